@@ -0,0 +1,294 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Lock-free acquisition ring buffer - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+// NOTE - The producer writes frames (and their mirrors) before it
+// release-stores "write_count", and the consumer acquire-loads
+// "write_count" before reading them. The consumer release-stores
+// "read_count" after it's done with frames, and the producer acquire-loads
+// it before reusing them. A mirrored frame at position depth+N stands for
+// frame N, so it's covered by the same ordering.
+
+
+//
+// nloop_AcqRing_t Class
+
+
+// Constructor.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+nloop_AcqRing_t(void)
+{
+  Clear();
+}
+
+
+
+// This returns the number of free frames, refreshing the producer's
+// cached read position if the cached value says there are fewer than
+// "wanted".
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+int nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+GetFreeCount_Producer(int wanted)
+{
+  unsigned long writeidx;
+  int freecount;
+
+  writeidx = write_count.load(memory_order_relaxed);
+  freecount = depth - (int) (writeidx - producer_read_cache);
+
+  if (freecount < wanted)
+  {
+    producer_read_cache = read_count.load(memory_order_acquire);
+    freecount = depth - (int) (writeidx - producer_read_cache);
+  }
+
+  return freecount;
+}
+
+
+
+// This copies newly-written frames into the mirror area, if needed.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+void nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+UpdateMirror(unsigned long firstidx, int count)
+{
+  int fidx, ringidx;
+
+  for (fidx = 0; fidx < count; fidx++)
+  {
+    ringidx = (int) ((firstidx + fidx) % depth);
+    if (ringidx < maxblock)
+      frames[depth + ringidx].CopyFrom(frames[ringidx]);
+  }
+}
+
+
+
+// This copies up to "count" frames into the ring, and returns the number
+// that fit.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+int nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::PushFrames(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *newframes, int count)
+{
+  unsigned long writeidx;
+  int freecount, fidx, fillcount;
+
+  if (1 > count)
+    return 0;
+
+  freecount = GetFreeCount_Producer(count);
+  if (freecount > count)
+    freecount = count;
+
+  writeidx = write_count.load(memory_order_relaxed);
+
+  for (fidx = 0; fidx < freecount; fidx++)
+    frames[(writeidx + fidx) % depth].CopyFrom(newframes[fidx]);
+
+  UpdateMirror(writeidx, freecount);
+
+  if (freecount < count)
+    CountOverrun(count - freecount);
+
+  write_count.store(writeidx + freecount, memory_order_release);
+
+  fillcount = (int) (writeidx + freecount - producer_read_cache);
+  if (fillcount > peak_fill.load(memory_order_relaxed))
+    peak_fill.store(fillcount, memory_order_relaxed);
+
+  return freecount;
+}
+
+
+
+// This returns a pointer to contiguous free frames.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+nloop_SampleSlice_t<samptype_t, 1, chancount> *
+nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::GetWriteSpan(
+  int &count)
+{
+  unsigned long writeidx;
+  int ringidx, freecount;
+
+  writeidx = write_count.load(memory_order_relaxed);
+  ringidx = (int) (writeidx % depth);
+
+  // Spans stop at the end of the ring.
+  count = depth - ringidx;
+
+  freecount = GetFreeCount_Producer(count);
+  if (freecount < count)
+    count = freecount;
+
+  if (1 > count)
+  {
+    count = 0;
+    return NULL;
+  }
+
+  return &(frames[ringidx]);
+}
+
+
+
+// This makes frames written through GetWriteSpan() visible to the consumer.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+void nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::CommitWrite(
+  int count)
+{
+  unsigned long writeidx;
+  int fillcount;
+
+  if (1 > count)
+    return;
+
+  writeidx = write_count.load(memory_order_relaxed);
+
+  UpdateMirror(writeidx, count);
+
+  write_count.store(writeidx + count, memory_order_release);
+
+  fillcount = (int) (writeidx + count - producer_read_cache);
+  if (fillcount > peak_fill.load(memory_order_relaxed))
+    peak_fill.store(fillcount, memory_order_relaxed);
+}
+
+
+
+// This records frames that the producer had to discard.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+void nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::CountOverrun(
+  int count)
+{
+  if (1 > count)
+    return;
+
+  overrun_frames.fetch_add(count, memory_order_relaxed);
+  overrun_events.fetch_add(1, memory_order_relaxed);
+}
+
+
+
+// This is the number of frames waiting to be read.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+int nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+GetReadableCount(void)
+{
+  consumer_write_cache = write_count.load(memory_order_acquire);
+
+  return (int) (consumer_write_cache - read_count.load(memory_order_relaxed));
+}
+
+
+
+// This returns a pointer to "count" contiguous frames, or NULL if they
+// aren't available.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+nloop_SampleSlice_t<samptype_t, 1, chancount> *
+nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::GetReadBlock(
+  int count)
+{
+  unsigned long readidx;
+
+  if ( (1 > count) || (maxblock < count) )
+    return NULL;
+
+  readidx = read_count.load(memory_order_relaxed);
+
+  if ( ((int) (consumer_write_cache - readidx)) < count )
+  {
+    consumer_write_cache = write_count.load(memory_order_acquire);
+    if ( ((int) (consumer_write_cache - readidx)) < count )
+      return NULL;
+  }
+
+  // The mirror area makes this contiguous even if it wraps.
+  return &(frames[readidx % depth]);
+}
+
+
+
+// This hands frames from GetReadBlock() back to the producer.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+void nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::ReleaseRead(
+  int count)
+{
+  if (1 > count)
+    return;
+
+  read_count.store( read_count.load(memory_order_relaxed) + count,
+    memory_order_release );
+}
+
+
+
+// Statistics accessors.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+unsigned long nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+GetOverrunFrames(void)
+{
+  return overrun_frames.load(memory_order_relaxed);
+}
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+unsigned long nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+GetOverrunEvents(void)
+{
+  return overrun_events.load(memory_order_relaxed);
+}
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+int nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+GetPeakFill(void)
+{
+  return peak_fill.load(memory_order_relaxed);
+}
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+void nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::
+ResetStatistics(void)
+{
+  overrun_frames.store(0);
+  overrun_events.store(0);
+  peak_fill.store(0);
+}
+
+
+
+// This empties the ring and resets statistics.
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+void nloop_AcqRing_t<samptype_t, chancount, depth, maxblock>::Clear(void)
+{
+  write_count.store(0);
+  read_count.store(0);
+  producer_read_cache = 0;
+  consumer_write_cache = 0;
+
+  ResetStatistics();
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,147 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Lock-free acquisition ring buffer - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <atomic> from C++11, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_ACQRING_H
+#define NLOOP_ACQRING_H
+
+
+// An acquisition ring passes input frames (one sample from every channel)
+// from an acquisition thread to the DSP thread without locks. There must be
+// exactly one producer and one consumer.
+//
+// The producer adds frames in batches, either by copying them in
+// (PushFrames()) or by writing directly into the ring (GetWriteSpan() and
+// CommitWrite()). If the ring is full, frames that don't fit are dropped
+// and counted as overruns; the producer never waits.
+//
+// The consumer reads whole blocks in place (GetReadBlock() and
+// ReleaseRead()). Blocks of up to "maxblock" frames are always contiguous,
+// even when they wrap around the end of the ring, so they can be passed
+// straight to a pipeline's ProcessBlock():
+//
+//   inframes = ring.GetReadBlock(blocksize);
+//   if (NULL != inframes)
+//   {
+//     pipeline.ProcessBlock(inframes, trigout, blocksize);
+//     ring.ReleaseRead(blocksize);
+//   }
+//
+// To do this, the first "maxblock" frames of the ring are mirrored past
+// its end when they're written. "maxblock" must not exceed "depth".
+//
+// Producer and consumer state are on separate cache lines. Each side keeps
+// a cached copy of the other side's position and only re-reads it when the
+// cached copy says the ring is full (or empty). The lines are separated by
+// explicit padding rather than "alignas", since "new" doesn't honour
+// over-aligned types before C++17.
+//
+// NOTE - This is large. Allocate it on the heap, not the stack.
+
+
+//
+// Classes
+
+
+template <class samptype_t, int chancount, int depth, int maxblock>
+class nloop_AcqRing_t
+{
+protected:
+  // Frames, plus a mirror of the first "maxblock" frames.
+  nloop_SampleSlice_t<samptype_t, 1, chancount> frames[depth + maxblock];
+
+  // Producer state. Counters are free-running.
+  uint8_t pad_frames[NLOOP_CACHE_LINE_BYTES];
+  atomic<unsigned long> write_count;
+  unsigned long producer_read_cache;
+  atomic<unsigned long> overrun_frames;
+  atomic<unsigned long> overrun_events;
+  atomic<int> peak_fill;
+
+  // Consumer state.
+  uint8_t pad_producer[NLOOP_CACHE_LINE_BYTES];
+  atomic<unsigned long> read_count;
+  unsigned long consumer_write_cache;
+  uint8_t pad_consumer[NLOOP_CACHE_LINE_BYTES];
+
+
+  // Helper functions.
+
+  // This returns the number of free frames, refreshing the producer's
+  // cached read position if needed.
+  int GetFreeCount_Producer(int wanted);
+  // This copies newly-written frames into the mirror area, if needed.
+  void UpdateMirror(unsigned long firstidx, int count);
+
+public:
+  nloop_AcqRing_t(void);
+  // Default destructor is fine.
+
+
+  // Producer functions.
+
+  // This copies up to "count" frames into the ring, and returns the number
+  // that fit. The rest are counted as overruns.
+  int PushFrames(nloop_SampleSlice_t<samptype_t, 1, chancount> *newframes,
+    int count);
+
+  // This returns a pointer to contiguous free frames, and sets "count" to
+  // the number available (possibly zero, in which case this returns NULL).
+  // Frames aren't visible to the consumer until CommitWrite() is called.
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *GetWriteSpan(int &count);
+  void CommitWrite(int count);
+
+  // This records frames that the producer had to discard without offering
+  // them (e.g. when GetWriteSpan() came up short).
+  void CountOverrun(int count);
+
+
+  // Consumer functions.
+
+  // This is the number of frames waiting to be read.
+  int GetReadableCount(void);
+
+  // This returns a pointer to "count" contiguous frames, or NULL if fewer
+  // than that are available or "count" is larger than "maxblock".
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *GetReadBlock(int count);
+  void ReleaseRead(int count);
+
+
+  // Statistics. These may be read from either side.
+
+  unsigned long GetOverrunFrames(void);
+  unsigned long GetOverrunEvents(void);
+  // This is the largest number of frames the ring has held, as seen by the
+  // producer. It can overestimate slightly, since the producer's copy of
+  // the read position may be stale.
+  int GetPeakFill(void);
+
+  // NOTE - Only call these while neither side is using the ring.
+  void ResetStatistics(void);
+  void Clear(void);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-acqring-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -177,6 +177,37 @@ GetEstimatedAnalytic(samptype_t &magnitude, indextype_t &period,
 
 
 
+// This saves feature identification state to a checkpoint.
+// Zero level and minimum period are configuration and aren't stored.
+
+template <class samptype_t, class indextype_t>
+void nloop_Analytic_PTZC_t<samptype_t,indextype_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.PutValue(max_mag_seen);
+  statebuf.PutValue(last_mag);
+  statebuf.PutValue(since_rise_count);
+  statebuf.PutValue(since_fall_count);
+  statebuf.PutValue(last_period);
+}
+
+
+
+// This restores feature identification state from a checkpoint.
+
+template <class samptype_t, class indextype_t>
+void nloop_Analytic_PTZC_t<samptype_t,indextype_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.GetValue(max_mag_seen);
+  statebuf.GetValue(last_mag);
+  statebuf.GetValue(since_rise_count);
+  statebuf.GetValue(since_fall_count);
+  statebuf.GetValue(last_period);
+}
+
+
+
 //
 // FIXME - Flank-crossing estimator NYI.
 
@@ -217,6 +248,8 @@ HandleSamples(nloop_SampleSlice_t<samptype_t, bankcount, chancount> &indata)
 {
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_ANALYTICBANK);
+
   for (bidx = 0; bidx < banks_active; bidx++)
     for (cidx = 0; cidx < chans_active; cidx++)
       estimators[bidx][cidx].HandleSample( indata.data[bidx][cidx] );
@@ -380,5 +413,46 @@ SetOneZeroLevel(int bankidx, int chanidx, samptype_t newzero)
 
 
 
+// This saves estimator state for active banks and channels.
+
+template <class samptype_t, class indextype_t, class estimator_t,
+  int bankcount, int chancount>
+void nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+  bankcount, chancount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag(NLOOP_STATE_ANALYTICBANK, banks_active, chans_active, 0);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      estimators[bidx][cidx].SaveState(statebuf);
+}
+
+
+
+// This restores estimator state for active banks and channels.
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, class indextype_t, class estimator_t,
+  int bankcount, int chancount>
+void nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+  bankcount, chancount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_ANALYTICBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      estimators[bidx][cidx].LoadState(statebuf);
+}
+
+
+
 //
 // This is the end of the file.
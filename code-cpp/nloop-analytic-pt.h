@@ -49,6 +49,11 @@ public:
   void HandleSample(samptype_t sampval);
   void GetEstimatedAnalytic(samptype_t &magnitude, indextype_t &period,
     indextype_t &since_rise_zc, indextype_t &since_fall_zc);
+
+  // Checkpointing. This saves or restores feature identification state.
+  // Zero level and minimum period are configuration and aren't stored.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -111,6 +116,13 @@ public:
     nloop_SampleSlice_t<samptype_t,bankcount,chancount> &newzeros
   );
   void SetOneZeroLevel(int bankidx, int chanidx, samptype_t newzero);
+
+
+  // Checkpointing. This saves or restores estimator state for active
+  // banks and channels. Estimators must provide SaveState()/LoadState().
+  // Loading fails if the active geometry doesn't match.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -0,0 +1,148 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Aligned storage arena for run-time geometry modules - non-template
+// functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <string.h>
+
+
+//
+// nloop_Arena_t Class
+
+
+// Constructor.
+
+nloop_Arena_t::nloop_Arena_t(void)
+{
+  storage = NULL;
+  reserved_bytes = 0;
+  carved_bytes = 0;
+  is_committed = false;
+}
+
+
+
+// Destructor.
+
+nloop_Arena_t::~nloop_Arena_t(void)
+{
+  Clear();
+}
+
+
+
+// This rounds a byte count up to a multiple of the alignment.
+
+size_t nloop_Arena_t::RoundUp(size_t bytes)
+{
+  return ( (bytes + NLOOP_ARENA_ALIGN_BYTES - 1)
+    / NLOOP_ARENA_ALIGN_BYTES ) * NLOOP_ARENA_ALIGN_BYTES;
+}
+
+
+
+// This frees the block (if any) and starts a new reservation pass.
+
+void nloop_Arena_t::Clear(void)
+{
+  if (NULL != storage)
+    free(storage);
+
+  storage = NULL;
+  reserved_bytes = 0;
+  carved_bytes = 0;
+  is_committed = false;
+}
+
+
+
+// This adds "bytes" bytes to the reservation. Reservations after Commit()
+// are ignored.
+
+void nloop_Arena_t::Reserve(size_t bytes)
+{
+  if (!is_committed)
+    reserved_bytes += RoundUp(bytes);
+}
+
+
+
+// This allocates and zeroes the block. It returns false if allocation
+// failed or if the arena was already committed.
+
+bool nloop_Arena_t::Commit(void)
+{
+  void *newblock;
+
+  if (is_committed)
+    return false;
+
+  // Even an empty reservation gets a valid (one-line) block.
+  newblock = NULL;
+  if ( 0 != posix_memalign( &newblock, NLOOP_ARENA_ALIGN_BYTES,
+    (0 < reserved_bytes) ? reserved_bytes : NLOOP_ARENA_ALIGN_BYTES ) )
+    return false;
+
+  storage = (uint8_t *) newblock;
+
+  // This also faults in every page.
+  memset(storage, 0, reserved_bytes);
+
+  carved_bytes = 0;
+  is_committed = true;
+
+  return true;
+}
+
+
+
+// This returns the next "bytes" bytes of the block, or NULL if the arena
+// isn't committed or the request runs past the end of the reservation.
+
+void *nloop_Arena_t::Carve(size_t bytes)
+{
+  void *result;
+
+  if (!is_committed)
+    return NULL;
+
+  bytes = RoundUp(bytes);
+
+  if (bytes > (reserved_bytes - carved_bytes))
+    return NULL;
+
+  result = storage + carved_bytes;
+  carved_bytes += bytes;
+
+  return result;
+}
+
+
+
+// Accessors.
+
+bool nloop_Arena_t::IsCommitted(void)
+{
+  return is_committed;
+}
+
+size_t nloop_Arena_t::GetTotalBytes(void)
+{
+  return reserved_bytes;
+}
+
+size_t nloop_Arena_t::GetCarvedBytes(void)
+{
+  return carved_bytes;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,96 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Aligned storage arena for run-time geometry modules - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This allocates from the heap with posix_memalign(), so it's
+// workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_ARENA_H
+#define NLOOP_ARENA_H
+
+
+// An arena holds the storage for a set of run-time geometry modules (see
+// nloop-dynbanks.h) in one aligned heap block. It's used in two passes:
+//
+//   arena.Clear();
+//   filters.ReserveStorage(arena, banks, chans);
+//   analytic.ReserveStorage(arena, banks, chans);
+//   arena.Commit();
+//   filters.AttachStorage(arena);
+//   analytic.AttachStorage(arena);
+//
+// Reserve() adds up the space that each module needs, and Commit() does
+// the one and only allocation. Carve() then hands out pieces of the block
+// in the order they were reserved, so modules must attach in the same order
+// that they reserved. Every piece starts on a cache line boundary.
+//
+// Commit() zeroes the block, which also touches every page, so there are
+// no first-use page faults during processing.
+//
+// NOTE - Modules hold pointers into the arena. Clearing or destroying the
+// arena invalidates them; re-reserve and re-attach after Clear().
+//
+// NOTE - Don't copy arenas. The copy would free the same block.
+
+
+//
+// Constants
+
+// Alignment of the block and of every piece carved from it.
+#define NLOOP_ARENA_ALIGN_BYTES NLOOP_CACHE_LINE_BYTES
+
+
+//
+// Classes
+
+
+class nloop_Arena_t
+{
+protected:
+  uint8_t *storage;
+
+  // Bytes reserved so far, and bytes handed out by Carve() so far.
+  size_t reserved_bytes;
+  size_t carved_bytes;
+
+  bool is_committed;
+
+  // This rounds a byte count up to a multiple of the alignment.
+  size_t RoundUp(size_t bytes);
+
+public:
+  nloop_Arena_t(void);
+  ~nloop_Arena_t(void);
+
+  // This frees the block (if any) and starts a new reservation pass.
+  void Clear(void);
+
+  // This adds "bytes" bytes to the reservation. Reservations after
+  // Commit() are ignored.
+  void Reserve(size_t bytes);
+
+  // This allocates and zeroes the block. It returns false if allocation
+  // failed or if the arena was already committed.
+  bool Commit(void);
+
+  // This returns the next "bytes" bytes of the block, or NULL if the arena
+  // isn't committed or the request runs past the end of the reservation.
+  void *Carve(size_t bytes);
+
+  bool IsCommitted(void);
+  // Total block size, and how much of it has been carved so far.
+  size_t GetTotalBytes(void);
+  size_t GetCarvedBytes(void);
+};
+
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
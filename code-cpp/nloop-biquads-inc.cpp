@@ -17,8 +17,9 @@
 
 // Constructor.
 
-template <class samptype_t, class indextype_t>
-nloop_IIRBiquad_t<samptype_t, indextype_t>::nloop_IIRBiquad_t(void)
+template <class samptype_t, class indextype_t, class accumtype_t>
+nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t>::
+  nloop_IIRBiquad_t(void)
 {
   // Default initialization should give zero coefficients, but force anyways.
   BlankCoefficients();
@@ -29,12 +30,12 @@ nloop_IIRBiquad_t<samptype_t, indextype_t>::nloop_IIRBiquad_t(void)
 // Process linear buffers.
 // NOTE - Elements [0], [-1], and [-2] are read/written.
 
-template <class samptype_t, class indextype_t>
-void nloop_IIRBiquad_t<samptype_t, indextype_t>::ApplyBiquadOnceLinear(
-  samptype_t *inbuf, samptype_t *outbuf)
+template <class samptype_t, class indextype_t, class accumtype_t>
+void nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t>::
+  ApplyBiquadOnceLinear(samptype_t *inbuf, samptype_t *outbuf)
 {
   samptype_t innow, inprev1, inprev2, outprev1, outprev2;
-  samptype_t outnow;
+  accumtype_t outnow;
 
   innow = *inbuf;
   inprev1 = *(inbuf - 1);
@@ -42,20 +43,22 @@ void nloop_IIRBiquad_t<samptype_t, indextype_t>::ApplyBiquadOnceLinear(
   outprev1 = *(outbuf - 1);
   outprev2 = *(outbuf - 2);
 
-  outnow = num0 * innow;
-  outnow += num1 * inprev1;
-  outnow += num2 * inprev2;
-  outnow -= den1 * outprev1;
-  outnow -= den2 * outprev2;
+  // Products and sums are in the accumulator type. Only the result is
+  // narrowed.
+  outnow = ((accumtype_t) num0) * ((accumtype_t) innow);
+  outnow += ((accumtype_t) num1) * ((accumtype_t) inprev1);
+  outnow += ((accumtype_t) num2) * ((accumtype_t) inprev2);
+  outnow -= ((accumtype_t) den1) * ((accumtype_t) outprev1);
+  outnow -= ((accumtype_t) den2) * ((accumtype_t) outprev2);
 
   // FIXME - This will be very slow for unsigned operands!
   // Use pointer tricks to treat it as signed instead.
-  if (NLOOP_ISSIGNED(samptype_t))
+  if (NLOOP_ISSIGNED(accumtype_t))
   { NLOOP_ARITHSHR(outnow, den0_bits); }
   else
   { NLOOP_ARITHSHR_UNSIGNED(outnow, den0_bits); }
 
-  *outbuf = outnow;
+  *outbuf = (samptype_t) outnow;
 }
 
 
@@ -64,13 +67,14 @@ void nloop_IIRBiquad_t<samptype_t, indextype_t>::ApplyBiquadOnceLinear(
 // NOTE - Buffer size must be a power of two! The mask is used for wrapping.
 // Elements [n], [n-1], and [n-2] are read/written.
 
-template <class samptype_t, class indextype_t>
-void nloop_IIRBiquad_t<samptype_t, indextype_t>::ApplyBiquadOnceCircular(
-  samptype_t *inbuf, indextype_t inptr, indextype_t inbufmask,
-  samptype_t *outbuf, indextype_t outptr, indextype_t outbufmask )
+template <class samptype_t, class indextype_t, class accumtype_t>
+void nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t>::
+  ApplyBiquadOnceCircular(
+    samptype_t *inbuf, indextype_t inptr, indextype_t inbufmask,
+    samptype_t *outbuf, indextype_t outptr, indextype_t outbufmask )
 {
   samptype_t innow, inprev1, inprev2, outprev1, outprev2;
-  samptype_t outnow;
+  accumtype_t outnow;
   indextype_t saved_outptr;
 
   // Remember that adding the mask value is equivalent to adding -1.
@@ -89,29 +93,32 @@ void nloop_IIRBiquad_t<samptype_t, indextype_t>::ApplyBiquadOnceCircular(
   outprev2 = outbuf[outptr];
 
 
-  outnow = num0 * innow;
-  outnow += num1 * inprev1;
-  outnow += num2 * inprev2;
-  outnow -= den1 * outprev1;
-  outnow -= den2 * outprev2;
+  // Products and sums are in the accumulator type. Only the result is
+  // narrowed.
+  outnow = ((accumtype_t) num0) * ((accumtype_t) innow);
+  outnow += ((accumtype_t) num1) * ((accumtype_t) inprev1);
+  outnow += ((accumtype_t) num2) * ((accumtype_t) inprev2);
+  outnow -= ((accumtype_t) den1) * ((accumtype_t) outprev1);
+  outnow -= ((accumtype_t) den2) * ((accumtype_t) outprev2);
 
   // FIXME - This will be very slow for unsigned operands!
   // Use pointer tricks to treat it as signed instead.
-  if (NLOOP_ISSIGNED(samptype_t))
+  if (NLOOP_ISSIGNED(accumtype_t))
   { NLOOP_ARITHSHR(outnow, den0_bits); }
   else
   { NLOOP_ARITHSHR_UNSIGNED(outnow, den0_bits); }
 
 
-  outbuf[saved_outptr] = outnow;
+  outbuf[saved_outptr] = (samptype_t) outnow;
 }
 
 
 
 // Blanking accessor.
 
-template <class samptype_t, class indextype_t>
-void nloop_IIRBiquad_t<samptype_t, indextype_t>::BlankCoefficients(void)
+template <class samptype_t, class indextype_t, class accumtype_t>
+void nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t>::
+  BlankCoefficients(void)
 {
   // Setting everything to zero gives a valid filter with zero output.
 
@@ -121,15 +128,16 @@ void nloop_IIRBiquad_t<samptype_t, indextype_t>::BlankCoefficients(void)
 
   num0 = 0;
   num1 = 0;
-  num0 = 0;
+  num2 = 0;
 }
 
 
 
 // Read accessor.
 
-template <class samptype_t, class indextype_t>
-void nloop_IIRBiquad_t<samptype_t, indextype_t>::GetCoefficients(
+template <class samptype_t, class indextype_t, class accumtype_t>
+void nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t>::
+  GetCoefficients(
   uint8_t &old_den0bits, samptype_t &old_den1, samptype_t &old_den2,
   samptype_t &old_num0, samptype_t &old_num1, samptype_t &old_num2 )
 {
@@ -146,8 +154,9 @@ void nloop_IIRBiquad_t<samptype_t, indextype_t>::GetCoefficients(
 
 // Write accessor.
 
-template <class samptype_t, class indextype_t>
-void nloop_IIRBiquad_t<samptype_t, indextype_t>::SetCoefficients(
+template <class samptype_t, class indextype_t, class accumtype_t>
+void nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t>::
+  SetCoefficients(
   uint8_t new_den0bits, samptype_t new_den1, samptype_t new_den2,
   samptype_t new_num0, samptype_t new_num1, samptype_t new_num2 )
 {
@@ -168,12 +177,24 @@ void nloop_IIRBiquad_t<samptype_t, indextype_t>::SetCoefficients(
 
 // Constructor.
 
-template <class samptype_t, class indextype_t, int stagecount>
-nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   nloop_IIRBiquadChain_t(void)
 {
+  int sidx, bidx;
+
   // Default initialization should give zero coefficients, but force anyways.
   BlankCoefficients();
+
+  // Start with no active stages and empty history, as the FIR bank does.
+  stages_active = 0;
+  bufptr = 0;
+
+  for (sidx = 0; sidx <= stagecount; sidx++)
+    for (bidx = 0; bidx < NLOOP_IIRBIQUADCHAIN_BUFSIZE; bidx++)
+      buffers[sidx][bidx] = 0;
 }
 
 
@@ -183,8 +204,10 @@ nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 // NOTE - This only reads the addressed elements. History is kept in internal
 // buffers. As a result, this takes time to stabilize.
 
-template <class samptype_t, class indextype_t, int stagecount>
-void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   ApplyChainOnce(samptype_t &indata, samptype_t &outdata)
 {
   int sidx;
@@ -211,8 +234,10 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 
 // Read the number of active stages.
 
-template <class samptype_t, class indextype_t, int stagecount>
-int nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+int nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   GetActiveStages(void)
 {
   return stages_active;
@@ -222,8 +247,10 @@ int nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 
 // Set the number of active stages.
 
-template <class samptype_t, class indextype_t, int stagecount>
-void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   SetActiveStages(int new_stages)
 {
   if (new_stages < 0)
@@ -240,8 +267,10 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 // Blank the filter coefficients.
 // This produces a valid filter configuration with zero output.
 
-template <class samptype_t, class indextype_t, int stagecount>
-void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   BlankCoefficients(void)
 {
   int sidx;
@@ -254,8 +283,10 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 
 // Read biquad coefficients for one stage.
 
-template <class samptype_t, class indextype_t, int stagecount>
-void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   GetCoefficients( int stagenum,
   uint8_t &old_den0bits, samptype_t &old_den1, samptype_t &old_den2,
   samptype_t &old_num0, samptype_t &old_num1, samptype_t &old_num2 )
@@ -276,8 +307,10 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 
 // Write biquad coefficients for one stage.
 
-template <class samptype_t, class indextype_t, int stagecount>
-void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   SetCoefficients( int stagenum,
   uint8_t new_den0bits, samptype_t new_den1, samptype_t new_den2,
   samptype_t new_num0, samptype_t new_num1, samptype_t new_num2 )
@@ -293,8 +326,10 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 // Stages are either stuffed with the input value (suitable for low-pass
 // stages) or with zero (suitable for high-pass and band-pass stages).
 
-template <class samptype_t, class indextype_t, int stagecount>
-void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
   FastSettleBuffers(samptype_t &indata, bool (&copy_input)[stagecount])
 {
   int stidx, vidx;
@@ -320,6 +355,46 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 
 
 
+// Save the internal buffers of active stages to a checkpoint.
+// Buffer 0 is the input history; buffers 1..stages_active are outputs.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int stidx;
+
+  for (stidx = 0; stidx <= stages_active; stidx++)
+    statebuf.PutArray(buffers[stidx], NLOOP_IIRBIQUADCHAIN_BUFSIZE);
+
+  statebuf.PutValue( (uint8_t) bufptr );
+}
+
+
+
+// Restore the internal buffers of active stages from a checkpoint.
+// The chain must have the same number of active stages as when saved.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int stidx;
+  uint8_t newptr;
+
+  for (stidx = 0; stidx <= stages_active; stidx++)
+    statebuf.GetArray(buffers[stidx], NLOOP_IIRBIQUADCHAIN_BUFSIZE);
+
+  statebuf.GetValue(newptr);
+  bufptr = newptr & (NLOOP_IIRBIQUADCHAIN_BUFSIZE - 1);
+}
+
+
+
 //
 // nloop_IIRFilterBank_t class.
 
@@ -327,11 +402,15 @@ void nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>::
 // Constructor.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   nloop_IIRFilterBank_t(void)
 {
+  // Start with no active geometry, as the FIR bank does.
+  chans_active = 0;
+  banks_active = 0;
+
   // Default initialization should give zero coefficients, but force anyways.
   BlankCoefficients();
 }
@@ -344,9 +423,9 @@ nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // the output array will get stale.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   ApplyBankOnce(
     nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
     nloop_SampleSlice_t<samptype_t, bankcount, chancount> &outdata
@@ -354,6 +433,8 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 {
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_IIRBANK);
+
   for (bidx = 0; bidx < banks_active; bidx++)
     for (cidx = 0; cidx < chans_active; cidx++)
       biquads[bidx][cidx].ApplyChainOnce( indata.data[0][cidx],
@@ -365,9 +446,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Read the number of active stages.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 int nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   GetActiveStages(void)
 {
   // Read from the first biquad chain. They all should be the same.
@@ -380,9 +461,9 @@ int nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // This is set for all channels and banks, not just active ones.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   SetActiveStages(int new_stages)
 {
   int bidx, cidx;
@@ -403,9 +484,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Read the number of active channels.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 int nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   GetActiveChans(void)
 {
   return chans_active;
@@ -416,9 +497,9 @@ int nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Set the number of active channels.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   SetActiveChans(int new_chans)
 {
   if (new_chans < 0)
@@ -434,9 +515,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Read the number of active banks.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 int nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   GetActiveBanks(void)
 {
   return banks_active;
@@ -447,9 +528,9 @@ int nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Set the number of active banks.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   SetActiveBanks(int new_banks)
 {
   if (new_banks < 0)
@@ -466,9 +547,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // This produces a valid filter configuration with zero output.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   BlankCoefficients(void)
 {
   int bidx, cidx;
@@ -483,9 +564,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Read filter coefficients for one bank.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   GetCoefficients( int stagenum, int banknum,
     uint8_t &old_den0bits, samptype_t &old_den1, samptype_t &old_den2,
     samptype_t &old_num0, samptype_t &old_num1, samptype_t &old_num2 )
@@ -502,9 +583,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // Coefficients are updated for all channels, not just active channels.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   SetCoefficients( int stagenum, int banknum,
     uint8_t new_den0bits, samptype_t new_den1, samptype_t new_den2,
     samptype_t new_num0, samptype_t new_num1, samptype_t new_num2 )
@@ -515,7 +596,7 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
   {
     // Set coefficients for all channels in this bank.
     for (cidx = 0; cidx < chancount; cidx++)
-      biquads[banknum][0].SetCoefficients( stagenum,
+      biquads[banknum][cidx].SetCoefficients( stagenum,
         new_den0bits, new_den1, new_den2, new_num0, new_num1, new_num2 );
   }
 }
@@ -528,9 +609,9 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 // This updates all channels, not just active channels.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount, class accumtype_t>
 void nloop_IIRFilterBank_t<samptype_t, indextype_t,
-  stagecount, bankcount, chancount>::
+  stagecount, bankcount, chancount, accumtype_t>::
   FastSettleBuffers(
     nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
     bool (&copy_input)[stagecount]
@@ -546,5 +627,47 @@ void nloop_IIRFilterBank_t<samptype_t, indextype_t,
 
 
 
+// Save internal buffers for active channels and banks to a checkpoint.
+
+template <class samptype_t, class indextype_t,
+  int stagecount, int bankcount, int chancount, class accumtype_t>
+void nloop_IIRFilterBank_t<samptype_t, indextype_t,
+  stagecount, bankcount, chancount, accumtype_t>::
+  SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag( NLOOP_STATE_IIRBANK, banks_active, chans_active,
+    GetActiveStages() );
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      biquads[bidx][cidx].SaveState(statebuf);
+}
+
+
+
+// Restore internal buffers for active channels and banks from a checkpoint.
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, class indextype_t,
+  int stagecount, int bankcount, int chancount, class accumtype_t>
+void nloop_IIRFilterBank_t<samptype_t, indextype_t,
+  stagecount, bankcount, chancount, accumtype_t>::
+  LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_IIRBANK, banks_active, chans_active,
+    GetActiveStages() ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      biquads[bidx][cidx].LoadState(statebuf);
+}
+
+
+
 //
 // This is the end of the file.
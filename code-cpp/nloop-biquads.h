@@ -31,8 +31,16 @@
 //
 // The index type is used for indexing and for masking with circular buffers.
 // It's typically an unsigned integer type.
+//
+// The accumulator type holds products and sums. It defaults to the sample
+// type. Making it wider (e.g. int16_t samples with an int32_t accumulator)
+// avoids intermediate overflow without widening samples, coefficients, or
+// history; only the final shifted result is narrowed to the sample type.
+// NOTE - The narrowed result wraps if it doesn't fit the sample type.
 
-template <class samptype_t, class indextype_t> class nloop_IIRBiquad_t
+template <class samptype_t, class indextype_t,
+  class accumtype_t = samptype_t>
+class nloop_IIRBiquad_t
 {
 protected:
   // Biquad filter coefficients.
@@ -85,12 +93,13 @@ public:
 
 #define NLOOP_IIRBIQUADCHAIN_BUFSIZE 4
 
-template <class samptype_t, class indextype_t, int stagecount>
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t = samptype_t>
 class nloop_IIRBiquadChain_t
 {
 protected:
   // Biquad instances.
-  nloop_IIRBiquad_t<samptype_t, indextype_t> biquads[stagecount];
+  nloop_IIRBiquad_t<samptype_t, indextype_t, accumtype_t> biquads[stagecount];
 
   // Buffers for intermediate results.
   // Make life easier on ourselves and buffer input and output too.
@@ -137,6 +146,12 @@ public:
   // quickly. Buffers are either stuffed with the input value (suitable for
   // low-pass stages) or with zero (suitable for high-pass and band-pass).
   void FastSettleBuffers(samptype_t &indata, bool (&copy_input)[stagecount]);
+
+  // Checkpointing. This saves or restores the internal buffers of active
+  // stages. The chain must have the same number of active stages when
+  // loading.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -153,7 +168,8 @@ public:
 // Filters may take time to stabilize as a result.
 
 template <class samptype_t, class indextype_t,
-  int stagecount, int bankcount, int chancount>
+  int stagecount, int bankcount, int chancount,
+  class accumtype_t = samptype_t>
 class nloop_IIRFilterBank_t
 {
 protected:
@@ -162,7 +178,7 @@ protected:
   // buffered data will vary.
   // NOTE - This means coefficient values are replicated, which may cause
   // space issues in embedded systems.
-  nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount>
+  nloop_IIRBiquadChain_t<samptype_t, indextype_t, stagecount, accumtype_t>
     biquads[bankcount][chancount];
 
   // Number of channels and banks that are actually being used.
@@ -220,6 +236,12 @@ public:
     nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
     bool (&copy_input)[stagecount]
   );
+
+  // Checkpointing. This saves or restores the internal buffers of active
+  // channels and banks. Loading fails if the active geometry (including
+  // the number of active stages) doesn't match what was saved.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
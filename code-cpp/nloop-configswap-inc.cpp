@@ -0,0 +1,191 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Double-buffered configuration hot-swapping - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+// NOTE - There is exactly one control thread and one DSP loop. The
+// "swap_pending" flag hands ownership of the inactive copy back and forth:
+// the control thread's writes are published by a release-store of "true",
+// and the DSP loop's last use of the old copy is published by a
+// release-store of "false".
+
+
+//
+// nloop_ConfigSwap_t Class
+
+
+// Constructor.
+
+template <class config_t>
+nloop_ConfigSwap_t<config_t>::nloop_ConfigSwap_t(void)
+{
+  active_idx.store(0);
+  swap_pending.store(false);
+  swap_count.store(0);
+
+  state_scratch.clear();
+  state_backup.clear();
+  backup_bytes = 0;
+  want_carry_state = true;
+  last_carry_ok = false;
+}
+
+
+
+// This returns the inactive copy for loading, or NULL if the previous
+// update hasn't been picked up by the DSP loop yet.
+
+template <class config_t>
+config_t *nloop_ConfigSwap_t<config_t>::BeginUpdate(void)
+{
+  if (swap_pending.load(memory_order_acquire))
+    return NULL;
+
+  return &(configs[1 - active_idx.load(memory_order_relaxed)]);
+}
+
+
+
+// This makes the inactive copy available to the DSP loop.
+// NOTE - This may allocate (to size the state scratch buffers).
+
+template <class config_t>
+void nloop_ConfigSwap_t<config_t>::PublishUpdate(void)
+{
+  nloop_StateBuffer_t statebuf;
+  size_t newsize;
+
+  // Ignore this if an update is already pending; the caller didn't get a
+  // copy from BeginUpdate().
+  if (swap_pending.load(memory_order_acquire))
+    return;
+
+  // Size the scratch buffer for the new copy's state. If the old copy has
+  // different geometry, carrying state over will fail anyways.
+  // Also save the new copy's own state, so that a carry that fails part of
+  // the way through can be rolled back.
+  if (want_carry_state)
+  {
+    config_t &newconfig = configs[1 - active_idx.load(memory_order_relaxed)];
+
+    statebuf.StartWrite(NULL, 0);
+    newconfig.SaveState(statebuf);
+    newsize = statebuf.GetByteCount();
+
+    if (state_scratch.size() < newsize)
+      state_scratch.resize(newsize);
+    if (state_backup.size() < newsize)
+      state_backup.resize(newsize);
+
+    statebuf.StartWrite(state_backup.data(), newsize);
+    newconfig.SaveState(statebuf);
+    backup_bytes = statebuf.GetByteCount();
+  }
+
+  swap_pending.store(true, memory_order_release);
+}
+
+
+
+template <class config_t>
+bool nloop_ConfigSwap_t<config_t>::IsUpdatePending(void)
+{
+  return swap_pending.load(memory_order_acquire);
+}
+
+
+
+template <class config_t>
+void nloop_ConfigSwap_t<config_t>::SetCarryState(bool want_carry)
+{
+  // Don't change this while the DSP loop might be reading it.
+  if (!swap_pending.load(memory_order_acquire))
+    want_carry_state = want_carry;
+}
+
+
+
+// This switches to the most recently published copy if there is one, and
+// returns the active copy.
+
+template <class config_t>
+config_t *nloop_ConfigSwap_t<config_t>::GetActive(void)
+{
+  nloop_StateBuffer_t statebuf;
+  int oldidx, newidx;
+
+  oldidx = active_idx.load(memory_order_relaxed);
+
+  if (swap_pending.load(memory_order_acquire))
+  {
+    newidx = 1 - oldidx;
+
+    // Carry processing state over. Save into scratch and load back out; if
+    // either step fails, the new copy keeps its own state.
+    last_carry_ok = false;
+    if (want_carry_state)
+    {
+      statebuf.StartWrite(state_scratch.data(), state_scratch.size());
+      configs[oldidx].SaveState(statebuf);
+
+      if (statebuf.IsOk())
+      {
+        // Only consume what was written.
+        statebuf.StartRead(state_scratch.data(), statebuf.GetByteCount());
+        configs[newidx].LoadState(statebuf);
+        last_carry_ok = statebuf.IsOk();
+
+        // Modules before a mismatched record have already loaded the old
+        // copy's state. Put back the state the new copy was published
+        // with, so that the carry is all-or-nothing.
+        if (!last_carry_ok)
+        {
+          statebuf.StartRead(state_backup.data(), backup_bytes);
+          configs[newidx].LoadState(statebuf);
+        }
+      }
+    }
+
+    active_idx.store(newidx, memory_order_relaxed);
+    swap_count.fetch_add(1, memory_order_relaxed);
+
+    // Hand the old copy back to the control thread.
+    swap_pending.store(false, memory_order_release);
+
+    oldidx = newidx;
+  }
+
+  return &(configs[oldidx]);
+}
+
+
+
+template <class config_t>
+unsigned long nloop_ConfigSwap_t<config_t>::GetSwapCount(void)
+{
+  return swap_count.load(memory_order_relaxed);
+}
+
+
+
+// This reports whether state was carried over during the last swap.
+// NOTE - Read this from the DSP loop, or after IsUpdatePending() returns
+// false in the control thread.
+
+template <class config_t>
+bool nloop_ConfigSwap_t<config_t>::GetLastCarryOk(void)
+{
+  return last_carry_ok;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,124 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Double-buffered configuration hot-swapping - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <atomic> from C++11, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_CONFIGSWAP_H
+#define NLOOP_CONFIGSWAP_H
+
+
+// A configuration swapper holds two copies of a configuration object: one
+// that the DSP loop is using, and one that a control thread can load new
+// coefficients, tables, and thresholds into (from CSV files or snapshots).
+// The control thread publishes the new copy when it's done, and the DSP
+// loop switches to it the next time it asks for the active copy, which it
+// should do once per block. The DSP side never blocks and never allocates.
+//
+// "config_t" is typically a structure holding module banks and threshold
+// slices. It must provide SaveState() and LoadState() methods (see
+// nloop-state.h); module banks already do. When the DSP loop switches
+// copies, processing state (filter history and so forth) is carried over
+// from the old copy to the new one, so output continues without settling
+// transients. If any module's active geometry differs between the old and
+// new copies, no state is carried over; the new copy keeps whatever state
+// it was given by the control thread.
+//
+// NOTE - The copy handed to the control thread holds the configuration
+// from before the previous update. Updates should set everything they
+// care about, not just what changed since the last update.
+//
+// NOTE - config_t instances are often large. Allocate the swapper on the
+// heap, not the stack.
+
+
+//
+// Classes
+
+
+template <class config_t>
+class nloop_ConfigSwap_t
+{
+protected:
+  config_t configs[2];
+
+  // Index of the copy the DSP loop is using. Only the DSP loop writes this.
+  atomic<int> active_idx;
+
+  // This is set by the control thread when the inactive copy is ready, and
+  // cleared by the DSP loop once it has switched. While it's set, the
+  // control thread may not touch the inactive copy or the scratch buffer.
+  atomic<bool> swap_pending;
+
+  // Scratch space for carrying state across a swap. This is sized by the
+  // control thread when publishing, so the DSP loop doesn't allocate.
+  vector<uint8_t> state_scratch;
+  // The new copy's own state, saved when publishing. If carrying state
+  // over fails part of the way through, this is loaded back.
+  vector<uint8_t> state_backup;
+  size_t backup_bytes;
+  bool want_carry_state;
+  bool last_carry_ok;
+
+  atomic<unsigned long> swap_count;
+
+public:
+  nloop_ConfigSwap_t(void);
+  // Default destructor is fine.
+
+
+  // Control thread functions.
+
+  // This returns the inactive copy for loading, or NULL if the previous
+  // update hasn't been picked up by the DSP loop yet.
+  config_t *BeginUpdate(void);
+
+  // This makes the inactive copy available to the DSP loop.
+  // NOTE - This may allocate (to size the state scratch buffers).
+  void PublishUpdate(void);
+
+  bool IsUpdatePending(void);
+
+  // If this is false, processing state isn't carried over when swapping;
+  // the new copy keeps whatever state the control thread left it with.
+  void SetCarryState(bool want_carry);
+
+
+  // DSP loop functions.
+
+  // This switches to the most recently published copy if there is one, and
+  // returns the active copy. Call it at block boundaries, and use the
+  // returned pointer for the whole block.
+  config_t *GetActive(void);
+
+
+  // Diagnostics. These may be called from either thread.
+
+  unsigned long GetSwapCount(void);
+  // This reports whether state was carried over during the last swap.
+  // If it wasn't, none of the old copy's state was kept.
+  bool GetLastCarryOk(void);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-configswap-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
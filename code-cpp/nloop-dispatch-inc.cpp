@@ -0,0 +1,426 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Run-time CPU feature dispatch for vector kernels - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// Macros
+
+// Kernel bodies are written once and inlined into one wrapper per level.
+// Each wrapper's target attribute tells the compiler which instructions it
+// may use when vectorizing the body.
+// NOTE - The scalar level turns vectorization off. The vector levels turn
+// it on explicitly, since -O2 doesn't vectorize everywhere.
+
+#ifdef NLOOP_DISPATCH_X86
+
+#define NLOOP_DISPATCH_BODY inline __attribute__((always_inline))
+
+#define NLOOP_DISPATCH_ATTR_SCALAR \
+  __attribute__((optimize("no-tree-vectorize")))
+#define NLOOP_DISPATCH_ATTR_SSE2 \
+  __attribute__((target("sse2"), optimize("tree-vectorize")))
+#define NLOOP_DISPATCH_ATTR_AVX2 \
+  __attribute__((target("avx2"), optimize("tree-vectorize")))
+#define NLOOP_DISPATCH_ATTR_AVX512 \
+  __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), \
+    optimize("tree-vectorize")))
+
+#else
+
+#define NLOOP_DISPATCH_BODY inline
+#define NLOOP_DISPATCH_ATTR_SCALAR
+
+#endif
+
+
+//
+// Kernel Bodies
+
+
+// FIR dot product.
+
+template <class samptype_t, class accumtype_t>
+NLOOP_DISPATCH_BODY accumtype_t nloop_DispatchDotBody(
+  const samptype_t *data, const samptype_t *coeffs, int count)
+{
+  accumtype_t running_total;
+  int cidx;
+
+  running_total = 0;
+
+  for (cidx = 0; cidx < count; cidx++)
+    running_total += ((accumtype_t) data[cidx])
+      * ((accumtype_t) coeffs[cidx]);
+
+  return running_total;
+}
+
+
+
+// One biquad stage across channels.
+// This is nloop_IIRBiquad_t::ApplyBiquadOnceLinear() with the loop over
+// channels on the inside.
+
+template <class samptype_t, class accumtype_t>
+NLOOP_DISPATCH_BODY void nloop_DispatchBiquadBody(
+  const samptype_t * __restrict__ indata, samptype_t * __restrict__ outdata,
+  samptype_t * __restrict__ history, int histstride,
+  const samptype_t *coeffs, uint8_t den0bits, int count)
+{
+  samptype_t * __restrict__ inprev1;
+  samptype_t * __restrict__ inprev2;
+  samptype_t * __restrict__ outprev1;
+  samptype_t * __restrict__ outprev2;
+  accumtype_t den1, den2, num0, num1, num2;
+  accumtype_t outnow;
+  samptype_t innow;
+  int cidx;
+
+  inprev1 = history;
+  inprev2 = history + histstride;
+  outprev1 = history + 2 * histstride;
+  outprev2 = history + 3 * histstride;
+
+  den1 = coeffs[0];
+  den2 = coeffs[1];
+  num0 = coeffs[2];
+  num1 = coeffs[3];
+  num2 = coeffs[4];
+
+  for (cidx = 0; cidx < count; cidx++)
+  {
+    innow = indata[cidx];
+
+    outnow = num0 * ((accumtype_t) innow);
+    outnow += num1 * ((accumtype_t) inprev1[cidx]);
+    outnow += num2 * ((accumtype_t) inprev2[cidx]);
+    outnow -= den1 * ((accumtype_t) outprev1[cidx]);
+    outnow -= den2 * ((accumtype_t) outprev2[cidx]);
+
+    if (NLOOP_ISSIGNED(accumtype_t))
+    { NLOOP_ARITHSHR(outnow, den0bits); }
+    else
+    { NLOOP_ARITHSHR_UNSIGNED(outnow, den0bits); }
+
+    inprev2[cidx] = inprev1[cidx];
+    inprev1[cidx] = innow;
+    outprev2[cidx] = outprev1[cidx];
+    outprev1[cidx] = (samptype_t) outnow;
+    outdata[cidx] = (samptype_t) outnow;
+  }
+}
+
+
+
+// Running averagers.
+// This is nloop_Averager_t::UpdateAverage() with the loop over elements on
+// the inside.
+
+template <class samptype_t>
+NLOOP_DISPATCH_BODY void nloop_DispatchAverageBody(
+  const samptype_t * __restrict__ indata, samptype_t * __restrict__ outdata,
+  samptype_t * __restrict__ running_sums, const samptype_t *coeffs,
+  const uint8_t *avgbits, uint8_t coeffbits, int count)
+{
+  samptype_t outval, thisbits;
+  int cidx;
+
+  for (cidx = 0; cidx < count; cidx++)
+  {
+    thisbits = avgbits[cidx];
+
+    outval = running_sums[cidx];
+    if (NLOOP_ISSIGNED(samptype_t))
+    { NLOOP_ARITHSHR(outval, thisbits); }
+    else
+    { NLOOP_ARITHSHR_UNSIGNED(outval, thisbits); }
+
+    running_sums[cidx] -= outval;
+    running_sums[cidx] += indata[cidx];
+
+    outval = running_sums[cidx];
+    if (NLOOP_ISSIGNED(samptype_t))
+    { NLOOP_ARITHSHR(outval, thisbits); }
+    else
+    { NLOOP_ARITHSHR_UNSIGNED(outval, thisbits); }
+
+    outval *= coeffs[cidx];
+
+    if (NLOOP_ISSIGNED(samptype_t))
+    { NLOOP_ARITHSHR(outval, coeffbits); }
+    else
+    { NLOOP_ARITHSHR_UNSIGNED(outval, coeffbits); }
+
+    outdata[cidx] = outval;
+  }
+}
+
+
+
+// Winner-take-all among rows.
+// Channels are on the inside so that every row is read sequentially.
+
+template <class samptype_t>
+NLOOP_DISPATCH_BODY void nloop_DispatchArgMaxBody(
+  const samptype_t *source, int stride, int banks, int chans,
+  int * __restrict__ selections, samptype_t * __restrict__ maxvals)
+{
+  const samptype_t *thisrow;
+  samptype_t thisval;
+  int bidx, cidx;
+
+  for (cidx = 0; cidx < chans; cidx++)
+  {
+    maxvals[cidx] = source[cidx];
+    selections[cidx] = 0;
+  }
+
+  for (bidx = 1; bidx < banks; bidx++)
+  {
+    thisrow = source + bidx * stride;
+
+    for (cidx = 0; cidx < chans; cidx++)
+    {
+      thisval = thisrow[cidx];
+      // Ties go to the earlier row.
+      selections[cidx] = (thisval > maxvals[cidx]) ? bidx : selections[cidx];
+      maxvals[cidx] = (thisval > maxvals[cidx]) ? thisval : maxvals[cidx];
+    }
+  }
+}
+
+
+
+// Monotonic table searches.
+// These count the keys that come before the match instead of searching,
+// so the time taken doesn't depend on the data (like the library's
+// pessimal linear search).
+
+template <class samptype_t>
+NLOOP_DISPATCH_BODY int nloop_DispatchLookupLEBody(
+  const samptype_t *keys, int rows, samptype_t value)
+{
+  int ridx, result;
+
+  result = 0;
+
+  // Keys are descending, so every key before the match is greater.
+  for (ridx = 0; ridx < rows; ridx++)
+    result += (keys[ridx] > value) ? 1 : 0;
+
+  return result;
+}
+
+template <class samptype_t>
+NLOOP_DISPATCH_BODY int nloop_DispatchLookupGEBody(
+  const samptype_t *keys, int rows, samptype_t value)
+{
+  int ridx, result;
+
+  result = 0;
+
+  // Keys are ascending, so every key before the match is smaller.
+  for (ridx = 0; ridx < rows; ridx++)
+    result += (keys[ridx] < value) ? 1 : 0;
+
+  return result;
+}
+
+
+//
+// Per-Level Wrappers
+
+// This defines one set of wrappers for a level.
+
+#define NLOOP_DISPATCH_WRAPPERS(SUFFIX, ATTR) \
+  \
+template <class samptype_t, class accumtype_t> ATTR \
+accumtype_t nloop_DispatchDot_##SUFFIX(const samptype_t *data, \
+  const samptype_t *coeffs, int count) \
+{ return nloop_DispatchDotBody<samptype_t, accumtype_t>( \
+  data, coeffs, count ); } \
+  \
+template <class samptype_t, class accumtype_t> ATTR \
+void nloop_DispatchBiquad_##SUFFIX(const samptype_t *indata, \
+  samptype_t *outdata, samptype_t *history, int histstride, \
+  const samptype_t *coeffs, uint8_t den0bits, int count) \
+{ nloop_DispatchBiquadBody<samptype_t, accumtype_t>( \
+  indata, outdata, history, histstride, coeffs, den0bits, count ); } \
+  \
+template <class samptype_t> ATTR \
+void nloop_DispatchAverage_##SUFFIX(const samptype_t *indata, \
+  samptype_t *outdata, samptype_t *running_sums, const samptype_t *coeffs, \
+  const uint8_t *avgbits, uint8_t coeffbits, int count) \
+{ nloop_DispatchAverageBody<samptype_t>( \
+  indata, outdata, running_sums, coeffs, avgbits, coeffbits, count ); } \
+  \
+template <class samptype_t> ATTR \
+void nloop_DispatchArgMax_##SUFFIX(const samptype_t *source, int stride, \
+  int banks, int chans, int *selections, samptype_t *maxvals) \
+{ nloop_DispatchArgMaxBody<samptype_t>( \
+  source, stride, banks, chans, selections, maxvals ); } \
+  \
+template <class samptype_t> ATTR \
+int nloop_DispatchLookupLE_##SUFFIX(const samptype_t *keys, int rows, \
+  samptype_t value) \
+{ return nloop_DispatchLookupLEBody<samptype_t>(keys, rows, value); } \
+  \
+template <class samptype_t> ATTR \
+int nloop_DispatchLookupGE_##SUFFIX(const samptype_t *keys, int rows, \
+  samptype_t value) \
+{ return nloop_DispatchLookupGEBody<samptype_t>(keys, rows, value); }
+
+
+NLOOP_DISPATCH_WRAPPERS(Scalar, NLOOP_DISPATCH_ATTR_SCALAR)
+
+#ifdef NLOOP_DISPATCH_X86
+NLOOP_DISPATCH_WRAPPERS(SSE2, NLOOP_DISPATCH_ATTR_SSE2)
+NLOOP_DISPATCH_WRAPPERS(AVX2, NLOOP_DISPATCH_ATTR_AVX2)
+NLOOP_DISPATCH_WRAPPERS(AVX512, NLOOP_DISPATCH_ATTR_AVX512)
+#endif
+
+
+// This fills a kernel table with one level's wrappers.
+
+#define NLOOP_DISPATCH_FILL(KERNELS, SUFFIX) \
+{ \
+  KERNELS.DotProduct = \
+    &nloop_DispatchDot_##SUFFIX<samptype_t, accumtype_t>; \
+  KERNELS.BiquadStage = \
+    &nloop_DispatchBiquad_##SUFFIX<samptype_t, accumtype_t>; \
+  KERNELS.Average = &nloop_DispatchAverage_##SUFFIX<samptype_t>; \
+  KERNELS.ArgMax = &nloop_DispatchArgMax_##SUFFIX<samptype_t>; \
+  KERNELS.LookupIndexLE = &nloop_DispatchLookupLE_##SUFFIX<samptype_t>; \
+  KERNELS.LookupIndexGE = &nloop_DispatchLookupGE_##SUFFIX<samptype_t>; \
+}
+
+
+//
+// Functions
+
+
+// This fills a kernel table for the level in use.
+
+template <class samptype_t, class accumtype_t>
+void nloop_GetDispatchKernels(
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels)
+{
+  nloop_GetDispatchKernelsForLevel(kernels, nloop_CPUGetLevel());
+}
+
+
+
+// This fills a kernel table for a specific level, clamped to what the CPU
+// supports. The level used is stored in the table.
+
+template <class samptype_t, class accumtype_t>
+void nloop_GetDispatchKernelsForLevel(
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels, int level)
+{
+  level = min( level, nloop_CPUDetectLevel() );
+  if (level < NLOOP_CPU_SCALAR)
+    level = NLOOP_CPU_SCALAR;
+
+  kernels.level = level;
+
+#ifdef NLOOP_DISPATCH_X86
+  if (NLOOP_CPU_AVX512 == level)
+    NLOOP_DISPATCH_FILL(kernels, AVX512)
+  else if (NLOOP_CPU_AVX2 == level)
+    NLOOP_DISPATCH_FILL(kernels, AVX2)
+  else if (NLOOP_CPU_SSE2 == level)
+    NLOOP_DISPATCH_FILL(kernels, SSE2)
+  else
+    NLOOP_DISPATCH_FILL(kernels, Scalar)
+#else
+  NLOOP_DISPATCH_FILL(kernels, Scalar)
+#endif
+}
+
+
+
+// Single-kernel calls for the level in use.
+// These pick one kernel per call instead of filling a table, so library
+// modules can use them without keeping a table around, and only the
+// kernel that's called gets instantiated.
+
+template <class samptype_t>
+void nloop_DispatchArgMax(const samptype_t *source, int stride, int banks,
+  int chans, int *selections, samptype_t *maxvals)
+{
+#ifdef NLOOP_DISPATCH_X86
+  int level;
+
+  level = nloop_CPUGetLevel();
+
+  if (NLOOP_CPU_AVX512 == level)
+    nloop_DispatchArgMax_AVX512<samptype_t>(
+      source, stride, banks, chans, selections, maxvals );
+  else if (NLOOP_CPU_AVX2 == level)
+    nloop_DispatchArgMax_AVX2<samptype_t>(
+      source, stride, banks, chans, selections, maxvals );
+  else if (NLOOP_CPU_SSE2 == level)
+    nloop_DispatchArgMax_SSE2<samptype_t>(
+      source, stride, banks, chans, selections, maxvals );
+  else
+#endif
+    nloop_DispatchArgMax_Scalar<samptype_t>(
+      source, stride, banks, chans, selections, maxvals );
+}
+
+
+
+template <class samptype_t>
+int nloop_DispatchLookupIndexLE(const samptype_t *keys, int rows,
+  samptype_t value)
+{
+#ifdef NLOOP_DISPATCH_X86
+  int level;
+
+  level = nloop_CPUGetLevel();
+
+  if (NLOOP_CPU_AVX512 == level)
+    return nloop_DispatchLookupLE_AVX512<samptype_t>(keys, rows, value);
+  if (NLOOP_CPU_AVX2 == level)
+    return nloop_DispatchLookupLE_AVX2<samptype_t>(keys, rows, value);
+  if (NLOOP_CPU_SSE2 == level)
+    return nloop_DispatchLookupLE_SSE2<samptype_t>(keys, rows, value);
+#endif
+
+  return nloop_DispatchLookupLE_Scalar<samptype_t>(keys, rows, value);
+}
+
+
+
+template <class samptype_t>
+int nloop_DispatchLookupIndexGE(const samptype_t *keys, int rows,
+  samptype_t value)
+{
+#ifdef NLOOP_DISPATCH_X86
+  int level;
+
+  level = nloop_CPUGetLevel();
+
+  if (NLOOP_CPU_AVX512 == level)
+    return nloop_DispatchLookupGE_AVX512<samptype_t>(keys, rows, value);
+  if (NLOOP_CPU_AVX2 == level)
+    return nloop_DispatchLookupGE_AVX2<samptype_t>(keys, rows, value);
+  if (NLOOP_CPU_SSE2 == level)
+    return nloop_DispatchLookupGE_SSE2<samptype_t>(keys, rows, value);
+#endif
+
+  return nloop_DispatchLookupGE_Scalar<samptype_t>(keys, rows, value);
+}
+
+
+//
+// This is the end of the file.
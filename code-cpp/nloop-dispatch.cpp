@@ -0,0 +1,163 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Run-time CPU feature dispatch for vector kernels - non-template
+// functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+//
+// Global Variables
+
+// Level in use, or -1 if it hasn't been chosen yet.
+// NOTE - This is set once at initialization, normally before any
+// processing threads start. Racing first calls pick the same value.
+static atomic<int> nloop_cpu_level(-1);
+
+// Whether NLOOP_CPU_LEVEL was unset or held a recognized name.
+static atomic<bool> nloop_cpu_override_ok(true);
+
+
+//
+// Functions
+
+
+// This returns the best level this CPU supports, ignoring overrides.
+
+int nloop_CPUDetectLevel(void)
+{
+  int result;
+
+  result = NLOOP_CPU_SCALAR;
+
+#ifdef NLOOP_DISPATCH_X86
+  // This runs cpuid once and caches the results.
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("sse2"))
+  {
+    result = NLOOP_CPU_SSE2;
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+      result = NLOOP_CPU_AVX2;
+
+      if ( __builtin_cpu_supports("avx512f")
+        && __builtin_cpu_supports("avx512bw")
+        && __builtin_cpu_supports("avx512dq")
+        && __builtin_cpu_supports("avx512vl") )
+        result = NLOOP_CPU_AVX512;
+    }
+  }
+#endif
+
+  return result;
+}
+
+
+
+// This returns the level in use. The first call detects the CPU and
+// applies the NLOOP_CPU_LEVEL override.
+
+int nloop_CPUGetLevel(void)
+{
+  const char *envval;
+  int result;
+
+  result = nloop_cpu_level.load();
+
+  if (result < 0)
+  {
+    result = nloop_CPUDetectLevel();
+
+    // NOTE - A name we don't recognize is ignored, and reported via
+    // nloop_CPULevelOverrideOk() rather than printed.
+    envval = getenv(NLOOP_CPU_LEVEL_ENV);
+    if (NULL != envval)
+    {
+      if (0 <= nloop_CPUParseLevel(envval))
+        result = min( result, nloop_CPUParseLevel(envval) );
+      else
+        nloop_cpu_override_ok.store(false);
+    }
+
+    nloop_cpu_level.store(result);
+  }
+
+  return result;
+}
+
+
+
+// This sets the level in use, clamped to what the CPU supports, and
+// returns the level actually set.
+
+int nloop_CPUSetLevel(int newlevel)
+{
+  newlevel = min( newlevel, nloop_CPUDetectLevel() );
+  if (newlevel < NLOOP_CPU_SCALAR)
+    newlevel = NLOOP_CPU_SCALAR;
+
+  nloop_cpu_level.store(newlevel);
+
+  return newlevel;
+}
+
+
+
+// This converts a level name to a level, or returns -1 if the name isn't
+// recognized.
+
+int nloop_CPUParseLevel(const char *levelname)
+{
+  int level;
+
+  for (level = 0; level < NLOOP_CPU_LEVEL_COUNT; level++)
+    if (0 == strcmp(levelname, nloop_CPULevelName(level)))
+      return level;
+
+  return -1;
+}
+
+
+
+// This returns a level's name, or "unknown".
+
+const char *nloop_CPULevelName(int level)
+{
+  if (NLOOP_CPU_SCALAR == level)
+    return "scalar";
+  if (NLOOP_CPU_SSE2 == level)
+    return "sse2";
+  if (NLOOP_CPU_AVX2 == level)
+    return "avx2";
+  if (NLOOP_CPU_AVX512 == level)
+    return "avx512";
+
+  return "unknown";
+}
+
+
+
+// This returns false if NLOOP_CPU_LEVEL held a name that wasn't
+// recognized.
+
+bool nloop_CPULevelOverrideOk(void)
+{
+  // Make sure the override has been looked at.
+  nloop_CPUGetLevel();
+
+  return nloop_cpu_override_ok.load();
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,204 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Run-time CPU feature dispatch for vector kernels - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This uses GCC/Clang function attributes and CPU detection
+// builtins on x86, so it's workstation-only. Other compilers and
+// architectures get the scalar kernels.
+
+// Wrapper.
+#ifndef NLOOP_DISPATCH_H
+#define NLOOP_DISPATCH_H
+
+
+// One binary has to run well on rigs ranging from SSE-only machines to
+// AVX-512 workstations. The kernels here operate on flat arrays (one
+// element per channel, or one row per bank) so that the compiler can
+// vectorize them, and each is compiled several times with different
+// instruction set targets. The best version the CPU supports is picked at
+// run time:
+//
+//   nloop_DispatchKernels_t<int32_t, int64_t> kernels;
+//   nloop_GetDispatchKernels(kernels);
+//   total = (*kernels.DotProduct)(data, coeffs, count);
+//
+// The CPU level is detected once (using cpuid via the compiler's
+// __builtin_cpu_supports()) and cached. Setting the NLOOP_CPU_LEVEL
+// environment variable to "scalar", "sse2", "avx2", or "avx512" lowers it
+// for testing; asking for a level the CPU doesn't support gets the best
+// level it does support. nloop_CPUSetLevel() does the same from code.
+//
+// Every level gives bit-identical results; they're the same source code.
+// Results also match the corresponding library modules (biquads, FIR
+// filters, averagers, winner-take-all voting, and monotonic lookup
+// tables), including the NLOOP_SIGN_SAFE_SHIFT setting.
+//
+// Users of the kernels:
+//
+// - The run-time geometry IIR, FIR, and averager banks (nloop-dynbanks.h)
+// keep their state in flat arrays and call the kernels directly.
+// - nloop_IdentifyWinningBanks() (nloop-voting.h) and the monotonic
+// lookup tables (nloop-lutmap.h) call nloop_DispatchArgMax() and
+// nloop_DispatchLookupIndexXX() when NLOOP_USE_DISPATCH is defined.
+// nloop-includes-workstation.h defines it; embedded builds keep their
+// own loops.
+//
+// NOTE - The fixed-geometry biquad, FIR, and averager banks (nloop-biquads.h,
+// nloop-fir.h, and nloop-threshold.h) don't use these kernels. They store
+// state per filter object rather than in per-stage channel arrays, and
+// they're shared with embedded builds. Use the run-time geometry banks for
+// vectorized filtering.
+//
+// The "scalar" level is compiled with vectorization turned off, as a
+// reference. On 64-bit x86, "sse2" is the baseline instruction set.
+
+
+//
+// Constants
+
+// CPU levels, in increasing order of capability.
+#define NLOOP_CPU_SCALAR 0
+#define NLOOP_CPU_SSE2 1
+#define NLOOP_CPU_AVX2 2
+#define NLOOP_CPU_AVX512 3
+
+#define NLOOP_CPU_LEVEL_COUNT 4
+
+// Environment variable that overrides the detected level.
+#define NLOOP_CPU_LEVEL_ENV "NLOOP_CPU_LEVEL"
+
+// Vector kernels need GCC-style target attributes and an x86 target.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NLOOP_DISPATCH_X86
+#endif
+
+
+//
+// Classes
+
+
+// Kernel table for one sample type and accumulator type.
+// Array arguments must not overlap unless stated otherwise.
+
+template <class samptype_t, class accumtype_t = samptype_t>
+struct nloop_DispatchKernels_t
+{
+  // Level these kernels were compiled for.
+  int level;
+
+  // FIR dot product. This returns the sum of data[k] * coeffs[k] for
+  // k < count, accumulated in accumtype_t.
+  accumtype_t (*DotProduct)(const samptype_t *data,
+    const samptype_t *coeffs, int count);
+
+  // One biquad stage for "count" channels sharing coefficients.
+  // "coeffs" is { den1, den2, num0, num1, num2 }. "history" holds four
+  // planes starting "histstride" elements apart (histstride >= count):
+  // previous input, input before that, previous output, and output before
+  // that. It's updated in place.
+  void (*BiquadStage)(const samptype_t *indata, samptype_t *outdata,
+    samptype_t *history, int histstride, const samptype_t *coeffs,
+    uint8_t den0bits, int count);
+
+  // Running averagers for "count" elements, with per-element running
+  // sums, coefficients, and averaging bits. See nloop_Averager_t.
+  void (*Average)(const samptype_t *indata, samptype_t *outdata,
+    samptype_t *running_sums, const samptype_t *coeffs,
+    const uint8_t *avgbits, uint8_t coeffbits, int count);
+
+  // Winner-take-all among "banks" rows of "chans" elements. Row "b"
+  // starts at source + b * stride. For each channel, this writes the
+  // index of the first row with the largest value, and that value.
+  // See nloop_IdentifyWinningBanks().
+  void (*ArgMax)(const samptype_t *source, int stride, int banks,
+    int chans, int *selections, samptype_t *maxvals);
+
+  // Monotonic lookup table search. These return the index of the first
+  // key <= "value" in a descending table, or the first key >= "value" in
+  // an ascending table, or "rows" if there's no match.
+  // See nloop_LookupMonoStep_t.
+  int (*LookupIndexLE)(const samptype_t *keys, int rows, samptype_t value);
+  int (*LookupIndexGE)(const samptype_t *keys, int rows, samptype_t value);
+};
+
+
+//
+// Functions
+
+
+// CPU level selection.
+
+// This returns the best level this CPU supports, ignoring overrides.
+int nloop_CPUDetectLevel(void);
+
+// This returns the level in use. The first call detects the CPU and
+// applies the NLOOP_CPU_LEVEL override.
+int nloop_CPUGetLevel(void);
+
+// This sets the level in use, clamped to what the CPU supports, and
+// returns the level actually set. Kernel tables fetched earlier keep the
+// level they were fetched with.
+int nloop_CPUSetLevel(int newlevel);
+
+// This converts a level name to a level, or returns -1 if the name isn't
+// recognized. Names are "scalar", "sse2", "avx2", and "avx512".
+int nloop_CPUParseLevel(const char *levelname);
+
+// This returns a level's name, or "unknown".
+const char *nloop_CPULevelName(int level);
+
+// This returns false if NLOOP_CPU_LEVEL held a name that wasn't
+// recognized. The override is ignored in that case. Like
+// nloop_CPUGetLevel(), the first call detects the CPU.
+bool nloop_CPULevelOverrideOk(void);
+
+
+// Kernel tables.
+
+// This fills a kernel table for the level in use.
+template <class samptype_t, class accumtype_t>
+void nloop_GetDispatchKernels(
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels);
+
+// This fills a kernel table for a specific level, clamped to what the CPU
+// supports. The level used is stored in the table.
+template <class samptype_t, class accumtype_t>
+void nloop_GetDispatchKernelsForLevel(
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels, int level);
+
+
+// Single kernels for the level in use. These take the same arguments as
+// the corresponding kernel table entries.
+
+template <class samptype_t>
+void nloop_DispatchArgMax(const samptype_t *source, int stride, int banks,
+  int chans, int *selections, samptype_t *maxvals);
+
+template <class samptype_t>
+int nloop_DispatchLookupIndexLE(const samptype_t *keys, int rows,
+  samptype_t value);
+template <class samptype_t>
+int nloop_DispatchLookupIndexGE(const samptype_t *keys, int rows,
+  samptype_t value);
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-dispatch-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,2680 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Run-time geometry bank modules - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// nloop_IIRFilterBankDyn_t class.
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  nloop_IIRFilterBankDyn_t(void)
+{
+  coeffs = NULL;
+  den0bits = NULL;
+  history = NULL;
+  scratch = NULL;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  stages_active = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  nloop_GetDispatchKernels(kernels);
+}
+
+
+
+// This reserves space for the specified geometry.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  arena.Reserve( ((size_t) pending_banks) * stagecount * 5
+    * sizeof(samptype_t) );
+  arena.Reserve( ((size_t) pending_banks) * stagecount * sizeof(uint8_t) );
+  arena.Reserve( ((size_t) pending_banks) * stagecount * 4
+    * ((size_t) pending_chans) * sizeof(samptype_t) );
+  arena.Reserve( 2 * ((size_t) pending_chans) * sizeof(samptype_t) );
+}
+
+
+
+// This carves and initializes storage. Coefficients and history are zero
+// (from the arena), no stages are active, and the active bank and channel
+// geometry is set to the full configured geometry.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+bool nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  AttachStorage(nloop_Arena_t &arena)
+{
+  void *coeffblock;
+  void *bitsblock;
+  void *histblock;
+  void *scratchblock;
+
+  // Carve every piece even if one fails, to keep carving in step with
+  // reservation.
+  coeffblock = arena.Carve( ((size_t) pending_banks) * stagecount * 5
+    * sizeof(samptype_t) );
+  bitsblock = arena.Carve( ((size_t) pending_banks) * stagecount
+    * sizeof(uint8_t) );
+  histblock = arena.Carve( ((size_t) pending_banks) * stagecount * 4
+    * ((size_t) pending_chans) * sizeof(samptype_t) );
+  scratchblock = arena.Carve( 2 * ((size_t) pending_chans)
+    * sizeof(samptype_t) );
+
+  // Fall back to zero geometry if there's no storage.
+  coeffs = NULL;
+  den0bits = NULL;
+  history = NULL;
+  scratch = NULL;
+  bankcount = 0;
+  chancount = 0;
+  stages_active = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if ( (NULL == coeffblock) || (NULL == bitsblock)
+    || (NULL == histblock) || (NULL == scratchblock) )
+    return false;
+
+  coeffs = (samptype_t *) coeffblock;
+  den0bits = (uint8_t *) bitsblock;
+  history = (samptype_t *) histblock;
+  scratch = (samptype_t *) scratchblock;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  // The arena zeroes storage, but blank coefficients explicitly to match
+  // the chain constructor.
+  BlankCoefficients();
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+int nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+int nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// Process one sample.
+// Each stage runs across all active channels of a bank at once. Stage
+// outputs ping-pong between the scratch rows, and the last stage writes
+// straight to the bank's output row.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  ApplyBankOnce(samptype_t *indata, samptype_t *outdata)
+{
+  int bidx, stidx, cidx;
+  int stageidx;
+  samptype_t *bankout, *stagein, *stageout;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_IIRBANK);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+  {
+    bankout = outdata + bidx * chancount;
+
+    // With no active stages, the chain copies input to output.
+    if (0 == stages_active)
+      for (cidx = 0; cidx < chans_active; cidx++)
+        bankout[cidx] = indata[cidx];
+
+    stagein = indata;
+
+    for (stidx = 0; stidx < stages_active; stidx++)
+    {
+      stageidx = bidx * stagecount + stidx;
+
+      stageout = scratch + (stidx & 1) * chancount;
+      if ((stidx + 1) == stages_active)
+        stageout = bankout;
+
+      (*kernels.BiquadStage)( stagein, stageout,
+        history + stageidx * 4 * chancount, chancount,
+        coeffs + stageidx * 5, den0bits[stageidx], chans_active );
+
+      stagein = stageout;
+    }
+  }
+}
+
+
+
+// Stage geometry accessors.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+int nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  GetActiveStages(void)
+{
+  return stages_active;
+}
+
+
+
+// This is set for all channels and banks, not just active ones.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  SetActiveStages(int new_stages)
+{
+  if (new_stages < 0)
+    new_stages = 0;
+  else if (new_stages > stagecount)
+    new_stages = stagecount;
+
+  // Without storage, there are no stages.
+  if (NULL == coeffs)
+    new_stages = 0;
+
+  stages_active = new_stages;
+}
+
+
+
+// Active geometry accessors.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+int nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+int nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+// Blank the filter coefficients.
+// This produces a valid filter configuration with zero output.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  BlankCoefficients(void)
+{
+  int stagetotal, stageidx, kidx;
+
+  stagetotal = bankcount * stagecount;
+
+  for (stageidx = 0; stageidx < stagetotal; stageidx++)
+  {
+    den0bits[stageidx] = 0;
+    for (kidx = 0; kidx < 5; kidx++)
+      coeffs[stageidx * 5 + kidx] = 0;
+  }
+}
+
+
+
+// Read filter coefficients for one bank.
+// Out-of-range stages read as zero, as with the biquad chain.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  GetCoefficients( int stagenum, int banknum,
+    uint8_t &old_den0bits, samptype_t &old_den1, samptype_t &old_den2,
+    samptype_t &old_num0, samptype_t &old_num1, samptype_t &old_num2 )
+{
+  samptype_t *stagecoeffs;
+
+  if ( (banknum < 0) || (banknum >= bankcount) )
+    return;
+
+  old_den0bits = 0;
+  old_den1 = 0;
+  old_den2 = 0;
+  old_num0 = 0;
+  old_num1 = 0;
+  old_num2 = 0;
+
+  if ((0 <= stagenum) && (stagecount > stagenum))
+  {
+    stagecoeffs = coeffs + (banknum * stagecount + stagenum) * 5;
+
+    old_den0bits = den0bits[banknum * stagecount + stagenum];
+    old_den1 = stagecoeffs[0];
+    old_den2 = stagecoeffs[1];
+    old_num0 = stagecoeffs[2];
+    old_num1 = stagecoeffs[3];
+    old_num2 = stagecoeffs[4];
+  }
+}
+
+
+
+// Set filter coefficients for one bank.
+// Coefficients are shared by all channels, active or not.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  SetCoefficients( int stagenum, int banknum,
+    uint8_t new_den0bits, samptype_t new_den1, samptype_t new_den2,
+    samptype_t new_num0, samptype_t new_num1, samptype_t new_num2 )
+{
+  samptype_t *stagecoeffs;
+
+  if ( (banknum >= 0) && (banknum < bankcount)
+    && (0 <= stagenum) && (stagecount > stagenum) )
+  {
+    stagecoeffs = coeffs + (banknum * stagecount + stagenum) * 5;
+
+    den0bits[banknum * stagecount + stagenum] = new_den0bits;
+    stagecoeffs[0] = new_den1;
+    stagecoeffs[1] = new_den2;
+    stagecoeffs[2] = new_num0;
+    stagecoeffs[3] = new_num1;
+    stagecoeffs[4] = new_num2;
+  }
+}
+
+
+
+// Stuff all layers of the internal buffers with "settled" values.
+// A stage's input history is the previous stage's output history, so this
+// settles to the same state as the biquad chain.
+// This updates all channels, not just active channels.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  FastSettleBuffers(samptype_t *indata, bool (&copy_input)[stagecount])
+{
+  int bidx, stidx, cidx;
+  samptype_t *stagehist;
+  samptype_t invalue, outvalue;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (stidx = 0; stidx < stagecount; stidx++)
+    {
+      stagehist = history + (bidx * stagecount + stidx) * 4 * chancount;
+
+      for (cidx = 0; cidx < chancount; cidx++)
+      {
+        // Stage 0 sees the input; later stages see the previous stage's
+        // settled output.
+        invalue = indata[cidx];
+        if ( (0 < stidx) && (!copy_input[stidx - 1]) )
+          invalue = 0;
+
+        outvalue = copy_input[stidx] ? indata[cidx] : 0;
+
+        stagehist[cidx] = invalue;
+        stagehist[chancount + cidx] = invalue;
+        stagehist[2 * chancount + cidx] = outvalue;
+        stagehist[3 * chancount + cidx] = outvalue;
+      }
+    }
+}
+
+
+
+// Save internal buffers for active channels and banks to a checkpoint.
+// This writes the same record as the standard bank. Each channel's chain
+// buffers are rebuilt from stage history, with the buffer pointer at zero
+// (so the newest two values are at the end and older values are zero).
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx, bufidx;
+  samptype_t *bankhist, *planes;
+  samptype_t chainbuf[NLOOP_IIRBIQUADCHAIN_BUFSIZE];
+
+  statebuf.PutTag( NLOOP_STATE_IIRBANK, banks_active, chans_active,
+    stages_active );
+
+  for (bufidx = 0; bufidx < NLOOP_IIRBIQUADCHAIN_BUFSIZE; bufidx++)
+    chainbuf[bufidx] = 0;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      bankhist = history + bidx * stagecount * 4 * chancount + cidx;
+
+      // Chain buffer 0 is the first stage's input history. Chain buffer N
+      // is stage N-1's output history.
+      for (bufidx = 0; bufidx <= stages_active; bufidx++)
+      {
+        planes = bankhist;
+        if (0 < bufidx)
+          planes += ((bufidx - 1) * 4 + 2) * chancount;
+
+        chainbuf[NLOOP_IIRBIQUADCHAIN_BUFSIZE - 1] = planes[0];
+        chainbuf[NLOOP_IIRBIQUADCHAIN_BUFSIZE - 2] = planes[chancount];
+
+        statebuf.PutArray(chainbuf, NLOOP_IIRBIQUADCHAIN_BUFSIZE);
+      }
+
+      statebuf.PutValue( (uint8_t) 0 );
+    }
+}
+
+
+
+// Restore internal buffers for active channels and banks from a checkpoint.
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t>
+void nloop_IIRFilterBankDyn_t<samptype_t, indextype_t, stagecount,
+  accumtype_t>::
+  LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, stidx, cidx;
+  samptype_t *bankhist;
+  samptype_t chainbufs[stagecount + 1][NLOOP_IIRBIQUADCHAIN_BUFSIZE];
+  samptype_t prev1, prev2;
+  uint8_t bufptr;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_IIRBANK, banks_active, chans_active,
+    stages_active ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      for (stidx = 0; stidx <= stages_active; stidx++)
+        statebuf.GetArray(chainbufs[stidx], NLOOP_IIRBIQUADCHAIN_BUFSIZE);
+
+      statebuf.GetValue(bufptr);
+
+      bankhist = history + bidx * stagecount * 4 * chancount + cidx;
+
+      // Chain buffer N feeds stage N's input history and stage N-1's
+      // output history.
+      for (stidx = 0; stidx <= stages_active; stidx++)
+      {
+        prev1 = chainbufs[stidx][ (bufptr - 1)
+          & (NLOOP_IIRBIQUADCHAIN_BUFSIZE - 1) ];
+        prev2 = chainbufs[stidx][ (bufptr - 2)
+          & (NLOOP_IIRBIQUADCHAIN_BUFSIZE - 1) ];
+
+        if (stidx < stages_active)
+        {
+          bankhist[stidx * 4 * chancount] = prev1;
+          bankhist[(stidx * 4 + 1) * chancount] = prev2;
+        }
+
+        if (0 < stidx)
+        {
+          bankhist[((stidx - 1) * 4 + 2) * chancount] = prev1;
+          bankhist[((stidx - 1) * 4 + 3) * chancount] = prev2;
+        }
+      }
+    }
+}
+
+
+
+//
+// nloop_FIRFilterBankDyn_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+nloop_FIRFilterBankDyn_t(void)
+{
+  firs = NULL;
+  inbufs = NULL;
+  bufptr = 0;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+
+  nloop_GetDispatchKernels(kernels);
+}
+
+
+
+// This reserves space for the specified geometry.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  arena.Reserve( ((size_t) pending_banks)
+    * sizeof( nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs,
+      accumtype_t> ) );
+  arena.Reserve( ((size_t) pending_chans) * ((size_t) buflen)
+    * sizeof(samptype_t) );
+}
+
+
+
+// This carves and initializes storage. Filters are blank, input buffers
+// are zero (from the arena), and the active geometry is set to the full
+// configured geometry.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+bool nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+AttachStorage(nloop_Arena_t &arena)
+{
+  void *filtblock;
+  void *bufblock;
+  int bidx;
+
+  // Carve both pieces even if the first fails, to keep carving in step
+  // with reservation.
+  filtblock = arena.Carve( ((size_t) pending_banks)
+    * sizeof( nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs,
+      accumtype_t> ) );
+  bufblock = arena.Carve( ((size_t) pending_chans) * ((size_t) buflen)
+    * sizeof(samptype_t) );
+
+  firs = NULL;
+  inbufs = NULL;
+  bufptr = 0;
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if ( (NULL == filtblock) || (NULL == bufblock) )
+    return false;
+
+  firs = (nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs,accumtype_t> *)
+    filtblock;
+  inbufs = (samptype_t *) bufblock;
+
+  // The FIR constructor blanks coefficients.
+  for (bidx = 0; bidx < pending_banks; bidx++)
+    new (&(firs[bidx]))
+      nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs,accumtype_t>;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+int nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+int nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This processes one sample.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+ApplyBankOnce(samptype_t *indata, samptype_t *outdata)
+{
+  int bidx, cidx;
+  int readidx, coeffcount, firstlen;
+  indextype_t bufmask;
+  samptype_t *bankout, *coeffs, *thisbuf;
+  accumtype_t running_total;
+  uint8_t fracbits;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_FIRBANK);
+
+
+  // Blank the entire output (active or inactive).
+
+  for (cidx = 0; cidx < (bankcount * chancount); cidx++)
+    outdata[cidx] = 0;
+
+
+  // Copy this input sample.
+
+  bufmask = buflen - 1;
+  bufptr &= bufmask; // Shouldn't be needed but do it anyways.
+
+  for (cidx = 0; cidx < chans_active; cidx++)
+    inbufs[cidx * buflen + bufptr] = indata[cidx];
+
+  bufptr++;
+  bufptr &= bufmask;
+
+
+  // Only process active channels/banks.
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+  {
+    coeffcount = firs[bidx].GetCoeffCount();
+    fracbits = firs[bidx].GetFracBits();
+    coeffs = firs[bidx].GetCoefficientArray();
+
+    readidx = bufptr;
+    readidx -= coeffcount; // Underflow is fine.
+    readidx &= bufmask; // This wraps underflow around to a valid value.
+
+    // The window may wrap past the end of the buffer. If so, it's done as
+    // two contiguous pieces.
+    firstlen = buflen - readidx;
+    if (firstlen > coeffcount)
+      firstlen = coeffcount;
+
+    bankout = outdata + bidx * chancount;
+
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      thisbuf = inbufs + cidx * buflen;
+
+      running_total = (*kernels.DotProduct)( thisbuf + readidx,
+        coeffs, firstlen );
+      running_total += (*kernels.DotProduct)( thisbuf,
+        coeffs + firstlen, coeffcount - firstlen );
+
+      NLOOP_ARITHSHR(running_total, fracbits);
+
+      bankout[cidx] = (samptype_t) running_total;
+    }
+  }
+}
+
+
+
+// Channel and bank geometry accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+int nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+int nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+// Filter blanking accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+BlankAllFilters(void)
+{
+  int bidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    firs[bidx].BlankCoefficients();
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+BlankOneFilter(int banknum)
+{
+  if ( (banknum >= 0) && (banknum < bankcount) )
+    firs[banknum].BlankCoefficients();
+}
+
+
+
+// Individual coefficient accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+SetOneCoefficient(int banknum, indextype_t coeffidx, samptype_t coeffval)
+{
+  if ( (banknum >= 0) && (banknum < bankcount) )
+    // Coeffidx is checked by the FIR's accessor.
+    firs[banknum].SetOneCoefficient(coeffidx, coeffval);
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+samptype_t
+nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetOneCoefficient(int banknum, indextype_t coeffidx)
+{
+  samptype_t result;
+
+  result = 0;
+
+  if ( (banknum >= 0) && (banknum < bankcount) )
+    // Coeffidx is checked by the FIR's accessor.
+    result = firs[banknum].GetOneCoefficient(coeffidx);
+
+  return result;
+}
+
+
+
+// Filter geometry accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+SetOneGeometry(int banknum, uint8_t newfracbits, indextype_t newcoeffcount)
+{
+  if ( (banknum >= 0) && (banknum < bankcount) )
+  {
+    // FIR accessors check the other arguments.
+    firs[banknum].SetFracBits(newfracbits);
+    firs[banknum].SetCoeffCount(newcoeffcount);
+  }
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetOneGeometry(int banknum, uint8_t &oldfracbits, indextype_t &oldcoeffcount)
+{
+  oldfracbits = 0;
+  oldcoeffcount = 0;
+
+  if ( (banknum >= 0) && (banknum < bankcount) )
+  {
+    oldfracbits = firs[banknum].GetFracBits();
+    oldcoeffcount = firs[banknum].GetCoeffCount();
+  }
+}
+
+
+
+// Whole-filter configuration accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+SetBankCoefficients(int banknum, int newbits, indextype_t newcoeffcount,
+  nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &newcoeffs)
+{
+  if ( (banknum >= 0) && (banknum < bankcount) )
+    // FIR accessor checks the other arguments.
+    firs[banknum].SetAllCoefficients(newbits, newcoeffcount, newcoeffs);
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+GetBankCoefficients(int banknum, int &oldbits, indextype_t &oldcoeffcount,
+    nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &oldcoeffs)
+{
+  oldbits = 0;
+  oldcoeffcount = 0;
+  oldcoeffs.SetUniformValue(0);
+
+  if ( (banknum >= 0) && (banknum < bankcount) )
+    firs[banknum].GetAllCoefficients(oldbits, oldcoeffcount, oldcoeffs);
+}
+
+
+
+// Input buffer accessors.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+BlankAllInputBuffers(void)
+{
+  int cidx;
+
+  bufptr = 0;
+
+  for (cidx = 0; cidx < chancount; cidx++)
+    BlankOneInputBuffer(cidx);
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+BlankOneInputBuffer(int channum)
+{
+  indextype_t sidx;
+
+  if ( (channum >= 0) && (channum < chancount) )
+  {
+    // Leave the buffer read/write pointer where it is.
+
+    for (sidx = 0; sidx < buflen; sidx++)
+      inbufs[channum * buflen + sidx] = 0;
+  }
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+FastSettleBuffers(samptype_t *indata)
+{
+  int cidx;
+  indextype_t sidx;
+  samptype_t thisval;
+
+  // Copy all channels, active or not.
+
+  bufptr = 0;
+
+  for (cidx = 0; cidx < chancount; cidx++)
+  {
+    thisval = indata[cidx];
+    for (sidx = 0; sidx < buflen; sidx++)
+      inbufs[cidx * buflen + sidx] = thisval;
+  }
+}
+
+
+
+// Input buffers are shared across banks, so only channels are stored.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int cidx;
+
+  statebuf.PutTag(NLOOP_STATE_FIRBANK, chans_active, buflen, 0);
+
+  statebuf.PutValue(bufptr);
+
+  for (cidx = 0; cidx < chans_active; cidx++)
+    statebuf.PutArray(inbufs + cidx * buflen, buflen);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t>
+void nloop_FIRFilterBankDyn_t<samptype_t, indextype_t, maxcoeffs, buflen,
+  accumtype_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int cidx;
+
+  if (!statebuf.CheckTag(NLOOP_STATE_FIRBANK, chans_active, buflen, 0))
+    return;
+
+  statebuf.GetValue(bufptr);
+  bufptr &= (buflen - 1);
+
+  for (cidx = 0; cidx < chans_active; cidx++)
+    statebuf.GetArray(inbufs + cidx * buflen, buflen);
+}
+
+
+
+//
+// nloop_AnalyticBankDyn_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+nloop_AnalyticBankDyn_t(void)
+{
+  estimators = NULL;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+}
+
+
+
+// This reserves space for the specified geometry.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  arena.Reserve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof(estimator_t) );
+}
+
+
+
+// This carves and initializes storage. Estimators handle their own
+// first-time initialization, and the active geometry is set to the full
+// configured geometry.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+bool nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+AttachStorage(nloop_Arena_t &arena)
+{
+  void *block;
+  int cellcount, cellidx;
+
+  cellcount = pending_banks * pending_chans;
+
+  block = arena.Carve( ((size_t) cellcount) * sizeof(estimator_t) );
+
+  estimators = NULL;
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if (NULL == block)
+    return false;
+
+  estimators = (estimator_t *) block;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    new (&(estimators[cellidx])) estimator_t;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+int nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class samptype_t, class indextype_t, class estimator_t>
+int nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This resets all estimators, and makes the full configured geometry
+// active.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+ResetState(void)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    estimators[cellidx].ResetState();
+
+  banks_active = bankcount;
+  chans_active = chancount;
+}
+
+
+
+// This passes sample data to the estimators.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+HandleSamples(samptype_t *indata)
+{
+  int bidx, cidx;
+  estimator_t *bankest;
+  samptype_t *bankin;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_ANALYTICBANK);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+  {
+    bankest = estimators + bidx * chancount;
+    bankin = indata + bidx * chancount;
+
+    for (cidx = 0; cidx < chans_active; cidx++)
+      bankest[cidx].HandleSample( bankin[cidx] );
+  }
+}
+
+
+
+// This queries estimators for analytic signal parameters.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+GetEstimatedAnalytic(samptype_t *outmagnitude, indextype_t *outperiod,
+  indextype_t *since_rise_zc, indextype_t *since_fall_zc)
+{
+  int bidx, cidx;
+  int cellidx;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      cellidx = bidx * chancount + cidx;
+
+      estimators[cellidx].GetEstimatedAnalytic(
+        outmagnitude[cellidx], outperiod[cellidx],
+        since_rise_zc[cellidx], since_fall_zc[cellidx] );
+    }
+}
+
+
+
+// Active geometry accessors.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+int nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class samptype_t, class indextype_t, class estimator_t>
+int nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+// This sets the minimum period for the estimators associated with each bank.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SetMinPeriods(indextype_t *newminperiods)
+{
+  int bidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    SetOneMinPeriod( bidx, newminperiods[bidx] );
+}
+
+
+
+// This sets the minimum period for the estimators associated with a single
+// bank.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SetOneMinPeriod(int bankidx, indextype_t newminperiod)
+{
+  int cidx;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount) )
+    for (cidx = 0; cidx < chancount; cidx++)
+      estimators[bankidx * chancount + cidx].SetMinPeriod( newminperiod );
+}
+
+
+
+// This sets the zero levels associated with each estimator.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SetZeroLevels(samptype_t *newzeros)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    estimators[cellidx].SetZeroLevel( newzeros[cellidx] );
+}
+
+
+
+// This sets the zero level for one specific estimator.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SetOneZeroLevel(int bankidx, int chanidx, samptype_t newzero)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    estimators[bankidx * chancount + chanidx].SetZeroLevel( newzero );
+}
+
+
+
+// This saves estimator state for active banks and channels.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag(NLOOP_STATE_ANALYTICBANK, banks_active, chans_active, 0);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      estimators[bidx * chancount + cidx].SaveState(statebuf);
+}
+
+
+
+// This restores estimator state for active banks and channels.
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+void nloop_AnalyticBankDyn_t<samptype_t, indextype_t, estimator_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_ANALYTICBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      estimators[bidx * chancount + cidx].LoadState(statebuf);
+}
+
+
+
+//
+// nloop_AveragerBankDyn_t Class
+
+
+// Constructor.
+
+template <class samptype_t, uint8_t coeffbits>
+nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+nloop_AveragerBankDyn_t(void)
+{
+  running_sums = NULL;
+  coeffs = NULL;
+  avgbits = NULL;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+
+  nloop_GetDispatchKernels(kernels);
+}
+
+
+
+// This reserves space for the specified geometry.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  arena.Reserve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof(samptype_t) );
+  arena.Reserve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof(samptype_t) );
+  arena.Reserve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof(uint8_t) );
+}
+
+
+
+// This carves and initializes storage. Running sums, coefficients, and
+// averaging bits are zero (from the arena), as in a newly-constructed
+// standard bank, and the active geometry is set to the full configured
+// geometry.
+
+template <class samptype_t, uint8_t coeffbits>
+bool nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+AttachStorage(nloop_Arena_t &arena)
+{
+  void *sumblock;
+  void *coeffblock;
+  void *bitsblock;
+  size_t cellcount;
+
+  cellcount = ((size_t) pending_banks) * ((size_t) pending_chans);
+
+  // Carve every piece even if one fails, to keep carving in step with
+  // reservation.
+  sumblock = arena.Carve( cellcount * sizeof(samptype_t) );
+  coeffblock = arena.Carve( cellcount * sizeof(samptype_t) );
+  bitsblock = arena.Carve( cellcount * sizeof(uint8_t) );
+
+  running_sums = NULL;
+  coeffs = NULL;
+  avgbits = NULL;
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if ( (NULL == sumblock) || (NULL == coeffblock) || (NULL == bitsblock) )
+    return false;
+
+  running_sums = (samptype_t *) sumblock;
+  coeffs = (samptype_t *) coeffblock;
+  avgbits = (uint8_t *) bitsblock;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class samptype_t, uint8_t coeffbits>
+int nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+int nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This only operates on active banks/channels. Each bank row is one
+// kernel call.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+UpdateAverage(samptype_t *indata, samptype_t *outdata)
+{
+  int bidx, rowstart;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_AVERAGERBANK);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+  {
+    rowstart = bidx * chancount;
+
+    (*kernels.Average)( indata + rowstart, outdata + rowstart,
+      running_sums + rowstart, coeffs + rowstart, avgbits + rowstart,
+      coeffbits, chans_active );
+  }
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+InitAverage(samptype_t *indata)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  // This is nloop_Averager_t::InitAverage().
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    running_sums[cellidx] = indata[cellidx] << avgbits[cellidx];
+}
+
+
+
+// Active geometry accessors.
+
+template <class samptype_t, uint8_t coeffbits>
+int nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+int nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+// Coefficient accessors.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetCoeffs(samptype_t *new_coeffs)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    coeffs[cellidx] = new_coeffs[cellidx];
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetBankCoeffs(samptype_t *new_coeffs)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      coeffs[bidx * chancount + cidx] = new_coeffs[bidx];
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetChanCoeffs(samptype_t *new_coeffs)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      coeffs[bidx * chancount + cidx] = new_coeffs[cidx];
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetUniformCoeffs(samptype_t new_coeff)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    coeffs[cellidx] = new_coeff;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetOneCoeff(int bankidx, int chanidx, samptype_t new_coeff)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    coeffs[bankidx * chancount + chanidx] = new_coeff;
+}
+
+
+
+// Averaging bit-shift accessors.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetAvgBits(uint8_t *new_avgbits)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    avgbits[cellidx] = new_avgbits[cellidx];
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetBankAvgBits(uint8_t *new_avgbits)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      avgbits[bidx * chancount + cidx] = new_avgbits[bidx];
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetChanAvgBits(uint8_t *new_avgbits)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      avgbits[bidx * chancount + cidx] = new_avgbits[cidx];
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetUniformAvgBits(uint8_t new_avgbits)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    avgbits[cellidx] = new_avgbits;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SetOneAvgBits(int bankidx, int chanidx, uint8_t new_avgbits)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    avgbits[bankidx * chancount + chanidx] = new_avgbits;
+}
+
+
+
+// Single-cell readback.
+
+template <class samptype_t, uint8_t coeffbits>
+samptype_t nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+GetOneCoeff(int bankidx, int chanidx)
+{
+  samptype_t result;
+
+  result = 0;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = coeffs[bankidx * chancount + chanidx];
+
+  return result;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+uint8_t nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+GetOneAvgBits(int bankidx, int chanidx)
+{
+  uint8_t result;
+
+  result = 0;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = avgbits[bankidx * chancount + chanidx];
+
+  return result;
+}
+
+
+
+// Checkpointing. Only active banks and channels are stored. Each averager
+// stores its running sum, so one array per bank row is the same record as
+// the standard bank's.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx;
+
+  statebuf.PutTag(NLOOP_STATE_AVERAGERBANK, banks_active, chans_active, 0);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    statebuf.PutArray(running_sums + bidx * chancount, chans_active);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_AveragerBankDyn_t<samptype_t, coeffbits>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_AVERAGERBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    statebuf.GetArray(running_sums + bidx * chancount, chans_active);
+}
+
+
+
+//
+// nloop_ThresholdSingleBankDyn_t Class
+
+
+// Constructor.
+
+template <class samptype_t>
+nloop_ThresholdSingleBankDyn_t<samptype_t>::
+nloop_ThresholdSingleBankDyn_t(void)
+{
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+}
+
+
+
+// This records the geometry. There's no per-cell state to reserve.
+
+template <class samptype_t>
+void nloop_ThresholdSingleBankDyn_t<samptype_t>::
+ReserveStorage(nloop_Arena_t & /* arena */, int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+}
+
+
+
+// This adopts the reserved geometry, once the other modules sharing the
+// arena can attach too.
+
+template <class samptype_t>
+bool nloop_ThresholdSingleBankDyn_t<samptype_t>::
+AttachStorage(nloop_Arena_t &arena)
+{
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if (!arena.IsCommitted())
+    return false;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class samptype_t>
+int nloop_ThresholdSingleBankDyn_t<samptype_t>::
+GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class samptype_t>
+int nloop_ThresholdSingleBankDyn_t<samptype_t>::
+GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This returns true if and only if the sample is at or above the threshold.
+
+template <class samptype_t>
+void nloop_ThresholdSingleBankDyn_t<samptype_t>::
+TestSamples(samptype_t *indata, samptype_t *thresholds, bool *outflag)
+{
+  int bidx, cidx;
+  int cellidx;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_THRESHSINGLE);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      cellidx = bidx * chancount + cidx;
+      outflag[cellidx] = ( indata[cellidx] >= thresholds[cellidx] );
+    }
+}
+
+
+
+// Active geometry accessors.
+
+template <class samptype_t>
+int nloop_ThresholdSingleBankDyn_t<samptype_t>::
+GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+template <class samptype_t>
+void nloop_ThresholdSingleBankDyn_t<samptype_t>::
+SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class samptype_t>
+int nloop_ThresholdSingleBankDyn_t<samptype_t>::
+GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class samptype_t>
+void nloop_ThresholdSingleBankDyn_t<samptype_t>::
+SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+//
+// nloop_DeGlitcherBankDyn_t Class
+
+
+// Constructor.
+
+template <class indextype_t>
+nloop_DeGlitcherBankDyn_t<indextype_t>::nloop_DeGlitcherBankDyn_t(void)
+{
+  deglitchers = NULL;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+}
+
+
+
+// This reserves space for the specified geometry.
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  arena.Reserve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof( nloop_DeGlitcher_t<indextype_t> ) );
+}
+
+
+
+// This carves and initializes storage. De-glitchers get zero delays, and
+// the active geometry is set to the full configured geometry.
+
+template <class indextype_t>
+bool nloop_DeGlitcherBankDyn_t<indextype_t>::
+AttachStorage(nloop_Arena_t &arena)
+{
+  void *block;
+  int cellcount, cellidx;
+
+  cellcount = pending_banks * pending_chans;
+
+  block = arena.Carve( ((size_t) cellcount)
+    * sizeof( nloop_DeGlitcher_t<indextype_t> ) );
+
+  deglitchers = NULL;
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if (NULL == block)
+    return false;
+
+  deglitchers = (nloop_DeGlitcher_t<indextype_t> *) block;
+
+  // De-glitchers have no constructor; SetDelays() resets all state.
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+  {
+    new (&(deglitchers[cellidx])) nloop_DeGlitcher_t<indextype_t>;
+    deglitchers[cellidx].SetDelays(0, 0);
+  }
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class indextype_t>
+int nloop_DeGlitcherBankDyn_t<indextype_t>::GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class indextype_t>
+int nloop_DeGlitcherBankDyn_t<indextype_t>::GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This processes one input sample for active banks/channels.
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+ProcessSample(bool *indata, bool *outdata)
+{
+  int bidx, cidx;
+  int cellidx;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_DEGLITCHERBANK);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      cellidx = bidx * chancount + cidx;
+      outdata[cellidx] = deglitchers[cellidx].ProcessSample( indata[cellidx] );
+    }
+}
+
+
+
+// Active geometry accessors.
+
+template <class indextype_t>
+int nloop_DeGlitcherBankDyn_t<indextype_t>::GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class indextype_t>
+int nloop_DeGlitcherBankDyn_t<indextype_t>::GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+// Delay accessors. These update all cells, not just active ones.
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+SetDelays(indextype_t *new_rise_delays, indextype_t *new_fall_delays)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    deglitchers[cellidx].SetDelays( new_rise_delays[cellidx],
+      new_fall_delays[cellidx] );
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+SetBankDelays(indextype_t *new_rise_delays, indextype_t *new_fall_delays)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      deglitchers[bidx * chancount + cidx].SetDelays(
+        new_rise_delays[bidx], new_fall_delays[bidx] );
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+SetChanDelays(indextype_t *new_rise_delays, indextype_t *new_fall_delays)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      deglitchers[bidx * chancount + cidx].SetDelays(
+        new_rise_delays[cidx], new_fall_delays[cidx] );
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+SetUniformDelays(indextype_t new_rise_delay, indextype_t new_fall_delay)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    deglitchers[cellidx].SetDelays( new_rise_delay, new_fall_delay );
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+SetOneDelays( int bankidx, int chanidx,
+  indextype_t new_rise_delay, indextype_t new_fall_delay )
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    deglitchers[bankidx * chancount + chanidx].SetDelays( new_rise_delay,
+      new_fall_delay );
+}
+
+
+
+// Checkpointing. Only active banks and channels are stored.
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag( NLOOP_STATE_DEGLITCHERBANK,
+    banks_active, chans_active, 0 );
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      deglitchers[bidx * chancount + cidx].SaveState(statebuf);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template <class indextype_t>
+void nloop_DeGlitcherBankDyn_t<indextype_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_DEGLITCHERBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      deglitchers[bidx * chancount + cidx].LoadState(statebuf);
+}
+
+
+
+//
+// nloop_TriggerBankDyn_t Class
+
+
+// Constructor.
+
+template <class indextype_t>
+nloop_TriggerBankDyn_t<indextype_t>::nloop_TriggerBankDyn_t(void)
+{
+  trigger_count_left = 0;
+  window_time_left = 0;
+
+  triggers = NULL;
+  enabled = NULL;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+}
+
+
+
+// This reserves space for the specified geometry.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans)
+{
+  size_t cellcount;
+
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  cellcount = ((size_t) pending_banks) * ((size_t) pending_chans);
+
+  arena.Reserve( cellcount * sizeof( nloop_Trigger_t<indextype_t> ) );
+  arena.Reserve( cellcount * sizeof(bool) );
+}
+
+
+
+// This carves storage and resets the bank.
+
+template <class indextype_t>
+bool nloop_TriggerBankDyn_t<indextype_t>::
+AttachStorage(nloop_Arena_t &arena)
+{
+  void *trigblock;
+  void *flagblock;
+  int cellcount, cellidx;
+
+  cellcount = pending_banks * pending_chans;
+
+  // Carve both pieces even if the first fails, to keep carving in step
+  // with reservation.
+  trigblock = arena.Carve( ((size_t) cellcount)
+    * sizeof( nloop_Trigger_t<indextype_t> ) );
+  flagblock = arena.Carve( ((size_t) cellcount) * sizeof(bool) );
+
+  trigger_count_left = 0;
+  window_time_left = 0;
+  triggers = NULL;
+  enabled = NULL;
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if ( (NULL == trigblock) || (NULL == flagblock) )
+    return false;
+
+  triggers = (nloop_Trigger_t<indextype_t> *) trigblock;
+  enabled = (bool *) flagblock;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    new (&(triggers[cellidx])) nloop_Trigger_t<indextype_t>;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+
+  ResetState();
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+template <class indextype_t>
+int nloop_TriggerBankDyn_t<indextype_t>::GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+template <class indextype_t>
+int nloop_TriggerBankDyn_t<indextype_t>::GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This initializes state to sane values.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::ResetState(void)
+{
+  int cellcount, cellidx;
+
+  trigger_count_left = 0;
+  window_time_left = 0;
+
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+  {
+    enabled[cellidx] = false;
+    triggers[cellidx].ResetState();
+  }
+}
+
+
+
+// This forces state to "idle" and resets transient state to sane values.
+// Configuration state is left intact.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::ForceIdle(void)
+{
+  int cellcount, cellidx;
+
+  // Halt all triggering.
+  trigger_count_left = 0;
+  window_time_left = 0;
+
+  // Reset individual triggers.
+  cellcount = bankcount * chancount;
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    triggers[cellidx].ForceIdle();
+}
+
+
+
+// This resets the active triggering time window and trigger count,
+// enabling triggering.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+EnableTriggering( indextype_t active_window_samps,
+  indextype_t max_pulses_sent )
+{
+  window_time_left = active_window_samps;
+  trigger_count_left = max_pulses_sent;
+}
+
+
+
+// This disables triggering. Triggers that are in progress will still
+// complete.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::DisableTriggering(void)
+{
+  window_time_left = 0;
+  trigger_count_left = 0;
+}
+
+
+
+// This accepts a delay/phase sample and returns the current output state.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+ProcessSamples(indextype_t *sampvals, indextype_t *targetvals,
+  indextype_t *periods, bool *detectflags, bool *trigsout)
+{
+  int bidx, cidx;
+  int cellidx;
+  bool thisout;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_TRIGGERBANK);
+
+  // Reaching the end of the window drops the stimulation quota to zero.
+  // We still have to call the update routine to finish pulses that are
+  // in progress.
+
+  if (window_time_left > 0)
+    window_time_left--;
+  else
+    trigger_count_left = 0;
+
+
+  // Only scan active banks and channels, in the same order as the
+  // standard bank, since cells share the pulse quota.
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      cellidx = bidx * chancount + cidx;
+      thisout = false;
+
+      if (enabled[cellidx])
+        // This checks and then updates trigger_count_left.
+        thisout = triggers[cellidx].ProcessSample(
+          sampvals[cellidx], targetvals[cellidx],
+          periods[cellidx], detectflags[cellidx],
+          trigger_count_left );
+
+      trigsout[cellidx] = thisout;
+    }
+}
+
+
+
+// Active geometry accessors.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+template <class indextype_t>
+int nloop_TriggerBankDyn_t<indextype_t>::GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+template <class indextype_t>
+int nloop_TriggerBankDyn_t<indextype_t>::GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+// Whole-bank configuration accessors. These cover all cells.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::SetEnableFlags(bool *want_enabled)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    enabled[cellidx] = want_enabled[cellidx];
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SetPulseDurations(indextype_t *duration_samps)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    triggers[cellidx].SetPulseDuration( duration_samps[cellidx] );
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SetPulseCooldowns(indextype_t *cooldown_samps)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    triggers[cellidx].SetPulseCooldown( cooldown_samps[cellidx] );
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::SetAllReRaises(bool want_reraise)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    triggers[cellidx].SetReRaise(want_reraise);
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::GetEnableFlags(bool *is_enabled)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    is_enabled[cellidx] = enabled[cellidx];
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+GetPulseDurations(indextype_t *duration_samps)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    duration_samps[cellidx] = triggers[cellidx].GetPulseDuration();
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+GetPulseCooldowns(indextype_t *cooldown_samps)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    cooldown_samps[cellidx] = triggers[cellidx].GetPulseCooldown();
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::GetReRaises(bool *reraise_flags)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    reraise_flags[cellidx] = triggers[cellidx].GetReRaise();
+}
+
+
+
+// Single-cell configuration accessors.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SetOneEnableFlag(int bankidx, int chanidx, bool want_enabled)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    enabled[bankidx * chancount + chanidx] = want_enabled;
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SetOnePulseDuration(int bankidx, int chanidx,
+  indextype_t new_duration_samps)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    triggers[bankidx * chancount + chanidx].SetPulseDuration(
+      new_duration_samps );
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SetOnePulseCooldown(int bankidx, int chanidx,
+  indextype_t new_cooldown_samps)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    triggers[bankidx * chancount + chanidx].SetPulseCooldown(
+      new_cooldown_samps );
+}
+
+
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SetOneReRaise(int bankidx, int chanidx, bool want_reraise)
+{
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    triggers[bankidx * chancount + chanidx].SetReRaise(want_reraise);
+}
+
+
+
+template <class indextype_t>
+bool nloop_TriggerBankDyn_t<indextype_t>::
+GetOneEnableFlag(int bankidx, int chanidx)
+{
+  bool result;
+
+  result = false;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = enabled[bankidx * chancount + chanidx];
+
+  return result;
+}
+
+
+
+template <class indextype_t>
+indextype_t nloop_TriggerBankDyn_t<indextype_t>::
+GetOnePulseDuration(int bankidx, int chanidx)
+{
+  indextype_t result;
+
+  result = 0;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = triggers[bankidx * chancount + chanidx].GetPulseDuration();
+
+  return result;
+}
+
+
+
+template <class indextype_t>
+indextype_t nloop_TriggerBankDyn_t<indextype_t>::
+GetOnePulseCooldown(int bankidx, int chanidx)
+{
+  indextype_t result;
+
+  result = 0;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = triggers[bankidx * chancount + chanidx].GetPulseCooldown();
+
+  return result;
+}
+
+
+
+template <class indextype_t>
+bool nloop_TriggerBankDyn_t<indextype_t>::
+GetOneReRaise(int bankidx, int chanidx)
+{
+  bool result;
+
+  result = false;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = triggers[bankidx * chancount + chanidx].GetReRaise();
+
+  return result;
+}
+
+
+
+// Checkpointing. Only active triggers are stored.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag(NLOOP_STATE_TRIGGERBANK, banks_active, chans_active, 0);
+
+  statebuf.PutValue(trigger_count_left);
+  statebuf.PutValue(window_time_left);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      triggers[bidx * chancount + cidx].SaveState(statebuf);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template <class indextype_t>
+void nloop_TriggerBankDyn_t<indextype_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_TRIGGERBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  statebuf.GetValue(trigger_count_left);
+  statebuf.GetValue(window_time_left);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      triggers[bidx * chancount + cidx].LoadState(statebuf);
+}
+
+
+
+//
+// This is the end of the file.
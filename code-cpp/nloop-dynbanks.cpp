@@ -0,0 +1,206 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Run-time geometry bank modules - non-template functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+
+//
+// nloop_ThresholdDualBankDyn_t Class
+
+
+// Constructor.
+
+nloop_ThresholdDualBankDyn_t::nloop_ThresholdDualBankDyn_t(void)
+{
+  prev_state = NULL;
+
+  bankcount = 0;
+  chancount = 0;
+  pending_banks = 0;
+  pending_chans = 0;
+
+  chans_active = 0;
+  banks_active = 0;
+}
+
+
+
+// This reserves space for the specified geometry.
+
+void nloop_ThresholdDualBankDyn_t::ReserveStorage(nloop_Arena_t &arena,
+  int new_banks, int new_chans)
+{
+  pending_banks = (0 < new_banks) ? new_banks : 0;
+  pending_chans = (0 < new_chans) ? new_chans : 0;
+
+  arena.Reserve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof(bool) );
+}
+
+
+
+// This carves storage and resets detection state. The active geometry is
+// set to the full configured geometry.
+
+bool nloop_ThresholdDualBankDyn_t::AttachStorage(nloop_Arena_t &arena)
+{
+  void *block;
+
+  block = arena.Carve( ((size_t) pending_banks) * ((size_t) pending_chans)
+    * sizeof(bool) );
+
+  prev_state = NULL;
+  bankcount = 0;
+  chancount = 0;
+  chans_active = 0;
+  banks_active = 0;
+
+  if (NULL == block)
+    return false;
+
+  prev_state = (bool *) block;
+
+  bankcount = pending_banks;
+  chancount = pending_chans;
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  ResetState();
+
+  return true;
+}
+
+
+
+// Configured geometry accessors.
+
+int nloop_ThresholdDualBankDyn_t::GetBankCount(void)
+{
+  return bankcount;
+}
+
+
+
+int nloop_ThresholdDualBankDyn_t::GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+// This resets internal state to "no events detected".
+
+void nloop_ThresholdDualBankDyn_t::ResetState(void)
+{
+  int cellcount, cellidx;
+
+  cellcount = bankcount * chancount;
+
+  for (cellidx = 0; cellidx < cellcount; cellidx++)
+    prev_state[cellidx] = false;
+}
+
+
+
+// This returns true if and only if the sample rose to the turn-on
+// threshold and has not yet fallen below the turn-off threshold.
+
+void nloop_ThresholdDualBankDyn_t::TestDual(bool *flag_activate,
+  bool *flag_sustain, bool *outflag)
+{
+  int bidx, cidx;
+  int cellidx;
+
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_THRESHDUAL);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+    {
+      cellidx = bidx * chancount + cidx;
+
+      outflag[cellidx] = flag_activate[cellidx]
+        || ( prev_state[cellidx] && flag_sustain[cellidx] );
+      prev_state[cellidx] = outflag[cellidx];
+    }
+}
+
+
+
+// Active geometry accessors.
+
+int nloop_ThresholdDualBankDyn_t::GetActiveChans(void)
+{
+  return chans_active;
+}
+
+
+
+void nloop_ThresholdDualBankDyn_t::SetActiveChans(int new_chans)
+{
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  chans_active = new_chans;
+}
+
+
+
+int nloop_ThresholdDualBankDyn_t::GetActiveBanks(void)
+{
+  return banks_active;
+}
+
+
+
+void nloop_ThresholdDualBankDyn_t::SetActiveBanks(int new_banks)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  banks_active = new_banks;
+}
+
+
+
+// Checkpointing. Only active banks and channels are stored, one row per
+// bank, as in the standard bank.
+
+void nloop_ThresholdDualBankDyn_t::SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx;
+
+  statebuf.PutTag(NLOOP_STATE_THRESHDUAL, banks_active, chans_active, 0);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    statebuf.PutArray(prev_state + bidx * chancount, chans_active);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+void nloop_ThresholdDualBankDyn_t::LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx;
+
+  if (!statebuf.CheckTag(NLOOP_STATE_THRESHDUAL, banks_active, chans_active,
+    0))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    statebuf.GetArray(prev_state + bidx * chancount, chans_active);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,679 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Run-time geometry bank modules - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - These get their storage from a heap arena (nloop-arena.h), so
+// they're workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_DYNBANKS_H
+#define NLOOP_DYNBANKS_H
+
+
+// The standard bank classes size their storage from the "bankcount" and
+// "chancount" template arguments, so a program built for 1024 channels
+// carries 1024 channels' worth of state even on a 32-channel rig. The
+// "Dyn" variants here take their bank and channel counts at configuration
+// time instead, and get their storage from an arena:
+//
+//   filters.ReserveStorage(arena, banks, chans);
+//   arena.Commit();
+//   filters.AttachStorage(arena);
+//
+// All allocation happens in arena.Commit(). After that, processing and
+// accessors never allocate.
+//
+// Accessors match the standard banks. Active geometry works the same way,
+// clamped to the configured geometry rather than the template geometry,
+// and starts out as the full configured geometry. Checkpoints use the same
+// record format as the standard banks, so state can be moved between a
+// standard bank and a Dyn bank with the same active geometry.
+//
+// Every per-cell bank has a Dyn variant: filter banks, the analytic
+// estimator bank, and the detection banks (averager, single and dual
+// thresholds, de-glitcher, and trigger bank). A whole detection chain can
+// therefore be sized for the rig that's actually attached.
+//
+// Stage counts, FIR lengths, accumulator types, and estimator types are
+// still template arguments; they're properties of the filter design, not
+// of the rig.
+//
+// Slices are replaced by plain arrays. Per-channel data ("1 x chans") has
+// one entry per configured channel. Per-bank-and-channel data
+// ("banks x chans") is stored bank-major: element [bidx][cidx] is at
+// (bidx * chans + cidx), where "chans" is the configured channel count
+// (GetChanCount()), not the active count.
+//
+// Before AttachStorage() succeeds, a Dyn bank has zero geometry and every
+// call is a no-op.
+//
+// The standard de-glitcher and threshold banks always process their full
+// template geometry. Their Dyn variants have active geometry like the other
+// banks, and checkpoint the active cells; this is the same record as the
+// standard bank's when the active geometry is the standard bank's full
+// geometry. The Dyn trigger bank's ResetState() makes the full configured
+// geometry active rather than setting it to zero.
+//
+// The IIR, FIR, and averager banks keep their per-cell state in flat
+// arrays and process each bank row with the best vector kernel the CPU
+// supports (see nloop-dispatch.h). Results are identical to the standard
+// banks'.
+
+
+//
+// Classes
+
+
+// IIR filter bank. See nloop_IIRFilterBank_t.
+
+template <class samptype_t, class indextype_t, int stagecount,
+  class accumtype_t = samptype_t>
+class nloop_IIRFilterBankDyn_t
+{
+protected:
+  // Coefficients, [bankcount][stagecount][5], in the arena. Each stage is
+  // { den1, den2, num0, num1, num2 }, as the biquad kernel expects.
+  samptype_t *coeffs;
+  // Denominator shifts, [bankcount][stagecount], in the arena.
+  uint8_t *den0bits;
+
+  // Stage history, [bankcount][stagecount][4][chancount], in the arena.
+  // The four planes are previous input, input before that, previous
+  // output, and output before that.
+  samptype_t *history;
+
+  // Intermediate stage outputs, [2][chancount], in the arena.
+  samptype_t *scratch;
+
+  // Configured geometry. Storage is attached only if this is non-zero.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of stages, channels, and banks that are actually being used.
+  int stages_active;
+  int chans_active;
+  int banks_active;
+
+  // Biquad kernel for this CPU.
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> kernels;
+
+public:
+  nloop_IIRFilterBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  // This reserves space for the specified geometry. Call AttachStorage()
+  // after the arena is committed.
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  // This carves and initializes storage. It returns false on failure.
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // "indata" is 1 x chans, and "outdata" is banks x chans.
+  // NOTE - This only manipulates active channels and banks. Unused parts
+  // of the output array will get stale.
+  void ApplyBankOnce(samptype_t *indata, samptype_t *outdata);
+
+
+  // Accessors.
+
+  int GetActiveStages(void);
+  void SetActiveStages(int new_stages);
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+
+  void BlankCoefficients(void);
+
+  void GetCoefficients(int stagenum, int banknum,
+    uint8_t &old_den0bits, samptype_t &old_den1, samptype_t &old_den2,
+    samptype_t &old_num0, samptype_t &old_num1, samptype_t &old_num2);
+
+  // Coefficients are updated for all channels, not just active channels.
+  void SetCoefficients(int stagenum, int banknum,
+    uint8_t new_den0bits, samptype_t new_den1, samptype_t new_den2,
+    samptype_t new_num0, samptype_t new_num1, samptype_t new_num2);
+
+  // "indata" is 1 x chans. This updates all channels.
+  void FastSettleBuffers(samptype_t *indata,
+    bool (&copy_input)[stagecount]);
+
+  // Checkpointing. Same format as nloop_IIRFilterBank_t.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// FIR filter bank. See nloop_FIRFilterBank_t.
+// NOTE - Buffer length must be a power of two, for masking.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, class accumtype_t = samptype_t>
+class nloop_FIRFilterBankDyn_t
+{
+protected:
+  // FIR instances, [bankcount], in the arena.
+  nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs,accumtype_t> *firs;
+
+  // Input data buffers, [chancount][buflen], in the arena.
+  samptype_t *inbufs;
+  indextype_t bufptr;
+
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+  // Dot product kernel for this CPU.
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> kernels;
+
+public:
+  nloop_FIRFilterBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // "indata" is 1 x chans, and "outdata" is banks x chans.
+  void ApplyBankOnce(samptype_t *indata, samptype_t *outdata);
+
+
+  // Accessors.
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+
+  void BlankAllFilters(void);
+  void BlankOneFilter(int banknum);
+
+  void SetOneCoefficient(int banknum,
+    indextype_t coeffidx, samptype_t coeffval);
+  samptype_t GetOneCoefficient(int banknum, indextype_t coeffidx);
+
+  void SetOneGeometry(int banknum,
+    uint8_t newfracbits, indextype_t newcoeffcount);
+  void GetOneGeometry(int banknum,
+    uint8_t &oldfracbits, indextype_t &oldcoeffcount);
+
+  void SetBankCoefficients(int banknum,
+    int newbits, indextype_t newcoeffcount,
+    nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &newcoeffs);
+  void GetBankCoefficients(int banknum,
+    int &oldbits, indextype_t &oldcoeffcount,
+    nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &oldcoeffs);
+
+  void BlankAllInputBuffers(void);
+  void BlankOneInputBuffer(int channum);
+  // "indata" is 1 x chans.
+  void FastSettleBuffers(samptype_t *indata);
+
+  // Checkpointing. Same format as nloop_FIRFilterBank_t.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// Analytic estimator bank. See nloop_AnalyticBank_PT_t.
+
+template <class samptype_t, class indextype_t, class estimator_t>
+class nloop_AnalyticBankDyn_t
+{
+protected:
+  // Estimator instances, [bankcount][chancount], in the arena.
+  estimator_t *estimators;
+
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+public:
+  nloop_AnalyticBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // This also resets zero levels and active bank/channel counts.
+  void ResetState(void);
+
+  // All arrays are banks x chans. These only operate on active
+  // banks/channels.
+  void HandleSamples(samptype_t *indata);
+  void GetEstimatedAnalytic(samptype_t *outmagnitude,
+    indextype_t *outperiod, indextype_t *since_rise_zc,
+    indextype_t *since_fall_zc);
+
+
+  // Accessors.
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+
+  // "newminperiods" has one entry per configured bank.
+  void SetMinPeriods(indextype_t *newminperiods);
+  void SetOneMinPeriod(int bankidx, indextype_t newminperiod);
+
+  // "newzeros" is banks x chans.
+  void SetZeroLevels(samptype_t *newzeros);
+  void SetOneZeroLevel(int bankidx, int chanidx, samptype_t newzero);
+
+  // Checkpointing. Same format as nloop_AnalyticBank_PT_t.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// Averager bank. See nloop_AveragerBank_t.
+
+template <class samptype_t, uint8_t coeffbits>
+class nloop_AveragerBankDyn_t
+{
+protected:
+  // Averager state and configuration, [bankcount][chancount] each, in the
+  // arena. See nloop_Averager_t.
+  samptype_t *running_sums;
+  samptype_t *coeffs;
+  uint8_t *avgbits;
+
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+  // Averager kernel for this CPU.
+  nloop_DispatchKernels_t<samptype_t, samptype_t> kernels;
+
+public:
+  nloop_AveragerBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  // Averagers start with zero coefficients, zero averaging bits, and zero
+  // running sums, like a newly-constructed standard bank.
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // Both arrays are banks x chans. This only operates on active
+  // banks/channels.
+  void UpdateAverage(samptype_t *indata, samptype_t *outdata);
+
+  // "indata" is banks x chans.
+  void InitAverage(samptype_t *indata);
+
+
+  // Accessors.
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+
+  // "Bank" arrays have one entry per configured bank, "Chan" arrays have
+  // one entry per configured channel, and the others are banks x chans.
+
+  void SetCoeffs(samptype_t *new_coeffs);
+  void SetBankCoeffs(samptype_t *new_coeffs);
+  void SetChanCoeffs(samptype_t *new_coeffs);
+  void SetUniformCoeffs(samptype_t new_coeff);
+  void SetOneCoeff(int bankidx, int chanidx, samptype_t new_coeff);
+
+  void SetAvgBits(uint8_t *new_avgbits);
+  void SetBankAvgBits(uint8_t *new_avgbits);
+  void SetChanAvgBits(uint8_t *new_avgbits);
+  void SetUniformAvgBits(uint8_t new_avgbits);
+  void SetOneAvgBits(int bankidx, int chanidx, uint8_t new_avgbits);
+
+  // These return 0 for out-of-range banks/channels.
+  samptype_t GetOneCoeff(int bankidx, int chanidx);
+  uint8_t GetOneAvgBits(int bankidx, int chanidx);
+
+  // Checkpointing. Same format as nloop_AveragerBank_t.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// Single-threshold bank. See nloop_ThresholdSingleBank_t.
+// NOTE - This has no per-cell state, so it doesn't reserve any arena
+// space; it only needs to know the geometry.
+
+template <class samptype_t>
+class nloop_ThresholdSingleBankDyn_t
+{
+protected:
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+public:
+  nloop_ThresholdSingleBankDyn_t(void);
+  // Default destructor is fine.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  // This returns false if the arena isn't committed.
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // All arrays are banks x chans. Output flags are true if and only if the
+  // sample is at or above the threshold. This only operates on active
+  // banks/channels.
+  void TestSamples(samptype_t *indata, samptype_t *thresholds,
+    bool *outflag);
+
+
+  // Accessors.
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+};
+
+
+
+// Dual-threshold bank. See nloop_ThresholdDualBank_t.
+
+class nloop_ThresholdDualBankDyn_t
+{
+protected:
+  // Previous detection state, [bankcount][chancount], in the arena.
+  bool *prev_state;
+
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+public:
+  nloop_ThresholdDualBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  // Detection state starts out as "no events detected".
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // This resets all cells to "no events detected".
+  void ResetState(void);
+
+  // All arrays are banks x chans. This only operates on active
+  // banks/channels.
+  void TestDual(bool *flag_activate, bool *flag_sustain, bool *outflag);
+
+
+  // Accessors.
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+
+  // Checkpointing. This saves or restores detection state for active
+  // banks and channels. Loading fails if the active geometry doesn't match.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// De-glitcher bank. See nloop_DeGlitcherBank_t.
+
+template <class indextype_t>
+class nloop_DeGlitcherBankDyn_t
+{
+protected:
+  // De-glitcher instances, [bankcount][chancount], in the arena.
+  nloop_DeGlitcher_t<indextype_t> *deglitchers;
+
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+public:
+  nloop_DeGlitcherBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  // De-glitchers start with zero delays and low outputs.
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // Both arrays are banks x chans. This only operates on active
+  // banks/channels.
+  void ProcessSample(bool *indata, bool *outdata);
+
+
+  // Accessors.
+
+  int GetActiveChans(void);
+  void SetActiveChans(int new_chans);
+  int GetActiveBanks(void);
+  void SetActiveBanks(int new_banks);
+
+  // These set the delays and reset the countdowns, for all cells.
+  // Array shapes are as for the averager bank's accessors.
+  void SetDelays(indextype_t *new_rise_delays,
+    indextype_t *new_fall_delays);
+  void SetBankDelays(indextype_t *new_rise_delays,
+    indextype_t *new_fall_delays);
+  void SetChanDelays(indextype_t *new_rise_delays,
+    indextype_t *new_fall_delays);
+  void SetUniformDelays(
+    indextype_t new_rise_delay, indextype_t new_fall_delay );
+  void SetOneDelays( int bankidx, int chanidx,
+    indextype_t new_rise_delay, indextype_t new_fall_delay );
+
+  // Checkpointing. This saves or restores de-glitcher state for active
+  // banks and channels. Loading fails if the active geometry doesn't match.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// Trigger bank. See nloop_TriggerBank_t.
+
+template <class indextype_t>
+class nloop_TriggerBankDyn_t
+{
+protected:
+  // Priming state.
+  indextype_t trigger_count_left, window_time_left;
+
+  // Trigger instances and per-trigger enable flags, [bankcount][chancount],
+  // in the arena.
+  nloop_Trigger_t<indextype_t> *triggers;
+  bool *enabled;
+
+  // Configured geometry.
+  int bankcount, chancount;
+  int pending_banks, pending_chans;
+
+  // Number of channels and banks that are actually being used.
+  int chans_active;
+  int banks_active;
+
+public:
+  nloop_TriggerBankDyn_t(void);
+  // Default destructor is fine; the arena owns the storage.
+
+
+  // Storage.
+
+  void ReserveStorage(nloop_Arena_t &arena, int new_banks, int new_chans);
+  // This resets the bank (see ResetState()).
+  bool AttachStorage(nloop_Arena_t &arena);
+
+  int GetBankCount(void);
+  int GetChanCount(void);
+
+
+  // Processing functions.
+
+  // This disables and idles every trigger and restores default trigger
+  // configuration. The full configured geometry is made active.
+  void ResetState(void);
+  void ForceIdle(void);
+
+  void EnableTriggering( indextype_t active_window_samps,
+    indextype_t max_pulses_sent );
+  void DisableTriggering(void);
+
+  // All arrays are banks x chans. This only operates on active
+  // banks/channels.
+  void ProcessSamples(indextype_t *sampvals, indextype_t *targetvals,
+    indextype_t *periods, bool *detectflags, bool *trigsout);
+
+
+  // Accessors.
+
+  void SetActiveBanks(int new_banks);
+  void SetActiveChans(int new_chans);
+
+  int GetActiveBanks(void);
+  int GetActiveChans(void);
+
+
+  // These arrays are banks x chans, and cover all cells.
+
+  void SetEnableFlags(bool *want_enabled);
+  void SetPulseDurations(indextype_t *duration_samps);
+  void SetPulseCooldowns(indextype_t *cooldown_samps);
+
+  void SetAllReRaises(bool want_reraise);
+
+  void GetEnableFlags(bool *is_enabled);
+  void GetPulseDurations(indextype_t *duration_samps);
+  void GetPulseCooldowns(indextype_t *cooldown_samps);
+  void GetReRaises(bool *reraise_flags);
+
+
+  void SetOneEnableFlag(int bankidx, int chanidx, bool want_enabled);
+  void SetOnePulseDuration(int bankidx, int chanidx,
+    indextype_t new_duration_samps);
+  void SetOnePulseCooldown(int bankidx, int chanidx,
+    indextype_t new_cooldown_samps);
+  void SetOneReRaise(int bankidx, int chanidx, bool want_reraise);
+
+  bool GetOneEnableFlag(int bankidx, int chanidx);
+  indextype_t GetOnePulseDuration(int bankidx, int chanidx);
+  indextype_t GetOnePulseCooldown(int bankidx, int chanidx);
+  bool GetOneReRaise(int bankidx, int chanidx);
+
+
+  // Checkpointing. Same format as nloop_TriggerBank_t.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-dynbanks-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
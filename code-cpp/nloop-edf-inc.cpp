@@ -0,0 +1,123 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// EDF/BDF recording reader - Template implementations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// nloop_EDFReader_t Class
+
+
+// This decodes up to "count" frames into slices, returning the number
+// decoded.
+// Samples for one signal are contiguous within a record, so this decodes
+// one channel at a time across as many slices as the record can supply.
+
+template<class samptype_t, int slicechans>
+size_t nloop_EDFReader_t::ReadNextSlices(size_t count,
+  nloop_SampleSlice_t<samptype_t,1,slicechans> *slices)
+{
+  const uint8_t *recbase;
+  const uint8_t *src;
+  size_t donecount, thiscount, sidx;
+  int cidx, copychans;
+  int64_t thisval, minval, maxval, thismult, thisoffset;
+
+  if ( (NULL == instream) || (NULL == slices) || (chan_samprecord < 1) )
+    return 0;
+
+  copychans = (int) chan_signals.size();
+  if (copychans > slicechans)
+    copychans = slicechans;
+
+  minval = NLOOP_MINVAL(samptype_t);
+  maxval = NLOOP_MAXVAL(samptype_t);
+
+  donecount = 0;
+
+  while (donecount < count)
+  {
+    // Move to the next record if we've used this one up.
+    if (current_samp >= chan_samprecord)
+    {
+      current_rec++;
+      current_samp = 0;
+    }
+
+    if ( (current_rec < block_firstrec)
+      || (current_rec >= (block_firstrec + block_reccount)) )
+      if (!LoadBlock(current_rec))
+        break;
+
+    thiscount = chan_samprecord - current_samp;
+    if (thiscount > (count - donecount))
+      thiscount = count - donecount;
+
+    recbase = blockbuf.data()
+      + (current_rec - block_firstrec) * recordbytes;
+
+    for (cidx = 0; cidx < copychans; cidx++)
+    {
+      src = recbase + sig_offsets[chan_signals[cidx]]
+        + current_samp * sampbytes;
+
+      thismult = chan_mult[cidx];
+      thisoffset = chan_offset[cidx];
+
+      for (sidx = 0; sidx < thiscount; sidx++)
+      {
+        if (is_bdf)
+        {
+          // 24-bit little-endian, two's complement. Sign-extend by
+          // subtracting 2^24 rather than by shifting a negative value.
+          thisval = (int32_t) ( ((uint32_t) src[0])
+            | ((uint32_t) src[1] << 8) | ((uint32_t) src[2] << 16) );
+          if (0 != (thisval & 0x800000))
+            thisval -= 0x1000000;
+          src += 3;
+        }
+        else
+        {
+          thisval = (int16_t) ( src[0] | (src[1] << 8) );
+          src += 2;
+        }
+
+        // NOTE - The setters bound the gain and offset so that this can't
+        // overflow (see NLOOP_EDF_MAX_MULT).
+        if (is_scaled)
+        {
+          thisval *= thismult;
+          NLOOP_ARITHSHR(thisval, NLOOP_EDF_SCALE_BITS);
+          thisval += thisoffset;
+        }
+
+        if (thisval < minval)
+          thisval = minval;
+        if (thisval > maxval)
+          thisval = maxval;
+
+        slices[donecount + sidx].data[0][cidx] = (samptype_t) thisval;
+      }
+    }
+
+    for (sidx = 0; sidx < thiscount; sidx++)
+      for (cidx = copychans; cidx < slicechans; cidx++)
+        slices[donecount + sidx].data[0][cidx] = 0;
+
+    current_samp += thiscount;
+    donecount += thiscount;
+  }
+
+  return donecount;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,599 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// EDF/BDF recording reader - non-template functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+
+// Fixed header layout (ASCII fields, space-padded):
+//   Offset  Bytes
+//     0       8    version ("0", or 0xff "BIOSEMI" for BDF)
+//     8      80    patient ID
+//    88      80    recording ID
+//   168       8    start date
+//   176       8    start time
+//   184       8    header size in bytes
+//   192      44    reserved ("EDF+C", "EDF+D", "24BIT", or blank)
+//   236       8    number of data records (-1 if unknown)
+//   244       8    data record duration in seconds
+//   252       4    number of signals (ns)
+// Signal header (each field is repeated ns times before the next one):
+//   label (16), transducer (80), physical units (8), physical minimum (8),
+//   physical maximum (8), digital minimum (8), digital maximum (8),
+//   prefiltering (80), samples per data record (8), reserved (32).
+// Data records hold each signal's samples in turn, as little-endian int16
+// (EDF) or int24 (BDF).
+
+
+//
+// Helper Functions
+
+
+// This extracts a header field, trimming trailing spaces.
+
+inline string nloop_EDFField_helper(const char *fieldbuf, int fieldlen)
+{
+  while ( (0 < fieldlen) && (' ' == fieldbuf[fieldlen - 1]) )
+    fieldlen--;
+
+  return string(fieldbuf, fieldlen);
+}
+
+
+
+// This extracts a numeric header field.
+// It returns false if the field isn't a number.
+
+inline bool nloop_EDFNumber_helper(const char *fieldbuf, int fieldlen,
+  double &value)
+{
+  string fieldtext;
+  const char *startptr;
+  char *endptr;
+
+  fieldtext = nloop_EDFField_helper(fieldbuf, fieldlen);
+  startptr = fieldtext.c_str();
+
+  value = strtod(startptr, &endptr);
+
+  return ( (endptr != startptr) && ('\0' == *endptr) );
+}
+
+
+//
+// nloop_EDFReader_t Class
+
+
+// Constructor.
+
+nloop_EDFReader_t::nloop_EDFReader_t(void)
+{
+  instream = NULL;
+  block_maxbytes = NLOOP_EDF_BLOCK_BYTES;
+
+  Close();
+}
+
+
+
+// This parses the header. It returns false if the header isn't valid.
+
+bool nloop_EDFReader_t::ReadHeader(void)
+{
+  char fixedbuf[NLOOP_EDF_HEADER_BYTES];
+  vector<char> sigbuf;
+  const char *fieldptr;
+  double thisval;
+  long sigcount, sidx, cidx;
+  streamoff filesize, datasize;
+  bool is_ok;
+
+  instream->seekg(0, ios::beg);
+  instream->read(fixedbuf, NLOOP_EDF_HEADER_BYTES);
+  if (!instream->good())
+    return false;
+
+
+  // File-level fields.
+
+  if ( ((char) 0xff == fixedbuf[0])
+    && (0 == memcmp(fixedbuf + 1, "BIOSEMI", 7)) )
+  {
+    is_bdf = true;
+    sampbytes = 3;
+  }
+  else if ('0' == fixedbuf[0])
+  {
+    is_bdf = false;
+    sampbytes = 2;
+  }
+  else
+    return false;
+
+  if (!nloop_EDFNumber_helper(fixedbuf + 252, 4, thisval))
+    return false;
+  sigcount = (long) thisval;
+  if (sigcount < 1)
+    return false;
+
+  if (!nloop_EDFNumber_helper(fixedbuf + 184, 8, thisval))
+    return false;
+  headerbytes = (size_t) thisval;
+  if ( ((size_t) (sigcount + 1)) * NLOOP_EDF_SIGHEADER_BYTES != headerbytes )
+    return false;
+
+  if (!nloop_EDFNumber_helper(fixedbuf + 244, 8, recordseconds))
+    return false;
+
+  if (!nloop_EDFNumber_helper(fixedbuf + 236, 8, thisval))
+    return false;
+  recordcount = (long) thisval;
+
+
+  // Per-signal fields.
+
+  sigbuf.resize(sigcount * NLOOP_EDF_SIGHEADER_BYTES);
+  instream->read(sigbuf.data(), sigbuf.size());
+  if (!instream->good())
+    return false;
+
+  sig_labels.resize(sigcount);
+  sig_units.resize(sigcount);
+  sig_physmin.resize(sigcount);
+  sig_physmax.resize(sigcount);
+  sig_digmin.resize(sigcount);
+  sig_digmax.resize(sigcount);
+  sig_samprecord.resize(sigcount);
+  sig_offsets.resize(sigcount);
+
+  is_ok = true;
+  recordbytes = 0;
+
+  for (sidx = 0; is_ok && (sidx < sigcount); sidx++)
+  {
+    fieldptr = sigbuf.data();
+
+    sig_labels[sidx] = nloop_EDFField_helper(fieldptr + sidx * 16, 16);
+    fieldptr += sigcount * 96;
+
+    sig_units[sidx] = nloop_EDFField_helper(fieldptr + sidx * 8, 8);
+    fieldptr += sigcount * 8;
+
+    is_ok = is_ok && nloop_EDFNumber_helper( fieldptr + sidx * 8, 8,
+      sig_physmin[sidx] );
+    fieldptr += sigcount * 8;
+
+    is_ok = is_ok && nloop_EDFNumber_helper( fieldptr + sidx * 8, 8,
+      sig_physmax[sidx] );
+    fieldptr += sigcount * 8;
+
+    is_ok = is_ok && nloop_EDFNumber_helper(fieldptr + sidx * 8, 8, thisval);
+    sig_digmin[sidx] = (long) thisval;
+    fieldptr += sigcount * 8;
+
+    is_ok = is_ok && nloop_EDFNumber_helper(fieldptr + sidx * 8, 8, thisval);
+    sig_digmax[sidx] = (long) thisval;
+    fieldptr += sigcount * 88;
+
+    is_ok = is_ok && nloop_EDFNumber_helper(fieldptr + sidx * 8, 8, thisval);
+    sig_samprecord[sidx] = (int) thisval;
+
+    is_ok = is_ok && (0 < sig_samprecord[sidx])
+      && (sig_digmin[sidx] < sig_digmax[sidx]);
+
+    sig_offsets[sidx] = recordbytes;
+    recordbytes += ((size_t) sig_samprecord[sidx]) * sampbytes;
+  }
+
+  if (!is_ok)
+    return false;
+
+
+  // The record count may be -1 (or wrong) if recording was interrupted.
+  // Trust the file size instead, and ignore any partial record.
+
+  instream->seekg(0, ios::end);
+  filesize = instream->tellg();
+  instream->clear();
+
+  datasize = filesize - (streamoff) headerbytes;
+  if (datasize < 0)
+    return false;
+
+  if ( (recordcount < 0)
+    || (((streamoff) recordcount) * ((streamoff) recordbytes) > datasize) )
+    recordcount = (long) (datasize / recordbytes);
+
+
+  // Pick slice channels: the fastest non-annotation signals.
+
+  chan_samprecord = 0;
+  for (sidx = 0; sidx < sigcount; sidx++)
+    if ( ("EDF Annotations" != sig_labels[sidx])
+      && ("BDF Annotations" != sig_labels[sidx])
+      && (sig_samprecord[sidx] > chan_samprecord) )
+      chan_samprecord = sig_samprecord[sidx];
+
+  for (sidx = 0; sidx < sigcount; sidx++)
+    if ( ("EDF Annotations" != sig_labels[sidx])
+      && ("BDF Annotations" != sig_labels[sidx])
+      && (sig_samprecord[sidx] == chan_samprecord) )
+      chan_signals.push_back(sidx);
+
+  chan_mult.resize(chan_signals.size());
+  chan_offset.resize(chan_signals.size());
+  for (cidx = 0; cidx < (long) chan_signals.size(); cidx++)
+  {
+    chan_mult[cidx] = 1 << NLOOP_EDF_SCALE_BITS;
+    chan_offset[cidx] = 0;
+  }
+
+  return true;
+}
+
+
+
+// This reads a block of records starting at "recidx".
+// It returns false at end of file or on I/O errors.
+
+bool nloop_EDFReader_t::LoadBlock(long recidx)
+{
+  long newcount;
+
+  if ( (NULL == instream) || (recidx < 0) || (recidx >= recordcount) )
+    return false;
+
+  newcount = (long) (block_maxbytes / recordbytes);
+  if (newcount < 1)
+    newcount = 1;
+  if (newcount > (recordcount - recidx))
+    newcount = recordcount - recidx;
+
+  // This only allocates if the block size went up.
+  if (blockbuf.size() < (newcount * recordbytes))
+    blockbuf.resize(newcount * recordbytes);
+
+  // Sequential reads don't need to seek.
+  if ( recidx != (block_firstrec + block_reccount) )
+    instream->seekg( (streamoff) headerbytes
+      + ((streamoff) recidx) * ((streamoff) recordbytes), ios::beg );
+
+  instream->read( (char *) blockbuf.data(), newcount * recordbytes );
+
+  // NOTE - A failed read leaves the stream somewhere in the middle of the
+  // block. Mark the position as unknown so that the next load seeks.
+  if (!instream->good())
+  {
+    block_firstrec = -1;
+    block_reccount = 0;
+    instream->clear();
+    return false;
+  }
+
+  block_firstrec = recidx;
+  block_reccount = newcount;
+
+  return true;
+}
+
+
+
+// This opens a file and reads its header.
+
+bool nloop_EDFReader_t::OpenFile(string filename)
+{
+  Close();
+
+  ownfile.open(filename.c_str(), ios::in | ios::binary);
+  if (!ownfile.is_open())
+    return false;
+
+  return AttachStream(ownfile);
+}
+
+
+
+// This reads the header from a caller-supplied stream.
+
+bool nloop_EDFReader_t::AttachStream(istream &newstream)
+{
+  // Don't close our own file if that's what we were handed.
+  if (&newstream != &ownfile)
+    Close();
+
+  instream = &newstream;
+
+  if (!ReadHeader())
+  {
+    Close();
+    return false;
+  }
+
+  // The stream is past the header now, at the first record. Let LoadBlock()
+  // know it doesn't need to seek.
+  instream->seekg( (streamoff) headerbytes, ios::beg );
+  block_firstrec = 0;
+  block_reccount = 0;
+
+  return true;
+}
+
+
+
+void nloop_EDFReader_t::Close(void)
+{
+  if (ownfile.is_open())
+    ownfile.close();
+  ownfile.clear();
+
+  instream = NULL;
+
+  is_bdf = false;
+  sampbytes = 2;
+  headerbytes = 0;
+  recordcount = 0;
+  recordseconds = 0;
+  recordbytes = 0;
+
+  sig_labels.clear();
+  sig_units.clear();
+  sig_physmin.clear();
+  sig_physmax.clear();
+  sig_digmin.clear();
+  sig_digmax.clear();
+  sig_samprecord.clear();
+  sig_offsets.clear();
+
+  chan_signals.clear();
+  chan_samprecord = 0;
+  chan_mult.clear();
+  chan_offset.clear();
+  is_scaled = false;
+
+  // Keep the block buffer's storage for the next file.
+  block_firstrec = 0;
+  block_reccount = 0;
+  current_rec = 0;
+  current_samp = 0;
+}
+
+
+
+bool nloop_EDFReader_t::IsOpen(void)
+{
+  return (NULL != instream);
+}
+
+
+
+// File information.
+
+bool nloop_EDFReader_t::IsBDF(void)
+{
+  return is_bdf;
+}
+
+
+
+long nloop_EDFReader_t::GetRecordCount(void)
+{
+  return recordcount;
+}
+
+
+
+double nloop_EDFReader_t::GetRecordSeconds(void)
+{
+  return recordseconds;
+}
+
+
+
+// Signal information. These don't range-check "sigidx".
+
+int nloop_EDFReader_t::GetSignalCount(void)
+{
+  return (int) sig_labels.size();
+}
+
+
+
+string nloop_EDFReader_t::GetSignalLabel(int sigidx)
+{
+  return sig_labels[sigidx];
+}
+
+
+
+string nloop_EDFReader_t::GetSignalUnits(int sigidx)
+{
+  return sig_units[sigidx];
+}
+
+
+
+int nloop_EDFReader_t::GetSignalSamplesPerRecord(int sigidx)
+{
+  return sig_samprecord[sigidx];
+}
+
+
+
+void nloop_EDFReader_t::GetSignalRange(int sigidx,
+  double &physmin, double &physmax, long &digmin, long &digmax)
+{
+  physmin = sig_physmin[sigidx];
+  physmax = sig_physmax[sigidx];
+  digmin = sig_digmin[sigidx];
+  digmax = sig_digmax[sigidx];
+}
+
+
+
+// Slice channel information.
+
+int nloop_EDFReader_t::GetChanCount(void)
+{
+  return (int) chan_signals.size();
+}
+
+
+
+// This returns -1 if "chanidx" is out of range.
+
+int nloop_EDFReader_t::GetChanSignal(int chanidx)
+{
+  if ( (chanidx < 0) || (chanidx >= (int) chan_signals.size()) )
+    return -1;
+
+  return chan_signals[chanidx];
+}
+
+
+
+double nloop_EDFReader_t::GetSampleRate(void)
+{
+  if (0 >= recordseconds)
+    return 0;
+
+  return chan_samprecord / recordseconds;
+}
+
+
+
+size_t nloop_EDFReader_t::GetFrameCount(void)
+{
+  return ((size_t) recordcount) * chan_samprecord;
+}
+
+
+
+// Per-channel scaling.
+// The fixed-point gain and the offset are bounded so that scaling a 24-bit
+// sample can't overflow int64_t.
+
+bool nloop_EDFReader_t::SetChanScaling(int chanidx, double gain,
+  int64_t offset)
+{
+  double fixedgain;
+  int cidx;
+
+  if ( (chanidx < 0) || (chanidx >= (int) chan_signals.size()) )
+    return false;
+
+  // NOTE - NaN fails both comparisons, so it's rejected too.
+  fixedgain = gain * (1 << NLOOP_EDF_SCALE_BITS);
+  if ( !( (fixedgain <= NLOOP_EDF_MAX_MULT)
+    && (fixedgain >= -NLOOP_EDF_MAX_MULT) ) )
+    return false;
+
+  if ( (offset > NLOOP_EDF_MAX_OFFSET) || (offset < -NLOOP_EDF_MAX_OFFSET) )
+    return false;
+
+  chan_mult[chanidx] = (int64_t) llround(fixedgain);
+  chan_offset[chanidx] = offset;
+
+  is_scaled = false;
+  for (cidx = 0; cidx < (int) chan_signals.size(); cidx++)
+    if ( ( (1 << NLOOP_EDF_SCALE_BITS) != chan_mult[cidx] )
+      || (0 != chan_offset[cidx]) )
+      is_scaled = true;
+
+  return true;
+}
+
+
+
+// This scales every channel so that output is in physical units times
+// "unitsperphys".
+// physical = (digital - digmin) * (physmax - physmin) / (digmax - digmin)
+//   + physmin
+// Every channel is checked before any are changed.
+
+bool nloop_EDFReader_t::SetPhysicalScaling(double unitsperphys)
+{
+  vector<double> gains, offsets;
+  double gain, offset;
+  int cidx, sidx;
+
+  for (cidx = 0; cidx < (int) chan_signals.size(); cidx++)
+  {
+    sidx = chan_signals[cidx];
+
+    // NOTE - A signal with digmax == digmin gives an infinite or NaN gain,
+    // which is rejected below.
+    gain = (sig_physmax[sidx] - sig_physmin[sidx])
+      / (sig_digmax[sidx] - sig_digmin[sidx]);
+    offset = sig_physmin[sidx] - sig_digmin[sidx] * gain;
+
+    gain *= unitsperphys;
+    offset *= unitsperphys;
+
+    // NOTE - NaN fails these comparisons, so it's rejected too.
+    if ( !( (fabs(gain * (1 << NLOOP_EDF_SCALE_BITS)) <= NLOOP_EDF_MAX_MULT)
+      && (fabs(offset) <= NLOOP_EDF_MAX_OFFSET) ) )
+      return false;
+
+    gains.push_back(gain);
+    offsets.push_back(offset);
+  }
+
+  for (cidx = 0; cidx < (int) chan_signals.size(); cidx++)
+    SetChanScaling( cidx, gains[cidx], (int64_t) llround(offsets[cidx]) );
+
+  return true;
+}
+
+
+
+void nloop_EDFReader_t::ClearScaling(void)
+{
+  int cidx;
+
+  for (cidx = 0; cidx < (int) chan_signals.size(); cidx++)
+  {
+    chan_mult[cidx] = 1 << NLOOP_EDF_SCALE_BITS;
+    chan_offset[cidx] = 0;
+  }
+
+  is_scaled = false;
+}
+
+
+
+// Block buffer size, in bytes. This takes effect on the next block read.
+
+void nloop_EDFReader_t::SetBlockBytes(size_t newbytes)
+{
+  block_maxbytes = newbytes;
+}
+
+
+
+// Sequential access.
+
+void nloop_EDFReader_t::Rewind(void)
+{
+  current_rec = 0;
+  current_samp = 0;
+}
+
+
+
+size_t nloop_EDFReader_t::GetPosition(void)
+{
+  return ((size_t) current_rec) * chan_samprecord + current_samp;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,178 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// EDF/BDF recording reader.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Wrapper.
+#ifndef NLOOP_EDF_H
+#define NLOOP_EDF_H
+
+
+// This streams EDF, EDF+, and BDF files into sample slices.
+// Data records are read a block at a time into a fixed-size buffer and
+// decoded straight into the caller's slices, so memory use doesn't depend
+// on file size.
+
+// EDF signals can have different sample rates. Slice channels are the
+// non-annotation signals with the highest number of samples per record;
+// other signals (and annotations) are skipped. Use GetChanSignal() to see
+// which signal each slice channel came from.
+
+// By default, slices hold raw digital values. Per-channel gain and offset
+// can be set manually, or computed from each signal's physical range.
+
+// NOTE - EDF+D (discontinuous) files are read as if they were continuous.
+// FIXME - Time-stamped annotation records aren't decoded.
+
+
+//
+// Constants
+
+// Fixed header size, and per-signal header size, in bytes.
+#define NLOOP_EDF_HEADER_BYTES 256
+#define NLOOP_EDF_SIGHEADER_BYTES 256
+
+// Default block buffer size, in bytes. At least one record is always read.
+#define NLOOP_EDF_BLOCK_BYTES (1024 * 1024)
+
+// Fractional bits used for per-channel scaling.
+#define NLOOP_EDF_SCALE_BITS 16
+
+// Limits on the fixed-point gain and on the offset. A 24-bit sample times
+// the gain is below 2^55, and the offset keeps the sum below 2^63.
+#define NLOOP_EDF_MAX_MULT (1LL << 31)
+#define NLOOP_EDF_MAX_OFFSET (1LL << 62)
+
+
+//
+// Classes
+
+
+// EDF/BDF reader.
+
+class nloop_EDFReader_t
+{
+protected:
+  // Input. This is either our own file or a caller-supplied stream.
+  ifstream ownfile;
+  istream *instream;
+
+  // File-level header information.
+  bool is_bdf;
+  int sampbytes;
+  size_t headerbytes;
+  long recordcount;
+  double recordseconds;
+  size_t recordbytes;
+
+  // Per-signal header information.
+  vector<string> sig_labels;
+  vector<string> sig_units;
+  vector<double> sig_physmin, sig_physmax;
+  vector<long> sig_digmin, sig_digmax;
+  vector<int> sig_samprecord;
+  vector<size_t> sig_offsets;
+
+  // Slice channels, and their per-channel scaling.
+  // Output = (digital * chan_mult) >> NLOOP_EDF_SCALE_BITS + chan_offset.
+  vector<int> chan_signals;
+  int chan_samprecord;
+  vector<int64_t> chan_mult;
+  vector<int64_t> chan_offset;
+  bool is_scaled;
+
+  // Block buffer and read position.
+  vector<uint8_t> blockbuf;
+  size_t block_maxbytes;
+  long block_firstrec;
+  long block_reccount;
+  long current_rec;
+  int current_samp;
+
+  // This parses the header. It returns false if the header isn't valid.
+  bool ReadHeader(void);
+
+  // This reads a block of records starting at "recidx".
+  // It returns false at end of file or on I/O errors.
+  bool LoadBlock(long recidx);
+
+public:
+  nloop_EDFReader_t(void);
+  // Default destructor is fine.
+
+  // These return false if the file couldn't be read or didn't have a valid
+  // header. Any previously opened file is closed first.
+  bool OpenFile(string filename);
+  // The stream must be binary and seekable, and must stay valid until
+  // Close() is called.
+  bool AttachStream(istream &newstream);
+
+  void Close(void);
+  bool IsOpen(void);
+
+  // File information.
+  bool IsBDF(void);
+  long GetRecordCount(void);
+  double GetRecordSeconds(void);
+
+  // Signal information. These don't range-check "sigidx".
+  int GetSignalCount(void);
+  string GetSignalLabel(int sigidx);
+  string GetSignalUnits(int sigidx);
+  int GetSignalSamplesPerRecord(int sigidx);
+  void GetSignalRange(int sigidx, double &physmin, double &physmax,
+    long &digmin, long &digmax);
+
+  // Slice channel information.
+  int GetChanCount(void);
+  int GetChanSignal(int chanidx);
+  double GetSampleRate(void);
+  size_t GetFrameCount(void);
+
+  // Per-channel scaling. Scaled output saturates at the limits of the
+  // slice's sample type.
+  // These return false, leaving scaling unchanged, if the channel doesn't
+  // exist or if a gain or offset isn't finite or is past the limits
+  // (NLOOP_EDF_MAX_MULT / NLOOP_EDF_MAX_OFFSET).
+  bool SetChanScaling(int chanidx, double gain, int64_t offset);
+  // This scales every channel so that output is in physical units times
+  // "unitsperphys" (e.g. 1000 for microvolts from a millivolt signal).
+  bool SetPhysicalScaling(double unitsperphys);
+  void ClearScaling(void);
+
+  // Block buffer size, in bytes. This takes effect on the next block read.
+  void SetBlockBytes(size_t newbytes);
+
+  // Sequential access.
+  void Rewind(void);
+  size_t GetPosition(void);
+
+  // This decodes up to "count" frames into slices, returning the number
+  // decoded. Slice channels past the end of the file's channels are zeroed,
+  // and file channels past the end of the slice are dropped.
+  template<class samptype_t, int slicechans>
+  size_t ReadNextSlices(size_t count,
+    nloop_SampleSlice_t<samptype_t,1,slicechans> *slices);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-edf-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -91,7 +91,7 @@ template<class samptype_t> samptype_t nloop_LLToSample(long long data)
 // Bank numbers are copied as-is.
 
 template<class samptype_t, class filtbanktype_t>
-void nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank)
+bool nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank)
 {
   multimap<string,string> criteria;
   map<int,int> bankremap;
@@ -100,83 +100,125 @@ void nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank)
 
   criteria.clear();
   bankremap.clear();
-  nloop_ReadBiquadCoeffs<samptype_t,filtbanktype_t>(infile,
+  return nloop_ReadBiquadCoeffs<samptype_t,filtbanktype_t>(infile,
     filtbank, criteria, bankremap);
 }
 
 
 
 // This sets all named bank and stage coefficients, active or not.
-// This version does criteria checking and bank remapping.
-// If match criteria are supplied, only table rows that match all of the
-// specified criteria are used.
-// Match criteria are (column name, cell value) tuples.
-// Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
+// This reads rows from a reader that has already had its header set up.
 
 template<class samptype_t, class filtbanktype_t>
-void nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank,
+bool nloop_ReadBiquadCoeffs_helper(nloop_CSVIntegerReader_t &reader,
+  filtbanktype_t &filtbank,
   multimap<string,string> &matchcriteria, map<int,int> &bankremap)
 {
-  map<string,vector<string>> tabdata;
-  size_t row_count, ridx;
-  map<string,string> thisrow;
+  vector<string> colnames;
+  long long cellvals[8];
   int banknum, stagenum;
   uint8_t den0bits;
   samptype_t num0, num1, num2;
   samptype_t den0, den1, den2;
 
 
-  // Read the raw CSV data.
-  tabdata = nloop_ReadCSV(infile);
+  // Resolve the columns we want.
+  // Rows that don't match the criteria are skipped.
+
+  colnames.push_back("bank");
+  colnames.push_back("stage");
+  colnames.push_back("num0");
+  colnames.push_back("num1");
+  colnames.push_back("num2");
+  colnames.push_back("den0");
+  colnames.push_back("den1");
+  colnames.push_back("den2");
 
-  // Get the number of rows.
-  row_count = nloop_GetCSVRowCount(tabdata);
+  reader.SelectColumns(colnames);
+  reader.SetCriteria(matchcriteria);
 
 
-  // Iterate through rows.
-  for (ridx = 0; ridx < row_count; ridx++)
+  // Iterate through matching rows.
+  // NOTE - Missing cells are read as 0, which we can live with.
+  // Rows with malformed cells are skipped.
+  while ( reader.ReadRow(cellvals) )
   {
-    // Fetch this row.
-    thisrow = nloop_GetCSVRowCells(tabdata, ridx);
+    if (0 < reader.GetRowBadCellCount())
+      continue;
+
+    banknum = (int) cellvals[0];
+    stagenum = (int) cellvals[1];
+
+    if (bankremap.count(banknum))
+      banknum = bankremap[banknum];
+
+    // FIXME - Assuming signed 64-bit is larger than samptype_t.
+    // If the user is using uint64_t, this will lose half the range.
 
-    // Check match criteria.
-    // Proceed if the row matches.
-    if ( nloop_CSVRowMatchesAllCriteria(thisrow, matchcriteria) )
+    num0 = nloop_LLToSample<samptype_t>( cellvals[2] );
+    num1 = nloop_LLToSample<samptype_t>( cellvals[3] );
+    num2 = nloop_LLToSample<samptype_t>( cellvals[4] );
+
+    den0 = nloop_LLToSample<samptype_t>( cellvals[5] );
+    den1 = nloop_LLToSample<samptype_t>( cellvals[6] );
+    den2 = nloop_LLToSample<samptype_t>( cellvals[7] );
+
+    // Get the bit-shift value.
+    // This tolerates negative den0.
+    den0bits = 0; // den0 = 1.
+    while (den0 > 1)
     {
-      // NOTE - Entries that aren't present will get created with "".
-      // Running stoi on "" gives 0, which we can live with.
+      den0 >>= 1;
+      den0bits++;
+    }
+
+    // Set this coefficient.
+    filtbank.SetCoefficients( stagenum, banknum,
+      den0bits, den1, den2, num0, num1, num2 );
+  }
+
+  return (0 == reader.GetBadCellCount());
+}
+
+
 
-      banknum = stoi(thisrow["bank"]);
-      stagenum = stoi(thisrow["stage"]);
+// This sets all named bank and stage coefficients, active or not.
+// This version does criteria checking and bank remapping.
+// If match criteria are supplied, only table rows that match all of the
+// specified criteria are used.
+// Match criteria are (column name, cell value) tuples.
+// Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
 
-      if (bankremap.count(banknum))
-        banknum = bankremap[banknum];
+template<class samptype_t, class filtbanktype_t>
+bool nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap)
+{
+  nloop_CSVIntegerReader_t reader;
 
-      // FIXME - Assuming signed 64-bit is larger than samptype_t.
-      // If the user is using uint64_t, this will lose half the range.
+  // Rows are streamed; non-matching rows are skipped as they're read.
+  if (!reader.ReadHeader(infile))
+    return false;
 
-      num0 = nloop_LLToSample<samptype_t>( stoll(thisrow["num0"]) );
-      num1 = nloop_LLToSample<samptype_t>( stoll(thisrow["num1"]) );
-      num2 = nloop_LLToSample<samptype_t>( stoll(thisrow["num2"]) );
+  return nloop_ReadBiquadCoeffs_helper<samptype_t,filtbanktype_t>(
+    reader, filtbank, matchcriteria, bankremap);
+}
 
-      den0 = nloop_LLToSample<samptype_t>( stoll(thisrow["den0"]) );
-      den1 = nloop_LLToSample<samptype_t>( stoll(thisrow["den1"]) );
-      den2 = nloop_LLToSample<samptype_t>( stoll(thisrow["den2"]) );
 
-      // Get the bit-shift value.
-      // This tolerates negative den0.
-      den0bits = 0; // den0 = 1.
-      while (den0 > 1)
-      {
-        den0 >>= 1;
-        den0bits++;
-      }
 
-      // Set this coefficient.
-      filtbank.SetCoefficients( stagenum, banknum,
-        den0bits, den1, den2, num0, num1, num2 );
-    }
-  }
+// This sets all named bank and stage coefficients, active or not.
+// This version reads from a pre-parsed table, using its index to visit
+// only the matching rows.
+
+template<class samptype_t, class filtbanktype_t>
+bool nloop_ReadBiquadCoeffs(nloop_CSVTable_t &intable,
+  filtbanktype_t &filtbank,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap)
+{
+  nloop_CSVIntegerReader_t reader;
+
+  reader.AttachTable(intable);
+  return nloop_ReadBiquadCoeffs_helper<samptype_t,filtbanktype_t>(
+    reader, filtbank, matchcriteria, bankremap);
 }
 
 
@@ -211,9 +253,10 @@ void nloop_WriteBiquadCoeffs(ostream &outfile, filtbanktype_t &filtbank,
 {
   int chancount, bankcount, stagecount;
   int bidx, sidx;
-  list<string> colnames;
-  map<string,vector<string>> colseries;
+  nloop_CSVWriter_t writer;
+  vector<string> colnames, extra_vals;
   list<string>::iterator nidx;
+  size_t eidx;
   uint8_t den0bits;
   samptype_t num0, num1, num2, den0, den1, den2;
 
@@ -224,12 +267,13 @@ void nloop_WriteBiquadCoeffs(ostream &outfile, filtbanktype_t &filtbank,
   bankcount = filtbank.GetActiveBanks();
   stagecount = filtbank.GetActiveStages();
 
-  // Construct column label list.
-
-  colnames.clear();
+  // Construct the column label list, and look up extra column values once.
 
   for (nidx = extra_col_order.begin(); nidx != extra_col_order.end(); nidx++)
+  {
     colnames.push_back(*nidx);
+    extra_vals.push_back(extra_col_values[*nidx]);
+  }
 
   colnames.push_back("bank");
   colnames.push_back("stage");
@@ -240,8 +284,10 @@ void nloop_WriteBiquadCoeffs(ostream &outfile, filtbanktype_t &filtbank,
   colnames.push_back("den1");
   colnames.push_back("den2");
 
+  writer.Start(outfile, colnames, want_header);
 
-  // Construct data series.
+
+  // Write one row per bank and stage.
 
   // Initialize to suppress compiler warnings.
   // FIXME - Maybe set to blatantly bogus values for easier debugging?
@@ -252,47 +298,32 @@ void nloop_WriteBiquadCoeffs(ostream &outfile, filtbanktype_t &filtbank,
   num1 = 0;
   num2 = 0;
 
-  colseries.clear();
-
   if (0 < chancount)
     for (bidx = 0; bidx < bankcount; bidx++)
       for (sidx = 0; sidx < stagecount; sidx++)
       {
-        // Coefficients.
-
         filtbank.GetCoefficients(sidx, bidx,
           den0bits, den1, den2, num0, num1, num2);
         den0 = 1;
         den0 <<= den0bits;
 
-        colseries["bank"].push_back(to_string(bidx));
-        colseries["stage"].push_back(to_string(sidx));
+        // Extra columns.
+        for (eidx = 0; eidx < extra_vals.size(); eidx++)
+          writer.AddText(extra_vals[eidx]);
 
-        colseries["num0"].push_back(to_string(
-          nloop_SampleToLL<samptype_t>(num0) ));
-        colseries["num1"].push_back(to_string(
-          nloop_SampleToLL<samptype_t>(num1) ));
-        colseries["num2"].push_back(to_string(
-          nloop_SampleToLL<samptype_t>(num2) ));
+        writer.AddInteger(bidx);
+        writer.AddInteger(sidx);
 
-        colseries["den0"].push_back(to_string(
-          nloop_SampleToLL<samptype_t>(den0) ));
-        colseries["den1"].push_back(to_string(
-          nloop_SampleToLL<samptype_t>(den1) ));
-        colseries["den2"].push_back(to_string(
-          nloop_SampleToLL<samptype_t>(den2) ));
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(num0) );
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(num1) );
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(num2) );
 
-        // Extra columns.
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(den0) );
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(den1) );
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(den2) );
 
-        for (nidx = extra_col_order.begin();
-          nidx != extra_col_order.end();
-          nidx++)
-          colseries[*nidx].push_back(extra_col_values[*nidx]);
+        writer.EndRow();
       }
-
-
-  // Write the table.
-  nloop_WriteCSV(outfile, colnames, colseries, want_header);
 }
 
 
@@ -313,7 +344,7 @@ void nloop_WriteBiquadCoeffs(ostream &outfile, filtbanktype_t &filtbank,
 // Don't remap bank numbers.
 
 template<class samptype_t, class indextype_t, class filtbanktype_t>
-void nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
+bool nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
   uint8_t fracbits)
 {
   multimap<string,string> criteria;
@@ -322,47 +353,44 @@ void nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
   // Wrap the criteria-filtered bank-remapped version.
   criteria.clear();
   bankremap.clear();
-  nloop_ReadFIRCoeffs<samptype_t,indextype_t,filtbanktype_t>(
+  return nloop_ReadFIRCoeffs<samptype_t,indextype_t,filtbanktype_t>(
     infile, filtbank, fracbits, criteria, bankremap);
 }
 
 
 
-// This reads a FIR filter from a stream.
-// If match criteria are supplied, only table rows that match all of the
-// specified criteria are used.
-// Match criteria are (column name, cell value) tuples.
-// Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
+// This reads FIR filters from a reader that has already had its header
+// set up.
 
 template<class samptype_t, class indextype_t, class filtbanktype_t>
-void nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
-  uint8_t fracbits,
+bool nloop_ReadFIRCoeffs_helper(nloop_CSVIntegerReader_t &reader,
+  filtbanktype_t &filtbank, uint8_t fracbits,
   multimap<string,string> &matchcriteria, map<int,int> &bankremap)
 {
-  map<string,vector<string>> tabdata;
-  map<string,vector<string>>::iterator tabcolidx;
   map<int,string> banknames;
   map<int,string>::iterator banknameidx;
+  vector<string> colnames;
+  vector<int> bankindices;
+  vector<long long> cellvals;
   regex thisregex;
   smatch thismatchlist;
   string thiscolname;
+  vector<bool> cellpresent;
+  vector<uint8_t> bankended;
+  vector<indextype_t> coeffcounts;
   int bankidx;
-  size_t rowcount, ridx;
-  map<string,string> thisrow;
-  indextype_t coeffcount;
+  size_t cidx, colcount;
+  bool is_ok;
 
 
-  // Read the raw CSV data.
-  tabdata = nloop_ReadCSV(infile);
-
-
-  // First pass: Get column names for remapped banks.
+  // Get column names for remapped banks.
+  // This only has to look at the header row.
 
   banknames.clear();
   thisregex = "bank\\s+(\\d+)";
-  for (tabcolidx = tabdata.begin(); tabdata.end() != tabcolidx; tabcolidx++)
+  for (cidx = 0; cidx < reader.GetColumnNames().size(); cidx++)
   {
-    thiscolname = tabcolidx->first;
+    thiscolname = reader.GetColumnNames()[cidx];
 
     // NOTE - "regex_match" looks for an exact match (whole line matches).
     // "regex_search" looks for a substring that matches.
@@ -378,49 +406,106 @@ void nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
   }
 
 
-  // Second pass: For each _column_, walk through table _rows_. Using rows
-  // that match the criteria, build a FIR.
-
-  rowcount = nloop_GetCSVRowCount(tabdata);
+  // Select one column per bank, and blank those banks' filters.
 
   for (banknameidx = banknames.begin();
     banknames.end() != banknameidx;
     banknameidx++)
   {
-    // Get the column name and remapped bank index for this bank.
+    bankindices.push_back(banknameidx->first);
+    colnames.push_back(banknameidx->second);
 
-    bankidx = banknameidx->first;
-    thiscolname = banknameidx->second;
+    filtbank.BlankOneFilter(banknameidx->first);
+  }
 
+  colcount = colnames.size();
+  if (colcount < 1)
+    return true;
 
-    // Iterate through the rows, building this FIR.
+  reader.SelectColumns(colnames);
+  reader.SetCriteria(matchcriteria);
+  cellvals.resize(colcount);
+  cellpresent.resize(colcount);
 
-    filtbank.BlankOneFilter(bankidx);
-    coeffcount = 0;
 
-    for (ridx = 0; ridx < rowcount; ridx++)
-    {
-      // This fills in "" for any missing column cells.
-      // Running stoi on "" gives 0, which we can live with.
-      thisrow = nloop_GetCSVRowCells(tabdata, ridx);
+  // Walk through matching rows once, building all of the FIRs in parallel.
+  // Each matching row holds the next coefficient for every bank.
+  // A blank cell ends that bank's column; shorter banks are written padded
+  // with blank cells. Malformed cells are read as 0, so that later
+  // coefficients keep their positions.
+  // NOTE - A coefficient after the end of its bank's column is ignored, and
+  // makes the read fail.
 
-      if ( nloop_CSVRowMatchesAllCriteria(thisrow, matchcriteria) )
-      {
-        // FIXME - Assume 64-bit is larger than samptype_t.
-        // If the user is using uint64_t, this will lose have the range.
+  coeffcounts.assign(colcount, 0);
+  bankended.assign(colcount, 0);
+  is_ok = true;
 
+  while ( reader.ReadRow(cellvals.data(), cellpresent) )
+  {
+    // FIXME - Assume 64-bit is larger than samptype_t.
+    // If the user is using uint64_t, this will lose have the range.
+
+    for (cidx = 0; cidx < colcount; cidx++)
+    {
+      if (!cellpresent[cidx])
+        bankended[cidx] = 1;
+      else if (bankended[cidx])
+        is_ok = false;
+      else
+      {
         // This does bounds checking for us, so don't check it here.
-        filtbank.SetOneCoefficient( bankidx, coeffcount,
-          nloop_LLToSample<samptype_t>( stoll(thisrow[thiscolname]) ) );
-        coeffcount++;
+        filtbank.SetOneCoefficient( bankindices[cidx], coeffcounts[cidx],
+          nloop_LLToSample<samptype_t>( cellvals[cidx] ) );
+
+        coeffcounts[cidx]++;
       }
+    }
+  }
+
+  // This does bounds checking on the coefficient count, so it's safe.
+  for (cidx = 0; cidx < colcount; cidx++)
+    filtbank.SetOneGeometry(bankindices[cidx], fracbits, coeffcounts[cidx]);
 
-    } // Row iteration.
+  return is_ok && (0 == reader.GetBadCellCount());
+}
 
-    // This does bounds checking on coeffcount, so it's safe.
-    filtbank.SetOneGeometry(bankidx, fracbits, coeffcount);
 
-  } // Bank iteration.
+
+// This reads a FIR filter from a stream.
+// If match criteria are supplied, only table rows that match all of the
+// specified criteria are used.
+// Match criteria are (column name, cell value) tuples.
+// Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
+
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+bool nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
+  uint8_t fracbits,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap)
+{
+  nloop_CSVIntegerReader_t reader;
+
+  if (!reader.ReadHeader(infile))
+    return false;
+
+  return nloop_ReadFIRCoeffs_helper<samptype_t,indextype_t,filtbanktype_t>(
+    reader, filtbank, fracbits, matchcriteria, bankremap);
+}
+
+
+
+// This reads a FIR filter from a pre-parsed table, using its index to
+// visit only the matching rows.
+
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+bool nloop_ReadFIRCoeffs(nloop_CSVTable_t &intable, filtbanktype_t &filtbank,
+  uint8_t fracbits,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap)
+{
+  nloop_CSVIntegerReader_t reader;
+
+  reader.AttachTable(intable);
+  return nloop_ReadFIRCoeffs_helper<samptype_t,indextype_t,filtbanktype_t>(
+    reader, filtbank, fracbits, matchcriteria, bankremap);
 }
 
 
@@ -458,62 +543,61 @@ void nloop_WriteFIRCoeffs(ostream &outfile, filtbanktype_t &filtbank,
   list<string> &extra_col_order, map<string,string> &extra_col_values)
 {
   int bankcount, bidx;
-  list<string> colnames;
+  nloop_CSVWriter_t writer;
+  vector<string> colnames, extra_vals;
+  vector<indextype_t> coeffcounts;
   list<string>::iterator nidx;
-  map<string,vector<string>> colseries;
-  vector<string> thiscolseries;
-  string thiscolname, thisval;
+  size_t eidx;
   indextype_t coeffcount, maxcoeffcount, sidx;
   uint8_t fracbits;
 
-  // Initialize column names.
+  // Initialize column names, and look up extra column values once.
 
-  colnames.clear();
   for (nidx = extra_col_order.begin(); nidx != extra_col_order.end(); nidx++)
+  {
     colnames.push_back(*nidx);
+    extra_vals.push_back(extra_col_values[*nidx]);
+  }
 
 
-  // Build per-bank data series.
+  // Each active bank gets a column. Rows are coefficients.
 
   bankcount = filtbank.GetActiveBanks();
-  colseries.clear();
   maxcoeffcount = 0;
 
   for (bidx = 0; bidx < bankcount; bidx++)
   {
-    thiscolname = "bank ";
-    thiscolname += to_string(bidx);
-    colnames.push_back(thiscolname);
+    colnames.push_back( "bank " + to_string(bidx) );
 
-    thiscolseries.clear();
     filtbank.GetOneGeometry(bidx, fracbits, coeffcount);
+    coeffcounts.push_back(coeffcount);
 
     if (coeffcount > maxcoeffcount)
       maxcoeffcount = coeffcount;
+  }
 
-    for (sidx = 0; sidx < coeffcount; sidx++)
-      thiscolseries.push_back(
-        to_string( filtbank.GetOneCoefficient(bidx, sidx) ) );
+  writer.Start(outfile, colnames, want_header);
 
-    colseries[thiscolname] = thiscolseries;
-  }
 
-  // Add the extra columns.
+  // Write one row per coefficient. Banks with fewer coefficients get
+  // empty cells.
 
-  for (nidx = extra_col_order.begin(); nidx != extra_col_order.end(); nidx++)
+  for (sidx = 0; sidx < maxcoeffcount; sidx++)
   {
-    thiscolname = *nidx;
-    thisval = extra_col_values[thiscolname];
+    for (eidx = 0; eidx < extra_vals.size(); eidx++)
+      writer.AddText(extra_vals[eidx]);
 
-    thiscolseries.clear();
-    for (sidx = 0; sidx < maxcoeffcount; sidx++)
-      thiscolseries.push_back(thisval);
+    for (bidx = 0; bidx < bankcount; bidx++)
+    {
+      if (sidx < coeffcounts[bidx])
+        writer.AddInteger( nloop_SampleToLL<samptype_t>(
+          filtbank.GetOneCoefficient(bidx, sidx) ) );
+      else
+        writer.AddEmpty();
+    }
 
-    colseries[thiscolname] = thiscolseries;
+    writer.EndRow();
   }
-
-  // Write the table.
-  nloop_WriteCSV(outfile, colnames, colseries, want_header);
 }
 
 
@@ -535,7 +619,7 @@ void nloop_WriteFIRCoeffs(ostream &outfile, filtbanktype_t &filtbank,
 // Treat all CSV rows as being part of this lookup table.
 
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
   string infield, string outfield )
 {
   multimap<string,string> criteria;
@@ -544,60 +628,94 @@ void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
 
   criteria.clear();
 
-  nloop_ReadLookupTableSingle(infile, lut, infield, outfield, criteria);
+  return nloop_ReadLookupTableSingle<intype_t,outtype_t,luttype_t>(
+    infile, lut, infield, outfield, criteria );
 }
 
 
 
 // Reading a single lookup table.
-// If match criteria are supplied, only table rows that match all of the
-// specified criteria are used.
-// Match criteria are (column name, cell value) tuples.
+// This reads rows from a reader that has already had its header set up.
 
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTableSingle_helper( nloop_CSVIntegerReader_t &reader,
+  luttype_t &lut,
   string infield, string outfield, multimap<string,string> &matchcriteria )
 {
-  map<string,vector<string>> tabdata;
-  size_t line_count, lidx;
-  map<string,string> thisline;
+  vector<string> colnames;
+  long long cellvals[3];
   int lutridx;
   intype_t inval;
   outtype_t outval;
 
 
-  // Read the raw CSV data.
-  tabdata = nloop_ReadCSV(infile);
+  // Resolve the columns we want.
+
+  colnames.push_back("row");
+  colnames.push_back(infield);
+  colnames.push_back(outfield);
 
-  // Get the number of CSV rows.
-  line_count = nloop_GetCSVRowCount(tabdata);
+  reader.SelectColumns(colnames);
+  reader.SetCriteria(matchcriteria);
 
 
-  // Iterate through CSV rows.
-  for (lidx = 0; lidx < line_count; lidx++)
+  // Iterate through matching CSV rows.
+  // NOTE - Missing cells are read as 0, which we can live with.
+  // Rows with malformed cells are skipped.
+  while ( reader.ReadRow(cellvals) )
   {
-    // Fetch this CSV row.
-    thisline = nloop_GetCSVRowCells(tabdata, lidx);
-
-    // Check match criteria.
-    // Proceed if the CSV row matches.
-    if ( nloop_CSVRowMatchesAllCriteria(thisline, matchcriteria) )
-    {
-      // NOTE - Entries that aren't present will get created with "".
-      // Running stoi on "" gives 0, which we can live with.
+    if (0 < reader.GetRowBadCellCount())
+      continue;
 
-      lutridx = stoi(thisline["row"]);
+    lutridx = (int) cellvals[0];
 
-      // FIXME - Assuming signed 64-bit is larger than intype_t/outtype_t.
-      // If the user is using uint64_t, this will lose half the range.
+    // FIXME - Assuming signed 64-bit is larger than intype_t/outtype_t.
+    // If the user is using uint64_t, this will lose half the range.
 
-      inval = nloop_LLToSample<intype_t>( stoll(thisline[infield]) );
-      outval = nloop_LLToSample<outtype_t>( stoll(thisline[outfield]) );
+    inval = nloop_LLToSample<intype_t>( cellvals[1] );
+    outval = nloop_LLToSample<outtype_t>( cellvals[2] );
 
-      // Set this LUT entry.
-      lut.SetEntry(lutridx, inval, outval);
-    }
+    // Set this LUT entry.
+    lut.SetEntry(lutridx, inval, outval);
   }
+
+  return (0 == reader.GetBadCellCount());
+}
+
+
+
+// Reading a single lookup table.
+// If match criteria are supplied, only table rows that match all of the
+// specified criteria are used.
+// Match criteria are (column name, cell value) tuples.
+
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
+  string infield, string outfield, multimap<string,string> &matchcriteria )
+{
+  nloop_CSVIntegerReader_t reader;
+
+  if (!reader.ReadHeader(infile))
+    return false;
+
+  return nloop_ReadLookupTableSingle_helper<intype_t,outtype_t,luttype_t>(
+    reader, lut, infield, outfield, matchcriteria );
+}
+
+
+
+// Reading a single lookup table from a pre-parsed table.
+// Only the rows matching the criteria are visited.
+
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTableSingle( nloop_CSVTable_t &intable, luttype_t &lut,
+  string infield, string outfield, multimap<string,string> &matchcriteria )
+{
+  nloop_CSVIntegerReader_t reader;
+
+  reader.AttachTable(intable);
+  return nloop_ReadLookupTableSingle_helper<intype_t,outtype_t,luttype_t>(
+    reader, lut, infield, outfield, matchcriteria );
 }
 
 
@@ -607,7 +725,7 @@ void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
 // Don't remap bank numbers.
 
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
   string infield, string outfield )
 {
   multimap<string,string> criteria;
@@ -618,67 +736,102 @@ void nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
   criteria.clear();
   bankremap.clear();
 
-  nloop_ReadLookupTableSingle( infile, lut, infield, outfield,
-    criteria, bankremap );
+  return nloop_ReadLookupTablePerBank<intype_t,outtype_t,luttype_t>(
+    infile, lut, infield, outfield, criteria, bankremap );
 }
 
 
 
 // Reading a class with per-bank lookup tables.
-// If match criteria are supplied, only table rows that match all of the
-// specified criteria are used.
-// Match criteria are (column name, cell value) tuples.
-// Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
+// This reads rows from a reader that has already had its header set up.
 
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
-  string infield, string outfield,
+bool nloop_ReadLookupTablePerBank_helper( nloop_CSVIntegerReader_t &reader,
+  luttype_t &lut, string infield, string outfield,
   multimap<string,string> &matchcriteria, map<int,int> &bankremap )
 {
-  map<string,vector<string>> tabdata;
-  size_t line_count, lidx;
-  map<string,string> thisline;
+  vector<string> colnames;
+  long long cellvals[4];
   int bankidx, lutridx;
   intype_t inval;
   outtype_t outval;
 
 
-  // Read the raw CSV data.
-  tabdata = nloop_ReadCSV(infile);
+  // Resolve the columns we want.
 
-  // Get the number of CSV rows.
-  line_count = nloop_GetCSVRowCount(tabdata);
+  colnames.push_back("row");
+  colnames.push_back("bank");
+  colnames.push_back(infield);
+  colnames.push_back(outfield);
 
+  reader.SelectColumns(colnames);
+  reader.SetCriteria(matchcriteria);
 
-  // Iterate through CSV rows.
-  for (lidx = 0; lidx < line_count; lidx++)
-  {
-    // Fetch this CSV row.
-    thisline = nloop_GetCSVRowCells(tabdata, lidx);
 
-    // Check match criteria.
-    // Proceed if the CSV row matches.
-    if ( nloop_CSVRowMatchesAllCriteria(thisline, matchcriteria) )
-    {
-      // NOTE - Entries that aren't present will get created with "".
-      // Running stoi on "" gives 0, which we can live with.
+  // Iterate through matching CSV rows.
+  // NOTE - Missing cells are read as 0, which we can live with.
+  // Rows with malformed cells are skipped.
+  while ( reader.ReadRow(cellvals) )
+  {
+    if (0 < reader.GetRowBadCellCount())
+      continue;
 
-      lutridx = stoi(thisline["row"]);
-      bankidx = stoi(thisline["bank"]);
+    lutridx = (int) cellvals[0];
+    bankidx = (int) cellvals[1];
 
-      if (bankremap.count(bankidx))
-        bankidx = bankremap[bankidx];
+    if (bankremap.count(bankidx))
+      bankidx = bankremap[bankidx];
 
-      // FIXME - Assuming signed 64-bit is larger than intype_t/outtype_t.
-      // If the user is using uint64_t, this will lose half the range.
+    // FIXME - Assuming signed 64-bit is larger than intype_t/outtype_t.
+    // If the user is using uint64_t, this will lose half the range.
 
-      inval = nloop_LLToSample<intype_t>( stoll(thisline[infield]) );
-      outval = nloop_LLToSample<outtype_t>( stoll(thisline[outfield]) );
+    inval = nloop_LLToSample<intype_t>( cellvals[2] );
+    outval = nloop_LLToSample<outtype_t>( cellvals[3] );
 
-      // Set this LUT entry.
-      lut.SetOneEntry(bankidx, lutridx, inval, outval);
-    }
+    // Set this LUT entry.
+    lut.SetOneEntry(bankidx, lutridx, inval, outval);
   }
+
+  return (0 == reader.GetBadCellCount());
+}
+
+
+
+// Reading a class with per-bank lookup tables.
+// If match criteria are supplied, only table rows that match all of the
+// specified criteria are used.
+// Match criteria are (column name, cell value) tuples.
+// Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
+
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
+  string infield, string outfield,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap )
+{
+  nloop_CSVIntegerReader_t reader;
+
+  if (!reader.ReadHeader(infile))
+    return false;
+
+  return nloop_ReadLookupTablePerBank_helper<intype_t,outtype_t,luttype_t>(
+    reader, lut, infield, outfield, matchcriteria, bankremap );
+}
+
+
+
+// Reading a class with per-bank lookup tables from a pre-parsed table.
+// Only the rows matching the criteria are visited.
+
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTablePerBank( nloop_CSVTable_t &intable, luttype_t &lut,
+  string infield, string outfield,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap )
+{
+  nloop_CSVIntegerReader_t reader;
+
+  reader.AttachTable(intable);
+  return nloop_ReadLookupTablePerBank_helper<intype_t,outtype_t,luttype_t>(
+    reader, lut, infield, outfield, matchcriteria, bankremap );
 }
 
 
@@ -716,9 +869,10 @@ void nloop_WriteLookupTableSingle( ostream &outfile, luttype_t &lut,
 {
   int rowcount;
   int ridx;
-  list<string> colnames;
-  map<string,vector<string>> colseries;
+  nloop_CSVWriter_t writer;
+  vector<string> colnames, extra_vals;
   list<string>::iterator nidx;
+  size_t eidx;
   intype_t inval;
   outtype_t outval;
 
@@ -727,50 +881,45 @@ void nloop_WriteLookupTableSingle( ostream &outfile, luttype_t &lut,
 
   rowcount = lut.GetActiveRows();
 
-  // Construct column label list.
-
-  colnames.clear();
+  // Construct the column label list, and look up extra column values once.
 
   for (nidx = extra_col_order.begin(); nidx != extra_col_order.end(); nidx++)
+  {
     colnames.push_back(*nidx);
+    extra_vals.push_back(extra_col_values[*nidx]);
+  }
 
   colnames.push_back("row");
   colnames.push_back(infield);
   colnames.push_back(outfield);
 
+  writer.Start(outfile, colnames, want_header);
+
 
-  // Construct data series.
+  // Write one row per LUT entry.
 
   // Initialize to suppress compiler warnings.
   // It should be possible to cast zero to any type that's used for this.
   inval = 0;
   outval = 0;
 
-  colseries.clear();
-
   for (ridx = 0; ridx < rowcount; ridx++)
   {
     lut.GetEntry(ridx, inval, outval);
 
+    // Extra columns.
+    for (eidx = 0; eidx < extra_vals.size(); eidx++)
+      writer.AddText(extra_vals[eidx]);
+
     // LUT index.
-    colseries["row"].push_back(to_string(ridx));
+    writer.AddInteger(ridx);
 
     // LUT tuple.
-    colseries[infield].push_back(to_string(
-      nloop_SampleToLL<intype_t>(inval) ));
-    colseries[outfield].push_back(to_string(
-      nloop_SampleToLL<outtype_t>(outval) ));
+    writer.AddInteger( nloop_SampleToLL<intype_t>(inval) );
+    writer.AddInteger( nloop_SampleToLL<outtype_t>(outval) );
 
-    // Extra columns.
-    for (nidx = extra_col_order.begin();
-      nidx != extra_col_order.end();
-      nidx++)
-      colseries[*nidx].push_back(extra_col_values[*nidx]);
+    writer.EndRow();
   }
-
-
-  // Write the table.
-  nloop_WriteCSV(outfile, colnames, colseries, want_header);
 }
 
 
@@ -808,9 +957,10 @@ void nloop_WriteLookupTablePerBank( ostream &outfile, luttype_t &lut,
 {
   int bankcount, rowcount;
   int bidx, ridx;
-  list<string> colnames;
-  map<string,vector<string>> colseries;
+  nloop_CSVWriter_t writer;
+  vector<string> colnames, extra_vals;
   list<string>::iterator nidx;
+  size_t eidx;
   intype_t inval;
   outtype_t outval;
 
@@ -820,53 +970,48 @@ void nloop_WriteLookupTablePerBank( ostream &outfile, luttype_t &lut,
   bankcount = lut.GetActiveBanks();
   rowcount = lut.GetActiveRows();
 
-  // Construct column label list.
-
-  colnames.clear();
+  // Construct the column label list, and look up extra column values once.
 
   for (nidx = extra_col_order.begin(); nidx != extra_col_order.end(); nidx++)
+  {
     colnames.push_back(*nidx);
+    extra_vals.push_back(extra_col_values[*nidx]);
+  }
 
   colnames.push_back("bank");
   colnames.push_back("row");
   colnames.push_back(infield);
   colnames.push_back(outfield);
 
+  writer.Start(outfile, colnames, want_header);
+
 
-  // Construct data series.
+  // Write one row per bank and LUT entry.
 
   // Initialize to suppress compiler warnings.
   // It should be possible to cast zero to any type that's used for this.
   inval = 0;
   outval = 0;
 
-  colseries.clear();
-
   for (bidx = 0; bidx < bankcount; bidx++)
     for (ridx = 0; ridx < rowcount; ridx++)
     {
       lut.GetOneEntry(bidx, ridx, inval, outval);
 
+      // Extra columns.
+      for (eidx = 0; eidx < extra_vals.size(); eidx++)
+        writer.AddText(extra_vals[eidx]);
+
       // LUT indices.
-      colseries["bank"].push_back(to_string(bidx));
-      colseries["row"].push_back(to_string(ridx));
+      writer.AddInteger(bidx);
+      writer.AddInteger(ridx);
 
       // LUT tuple.
-      colseries[infield].push_back(to_string(
-        nloop_SampleToLL<intype_t>(inval) ));
-      colseries[outfield].push_back(to_string(
-        nloop_SampleToLL<outtype_t>(outval) ));
+      writer.AddInteger( nloop_SampleToLL<intype_t>(inval) );
+      writer.AddInteger( nloop_SampleToLL<outtype_t>(outval) );
 
-      // Extra columns.
-      for (nidx = extra_col_order.begin();
-        nidx != extra_col_order.end();
-        nidx++)
-        colseries[*nidx].push_back(extra_col_values[*nidx]);
+      writer.EndRow();
     }
-
-
-  // Write the table.
-  nloop_WriteCSV(outfile, colnames, colseries, want_header);
 }
 
 
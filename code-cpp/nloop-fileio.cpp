@@ -19,6 +19,89 @@
 // I/O Helper Functions
 
 
+// This converts a CSV cell to signed long long, without throwing.
+// Whitespace around the number is skipped. Empty cells, cells with
+// anything other than an optionally signed decimal integer, and values
+// outside the signed long long range are rejected.
+// This returns false (and sets "value" to 0) if the cell was rejected.
+
+// NOTE - This replaces "stoll()", which throws on bad cells and is
+// needlessly slow for the volume of cells in coefficient files.
+
+bool nloop_CSVCellToLL(const string &cellval, long long &value)
+{
+  const char *thischar;
+  unsigned long long result, limit;
+  unsigned thisdigit;
+  bool is_negative, have_digits;
+
+  value = 0;
+  thischar = cellval.c_str();
+
+  while ( (' ' == *thischar) || ('\t' == *thischar) )
+    thischar++;
+
+  is_negative = false;
+  if ('-' == *thischar)
+  {
+    is_negative = true;
+    thischar++;
+  }
+  else if ('+' == *thischar)
+    thischar++;
+
+  // Accumulate as unsigned so that LLONG_MIN doesn't overflow.
+  limit = (unsigned long long) NLOOP_MAXVAL(long long);
+  if (is_negative)
+    limit++;
+
+  result = 0;
+  have_digits = false;
+  while ( ('0' <= *thischar) && ('9' >= *thischar) )
+  {
+    thisdigit = (unsigned) (*thischar - '0');
+    if (result > ((limit - thisdigit) / 10))
+      return false;
+
+    result = (result * 10) + thisdigit;
+    have_digits = true;
+    thischar++;
+  }
+
+  while ( (' ' == *thischar) || ('\t' == *thischar) )
+    thischar++;
+
+  if ( (!have_digits) || ('\0' != *thischar) )
+    return false;
+
+  if (is_negative)
+    result = (~result) + 1;
+
+  value = (long long) result;
+
+  return true;
+}
+
+
+
+
+// This checks whether a CSV cell is empty or holds only whitespace.
+// Blank cells are where a shorter column has run out, not bad values.
+
+bool nloop_CSVCellIsBlank(const string &cellval)
+{
+  const char *thischar;
+
+  thischar = cellval.c_str();
+
+  while ( (' ' == *thischar) || ('\t' == *thischar) )
+    thischar++;
+
+  return ('\0' == *thischar);
+}
+
+
+
 // These check a row's contents against match criteria.
 // Match criteria are (column name, cell value) tuples.
 
@@ -108,214 +191,292 @@ bool nloop_CSVRowMatchesAllCriteria( map<string,string> &thisrow,
 // CSV I/O Functions
 
 
-// This reads all columns from a CSV file, discarding order information.
-// A header line must exist, containing column names.
-// Cell values within quotes have the outermost quotes stripped.
+// Parser states for nloop_ReadCSVRow().
 
-map<string,vector<string>> nloop_ReadCSV(istream &infile)
+enum nloop_csvstate_t
 {
-  map<string,vector<string>> result;
-  list<string> colnames, cellvals;
-  list<string>::iterator cidx, vidx;
-  string thisline;
-  bool first_line;
-  regex regexnotnewline, regexnotblank;
-  regex regexquoted, regexnoquotes;
-  regex regexquotedend, regexnoquotesend;
-  smatch thismatchlist;
-  bool had_match, have_string;
-  string matchval;
-
-  // We need this to trim line delimiters, which don't match "." but do "\S".
-  regexnotnewline = "(.*)";
-  regexnotblank = "\\S";
-  // FIXME - These regexes aren't bulletproof.
-  regexquoted = "\\s*\"(.*?)\"\\s*,(.*)";
-  regexnoquotes = "\\s*([^\",\\s]*)\\s*,(.*)";
-  regexquotedend = "\\s*\"(.*?)\"\\s*";
-  // This matches the empty string.
-  regexnoquotesend = "\\s*([^\",\\s]*)\\s*";
-
-
-  first_line = true;
-  colnames.clear();
+  NLOOP_CSVSTATE_CELLSTART = 0,
+  NLOOP_CSVSTATE_UNQUOTED,
+  NLOOP_CSVSTATE_QUOTED,
+  NLOOP_CSVSTATE_QUOTEDQUOTE,
+  NLOOP_CSVSTATE_AFTERQUOTED
+};
 
-  result.clear();
 
-  while (infile.good())
+// Private helper. This starts a new cell, reusing an existing string
+// (and its allocated storage) if one is available.
+
+string *nloop_CSVStartCell_helper(vector<string> &cellvals,
+  size_t &cellcount)
+{
+  if (cellcount < cellvals.size())
+    cellvals[cellcount].clear();
+  else
+    cellvals.push_back("");
+
+  cellcount++;
+
+  return &(cellvals[cellcount - 1]);
+}
+
+
+// Private helper. This is true for whitespace that isn't a line break.
+// This is the same set of characters that "\s" matched, minus CR/LF.
+
+inline bool nloop_CSVIsBlank_helper(int thischar)
+{
+  return ( (' ' == thischar) || ('\t' == thischar)
+    || ('\f' == thischar) || ('\v' == thischar) );
+}
+
+
+
+// This reads one row of cells from a CSV file, skipping blank lines.
+// Whitespace around cells is trimmed. Cell values within quotes have the
+// outermost quotes stripped; doubled quotes within quoted cells become
+// single quotes. Quoted cells may contain commas and line breaks.
+// This returns false if there were no more rows to read.
+
+// NOTE - This is a single-pass state machine that reads directly from the
+// stream buffer. The old regex-based version was quadratic in line length
+// and dominated start-up time for large coefficient files.
+
+bool nloop_ReadCSVRow(istream &infile, vector<string> &cellvals)
+{
+  streambuf *inbuf;
+  int thischar;
+  nloop_csvstate_t state;
+  string *thiscell;
+  size_t cellcount, keeplen;
+  bool have_content, row_done;
+
+
+  inbuf = infile.rdbuf();
+
+  // Bail out if the stream is already unusable.
+  if ( (!infile.good()) || (NULL == inbuf) )
+  {
+    cellvals.clear();
+    return false;
+  }
+
+
+  // Every row starts with one (possibly empty) cell.
+  cellcount = 0;
+  thiscell = nloop_CSVStartCell_helper(cellvals, cellcount);
+  keeplen = 0;
+  state = NLOOP_CSVSTATE_CELLSTART;
+  have_content = false;
+  row_done = false;
+
+  while (!row_done)
   {
-    getline(infile, thisline);
+    thischar = inbuf->sbumpc();
 
-    if (infile.good())
+    if (char_traits<char>::eof() == thischar)
     {
-      // Process this line.
+      // End of input. Finish the row if we have one.
+      infile.setstate(ios::eofbit);
 
-      // Trim delimiters. We can get "\r" at the end reading DOS-format text
-      // under Linux.
-      if (regex_search(thisline, thismatchlist, regexnotnewline))
-        thisline = thismatchlist[1];
-
-      // Proceed if not blank.
-      if (regex_search(thisline, regexnotblank))
+      if (!have_content)
       {
-        // Get this row's cell contents.
-
         cellvals.clear();
+        return false;
+      }
+
+      if (NLOOP_CSVSTATE_UNQUOTED == state)
+        thiscell->resize(keeplen);
+
+      row_done = true;
+    }
+    else if ( ( ('\n' == thischar) || ('\r' == thischar) )
+      && (NLOOP_CSVSTATE_QUOTED != state) )
+    {
+      // End of line (outside of quotes).
+
+      if (NLOOP_CSVSTATE_UNQUOTED == state)
+        thiscell->resize(keeplen);
+
+      if (have_content)
+        row_done = true;
+      else
+      {
+        // Blank line. Discard it and start over.
+        // NOTE - CRLF line endings show up as blank lines after each LF.
+        cellcount = 0;
+        thiscell = nloop_CSVStartCell_helper(cellvals, cellcount);
+        state = NLOOP_CSVSTATE_CELLSTART;
+      }
+    }
+    else
+    {
+      // Ordinary character.
 
-        had_match = true;
-        have_string = true;
+      if (!nloop_CSVIsBlank_helper(thischar))
+        have_content = true;
 
-        while (had_match && have_string)
+      // A quote followed by anything other than a quote closes the cell.
+      if (NLOOP_CSVSTATE_QUOTEDQUOTE == state)
+      {
+        if ('"' == thischar)
         {
-          matchval = "";
+          thiscell->push_back('"');
+          state = NLOOP_CSVSTATE_QUOTED;
+          continue;
+        }
 
-          // Use "match", not "search".
-          // We want the full string to have the specified format.
-          if (regex_match(thisline, thismatchlist, regexquoted))
+        state = NLOOP_CSVSTATE_AFTERQUOTED;
+      }
+
+      switch (state)
+      {
+        case NLOOP_CSVSTATE_CELLSTART:
+          // Skip leading whitespace.
+          if ('"' == thischar)
+            state = NLOOP_CSVSTATE_QUOTED;
+          else if (',' == thischar)
+            thiscell = nloop_CSVStartCell_helper(cellvals, cellcount);
+          else if (!nloop_CSVIsBlank_helper(thischar))
           {
-            matchval = thismatchlist[1];
-            thisline = thismatchlist[2];
+            thiscell->push_back((char) thischar);
+            keeplen = thiscell->size();
+            state = NLOOP_CSVSTATE_UNQUOTED;
           }
-          else if (regex_match(thisline, thismatchlist, regexnoquotes))
+          break;
+
+        case NLOOP_CSVSTATE_UNQUOTED:
+          // Only keep whitespace if something non-blank follows it.
+          if (',' == thischar)
           {
-            matchval = thismatchlist[1];
-            thisline = thismatchlist[2];
+            thiscell->resize(keeplen);
+            thiscell = nloop_CSVStartCell_helper(cellvals, cellcount);
+            state = NLOOP_CSVSTATE_CELLSTART;
           }
-          else if (regex_match(thisline, thismatchlist, regexquotedend))
+          else
           {
-            matchval = thismatchlist[1];
-            thisline = "";
-            have_string = false;
+            thiscell->push_back((char) thischar);
+            if (!nloop_CSVIsBlank_helper(thischar))
+              keeplen = thiscell->size();
           }
-          else if (regex_match(thisline, thismatchlist, regexnoquotesend))
+          break;
+
+        case NLOOP_CSVSTATE_QUOTED:
+          if ('"' == thischar)
+            state = NLOOP_CSVSTATE_QUOTEDQUOTE;
+          else
+            thiscell->push_back((char) thischar);
+          break;
+
+        default:
+          // Assume NLOOP_CSVSTATE_AFTERQUOTED.
+          // Tolerate stray text after the closing quote by keeping it.
+          if (',' == thischar)
           {
-            matchval = thismatchlist[1];
-            thisline = "";
-            have_string = false;
+            thiscell = nloop_CSVStartCell_helper(cellvals, cellcount);
+            state = NLOOP_CSVSTATE_CELLSTART;
           }
-          else
-            // This should only happen on an error condition, as the empty
-            // string will match "no quotes end".
-            had_match = false;
+          else if (!nloop_CSVIsBlank_helper(thischar))
+            thiscell->push_back((char) thischar);
+          break;
+      }
+    }
+  }
 
-          // If we found a cell, add it.
-          if (had_match)
-            cellvals.push_back(matchval);
-        }
+  // Drop any leftover cells from previous (longer) rows.
+  cellvals.resize(cellcount);
 
-        // If this was the first line, use the contents as the column names.
-        // Otherwise treat it as data.
+  return true;
+}
 
-        if (first_line)
-        {
-          // Header row. Store the column names.
-          // Iterate to make sure we're copying by value and not reference.
 
-          colnames.clear();
-          for (cidx = cellvals.begin(); cidx != cellvals.end(); cidx++)
-            colnames.push_back(*cidx);
 
-          first_line = false;
-        }
-        else
-        {
-          // Data row. Store the column cell values.
-          // This will create the column vectors the first time we access
-          // them.
-
-          // Add the cells that we have.
-          // This tolerates rows that are too long or too short.
-          vidx = cellvals.begin();
-          for (cidx = colnames.begin(); cidx != colnames.end(); cidx++)
-          {
-            if (vidx != cellvals.end())
-            {
-              // Store this cell.
-              result[*cidx].push_back(*vidx);
-              vidx++;
-            }
-            else
-            {
-              // Missing cell; store the empty string.
-              result[*cidx].push_back("");
-            }
-          }
-        }
+// This reads all columns from a CSV file, discarding order information.
+// A header line must exist, containing column names.
+// Cell values within quotes have the outermost quotes stripped.
 
+map<string,vector<string>> nloop_ReadCSV(istream &infile)
+{
+  map<string,vector<string>> result;
+  vector<string> colnames, cellvals;
+  vector< vector<string> * > colseries;
+  size_t cidx, colcount;
 
-        // Finished with this row.
-      }
+  result.clear();
+
+
+  // The first row contains the column names.
+  if (!nloop_ReadCSVRow(infile, colnames))
+    return result;
+
+  colcount = colnames.size();
+
+
+  // Subsequent rows contain data.
+  while (nloop_ReadCSVRow(infile, cellvals))
+  {
+    // Look up the column vectors once, on the first data row.
+    // This will create the column vectors, which is what the old version
+    // did too (a header with no data rows produces an empty table).
+    // NOTE - Duplicate column names get two cells per row, as before.
+    if (colseries.empty())
+      for (cidx = 0; cidx < colcount; cidx++)
+        colseries.push_back( &(result[colnames[cidx]]) );
+
+    // Add the cells that we have.
+    // This tolerates rows that are too long or too short.
+    for (cidx = 0; cidx < colcount; cidx++)
+    {
+      if (cidx < cellvals.size())
+        colseries[cidx]->push_back(cellvals[cidx]);
+      else
+        // Missing cell; store the empty string.
+        colseries[cidx]->push_back("");
     }
   }
 
-// FIXME - Diagnostics.
-#if 0
-{
-map<string,vector<string>>::iterator tidx;
-vector<string> thiscolumn;
-vector<string>::iterator ridx;
-cout << "== Table columns:\n";
-for (tidx = result.begin(); tidx != result.end(); tidx++)
-{
-  cout << "-- Column \"" << (tidx->first) << "\":\n";
-  thiscolumn = tidx->second;
-  for (ridx = thiscolumn.begin(); ridx != thiscolumn.end(); ridx++)
-    cout << ".. \"" << (*ridx) << "\"\n";
-}
-cout << "== End of table columns.\n";
-}
-#endif
-
   return result;
 }
 
 
 
 // This writes data series to a CSV file using the specified column order.
+// Nonexistent cells are written as empty cells.
 
 void nloop_WriteCSV(ostream &outfile, list<string> colnames,
   map<string,vector<string>> &dataseries, bool want_header)
 {
+  nloop_CSVWriter_t writer;
   list<string>::iterator cidx;
-  map<string,string> thisrow;
-  bool is_first;
-  string thiskey;
-  size_t row_count, ridx;
+  vector<vector<string> *> colseries;
+  size_t row_count, ridx, sidx;
 
-  // Write the column labels.
-  if (want_header)
+  writer.Start(outfile, colnames, want_header);
+
+  // Look up each column's series once, rather than once per row.
+  // Columns with no data series get NULL.
+  for (cidx = colnames.begin(); colnames.end() != cidx; cidx++)
   {
-    is_first = true;
-    for (cidx = colnames.begin(); colnames.end() != cidx; cidx++)
-    {
-      if (!is_first)
-        outfile << ',';
-      is_first = false;
-      outfile << '"' << (*cidx) << '"';
-    }
-    outfile << "\r\n";
+    if (dataseries.count(*cidx))
+      colseries.push_back( &(dataseries[*cidx]) );
+    else
+      colseries.push_back(NULL);
   }
 
   // Get the number of rows (maximum across all columns).
   row_count = nloop_GetCSVRowCount(dataseries);
 
   // Write data series.
-  // Nonexistent cells contain "".
   for (ridx = 0; ridx < row_count; ridx++)
   {
-    thisrow = nloop_GetCSVRowCells(dataseries, ridx);
-
-    is_first = true;
-    for (cidx = colnames.begin(); colnames.end() != cidx; cidx++)
+    for (sidx = 0; sidx < colseries.size(); sidx++)
     {
-      if (!is_first)
-        outfile << ',';
-      is_first = false;
-      thiskey = *cidx;
-      if (thisrow.count(thiskey))
-        outfile << thisrow[thiskey];
+      if ( (NULL != colseries[sidx]) && (ridx < colseries[sidx]->size()) )
+        writer.AddText( (*(colseries[sidx]))[ridx] );
+      else
+        writer.AddEmpty();
     }
-    outfile << "\r\n";
+
+    writer.EndRow();
   }
 }
 
@@ -370,5 +531,727 @@ map<string,string> nloop_GetCSVRowCells(
 
 
 
+//
+// Indexed CSV Table
+
+// This holds all rows of a CSV file, parsed once. Criteria columns are
+// indexed on first use, so that subsets of a multi-set file can be
+// selected without scanning every row.
+
+
+// Constructor.
+
+nloop_CSVTable_t::nloop_CSVTable_t(void)
+{
+  Clear();
+}
+
+
+
+// This reads an entire CSV file. It returns false if there was no header.
+// Any previous contents are discarded.
+
+bool nloop_CSVTable_t::ReadTable(istream &infile)
+{
+  vector<string> thisrow;
+
+  Clear();
+
+  if (!nloop_ReadCSVRow(infile, colnames))
+    return false;
+
+  while (nloop_ReadCSVRow(infile, thisrow))
+  {
+    // Swapping avoids copying the cell strings.
+    rows.push_back( vector<string>() );
+    rows.back().swap(thisrow);
+  }
+
+  return true;
+}
+
+
+
+// This discards all table contents and indices.
+
+void nloop_CSVTable_t::Clear(void)
+{
+  colnames.clear();
+  rows.clear();
+  colindices.clear();
+}
+
+
+
+// Accessors.
+
+vector<string> &nloop_CSVTable_t::GetColumnNames(void)
+{
+  return colnames;
+}
+
+
+// This returns -1 if the column doesn't exist.
+// If a name is duplicated, the first instance is returned.
+
+int nloop_CSVTable_t::FindColumn(string colname)
+{
+  size_t cidx;
+
+  for (cidx = 0; cidx < colnames.size(); cidx++)
+    if (colnames[cidx] == colname)
+      return (int) cidx;
+
+  return -1;
+}
+
+
+size_t nloop_CSVTable_t::GetRowCount(void)
+{
+  return rows.size();
+}
+
+
+// NOTE - No bounds checking. Rows may be shorter than the header.
+
+vector<string> &nloop_CSVTable_t::GetRow(size_t ridx)
+{
+  return rows[ridx];
+}
+
+
+
+// This returns the value index for a column, building it if needed.
+// Cells past the end of short rows are indexed as "".
+
+map< string, vector<size_t> > &nloop_CSVTable_t::GetColumnIndex(int cellidx)
+{
+  size_t ridx;
+  string blankcell;
+
+  if (!colindices.count(cellidx))
+  {
+    map< string, vector<size_t> > &newindex = colindices[cellidx];
+
+    // Rows are visited in order, so each row list ends up sorted.
+    for (ridx = 0; ridx < rows.size(); ridx++)
+    {
+      if (((size_t) cellidx) < rows[ridx].size())
+        newindex[ rows[ridx][cellidx] ].push_back(ridx);
+      else
+        newindex[blankcell].push_back(ridx);
+    }
+  }
+
+  return colindices[cellidx];
+}
+
+
+
+// This returns the distinct values in a column, in sorted order.
+
+void nloop_CSVTable_t::GetColumnValues(string colname, vector<string> &values)
+{
+  map< string, vector<size_t> >::iterator vidx;
+  int cellidx;
+
+  values.clear();
+
+  cellidx = FindColumn(colname);
+  if (cellidx < 0)
+    return;
+
+  map< string, vector<size_t> > &thisindex = GetColumnIndex(cellidx);
+
+  for (vidx = thisindex.begin(); thisindex.end() != vidx; vidx++)
+    values.push_back(vidx->first);
+}
+
+
+
+// This returns the indices of rows matching all of the specified criteria,
+// in ascending order. An empty criteria list matches all rows.
+// Match criteria are (column name, cell value) tuples. Tuples with the
+// same column name are alternatives; any one of them satisfies that
+// criterion.
+
+void nloop_CSVTable_t::SelectRows( multimap<string,string> &matchcriteria,
+  vector<size_t> &rowlist )
+{
+  multimap<string,string>::iterator midx;
+  map< string, vector<size_t> >::iterator iidx;
+  vector<int> keycells;
+  vector< vector<string> > keyvalues;
+  vector<size_t> candidates;
+  size_t kidx, vidx, ridx, thiscount, bestcount, bestkey;
+  bool row_ok, criterion_ok;
+  string prevkey, blankcell;
+
+  rowlist.clear();
+
+
+  // An empty criteria list selects everything.
+
+  if (matchcriteria.empty())
+  {
+    for (ridx = 0; ridx < rows.size(); ridx++)
+      rowlist.push_back(ridx);
+    return;
+  }
+
+
+  // Group criteria by column. A missing column never matches.
+
+  for (midx = matchcriteria.begin(); matchcriteria.end() != midx; midx++)
+  {
+    if ( keycells.empty() || (midx->first != prevkey) )
+    {
+      prevkey = midx->first;
+      keycells.push_back( FindColumn(prevkey) );
+      keyvalues.push_back( vector<string>() );
+
+      if (keycells.back() < 0)
+        return;
+    }
+
+    keyvalues.back().push_back(midx->second);
+  }
+
+
+  // Pick the most selective criterion, using the column indices.
+
+  bestkey = 0;
+  bestcount = rows.size() + 1;
+
+  for (kidx = 0; kidx < keycells.size(); kidx++)
+  {
+    map< string, vector<size_t> > &thisindex =
+      GetColumnIndex(keycells[kidx]);
+
+    thiscount = 0;
+    for (vidx = 0; vidx < keyvalues[kidx].size(); vidx++)
+    {
+      iidx = thisindex.find(keyvalues[kidx][vidx]);
+      if (thisindex.end() != iidx)
+        thiscount += iidx->second.size();
+    }
+
+    if (thiscount < bestcount)
+    {
+      bestcount = thiscount;
+      bestkey = kidx;
+    }
+  }
+
+
+  // Get that criterion's rows.
+  // If it has several alternative values, merge their row lists.
+
+  {
+    map< string, vector<size_t> > &thisindex =
+      GetColumnIndex(keycells[bestkey]);
+
+    for (vidx = 0; vidx < keyvalues[bestkey].size(); vidx++)
+    {
+      iidx = thisindex.find(keyvalues[bestkey][vidx]);
+      if (thisindex.end() != iidx)
+        candidates.insert( candidates.end(),
+          iidx->second.begin(), iidx->second.end() );
+    }
+
+    if (keyvalues[bestkey].size() > 1)
+    {
+      sort(candidates.begin(), candidates.end());
+      candidates.erase( unique(candidates.begin(), candidates.end()),
+        candidates.end() );
+    }
+  }
+
+
+  // Check the remaining criteria against the candidates' cells directly.
+
+  for (ridx = 0; ridx < candidates.size(); ridx++)
+  {
+    vector<string> &thisrow = rows[ candidates[ridx] ];
+
+    row_ok = true;
+    for (kidx = 0; row_ok && (kidx < keycells.size()); kidx++)
+      if (kidx != bestkey)
+      {
+        const string &thiscell =
+          ( ((size_t) keycells[kidx]) < thisrow.size() )
+          ? thisrow[ keycells[kidx] ] : blankcell;
+
+        criterion_ok = false;
+        for (vidx = 0; vidx < keyvalues[kidx].size(); vidx++)
+          if (keyvalues[kidx][vidx] == thiscell)
+            criterion_ok = true;
+
+        row_ok = criterion_ok;
+      }
+
+    if (row_ok)
+      rowlist.push_back(candidates[ridx]);
+  }
+}
+
+
+
+//
+// Typed CSV Column Reader
+
+// This streams rows from a CSV file without building a table. Column names
+// are resolved to cell indices once (from the header row), match criteria
+// are checked by index as each row is read, and the selected columns are
+// parsed directly into a caller-supplied integer array.
+// A reader attached to an nloop_CSVTable_t uses the table's index instead.
+
+
+// Constructor.
+
+nloop_CSVIntegerReader_t::nloop_CSVIntegerReader_t(void)
+{
+  instream = NULL;
+
+  intable = NULL;
+  table_rows.clear();
+  table_rowptr = 0;
+
+  row_bad_cells = 0;
+  bad_cells = 0;
+
+  colnames.clear();
+  cellvals.clear();
+  selected_cells.clear();
+  criteria_cells.clear();
+  criteria_values.clear();
+}
+
+
+
+// This reads the header row. It returns false if there wasn't one.
+// Column selection, criteria, and the bad cell count are reset.
+
+bool nloop_CSVIntegerReader_t::ReadHeader(istream &infile)
+{
+  instream = &infile;
+  intable = NULL;
+
+  row_bad_cells = 0;
+  bad_cells = 0;
+
+  selected_cells.clear();
+  criteria_cells.clear();
+  criteria_values.clear();
+
+  return nloop_ReadCSVRow(infile, colnames);
+}
+
+
+
+// This reads rows from a table instead of from a stream.
+// Column selection, criteria, and the bad cell count are reset, so all
+// rows are selected.
+
+void nloop_CSVIntegerReader_t::AttachTable(nloop_CSVTable_t &new_table)
+{
+  multimap<string,string> nocriteria;
+
+  instream = NULL;
+  intable = &new_table;
+
+  // Copying the header is cheap compared to reading the file.
+  colnames = intable->GetColumnNames();
+
+  row_bad_cells = 0;
+  bad_cells = 0;
+
+  selected_cells.clear();
+  criteria_cells.clear();
+  criteria_values.clear();
+
+  intable->SelectRows(nocriteria, table_rows);
+  table_rowptr = 0;
+}
+
+
+
+// Header accessors.
+
+vector<string> &nloop_CSVIntegerReader_t::GetColumnNames(void)
+{
+  return colnames;
+}
+
+
+// This returns -1 if the column doesn't exist.
+// If a name is duplicated, the first instance is returned.
+
+int nloop_CSVIntegerReader_t::FindColumn(string colname)
+{
+  size_t cidx;
+
+  for (cidx = 0; cidx < colnames.size(); cidx++)
+    if (colnames[cidx] == colname)
+      return (int) cidx;
+
+  return -1;
+}
+
+
+
+// This chooses the columns that ReadRow() parses, in the order given.
+
+void nloop_CSVIntegerReader_t::SelectColumns(vector<string> &new_colnames)
+{
+  size_t nidx;
+
+  selected_cells.clear();
+
+  for (nidx = 0; nidx < new_colnames.size(); nidx++)
+    selected_cells.push_back( FindColumn(new_colnames[nidx]) );
+}
+
+
+
+// If match criteria are supplied, only rows that match all of the
+// specified criteria are returned.
+// Match criteria are (column name, cell value) tuples.
+
+void nloop_CSVIntegerReader_t::SetCriteria(
+  multimap<string,string> &matchcriteria)
+{
+  multimap<string,string>::iterator midx;
+  string prevkey;
+
+  criteria_cells.clear();
+  criteria_values.clear();
+
+  // If we're reading from a table, let its index pick the rows.
+  // The per-row criteria lists stay empty.
+  if (NULL != intable)
+  {
+    intable->SelectRows(matchcriteria, table_rows);
+    table_rowptr = 0;
+    return;
+  }
+
+  // Tuples with the same key are adjacent, and any one of their values
+  // satisfies that criterion.
+  for (midx = matchcriteria.begin(); matchcriteria.end() != midx; midx++)
+  {
+    if ( criteria_cells.empty() || (midx->first != prevkey) )
+    {
+      prevkey = midx->first;
+      criteria_cells.push_back( FindColumn(prevkey) );
+      criteria_values.push_back( vector<string>() );
+    }
+
+    criteria_values.back().push_back(midx->second);
+  }
+}
+
+
+
+// This parses the selected columns of a row into "values", and flags
+// non-blank cells in "present" if it isn't NULL.
+// Missing cells give 0. Cells that aren't valid integers also give 0, and
+// are counted as bad cells. Blank cells are only counted as bad if the
+// caller isn't being told about them via "present".
+
+void nloop_CSVIntegerReader_t::ParseSelectedCells(vector<string> &thisrow,
+  long long *values, vector<bool> *present)
+{
+  size_t kidx, cellcount;
+  int cellidx;
+  bool is_present;
+
+  cellcount = thisrow.size();
+  for (kidx = 0; kidx < selected_cells.size(); kidx++)
+  {
+    cellidx = selected_cells[kidx];
+
+    values[kidx] = 0;
+    is_present = ( (cellidx >= 0) && (((size_t) cellidx) < cellcount) );
+    if ( is_present && (NULL != present) )
+      is_present = !nloop_CSVCellIsBlank(thisrow[cellidx]);
+
+    if (is_present)
+      if (!nloop_CSVCellToLL(thisrow[cellidx], values[kidx]))
+        row_bad_cells++;
+
+    if (NULL != present)
+      (*present)[kidx] = is_present;
+  }
+
+  bad_cells += row_bad_cells;
+}
+
+
+
+// This reads the next row that matches the criteria and parses the
+// selected columns into "values", which must have one element per
+// selected column. Missing cells parse as 0. Cells that are present but
+// aren't valid integers also give 0, and are counted as bad cells.
+// If "present" is supplied, it must also have one element per selected
+// column. Each is set for cells that are there and aren't blank. Blank
+// cells are then treated as missing rather than bad.
+// This returns false if there were no more matching rows.
+
+bool nloop_CSVIntegerReader_t::ReadRow(long long *values)
+{
+  return ReadRow_helper(values, NULL);
+}
+
+
+
+bool nloop_CSVIntegerReader_t::ReadRow(long long *values,
+  vector<bool> &present)
+{
+  return ReadRow_helper(values, &present);
+}
+
+
+
+// Private implementation.
+
+bool nloop_CSVIntegerReader_t::ReadRow_helper(long long *values,
+  vector<bool> *present)
+{
+  size_t kidx, vidx, cellcount;
+  int cellidx;
+  bool row_ok, criterion_ok;
+  string blankcell;
+
+  row_bad_cells = 0;
+
+  // Table rows have already been filtered.
+  if (NULL != intable)
+  {
+    if (table_rowptr >= table_rows.size())
+      return false;
+
+    vector<string> &thisrow = intable->GetRow( table_rows[table_rowptr] );
+    table_rowptr++;
+
+    ParseSelectedCells(thisrow, values, present);
+
+    return true;
+  }
+
+  if (NULL == instream)
+    return false;
+
+  while (nloop_ReadCSVRow(*instream, cellvals))
+  {
+    cellcount = cellvals.size();
+
+    // Check match criteria.
+    // Cells past the end of a short row are treated as "".
+
+    row_ok = true;
+    for (kidx = 0; row_ok && (kidx < criteria_cells.size()); kidx++)
+    {
+      cellidx = criteria_cells[kidx];
+      criterion_ok = false;
+
+      if (cellidx >= 0)
+      {
+        const string &thiscell =
+          ( ((size_t) cellidx) < cellcount ) ? cellvals[cellidx] : blankcell;
+
+        for (vidx = 0; vidx < criteria_values[kidx].size(); vidx++)
+          if (criteria_values[kidx][vidx] == thiscell)
+            criterion_ok = true;
+      }
+
+      row_ok = criterion_ok;
+    }
+
+
+    // If this row matches, parse the selected cells.
+
+    if (row_ok)
+    {
+      ParseSelectedCells(cellvals, values, present);
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+
+// Bad cell accessors.
+// A bad cell is one that's present but isn't a valid integer.
+
+size_t nloop_CSVIntegerReader_t::GetRowBadCellCount(void)
+{
+  return row_bad_cells;
+}
+
+
+size_t nloop_CSVIntegerReader_t::GetBadCellCount(void)
+{
+  return bad_cells;
+}
+
+
+
+
+//
+// Streaming CSV Writer
+
+// This writes one row at a time with a fixed column order. Integers are
+// formatted directly into a reusable row buffer.
+
+
+// Constructor.
+
+nloop_CSVWriter_t::nloop_CSVWriter_t(void)
+{
+  outstream = NULL;
+  colcount = 0;
+  rowbuf.clear();
+  cells_in_row = 0;
+}
+
+
+
+// This attaches an output stream and sets the column count, and writes
+// a header row if requested. Column names are quoted.
+
+void nloop_CSVWriter_t::Start(ostream &outfile, vector<string> &colnames,
+  bool want_header)
+{
+  size_t cidx;
+
+  outstream = &outfile;
+  colcount = colnames.size();
+
+  rowbuf.clear();
+  cells_in_row = 0;
+
+  if (want_header)
+  {
+    for (cidx = 0; cidx < colcount; cidx++)
+    {
+      if (0 < cidx)
+        rowbuf += ',';
+      rowbuf += '"';
+      rowbuf += colnames[cidx];
+      rowbuf += '"';
+    }
+
+    // Don't let EndRow() pad this.
+    cells_in_row = colcount;
+    EndRow();
+  }
+}
+
+
+
+void nloop_CSVWriter_t::Start(ostream &outfile, list<string> &colnames,
+  bool want_header)
+{
+  vector<string> scratch;
+
+  scratch.assign(colnames.begin(), colnames.end());
+  Start(outfile, scratch, want_header);
+}
+
+
+
+// This appends an integer cell to the current row.
+// NOTE - This replaces "to_string()", which allocates a string per cell.
+
+void nloop_CSVWriter_t::AddInteger(long long value)
+{
+  char digits[24];
+  unsigned long long magnitude;
+  int didx;
+
+  if (0 < cells_in_row)
+    rowbuf += ',';
+  cells_in_row++;
+
+  // Work in unsigned so that LLONG_MIN doesn't overflow.
+  magnitude = (unsigned long long) value;
+  if (value < 0)
+  {
+    rowbuf += '-';
+    magnitude = (~magnitude) + 1;
+  }
+
+  // Digits come out least-significant first.
+  didx = 0;
+  do
+  {
+    digits[didx] = '0' + (char) (magnitude % 10);
+    magnitude /= 10;
+    didx++;
+  }
+  while (0 < magnitude);
+
+  while (0 < didx)
+  {
+    didx--;
+    rowbuf += digits[didx];
+  }
+}
+
+
+
+// This appends a text cell to the current row, as-is.
+
+void nloop_CSVWriter_t::AddText(const string &value)
+{
+  if (0 < cells_in_row)
+    rowbuf += ',';
+  cells_in_row++;
+
+  rowbuf += value;
+}
+
+
+
+void nloop_CSVWriter_t::AddEmpty(void)
+{
+  if (0 < cells_in_row)
+    rowbuf += ',';
+  cells_in_row++;
+}
+
+
+
+// This writes the current row. Missing cells are left empty.
+
+void nloop_CSVWriter_t::EndRow(void)
+{
+  while (cells_in_row < colcount)
+    AddEmpty();
+
+  rowbuf += "\r\n";
+
+  if (NULL != outstream)
+    outstream->write(rowbuf.data(), rowbuf.size());
+
+  // This keeps the buffer's capacity.
+  rowbuf.clear();
+  cells_in_row = 0;
+}
+
+
+
+// This returns false if the stream has reported an error.
+
+bool nloop_CSVWriter_t::IsOk(void)
+{
+  return ( (NULL != outstream) && outstream->good() );
+}
+
+
 //
 // This is the end of the file.
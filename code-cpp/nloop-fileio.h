@@ -17,6 +17,180 @@
 // file streams.
 
 
+//
+// Classes
+
+
+// Indexed CSV table.
+// This holds all rows of a CSV file, parsed once. Criteria columns are
+// indexed on first use, mapping each cell value to the list of rows that
+// contain it, so that subsets of a multi-set file (e.g. one "type"/"set"
+// combination) can be selected in time proportional to the match count.
+
+class nloop_CSVTable_t
+{
+protected:
+  vector<string> colnames;
+  vector< vector<string> > rows;
+
+  // Per-column value indices, keyed by cell index and built on demand.
+  // Row lists are in ascending order.
+  map< int, map< string, vector<size_t> > > colindices;
+
+  // This returns the value index for a column, building it if needed.
+  map< string, vector<size_t> > &GetColumnIndex(int cellidx);
+
+public:
+  nloop_CSVTable_t(void);
+  // Default destructor is fine.
+
+  // This reads an entire CSV file. It returns false if there was no header.
+  // Any previous contents are discarded.
+  bool ReadTable(istream &infile);
+
+  void Clear(void);
+
+  // Accessors.
+  // Rows may be shorter or longer than the header; missing cells are "".
+  vector<string> &GetColumnNames(void);
+  // This returns -1 if the column doesn't exist.
+  int FindColumn(string colname);
+  size_t GetRowCount(void);
+  vector<string> &GetRow(size_t ridx);
+
+  // This returns the distinct values in a column, in sorted order.
+  // This is useful for loading every set that a file contains.
+  void GetColumnValues(string colname, vector<string> &values);
+
+  // This returns the indices of rows matching all of the specified
+  // criteria, in ascending order. An empty criteria list matches all rows.
+  // Match criteria are (column name, cell value) tuples.
+  void SelectRows( multimap<string,string> &matchcriteria,
+    vector<size_t> &rowlist );
+};
+
+
+// Typed CSV column reader.
+// This streams rows from a CSV file without building a table. Column names
+// are resolved to cell indices once (from the header row), match criteria
+// are checked by index as each row is read, and the selected columns are
+// parsed directly into a caller-supplied integer array.
+// A reader can also be attached to an nloop_CSVTable_t, in which case the
+// table's index is used to visit only matching rows.
+
+class nloop_CSVIntegerReader_t
+{
+protected:
+  istream *instream;
+
+  // Table source, and the matching rows still to be visited.
+  nloop_CSVTable_t *intable;
+  vector<size_t> table_rows;
+  size_t table_rowptr;
+
+  // Header and scratch row. The scratch row's strings are reused.
+  vector<string> colnames;
+  vector<string> cellvals;
+
+  // Cell indices of the selected columns (-1 if a column is missing).
+  vector<int> selected_cells;
+
+  // Match criteria, resolved to cell indices. A criterion with a missing
+  // column never matches, as with nloop_CSVRowMatchesAllCriteria().
+  vector<int> criteria_cells;
+  vector< vector<string> > criteria_values;
+
+  // Cells that were present but weren't valid integers.
+  size_t row_bad_cells;
+  size_t bad_cells;
+
+  // These parse the next matching row, or the selected cells of one row.
+  // "present" may be NULL.
+  bool ReadRow_helper(long long *values, vector<bool> *present);
+  void ParseSelectedCells(vector<string> &thisrow,
+    long long *values, vector<bool> *present);
+
+public:
+  nloop_CSVIntegerReader_t(void);
+  // Default destructor is fine.
+
+  // This reads the header row. It returns false if there wasn't one.
+  // Column selection, criteria, and the bad cell count are reset.
+  bool ReadHeader(istream &infile);
+
+  // This reads rows from a table instead of from a stream.
+  // Column selection, criteria, and the bad cell count are reset.
+  void AttachTable(nloop_CSVTable_t &new_table);
+
+  // Header accessors.
+  vector<string> &GetColumnNames(void);
+  // This returns -1 if the column doesn't exist.
+  int FindColumn(string colname);
+
+  // This chooses the columns that ReadRow() parses, in the order given.
+  void SelectColumns(vector<string> &new_colnames);
+
+  // If match criteria are supplied, only rows that match all of the
+  // specified criteria are returned.
+  // Match criteria are (column name, cell value) tuples.
+  void SetCriteria(multimap<string,string> &matchcriteria);
+
+  // This reads the next row that matches the criteria and parses the
+  // selected columns into "values", which must have one element per
+  // selected column. Missing cells parse as 0. Cells that are present but
+  // aren't valid integers also give 0, and are counted as bad cells.
+  // If "present" is supplied, it must also have one element per selected
+  // column. Each is set for cells that are there and aren't blank. Blank
+  // cells are then treated as missing rather than bad.
+  // This returns false if there were no more matching rows.
+  bool ReadRow(long long *values);
+  bool ReadRow(long long *values, vector<bool> &present);
+
+  // Bad cell counts for the most recent row, and since the header was read
+  // or the table was attached.
+  size_t GetRowBadCellCount(void);
+  size_t GetBadCellCount(void);
+};
+
+
+// Streaming CSV writer.
+// This writes one row at a time with a fixed column order. Integers are
+// formatted directly into a reusable row buffer, so memory use doesn't
+// depend on the number of rows written.
+
+class nloop_CSVWriter_t
+{
+protected:
+  ostream *outstream;
+  size_t colcount;
+
+  // Row under construction. Its capacity is reused from row to row.
+  string rowbuf;
+  size_t cells_in_row;
+
+public:
+  nloop_CSVWriter_t(void);
+  // Default destructor is fine.
+
+  // This attaches an output stream and sets the column count, and writes
+  // a header row if requested. Column names are quoted.
+  void Start(ostream &outfile, vector<string> &colnames, bool want_header);
+  void Start(ostream &outfile, list<string> &colnames, bool want_header);
+
+  // These append a cell to the current row. Text is written as-is.
+  void AddInteger(long long value);
+  void AddText(const string &value);
+  void AddEmpty(void);
+
+  // This writes the current row. Missing cells are left empty.
+  void EndRow(void);
+
+  // This returns false if the stream has reported an error.
+  bool IsOk(void);
+};
+
+
+
 //
 // Functions
 
@@ -30,6 +204,16 @@ template<class samptype_t> long long nloop_SampleToLL(samptype_t data);
 // This converts signed long long to samptype_t appropriately.
 template<class samptype_t> samptype_t nloop_LLToSample(long long data);
 
+// This converts a CSV cell to signed long long, without throwing.
+// Whitespace around the number is skipped. Empty cells, cells with
+// anything other than an optionally signed decimal integer, and values
+// outside the signed long long range are rejected.
+// This returns false (and sets "value" to 0) if the cell was rejected.
+bool nloop_CSVCellToLL(const string &cellval, long long &value);
+
+// This checks whether a CSV cell is empty or holds only whitespace.
+bool nloop_CSVCellIsBlank(const string &cellval);
+
 // These check a row's contents against match criteria.
 // Match criteria are (column name, cell value) tuples.
 // An empty criteria list always matches.
@@ -41,12 +225,20 @@ bool nloop_CSVRowMatchesAllCriteria( map<string,string> &thisrow,
 
 // CSV I/O functions.
 
+// This reads one row of cells from a CSV file, skipping blank lines.
+// Whitespace around cells is trimmed. Cell values within quotes have the
+// outermost quotes stripped; doubled quotes within quoted cells become
+// single quotes. Quoted cells may contain commas and line breaks.
+// This returns false if there were no more rows to read.
+bool nloop_ReadCSVRow(istream &infile, vector<string> &cellvals);
+
 // This reads all columns from a CSV file, discarding order information.
 // A header line must exist, containing column names.
 // Cell values within quotes have the outermost quotes stripped.
 map<string,vector<string>> nloop_ReadCSV(istream &infile);
 
 // This writes data series to a CSV file using the specified column order.
+// Nonexistent cells are written as empty cells.
 void nloop_WriteCSV(ostream &outfile, list<string> colnames,
   map<string,vector<string>> &dataseries, bool want_header);
 
@@ -69,18 +261,27 @@ map<string,string> nloop_GetCSVRowCells(
 // CSV biquad coefficients may be negative even with unsigned samptype_t.
 
 // Reading.
+// These return false if there was no header row or if any matching row
+// had a malformed cell. Rows with malformed cells are skipped.
 
 // Treat all table rows as applying to this filter.
 // Don't remap bank numbers.
 template<class samptype_t, class filtbanktype_t>
-void nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank);
+bool nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank);
 
 // If match criteria are supplied, only table rows that match all of the
 // specified criteria are used.
 // Match criteria are (column name, cell value) tuples.
 // Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
 template<class samptype_t, class filtbanktype_t>
-void nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank,
+bool nloop_ReadBiquadCoeffs(istream &infile, filtbanktype_t &filtbank,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap);
+
+// As above, but reading from a pre-parsed table. Use this to load several
+// filter sets from one file without re-parsing it.
+template<class samptype_t, class filtbanktype_t>
+bool nloop_ReadBiquadCoeffs(nloop_CSVTable_t &intable,
+  filtbanktype_t &filtbank,
   multimap<string,string> &matchcriteria, map<int,int> &bankremap);
 
 // Writing.
@@ -108,18 +309,30 @@ void nloop_WriteBiquadCoeffs(ostream &outfile, filtbanktype_t &filtbank,
 // CSV FIR coefficients may be negative even with unsigned samptype_t.
 
 // Reading.
+// These return false if there was no header row or if any matching row
+// had a malformed cell. Malformed cells are read as 0, so that later
+// coefficients keep their positions.
 
 // Treat all table rows as applying to this filter.
 // Don't remap bank numbers.
+// "fracbits" is the fixed-point bit count; it isn't stored in the file.
 template<class samptype_t, class indextype_t, class filtbanktype_t>
-void nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank);
+bool nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
+  uint8_t fracbits);
 
 // If match criteria are supplied, only table rows that match all of the
 // specified criteria are used.
 // Match criteria are (column name, cell value) tuples.
 // Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
 template<class samptype_t, class indextype_t, class filtbanktype_t>
-void nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
+bool nloop_ReadFIRCoeffs(istream &infile, filtbanktype_t &filtbank,
+  uint8_t fracbits,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap);
+
+// As above, but reading from a pre-parsed table.
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+bool nloop_ReadFIRCoeffs(nloop_CSVTable_t &intable, filtbanktype_t &filtbank,
+  uint8_t fracbits,
   multimap<string,string> &matchcriteria, map<int,int> &bankremap);
 
 // Writing.
@@ -149,11 +362,13 @@ void nloop_WriteFIRCoeffs(ostream &outfile, filtbanktype_t &filtbank,
 // See LUTVALUES.txt for file format information.
 
 // Reading.
+// These return false if there was no header row or if any matching row
+// had a malformed cell. Rows with malformed cells are skipped.
 
 // Reading a single lookup table.
 // Treat all CSV rows as being part of this lookup table.
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
   string infield, string outfield );
 
 // Reading a single lookup table.
@@ -161,14 +376,19 @@ void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
 // specified criteria are used.
 // Match criteria are (column name, cell value) tuples.
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTableSingle( istream &infile, luttype_t &lut,
+  string infield, string outfield, multimap<string,string> &matchcriteria );
+
+// As above, but reading from a pre-parsed table.
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTableSingle( nloop_CSVTable_t &intable, luttype_t &lut,
   string infield, string outfield, multimap<string,string> &matchcriteria );
 
 // Reading a class with per-bank lookup tables.
 // Treat all CSV rows as being part of this lookup table.
 // Don't remap bank numbers.
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
   string infield, string outfield );
 
 // Reading a class with per-bank lookup tables.
@@ -177,7 +397,13 @@ void nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
 // Match criteria are (column name, cell value) tuples.
 // Bank numbers in the remap table are remapped ( k -> bankremap[k] ).
 template <class intype_t, class outtype_t, class luttype_t>
-void nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
+bool nloop_ReadLookupTablePerBank( istream &infile, luttype_t &lut,
+  string infield, string outfield,
+  multimap<string,string> &matchcriteria, map<int,int> &bankremap );
+
+// As above, but reading from a pre-parsed table.
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTablePerBank( nloop_CSVTable_t &intable, luttype_t &lut,
   string infield, string outfield,
   multimap<string,string> &matchcriteria, map<int,int> &bankremap );
 
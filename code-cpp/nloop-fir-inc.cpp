@@ -17,8 +17,10 @@
 
 // Constructor.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 nloop_FIRFilter_t(void)
 {
   BlankCoefficients();
@@ -29,20 +31,24 @@ nloop_FIRFilter_t(void)
 // Process a linear buffer.
 // NOTE - Elements [0]..[n-1] are read. y[0] is returned.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-samptype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+samptype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 ApplyFIROnceLinear(samptype_t *inbuf)
 {
-  samptype_t running_total;
+  accumtype_t running_total;
   indextype_t cidx;
 
   running_total = 0;
   for (cidx = 0; cidx < coeffcount; cidx++)
-    running_total += inbuf[cidx] * coeffs[cidx];
+    running_total += ((accumtype_t) inbuf[cidx])
+      * ((accumtype_t) coeffs[cidx]);
 
   NLOOP_ARITHSHR(running_total, fracbits);
 
-  return running_total;
+  // Only the result is narrowed.
+  return (samptype_t) running_total;
 }
 
 
@@ -52,33 +58,39 @@ ApplyFIROnceLinear(samptype_t *inbuf)
 // wrapping. Elements [0]..[n-1] (modulo buffer length) are read.
 // y[0] is returned.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-samptype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+samptype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 ApplyFIROnceCircular(
   samptype_t *inbuf, indextype_t inptr, indextype_t inbufmask)
 {
-  samptype_t running_total;
+  accumtype_t running_total;
   indextype_t cidx;
 
   running_total = 0;
   for (cidx = 0; cidx < coeffcount; cidx++)
   {
     inptr &= inbufmask;
-    running_total += inbuf[inptr] * coeffs[cidx];
+    running_total += ((accumtype_t) inbuf[inptr])
+      * ((accumtype_t) coeffs[cidx]);
     inptr++;
   }
 
   NLOOP_ARITHSHR(running_total, fracbits);
 
-  return running_total;
+  // Only the result is narrowed.
+  return (samptype_t) running_total;
 }
 
 
 
 // Blanking accessor.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 BlankCoefficients(void)
 {
   indextype_t cidx;
@@ -94,8 +106,10 @@ BlankCoefficients(void)
 
 // Fixed-point bit depth configuration.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 SetFracBits(uint8_t newbits)
 {
   fracbits = newbits;
@@ -105,8 +119,10 @@ SetFracBits(uint8_t newbits)
 
 // Fixed-point bit depth accessor.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-uint8_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+uint8_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 GetFracBits(void)
 {
   return fracbits;
@@ -116,8 +132,10 @@ GetFracBits(void)
 
 // Coefficient count configuration.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 SetCoeffCount(indextype_t newcount)
 {
   if (newcount < 0)
@@ -132,8 +150,10 @@ SetCoeffCount(indextype_t newcount)
 
 // Coefficient count accessor.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-indextype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+indextype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 GetCoeffCount(void)
 {
   return coeffcount;
@@ -143,8 +163,10 @@ GetCoeffCount(void)
 
 // Coefficient accessors.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 SetOneCoefficient(indextype_t coeffidx, samptype_t coeffval)
 {
   if ( (coeffidx >= 0) && (coeffidx < maxcoeffs) )
@@ -153,8 +175,10 @@ SetOneCoefficient(indextype_t coeffidx, samptype_t coeffval)
 
 
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-samptype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+samptype_t nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 GetOneCoefficient(indextype_t coeffidx)
 {
   samptype_t result;
@@ -169,8 +193,21 @@ GetOneCoefficient(indextype_t coeffidx)
 
 
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+samptype_t *nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
+GetCoefficientArray(void)
+{
+  return coeffs;
+}
+
+
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 SetAllCoefficients(uint8_t newbits, indextype_t newcoeffcount,
   nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &newcoeffs)
 {
@@ -187,8 +224,10 @@ SetAllCoefficients(uint8_t newbits, indextype_t newcoeffcount,
 
 
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
-void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs>::
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t>
+void nloop_FIRFilter_t<samptype_t, indextype_t, maxcoeffs,
+  accumtype_t>::
 GetAllCoefficients(uint8_t &oldbits, indextype_t &oldcoeffcount,
   nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &oldcoeffs)
 {
@@ -212,9 +251,10 @@ GetAllCoefficients(uint8_t &oldbits, indextype_t &oldcoeffcount,
 // Constructor.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 nloop_FIRFilterBank_t(void)
 {
   chans_active = 0;
@@ -230,9 +270,10 @@ nloop_FIRFilterBank_t(void)
 // This processes one sample.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 ApplyBankOnce( nloop_SampleSlice_t<samptype_t,1,chancount> &indata,
   nloop_SampleSlice_t<samptype_t,bankcount,chancount> &outdata )
 {
@@ -240,6 +281,8 @@ ApplyBankOnce( nloop_SampleSlice_t<samptype_t,1,chancount> &indata,
   int readidx;
   indextype_t bufmask;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_FIRBANK);
+
 
   // Blank the entire output (active or inactive).
 
@@ -277,9 +320,10 @@ ApplyBankOnce( nloop_SampleSlice_t<samptype_t,1,chancount> &indata,
 // Channel and bank geometry accessors.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 int nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 GetActiveChans(void)
 {
   return chans_active;
@@ -288,9 +332,10 @@ GetActiveChans(void)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 SetActiveChans(int new_chans)
 {
   if (new_chans < 0)
@@ -304,9 +349,10 @@ SetActiveChans(int new_chans)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 int nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 GetActiveBanks(void)
 {
   return banks_active;
@@ -315,9 +361,10 @@ GetActiveBanks(void)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 SetActiveBanks(int new_banks)
 {
   if (new_banks < 0)
@@ -333,9 +380,10 @@ SetActiveBanks(int new_banks)
 // Filter blanking accessors.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 BlankAllFilters(void)
 {
   int bidx;
@@ -347,9 +395,10 @@ BlankAllFilters(void)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 BlankOneFilter(int banknum)
 {
   if ( (banknum >= 0) && (banknum < bankcount) )
@@ -361,9 +410,10 @@ BlankOneFilter(int banknum)
 // Individual coefficient accessors.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 SetOneCoefficient(int banknum, indextype_t coeffidx, samptype_t coeffval)
 {
   if ( (banknum >= 0) && (banknum < bankcount) )
@@ -374,9 +424,10 @@ SetOneCoefficient(int banknum, indextype_t coeffidx, samptype_t coeffval)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 samptype_t nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 GetOneCoefficient(int banknum, indextype_t coeffidx)
 {
   samptype_t result;
@@ -395,9 +446,10 @@ GetOneCoefficient(int banknum, indextype_t coeffidx)
 // Filter geometry accessors.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 SetOneGeometry(int banknum, uint8_t newfracbits, indextype_t newcoeffcount)
 {
   if ( (banknum >= 0) && (banknum < bankcount) )
@@ -411,9 +463,10 @@ SetOneGeometry(int banknum, uint8_t newfracbits, indextype_t newcoeffcount)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 GetOneGeometry(int banknum, uint8_t &oldfracbits, indextype_t &oldcoeffcount)
 {
   oldfracbits = 0;
@@ -431,9 +484,10 @@ GetOneGeometry(int banknum, uint8_t &oldfracbits, indextype_t &oldcoeffcount)
 // Whole-filter configuration accessors.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 SetBankCoefficients(int banknum, int newbits, indextype_t newcoeffcount,
   nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &newcoeffs)
 {
@@ -445,9 +499,10 @@ SetBankCoefficients(int banknum, int newbits, indextype_t newcoeffcount,
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 GetBankCoefficients(int banknum, int &oldbits, indextype_t &oldcoeffcount,
     nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &oldcoeffs)
 {
@@ -464,9 +519,10 @@ GetBankCoefficients(int banknum, int &oldbits, indextype_t &oldcoeffcount,
 // Input buffer accessors.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 BlankAllInputBuffers(void)
 {
   int cidx;
@@ -482,9 +538,10 @@ BlankAllInputBuffers(void)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 BlankOneInputBuffer(int channum)
 {
   indextype_t sidx;
@@ -501,9 +558,10 @@ BlankOneInputBuffer(int channum)
 
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
 void nloop_FIRFilterBank_t
-<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount>::
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
 FastSettleBuffers(nloop_SampleSlice_t<samptype_t,1,chancount> &indata)
 {
   int cidx;
@@ -524,5 +582,49 @@ FastSettleBuffers(nloop_SampleSlice_t<samptype_t,1,chancount> &indata)
 
 
 
+// Input buffers are shared across banks, so only channels are stored.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
+void nloop_FIRFilterBank_t
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int cidx;
+
+  statebuf.PutTag(NLOOP_STATE_FIRBANK, chans_active, buflen, 0);
+
+  statebuf.PutValue(bufptr);
+
+  for (cidx = 0; cidx < chans_active; cidx++)
+    statebuf.PutArray(inbufs[cidx], buflen);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  indextype_t buflen, int bankcount, int chancount, class accumtype_t>
+void nloop_FIRFilterBank_t
+<samptype_t, indextype_t, maxcoeffs, buflen, bankcount, chancount,
+  accumtype_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int cidx;
+
+  if (!statebuf.CheckTag(NLOOP_STATE_FIRBANK, chans_active, buflen, 0))
+    return;
+
+  statebuf.GetValue(bufptr);
+  bufptr &= (buflen - 1);
+
+  for (cidx = 0; cidx < chans_active; cidx++)
+    statebuf.GetArray(inbufs[cidx], buflen);
+}
+
+
+
 //
 // This is the end of the file.
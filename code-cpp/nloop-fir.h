@@ -28,8 +28,15 @@
 //
 // The index type is used for indexing and for masking with circular buffers.
 // It's typically an unsigned integer type.
+//
+// The accumulator type holds products and the running sum. It defaults to
+// the sample type. A wider accumulator (e.g. int16_t samples with int32_t
+// accumulation) avoids overflow while keeping samples, coefficients, and
+// input buffers narrow; only the final shifted result is narrowed.
+// NOTE - The narrowed result wraps if it doesn't fit the sample type.
 
-template <class samptype_t, class indextype_t, indextype_t maxcoeffs>
+template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
+  class accumtype_t = samptype_t>
 class nloop_FIRFilter_t
 {
 protected:
@@ -73,6 +80,9 @@ public:
 
   void SetOneCoefficient(indextype_t coeffidx, samptype_t coeffval);
   samptype_t GetOneCoefficient(indextype_t coeffidx);
+  // This returns the coefficient array itself, for vector kernels that
+  // take flat arrays. Don't write through it.
+  samptype_t *GetCoefficientArray(void);
 
   void SetAllCoefficients(uint8_t newbits, indextype_t newcoeffcount,
     nloop_SampleSlice_t<samptype_t,1,maxcoeffs> &newcoeffs);
@@ -96,14 +106,16 @@ public:
 // buffers can be fast-settled to sidestep this.
 
 template <class samptype_t, class indextype_t, indextype_t maxcoeffs,
-  indextype_t buflen, int bankcount, int chancount>
+  indextype_t buflen, int bankcount, int chancount,
+  class accumtype_t = samptype_t>
 class nloop_FIRFilterBank_t
 {
 protected:
   // FIR instances.
   // This is a one-dimensional array; the FIR filters don't have internal
   // signal processing state.
-  nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs> firs[bankcount];
+  nloop_FIRFilter_t<samptype_t,indextype_t,maxcoeffs,accumtype_t>
+    firs[bankcount];
 
   // Input data buffers.
   // This is a one-dimensional array; input data isn't modified, so it can
@@ -166,6 +178,11 @@ public:
   void FastSettleBuffers(
     nloop_SampleSlice_t<samptype_t,1,chancount> &indata);
 
+  // Checkpointing. This saves or restores the input buffers of active
+  // channels. Loading fails if the active channel count doesn't match.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+
 };
 
 
@@ -0,0 +1,94 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Fixed-point headroom analysis for filter coefficients - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// Functions
+
+
+// This extracts one bank's coefficients from a biquad filter bank and
+// analyzes them. Only active stages are analyzed.
+// This returns false if "banknum" isn't an active bank or if any stage is
+// unstable.
+
+template <class samptype_t, class filtbank_t>
+bool nloop_HeadroomBiquadBank(filtbank_t &filtbank, int banknum,
+  double inmin, double inmax, vector<nloop_HeadroomStage_t> &results)
+{
+  vector<uint8_t> den0bits;
+  vector<long long> den1, den2, num0, num1, num2;
+  uint8_t thisbits;
+  samptype_t thisden1, thisden2, thisnum0, thisnum1, thisnum2;
+  int sidx, stagecount;
+
+  if ( (0 > banknum) || (banknum >= filtbank.GetActiveBanks()) )
+    return false;
+
+  stagecount = filtbank.GetActiveStages();
+
+  for (sidx = 0; sidx < stagecount; sidx++)
+  {
+    thisbits = 0;
+    thisden1 = 0;
+    thisden2 = 0;
+    thisnum0 = 0;
+    thisnum1 = 0;
+    thisnum2 = 0;
+
+    filtbank.GetCoefficients(sidx, banknum, thisbits, thisden1, thisden2,
+      thisnum0, thisnum1, thisnum2);
+
+    den0bits.push_back(thisbits);
+    den1.push_back(thisden1);
+    den2.push_back(thisden2);
+    num0.push_back(thisnum0);
+    num1.push_back(thisnum1);
+    num2.push_back(thisnum2);
+  }
+
+  return nloop_HeadroomBiquadChain(inmin, inmax, den0bits,
+    den1, den2, num0, num1, num2, results);
+}
+
+
+
+// This extracts one bank's coefficients from a FIR filter bank and
+// analyzes them.
+// This returns false if "banknum" isn't an active bank.
+
+template <class samptype_t, class indextype_t, class filtbank_t>
+bool nloop_HeadroomFIRBank(filtbank_t &filtbank, int banknum,
+  double inmin, double inmax, nloop_HeadroomStage_t &result)
+{
+  vector<long long> coeffs;
+  uint8_t fracbits;
+  indextype_t coeffcount, cidx;
+
+  if ( (0 > banknum) || (banknum >= filtbank.GetActiveBanks()) )
+    return false;
+
+  fracbits = 0;
+  coeffcount = 0;
+
+  filtbank.GetOneGeometry(banknum, fracbits, coeffcount);
+
+  for (cidx = 0; cidx < coeffcount; cidx++)
+    coeffs.push_back(filtbank.GetOneCoefficient(banknum, cidx));
+
+  nloop_HeadroomFIR(inmin, inmax, fracbits, coeffs, result);
+
+  return true;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,563 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Fixed-point headroom analysis for filter coefficients - non-template
+// functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <math.h>
+
+
+//
+// Helper Functions
+
+
+// This returns true if a biquad stage's poles are strictly inside the
+// unit circle.
+
+bool nloop_HeadroomIsStageStable(double den1, double den2)
+{
+  // Stability triangle for z^2 + den1 z + den2.
+  return (fabs(den2) < 1.0) && (fabs(den1) < (1.0 + den2));
+}
+
+
+
+// This sends an impulse through biquad stages "firststage" to "laststage"
+// and accumulates the sums of the positive and negative taps of the
+// response seen at each stage's output. If "is_error" is true, the first
+// stage's numerator is replaced with 1, giving the response to an error
+// injected at that stage's output.
+// Coefficients are normalized (divided by den0). "possum" and "negsum"
+// are indexed by stage and are overwritten for the stages processed.
+// This returns false if the response didn't decay within
+// NLOOP_HEADROOM_MAX_IMPULSE samples.
+
+bool nloop_HeadroomImpulseSums(int firststage, int laststage,
+  bool is_error,
+  vector<double> &den1, vector<double> &den2,
+  vector<double> &num0, vector<double> &num1, vector<double> &num2,
+  vector<double> &possum, vector<double> &negsum)
+{
+  vector<double> in1, in2, out1, out2;
+  double thisin, thisout, statesum, l1sum;
+  double thisnum0, thisnum1, thisnum2;
+  int sidx, stagecount;
+  long sampidx;
+
+  stagecount = laststage + 1 - firststage;
+  if (stagecount < 1)
+    return true;
+
+  in1.assign(stagecount, 0.0);
+  in2.assign(stagecount, 0.0);
+  out1.assign(stagecount, 0.0);
+  out2.assign(stagecount, 0.0);
+
+  for (sidx = firststage; sidx <= laststage; sidx++)
+  {
+    possum[sidx] = 0;
+    negsum[sidx] = 0;
+  }
+
+  l1sum = 0;
+
+  for (sampidx = 0; sampidx < NLOOP_HEADROOM_MAX_IMPULSE; sampidx++)
+  {
+    thisin = (0 == sampidx) ? 1.0 : 0.0;
+    statesum = 0;
+
+    for (sidx = 0; sidx < stagecount; sidx++)
+    {
+      thisnum0 = num0[firststage + sidx];
+      thisnum1 = num1[firststage + sidx];
+      thisnum2 = num2[firststage + sidx];
+
+      if (is_error && (0 == sidx))
+      {
+        thisnum0 = 1.0;
+        thisnum1 = 0;
+        thisnum2 = 0;
+      }
+
+      thisout = thisnum0 * thisin + thisnum1 * in1[sidx]
+        + thisnum2 * in2[sidx]
+        - den1[firststage + sidx] * out1[sidx]
+        - den2[firststage + sidx] * out2[sidx];
+
+      in2[sidx] = in1[sidx];
+      in1[sidx] = thisin;
+      out2[sidx] = out1[sidx];
+      out1[sidx] = thisout;
+
+      if (0 < thisout)
+        possum[firststage + sidx] += thisout;
+      else
+        negsum[firststage + sidx] += thisout;
+
+      l1sum += fabs(thisout);
+      statesum += fabs(in1[sidx]) + fabs(in2[sidx])
+        + fabs(out1[sidx]) + fabs(out2[sidx]);
+
+      thisin = thisout;
+    }
+
+    // Once the state has decayed, the rest of the response is negligible.
+    if ( (0 < sampidx)
+      && (statesum <= (NLOOP_HEADROOM_DECAY_FRACTION * l1sum)) )
+      return true;
+
+    // Guard against runaway responses from marginal stages.
+    if (!(l1sum < 1.0e30))
+      return false;
+  }
+
+  return false;
+}
+
+
+
+// This returns the largest magnitude of a list of coefficients.
+
+double nloop_HeadroomMaxMagnitude(long long a, long long b, long long c,
+  long long d, long long e)
+{
+  double result;
+
+  result = fabs((double) a);
+  result = max( result, fabs((double) b) );
+  result = max( result, fabs((double) c) );
+  result = max( result, fabs((double) d) );
+  result = max( result, fabs((double) e) );
+
+  return result;
+}
+
+
+
+// This fills in a stage's derived bit counts.
+
+void nloop_HeadroomFillBits(nloop_HeadroomStage_t &stage)
+{
+  stage.sample_bits =
+    nloop_HeadroomBitsNeeded(stage.worst_min, stage.worst_max);
+  stage.accum_bits =
+    nloop_HeadroomBitsNeeded(-stage.worst_accum, stage.worst_accum);
+  stage.typical_bits =
+    nloop_HeadroomBitsNeeded(-stage.typical_peak, stage.typical_peak);
+  stage.coeff_bits =
+    nloop_HeadroomBitsNeeded(-stage.max_coeff, stage.max_coeff);
+}
+
+
+
+// This returns a stage with no usable bounds.
+
+nloop_HeadroomStage_t nloop_HeadroomUnboundedStage(uint8_t den0bits,
+  double max_coeff)
+{
+  nloop_HeadroomStage_t result;
+
+  result.worst_min = -HUGE_VAL;
+  result.worst_max = HUGE_VAL;
+  result.worst_accum = HUGE_VAL;
+  result.typical_peak = HUGE_VAL;
+  result.max_coeff = max_coeff;
+  result.den0bits = den0bits;
+  result.is_stable = false;
+
+  nloop_HeadroomFillBits(result);
+
+  return result;
+}
+
+
+//
+// Analysis Functions
+
+
+// This analyzes a cascade of biquad stages. Coefficient arrays have one
+// entry per stage. One result per stage is appended to "results".
+// This returns false if any stage is unstable.
+
+bool nloop_HeadroomBiquadChain(double inmin, double inmax,
+  vector<uint8_t> &den0bits,
+  vector<long long> &den1, vector<long long> &den2,
+  vector<long long> &num0, vector<long long> &num1,
+  vector<long long> &num2,
+  vector<nloop_HeadroomStage_t> &results)
+{
+  vector<double> nden1, nden2, nnum0, nnum1, nnum2;
+  vector<double> possum, negsum, errpos, errneg;
+  vector<double> resp_re, resp_im;
+  nloop_HeadroomStage_t thisstage;
+  double scale, maxcoeff, stagein, stageout, midval, halfrange;
+  double omega, c1, s1, c2, s2, br, bi, ar, ai, denmag, tr, ti;
+  double peakgain, dcgain, prevmin, prevmax;
+  int stagecount, stablecount, sidx, eidx, fidx;
+  bool is_ok;
+
+  stagecount = den0bits.size();
+
+  if ( (den1.size() != ((size_t) stagecount))
+    || (den2.size() != ((size_t) stagecount))
+    || (num0.size() != ((size_t) stagecount))
+    || (num1.size() != ((size_t) stagecount))
+    || (num2.size() != ((size_t) stagecount)) )
+    return false;
+
+
+  // Normalize coefficients, and find the first unstable stage.
+
+  stablecount = stagecount;
+
+  for (sidx = 0; sidx < stagecount; sidx++)
+  {
+    scale = ldexp(1.0, - ((int) den0bits[sidx]));
+
+    nden1.push_back(scale * den1[sidx]);
+    nden2.push_back(scale * den2[sidx]);
+    nnum0.push_back(scale * num0[sidx]);
+    nnum1.push_back(scale * num1[sidx]);
+    nnum2.push_back(scale * num2[sidx]);
+
+    if ( (stablecount == stagecount)
+      && (!nloop_HeadroomIsStageStable(nden1[sidx], nden2[sidx])) )
+      stablecount = sidx;
+  }
+
+
+  // Get impulse response tap sums for the signal path, and for truncation
+  // error injected at each stage.
+
+  possum.assign(stagecount, 0.0);
+  negsum.assign(stagecount, 0.0);
+
+  is_ok = nloop_HeadroomImpulseSums(0, stablecount - 1, false,
+    nden1, nden2, nnum0, nnum1, nnum2, possum, negsum);
+  if (!is_ok)
+    stablecount = 0;
+
+  // Error sums are indexed [injection stage][output stage].
+  errpos.assign(stagecount * stagecount, 0.0);
+  errneg.assign(stagecount * stagecount, 0.0);
+
+  for (eidx = 0; is_ok && (eidx < stablecount); eidx++)
+  {
+    // Outputs without truncation don't inject error.
+    if (0 == den0bits[eidx])
+      continue;
+
+    vector<double> thispos(stagecount, 0.0);
+    vector<double> thisneg(stagecount, 0.0);
+
+    is_ok = nloop_HeadroomImpulseSums(eidx, stablecount - 1, true,
+      nden1, nden2, nnum0, nnum1, nnum2, thispos, thisneg);
+
+    for (sidx = eidx; sidx < stablecount; sidx++)
+    {
+      errpos[eidx * stagecount + sidx] = thispos[sidx];
+      errneg[eidx * stagecount + sidx] = thisneg[sidx];
+    }
+  }
+  if (!is_ok)
+    stablecount = 0;
+
+
+  // Walk through the frequency response one stage at a time, so that each
+  // stage's peak gain covers the cascade up to that point.
+
+  resp_re.assign(NLOOP_HEADROOM_FREQ_POINTS + 1, 1.0);
+  resp_im.assign(NLOOP_HEADROOM_FREQ_POINTS + 1, 0.0);
+
+  midval = 0.5 * (inmin + inmax);
+  halfrange = 0.5 * (inmax - inmin);
+
+  prevmin = inmin;
+  prevmax = inmax;
+
+  for (sidx = 0; sidx < stagecount; sidx++)
+  {
+    maxcoeff = nloop_HeadroomMaxMagnitude( den1[sidx], den2[sidx],
+      num0[sidx], num1[sidx], num2[sidx] );
+
+    if (sidx >= stablecount)
+    {
+      results.push_back(
+        nloop_HeadroomUnboundedStage(den0bits[sidx], maxcoeff) );
+      continue;
+    }
+
+    thisstage.den0bits = den0bits[sidx];
+    thisstage.max_coeff = maxcoeff;
+    thisstage.is_stable = true;
+
+    // Worst-case output range, with worst-case truncation error.
+    // Truncation rounds down, so each injected error is in (-1, 0].
+    thisstage.worst_max = possum[sidx] * inmax + negsum[sidx] * inmin;
+    thisstage.worst_min = possum[sidx] * inmin + negsum[sidx] * inmax;
+
+    for (eidx = 0; eidx <= sidx; eidx++)
+    {
+      thisstage.worst_max -= errneg[eidx * stagecount + sidx];
+      thisstage.worst_min -= errpos[eidx * stagecount + sidx];
+    }
+
+    // Worst-case accumulator magnitude.
+    stagein = max( fabs(prevmin), fabs(prevmax) );
+    stageout = max( fabs(thisstage.worst_min), fabs(thisstage.worst_max) );
+    thisstage.worst_accum = stagein * ( fabs((double) num0[sidx])
+        + fabs((double) num1[sidx]) + fabs((double) num2[sidx]) )
+      + stageout * ( fabs((double) den1[sidx])
+        + fabs((double) den2[sidx]) );
+
+    // Typical peak.
+    peakgain = 0;
+    for (fidx = 0; fidx <= NLOOP_HEADROOM_FREQ_POINTS; fidx++)
+    {
+      omega = M_PI * fidx / NLOOP_HEADROOM_FREQ_POINTS;
+      c1 = cos(omega);
+      s1 = sin(omega);
+      c2 = cos(2.0 * omega);
+      s2 = sin(2.0 * omega);
+
+      // Evaluate at z^-1 = exp(-j omega).
+      br = nnum0[sidx] + nnum1[sidx] * c1 + nnum2[sidx] * c2;
+      bi = - nnum1[sidx] * s1 - nnum2[sidx] * s2;
+      ar = 1.0 + nden1[sidx] * c1 + nden2[sidx] * c2;
+      ai = - nden1[sidx] * s1 - nden2[sidx] * s2;
+
+      // (br + j bi) / (ar + j ai), times the previous stages.
+      denmag = ar * ar + ai * ai;
+      tr = (br * ar + bi * ai) / denmag;
+      ti = (bi * ar - br * ai) / denmag;
+
+      br = resp_re[fidx] * tr - resp_im[fidx] * ti;
+      bi = resp_re[fidx] * ti + resp_im[fidx] * tr;
+      resp_re[fidx] = br;
+      resp_im[fidx] = bi;
+
+      peakgain = max( peakgain, sqrt(br * br + bi * bi) );
+    }
+
+    dcgain = resp_re[0];
+    thisstage.typical_peak = fabs(dcgain * midval) + peakgain * halfrange;
+
+    nloop_HeadroomFillBits(thisstage);
+    results.push_back(thisstage);
+
+    prevmin = thisstage.worst_min;
+    prevmax = thisstage.worst_max;
+  }
+
+  return (stablecount == stagecount);
+}
+
+
+
+// This analyzes one FIR filter.
+
+void nloop_HeadroomFIR(double inmin, double inmax, uint8_t fracbits,
+  vector<long long> &coeffs, nloop_HeadroomStage_t &result)
+{
+  double scale, thistap, possum, negsum, abssum, maxcoeff;
+  double omega, re, im, peakgain, midval, halfrange;
+  size_t cidx;
+  int fidx;
+
+  scale = ldexp(1.0, - ((int) fracbits));
+
+  possum = 0;
+  negsum = 0;
+  abssum = 0;
+  maxcoeff = 0;
+
+  for (cidx = 0; cidx < coeffs.size(); cidx++)
+  {
+    thistap = scale * coeffs[cidx];
+
+    if (0 < thistap)
+      possum += thistap;
+    else
+      negsum += thistap;
+
+    abssum += fabs((double) coeffs[cidx]);
+    maxcoeff = max( maxcoeff, fabs((double) coeffs[cidx]) );
+  }
+
+  result.den0bits = fracbits;
+  result.max_coeff = maxcoeff;
+  result.is_stable = true;
+
+  // Worst-case output range. Truncation can subtract up to 1.
+  result.worst_max = possum * inmax + negsum * inmin;
+  result.worst_min = possum * inmin + negsum * inmax;
+  if (0 < fracbits)
+    result.worst_min -= 1.0;
+
+  result.worst_accum = abssum * max( fabs(inmin), fabs(inmax) );
+
+  // Typical peak.
+  peakgain = 0;
+  for (fidx = 0; fidx <= NLOOP_HEADROOM_FREQ_POINTS; fidx++)
+  {
+    omega = M_PI * fidx / NLOOP_HEADROOM_FREQ_POINTS;
+    re = 0;
+    im = 0;
+
+    for (cidx = 0; cidx < coeffs.size(); cidx++)
+    {
+      re += coeffs[cidx] * cos(omega * cidx);
+      im -= coeffs[cidx] * sin(omega * cidx);
+    }
+
+    peakgain = max( peakgain, scale * sqrt(re * re + im * im) );
+  }
+
+  midval = 0.5 * (inmin + inmax);
+  halfrange = 0.5 * (inmax - inmin);
+  result.typical_peak =
+    fabs( (possum + negsum) * midval ) + peakgain * halfrange;
+
+  nloop_HeadroomFillBits(result);
+}
+
+
+//
+// Type Selection Functions
+
+
+// This returns the number of bits a signed integer needs to hold every
+// value from "minval" to "maxval".
+
+int nloop_HeadroomBitsNeeded(double minval, double maxval)
+{
+  int result;
+
+  // Anything past this (including infinity) is reported as not fitting.
+  for (result = 1; result < 1024; result++)
+    if ( (minval >= (- ldexp(1.0, result - 1)))
+      && (maxval <= (ldexp(1.0, result - 1) - 1.0)) )
+      return result;
+
+  return result;
+}
+
+
+
+// This returns the narrowest type width that holds a bit count, or 0.
+
+int nloop_HeadroomPickWidth(int bitsneeded)
+{
+  if (bitsneeded <= 16)
+    return 16;
+  if (bitsneeded <= 32)
+    return 32;
+  if (bitsneeded <= 64)
+    return 64;
+
+  return 0;
+}
+
+
+
+// This returns the narrowest type width that holds every stage's samples
+// plus "marginbits" guard bits, or 0 if nothing fits. This also covers
+// the input range and the coefficients.
+
+int nloop_HeadroomPickSampleBits(double inmin, double inmax,
+  vector<nloop_HeadroomStage_t> &stages, int marginbits)
+{
+  int bitsneeded;
+  size_t sidx;
+
+  bitsneeded = nloop_HeadroomBitsNeeded(inmin, inmax) + marginbits;
+
+  for (sidx = 0; sidx < stages.size(); sidx++)
+  {
+    if (!stages[sidx].is_stable)
+      return 0;
+
+    bitsneeded = max(bitsneeded, stages[sidx].sample_bits + marginbits);
+    bitsneeded = max(bitsneeded, stages[sidx].coeff_bits);
+  }
+
+  return nloop_HeadroomPickWidth(bitsneeded);
+}
+
+
+
+// This returns the narrowest type width that holds every stage's
+// accumulator values plus "marginbits" guard bits, or 0 if nothing fits.
+
+int nloop_HeadroomPickAccumBits(
+  vector<nloop_HeadroomStage_t> &stages, int marginbits)
+{
+  int bitsneeded;
+  size_t sidx;
+
+  bitsneeded = 1;
+
+  for (sidx = 0; sidx < stages.size(); sidx++)
+  {
+    if (!stages[sidx].is_stable)
+      return 0;
+
+    bitsneeded = max(bitsneeded, stages[sidx].accum_bits + marginbits);
+  }
+
+  return nloop_HeadroomPickWidth(bitsneeded);
+}
+
+
+
+// This returns the largest den0_bits value that a stage could use with
+// the specified sample and accumulator widths, or -1 if the stage doesn't
+// fit at all.
+
+int nloop_HeadroomMaxDen0Bits(nloop_HeadroomStage_t &stage,
+  int samplebits, int accumbits, int marginbits)
+{
+  int spare, result;
+
+  if (!stage.is_stable)
+    return -1;
+
+  // Scaling coefficients doesn't change the output, so samples have to
+  // fit as-is.
+  if ((stage.sample_bits + marginbits) > samplebits)
+    return -1;
+
+  // Each extra bit of den0 doubles coefficients and accumulator values.
+  spare = accumbits - (stage.accum_bits + marginbits);
+  spare = min(spare, samplebits - stage.coeff_bits);
+
+  result = ((int) stage.den0bits) + spare;
+
+  return (result < 0) ? -1 : result;
+}
+
+
+
+// This returns a type name for a width from the functions above.
+
+const char *nloop_HeadroomTypeName(int typebits)
+{
+  if (16 == typebits)
+    return "int16_t";
+  if (32 == typebits)
+    return "int32_t";
+  if (64 == typebits)
+    return "int64_t";
+
+  return "(none)";
+}
+
+
+//
+// This is the end of the file.
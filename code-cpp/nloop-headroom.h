@@ -0,0 +1,172 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Fixed-point headroom analysis for filter coefficients - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This does its arithmetic in double precision and uses vectors, so
+// it's workstation-only. It's meant for checking coefficient sets offline,
+// not for use in the processing loop.
+
+// Wrapper.
+#ifndef NLOOP_HEADROOM_H
+#define NLOOP_HEADROOM_H
+
+
+// These functions take a set of filter coefficients and the range that
+// input samples are confined to (the range given to
+// nloop_AutoRanger_t::SetDesiredRange()), and work out how large the
+// values inside the filter can get:
+//
+// - The worst-case output range of each stage is the input range scaled
+// by the L1 norm of the impulse response up to that stage, with the sign
+// of each tap chosen to push the output as far as possible. No input
+// within the range can exceed this. It includes the worst-case error from
+// truncating each stage's output.
+// - The worst-case accumulator magnitude of each stage is the sum of the
+// magnitudes of every product term, for worst-case stage inputs and
+// outputs. Partial sums never exceed this.
+// - The typical peak of each stage is the DC gain times the middle of the
+// input range, plus the largest frequency-response gain times half of the
+// input range. This is what a full-scale sinusoid at the worst frequency
+// produces, and is usually much smaller than the worst case.
+//
+// From these, nloop_HeadroomPickSampleBits() and
+// nloop_HeadroomPickAccumBits() give the narrowest of int16_t, int32_t,
+// and int64_t that can be used as "samptype_t" and "accumtype_t" (see
+// nloop-biquads.h and nloop-fir.h), with a requested number of guard bits.
+//
+// Scaling every coefficient of a stage by 2 and adding 1 to den0_bits
+// gives the same filter with one more bit of coefficient precision, and
+// doubles the accumulator and coefficient magnitudes. The "max_den0bits"
+// value reported for each stage is the largest den0_bits that still fits
+// a given pair of types.
+//
+// Filters are analyzed as exact rational-coefficient filters. Coefficient
+// sets with unstable stages are flagged, and have no meaningful bounds.
+
+
+//
+// Constants
+
+// Longest impulse response evaluated for IIR filters. Stable filters
+// normally decay well before this.
+#define NLOOP_HEADROOM_MAX_IMPULSE (1024 * 1024)
+
+// Impulse responses are truncated once the filter state falls below this
+// fraction of the response's running L1 norm.
+#define NLOOP_HEADROOM_DECAY_FRACTION 1.0e-12
+
+// Number of frequencies between DC and Nyquist at which the frequency
+// response is evaluated to find the peak gain.
+#define NLOOP_HEADROOM_FREQ_POINTS 4096
+
+// Default number of guard bits added when picking types.
+#define NLOOP_HEADROOM_DEFAULT_MARGIN_BITS 1
+
+
+//
+// Classes
+
+
+// Magnitude bounds for one filter stage.
+// "Bits" values are the number of bits needed in a signed integer,
+// including the sign bit.
+
+struct nloop_HeadroomStage_t
+{
+  // Output range for any input within the input range.
+  double worst_min, worst_max;
+  // Largest accumulator magnitude before the output shift.
+  double worst_accum;
+  // Typical output peak magnitude.
+  double typical_peak;
+  // Largest coefficient magnitude.
+  double max_coeff;
+
+  uint8_t den0bits;
+
+  int sample_bits;
+  int accum_bits;
+  int typical_bits;
+  int coeff_bits;
+
+  bool is_stable;
+};
+
+
+//
+// Functions
+
+
+// Analysis.
+
+// This analyzes a cascade of biquad stages. Coefficient arrays have one
+// entry per stage. One result per stage is appended to "results".
+// This returns false if any stage is unstable.
+bool nloop_HeadroomBiquadChain(double inmin, double inmax,
+  vector<uint8_t> &den0bits,
+  vector<long long> &den1, vector<long long> &den2,
+  vector<long long> &num0, vector<long long> &num1,
+  vector<long long> &num2,
+  vector<nloop_HeadroomStage_t> &results);
+
+// This analyzes one FIR filter.
+void nloop_HeadroomFIR(double inmin, double inmax, uint8_t fracbits,
+  vector<long long> &coeffs, nloop_HeadroomStage_t &result);
+
+// These extract one bank's coefficients from a filter bank and analyze
+// them. Only active stages are analyzed.
+// These return false if "banknum" isn't an active bank (in which case
+// nothing is analyzed), or if a biquad stage is unstable.
+template <class samptype_t, class filtbank_t>
+bool nloop_HeadroomBiquadBank(filtbank_t &filtbank, int banknum,
+  double inmin, double inmax, vector<nloop_HeadroomStage_t> &results);
+template <class samptype_t, class indextype_t, class filtbank_t>
+bool nloop_HeadroomFIRBank(filtbank_t &filtbank, int banknum,
+  double inmin, double inmax, nloop_HeadroomStage_t &result);
+
+
+// Type selection.
+
+// This returns the number of bits a signed integer needs to hold every
+// value from "minval" to "maxval".
+int nloop_HeadroomBitsNeeded(double minval, double maxval);
+
+// These return the narrowest type width (16, 32, or 64) that holds every
+// stage's samples (or accumulator values) plus "marginbits" guard bits,
+// or 0 if even 64 bits isn't enough. Sample widths also cover the input
+// range and the coefficients.
+int nloop_HeadroomPickSampleBits(double inmin, double inmax,
+  vector<nloop_HeadroomStage_t> &stages, int marginbits);
+int nloop_HeadroomPickAccumBits(
+  vector<nloop_HeadroomStage_t> &stages, int marginbits);
+
+// This returns the largest den0_bits value that a stage could use with
+// the specified sample and accumulator widths, or -1 if the stage doesn't
+// fit at all.
+int nloop_HeadroomMaxDen0Bits(nloop_HeadroomStage_t &stage,
+  int samplebits, int accumbits, int marginbits);
+
+// This returns a type name for a width from the functions above.
+const char *nloop_HeadroomTypeName(int typebits);
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-headroom-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -23,12 +23,16 @@
 //
 // NeuroLoop includes.
 
+// Instrumentation. This has to come before anything that's profiled.
+#include "nloop-profile.h"
+
 // Data types and primitive operations.
 #include "nloop-integers.h"
 #include "nloop-slices.h"
 #include "nloop-math.h"
 #include "nloop-lutmap.h"
 #include "nloop-voting.h"
+#include "nloop-state.h"
 
 // Signal processing modules.
 #include "nloop-preproc.h"
@@ -38,6 +42,13 @@
 #include "nloop-threshold.h"
 #include "nloop-trigger.h"
 
+// Module composition.
+#include "nloop-pipeline.h"
+
+// Test signal generation and scoring.
+#include "nloop-synth.h"
+#include "nloop-score.h"
+
 
 //
 // This is the end of the file.
@@ -5,6 +5,16 @@
 // Copyright (c) 2020 by Vanderbilt University. This work is licensed under
 // the Creative Commons Attribution 4.0 International License.
 
+//
+// Configuration
+
+// Embedded modules that have vector kernels in nloop-dispatch.h (voting
+// and lookup tables) call those instead of running their own loops.
+#ifndef NLOOP_USE_DISPATCH
+#define NLOOP_USE_DISPATCH
+#endif
+
+
 //
 // Embedded includes.
 
@@ -15,13 +25,32 @@
 // Additional standard library includes.
 
 // NOTE - <regex> needs C++11.
+// NOTE - nloop-snapshot.cpp needs POSIX (for mmap()).
+// NOTE - nloop-recording.cpp needs POSIX (for mmap() and madvise()).
+// NOTE - <atomic>, <thread>, and <chrono> need C++11.
+// NOTE - nloop-workers.cpp (used by nloop-shards.h, nloop-sweep.h, and
+// nloop-stages.h) needs POSIX threads (for CPU affinity).
+// NOTE - nloop-rt.cpp needs POSIX (for SCHED_FIFO, mlockall(), and
+// clock_nanosleep()).
+// NOTE - nloop-arena.cpp needs POSIX (for posix_memalign()).
+// NOTE - nloop-dispatch.h uses GCC/Clang target attributes on x86 (and
+// falls back to scalar code elsewhere).
 
 #include <iostream>
+#include <fstream>
 #include <string>
 #include <list>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <regex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
 
 
 //
@@ -35,6 +64,21 @@ using namespace std;
 // Additional NeuroLoop includes.
 
 #include "nloop-fileio.h"
+#include "nloop-snapshot.h"
+#include "nloop-recording.h"
+#include "nloop-edf.h"
+#include "nloop-configswap.h"
+#include "nloop-workers.h"
+#include "nloop-shards.h"
+#include "nloop-sweep.h"
+#include "nloop-spsc.h"
+#include "nloop-stages.h"
+#include "nloop-acqring.h"
+#include "nloop-rt.h"
+#include "nloop-arena.h"
+#include "nloop-dispatch.h"
+#include "nloop-dynbanks.h"
+#include "nloop-headroom.h"
 
 
 //
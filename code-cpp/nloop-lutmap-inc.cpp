@@ -71,9 +71,16 @@ Lookup_LE(intype_t inval)
   // Force sane output.
   outval = 0;
 
+#ifdef NLOOP_USE_DISPATCH
+  // This takes the same time regardless of where the match is.
+  ridx = nloop_DispatchLookupIndexLE<intype_t>(input_lut, ridxmax, inval);
+  if (ridx < ridxmax)
+    outval = output_lut[ridx];
+#else
   for (ridx = (ridxmax - 1); ridx >= 0; ridx--)
     if (input_lut[ridx] <= inval)
       outval = output_lut[ridx];
+#endif
 
   return outval;
 }
@@ -104,9 +111,16 @@ Lookup_GE(intype_t inval)
   // Force sane output.
   outval = 0;
 
+#ifdef NLOOP_USE_DISPATCH
+  // This takes the same time regardless of where the match is.
+  ridx = nloop_DispatchLookupIndexGE<intype_t>(input_lut, ridxmax, inval);
+  if (ridx < ridxmax)
+    outval = output_lut[ridx];
+#else
   for (ridx = (ridxmax - 1); ridx >= 0; ridx--)
     if (input_lut[ridx] >= inval)
       outval = output_lut[ridx];
+#endif
 
   return outval;
 }
@@ -269,6 +283,8 @@ LookupAll_LE(
   int blimit, climit;
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_LUTBANK);
+
   blimit = banks_active;
   if (blimit > bankcount)
     blimit = bankcount;
@@ -303,6 +319,8 @@ LookupAll_GE(
   int blimit, climit;
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_LUTBANK);
+
   blimit = banks_active;
   if (blimit > bankcount)
     blimit = bankcount;
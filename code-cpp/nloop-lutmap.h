@@ -22,6 +22,9 @@
 // descending monotonic table, or the first row entry >= the input in an
 // ascending monotonic table.
 
+// If NLOOP_USE_DISPATCH is defined, searches use the vector kernels in
+// nloop-dispatch.h. These assume the table really is monotonic.
+
 
 // Individual version.
 
@@ -138,6 +141,24 @@ public:
 
 
 
+//
+// Functions
+
+
+#ifdef NLOOP_USE_DISPATCH
+
+// Vector kernels from nloop-dispatch.h (workstation builds).
+
+template <class samptype_t>
+int nloop_DispatchLookupIndexLE(const samptype_t *keys, int rows,
+  samptype_t value);
+template <class samptype_t>
+int nloop_DispatchLookupIndexGE(const samptype_t *keys, int rows,
+  samptype_t value);
+
+#endif
+
+
 //
 // Code Inclusion
 
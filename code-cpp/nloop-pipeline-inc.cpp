@@ -0,0 +1,359 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Compile-time detection pipeline - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// nloop_DetectionPipeline_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t, estimator_t,
+  avgcoeffbits, bankcount, chancount>::nloop_DetectionPipeline_t(void)
+{
+  want_autorange = false;
+
+  thresh_high.SetUniformValue(0);
+  thresh_low.SetUniformValue(0);
+  targets.SetUniformValue(0);
+
+  ranged.SetUniformValue(0);
+  filtered.SetUniformValue(0);
+  magnitudes.SetUniformValue(0);
+  averages.SetUniformValue(0);
+  periods.SetUniformValue(0);
+  since_rise.SetUniformValue(0);
+  since_fall.SetUniformValue(0);
+  flag_high.SetUniformValue(false);
+  flag_low.SetUniformValue(false);
+  detected.SetUniformValue(false);
+  bursts.SetUniformValue(false);
+
+  threshdual.ResetState();
+}
+
+
+
+// This runs one sample through every stage up to and including the
+// deglitcher.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::ProcessDetection(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> &indata)
+{
+  if (want_autorange)
+  {
+    ranger.UpdateFromSample(indata);
+    ranger.GetLatchedOutput(indata, ranged);
+  }
+  else
+    ranged.CopyFrom(indata);
+
+  filters.ApplyBankOnce(ranged, filtered);
+
+  analytic.HandleSamples(filtered);
+  analytic.GetEstimatedAnalytic(magnitudes, periods, since_rise, since_fall);
+
+  averagers.UpdateAverage(magnitudes, averages);
+
+  threshsingle.TestSamples(averages, thresh_high, flag_high);
+  threshsingle.TestSamples(averages, thresh_low, flag_low);
+  threshdual.TestDual(flag_high, flag_low, detected);
+  deglitch.ProcessSample(detected, bursts);
+}
+
+
+
+// This runs one sample through every stage, and returns trigger outputs.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::ProcessSlice(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
+  nloop_SampleSlice_t<bool, bankcount, chancount> &trigout)
+{
+  ProcessDetection(indata);
+  triggers.ProcessSamples(since_rise, targets, periods, bursts, trigout);
+}
+
+
+
+// This runs "count" samples through every stage.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::ProcessBlock(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *indata,
+  nloop_SampleSlice_t<bool, bankcount, chancount> *trigout, int count)
+{
+  int sidx;
+
+  // NOTE - This is sample-major rather than stage-major. Every stage's
+  // state stays in cache between samples, and intermediate slices don't
+  // have to be buffered for the whole block.
+  for (sidx = 0; sidx < count; sidx++)
+    ProcessSlice(indata[sidx], trigout[sidx]);
+}
+
+
+
+// This sets the number of active banks and channels in every module
+// that supports run-time geometry.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetActiveGeometry(
+  int new_banks, int new_chans)
+{
+  filters.SetActiveBanks(new_banks);
+  filters.SetActiveChans(new_chans);
+
+  analytic.SetActiveBanks(new_banks);
+  analytic.SetActiveChans(new_chans);
+
+  averagers.SetActiveBanks(new_banks);
+  averagers.SetActiveChans(new_chans);
+
+  triggers.SetActiveBanks(new_banks);
+  triggers.SetActiveChans(new_chans);
+}
+
+
+
+// Auto-ranging enable accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetAutoRange(
+  bool want_enabled)
+{
+  want_autorange = want_enabled;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+bool nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetAutoRange(void)
+{
+  return want_autorange;
+}
+
+
+
+// Threshold accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetThresholds(
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_high,
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_low )
+{
+  thresh_high.CopyFrom(new_high);
+  thresh_low.CopyFrom(new_low);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetUniformThresholds(
+  samptype_t new_high, samptype_t new_low)
+{
+  thresh_high.SetUniformValue(new_high);
+  thresh_low.SetUniformValue(new_low);
+}
+
+
+
+// Trigger target accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetTargets(
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> &new_targets )
+{
+  targets.CopyFrom(new_targets);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetUniformTargets(
+  indextype_t new_target)
+{
+  targets.SetUniformValue(new_target);
+}
+
+
+
+// Module accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_AutoRanger_t<samptype_t, indextype_t, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetRanger(void)
+{
+  return ranger;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+filtbank_t &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetFilterBank(void)
+{
+  return filters;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+  bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetAnalytic(void)
+{
+  return analytic;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetAverager(void)
+{
+  return averagers;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetDeGlitcher(void)
+{
+  return deglitch;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_TriggerBank_t<indextype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetTriggers(void)
+{
+  return triggers;
+}
+
+
+
+// Intermediate slice accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SampleSlice_t<samptype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetFiltered(void)
+{
+  return filtered;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SampleSlice_t<samptype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetMagnitudes(void)
+{
+  return magnitudes;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SampleSlice_t<samptype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetAverages(void)
+{
+  return averages;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SampleSlice_t<indextype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetPeriods(void)
+{
+  return periods;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SampleSlice_t<indextype_t, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetSinceRise(void)
+{
+  return since_rise;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SampleSlice_t<bool, bankcount, chancount> &
+nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetBurstFlags(void)
+{
+  return bursts;
+}
+
+
+
+// Checkpointing. This saves or restores every module's processing
+// state, in pipeline order.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SaveState(
+  nloop_StateBuffer_t &statebuf)
+{
+  ranger.SaveState(statebuf);
+  filters.SaveState(statebuf);
+  analytic.SaveState(statebuf);
+  averagers.SaveState(statebuf);
+  threshdual.SaveState(statebuf);
+  deglitch.SaveState(statebuf);
+  triggers.SaveState(statebuf);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::LoadState(
+  nloop_StateBuffer_t &statebuf)
+{
+  ranger.LoadState(statebuf);
+  filters.LoadState(statebuf);
+  analytic.LoadState(statebuf);
+  averagers.LoadState(statebuf);
+  threshdual.LoadState(statebuf);
+  deglitch.LoadState(statebuf);
+  triggers.LoadState(statebuf);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,169 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Compile-time detection pipeline - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// Wrapper.
+#ifndef NLOOP_PIPELINE_H
+#define NLOOP_PIPELINE_H
+
+
+// A detection pipeline wires together the standard chain of modules:
+//
+//   auto-ranger -> filter bank -> analytic estimator -> averager
+//     -> dual threshold -> deglitcher -> trigger bank
+//
+// The pipeline owns its modules and all intermediate slices. Each sample
+// is processed by calling ProcessSlice(), or a block of samples by calling
+// ProcessBlock(). Modules are members rather than pointers, and stage
+// types are template arguments, so the compiler can inline across stage
+// boundaries and there are no vtables.
+//
+// "filtbank_t" is the filter bank type (nloop_IIRFilterBank_t or
+// nloop_FIRFilterBank_t with matching samptype_t/bankcount/chancount).
+// "estimator_t" is the analytic estimator type (e.g. nloop_Analytic_PTZC_t).
+//
+// Modules are configured through the GetX() accessors, which return
+// references to the pipeline's own instances. Intermediate slices from the
+// most recent sample can be inspected the same way.
+//
+// NOTE - Pipelines are large. Allocate them statically or on the heap, not
+// on the stack.
+
+
+//
+// Classes
+
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+class nloop_DetectionPipeline_t
+{
+protected:
+  // Modules.
+  nloop_AutoRanger_t<samptype_t, indextype_t, chancount> ranger;
+  filtbank_t filters;
+  nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+    bankcount, chancount> analytic;
+  nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount>
+    averagers;
+  nloop_ThresholdSingleBank_t<samptype_t, bankcount, chancount> threshsingle;
+  nloop_ThresholdDualBank_t<bankcount, chancount> threshdual;
+  nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount> deglitch;
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> triggers;
+
+  // Configuration that isn't held by modules.
+  bool want_autorange;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> thresh_high;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> thresh_low;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> targets;
+
+  // Intermediate slices.
+  nloop_SampleSlice_t<samptype_t, 1, chancount> ranged;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> filtered;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> magnitudes;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> averages;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> periods;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> since_rise;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> since_fall;
+  nloop_SampleSlice_t<bool, bankcount, chancount> flag_high;
+  nloop_SampleSlice_t<bool, bankcount, chancount> flag_low;
+  nloop_SampleSlice_t<bool, bankcount, chancount> detected;
+  nloop_SampleSlice_t<bool, bankcount, chancount> bursts;
+
+public:
+  // This sets thresholds and targets to zero and disables auto-ranging.
+  // Modules get their own default configurations.
+  nloop_DetectionPipeline_t(void);
+  // Default destructor is fine.
+
+
+  // Processing functions.
+
+  // This runs one sample through every stage up to and including the
+  // deglitcher. Triggering is the only stage that couples channels (via
+  // the pulse quota), so callers that split channels across several
+  // pipelines run it themselves on the merged outputs.
+  void ProcessDetection(
+    nloop_SampleSlice_t<samptype_t, 1, chancount> &indata );
+
+  // This runs one sample through every stage, and returns trigger outputs.
+  void ProcessSlice(nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
+    nloop_SampleSlice_t<bool, bankcount, chancount> &trigout);
+
+  // This runs "count" samples through every stage.
+  // NOTE - Intermediate slices only hold values from the last sample.
+  void ProcessBlock(nloop_SampleSlice_t<samptype_t, 1, chancount> *indata,
+    nloop_SampleSlice_t<bool, bankcount, chancount> *trigout, int count);
+
+
+  // Configuration.
+
+  // This sets the number of active banks and channels in every module
+  // that supports run-time geometry.
+  void SetActiveGeometry(int new_banks, int new_chans);
+
+  // If auto-ranging is disabled, input goes straight to the filter bank.
+  void SetAutoRange(bool want_enabled);
+  bool GetAutoRange(void);
+
+  void SetThresholds(
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_high,
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_low );
+  void SetUniformThresholds(samptype_t new_high, samptype_t new_low);
+
+  // Target delays after the rising zero crossing, for the trigger bank.
+  void SetTargets(
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> &new_targets );
+  void SetUniformTargets(indextype_t new_target);
+
+
+  // Module accessors.
+
+  nloop_AutoRanger_t<samptype_t, indextype_t, chancount> &GetRanger(void);
+  filtbank_t &GetFilterBank(void);
+  nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+    bankcount, chancount> &GetAnalytic(void);
+  nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount>
+    &GetAverager(void);
+  nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount>
+    &GetDeGlitcher(void);
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> &GetTriggers(void);
+
+
+  // Intermediate slice accessors. These hold values from the last sample.
+
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &GetFiltered(void);
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &GetMagnitudes(void);
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &GetAverages(void);
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> &GetPeriods(void);
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> &GetSinceRise(void);
+  nloop_SampleSlice_t<bool, bankcount, chancount> &GetBurstFlags(void);
+
+
+  // Checkpointing. This saves or restores every module's processing
+  // state, in pipeline order.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-pipeline-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -201,6 +201,8 @@ UpdateFromSample(nloop_SampleSlice_t<samptype_t, 1, chancount> &data)
   int cidx;
   samptype_t thisval;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_AUTORANGE_UPDATE);
+
   // Update observed minimum and maximum.
   for (cidx = 0; cidx < chancount; cidx++)
   {
@@ -245,6 +247,8 @@ void nloop_AutoRanger_t<samptype_t,indextype_t,chancount>::
 GetRunningOutput(nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
   nloop_SampleSlice_t<samptype_t, 1, chancount> &outdata)
 {
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_AUTORANGE_OUTPUT);
+
   // Wrap the helper function.
   CalcOutput(indata, outdata, false);
 }
@@ -259,6 +263,8 @@ void nloop_AutoRanger_t<samptype_t,indextype_t,chancount>::
 GetLatchedOutput(nloop_SampleSlice_t<samptype_t, 1, chancount> &indata,
   nloop_SampleSlice_t<samptype_t, 1, chancount> &outdata)
 {
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_AUTORANGE_OUTPUT);
+
   // Wrap the helper function.
   CalcOutput(indata, outdata, true);
 }
@@ -277,6 +283,8 @@ ResetTracking(bool want_shared_atten)
 {
   int cidx;
 
+  atten_tied = want_shared_atten;
+
   for (cidx = 0; cidx < chancount; cidx++)
   {
     // Set these to values that any sample will modify.
@@ -460,5 +468,51 @@ SetAttenOffset(
 
 
 
+// Checkpointing.
+// The desired output range is configuration and isn't stored.
+
+template<class samptype_t, class indextype_t, int chancount>
+void nloop_AutoRanger_t<samptype_t,indextype_t,chancount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.PutTag(NLOOP_STATE_AUTORANGER, chancount, 0, 0);
+
+  statebuf.PutArray(minvals, chancount);
+  statebuf.PutArray(maxvals, chancount);
+
+  statebuf.PutValue(latch_countdown);
+  statebuf.PutValue(countdown_active);
+  statebuf.PutValue(atten_tied);
+
+  statebuf.PutArray(running_offsets, chancount);
+  statebuf.PutArray(running_attens, chancount);
+  statebuf.PutArray(latched_offsets, chancount);
+  statebuf.PutArray(latched_attens, chancount);
+}
+
+
+
+template<class samptype_t, class indextype_t, int chancount>
+void nloop_AutoRanger_t<samptype_t,indextype_t,chancount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  if (!statebuf.CheckTag(NLOOP_STATE_AUTORANGER, chancount, 0, 0))
+    return;
+
+  statebuf.GetArray(minvals, chancount);
+  statebuf.GetArray(maxvals, chancount);
+
+  statebuf.GetValue(latch_countdown);
+  statebuf.GetValue(countdown_active);
+  statebuf.GetValue(atten_tied);
+
+  statebuf.GetArray(running_offsets, chancount);
+  statebuf.GetArray(running_attens, chancount);
+  statebuf.GetArray(latched_offsets, chancount);
+  statebuf.GetArray(latched_attens, chancount);
+}
+
+
+
 //
 // This is the end of the file.
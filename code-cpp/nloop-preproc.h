@@ -105,6 +105,12 @@ public:
   void SetAttenOffset(
     nloop_SampleSlice_t<samptype_t,1,chancount> &bitshifts,
     nloop_SampleSlice_t<samptype_t,1,chancount> &offsets);
+
+  // Checkpointing. This saves or restores the tracked range, the latch
+  // countdown, and the running and latched attenuations and offsets.
+  // The desired output range is configuration and isn't stored.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -0,0 +1,348 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Per-stage cycle-count instrumentation - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this is included by every file that uses the library,
+// non-template functions here are declared "inline" so that multiple
+// copies don't collide at link-time.
+
+
+//
+// nloop_CycleHistogram_t Class
+
+
+// Constructor.
+
+inline nloop_CycleHistogram_t::nloop_CycleHistogram_t(void)
+{
+  Clear();
+}
+
+
+
+// This converts a time to a bucket index.
+// Times below 2^(subbits+1) map directly to buckets. Larger times are
+// shifted down until they're in that range, and each shift moves them up
+// by another 2^subbits buckets.
+
+inline int nloop_CycleHistogram_t::GetBucketIndex(uint64_t ticks)
+{
+  int shift, bucketidx;
+
+  shift = 0;
+  while (ticks >= (2 << NLOOP_PROFILE_SUBBITS))
+  {
+    ticks >>= 1;
+    shift++;
+  }
+
+  bucketidx = (shift << NLOOP_PROFILE_SUBBITS) + (int) ticks;
+
+  if (bucketidx >= NLOOP_PROFILE_BUCKETS)
+    bucketidx = NLOOP_PROFILE_BUCKETS - 1;
+
+  return bucketidx;
+}
+
+
+
+// This returns the largest time that maps to a given bucket.
+
+inline uint64_t nloop_CycleHistogram_t::GetBucketUpperEdge(int bucketidx)
+{
+  uint64_t mantissa;
+  int shift;
+
+  if (bucketidx < (2 << NLOOP_PROFILE_SUBBITS))
+    return (uint64_t) bucketidx;
+
+  shift = (bucketidx >> NLOOP_PROFILE_SUBBITS) - 1;
+  mantissa = (uint64_t) (bucketidx - (shift << NLOOP_PROFILE_SUBBITS));
+
+  return ((mantissa + 1) << shift) - 1;
+}
+
+
+
+// This empties the histogram.
+
+inline void nloop_CycleHistogram_t::Clear(void)
+{
+  int hidx;
+
+  for (hidx = 0; hidx < NLOOP_PROFILE_BUCKETS; hidx++)
+    buckets[hidx] = 0;
+
+  count = 0;
+  total = 0;
+  maxval = 0;
+}
+
+
+
+// This adds one elapsed time.
+
+inline void nloop_CycleHistogram_t::Record(uint64_t ticks)
+{
+  buckets[GetBucketIndex(ticks)]++;
+
+  count++;
+  total += ticks;
+  if (ticks > maxval)
+    maxval = ticks;
+}
+
+
+
+// This adds another histogram's contents to this one's.
+
+inline void nloop_CycleHistogram_t::MergeFrom(nloop_CycleHistogram_t &other)
+{
+  int hidx;
+
+  for (hidx = 0; hidx < NLOOP_PROFILE_BUCKETS; hidx++)
+    buckets[hidx] += other.buckets[hidx];
+
+  count += other.count;
+  total += other.total;
+  if (other.maxval > maxval)
+    maxval = other.maxval;
+}
+
+
+
+// Accessors.
+
+inline uint64_t nloop_CycleHistogram_t::GetCount(void)
+{
+  return count;
+}
+
+inline uint64_t nloop_CycleHistogram_t::GetTotal(void)
+{
+  return total;
+}
+
+inline uint64_t nloop_CycleHistogram_t::GetMax(void)
+{
+  return maxval;
+}
+
+
+
+// This returns the time that "permille" thousandths of all recorded times
+// are at or below, rounded up to the edge of its bucket.
+
+inline uint64_t nloop_CycleHistogram_t::GetPercentile(int permille)
+{
+  uint64_t wanted, seen, result;
+  int hidx;
+
+  if (0 == count)
+    return 0;
+
+  if (permille < 0)
+    permille = 0;
+  if (permille > 1000)
+    permille = 1000;
+
+  wanted = (count * permille + 999) / 1000;
+  if (wanted < 1)
+    wanted = 1;
+
+  result = maxval;
+  seen = 0;
+  for (hidx = 0; hidx < NLOOP_PROFILE_BUCKETS; hidx++)
+  {
+    seen += buckets[hidx];
+    if (seen >= wanted)
+    {
+      // The last bucket is open-ended, so leave the result as the maximum.
+      if (hidx < (NLOOP_PROFILE_BUCKETS - 1))
+        result = GetBucketUpperEdge(hidx);
+      break;
+    }
+  }
+
+  // No bucket edge is more useful than the true maximum.
+  if (result > maxval)
+    result = maxval;
+
+  return result;
+}
+
+
+
+//
+// nloop_Profiler_t Class
+
+
+// This empties all stage histograms.
+
+inline void nloop_Profiler_t::Clear(void)
+{
+  int sidx;
+
+  for (sidx = 0; sidx < NLOOP_PROF_STAGECOUNT; sidx++)
+    stages[sidx].Clear();
+}
+
+
+
+// This adds one elapsed time to a stage's histogram.
+
+inline void nloop_Profiler_t::Record(int stageidx, uint64_t ticks)
+{
+  if ( (0 <= stageidx) && (NLOOP_PROF_STAGECOUNT > stageidx) )
+    stages[stageidx].Record(ticks);
+}
+
+
+
+// This returns a stage's histogram, or NULL if the index is out of range.
+
+inline nloop_CycleHistogram_t *nloop_Profiler_t::GetStage(int stageidx)
+{
+  if ( (0 > stageidx) || (NLOOP_PROF_STAGECOUNT <= stageidx) )
+    return NULL;
+
+  return &(stages[stageidx]);
+}
+
+
+
+// This reports the call count, median, 99th percentile, and maximum for
+// one stage.
+
+inline bool nloop_Profiler_t::GetStageSummary(int stageidx,
+  uint64_t &count, uint64_t &p50, uint64_t &p99, uint64_t &maxval)
+{
+  count = 0;
+  p50 = 0;
+  p99 = 0;
+  maxval = 0;
+
+  if ( (0 > stageidx) || (NLOOP_PROF_STAGECOUNT <= stageidx) )
+    return false;
+
+  count = stages[stageidx].GetCount();
+  p50 = stages[stageidx].GetPercentile(500);
+  p99 = stages[stageidx].GetPercentile(990);
+  maxval = stages[stageidx].GetMax();
+
+  return (0 < count);
+}
+
+
+
+// This adds another profiler's histograms to this one's.
+
+inline void nloop_Profiler_t::MergeFrom(nloop_Profiler_t &other)
+{
+  int sidx;
+
+  for (sidx = 0; sidx < NLOOP_PROF_STAGECOUNT; sidx++)
+    stages[sidx].MergeFrom(other.stages[sidx]);
+}
+
+
+
+//
+// nloop_ProfileScope_t Class
+
+#ifdef NLOOP_PROFILE
+
+inline nloop_ProfileScope_t::nloop_ProfileScope_t(int new_stage)
+{
+  stageidx = new_stage;
+  start_ticks = NLOOP_PROFILE_CLOCK();
+}
+
+
+
+inline nloop_ProfileScope_t::~nloop_ProfileScope_t(void)
+{
+  nloop_GetProfiler().Record(stageidx, NLOOP_PROFILE_CLOCK() - start_ticks);
+}
+
+#endif
+
+
+
+//
+// Functions
+
+
+// This returns the profiler that instrumented calls record into.
+
+inline nloop_Profiler_t &nloop_GetProfiler(void)
+{
+#ifdef NLOOP_PROFILE_PER_THREAD
+  static thread_local nloop_Profiler_t profiler;
+#else
+  static nloop_Profiler_t profiler;
+#endif
+
+  return profiler;
+}
+
+
+
+// This returns a short human-readable stage name.
+
+inline const char *nloop_GetProfileStageName(int stageidx)
+{
+  switch (stageidx)
+  {
+    case NLOOP_PROF_AUTORANGE_UPDATE:
+      return "autorange-update";
+    case NLOOP_PROF_AUTORANGE_OUTPUT:
+      return "autorange-output";
+    case NLOOP_PROF_IIRBANK:
+      return "iir-bank";
+    case NLOOP_PROF_FIRBANK:
+      return "fir-bank";
+    case NLOOP_PROF_ANALYTICBANK:
+      return "analytic-bank";
+    case NLOOP_PROF_AVERAGERBANK:
+      return "averager-bank";
+    case NLOOP_PROF_THRESHSINGLE:
+      return "threshold-single";
+    case NLOOP_PROF_THRESHDUAL:
+      return "threshold-dual";
+    case NLOOP_PROF_DEGLITCHERBANK:
+      return "deglitcher-bank";
+    case NLOOP_PROF_TRIGGERBANK:
+      return "trigger-bank";
+    case NLOOP_PROF_LUTBANK:
+      return "lut-bank";
+    default:
+      break;
+  }
+
+  return "unknown";
+}
+
+
+
+#ifdef NLOOP_PROFILE_USE_GETTIME
+
+// This reads CLOCK_MONOTONIC in nanoseconds.
+
+inline uint64_t nloop_ReadProfileClockNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return ((uint64_t) now.tv_sec) * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,213 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Per-stage cycle-count instrumentation - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// Wrapper.
+#ifndef NLOOP_PROFILE_H
+#define NLOOP_PROFILE_H
+
+
+// When NLOOP_PROFILE is defined, every bank-level processing call
+// (ApplyBankOnce(), HandleSamples(), UpdateAverage(), TestSamples(),
+// TestDual(), ProcessSample(), ProcessSamples(), LookupAll_XX(), and the
+// auto-ranger's update and output calls) is timed, and the elapsed time is
+// added to a histogram for that stage. When NLOOP_PROFILE is not defined,
+// the instrumentation compiles to nothing.
+//
+// Times are in clock ticks. On x86 targets this is the time-stamp counter
+// (read with RDTSC, which isn't serializing, so very short calls are
+// approximate). Elsewhere, or if NLOOP_PROFILE_CLOCK_GETTIME is defined,
+// this is CLOCK_MONOTONIC in nanoseconds. Embedded targets can supply their
+// own cycle counter by defining NLOOP_PROFILE_CLOCK() before including the
+// library.
+//
+// Histograms have fixed log-linear buckets (eight per power of two), so
+// recording a time is a few shifts and an increment, and nothing is
+// allocated. Percentiles are reported as the upper edge of the bucket they
+// fall in, so they're accurate to within about 12%. Maxima are exact.
+//
+// Results are read from nloop_GetProfiler():
+//
+//   nloop_GetProfiler().GetStageSummary(NLOOP_PROF_IIRBANK,
+//     count, p50, p99, maxval);
+//
+// NOTE - By default there's one profiler for the whole process, and it
+// isn't thread-safe. When profiling the multi-threaded runners, define
+// NLOOP_PROFILE_PER_THREAD to give each thread its own profiler; each
+// thread then sees only the calls it made.
+
+
+//
+// Constants
+
+// Histogram geometry. Times below 8 ticks get their own buckets; above
+// that, each power of two is split into 8 buckets. 256 buckets reach about
+// 2^34 ticks; longer times go in the last bucket.
+#define NLOOP_PROFILE_SUBBITS 3
+#define NLOOP_PROFILE_BUCKETS 256
+
+// Profiled stages.
+enum nloop_profstage_t
+{
+  NLOOP_PROF_AUTORANGE_UPDATE = 0,
+  NLOOP_PROF_AUTORANGE_OUTPUT,
+  NLOOP_PROF_IIRBANK,
+  NLOOP_PROF_FIRBANK,
+  NLOOP_PROF_ANALYTICBANK,
+  NLOOP_PROF_AVERAGERBANK,
+  NLOOP_PROF_THRESHSINGLE,
+  NLOOP_PROF_THRESHDUAL,
+  NLOOP_PROF_DEGLITCHERBANK,
+  NLOOP_PROF_TRIGGERBANK,
+  NLOOP_PROF_LUTBANK,
+  NLOOP_PROF_STAGECOUNT
+};
+
+
+//
+// Classes
+
+
+// Fixed-bucket histogram of elapsed times.
+
+class nloop_CycleHistogram_t
+{
+protected:
+  uint64_t buckets[NLOOP_PROFILE_BUCKETS];
+  uint64_t count, total, maxval;
+
+  // These convert between times and bucket indices.
+  int GetBucketIndex(uint64_t ticks);
+  uint64_t GetBucketUpperEdge(int bucketidx);
+
+public:
+  // The constructor clears the histogram.
+  nloop_CycleHistogram_t(void);
+  // Default destructor is fine.
+
+  void Clear(void);
+
+  // This adds one elapsed time.
+  void Record(uint64_t ticks);
+
+  // This adds another histogram's contents to this one's.
+  void MergeFrom(nloop_CycleHistogram_t &other);
+
+  uint64_t GetCount(void);
+  uint64_t GetTotal(void);
+  uint64_t GetMax(void);
+
+  // This returns the time that "permille" thousandths of all recorded times
+  // are at or below (e.g. 500 for the median, 990 for the 99th percentile).
+  // This returns 0 if nothing has been recorded.
+  uint64_t GetPercentile(int permille);
+};
+
+
+// One histogram per profiled stage.
+
+class nloop_Profiler_t
+{
+protected:
+  nloop_CycleHistogram_t stages[NLOOP_PROF_STAGECOUNT];
+
+public:
+  // Default constructor and destructor are fine.
+
+  void Clear(void);
+
+  // This adds one elapsed time to a stage's histogram.
+  // Out-of-range stages are ignored.
+  void Record(int stageidx, uint64_t ticks);
+
+  // This returns NULL if the stage index is out of range.
+  nloop_CycleHistogram_t *GetStage(int stageidx);
+
+  // This returns false if the stage index is out of range or the stage
+  // hasn't been called.
+  bool GetStageSummary(int stageidx, uint64_t &count, uint64_t &p50,
+    uint64_t &p99, uint64_t &maxval);
+
+  void MergeFrom(nloop_Profiler_t &other);
+};
+
+
+#ifdef NLOOP_PROFILE
+
+// This records the time from construction to destruction. Use it through
+// NLOOP_PROFILE_SCOPE().
+
+class nloop_ProfileScope_t
+{
+protected:
+  int stageidx;
+  uint64_t start_ticks;
+
+public:
+  nloop_ProfileScope_t(int new_stage);
+  ~nloop_ProfileScope_t(void);
+};
+
+#endif
+
+
+//
+// Functions
+
+// This returns the profiler that instrumented calls record into.
+nloop_Profiler_t &nloop_GetProfiler(void);
+
+// This returns a short human-readable stage name, or "unknown".
+const char *nloop_GetProfileStageName(int stageidx);
+
+
+//
+// Macros
+
+#ifdef NLOOP_PROFILE
+
+#ifndef NLOOP_PROFILE_CLOCK
+#if ( defined(__x86_64__) || defined(__i386__) ) \
+  && !defined(NLOOP_PROFILE_CLOCK_GETTIME)
+#include <x86intrin.h>
+#define NLOOP_PROFILE_CLOCK() ((uint64_t) __rdtsc())
+#else
+#include <time.h>
+#define NLOOP_PROFILE_USE_GETTIME
+// This reads CLOCK_MONOTONIC in nanoseconds.
+uint64_t nloop_ReadProfileClockNs(void);
+#define NLOOP_PROFILE_CLOCK() nloop_ReadProfileClockNs()
+#endif
+#endif
+
+// This times the rest of the enclosing block as stage "stageidx".
+#define NLOOP_PROFILE_SCOPE(stageidx) \
+  nloop_ProfileScope_t nloop_profile_scope(stageidx)
+
+#else
+
+#define NLOOP_PROFILE_SCOPE(stageidx)
+
+#endif
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-profile-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
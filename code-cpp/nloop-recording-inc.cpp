@@ -0,0 +1,251 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Raw binary recording reader - Template implementations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// Functions
+
+
+// This returns the raw sample type matching a C type, or NLOOP_RAW_NONE.
+// NOTE - Full specializations aren't templates anymore, so they have to be
+// declared "inline" to avoid link-time collisions.
+
+template<class samptype_t> nloop_rawtype_t nloop_RawTypeOf(void)
+{ return NLOOP_RAW_NONE; }
+
+template<> inline nloop_rawtype_t nloop_RawTypeOf<int16_t>(void)
+{ return NLOOP_RAW_INT16; }
+
+template<> inline nloop_rawtype_t nloop_RawTypeOf<uint16_t>(void)
+{ return NLOOP_RAW_UINT16; }
+
+template<> inline nloop_rawtype_t nloop_RawTypeOf<int32_t>(void)
+{ return NLOOP_RAW_INT32; }
+
+template<> inline nloop_rawtype_t nloop_RawTypeOf<float>(void)
+{ return NLOOP_RAW_FLOAT32; }
+
+
+//
+// nloop_RawRecording_t Class
+
+
+// Block conversion, once the file type is known.
+// NOTE - The type switch happens once per batch, not once per sample.
+
+// NOTE - A header that isn't a multiple of the sample size leaves samples
+// misaligned, so samples are copied out with memcpy() rather than read
+// through a typed pointer. Compilers turn this into a plain load.
+
+template<class filetype_t, class samptype_t, int slicechans>
+void nloop_RawRecording_t::ConvertFrames(size_t firstframe, size_t count,
+  nloop_SampleSlice_t<samptype_t,1,slicechans> *slices)
+{
+  const uint8_t *src;
+  samptype_t *dst;
+  filetype_t rawval;
+  size_t fidx;
+  int cidx, copychans;
+  int64_t thisval, minval, maxval;
+  double thisfloat, maxlimit;
+
+  copychans = chancount;
+  if (copychans > slicechans)
+    copychans = slicechans;
+
+  minval = NLOOP_MINVAL(samptype_t);
+  maxval = NLOOP_MAXVAL(samptype_t);
+
+  // NOTE - For 64-bit types, "maxval" rounds up to 2^63 as a double, and
+  // converting that back is out of range. Compare against maxval + 1
+  // instead; it's a power of two, so it's exact.
+  maxlimit = 2.0 * (double) (maxval / 2 + 1);
+
+  for (fidx = 0; fidx < count; fidx++)
+  {
+    src = framedata + (firstframe + fidx) * framebytes;
+    dst = slices[fidx].data[0];
+
+    // Float samples always go through the saturating path, since
+    // converting an out-of-range float to an integer is undefined.
+    if (NLOOP_RAW_FLOAT32 == datatype)
+    {
+      for (cidx = 0; cidx < copychans; cidx++)
+      {
+        memcpy(&rawval, src + cidx * sizeof(filetype_t), sizeof(filetype_t));
+        thisfloat = rawval * scale_gain + scale_offset;
+        // Round to nearest, and saturate. NaN gives 0.
+        // NOTE - NaN is the only value that doesn't equal itself.
+        thisfloat += (thisfloat < 0) ? -0.5 : 0.5;
+        if (thisfloat != thisfloat)
+          thisval = 0;
+        else if (thisfloat >= maxlimit)
+          thisval = maxval;
+        else if (thisfloat <= minval)
+          thisval = minval;
+        else
+          thisval = (int64_t) thisfloat;
+        dst[cidx] = (samptype_t) thisval;
+      }
+    }
+    else if (!is_scaled)
+    {
+      // The file type may be wider than the slice type, so this saturates.
+      for (cidx = 0; cidx < copychans; cidx++)
+      {
+        memcpy(&rawval, src + cidx * sizeof(filetype_t), sizeof(filetype_t));
+        thisval = rawval;
+        if (thisval < minval)
+          thisval = minval;
+        if (thisval > maxval)
+          thisval = maxval;
+        dst[cidx] = (samptype_t) thisval;
+      }
+    }
+    else
+    {
+      // SetScaling() bounds "scale_mult" and "scale_offset" so that this
+      // can't overflow for 32-bit file samples.
+      for (cidx = 0; cidx < copychans; cidx++)
+      {
+        memcpy(&rawval, src + cidx * sizeof(filetype_t), sizeof(filetype_t));
+        thisval = rawval;
+        thisval *= scale_mult;
+        NLOOP_ARITHSHR(thisval, NLOOP_RECORDING_SCALE_BITS);
+        thisval += scale_offset;
+        if (thisval < minval)
+          thisval = minval;
+        if (thisval > maxval)
+          thisval = maxval;
+        dst[cidx] = (samptype_t) thisval;
+      }
+    }
+
+    for (cidx = copychans; cidx < slicechans; cidx++)
+      dst[cidx] = 0;
+  }
+}
+
+
+
+// This returns a pointer to up to "count" consecutive slices starting at
+// "firstframe", pointing directly into the file, and trims "count" to
+// the number available. It returns NULL if the slice type doesn't match
+// the file exactly or if scaling is enabled.
+
+template<class samptype_t, int slicechans>
+const nloop_SampleSlice_t<samptype_t,1,slicechans> *
+nloop_RawRecording_t::GetSliceViews(size_t firstframe, size_t &count)
+{
+  const uint8_t *firstptr;
+
+  if ( (NULL == framedata) || is_scaled || (firstframe >= framecount)
+    || (nloop_RawTypeOf<samptype_t>() != datatype)
+    || (slicechans != chancount)
+    || (sizeof(nloop_SampleSlice_t<samptype_t,1,slicechans>) != framebytes) )
+  {
+    count = 0;
+    return NULL;
+  }
+
+  firstptr = framedata + firstframe * framebytes;
+
+  // A non-zero header size can leave samples misaligned.
+  if ( 0 != ( ((uintptr_t) firstptr) % sizeof(samptype_t) ) )
+  {
+    count = 0;
+    return NULL;
+  }
+
+  if (count > (framecount - firstframe))
+    count = framecount - firstframe;
+
+  return (const nloop_SampleSlice_t<samptype_t,1,slicechans> *) firstptr;
+}
+
+
+
+// This converts up to "count" frames starting at "firstframe" into
+// slices, returning the number converted.
+
+template<class samptype_t, int slicechans>
+size_t nloop_RawRecording_t::ReadSlices(size_t firstframe, size_t count,
+  nloop_SampleSlice_t<samptype_t,1,slicechans> *slices)
+{
+  if ( (NULL == framedata) || (NULL == slices)
+    || (firstframe >= framecount) )
+    return 0;
+
+  if (count > (framecount - firstframe))
+    count = framecount - firstframe;
+
+  switch (datatype)
+  {
+    case NLOOP_RAW_INT16:
+      ConvertFrames<int16_t, samptype_t, slicechans>(
+        firstframe, count, slices);
+      break;
+
+    case NLOOP_RAW_UINT16:
+      ConvertFrames<uint16_t, samptype_t, slicechans>(
+        firstframe, count, slices);
+      break;
+
+    case NLOOP_RAW_INT32:
+      ConvertFrames<int32_t, samptype_t, slicechans>(
+        firstframe, count, slices);
+      break;
+
+    case NLOOP_RAW_FLOAT32:
+      ConvertFrames<float, samptype_t, slicechans>(
+        firstframe, count, slices);
+      break;
+
+    default:
+      count = 0;
+      break;
+  }
+
+  return count;
+}
+
+
+
+// Sequential access.
+
+template<class samptype_t, int slicechans>
+const nloop_SampleSlice_t<samptype_t,1,slicechans> *
+nloop_RawRecording_t::ViewNextSlices(size_t &count)
+{
+  const nloop_SampleSlice_t<samptype_t,1,slicechans> *result;
+
+  result = GetSliceViews<samptype_t, slicechans>(cursor, count);
+  AdvanceCursor(count);
+
+  return result;
+}
+
+
+
+template<class samptype_t, int slicechans>
+size_t nloop_RawRecording_t::ReadNextSlices(size_t count,
+  nloop_SampleSlice_t<samptype_t,1,slicechans> *slices)
+{
+  count = ReadSlices<samptype_t, slicechans>(cursor, count, slices);
+  AdvanceCursor(count);
+
+  return count;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,380 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Raw binary recording reader - non-template functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <math.h>
+
+// POSIX includes for mmap() and madvise().
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+//
+// Functions
+
+
+// This returns the number of bytes per sample for a sample type, or 0 if
+// the type isn't valid.
+
+int nloop_RawTypeBytes(nloop_rawtype_t datatype)
+{
+  int result;
+
+  result = 0;
+
+  switch (datatype)
+  {
+    case NLOOP_RAW_INT16:
+    case NLOOP_RAW_UINT16:
+      result = 2;
+      break;
+
+    case NLOOP_RAW_INT32:
+    case NLOOP_RAW_FLOAT32:
+      result = 4;
+      break;
+
+    default:
+      break;
+  }
+
+  return result;
+}
+
+
+
+//
+// nloop_RawRecording_t Class
+
+
+// Constructor.
+
+nloop_RawRecording_t::nloop_RawRecording_t(void)
+{
+  filedata = NULL;
+  filesize = 0;
+  is_mapped = false;
+
+  framedata = NULL;
+  framecount = 0;
+  framebytes = 0;
+  chancount = 0;
+  datatype = NLOOP_RAW_NONE;
+
+  ClearScaling();
+
+  cursor = 0;
+  readahead_frames = 0;
+  prefetched_to = 0;
+}
+
+
+
+// Destructor.
+
+nloop_RawRecording_t::~nloop_RawRecording_t(void)
+{
+  Close();
+}
+
+
+
+// This checks geometry and sets up frame pointers.
+
+bool nloop_RawRecording_t::SetGeometry(const uint8_t *newdata,
+  size_t newsize, int newchancount, nloop_rawtype_t newtype,
+  size_t headerbytes)
+{
+  size_t newframebytes;
+
+  if ( (NULL == newdata) || (newchancount < 1) )
+    return false;
+
+  newframebytes = ((size_t) newchancount) * nloop_RawTypeBytes(newtype);
+
+  if ( (0 == newframebytes) || (headerbytes > newsize) )
+    return false;
+
+  // A truncated last frame usually means the channel count is wrong.
+  if ( 0 != ((newsize - headerbytes) % newframebytes) )
+    return false;
+
+  filedata = newdata;
+  filesize = newsize;
+  framedata = newdata + headerbytes;
+  framebytes = newframebytes;
+  framecount = (newsize - headerbytes) / newframebytes;
+  chancount = newchancount;
+  datatype = newtype;
+
+  cursor = 0;
+  prefetched_to = 0;
+  readahead_frames = NLOOP_RECORDING_READAHEAD_BYTES / framebytes;
+
+  return true;
+}
+
+
+
+// This memory-maps a recording file.
+// It returns false if the file couldn't be read or the geometry is wrong.
+
+bool nloop_RawRecording_t::OpenFile(string filename, int newchancount,
+  nloop_rawtype_t newtype, size_t headerbytes)
+{
+  int fd;
+  struct stat fileinfo;
+  void *mapptr;
+
+  Close();
+
+  fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  if ( (0 != fstat(fd, &fileinfo)) || (fileinfo.st_size <= 0) )
+  {
+    close(fd);
+    return false;
+  }
+
+  mapptr = mmap( NULL, (size_t) fileinfo.st_size, PROT_READ, MAP_PRIVATE,
+    fd, 0 );
+
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  if (MAP_FAILED == mapptr)
+    return false;
+
+  if (!SetGeometry( (const uint8_t *) mapptr, (size_t) fileinfo.st_size,
+    newchancount, newtype, headerbytes ))
+  {
+    munmap(mapptr, (size_t) fileinfo.st_size);
+    return false;
+  }
+
+  is_mapped = true;
+
+  // Replay is mostly sequential. This lets the kernel read ahead further
+  // and drop pages behind us sooner.
+  madvise(mapptr, (size_t) fileinfo.st_size, MADV_SEQUENTIAL);
+
+  return true;
+}
+
+
+
+// This uses a recording that's already in memory.
+// The buffer must stay valid until Close() is called.
+
+bool nloop_RawRecording_t::AttachBuffer(const void *buffer, size_t buflen,
+  int newchancount, nloop_rawtype_t newtype, size_t headerbytes)
+{
+  Close();
+
+  return SetGeometry( (const uint8_t *) buffer, buflen,
+    newchancount, newtype, headerbytes );
+}
+
+
+
+// This releases the mapping (if any).
+
+void nloop_RawRecording_t::Close(void)
+{
+  if (is_mapped && (NULL != filedata))
+    munmap( (void *) filedata, filesize );
+
+  filedata = NULL;
+  filesize = 0;
+  is_mapped = false;
+
+  framedata = NULL;
+  framecount = 0;
+  framebytes = 0;
+  chancount = 0;
+  datatype = NLOOP_RAW_NONE;
+
+  cursor = 0;
+  prefetched_to = 0;
+}
+
+
+
+bool nloop_RawRecording_t::IsOpen(void)
+{
+  return (NULL != framedata);
+}
+
+
+
+size_t nloop_RawRecording_t::GetFrameCount(void)
+{
+  return framecount;
+}
+
+
+
+int nloop_RawRecording_t::GetChanCount(void)
+{
+  return chancount;
+}
+
+
+
+nloop_rawtype_t nloop_RawRecording_t::GetDataType(void)
+{
+  return datatype;
+}
+
+
+
+// Scaling is applied to converted slices only.
+// The fixed-point gain and the offset are bounded so that scaling a 32-bit
+// sample can't overflow int64_t. Values past the bounds would saturate
+// every sample anyways.
+
+void nloop_RawRecording_t::SetScaling(double gain, int64_t offset)
+{
+  double fixedgain;
+
+  // NOTE - NaN fails both comparisons and ends up at the lower bound.
+  fixedgain = gain * (1 << NLOOP_RECORDING_SCALE_BITS);
+  if (fixedgain > NLOOP_RECORDING_MAX_MULT)
+    fixedgain = NLOOP_RECORDING_MAX_MULT;
+  if ( !(fixedgain >= -NLOOP_RECORDING_MAX_MULT) )
+    fixedgain = -NLOOP_RECORDING_MAX_MULT;
+
+  if (offset > NLOOP_RECORDING_MAX_OFFSET)
+    offset = NLOOP_RECORDING_MAX_OFFSET;
+  if (offset < -NLOOP_RECORDING_MAX_OFFSET)
+    offset = -NLOOP_RECORDING_MAX_OFFSET;
+
+  scale_gain = gain;
+  scale_offset = offset;
+  scale_mult = (int64_t) llround(fixedgain);
+
+  is_scaled = ( (1.0 != gain) || (0 != offset) );
+}
+
+
+
+void nloop_RawRecording_t::ClearScaling(void)
+{
+  SetScaling(1.0, 0);
+}
+
+
+
+void nloop_RawRecording_t::SetReadAheadFrames(size_t newframes)
+{
+  readahead_frames = newframes;
+}
+
+
+
+size_t nloop_RawRecording_t::GetReadAheadFrames(void)
+{
+  return readahead_frames;
+}
+
+
+
+// This asks the kernel to start reading the specified frames in.
+// It does nothing for caller-supplied buffers.
+
+void nloop_RawRecording_t::PrefetchFrames(size_t firstframe, size_t count)
+{
+  uintptr_t startaddr, endaddr, pagemask;
+
+  if ( (!is_mapped) || (firstframe >= framecount) || (0 == count) )
+    return;
+
+  if (count > (framecount - firstframe))
+    count = framecount - firstframe;
+
+  // madvise() wants a page-aligned start address.
+  pagemask = ((uintptr_t) sysconf(_SC_PAGESIZE)) - 1;
+
+  startaddr = (uintptr_t) (framedata + firstframe * framebytes);
+  endaddr = startaddr + count * framebytes;
+  startaddr &= ~pagemask;
+
+  madvise( (void *) startaddr, endaddr - startaddr, MADV_WILLNEED );
+}
+
+
+
+// This returns a pointer to one frame's raw samples.
+// NOTE - No bounds checking, for speed.
+
+const void *nloop_RawRecording_t::GetFrameData(size_t frameidx)
+{
+  return framedata + frameidx * framebytes;
+}
+
+
+
+// Sequential access.
+
+void nloop_RawRecording_t::Rewind(void)
+{
+  Seek(0);
+}
+
+
+
+void nloop_RawRecording_t::Seek(size_t frameidx)
+{
+  if (frameidx > framecount)
+    frameidx = framecount;
+
+  cursor = frameidx;
+
+  // Start read-ahead over from here.
+  prefetched_to = cursor;
+}
+
+
+
+size_t nloop_RawRecording_t::GetPosition(void)
+{
+  return cursor;
+}
+
+
+
+// This advances the cursor and issues read-ahead if needed.
+// Read-ahead is issued in half-window steps, so that there's one system
+// call per several blocks rather than one per block.
+
+void nloop_RawRecording_t::AdvanceCursor(size_t count)
+{
+  cursor += count;
+
+  if ( (0 == readahead_frames) || (!is_mapped) )
+    return;
+
+  if ( (cursor + (readahead_frames / 2)) >= prefetched_to )
+  {
+    if (prefetched_to < cursor)
+      prefetched_to = cursor;
+
+    PrefetchFrames(prefetched_to, cursor + readahead_frames - prefetched_to);
+    prefetched_to = cursor + readahead_frames;
+  }
+}
+
+
+//
+// This is the end of the file.
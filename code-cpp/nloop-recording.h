@@ -0,0 +1,209 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Raw binary recording reader.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - Reading recording files uses mmap() and madvise(), so this needs a
+// POSIX system. Recordings can also be read from a buffer already in memory.
+
+//
+// Wrapper.
+#ifndef NLOOP_RECORDING_H
+#define NLOOP_RECORDING_H
+
+
+// A raw recording is a headerless (or fixed-header) file of interleaved
+// samples: all channels for frame 0, then all channels for frame 1, and so
+// on. This is the Open Ephys ".dat" layout (int16, no header).
+
+// Frames can be handed out two ways:
+// - As zero-copy slice views, pointing directly into the mapped file. This
+// only works if the file's sample type and channel count match the slice
+// type exactly and no scaling is applied.
+// - As converted slices, copied in batches. This handles any sample type,
+// channel count, and scaling.
+
+// Sequential reads advise the kernel to prefetch the next few blocks, so
+// that offline replay is limited by processing rather than by disk I/O.
+
+// NOTE - Samples are assumed to be in host byte order. Open Ephys files are
+// little-endian, as are x86 and ARM workstations.
+
+
+//
+// Constants
+
+// Sample types.
+enum nloop_rawtype_t
+{
+  NLOOP_RAW_NONE = 0,
+  NLOOP_RAW_INT16 = 1,
+  NLOOP_RAW_UINT16 = 2,
+  NLOOP_RAW_INT32 = 3,
+  NLOOP_RAW_FLOAT32 = 4
+};
+
+// Default read-ahead distance, in bytes.
+#define NLOOP_RECORDING_READAHEAD_BYTES (4 * 1024 * 1024)
+
+// Fractional bits used for integer scaling.
+#define NLOOP_RECORDING_SCALE_BITS 16
+
+// Limits on the fixed-point gain and on the offset. A 32-bit sample times
+// the gain is at most 2^62, and the offset keeps the sum below 2^63.
+#define NLOOP_RECORDING_MAX_MULT (1LL << 31)
+#define NLOOP_RECORDING_MAX_OFFSET (1LL << 62)
+
+
+//
+// Classes
+
+
+// Raw recording reader.
+
+class nloop_RawRecording_t
+{
+protected:
+  // Mapped file contents, or a caller-supplied buffer.
+  const uint8_t *filedata;
+  size_t filesize;
+  bool is_mapped;
+
+  // Geometry. "framedata" points past the header.
+  const uint8_t *framedata;
+  size_t framecount;
+  size_t framebytes;
+  int chancount;
+  nloop_rawtype_t datatype;
+
+  // Scaling: output = input * gain + offset.
+  // Integer inputs use a fixed-point gain for speed.
+  bool is_scaled;
+  double scale_gain;
+  int64_t scale_offset;
+  int64_t scale_mult;
+
+  // Sequential read position and read-ahead bookkeeping.
+  size_t cursor;
+  size_t readahead_frames;
+  size_t prefetched_to;
+
+  // This checks geometry and sets up frame pointers.
+  bool SetGeometry(const uint8_t *newdata, size_t newsize,
+    int newchancount, nloop_rawtype_t newtype, size_t headerbytes);
+
+  // This advances the cursor and issues read-ahead if needed.
+  void AdvanceCursor(size_t count);
+
+  // Block conversion, once the file type is known.
+  template<class filetype_t, class samptype_t, int slicechans>
+  void ConvertFrames(size_t firstframe, size_t count,
+    nloop_SampleSlice_t<samptype_t,1,slicechans> *slices);
+
+public:
+  nloop_RawRecording_t(void);
+  ~nloop_RawRecording_t(void);
+
+  // These return false if the file couldn't be read or its size isn't a
+  // whole number of frames. Any previously opened file is closed first.
+  // "headerbytes" bytes at the start of the file are skipped.
+  bool OpenFile(string filename, int newchancount, nloop_rawtype_t newtype,
+    size_t headerbytes = 0);
+  // The buffer must stay valid until Close() is called.
+  bool AttachBuffer(const void *buffer, size_t buflen, int newchancount,
+    nloop_rawtype_t newtype, size_t headerbytes = 0);
+
+  void Close(void);
+  bool IsOpen(void);
+
+  size_t GetFrameCount(void);
+  int GetChanCount(void);
+  nloop_rawtype_t GetDataType(void);
+
+  // Scaling is applied to converted slices only. Output saturates at the
+  // limits of the slice's sample type, scaled or not.
+  // Gains beyond +/-32768 and offsets beyond +/-2^62 are clamped.
+  // NOTE - Scaled output assumes an integer slice sample type.
+  void SetScaling(double gain, int64_t offset);
+  void ClearScaling(void);
+
+  // Read-ahead distance for sequential reads, in frames. 0 disables it.
+  void SetReadAheadFrames(size_t newframes);
+  size_t GetReadAheadFrames(void);
+
+  // This asks the kernel to start reading the specified frames in.
+  // It does nothing for caller-supplied buffers.
+  void PrefetchFrames(size_t firstframe, size_t count);
+
+  // This returns a pointer to one frame's raw samples.
+  // NOTE - No bounds checking, for speed.
+  const void *GetFrameData(size_t frameidx);
+
+
+  // Random access.
+
+  // This returns a pointer to up to "count" consecutive slices starting at
+  // "firstframe", pointing directly into the file, and trims "count" to
+  // the number available. It returns NULL if the slice type doesn't match
+  // the file exactly or if scaling is enabled.
+  template<class samptype_t, int slicechans>
+  const nloop_SampleSlice_t<samptype_t,1,slicechans> *GetSliceViews(
+    size_t firstframe, size_t &count);
+
+  // This converts up to "count" frames starting at "firstframe" into
+  // slices, returning the number converted. File channels past the end of
+  // the slice are dropped, and slice channels past the end of the file are
+  // zeroed.
+  template<class samptype_t, int slicechans>
+  size_t ReadSlices(size_t firstframe, size_t count,
+    nloop_SampleSlice_t<samptype_t,1,slicechans> *slices);
+
+
+  // Sequential access. These advance the read position and prefetch.
+
+  void Rewind(void);
+  void Seek(size_t frameidx);
+  size_t GetPosition(void);
+
+  template<class samptype_t, int slicechans>
+  const nloop_SampleSlice_t<samptype_t,1,slicechans> *ViewNextSlices(
+    size_t &count);
+
+  template<class samptype_t, int slicechans>
+  size_t ReadNextSlices(size_t count,
+    nloop_SampleSlice_t<samptype_t,1,slicechans> *slices);
+};
+
+
+
+//
+// Functions
+
+
+// This returns the number of bytes per sample for a sample type, or 0 if
+// the type isn't valid.
+int nloop_RawTypeBytes(nloop_rawtype_t datatype);
+
+// This returns the raw sample type matching a C type, or NLOOP_RAW_NONE.
+template<class samptype_t> nloop_rawtype_t nloop_RawTypeOf(void);
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-recording-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,39 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Real-time loop helpers for workstations - template functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// Functions
+
+
+// This prefaults a module instance, slice, or other object.
+
+template <class object_t>
+void nloop_RTPrefault(object_t &object)
+{
+  nloop_RTPrefaultMemory( (void *) &object, sizeof(object_t) );
+}
+
+
+
+// This prefaults an array of objects.
+
+template <class object_t>
+void nloop_RTPrefaultArray(object_t *objects, size_t count)
+{
+  if (NULL != objects)
+    nloop_RTPrefaultMemory( (void *) objects, count * sizeof(object_t) );
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,323 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Real-time loop helpers for workstations - non-template functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+// POSIX includes for scheduling, memory locking, and clocks.
+#include <sys/mman.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <alloca.h>
+
+
+//
+// nloop_DeadlineMonitor_t Class
+
+
+// Constructor.
+
+nloop_DeadlineMonitor_t::nloop_DeadlineMonitor_t(void)
+{
+  period_ns = 1000000;
+  deadline_ns = 1000000;
+  release_ns = 0;
+  is_started = false;
+
+  ClearStats();
+}
+
+
+
+// This sets the period and deadline, clears statistics, and makes the
+// next release happen one period from now.
+
+void nloop_DeadlineMonitor_t::Start(uint64_t new_period_ns,
+  uint64_t new_deadline_ns)
+{
+  period_ns = (0 < new_period_ns) ? new_period_ns : 1;
+  deadline_ns = new_deadline_ns;
+
+  ClearStats();
+
+  // This is the previous cycle's release; WaitForRelease() advances it.
+  release_ns = nloop_RTGetTimeNs();
+  is_started = true;
+}
+
+
+
+// This sleeps until the next scheduled release and records jitter. It
+// returns false if the release time had already passed.
+
+bool nloop_DeadlineMonitor_t::WaitForRelease(void)
+{
+  struct timespec wakeup;
+  uint64_t now_ns, behind;
+  bool is_on_time;
+
+  if (!is_started)
+    Start(period_ns, deadline_ns);
+
+  release_ns += period_ns;
+  now_ns = nloop_RTGetTimeNs();
+
+  // If we're more than a period behind, skip the releases we missed
+  // instead of running them back-to-back.
+  if (now_ns > (release_ns + period_ns))
+  {
+    behind = (now_ns - release_ns) / period_ns;
+    release_ns += behind * period_ns;
+    skip_count += behind;
+  }
+
+  is_on_time = (now_ns < release_ns);
+
+  if (is_on_time)
+  {
+    wakeup.tv_sec = (time_t) (release_ns / 1000000000ull);
+    wakeup.tv_nsec = (long) (release_ns % 1000000000ull);
+
+    while ( EINTR == clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME,
+      &wakeup, NULL ) )
+      ;
+
+    now_ns = nloop_RTGetTimeNs();
+  }
+
+  jitter.Record( (now_ns > release_ns) ? (now_ns - release_ns) : 0 );
+
+  return is_on_time;
+}
+
+
+
+// This records the response time of the current cycle, and checks it
+// against the deadline.
+
+void nloop_DeadlineMonitor_t::EndCycle(void)
+{
+  uint64_t now_ns, elapsed;
+
+  now_ns = nloop_RTGetTimeNs();
+  elapsed = (now_ns > release_ns) ? (now_ns - release_ns) : 0;
+
+  response.Record(elapsed);
+  cycle_count++;
+
+  if (elapsed > deadline_ns)
+    miss_count++;
+}
+
+
+
+// This clears statistics without changing the schedule.
+
+void nloop_DeadlineMonitor_t::ClearStats(void)
+{
+  cycle_count = 0;
+  miss_count = 0;
+  skip_count = 0;
+
+  jitter.Clear();
+  response.Clear();
+}
+
+
+
+// Accessors.
+
+uint64_t nloop_DeadlineMonitor_t::GetPeriodNs(void)
+{
+  return period_ns;
+}
+
+uint64_t nloop_DeadlineMonitor_t::GetDeadlineNs(void)
+{
+  return deadline_ns;
+}
+
+uint64_t nloop_DeadlineMonitor_t::GetCycleCount(void)
+{
+  return cycle_count;
+}
+
+uint64_t nloop_DeadlineMonitor_t::GetMissCount(void)
+{
+  return miss_count;
+}
+
+uint64_t nloop_DeadlineMonitor_t::GetSkipCount(void)
+{
+  return skip_count;
+}
+
+nloop_CycleHistogram_t &nloop_DeadlineMonitor_t::GetJitter(void)
+{
+  return jitter;
+}
+
+nloop_CycleHistogram_t &nloop_DeadlineMonitor_t::GetResponse(void)
+{
+  return response;
+}
+
+
+
+//
+// Functions
+
+
+// This returns CLOCK_MONOTONIC in nanoseconds.
+
+uint64_t nloop_RTGetTimeNs(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return ((uint64_t) now.tv_sec) * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+
+
+// This pins the calling thread to a CPU. It returns false on failure.
+
+bool nloop_RTPinThread(int cpuidx)
+{
+  cpu_set_t cpuset;
+
+  if (0 > cpuidx)
+    return false;
+
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpuidx, &cpuset);
+
+  return ( 0 == pthread_setaffinity_np( pthread_self(),
+    sizeof(cpuset), &cpuset ) );
+}
+
+
+
+// This requests SCHED_FIFO at the specified priority for the calling
+// thread. It returns false if that isn't permitted.
+
+bool nloop_RTSetFIFO(int priority)
+{
+  struct sched_param param;
+  int minprio, maxprio;
+
+  minprio = sched_get_priority_min(SCHED_FIFO);
+  maxprio = sched_get_priority_max(SCHED_FIFO);
+
+  if (priority < minprio)
+    priority = minprio;
+  if (priority > maxprio)
+    priority = maxprio;
+
+  param.sched_priority = priority;
+
+  return ( 0 == pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) );
+}
+
+
+
+// This locks all current and future pages in memory. It returns false if
+// that isn't permitted.
+
+bool nloop_RTLockMemory(void)
+{
+  return ( 0 == mlockall(MCL_CURRENT | MCL_FUTURE) );
+}
+
+
+
+// This touches every page in a memory range, writing back the value that
+// was read. Contents are unchanged.
+
+void nloop_RTPrefaultMemory(void *buffer, size_t bytes)
+{
+  uintptr_t addr, endaddr, pagebytes;
+  long sysbytes;
+  volatile uint8_t *thisbyte;
+
+  if ( (NULL == buffer) || (0 == bytes) )
+    return;
+
+  sysbytes = sysconf(_SC_PAGESIZE);
+  pagebytes = (0 < sysbytes) ? (uintptr_t) sysbytes
+    : NLOOP_RT_FALLBACK_PAGE_BYTES;
+
+  addr = (uintptr_t) buffer;
+  endaddr = addr + bytes;
+
+  // Touch the first byte of the range, then the start of each later page.
+  while (addr < endaddr)
+  {
+    thisbyte = (volatile uint8_t *) addr;
+    *thisbyte = *thisbyte;
+
+    addr = (addr & ~(pagebytes - 1)) + pagebytes;
+  }
+}
+
+
+
+// This touches "bytes" bytes of stack below the caller's frame.
+
+void nloop_RTPrefaultStack(size_t bytes)
+{
+  volatile uint8_t *scratch;
+  size_t bidx;
+
+  scratch = (volatile uint8_t *) alloca(bytes);
+
+  // Every byte, rather than every page, so this doesn't depend on knowing
+  // the page size. This only runs once.
+  for (bidx = 0; bidx < bytes; bidx++)
+    scratch[bidx] = 0;
+}
+
+
+
+// This pins the calling thread (if "cpuidx" is non-negative), requests
+// SCHED_FIFO (if "priority" is positive), locks memory, and prefaults the
+// stack. It returns true if everything requested succeeded.
+
+bool nloop_RTSetupThread(int cpuidx, int priority, nloop_RTStatus_t &status)
+{
+  bool is_ok;
+
+  is_ok = true;
+
+  status.is_pinned = false;
+  if (0 <= cpuidx)
+  {
+    status.is_pinned = nloop_RTPinThread(cpuidx);
+    is_ok = is_ok && status.is_pinned;
+  }
+
+  status.is_fifo = false;
+  if (0 < priority)
+  {
+    status.is_fifo = nloop_RTSetFIFO(priority);
+    is_ok = is_ok && status.is_fifo;
+  }
+
+  status.is_locked = nloop_RTLockMemory();
+  is_ok = is_ok && status.is_locked;
+
+  nloop_RTPrefaultStack(NLOOP_RT_STACK_PREFAULT_BYTES);
+
+  return is_ok;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,187 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Real-time loop helpers for workstations - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This uses POSIX scheduling, memory locking, and clock functions
+// (sched_setscheduler(), mlockall(), clock_nanosleep()), and Linux thread
+// affinity, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_RT_H
+#define NLOOP_RT_H
+
+
+// Running sample-by-sample processing on a general-purpose OS gives
+// occasional long stalls: page faults the first time memory is touched,
+// migrations between cores, and preemption by other processes. These
+// helpers set up the calling thread to avoid that:
+//
+// - nloop_RTPinThread() pins the thread to one CPU.
+// - nloop_RTSetFIFO() requests SCHED_FIFO real-time scheduling. This needs
+// root or CAP_SYS_NICE (or an "rtprio" limit); without it, the thread
+// keeps normal scheduling.
+// - nloop_RTLockMemory() locks current and future pages in RAM with
+// mlockall(). This needs a large enough RLIMIT_MEMLOCK.
+// - nloop_RTPrefault() and nloop_RTPrefaultStack() touch every page of
+// module instances, slice buffers, and the stack ahead of time, so they
+// don't fault during processing even if locking wasn't permitted.
+//
+// nloop_RTSetupThread() does all of the above and reports what worked.
+// Failures aren't fatal; the loop just has weaker timing guarantees.
+//
+// A deadline monitor paces a periodic loop and measures how well it's
+// keeping up:
+//
+//   monitor.Start(period_ns, deadline_ns);
+//   while (running)
+//   {
+//     monitor.WaitForRelease();
+//     (process one sample or block)
+//     monitor.EndCycle();
+//   }
+//
+// Release jitter is how late the loop woke up relative to its scheduled
+// release time. Response time is from the scheduled release to the end of
+// the cycle; a cycle that takes longer than the deadline is a miss. If the
+// loop falls more than a whole period behind, the releases it missed are
+// skipped (and counted) rather than run back-to-back.
+//
+// Times are in nanoseconds from CLOCK_MONOTONIC. Histograms are the same
+// fixed-bucket type used for profiling (see nloop-profile.h).
+
+
+//
+// Constants
+
+// Default SCHED_FIFO priority. Kernel threads that handle interrupts
+// typically run at 50; this is above them.
+#define NLOOP_RT_DEFAULT_PRIORITY 80
+
+// Amount of stack that nloop_RTSetupThread() prefaults, in bytes.
+#define NLOOP_RT_STACK_PREFAULT_BYTES (256 * 1024)
+
+// Page size assumed if the system doesn't report one.
+#define NLOOP_RT_FALLBACK_PAGE_BYTES 4096
+
+
+//
+// Classes
+
+
+// Results of real-time thread setup.
+
+struct nloop_RTStatus_t
+{
+  bool is_pinned;
+  bool is_fifo;
+  bool is_locked;
+};
+
+
+// Deadline monitor for periodic loops.
+
+class nloop_DeadlineMonitor_t
+{
+protected:
+  // Configuration.
+  uint64_t period_ns, deadline_ns;
+
+  // Current cycle's scheduled release time.
+  uint64_t release_ns;
+  bool is_started;
+
+  // Statistics.
+  uint64_t cycle_count, miss_count, skip_count;
+  nloop_CycleHistogram_t jitter;
+  nloop_CycleHistogram_t response;
+
+public:
+  nloop_DeadlineMonitor_t(void);
+  // Default destructor is fine.
+
+  // This sets the period and deadline, clears statistics, and makes the
+  // next release happen one period from now.
+  void Start(uint64_t new_period_ns, uint64_t new_deadline_ns);
+
+  // This sleeps until the next scheduled release and records jitter. It
+  // returns false if the release time had already passed.
+  bool WaitForRelease(void);
+
+  // This records the response time of the current cycle, and checks it
+  // against the deadline.
+  void EndCycle(void);
+
+  // This clears statistics without changing the schedule.
+  void ClearStats(void);
+
+  uint64_t GetPeriodNs(void);
+  uint64_t GetDeadlineNs(void);
+
+  // Completed cycles, cycles that missed their deadline, and releases
+  // skipped because the loop fell behind.
+  uint64_t GetCycleCount(void);
+  uint64_t GetMissCount(void);
+  uint64_t GetSkipCount(void);
+
+  nloop_CycleHistogram_t &GetJitter(void);
+  nloop_CycleHistogram_t &GetResponse(void);
+};
+
+
+//
+// Functions
+
+// This returns CLOCK_MONOTONIC in nanoseconds.
+uint64_t nloop_RTGetTimeNs(void);
+
+// This pins the calling thread to a CPU. It returns false on failure.
+bool nloop_RTPinThread(int cpuidx);
+
+// This requests SCHED_FIFO at the specified priority for the calling
+// thread. It returns false if that isn't permitted.
+bool nloop_RTSetFIFO(int priority);
+
+// This locks all current and future pages in memory. It returns false if
+// that isn't permitted.
+bool nloop_RTLockMemory(void);
+
+// This touches every page in a memory range, writing back the value that
+// was read. Contents are unchanged.
+// NOTE - Don't do this while another thread is writing to the range.
+void nloop_RTPrefaultMemory(void *buffer, size_t bytes);
+
+// This touches "bytes" bytes of stack below the caller's frame.
+void nloop_RTPrefaultStack(size_t bytes);
+
+// These prefault a module instance, slice, or other object, or an array
+// of them.
+template <class object_t> void nloop_RTPrefault(object_t &object);
+template <class object_t> void nloop_RTPrefaultArray(object_t *objects,
+  size_t count);
+
+// This pins the calling thread (if "cpuidx" is non-negative), requests
+// SCHED_FIFO (if "priority" is positive), locks memory, and prefaults the
+// stack. It returns true if everything requested succeeded.
+bool nloop_RTSetupThread(int cpuidx, int priority, nloop_RTStatus_t &status);
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-rt-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
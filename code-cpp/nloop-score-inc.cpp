@@ -0,0 +1,336 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Detection and trigger scoring - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+//
+// nloop_DetectionScorer_t Class
+
+
+// Constructor.
+
+template <int bankcount, int chancount>
+nloop_DetectionScorer_t<bankcount, chancount>::nloop_DetectionScorer_t(void)
+{
+  target_phase = 0;
+  late_window = 0;
+
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  ResetState();
+}
+
+
+
+// This records a hit or miss for a channel's current burst.
+
+template <int bankcount, int chancount>
+void nloop_DetectionScorer_t<bankcount, chancount>::ScoreBurst(int cidx,
+  bool is_hit)
+{
+  burst_total++;
+
+  if (is_hit)
+  {
+    hit_total++;
+    latencies.Record( (uint64_t) (sampcount - chans[cidx].burst_start) );
+  }
+  else
+    miss_total++;
+
+  chans[cidx].burst_start = -1;
+}
+
+
+
+// This scores one sample.
+
+template <int bankcount, int chancount>
+void nloop_DetectionScorer_t<bankcount, chancount>::ProcessSample(
+  nloop_SampleSlice_t<bool, 1, chancount> &truthflags,
+  nloop_SampleSlice_t<uint16_t, 1, chancount> &truephases,
+  nloop_SampleSlice_t<bool, bankcount, chancount> &detectflags,
+  nloop_SampleSlice_t<bool, bankcount, chancount> &trigflags)
+{
+  int bidx, cidx;
+  int32_t phase_err;
+  bool is_truth, is_detecting, is_triggering, in_event;
+
+  for (cidx = 0; cidx < chans_active; cidx++)
+  {
+    chanstate_t &chan = chans[cidx];
+
+    is_truth = truthflags.data[0][cidx];
+
+    is_detecting = false;
+    for (bidx = 0; bidx < banks_active; bidx++)
+      is_detecting = is_detecting || detectflags.data[bidx][cidx];
+
+
+    // Burst boundaries. A new burst ends the previous one's late window.
+
+    if (is_truth && (!chan.was_truth))
+    {
+      if (0 <= chan.burst_start)
+        ScoreBurst(cidx, false);
+      chan.burst_start = (int64_t) sampcount;
+    }
+
+    if ( (!is_truth) && chan.was_truth )
+      chan.late_left = late_window;
+
+    in_event = is_truth || (0 < chan.late_left);
+
+
+    // Detection.
+
+    if (0 <= chan.burst_start)
+    {
+      if (is_detecting)
+        ScoreBurst(cidx, true);
+      else if (!in_event)
+        ScoreBurst(cidx, false);
+    }
+
+    if ( is_detecting && (!chan.was_detecting) && (!in_event) )
+      false_alarm_total++;
+
+    if (!in_event)
+      quiet_total++;
+
+
+    // Triggers.
+
+    for (bidx = 0; bidx < banks_active; bidx++)
+    {
+      is_triggering = trigflags.data[bidx][cidx];
+
+      if ( is_triggering && (!chan.was_triggering[bidx]) )
+      {
+        if (is_truth)
+        {
+          // Wrap to -half..+half cycle.
+          phase_err = (int16_t) (uint16_t)
+            (truephases.data[0][cidx] - target_phase);
+
+          trig_total++;
+          phase_err_sum += phase_err;
+          phase_errors.Record( (uint64_t)
+            (phase_err < 0 ? -phase_err : phase_err) );
+        }
+        else
+          stray_total++;
+      }
+
+      chan.was_triggering[bidx] = is_triggering;
+    }
+
+
+    // Bookkeeping.
+
+    if ( (!is_truth) && (0 < chan.late_left) )
+      chan.late_left--;
+
+    chan.was_truth = is_truth;
+    chan.was_detecting = is_detecting;
+  }
+
+  sampcount++;
+}
+
+
+
+// This clears statistics and tracking state. Configuration is kept.
+
+template <int bankcount, int chancount>
+void nloop_DetectionScorer_t<bankcount, chancount>::ResetState(void)
+{
+  int bidx, cidx;
+
+  for (cidx = 0; cidx < chancount; cidx++)
+  {
+    chans[cidx].was_truth = false;
+    chans[cidx].burst_start = -1;
+    chans[cidx].late_left = 0;
+    chans[cidx].was_detecting = false;
+    for (bidx = 0; bidx < bankcount; bidx++)
+      chans[cidx].was_triggering[bidx] = false;
+  }
+
+  sampcount = 0;
+  burst_total = 0;
+  hit_total = 0;
+  miss_total = 0;
+  false_alarm_total = 0;
+  quiet_total = 0;
+  trig_total = 0;
+  stray_total = 0;
+  phase_err_sum = 0;
+
+  latencies.Clear();
+  phase_errors.Clear();
+}
+
+
+
+// Configuration accessors.
+
+template <int bankcount, int chancount>
+void nloop_DetectionScorer_t<bankcount, chancount>::SetTargetPhase(
+  uint16_t new_phase)
+{
+  target_phase = new_phase;
+}
+
+
+
+template <int bankcount, int chancount>
+void nloop_DetectionScorer_t<bankcount, chancount>::SetLateWindow(
+  int32_t new_window)
+{
+  late_window = (new_window < 0) ? 0 : new_window;
+}
+
+
+
+template <int bankcount, int chancount>
+void nloop_DetectionScorer_t<bankcount, chancount>::SetActiveGeometry(
+  int new_banks, int new_chans)
+{
+  if (new_banks < 0)
+    new_banks = 0;
+  else if (new_banks > bankcount)
+    new_banks = bankcount;
+
+  if (new_chans < 0)
+    new_chans = 0;
+  else if (new_chans > chancount)
+    new_chans = chancount;
+
+  banks_active = new_banks;
+  chans_active = new_chans;
+}
+
+
+
+template <int bankcount, int chancount>
+uint16_t nloop_DetectionScorer_t<bankcount, chancount>::GetTargetPhase(void)
+{
+  return target_phase;
+}
+
+
+
+template <int bankcount, int chancount>
+int32_t nloop_DetectionScorer_t<bankcount, chancount>::GetLateWindow(void)
+{
+  return late_window;
+}
+
+
+
+// Statistics accessors.
+
+template <int bankcount, int chancount>
+uint64_t nloop_DetectionScorer_t<bankcount, chancount>::GetSampleCount(void)
+{
+  return sampcount;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t nloop_DetectionScorer_t<bankcount, chancount>::GetBurstCount(void)
+{
+  return burst_total;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t nloop_DetectionScorer_t<bankcount, chancount>::GetHitCount(void)
+{
+  return hit_total;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t nloop_DetectionScorer_t<bankcount, chancount>::GetMissCount(void)
+{
+  return miss_total;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t
+  nloop_DetectionScorer_t<bankcount, chancount>::GetFalseAlarmCount(void)
+{
+  return false_alarm_total;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t
+  nloop_DetectionScorer_t<bankcount, chancount>::GetQuietSampleCount(void)
+{
+  return quiet_total;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t nloop_DetectionScorer_t<bankcount, chancount>::GetTriggerCount(void)
+{
+  return trig_total;
+}
+
+
+
+template <int bankcount, int chancount>
+uint64_t
+  nloop_DetectionScorer_t<bankcount, chancount>::GetStrayTriggerCount(void)
+{
+  return stray_total;
+}
+
+
+
+template <int bankcount, int chancount>
+int64_t nloop_DetectionScorer_t<bankcount, chancount>::GetPhaseErrorSum(void)
+{
+  return phase_err_sum;
+}
+
+
+
+template <int bankcount, int chancount>
+nloop_CycleHistogram_t &
+  nloop_DetectionScorer_t<bankcount, chancount>::GetLatencies(void)
+{
+  return latencies;
+}
+
+
+
+template <int bankcount, int chancount>
+nloop_CycleHistogram_t &
+  nloop_DetectionScorer_t<bankcount, chancount>::GetPhaseErrors(void)
+{
+  return phase_errors;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,161 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Detection and trigger scoring - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// Wrapper.
+#ifndef NLOOP_SCORE_H
+#define NLOOP_SCORE_H
+
+
+// A detection scorer compares a pipeline's burst detection flags and
+// trigger outputs against ground truth labels (such as those produced by
+// nloop_SynthLFP_t), and accumulates accuracy statistics.
+//
+// Truth is per-channel: a burst flag and the true oscillation phase (in
+// units of 1/65536 cycles, with 0 at the rising zero crossing). Detection
+// and trigger flags are per-bank; a channel counts as "detecting" if any
+// active bank on it is.
+//
+// Detection scoring:
+// - A true burst is a hit if detection is asserted at any point from its
+// start until "late window" samples after its end. Latency is the number
+// of samples from the start of the burst to the first sample with
+// detection asserted (0 if detection was already on).
+// - A true burst is a miss if that doesn't happen. Misses are counted when
+// the late window expires.
+// - A false alarm is a detection onset (no bank detecting to any bank
+// detecting) at a time when no true burst or late window is active.
+// Quiet samples (no burst and no late window) are counted so that false
+// alarm rates can be computed.
+//
+// Trigger scoring:
+// - Each trigger pulse onset during a true burst is scored by its phase
+// error: the true phase at the onset minus the target phase, wrapped to
+// -32768..32767.
+// - Trigger pulse onsets outside of true bursts are counted as stray.
+//
+// Latencies (in samples) and absolute phase errors (in 1/65536 cycles)
+// are kept in fixed-bucket histograms (see nloop-profile.h).
+//
+// Bursts that haven't been scored when scoring stops aren't counted.
+
+
+//
+// Classes
+
+
+template <int bankcount, int chancount>
+class nloop_DetectionScorer_t
+{
+protected:
+  // Per-channel tracking state.
+  struct chanstate_t
+  {
+    // True burst state. "burst_start" is -1 if no burst is being scored.
+    bool was_truth;
+    int64_t burst_start;
+    // Samples left in the late window, once the burst has ended.
+    int32_t late_left;
+
+    // Previous detection and trigger flags.
+    bool was_detecting;
+    bool was_triggering[bankcount];
+  };
+
+  chanstate_t chans[chancount];
+
+  // Configuration.
+  uint16_t target_phase;
+  int32_t late_window;
+
+  // Active geometry.
+  int banks_active;
+  int chans_active;
+
+  // Statistics.
+  uint64_t sampcount;
+  uint64_t burst_total, hit_total, miss_total;
+  uint64_t false_alarm_total, quiet_total;
+  uint64_t trig_total, stray_total;
+  int64_t phase_err_sum;
+  nloop_CycleHistogram_t latencies;
+  nloop_CycleHistogram_t phase_errors;
+
+
+  // This records a hit or miss for a channel's current burst.
+  void ScoreBurst(int cidx, bool is_hit);
+
+public:
+  // This targets phase 0, with no late window, and clears statistics.
+  nloop_DetectionScorer_t(void);
+  // Default destructor is fine.
+
+
+  // Processing functions.
+
+  // This scores one sample.
+  void ProcessSample(nloop_SampleSlice_t<bool, 1, chancount> &truthflags,
+    nloop_SampleSlice_t<uint16_t, 1, chancount> &truephases,
+    nloop_SampleSlice_t<bool, bankcount, chancount> &detectflags,
+    nloop_SampleSlice_t<bool, bankcount, chancount> &trigflags);
+
+
+  // Configuration.
+
+  // This clears statistics and tracking state. Configuration is kept.
+  void ResetState(void);
+
+  // Phase that triggers are supposed to hit, in 1/65536 cycles.
+  void SetTargetPhase(uint16_t new_phase);
+  // Number of samples after a true burst ends during which detection
+  // still counts as a hit.
+  void SetLateWindow(int32_t new_window);
+  void SetActiveGeometry(int new_banks, int new_chans);
+
+  uint16_t GetTargetPhase(void);
+  int32_t GetLateWindow(void);
+
+
+  // Statistics accessors.
+
+  uint64_t GetSampleCount(void);
+  // Scored bursts, hits, and misses. Hits plus misses equals bursts.
+  uint64_t GetBurstCount(void);
+  uint64_t GetHitCount(void);
+  uint64_t GetMissCount(void);
+  uint64_t GetFalseAlarmCount(void);
+  // Channel-samples with no burst or late window active.
+  uint64_t GetQuietSampleCount(void);
+  // Trigger onsets during bursts, and outside of them.
+  uint64_t GetTriggerCount(void);
+  uint64_t GetStrayTriggerCount(void);
+  // Sum of signed phase errors; divide by GetTriggerCount() for the bias.
+  int64_t GetPhaseErrorSum(void);
+
+  // Detection latencies of hits, in samples.
+  nloop_CycleHistogram_t &GetLatencies(void);
+  // Absolute phase errors of scored triggers, in 1/65536 cycles.
+  nloop_CycleHistogram_t &GetPhaseErrors(void);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-score-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,388 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Channel-sharded multi-threaded pipeline runner - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+// NOTE - The calling thread writes the block pointer and count, then
+// publishes the block through the barrier (see nloop-workers.h). It waits
+// for every shard to finish before reading shard outputs or publishing the
+// next block, so workers never see a block change under them.
+
+
+//
+// nloop_ShardedPipeline_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t, estimator_t,
+  avgcoeffbits, bankcount, shardchans, shardcount>::
+nloop_ShardedPipeline_t(void)
+{
+  targets.SetUniformValue(0);
+
+  max_block = 0;
+  pin_failures.store(0);
+
+  block_data = NULL;
+  block_count = 0;
+  start_gen = 0;
+  want_quit.store(false);
+}
+
+
+
+// Destructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t, estimator_t,
+  avgcoeffbits, bankcount, shardchans, shardcount>::
+~nloop_ShardedPipeline_t(void)
+{
+  StopWorkers();
+}
+
+
+
+// This is each worker thread's main loop.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+WorkerLoop(int shardidx, int cpuidx)
+{
+  unsigned long seen_gen;
+
+  if (!nloop_WorkerPinThread(cpuidx))
+    pin_failures.fetch_add(1);
+
+  // NOTE - Start from the generation StartWorkers() saw, not the current
+  // one. The first block may have been published before this thread got
+  // around to running.
+  seen_gen = start_gen;
+
+  while (true)
+  {
+    // Wait for the next block (or for a request to quit).
+    barrier.WaitForBlock(seen_gen);
+
+    if (want_quit.load(memory_order_acquire))
+      break;
+
+    ProcessShardBlock(shardidx);
+
+    barrier.FinishBlock();
+  }
+}
+
+
+
+// This runs detection on one block for one shard.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+ProcessShardBlock(int shardidx)
+{
+  nloop_SampleSlice_t<samptype_t, 1, shardchans> shardin;
+  shard_pipeline_t &pipe = shards[shardidx];
+  int sidx, cidx, chanoffset;
+
+  chanoffset = shardidx * shardchans;
+
+  for (sidx = 0; sidx < block_count; sidx++)
+  {
+    for (cidx = 0; cidx < shardchans; cidx++)
+      shardin.data[0][cidx] = block_data[sidx].data[0][chanoffset + cidx];
+
+    pipe.ProcessDetection(shardin);
+
+    shard_rise[shardidx][sidx].CopyFrom(pipe.GetSinceRise());
+    shard_periods[shardidx][sidx].CopyFrom(pipe.GetPeriods());
+    shard_bursts[shardidx][sidx].CopyFrom(pipe.GetBurstFlags());
+  }
+}
+
+
+
+// This starts one worker per shard.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+bool nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+StartWorkers(int new_maxblock, int first_cpu)
+{
+  int shardidx;
+
+  if ( (0 < workers.size()) || (1 > new_maxblock) )
+    return false;
+
+  max_block = new_maxblock;
+  for (shardidx = 0; shardidx < shardcount; shardidx++)
+  {
+    shard_rise[shardidx].resize(max_block);
+    shard_periods[shardidx].resize(max_block);
+    shard_bursts[shardidx].resize(max_block);
+  }
+
+  pin_failures.store(0);
+  want_quit.store(false);
+  start_gen = barrier.GetGeneration();
+
+  for (shardidx = 0; shardidx < shardcount; shardidx++)
+    workers.push_back( thread(
+      &nloop_ShardedPipeline_t::WorkerLoop, this, shardidx,
+      ( 0 <= first_cpu ? first_cpu + shardidx : -1 ) ) );
+
+  return true;
+}
+
+
+
+// This stops the workers.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+StopWorkers(void)
+{
+  size_t widx;
+
+  if (0 == workers.size())
+    return;
+
+  want_quit.store(true, memory_order_release);
+  barrier.PublishBlock();
+
+  for (widx = 0; widx < workers.size(); widx++)
+    workers[widx].join();
+
+  workers.clear();
+}
+
+
+
+// Thread status accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+bool nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+IsRunning(void)
+{
+  return (0 < workers.size());
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+int nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+GetPinFailures(void)
+{
+  return pin_failures.load();
+}
+
+
+
+// This runs "count" samples through every shard and then the trigger bank.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+bool nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+ProcessBlock(
+  nloop_SampleSlice_t<samptype_t, 1, shardchans * shardcount> *indata,
+  nloop_SampleSlice_t<bool, bankcount, shardchans * shardcount> *trigout,
+  int count )
+{
+  int firstidx, sidx, shardidx, bidx, cidx, chanoffset;
+
+  if (0 == workers.size())
+    return false;
+
+  for (firstidx = 0; firstidx < count; firstidx += max_block)
+  {
+    // Hand this chunk to the workers.
+    block_data = indata + firstidx;
+    block_count = count - firstidx;
+    if (block_count > max_block)
+      block_count = max_block;
+
+    barrier.PublishBlock();
+
+    // Wait for them to finish.
+    barrier.WaitForWorkers(shardcount);
+
+    // Merge shard outputs and trigger, in sample order.
+    for (sidx = 0; sidx < block_count; sidx++)
+    {
+      for (shardidx = 0; shardidx < shardcount; shardidx++)
+      {
+        chanoffset = shardidx * shardchans;
+
+        for (bidx = 0; bidx < bankcount; bidx++)
+          for (cidx = 0; cidx < shardchans; cidx++)
+          {
+            merged_rise.data[bidx][chanoffset + cidx] =
+              shard_rise[shardidx][sidx].data[bidx][cidx];
+            merged_periods.data[bidx][chanoffset + cidx] =
+              shard_periods[shardidx][sidx].data[bidx][cidx];
+            merged_bursts.data[bidx][chanoffset + cidx] =
+              shard_bursts[shardidx][sidx].data[bidx][cidx];
+          }
+      }
+
+      triggers.ProcessSamples( merged_rise, targets, merged_periods,
+        merged_bursts, trigout[firstidx + sidx] );
+    }
+  }
+
+  return true;
+}
+
+
+
+// This returns NULL if the shard index is out of range.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+typename nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+  shard_pipeline_t *
+nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+GetShard(int shardidx)
+{
+  if ( (0 > shardidx) || (shardcount <= shardidx) )
+    return NULL;
+
+  return &(shards[shardidx]);
+}
+
+
+
+// This sets active geometry in every shard and in the trigger bank.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+SetActiveGeometry(int new_banks, int new_chans)
+{
+  int shardidx, thischans;
+
+  for (shardidx = 0; shardidx < shardcount; shardidx++)
+  {
+    thischans = new_chans - shardidx * shardchans;
+    if (0 > thischans)
+      thischans = 0;
+    else if (shardchans < thischans)
+      thischans = shardchans;
+
+    shards[shardidx].SetActiveGeometry(new_banks, thischans);
+  }
+
+  triggers.SetActiveBanks(new_banks);
+  triggers.SetActiveChans(new_chans);
+}
+
+
+
+// Trigger accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+nloop_TriggerBank_t<indextype_t, bankcount, shardchans * shardcount> &
+nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+GetTriggers(void)
+{
+  return triggers;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+SetTargets(
+  nloop_SampleSlice_t<indextype_t, bankcount, shardchans * shardcount>
+    &new_targets )
+{
+  targets.CopyFrom(new_targets);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+SetUniformTargets(indextype_t new_target)
+{
+  targets.SetUniformValue(new_target);
+}
+
+
+
+// Checkpointing.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int shardidx;
+
+  for (shardidx = 0; shardidx < shardcount; shardidx++)
+    shards[shardidx].SaveState(statebuf);
+
+  triggers.SaveState(statebuf);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+void nloop_ShardedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, shardchans, shardcount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int shardidx;
+
+  for (shardidx = 0; shardidx < shardcount; shardidx++)
+    shards[shardidx].LoadState(statebuf);
+
+  triggers.LoadState(statebuf);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,179 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Channel-sharded multi-threaded pipeline runner - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <thread> and <atomic> from C++11 and POSIX thread
+// affinity, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_SHARDS_H
+#define NLOOP_SHARDS_H
+
+
+// A sharded pipeline splits channels across several detection pipelines
+// (see nloop-pipeline.h), each of which runs on its own worker thread.
+// Shard N handles channels N*shardchans through (N+1)*shardchans - 1.
+//
+// The calling thread hands a block of input slices to every worker at
+// once, waits for all of them to finish, and then runs the trigger bank
+// over the merged outputs one sample at a time. Triggering is the only
+// stage that couples channels (the pulse quota is shared, and is handed
+// out in bank/channel scan order), so running it full-width on the calling
+// thread gives results identical to a single-threaded pipeline with the
+// same configuration.
+//
+// Each shard pipeline is configured through GetShard(); the trigger bank
+// and trigger targets are full-width and belong to the runner. The
+// shards' own trigger banks are not used.
+//
+// NOTE - Auto-ranging with shared attenuation (ResetTracking(true)) only
+// ties channels together within a shard.
+//
+// NOTE - Workers spin while waiting for blocks (see nloop-workers.h), so
+// each one should have a core to itself. Stop the workers when the runner
+// is idle.
+//
+// NOTE - This is very large. Allocate it on the heap, not the stack.
+
+
+//
+// Classes
+
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int shardchans,
+  int shardcount>
+class nloop_ShardedPipeline_t
+{
+public:
+  typedef nloop_DetectionPipeline_t<samptype_t, indextype_t, filtbank_t,
+    estimator_t, avgcoeffbits, bankcount, shardchans> shard_pipeline_t;
+
+protected:
+  // Per-shard pipelines.
+  shard_pipeline_t shards[shardcount];
+
+  // Per-shard detection outputs for the current block. These are separate
+  // allocations so that workers don't share cache lines.
+  vector< nloop_SampleSlice_t<indextype_t, bankcount, shardchans> >
+    shard_rise[shardcount];
+  vector< nloop_SampleSlice_t<indextype_t, bankcount, shardchans> >
+    shard_periods[shardcount];
+  vector< nloop_SampleSlice_t<bool, bankcount, shardchans> >
+    shard_bursts[shardcount];
+
+  // Full-width triggering.
+  nloop_TriggerBank_t<indextype_t, bankcount, shardchans * shardcount>
+    triggers;
+  nloop_SampleSlice_t<indextype_t, bankcount, shardchans * shardcount>
+    targets;
+  nloop_SampleSlice_t<indextype_t, bankcount, shardchans * shardcount>
+    merged_rise, merged_periods;
+  nloop_SampleSlice_t<bool, bankcount, shardchans * shardcount>
+    merged_bursts;
+
+  // Worker threads.
+  vector<thread> workers;
+  int max_block;
+  atomic<int> pin_failures;
+
+  // The calling thread publishes a block by setting these and then
+  // passing the barrier. Workers start from generation "start_gen".
+  nloop_SampleSlice_t<samptype_t, 1, shardchans * shardcount> *block_data;
+  int block_count;
+  nloop_BlockBarrier_t barrier;
+  unsigned long start_gen;
+  atomic<bool> want_quit;
+
+
+  // Helper functions.
+
+  // This is each worker thread's main loop.
+  void WorkerLoop(int shardidx, int cpuidx);
+
+  // This runs detection on one block for one shard.
+  void ProcessShardBlock(int shardidx);
+
+public:
+  // This sets targets to zero. Workers aren't started.
+  nloop_ShardedPipeline_t(void);
+  // This stops the workers.
+  ~nloop_ShardedPipeline_t(void);
+
+
+  // Thread management.
+
+  // This starts one worker per shard. Blocks passed to ProcessBlock() are
+  // handed out in chunks of at most "new_maxblock" samples.
+  // If "first_cpu" is non-negative, worker N is pinned to CPU first_cpu+N.
+  // This returns false if workers are already running or the block size
+  // is invalid.
+  // NOTE - This allocates.
+  bool StartWorkers(int new_maxblock, int first_cpu);
+
+  void StopWorkers(void);
+  bool IsRunning(void);
+
+  // This is the number of workers that couldn't be pinned to their CPU.
+  // Unpinned workers still run.
+  int GetPinFailures(void);
+
+
+  // Processing functions.
+
+  // This runs "count" samples through every shard and then the trigger
+  // bank. This returns false if the workers aren't running.
+  bool ProcessBlock(
+    nloop_SampleSlice_t<samptype_t, 1, shardchans * shardcount> *indata,
+    nloop_SampleSlice_t<bool, bankcount, shardchans * shardcount> *trigout,
+    int count );
+
+
+  // Configuration.
+  // NOTE - Only configure the runner while workers are stopped or between
+  // calls to ProcessBlock().
+
+  // This returns NULL if the shard index is out of range.
+  shard_pipeline_t *GetShard(int shardidx);
+
+  // This sets active geometry in every shard and in the trigger bank.
+  // Channels are assigned to shards in order; trailing shards may have no
+  // active channels.
+  void SetActiveGeometry(int new_banks, int new_chans);
+
+  nloop_TriggerBank_t<indextype_t, bankcount, shardchans * shardcount>
+    &GetTriggers(void);
+
+  void SetTargets(
+    nloop_SampleSlice_t<indextype_t, bankcount, shardchans * shardcount>
+      &new_targets );
+  void SetUniformTargets(indextype_t new_target);
+
+
+  // Checkpointing. This saves or restores every shard's state in order,
+  // followed by the trigger bank's state.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-shards-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
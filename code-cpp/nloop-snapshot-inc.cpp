@@ -0,0 +1,539 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Binary configuration snapshots - Template implementations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// See SNAPSHOT.txt for file format information.
+
+// Section layouts (all values are int64):
+//   NLOOP_SNAP_BIQUAD:    dim0 = banks, dim1 = stages.
+//     Per bank, per stage: den0bits, den1, den2, num0, num1, num2.
+//   NLOOP_SNAP_FIR:       dim0 = banks, dim1 = stored coefficients per bank.
+//     Per bank: fracbits, coeffcount, then dim1 coefficients.
+//   NLOOP_SNAP_LUT:       dim0 = banks, dim1 = rows.
+//     Per bank, per row: input value, output value.
+//   NLOOP_SNAP_AVERAGER:  dim0 = banks, dim1 = channels.
+//     Per bank, per channel: coeff, avgbits.
+//   NLOOP_SNAP_TRIGGER:   dim0 = banks, dim1 = channels.
+//     Per bank, per channel: enabled, duration, cooldown, reraise.
+
+
+//
+// IIR Biquad Filter Banks
+
+
+// This adds a section describing a biquad filter bank's coefficients.
+// Only active banks and stages are stored.
+
+template<class samptype_t, class filtbanktype_t>
+void nloop_WriteBiquadSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank)
+{
+  vector<int64_t> values;
+  int bidx, sidx, bankcount, stagecount;
+  uint8_t den0bits;
+  samptype_t den1, den2, num0, num1, num2;
+
+  bankcount = filtbank.GetActiveBanks();
+  stagecount = filtbank.GetActiveStages();
+
+  // The accessor leaves these alone if indices are out of range.
+  den0bits = 0;
+  den1 = 0;
+  den2 = 0;
+  num0 = 0;
+  num1 = 0;
+  num2 = 0;
+
+  values.reserve(6 * bankcount * stagecount);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (sidx = 0; sidx < stagecount; sidx++)
+    {
+      filtbank.GetCoefficients( sidx, bidx,
+        den0bits, den1, den2, num0, num1, num2 );
+
+      values.push_back(den0bits);
+      values.push_back( nloop_SampleToLL<samptype_t>(den1) );
+      values.push_back( nloop_SampleToLL<samptype_t>(den2) );
+      values.push_back( nloop_SampleToLL<samptype_t>(num0) );
+      values.push_back( nloop_SampleToLL<samptype_t>(num1) );
+      values.push_back( nloop_SampleToLL<samptype_t>(num2) );
+    }
+
+  snap.AddSection( NLOOP_SNAP_BIQUAD, sectid,
+    bankcount, stagecount, values );
+}
+
+
+
+// This copies a biquad filter bank section into a filter bank, and sets the
+// bank's active bank and stage counts.
+// It returns false if the section is missing or malformed.
+
+template<class samptype_t, class filtbanktype_t>
+bool nloop_ReadBiquadSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank)
+{
+  const uint8_t *sectdata;
+  int sectidx;
+  uint32_t bankcount, stagecount;
+  uint32_t bidx, sidx;
+  size_t vidx;
+
+  // The bank's setters do their own range checks, so we only need to
+  // reject malformed sections here.
+  sectidx = snap.FindCheckedSection( NLOOP_SNAP_BIQUAD, sectid, 0, 6,
+    bankcount, stagecount );
+
+  if (sectidx < 0)
+    return false;
+
+  sectdata = snap.GetSectionData(sectidx);
+
+  vidx = 0;
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (sidx = 0; sidx < stagecount; sidx++)
+    {
+      filtbank.SetCoefficients( sidx, bidx,
+        (uint8_t) nloop_SnapshotGetValue(sectdata, vidx),
+        nloop_LLToSample<samptype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 1) ),
+        nloop_LLToSample<samptype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 2) ),
+        nloop_LLToSample<samptype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 3) ),
+        nloop_LLToSample<samptype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 4) ),
+        nloop_LLToSample<samptype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 5) ) );
+
+      vidx += 6;
+    }
+
+  // These clamp to the template geometry.
+  filtbank.SetActiveBanks(bankcount);
+  filtbank.SetActiveStages(stagecount);
+
+  return true;
+}
+
+
+
+//
+// FIR Filter Banks
+
+
+// This adds a section describing a FIR filter bank's coefficients.
+// Only active banks are stored. Every bank stores as many coefficients as
+// the longest filter, padded with zeroes.
+
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+void nloop_WriteFIRSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank)
+{
+  vector<int64_t> values;
+  int bidx, bankcount;
+  indextype_t cidx, coeffcount, maxcoeffcount;
+  uint8_t fracbits;
+
+  bankcount = filtbank.GetActiveBanks();
+
+  fracbits = 0;
+  coeffcount = 0;
+  maxcoeffcount = 0;
+  for (bidx = 0; bidx < bankcount; bidx++)
+  {
+    filtbank.GetOneGeometry(bidx, fracbits, coeffcount);
+    if (coeffcount > maxcoeffcount)
+      maxcoeffcount = coeffcount;
+  }
+
+  values.reserve(bankcount * (2 + maxcoeffcount));
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+  {
+    filtbank.GetOneGeometry(bidx, fracbits, coeffcount);
+
+    values.push_back(fracbits);
+    values.push_back(coeffcount);
+
+    for (cidx = 0; cidx < maxcoeffcount; cidx++)
+      values.push_back( (cidx < coeffcount) ?
+        nloop_SampleToLL<samptype_t>(
+          filtbank.GetOneCoefficient(bidx, cidx) )
+        : 0 );
+  }
+
+  snap.AddSection( NLOOP_SNAP_FIR, sectid,
+    bankcount, maxcoeffcount, values );
+}
+
+
+
+// This copies a FIR filter bank section into a filter bank, and sets the
+// bank's active bank count.
+// It returns false if the section is missing or malformed.
+
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+bool nloop_ReadFIRSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank)
+{
+  const uint8_t *sectdata;
+  int sectidx;
+  uint32_t bankcount, storedcount;
+  uint32_t bidx;
+  indextype_t cidx, coeffcount;
+  int64_t storedcoeffs;
+  uint8_t fracbits;
+  size_t vidx;
+
+  sectidx = snap.FindCheckedSection( NLOOP_SNAP_FIR, sectid, 2, 1,
+    bankcount, storedcount );
+
+  if (sectidx < 0)
+    return false;
+
+  sectdata = snap.GetSectionData(sectidx);
+
+  vidx = 0;
+  for (bidx = 0; bidx < bankcount; bidx++)
+  {
+    fracbits = (uint8_t) nloop_SnapshotGetValue(sectdata, vidx);
+    storedcoeffs = nloop_SnapshotGetValue(sectdata, vidx + 1);
+    vidx += 2;
+
+    // Don't read past this bank's coefficients.
+    if ( (storedcoeffs < 0) || (storedcoeffs > storedcount) )
+      storedcoeffs = storedcount;
+    coeffcount = (indextype_t) storedcoeffs;
+
+    filtbank.BlankOneFilter(bidx);
+
+    for (cidx = 0; cidx < coeffcount; cidx++)
+      filtbank.SetOneCoefficient( bidx, cidx,
+        nloop_LLToSample<samptype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + cidx) ) );
+
+    // This does bounds checking on coeffcount, so it's safe.
+    filtbank.SetOneGeometry(bidx, fracbits, coeffcount);
+
+    vidx += storedcount;
+  }
+
+  filtbank.SetActiveBanks(bankcount);
+
+  return true;
+}
+
+
+
+//
+// Lookup Tables
+
+
+// This adds a one-bank section describing a single lookup table.
+// Only active rows are stored.
+
+template <class intype_t, class outtype_t, class luttype_t>
+void nloop_WriteLookupTableSingleSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, luttype_t &lut)
+{
+  vector<int64_t> values;
+  int ridx, rowcount;
+  intype_t inval;
+  outtype_t outval;
+
+  rowcount = lut.GetActiveRows();
+
+  inval = 0;
+  outval = 0;
+
+  values.reserve(2 * rowcount);
+
+  for (ridx = 0; ridx < rowcount; ridx++)
+  {
+    lut.GetEntry(ridx, inval, outval);
+    values.push_back( nloop_SampleToLL<intype_t>(inval) );
+    values.push_back( nloop_SampleToLL<outtype_t>(outval) );
+  }
+
+  snap.AddSection( NLOOP_SNAP_LUT, sectid, 1, rowcount, values );
+}
+
+
+
+// This copies the first bank of a lookup table section into a single
+// lookup table, and sets its active row count.
+// It returns false if the section is missing or malformed.
+
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTableSingleSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, luttype_t &lut)
+{
+  const uint8_t *sectdata;
+  int sectidx;
+  uint32_t bankcount, rowcount;
+  uint32_t ridx;
+
+  sectidx = snap.FindCheckedSection( NLOOP_SNAP_LUT, sectid, 0, 2,
+    bankcount, rowcount );
+
+  if ( (sectidx < 0) || (bankcount < 1) )
+    return false;
+
+  sectdata = snap.GetSectionData(sectidx);
+
+  for (ridx = 0; ridx < rowcount; ridx++)
+    lut.SetEntry( ridx,
+      nloop_LLToSample<intype_t>(
+        nloop_SnapshotGetValue(sectdata, 2 * ridx) ),
+      nloop_LLToSample<outtype_t>(
+        nloop_SnapshotGetValue(sectdata, 2 * ridx + 1) ) );
+
+  lut.SetActiveRows(rowcount);
+
+  return true;
+}
+
+
+
+// This adds a section describing a set of per-bank lookup tables.
+// Only active banks and rows are stored.
+
+template <class intype_t, class outtype_t, class luttype_t>
+void nloop_WriteLookupTablePerBankSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, luttype_t &lut)
+{
+  vector<int64_t> values;
+  int bidx, ridx, bankcount, rowcount;
+  intype_t inval;
+  outtype_t outval;
+
+  bankcount = lut.GetActiveBanks();
+  rowcount = lut.GetActiveRows();
+
+  inval = 0;
+  outval = 0;
+
+  values.reserve(2 * bankcount * rowcount);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (ridx = 0; ridx < rowcount; ridx++)
+    {
+      lut.GetOneEntry(bidx, ridx, inval, outval);
+      values.push_back( nloop_SampleToLL<intype_t>(inval) );
+      values.push_back( nloop_SampleToLL<outtype_t>(outval) );
+    }
+
+  snap.AddSection( NLOOP_SNAP_LUT, sectid, bankcount, rowcount, values );
+}
+
+
+
+// This copies a lookup table section into a set of per-bank lookup tables,
+// and sets the active bank and row counts.
+// It returns false if the section is missing or malformed.
+
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTablePerBankSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, luttype_t &lut)
+{
+  const uint8_t *sectdata;
+  int sectidx;
+  uint32_t bankcount, rowcount;
+  uint32_t bidx, ridx;
+  size_t vidx;
+
+  sectidx = snap.FindCheckedSection( NLOOP_SNAP_LUT, sectid, 0, 2,
+    bankcount, rowcount );
+
+  if (sectidx < 0)
+    return false;
+
+  sectdata = snap.GetSectionData(sectidx);
+
+  vidx = 0;
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (ridx = 0; ridx < rowcount; ridx++)
+    {
+      lut.SetOneEntry( bidx, ridx,
+        nloop_LLToSample<intype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx) ),
+        nloop_LLToSample<outtype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 1) ) );
+
+      vidx += 2;
+    }
+
+  lut.SetActiveBanks(bankcount);
+  lut.SetActiveRows(rowcount);
+
+  return true;
+}
+
+
+
+//
+// Averager Banks
+
+
+// This adds a section describing an averager bank's coefficients and
+// averaging bit counts. Only active banks and channels are stored.
+
+template<class samptype_t, class avgbanktype_t>
+void nloop_WriteAveragerSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, avgbanktype_t &avgbank)
+{
+  vector<int64_t> values;
+  int bidx, cidx, bankcount, chancount;
+
+  bankcount = avgbank.GetActiveBanks();
+  chancount = avgbank.GetActiveChans();
+
+  values.reserve(2 * bankcount * chancount);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+    {
+      values.push_back( nloop_SampleToLL<samptype_t>(
+        avgbank.GetOneCoeff(bidx, cidx) ) );
+      values.push_back( avgbank.GetOneAvgBits(bidx, cidx) );
+    }
+
+  snap.AddSection( NLOOP_SNAP_AVERAGER, sectid,
+    bankcount, chancount, values );
+}
+
+
+
+// This copies an averager section into an averager bank, and sets the
+// active bank and channel counts.
+// It returns false if the section is missing or malformed.
+
+template<class samptype_t, class avgbanktype_t>
+bool nloop_ReadAveragerSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, avgbanktype_t &avgbank)
+{
+  const uint8_t *sectdata;
+  int sectidx;
+  uint32_t bankcount, chancount;
+  uint32_t bidx, cidx;
+  size_t vidx;
+
+  sectidx = snap.FindCheckedSection( NLOOP_SNAP_AVERAGER, sectid, 0, 2,
+    bankcount, chancount );
+
+  if (sectidx < 0)
+    return false;
+
+  sectdata = snap.GetSectionData(sectidx);
+
+  vidx = 0;
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+    {
+      avgbank.SetOneCoeff( bidx, cidx, nloop_LLToSample<samptype_t>(
+        nloop_SnapshotGetValue(sectdata, vidx) ) );
+      avgbank.SetOneAvgBits( bidx, cidx,
+        (uint8_t) nloop_SnapshotGetValue(sectdata, vidx + 1) );
+
+      vidx += 2;
+    }
+
+  avgbank.SetActiveBanks(bankcount);
+  avgbank.SetActiveChans(chancount);
+
+  return true;
+}
+
+
+
+//
+// Trigger Banks
+
+
+// This adds a section describing a trigger bank's per-trigger parameters.
+// Only active banks and channels are stored.
+
+template<class indextype_t, class trigbanktype_t>
+void nloop_WriteTriggerSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, trigbanktype_t &trigbank)
+{
+  vector<int64_t> values;
+  int bidx, cidx, bankcount, chancount;
+
+  bankcount = trigbank.GetActiveBanks();
+  chancount = trigbank.GetActiveChans();
+
+  values.reserve(4 * bankcount * chancount);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+    {
+      values.push_back( trigbank.GetOneEnableFlag(bidx, cidx) ? 1 : 0 );
+      values.push_back( nloop_SampleToLL<indextype_t>(
+        trigbank.GetOnePulseDuration(bidx, cidx) ) );
+      values.push_back( nloop_SampleToLL<indextype_t>(
+        trigbank.GetOnePulseCooldown(bidx, cidx) ) );
+      values.push_back( trigbank.GetOneReRaise(bidx, cidx) ? 1 : 0 );
+    }
+
+  snap.AddSection( NLOOP_SNAP_TRIGGER, sectid,
+    bankcount, chancount, values );
+}
+
+
+
+// This copies a trigger section into a trigger bank, and sets the active
+// bank and channel counts. Trigger state isn't touched.
+// It returns false if the section is missing or malformed.
+
+template<class indextype_t, class trigbanktype_t>
+bool nloop_ReadTriggerSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, trigbanktype_t &trigbank)
+{
+  const uint8_t *sectdata;
+  int sectidx;
+  uint32_t bankcount, chancount;
+  uint32_t bidx, cidx;
+  size_t vidx;
+
+  sectidx = snap.FindCheckedSection( NLOOP_SNAP_TRIGGER, sectid, 0, 4,
+    bankcount, chancount );
+
+  if (sectidx < 0)
+    return false;
+
+  sectdata = snap.GetSectionData(sectidx);
+
+  vidx = 0;
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+    {
+      trigbank.SetOneEnableFlag( bidx, cidx,
+        (0 != nloop_SnapshotGetValue(sectdata, vidx)) );
+      trigbank.SetOnePulseDuration( bidx, cidx,
+        nloop_LLToSample<indextype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 1) ) );
+      trigbank.SetOnePulseCooldown( bidx, cidx,
+        nloop_LLToSample<indextype_t>(
+          nloop_SnapshotGetValue(sectdata, vidx + 2) ) );
+      trigbank.SetOneReRaise( bidx, cidx,
+        (0 != nloop_SnapshotGetValue(sectdata, vidx + 3)) );
+
+      vidx += 4;
+    }
+
+  trigbank.SetActiveBanks(bankcount);
+  trigbank.SetActiveChans(chancount);
+
+  return true;
+}
+
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,487 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Binary configuration snapshots - non-template functions.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <fstream>
+#include <string.h>
+
+// POSIX includes for mmap().
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// See SNAPSHOT.txt for file format information.
+
+// File layout:
+//   Header (NLOOP_SNAPSHOT_HEADER_BYTES):
+//     8 bytes   magic (NLOOP_SNAPSHOT_MAGIC, no terminator)
+//     uint32    format version
+//     uint32    section count
+//     uint64    total file size in bytes
+//   Section table (NLOOP_SNAPSHOT_ENTRY_BYTES per section):
+//     uint32    section type
+//     uint32    section ID
+//     uint32    dimension 0 (banks)
+//     uint32    dimension 1 (stages, coefficients, rows, or channels)
+//     uint64    byte offset of section data (a multiple of 8)
+//     uint64    number of int64 values in section data
+//   Section data:
+//     int64     values
+
+
+//
+// Byte Order Helpers
+
+
+// This writes a little-endian value regardless of host byte order.
+
+void nloop_SnapshotPutLE(uint8_t *dest, uint64_t value, int bytecount)
+{
+  int bidx;
+
+  for (bidx = 0; bidx < bytecount; bidx++)
+  {
+    dest[bidx] = (uint8_t) (value & 0xff);
+    value >>= 8;
+  }
+}
+
+
+
+// This reads a little-endian value regardless of host byte order.
+
+uint64_t nloop_SnapshotGetLE(const uint8_t *src, int bytecount)
+{
+  uint64_t result;
+  int bidx;
+
+  result = 0;
+
+  for (bidx = bytecount - 1; bidx >= 0; bidx--)
+    result = (result << 8) | src[bidx];
+
+  return result;
+}
+
+
+
+//
+// nloop_SnapshotWriter_t
+
+
+// Constructor.
+
+nloop_SnapshotWriter_t::nloop_SnapshotWriter_t(void)
+{
+  Clear();
+}
+
+
+
+// This discards all sections.
+
+void nloop_SnapshotWriter_t::Clear(void)
+{
+  sect_types.clear();
+  sect_ids.clear();
+  sect_dim0s.clear();
+  sect_dim1s.clear();
+  sect_values.clear();
+}
+
+
+
+// This adds a section. If a section with the same type and ID already
+// exists, it's replaced.
+
+void nloop_SnapshotWriter_t::AddSection(uint32_t secttype, uint32_t sectid,
+  uint32_t dim0, uint32_t dim1, vector<int64_t> &values)
+{
+  size_t sidx;
+
+  for (sidx = 0; sidx < sect_types.size(); sidx++)
+    if ( (secttype == sect_types[sidx]) && (sectid == sect_ids[sidx]) )
+      break;
+
+  if (sidx >= sect_types.size())
+  {
+    sect_types.push_back(secttype);
+    sect_ids.push_back(sectid);
+    sect_dim0s.push_back(0);
+    sect_dim1s.push_back(0);
+    sect_values.push_back( vector<int64_t>() );
+  }
+
+  sect_dim0s[sidx] = dim0;
+  sect_dim1s[sidx] = dim1;
+  sect_values[sidx] = values;
+}
+
+
+
+size_t nloop_SnapshotWriter_t::GetSectionCount(void)
+{
+  return sect_types.size();
+}
+
+
+
+// This writes the snapshot to a stream. It returns false on I/O errors.
+
+bool nloop_SnapshotWriter_t::WriteToStream(ostream &outfile)
+{
+  vector<uint8_t> filedata;
+  uint8_t *thisptr;
+  size_t sidx, vidx, sectcount, offset;
+
+  sectcount = sect_types.size();
+
+
+  // Lay out the file. Everything is a multiple of 8 bytes, so section
+  // data is always aligned for direct access.
+
+  offset = NLOOP_SNAPSHOT_HEADER_BYTES
+    + sectcount * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+  for (sidx = 0; sidx < sectcount; sidx++)
+    offset += 8 * sect_values[sidx].size();
+
+  filedata.resize(offset);
+
+
+  // Header.
+
+  thisptr = filedata.data();
+  memcpy(thisptr, NLOOP_SNAPSHOT_MAGIC, 8);
+  nloop_SnapshotPutLE(thisptr + 8, NLOOP_SNAPSHOT_VERSION, 4);
+  nloop_SnapshotPutLE(thisptr + 12, sectcount, 4);
+  nloop_SnapshotPutLE(thisptr + 16, filedata.size(), 8);
+
+
+  // Section table and section data.
+
+  offset = NLOOP_SNAPSHOT_HEADER_BYTES
+    + sectcount * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+  for (sidx = 0; sidx < sectcount; sidx++)
+  {
+    thisptr = filedata.data() + NLOOP_SNAPSHOT_HEADER_BYTES
+      + sidx * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+    nloop_SnapshotPutLE(thisptr, sect_types[sidx], 4);
+    nloop_SnapshotPutLE(thisptr + 4, sect_ids[sidx], 4);
+    nloop_SnapshotPutLE(thisptr + 8, sect_dim0s[sidx], 4);
+    nloop_SnapshotPutLE(thisptr + 12, sect_dim1s[sidx], 4);
+    nloop_SnapshotPutLE(thisptr + 16, offset, 8);
+    nloop_SnapshotPutLE(thisptr + 24, sect_values[sidx].size(), 8);
+
+    thisptr = filedata.data() + offset;
+    for (vidx = 0; vidx < sect_values[sidx].size(); vidx++)
+      nloop_SnapshotPutLE( thisptr + 8 * vidx,
+        (uint64_t) sect_values[sidx][vidx], 8 );
+
+    offset += 8 * sect_values[sidx].size();
+  }
+
+
+  outfile.write( (const char *) filedata.data(), filedata.size() );
+
+  return outfile.good();
+}
+
+
+
+// This writes the snapshot to a file. It returns false on I/O errors.
+
+bool nloop_SnapshotWriter_t::WriteToFile(string filename)
+{
+  ofstream outfile;
+
+  outfile.open(filename.c_str(), ios::out | ios::binary | ios::trunc);
+  if (!outfile.is_open())
+    return false;
+
+  if (!WriteToStream(outfile))
+    return false;
+
+  outfile.close();
+
+  return !outfile.fail();
+}
+
+
+
+//
+// nloop_SnapshotFile_t
+
+
+// Constructor.
+
+nloop_SnapshotFile_t::nloop_SnapshotFile_t(void)
+{
+  filedata = NULL;
+  filesize = 0;
+  is_mapped = false;
+  sectcount = 0;
+}
+
+
+
+// Destructor.
+
+nloop_SnapshotFile_t::~nloop_SnapshotFile_t(void)
+{
+  Close();
+}
+
+
+
+// This memory-maps a snapshot file and validates it.
+// It returns false if the file couldn't be read or wasn't a valid snapshot.
+
+bool nloop_SnapshotFile_t::OpenFile(string filename)
+{
+  int fd;
+  struct stat fileinfo;
+  void *mapptr;
+  bool is_ok;
+
+  Close();
+
+  fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  if ( (0 != fstat(fd, &fileinfo)) || (fileinfo.st_size <= 0) )
+  {
+    close(fd);
+    return false;
+  }
+
+  mapptr = mmap( NULL, (size_t) fileinfo.st_size, PROT_READ, MAP_PRIVATE,
+    fd, 0 );
+
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+
+  if (MAP_FAILED == mapptr)
+    return false;
+
+  is_ok = AttachBuffer(mapptr, (size_t) fileinfo.st_size);
+
+  if (is_ok)
+    is_mapped = true;
+  else
+    munmap(mapptr, (size_t) fileinfo.st_size);
+
+  return is_ok;
+}
+
+
+
+// This validates a snapshot that's already in memory.
+// The buffer must stay valid until Close() is called.
+
+bool nloop_SnapshotFile_t::AttachBuffer(const void *buffer, size_t buflen)
+{
+  const uint8_t *bufbytes;
+  const uint8_t *thisentry;
+  uint64_t offset, valcount;
+  uint32_t sidx, newcount;
+
+  Close();
+
+  bufbytes = (const uint8_t *) buffer;
+
+  if ( (NULL == bufbytes) || (buflen < NLOOP_SNAPSHOT_HEADER_BYTES) )
+    return false;
+
+
+  // Check the header.
+
+  if (0 != memcmp(bufbytes, NLOOP_SNAPSHOT_MAGIC, 8))
+    return false;
+
+  // NOTE - Newer versions may change the layout, so reject them.
+  if (NLOOP_SNAPSHOT_VERSION != nloop_SnapshotGetLE(bufbytes + 8, 4))
+    return false;
+
+  newcount = (uint32_t) nloop_SnapshotGetLE(bufbytes + 12, 4);
+
+  if (buflen != nloop_SnapshotGetLE(bufbytes + 16, 8))
+    return false;
+
+  if ( ( ((uint64_t) buflen) - NLOOP_SNAPSHOT_HEADER_BYTES )
+    / NLOOP_SNAPSHOT_ENTRY_BYTES < newcount )
+    return false;
+
+
+  // Check that every section's data is aligned and inside the buffer.
+
+  for (sidx = 0; sidx < newcount; sidx++)
+  {
+    thisentry = bufbytes + NLOOP_SNAPSHOT_HEADER_BYTES
+      + sidx * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+    offset = nloop_SnapshotGetLE(thisentry + 16, 8);
+    valcount = nloop_SnapshotGetLE(thisentry + 24, 8);
+
+    if ( (0 != (offset & 7)) || (offset > buflen) )
+      return false;
+    if ( valcount > ((buflen - offset) / 8) )
+      return false;
+  }
+
+
+  // Everything checks out.
+
+  filedata = bufbytes;
+  filesize = buflen;
+  sectcount = newcount;
+
+  return true;
+}
+
+
+
+// This releases the mapping (if any).
+
+void nloop_SnapshotFile_t::Close(void)
+{
+  if (is_mapped && (NULL != filedata))
+    munmap( (void *) filedata, filesize );
+
+  filedata = NULL;
+  filesize = 0;
+  is_mapped = false;
+  sectcount = 0;
+}
+
+
+
+bool nloop_SnapshotFile_t::IsOpen(void)
+{
+  return (NULL != filedata);
+}
+
+
+
+// This returns the index of the matching section, or -1 if not found.
+
+int nloop_SnapshotFile_t::FindSection(uint32_t secttype, uint32_t sectid)
+{
+  const uint8_t *thisentry;
+  uint32_t sidx;
+
+  for (sidx = 0; sidx < sectcount; sidx++)
+  {
+    thisentry = filedata + NLOOP_SNAPSHOT_HEADER_BYTES
+      + sidx * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+    if ( (secttype == nloop_SnapshotGetLE(thisentry, 4))
+      && (sectid == nloop_SnapshotGetLE(thisentry + 4, 4)) )
+      return (int) sidx;
+  }
+
+  return -1;
+}
+
+
+
+// This finds a section and checks that its value count matches its
+// dimensions. It returns -1 if the section is missing or malformed.
+
+int nloop_SnapshotFile_t::FindCheckedSection(
+  uint32_t secttype, uint32_t sectid,
+  size_t valsperdim0, size_t valsperdim1,
+  uint32_t &dim0, uint32_t &dim1)
+{
+  int sectidx;
+  uint32_t thistype, thisid;
+  size_t valcount;
+
+  dim0 = 0;
+  dim1 = 0;
+
+  sectidx = FindSection(secttype, sectid);
+  if (sectidx < 0)
+    return -1;
+
+  GetSectionInfo(sectidx, thistype, thisid, dim0, dim1, valcount);
+
+  // Keep the product below from overflowing. Nothing real is this large.
+  if ( (dim0 > NLOOP_SNAPSHOT_MAXDIM) || (dim1 > NLOOP_SNAPSHOT_MAXDIM) )
+    return -1;
+
+  if ( valcount != dim0 * (valsperdim0 + dim1 * valsperdim1) )
+    return -1;
+
+  return sectidx;
+}
+
+
+
+// Section accessors.
+
+uint32_t nloop_SnapshotFile_t::GetSectionCount(void)
+{
+  return sectcount;
+}
+
+
+// NOTE - This doesn't range-check "sectidx".
+
+void nloop_SnapshotFile_t::GetSectionInfo(int sectidx,
+  uint32_t &secttype, uint32_t &sectid,
+  uint32_t &dim0, uint32_t &dim1, size_t &valcount)
+{
+  const uint8_t *thisentry;
+
+  thisentry = filedata + NLOOP_SNAPSHOT_HEADER_BYTES
+    + sectidx * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+  secttype = (uint32_t) nloop_SnapshotGetLE(thisentry, 4);
+  sectid = (uint32_t) nloop_SnapshotGetLE(thisentry + 4, 4);
+  dim0 = (uint32_t) nloop_SnapshotGetLE(thisentry + 8, 4);
+  dim1 = (uint32_t) nloop_SnapshotGetLE(thisentry + 12, 4);
+  valcount = (size_t) nloop_SnapshotGetLE(thisentry + 24, 8);
+}
+
+
+
+// This returns a pointer to a section's raw little-endian data.
+// NOTE - This doesn't range-check "sectidx".
+
+const uint8_t *nloop_SnapshotFile_t::GetSectionData(int sectidx)
+{
+  const uint8_t *thisentry;
+
+  thisentry = filedata + NLOOP_SNAPSHOT_HEADER_BYTES
+    + sectidx * NLOOP_SNAPSHOT_ENTRY_BYTES;
+
+  return filedata + nloop_SnapshotGetLE(thisentry + 16, 8);
+}
+
+
+
+// This decodes one value from a section.
+// NOTE - No bounds checking, for speed. Use GetSectionInfo() first.
+
+int64_t nloop_SnapshotFile_t::GetValue(int sectidx, size_t validx)
+{
+  return nloop_SnapshotGetValue( GetSectionData(sectidx), validx );
+}
+
+
+
+//
+// This is the end of the file.
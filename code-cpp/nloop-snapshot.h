@@ -0,0 +1,231 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Binary configuration snapshots.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - Reading snapshot files uses mmap(), so this needs a POSIX system.
+// Snapshots can also be read from a buffer already in memory.
+
+//
+// Wrapper.
+#ifndef NLOOP_SNAPSHOT_H
+#define NLOOP_SNAPSHOT_H
+
+
+// A snapshot is a single binary file holding module configurations (filter
+// coefficients, lookup tables, and per-channel parameters). Loading one is
+// a bounds check and a copy, rather than a CSV parse.
+// See SNAPSHOT.txt for file format information.
+
+// All values are stored as little-endian signed 64-bit integers, so one
+// snapshot can be loaded into modules with any samptype_t.
+
+// Each section has a type and a user-chosen ID. The ID distinguishes
+// multiple sets of the same type (e.g. anti-aliasing vs filter bank).
+
+
+//
+// Constants
+
+// File signature and format version.
+#define NLOOP_SNAPSHOT_MAGIC "NLOOPSNP"
+#define NLOOP_SNAPSHOT_VERSION 1
+
+// Header and section table entry sizes, in bytes.
+#define NLOOP_SNAPSHOT_HEADER_BYTES 24
+#define NLOOP_SNAPSHOT_ENTRY_BYTES 32
+
+// Largest accepted section dimension. This is a sanity check.
+#define NLOOP_SNAPSHOT_MAXDIM 0xffffff
+
+// Section types.
+enum nloop_snapsection_t
+{
+  NLOOP_SNAP_BIQUAD = 1,
+  NLOOP_SNAP_FIR = 2,
+  NLOOP_SNAP_LUT = 3,
+  NLOOP_SNAP_AVERAGER = 4,
+  NLOOP_SNAP_TRIGGER = 5
+};
+
+
+//
+// Classes
+
+
+// Snapshot writer.
+// Sections are accumulated in memory and written out in one pass.
+
+class nloop_SnapshotWriter_t
+{
+protected:
+  // Section table, one element per section.
+  vector<uint32_t> sect_types;
+  vector<uint32_t> sect_ids;
+  vector<uint32_t> sect_dim0s;
+  vector<uint32_t> sect_dim1s;
+  vector< vector<int64_t> > sect_values;
+
+public:
+  nloop_SnapshotWriter_t(void);
+  // Default destructor is fine.
+
+  void Clear(void);
+
+  // This adds a section. If a section with the same type and ID already
+  // exists, it's replaced.
+  void AddSection(uint32_t secttype, uint32_t sectid,
+    uint32_t dim0, uint32_t dim1, vector<int64_t> &values);
+
+  size_t GetSectionCount(void);
+
+  // These write the snapshot. They return false on I/O errors.
+  bool WriteToStream(ostream &outfile);
+  bool WriteToFile(string filename);
+};
+
+
+// Snapshot reader.
+// The file is memory-mapped and validated when opened; values are decoded
+// from the mapping on request.
+
+class nloop_SnapshotFile_t
+{
+protected:
+  // Mapped file contents, or a caller-supplied buffer.
+  const uint8_t *filedata;
+  size_t filesize;
+  bool is_mapped;
+
+  uint32_t sectcount;
+
+public:
+  nloop_SnapshotFile_t(void);
+  ~nloop_SnapshotFile_t(void);
+
+  // These return false if the file couldn't be read or wasn't a valid
+  // snapshot. Any previously opened file is closed first.
+  bool OpenFile(string filename);
+  // The buffer must stay valid until Close() is called.
+  bool AttachBuffer(const void *buffer, size_t buflen);
+
+  void Close(void);
+  bool IsOpen(void);
+
+  // This returns the index of the matching section, or -1 if not found.
+  int FindSection(uint32_t secttype, uint32_t sectid);
+
+  // This finds a section and checks that its value count is
+  // dim0 * (valsperdim0 + dim1 * valsperdim1). It returns -1 if the
+  // section is missing or malformed, and the section's dimensions if not.
+  int FindCheckedSection(uint32_t secttype, uint32_t sectid,
+    size_t valsperdim0, size_t valsperdim1,
+    uint32_t &dim0, uint32_t &dim1);
+
+  // Section accessors. These don't range-check "sectidx".
+  uint32_t GetSectionCount(void);
+  void GetSectionInfo(int sectidx, uint32_t &secttype, uint32_t &sectid,
+    uint32_t &dim0, uint32_t &dim1, size_t &valcount);
+
+  // This returns a pointer to a section's raw little-endian data.
+  // Use nloop_SnapshotGetValue() to decode it.
+  const uint8_t *GetSectionData(int sectidx);
+
+  // This decodes one value from a section.
+  // NOTE - No bounds checking, for speed. Use GetSectionInfo() first.
+  int64_t GetValue(int sectidx, size_t validx);
+};
+
+
+
+//
+// Functions
+
+
+// Byte order helpers.
+
+// These read and write little-endian values regardless of host byte order.
+void nloop_SnapshotPutLE(uint8_t *dest, uint64_t value, int bytecount);
+uint64_t nloop_SnapshotGetLE(const uint8_t *src, int bytecount);
+
+// This decodes the specified value from raw section data.
+inline int64_t nloop_SnapshotGetValue(const uint8_t *sectdata, size_t validx)
+{ return (int64_t) nloop_SnapshotGetLE(sectdata + 8 * validx, 8); }
+
+
+// Module snapshot functions.
+
+// The "Write" functions add a section describing a module's configuration.
+// Only active banks/stages/channels/rows are stored.
+
+// The "Read" functions copy a section into a module. They return false if
+// the section doesn't exist or doesn't fit the module. Geometry that is
+// stored in the section (active banks, stages, rows, and channels) is
+// applied to the module.
+
+// IIR biquad filter banks.
+template<class samptype_t, class filtbanktype_t>
+void nloop_WriteBiquadSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank);
+template<class samptype_t, class filtbanktype_t>
+bool nloop_ReadBiquadSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank);
+
+// FIR filter banks.
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+void nloop_WriteFIRSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank);
+template<class samptype_t, class indextype_t, class filtbanktype_t>
+bool nloop_ReadFIRSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, filtbanktype_t &filtbank);
+
+// Single lookup tables. These are stored as one-bank LUT sections.
+template <class intype_t, class outtype_t, class luttype_t>
+void nloop_WriteLookupTableSingleSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, luttype_t &lut);
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTableSingleSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, luttype_t &lut);
+
+// Per-bank lookup tables.
+template <class intype_t, class outtype_t, class luttype_t>
+void nloop_WriteLookupTablePerBankSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, luttype_t &lut);
+template <class intype_t, class outtype_t, class luttype_t>
+bool nloop_ReadLookupTablePerBankSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, luttype_t &lut);
+
+// Averager banks (coefficients and averaging bit counts).
+template<class samptype_t, class avgbanktype_t>
+void nloop_WriteAveragerSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, avgbanktype_t &avgbank);
+template<class samptype_t, class avgbanktype_t>
+bool nloop_ReadAveragerSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, avgbanktype_t &avgbank);
+
+// Trigger banks (enable flags, pulse durations, cooldowns, re-raise flags).
+template<class indextype_t, class trigbanktype_t>
+void nloop_WriteTriggerSnapshot(nloop_SnapshotWriter_t &snap,
+  uint32_t sectid, trigbanktype_t &trigbank);
+template<class indextype_t, class trigbanktype_t>
+bool nloop_ReadTriggerSnapshot(nloop_SnapshotFile_t &snap,
+  uint32_t sectid, trigbanktype_t &trigbank);
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes and functions on-demand. The source code
+// has to be included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies
+// get pruned at link-time.
+
+#include "nloop-snapshot-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+//
+// This is the end of the file.
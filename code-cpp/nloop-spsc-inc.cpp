@@ -0,0 +1,153 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Lock-free single-producer single-consumer queue - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+// NOTE - Each side reads its own counter relaxed and the other side's
+// counter with acquire semantics, and publishes its own counter with
+// release semantics. The producer's item writes happen-before the
+// consumer's reads of that slot, and the consumer's reads happen-before
+// the producer reuses the slot.
+
+
+//
+// nloop_SPSCQueue_t Class
+
+
+// Constructor.
+
+template <class item_t, int depth>
+nloop_SPSCQueue_t<item_t, depth>::nloop_SPSCQueue_t(void)
+{
+  read_count.store(0);
+  write_count.store(0);
+}
+
+
+
+// This copies an item into the queue, returning false if it's full.
+
+template <class item_t, int depth>
+bool nloop_SPSCQueue_t<item_t, depth>::Push(item_t &item)
+{
+  item_t *slot;
+
+  slot = GetWriteSlot();
+  if (NULL == slot)
+    return false;
+
+  *slot = item;
+  CommitWrite();
+
+  return true;
+}
+
+
+
+// This returns the next free slot, or NULL if the queue is full.
+
+template <class item_t, int depth>
+item_t *nloop_SPSCQueue_t<item_t, depth>::GetWriteSlot(void)
+{
+  unsigned long writeidx;
+
+  writeidx = write_count.load(memory_order_relaxed);
+
+  if ( (writeidx - read_count.load(memory_order_acquire))
+    >= ((unsigned long) depth) )
+    return NULL;
+
+  return &(items[writeidx % depth]);
+}
+
+
+
+// This makes the slot from GetWriteSlot() visible to the consumer.
+
+template <class item_t, int depth>
+void nloop_SPSCQueue_t<item_t, depth>::CommitWrite(void)
+{
+  write_count.store( write_count.load(memory_order_relaxed) + 1,
+    memory_order_release );
+}
+
+
+
+// This copies an item out of the queue, returning false if it's empty.
+
+template <class item_t, int depth>
+bool nloop_SPSCQueue_t<item_t, depth>::Pop(item_t &item)
+{
+  item_t *slot;
+
+  slot = GetReadSlot();
+  if (NULL == slot)
+    return false;
+
+  item = *slot;
+  ReleaseRead();
+
+  return true;
+}
+
+
+
+// This returns the oldest item, or NULL if the queue is empty.
+
+template <class item_t, int depth>
+item_t *nloop_SPSCQueue_t<item_t, depth>::GetReadSlot(void)
+{
+  unsigned long readidx;
+
+  readidx = read_count.load(memory_order_relaxed);
+
+  if (readidx == write_count.load(memory_order_acquire))
+    return NULL;
+
+  return &(items[readidx % depth]);
+}
+
+
+
+// This hands the slot from GetReadSlot() back to the producer.
+
+template <class item_t, int depth>
+void nloop_SPSCQueue_t<item_t, depth>::ReleaseRead(void)
+{
+  read_count.store( read_count.load(memory_order_relaxed) + 1,
+    memory_order_release );
+}
+
+
+
+// This returns the number of items in the queue.
+
+template <class item_t, int depth>
+int nloop_SPSCQueue_t<item_t, depth>::GetCount(void)
+{
+  return (int) ( write_count.load(memory_order_acquire)
+    - read_count.load(memory_order_acquire) );
+}
+
+
+
+// This empties the queue.
+
+template <class item_t, int depth>
+void nloop_SPSCQueue_t<item_t, depth>::Clear(void)
+{
+  read_count.store(0);
+  write_count.store(0);
+}
+
+
+//
+// This is the end of the file.
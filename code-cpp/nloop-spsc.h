@@ -0,0 +1,110 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Lock-free single-producer single-consumer queue - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <atomic> from C++11, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_SPSC_H
+#define NLOOP_SPSC_H
+
+
+// An SPSC queue passes fixed-size items from exactly one producer thread to
+// exactly one consumer thread without locks. Items live in the queue;
+// either side can copy items in and out (Push()/Pop()), or work on them in
+// place (GetWriteSlot()/CommitWrite() and GetReadSlot()/ReleaseRead()).
+//
+// The read and write counters are on separate cache lines so that the
+// producer and consumer don't contend for one line. This is done with
+// explicit padding rather than "alignas", because "new" doesn't honour
+// over-aligned types before C++17.
+//
+// NOTE - Queues with large items are large. Allocate them on the heap or
+// as members of heap-allocated objects.
+
+
+//
+// Constants
+
+// Cache line size, for padding shared counters.
+#define NLOOP_CACHE_LINE_BYTES 64
+
+
+//
+// Classes
+
+
+template <class item_t, int depth>
+class nloop_SPSCQueue_t
+{
+protected:
+  item_t items[depth];
+
+  // Free-running counters. Only the consumer writes "read_count", and only
+  // the producer writes "write_count".
+  // A full line of padding between neighbours keeps each counter off the
+  // lines of the items, the other counter, and whatever follows the queue.
+  uint8_t pad_items[NLOOP_CACHE_LINE_BYTES];
+  atomic<unsigned long> read_count;
+  uint8_t pad_read[NLOOP_CACHE_LINE_BYTES];
+  atomic<unsigned long> write_count;
+  uint8_t pad_write[NLOOP_CACHE_LINE_BYTES];
+
+public:
+  nloop_SPSCQueue_t(void);
+  // Default destructor is fine.
+
+
+  // Producer functions.
+
+  // This copies an item into the queue, returning false if it's full.
+  bool Push(item_t &item);
+
+  // This returns the next free slot, or NULL if the queue is full.
+  // The item isn't visible to the consumer until CommitWrite() is called.
+  item_t *GetWriteSlot(void);
+  void CommitWrite(void);
+
+
+  // Consumer functions.
+
+  // This copies an item out of the queue, returning false if it's empty.
+  bool Pop(item_t &item);
+
+  // This returns the oldest item, or NULL if the queue is empty.
+  // The slot isn't handed back to the producer until ReleaseRead() is
+  // called.
+  item_t *GetReadSlot(void);
+  void ReleaseRead(void);
+
+
+  // Either side.
+
+  // This is a snapshot; the other side may change it immediately.
+  int GetCount(void);
+
+  // NOTE - Only call this while neither side is using the queue.
+  void Clear(void);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-spsc-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,772 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Stage-pipelined multi-threaded executor - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+// NOTE - Each module is only touched by the worker that runs its stage, so
+// modules need no locking. Stages work in place on queue slots: a worker
+// claims its input slot and its output slot, processes from one into the
+// other, and then releases the input and commits the output.
+
+
+//
+// nloop_StagedPipeline_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+nloop_StagedPipeline_t(void)
+{
+  int hidx;
+
+  want_autorange = false;
+
+  thresh_high.SetUniformValue(0);
+  thresh_low.SetUniformValue(0);
+  targets.SetUniformValue(0);
+
+  threshdual.ResetState();
+
+  for (hidx = 0; hidx < NLOOP_STAGES_HOPS; hidx++)
+  {
+    hopstats[hidx].count = 0;
+    hopstats[hidx].total_ns = 0;
+    hopstats[hidx].max_ns = 0;
+  }
+  totalstats.count = 0;
+  totalstats.total_ns = 0;
+  totalstats.max_ns = 0;
+
+  pin_failures.store(0);
+  want_quit.store(false);
+}
+
+
+
+// Destructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+~nloop_StagedPipeline_t(void)
+{
+  StopWorkers();
+}
+
+
+
+// Worker thread main loop for pre-processing.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+RangerLoop(int cpuidx)
+{
+  inpacket_t *inpkt, *outpkt;
+  int spincount;
+
+  PinToCPU(cpuidx);
+
+  spincount = 0;
+  while (!want_quit.load(memory_order_acquire))
+  {
+    inpkt = inqueue.GetReadSlot();
+    outpkt = ( NULL == inpkt ? NULL : rangedqueue.GetWriteSlot() );
+
+    if (NULL == outpkt)
+    {
+      nloop_WorkerIdleWait(spincount);
+      continue;
+    }
+    spincount = 0;
+
+    RecordLatency(hopstats[0], inpkt->push_ns, GetTimeNs());
+
+    if (want_autorange)
+    {
+      ranger.UpdateFromSample(inpkt->data);
+      ranger.GetLatchedOutput(inpkt->data, outpkt->data);
+    }
+    else
+      outpkt->data.CopyFrom(inpkt->data);
+
+    outpkt->origin_ns = inpkt->origin_ns;
+    inqueue.ReleaseRead();
+
+    outpkt->push_ns = GetTimeNs();
+    rangedqueue.CommitWrite();
+  }
+}
+
+
+
+// Worker thread main loop for filtering.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+FilterLoop(int cpuidx)
+{
+  inpacket_t *inpkt;
+  filtpacket_t *outpkt;
+  int spincount;
+
+  PinToCPU(cpuidx);
+
+  spincount = 0;
+  while (!want_quit.load(memory_order_acquire))
+  {
+    inpkt = rangedqueue.GetReadSlot();
+    outpkt = ( NULL == inpkt ? NULL : filtqueue.GetWriteSlot() );
+
+    if (NULL == outpkt)
+    {
+      nloop_WorkerIdleWait(spincount);
+      continue;
+    }
+    spincount = 0;
+
+    RecordLatency(hopstats[1], inpkt->push_ns, GetTimeNs());
+
+    filters.ApplyBankOnce(inpkt->data, outpkt->filtered);
+
+    outpkt->origin_ns = inpkt->origin_ns;
+    rangedqueue.ReleaseRead();
+
+    outpkt->push_ns = GetTimeNs();
+    filtqueue.CommitWrite();
+  }
+}
+
+
+
+// Worker thread main loop for analytic signal estimation.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+AnalyticLoop(int cpuidx)
+{
+  filtpacket_t *inpkt;
+  analyticpacket_t *outpkt;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> since_fall;
+  int spincount;
+
+  PinToCPU(cpuidx);
+
+  spincount = 0;
+  while (!want_quit.load(memory_order_acquire))
+  {
+    inpkt = filtqueue.GetReadSlot();
+    outpkt = ( NULL == inpkt ? NULL : analyticqueue.GetWriteSlot() );
+
+    if (NULL == outpkt)
+    {
+      nloop_WorkerIdleWait(spincount);
+      continue;
+    }
+    spincount = 0;
+
+    RecordLatency(hopstats[2], inpkt->push_ns, GetTimeNs());
+
+    analytic.HandleSamples(inpkt->filtered);
+    analytic.GetEstimatedAnalytic( outpkt->magnitudes, outpkt->periods,
+      outpkt->since_rise, since_fall );
+
+    outpkt->origin_ns = inpkt->origin_ns;
+    filtqueue.ReleaseRead();
+
+    outpkt->push_ns = GetTimeNs();
+    analyticqueue.CommitWrite();
+  }
+}
+
+
+
+// Worker thread main loop for detection and triggering.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+DetectLoop(int cpuidx)
+{
+  analyticpacket_t *inpkt;
+  outpacket_t *outpkt;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> averages;
+  nloop_SampleSlice_t<bool, bankcount, chancount> flag_high, flag_low;
+  nloop_SampleSlice_t<bool, bankcount, chancount> detected, bursts;
+  int spincount;
+
+  PinToCPU(cpuidx);
+
+  spincount = 0;
+  while (!want_quit.load(memory_order_acquire))
+  {
+    inpkt = analyticqueue.GetReadSlot();
+    outpkt = ( NULL == inpkt ? NULL : outqueue.GetWriteSlot() );
+
+    if (NULL == outpkt)
+    {
+      nloop_WorkerIdleWait(spincount);
+      continue;
+    }
+    spincount = 0;
+
+    RecordLatency(hopstats[3], inpkt->push_ns, GetTimeNs());
+
+    averagers.UpdateAverage(inpkt->magnitudes, averages);
+
+    threshsingle.TestSamples(averages, thresh_high, flag_high);
+    threshsingle.TestSamples(averages, thresh_low, flag_low);
+    threshdual.TestDual(flag_high, flag_low, detected);
+    deglitch.ProcessSample(detected, bursts);
+
+    triggers.ProcessSamples( inpkt->since_rise, targets, inpkt->periods,
+      bursts, outpkt->trigout );
+
+    outpkt->origin_ns = inpkt->origin_ns;
+    analyticqueue.ReleaseRead();
+
+    outpkt->push_ns = GetTimeNs();
+    outqueue.CommitWrite();
+  }
+}
+
+
+
+// This pins the calling thread to a CPU, if "cpuidx" is non-negative.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+PinToCPU(int cpuidx)
+{
+  if (!nloop_WorkerPinThread(cpuidx))
+    pin_failures.fetch_add(1);
+}
+
+
+
+// This returns a monotonic timestamp in nanoseconds.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+uint64_t nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetTimeNs(void)
+{
+  return (uint64_t) chrono::duration_cast<chrono::nanoseconds>(
+    chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+
+
+// This adds one sample to a hop's statistics.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+RecordLatency(
+  hopstats_t &stats, uint64_t start_ns, uint64_t end_ns)
+{
+  uint64_t thistime;
+
+  thistime = end_ns - start_ns;
+
+  stats.count++;
+  stats.total_ns += thistime;
+  if (thistime > stats.max_ns)
+    stats.max_ns = thistime;
+}
+
+
+
+// This empties the queues, clears latency statistics, and starts the
+// workers.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+StartWorkers(int first_cpu)
+{
+  int hidx;
+
+  if (0 < workers.size())
+    return false;
+
+  inqueue.Clear();
+  rangedqueue.Clear();
+  filtqueue.Clear();
+  analyticqueue.Clear();
+  outqueue.Clear();
+
+  for (hidx = 0; hidx < NLOOP_STAGES_HOPS; hidx++)
+  {
+    hopstats[hidx].count = 0;
+    hopstats[hidx].total_ns = 0;
+    hopstats[hidx].max_ns = 0;
+  }
+  totalstats.count = 0;
+  totalstats.total_ns = 0;
+  totalstats.max_ns = 0;
+
+  pin_failures.store(0);
+  want_quit.store(false);
+
+  workers.push_back( thread( &nloop_StagedPipeline_t::RangerLoop, this,
+    ( 0 <= first_cpu ? first_cpu : -1 ) ) );
+  workers.push_back( thread( &nloop_StagedPipeline_t::FilterLoop, this,
+    ( 0 <= first_cpu ? first_cpu + 1 : -1 ) ) );
+  workers.push_back( thread( &nloop_StagedPipeline_t::AnalyticLoop, this,
+    ( 0 <= first_cpu ? first_cpu + 2 : -1 ) ) );
+  workers.push_back( thread( &nloop_StagedPipeline_t::DetectLoop, this,
+    ( 0 <= first_cpu ? first_cpu + 3 : -1 ) ) );
+
+  return true;
+}
+
+
+
+// This stops the workers. Samples that are still in flight are discarded.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+StopWorkers(void)
+{
+  size_t widx;
+
+  if (0 == workers.size())
+    return;
+
+  want_quit.store(true, memory_order_release);
+
+  for (widx = 0; widx < workers.size(); widx++)
+    workers[widx].join();
+
+  workers.clear();
+}
+
+
+
+// Thread status accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+IsRunning(void)
+{
+  return (0 < workers.size());
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+int nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetPinFailures(void)
+{
+  return pin_failures.load();
+}
+
+
+
+// This queues one sample. It returns false if the input queue is full.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+PushInput(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> &indata)
+{
+  inpacket_t *pkt;
+
+  pkt = inqueue.GetWriteSlot();
+  if (NULL == pkt)
+    return false;
+
+  pkt->data.CopyFrom(indata);
+  pkt->origin_ns = GetTimeNs();
+  pkt->push_ns = pkt->origin_ns;
+
+  inqueue.CommitWrite();
+
+  return true;
+}
+
+
+
+// This fetches the oldest trigger output. It returns false if none are
+// ready.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+PopOutput(
+  nloop_SampleSlice_t<bool, bankcount, chancount> &trigout)
+{
+  outpacket_t *pkt;
+  uint64_t thistime;
+
+  pkt = outqueue.GetReadSlot();
+  if (NULL == pkt)
+    return false;
+
+  thistime = GetTimeNs();
+  RecordLatency(hopstats[4], pkt->push_ns, thistime);
+  RecordLatency(totalstats, pkt->origin_ns, thistime);
+
+  trigout.CopyFrom(pkt->trigout);
+
+  outqueue.ReleaseRead();
+
+  return true;
+}
+
+
+
+// This pushes "count" samples and waits for all of their outputs.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+ProcessBlock(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *indata,
+  nloop_SampleSlice_t<bool, bankcount, chancount> *trigout, int count)
+{
+  int pushed, popped, spincount;
+  bool did_something;
+
+  if (0 == workers.size())
+    return false;
+
+  pushed = 0;
+  popped = 0;
+  spincount = 0;
+
+  while (popped < count)
+  {
+    did_something = false;
+
+    if ( (pushed < count) && PushInput(indata[pushed]) )
+    {
+      pushed++;
+      did_something = true;
+    }
+
+    if (PopOutput(trigout[popped]))
+    {
+      popped++;
+      did_something = true;
+    }
+
+    if (did_something)
+      spincount = 0;
+    else
+      nloop_WorkerIdleWait(spincount);
+  }
+
+  return true;
+}
+
+
+
+// Latency statistics.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetHopLatency(
+  int hopidx, double &mean_ns, double &max_ns)
+{
+  mean_ns = 0;
+  max_ns = 0;
+
+  if ( (0 > hopidx) || (NLOOP_STAGES_HOPS <= hopidx) )
+    return false;
+
+  if (0 == hopstats[hopidx].count)
+    return false;
+
+  mean_ns = ((double) hopstats[hopidx].total_ns) / hopstats[hopidx].count;
+  max_ns = (double) hopstats[hopidx].max_ns;
+
+  return true;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetTotalLatency(
+  double &mean_ns, double &max_ns)
+{
+  mean_ns = 0;
+  max_ns = 0;
+
+  if (0 == totalstats.count)
+    return false;
+
+  mean_ns = ((double) totalstats.total_ns) / totalstats.count;
+  max_ns = (double) totalstats.max_ns;
+
+  return true;
+}
+
+
+
+// This sets the number of active banks and channels in every module
+// that supports run-time geometry.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SetActiveGeometry(
+  int new_banks, int new_chans)
+{
+  filters.SetActiveBanks(new_banks);
+  filters.SetActiveChans(new_chans);
+
+  analytic.SetActiveBanks(new_banks);
+  analytic.SetActiveChans(new_chans);
+
+  averagers.SetActiveBanks(new_banks);
+  averagers.SetActiveChans(new_chans);
+
+  triggers.SetActiveBanks(new_banks);
+  triggers.SetActiveChans(new_chans);
+}
+
+
+
+// Auto-ranging enable accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SetAutoRange(bool want_enabled)
+{
+  want_autorange = want_enabled;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+bool nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetAutoRange(void)
+{
+  return want_autorange;
+}
+
+
+
+// Threshold accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SetThresholds(
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_high,
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_low )
+{
+  thresh_high.CopyFrom(new_high);
+  thresh_low.CopyFrom(new_low);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SetUniformThresholds(
+  samptype_t new_high, samptype_t new_low)
+{
+  thresh_high.SetUniformValue(new_high);
+  thresh_low.SetUniformValue(new_low);
+}
+
+
+
+// Trigger target accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SetTargets(
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> &new_targets )
+{
+  targets.CopyFrom(new_targets);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SetUniformTargets(indextype_t new_target)
+{
+  targets.SetUniformValue(new_target);
+}
+
+
+
+// Module accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_AutoRanger_t<samptype_t, indextype_t, chancount> &
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetRanger(void)
+{
+  return ranger;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+filtbank_t &
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetFilterBank(void)
+{
+  return filters;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+  bankcount, chancount> &
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetAnalytic(void)
+{
+  return analytic;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount> &
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetAverager(void)
+{
+  return averagers;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount> &
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetDeGlitcher(void)
+{
+  return deglitch;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+nloop_TriggerBank_t<indextype_t, bankcount, chancount> &
+nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+GetTriggers(void)
+{
+  return triggers;
+}
+
+
+
+// Checkpointing.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  ranger.SaveState(statebuf);
+  filters.SaveState(statebuf);
+  analytic.SaveState(statebuf);
+  averagers.SaveState(statebuf);
+  threshdual.SaveState(statebuf);
+  deglitch.SaveState(statebuf);
+  triggers.SaveState(statebuf);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+void nloop_StagedPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount, queuedepth>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  ranger.LoadState(statebuf);
+  filters.LoadState(statebuf);
+  analytic.LoadState(statebuf);
+  averagers.LoadState(statebuf);
+  threshdual.LoadState(statebuf);
+  deglitch.LoadState(statebuf);
+  triggers.LoadState(statebuf);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,249 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Stage-pipelined multi-threaded executor - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <thread>, <atomic>, and <chrono> from C++11 and POSIX
+// thread affinity, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_STAGES_H
+#define NLOOP_STAGES_H
+
+
+// A staged pipeline runs the same chain of modules as a detection pipeline
+// (see nloop-pipeline.h), but puts each group of stages on its own worker
+// thread, connected by SPSC queues (see nloop-spsc.h):
+//
+//   caller -> [0] -> auto-ranger -> [1] -> filter bank -> [2]
+//     -> analytic estimator -> [3] -> averager, thresholds, deglitcher,
+//     and trigger bank -> [4] -> caller
+//
+// This is useful when channels can't be split across threads (see
+// nloop-shards.h). Throughput is limited by the slowest stage rather than
+// the sum of all stages, at the cost of a few samples of latency.
+//
+// Samples are pushed with PushInput() and trigger outputs are collected in
+// order with PopOutput(). Queues are "queuedepth" samples deep; when a
+// queue is full, the stage feeding it waits. ProcessBlock() pushes and
+// pops until a whole block has been processed.
+//
+// Each queue is a "hop". The time each sample spends waiting in each hop
+// is tracked, along with the total time from PushInput() to PopOutput().
+//
+// Modules are configured through the GetX() accessors, as with the
+// detection pipeline. Outputs are identical to the detection pipeline's.
+//
+// NOTE - Workers spin while waiting for samples (see nloop-workers.h), so
+// each one should have a core to itself. Stop the workers when the
+// executor is idle.
+//
+// NOTE - This is very large. Allocate it on the heap, not the stack.
+
+
+//
+// Constants
+
+// Number of worker threads (stage groups).
+#define NLOOP_STAGES_WORKERS 4
+
+// Number of queues (hops), including the input and output queues.
+#define NLOOP_STAGES_HOPS 5
+
+
+//
+// Classes
+
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount,
+  int queuedepth>
+class nloop_StagedPipeline_t
+{
+protected:
+  // Queue items. Timestamps are in nanoseconds: "origin_ns" is when the
+  // sample was passed to PushInput(), and "push_ns" is when this item was
+  // added to its current queue.
+  struct inpacket_t
+  {
+    nloop_SampleSlice_t<samptype_t, 1, chancount> data;
+    uint64_t origin_ns, push_ns;
+  };
+  struct filtpacket_t
+  {
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> filtered;
+    uint64_t origin_ns, push_ns;
+  };
+  struct analyticpacket_t
+  {
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> magnitudes;
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> periods;
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> since_rise;
+    uint64_t origin_ns, push_ns;
+  };
+  struct outpacket_t
+  {
+    nloop_SampleSlice_t<bool, bankcount, chancount> trigout;
+    uint64_t origin_ns, push_ns;
+  };
+
+  // Per-hop latency statistics. Each is only written by the thread that
+  // consumes from that hop.
+  struct hopstats_t
+  {
+    uint64_t count, total_ns, max_ns;
+  };
+
+  // Modules.
+  nloop_AutoRanger_t<samptype_t, indextype_t, chancount> ranger;
+  filtbank_t filters;
+  nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+    bankcount, chancount> analytic;
+  nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount>
+    averagers;
+  nloop_ThresholdSingleBank_t<samptype_t, bankcount, chancount> threshsingle;
+  nloop_ThresholdDualBank_t<bankcount, chancount> threshdual;
+  nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount> deglitch;
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> triggers;
+
+  // Configuration that isn't held by modules.
+  bool want_autorange;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> thresh_high;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> thresh_low;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> targets;
+
+  // Queues.
+  nloop_SPSCQueue_t<inpacket_t, queuedepth> inqueue;
+  nloop_SPSCQueue_t<inpacket_t, queuedepth> rangedqueue;
+  nloop_SPSCQueue_t<filtpacket_t, queuedepth> filtqueue;
+  nloop_SPSCQueue_t<analyticpacket_t, queuedepth> analyticqueue;
+  nloop_SPSCQueue_t<outpacket_t, queuedepth> outqueue;
+
+  hopstats_t hopstats[NLOOP_STAGES_HOPS];
+  hopstats_t totalstats;
+
+  // Worker threads.
+  vector<thread> workers;
+  atomic<int> pin_failures;
+  atomic<bool> want_quit;
+
+
+  // Helper functions.
+
+  // Worker thread main loops.
+  void RangerLoop(int cpuidx);
+  void FilterLoop(int cpuidx);
+  void AnalyticLoop(int cpuidx);
+  void DetectLoop(int cpuidx);
+
+  // This pins the calling thread to a CPU, if "cpuidx" is non-negative.
+  void PinToCPU(int cpuidx);
+  // This returns a monotonic timestamp in nanoseconds.
+  uint64_t GetTimeNs(void);
+  // This adds one sample to a hop's statistics.
+  void RecordLatency(hopstats_t &stats, uint64_t start_ns, uint64_t end_ns);
+
+public:
+  // This sets thresholds and targets to zero and disables auto-ranging.
+  // Workers aren't started.
+  nloop_StagedPipeline_t(void);
+  // This stops the workers.
+  ~nloop_StagedPipeline_t(void);
+
+
+  // Thread management.
+
+  // This empties the queues, clears latency statistics, and starts the
+  // workers. If "first_cpu" is non-negative, worker N is pinned to CPU
+  // first_cpu+N. This returns false if workers are already running.
+  // NOTE - This allocates.
+  bool StartWorkers(int first_cpu);
+
+  // Samples that are still in flight are discarded.
+  void StopWorkers(void);
+  bool IsRunning(void);
+
+  // This is the number of workers that couldn't be pinned to their CPU.
+  int GetPinFailures(void);
+
+
+  // Processing functions.
+
+  // This queues one sample. It returns false if the input queue is full.
+  bool PushInput(nloop_SampleSlice_t<samptype_t, 1, chancount> &indata);
+
+  // This fetches the oldest trigger output. It returns false if none are
+  // ready.
+  bool PopOutput(nloop_SampleSlice_t<bool, bankcount, chancount> &trigout);
+
+  // This pushes "count" samples and waits for all of their outputs.
+  // This returns false if the workers aren't running.
+  bool ProcessBlock(nloop_SampleSlice_t<samptype_t, 1, chancount> *indata,
+    nloop_SampleSlice_t<bool, bankcount, chancount> *trigout, int count);
+
+
+  // Latency statistics.
+  // NOTE - Only read these while workers are stopped.
+
+  // This returns false if the hop index is out of range or no samples have
+  // passed through it.
+  bool GetHopLatency(int hopidx, double &mean_ns, double &max_ns);
+  // This is the time from PushInput() to PopOutput().
+  bool GetTotalLatency(double &mean_ns, double &max_ns);
+
+
+  // Configuration.
+  // NOTE - Only configure the executor while workers are stopped.
+
+  void SetActiveGeometry(int new_banks, int new_chans);
+
+  void SetAutoRange(bool want_enabled);
+  bool GetAutoRange(void);
+
+  void SetThresholds(
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_high,
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_low );
+  void SetUniformThresholds(samptype_t new_high, samptype_t new_low);
+
+  void SetTargets(
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> &new_targets );
+  void SetUniformTargets(indextype_t new_target);
+
+  nloop_AutoRanger_t<samptype_t, indextype_t, chancount> &GetRanger(void);
+  filtbank_t &GetFilterBank(void);
+  nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+    bankcount, chancount> &GetAnalytic(void);
+  nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount>
+    &GetAverager(void);
+  nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount>
+    &GetDeGlitcher(void);
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> &GetTriggers(void);
+
+
+  // Checkpointing. This uses the same order as the detection pipeline, so
+  // checkpoints can be moved between the two.
+  // NOTE - Only call these while workers are stopped.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-stages-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,235 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Processing state checkpoints - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this is included by every file that uses the library,
+// non-template functions here are declared "inline" so that multiple
+// copies don't collide at link-time.
+
+
+//
+// nloop_StateBuffer_t Class
+
+
+inline nloop_StateBuffer_t::nloop_StateBuffer_t(void)
+{
+  writedata = NULL;
+  readdata = NULL;
+  buflen = 0;
+  bufpos = 0;
+  is_writing = false;
+  is_ok = false;
+}
+
+
+
+// This starts writing a checkpoint, and writes the header.
+// If "newbuf" is NULL, bytes are counted but not stored.
+
+inline void nloop_StateBuffer_t::StartWrite(uint8_t *newbuf, size_t newlen)
+{
+  const char *magic;
+  int cidx;
+
+  writedata = newbuf;
+  readdata = NULL;
+  buflen = newlen;
+  bufpos = 0;
+  is_writing = true;
+  is_ok = true;
+
+  magic = NLOOP_STATE_MAGIC;
+  for (cidx = 0; cidx < 4; cidx++)
+    PutRaw((uint8_t) magic[cidx], 1);
+
+  PutRaw(NLOOP_STATE_VERSION, 2);
+}
+
+
+
+// This starts reading a checkpoint, and checks the header.
+// This returns false if the signature or version doesn't match.
+
+inline bool nloop_StateBuffer_t::StartRead(const uint8_t *newbuf,
+  size_t newlen)
+{
+  const char *magic;
+  int cidx;
+
+  writedata = NULL;
+  readdata = newbuf;
+  buflen = newlen;
+  bufpos = 0;
+  is_writing = false;
+  is_ok = (NULL != newbuf);
+
+  magic = NLOOP_STATE_MAGIC;
+  for (cidx = 0; cidx < 4; cidx++)
+    if ( ((uint8_t) magic[cidx]) != GetRaw(1) )
+      is_ok = false;
+
+  if (NLOOP_STATE_VERSION != GetRaw(2))
+    is_ok = false;
+
+  return is_ok;
+}
+
+
+
+inline bool nloop_StateBuffer_t::IsOk(void)
+{
+  return is_ok;
+}
+
+
+
+inline size_t nloop_StateBuffer_t::GetByteCount(void)
+{
+  return bufpos;
+}
+
+
+
+// Raw value I/O. Values are "bytecount" bytes, little-endian.
+
+inline void nloop_StateBuffer_t::PutRaw(uint64_t value, int bytecount)
+{
+  int bidx;
+
+  if ( (!is_ok) || (!is_writing) )
+  {
+    is_ok = false;
+    return;
+  }
+
+  // Sizing pass.
+  if (NULL == writedata)
+  {
+    bufpos += bytecount;
+    return;
+  }
+
+  if ( (bufpos + bytecount) > buflen )
+  {
+    is_ok = false;
+    return;
+  }
+
+  for (bidx = 0; bidx < bytecount; bidx++)
+  {
+    writedata[bufpos] = (uint8_t) (value & 0xff);
+    value >>= 8;
+    bufpos++;
+  }
+}
+
+
+
+// Reading past the end or in the wrong mode returns 0 and flags an error.
+
+inline uint64_t nloop_StateBuffer_t::GetRaw(int bytecount)
+{
+  uint64_t result;
+  int bidx;
+
+  result = 0;
+
+  if ( (!is_ok) || is_writing || (NULL == readdata)
+    || ( (bufpos + bytecount) > buflen ) )
+  {
+    is_ok = false;
+    return result;
+  }
+
+  for (bidx = bytecount - 1; bidx >= 0; bidx--)
+  {
+    result <<= 8;
+    result |= readdata[bufpos + bidx];
+  }
+
+  bufpos += bytecount;
+
+  return result;
+}
+
+
+
+// Typed value I/O. These use sizeof(val_t) bytes per value.
+// NOTE - Narrowing the raw value back to val_t restores negative values,
+// since only the low-order bytes are stored.
+
+template<class val_t>
+void nloop_StateBuffer_t::PutValue(val_t value)
+{
+  PutRaw( (uint64_t) value, sizeof(val_t) );
+}
+
+
+
+template<class val_t>
+void nloop_StateBuffer_t::GetValue(val_t &value)
+{
+  value = (val_t) GetRaw(sizeof(val_t));
+}
+
+
+
+template<class val_t>
+void nloop_StateBuffer_t::PutArray(val_t *values, size_t count)
+{
+  size_t vidx;
+
+  for (vidx = 0; vidx < count; vidx++)
+    PutRaw( (uint64_t) values[vidx], sizeof(val_t) );
+}
+
+
+
+template<class val_t>
+void nloop_StateBuffer_t::GetArray(val_t *values, size_t count)
+{
+  size_t vidx;
+
+  for (vidx = 0; vidx < count; vidx++)
+    values[vidx] = (val_t) GetRaw(sizeof(val_t));
+}
+
+
+
+// Module record headers.
+
+inline void nloop_StateBuffer_t::PutTag(uint8_t tag,
+  uint32_t dim0, uint32_t dim1, uint32_t dim2)
+{
+  PutRaw(tag, 1);
+  PutRaw(dim0, 4);
+  PutRaw(dim1, 4);
+  PutRaw(dim2, 4);
+}
+
+
+
+// CheckTag() flags an error and returns false on a mismatch.
+
+inline bool nloop_StateBuffer_t::CheckTag(uint8_t tag,
+  uint32_t dim0, uint32_t dim1, uint32_t dim2)
+{
+  // Read all fields even if one mismatches, for consistency.
+  if (tag != GetRaw(1))
+    is_ok = false;
+  if (dim0 != GetRaw(4))
+    is_ok = false;
+  if (dim1 != GetRaw(4))
+    is_ok = false;
+  if (dim2 != GetRaw(4))
+    is_ok = false;
+
+  return is_ok;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,132 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Processing state checkpoints - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Wrapper.
+#ifndef NLOOP_STATE_H
+#define NLOOP_STATE_H
+
+
+// A state checkpoint holds the internal signal processing state of modules
+// (filter history, running sums, trigger state machines, and so forth), so
+// that a restarted process can resume where it left off instead of waiting
+// for filters and estimators to settle.
+//
+// Configuration (coefficients, tables, thresholds, active geometry) is NOT
+// part of a checkpoint; load that first (from CSV or a snapshot), then load
+// the checkpoint. Each module's record starts with a tag and its geometry,
+// and loading fails if these don't match the module as configured.
+//
+// Modules provide SaveState() and LoadState() methods, which append to or
+// consume from an nloop_StateBuffer_t. Call them in the same order when
+// saving and loading.
+//
+// Values are stored little-endian using the module's own type widths, so
+// checkpoints are compact and don't depend on host byte order, but can
+// only be loaded into modules with the same template parameters.
+//
+// This uses a caller-supplied byte array and doesn't allocate, so it's
+// usable on embedded targets. Writing to a NULL buffer counts the bytes
+// that would be written, to size the real buffer.
+
+
+//
+// Constants
+
+// Buffer signature and format version.
+#define NLOOP_STATE_MAGIC "NLST"
+#define NLOOP_STATE_VERSION 1
+
+// Header size, in bytes (signature plus 16-bit version).
+#define NLOOP_STATE_HEADER_BYTES 6
+
+// Record tags.
+enum nloop_statetag_t
+{
+  NLOOP_STATE_AUTORANGER = 1,
+  NLOOP_STATE_IIRBANK = 2,
+  NLOOP_STATE_FIRBANK = 3,
+  NLOOP_STATE_ANALYTICBANK = 4,
+  NLOOP_STATE_AVERAGERBANK = 5,
+  NLOOP_STATE_DEGLITCHERBANK = 6,
+  NLOOP_STATE_THRESHDUAL = 7,
+  NLOOP_STATE_TRIGGERBANK = 8
+};
+
+
+//
+// Classes
+
+
+// State checkpoint buffer.
+// Errors (overruns, signature mismatches, geometry mismatches) are sticky;
+// check IsOk() after saving or loading everything.
+
+class nloop_StateBuffer_t
+{
+protected:
+  // Exactly one of these is non-NULL while a buffer is attached, except
+  // when sizing (both NULL, is_writing true).
+  uint8_t *writedata;
+  const uint8_t *readdata;
+  size_t buflen;
+
+  size_t bufpos;
+  bool is_writing;
+  bool is_ok;
+
+public:
+  nloop_StateBuffer_t(void);
+  // Default destructor is fine.
+
+  // This starts writing a checkpoint, and writes the header.
+  // If "newbuf" is NULL, bytes are counted but not stored.
+  void StartWrite(uint8_t *newbuf, size_t newlen);
+
+  // This starts reading a checkpoint, and checks the header.
+  // This returns false if the signature or version doesn't match.
+  bool StartRead(const uint8_t *newbuf, size_t newlen);
+
+  bool IsOk(void);
+  // This is the number of bytes written or read so far.
+  size_t GetByteCount(void);
+
+
+  // Raw value I/O. Values are "bytecount" bytes, little-endian.
+  // Reading past the end or in the wrong mode returns 0 and flags an error.
+  void PutRaw(uint64_t value, int bytecount);
+  uint64_t GetRaw(int bytecount);
+
+  // Typed value I/O. These use sizeof(val_t) bytes per value.
+  template<class val_t> void PutValue(val_t value);
+  template<class val_t> void GetValue(val_t &value);
+  template<class val_t> void PutArray(val_t *values, size_t count);
+  template<class val_t> void GetArray(val_t *values, size_t count);
+
+  // Module record headers.
+  // CheckTag() flags an error and returns false on a mismatch.
+  void PutTag(uint8_t tag, uint32_t dim0, uint32_t dim1, uint32_t dim2);
+  bool CheckTag(uint8_t tag, uint32_t dim0, uint32_t dim1, uint32_t dim2);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes and functions on-demand. The source code
+// has to be included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies
+// get pruned at link-time.
+
+#include "nloop-state-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+//
+// This is the end of the file.
@@ -0,0 +1,712 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Parameter sweep runner with shared upstream stages - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+
+// NOTE - The calling thread fills the shared output buffers and the truth
+// pointers, then publishes the block through the barrier (see
+// nloop-workers.h). It waits for every worker to finish before touching
+// the shared buffers again.
+
+
+//
+// nloop_SweepVariant_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::nloop_SweepVariant_t(void)
+{
+  thresh_high.SetUniformValue(0);
+  thresh_low.SetUniformValue(0);
+  targets.SetUniformValue(0);
+
+  banks_active = bankcount;
+  chans_active = chancount;
+
+  averages.SetUniformValue(0);
+  flag_high.SetUniformValue(false);
+  flag_low.SetUniformValue(false);
+  detected.SetUniformValue(false);
+
+  threshdual.ResetState();
+
+  ResetCounts();
+}
+
+
+
+// This sizes the per-block output buffers.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SetMaxBlock(int new_maxblock)
+{
+  bursts.resize(new_maxblock);
+  trigout.resize(new_maxblock);
+}
+
+
+
+// This runs "count" samples of analytic estimator output through every
+// stage.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::ProcessBlock(
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *magnitudes,
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> *periods,
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> *since_rise,
+  nloop_SampleSlice_t<bool, 1, chancount> *truthflags,
+  nloop_SampleSlice_t<uint16_t, 1, chancount> *truephases,
+  int count )
+{
+  int sidx, bidx, cidx;
+  bool thisflag;
+
+  for (sidx = 0; sidx < count; sidx++)
+  {
+    nloop_SampleSlice_t<bool, bankcount, chancount> &thisburst =
+      bursts[sidx];
+    nloop_SampleSlice_t<bool, bankcount, chancount> &thistrig =
+      trigout[sidx];
+
+    // Same stage order as nloop_DetectionPipeline_t::ProcessSlice().
+    averagers.UpdateAverage(magnitudes[sidx], averages);
+
+    threshsingle.TestSamples(averages, thresh_high, flag_high);
+    threshsingle.TestSamples(averages, thresh_low, flag_low);
+    threshdual.TestDual(flag_high, flag_low, detected);
+    deglitch.ProcessSample(detected, thisburst);
+
+    triggers.ProcessSamples( since_rise[sidx], targets, periods[sidx],
+      thisburst, thistrig );
+
+    // Count onsets.
+    for (bidx = 0; bidx < banks_active; bidx++)
+      for (cidx = 0; cidx < chans_active; cidx++)
+      {
+        thisflag = thisburst.data[bidx][cidx];
+        if (thisflag && !(was_burst.data[bidx][cidx]))
+          burst_total++;
+        was_burst.data[bidx][cidx] = thisflag;
+
+        thisflag = thistrig.data[bidx][cidx];
+        if (thisflag && !(was_trig.data[bidx][cidx]))
+          trig_total++;
+        was_trig.data[bidx][cidx] = thisflag;
+      }
+
+    if ( (NULL != truthflags) && (NULL != truephases) )
+      scorer.ProcessSample( truthflags[sidx], truephases[sidx],
+        thisburst, thistrig );
+  }
+}
+
+
+
+// This sets active geometry in every module that supports it.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SetActiveGeometry(int new_banks, int new_chans)
+{
+  banks_active = new_banks;
+  if (0 > banks_active)
+    banks_active = 0;
+  else if (bankcount < banks_active)
+    banks_active = bankcount;
+
+  chans_active = new_chans;
+  if (0 > chans_active)
+    chans_active = 0;
+  else if (chancount < chans_active)
+    chans_active = chancount;
+
+  averagers.SetActiveBanks(new_banks);
+  averagers.SetActiveChans(new_chans);
+
+  triggers.SetActiveBanks(new_banks);
+  triggers.SetActiveChans(new_chans);
+
+  scorer.SetActiveGeometry(new_banks, new_chans);
+}
+
+
+
+// Threshold accessors.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SetThresholds(
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_high,
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_low )
+{
+  thresh_high.CopyFrom(new_high);
+  thresh_low.CopyFrom(new_low);
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SetUniformThresholds(
+  samptype_t new_high, samptype_t new_low)
+{
+  thresh_high.SetUniformValue(new_high);
+  thresh_low.SetUniformValue(new_low);
+}
+
+
+
+// Trigger target accessors.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SetTargets(
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> &new_targets )
+{
+  targets.CopyFrom(new_targets);
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SetUniformTargets(indextype_t new_target)
+{
+  targets.SetUniformValue(new_target);
+}
+
+
+
+// Module accessors.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount> &
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetAverager(void)
+{
+  return averagers;
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount> &
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetDeGlitcher(void)
+{
+  return deglitch;
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_TriggerBank_t<indextype_t, bankcount, chancount> &
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetTriggers(void)
+{
+  return triggers;
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_DetectionScorer_t<bankcount, chancount> &
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetScorer(void)
+{
+  return scorer;
+}
+
+
+
+// Output accessors.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_SampleSlice_t<bool, bankcount, chancount> &
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetBurstFlags(int sidx)
+{
+  return bursts[sidx];
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+nloop_SampleSlice_t<bool, bankcount, chancount> &
+nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetTriggerFlags(int sidx)
+{
+  return trigout[sidx];
+}
+
+
+
+// Summary statistics.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+uint64_t nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetBurstCount(void)
+{
+  return burst_total;
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+uint64_t nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::GetTriggerCount(void)
+{
+  return trig_total;
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::ResetCounts(void)
+{
+  was_burst.SetUniformValue(false);
+  was_trig.SetUniformValue(false);
+  burst_total = 0;
+  trig_total = 0;
+}
+
+
+
+// Checkpointing.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::SaveState(nloop_StateBuffer_t &statebuf)
+{
+  averagers.SaveState(statebuf);
+  threshdual.SaveState(statebuf);
+  deglitch.SaveState(statebuf);
+  triggers.SaveState(statebuf);
+}
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+void nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+  bankcount, chancount>::LoadState(nloop_StateBuffer_t &statebuf)
+{
+  averagers.LoadState(statebuf);
+  threshdual.LoadState(statebuf);
+  deglitch.LoadState(statebuf);
+  triggers.LoadState(statebuf);
+}
+
+
+
+//
+// nloop_SweepPipeline_t Class
+
+
+// Constructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t, estimator_t,
+  avgcoeffbits, bankcount, chancount>::nloop_SweepPipeline_t(void)
+{
+  want_autorange = false;
+
+  ranged.SetUniformValue(0);
+  filtered.SetUniformValue(0);
+  since_fall.SetUniformValue(0);
+
+  max_block = 0;
+  pin_failures.store(0);
+
+  block_truth = NULL;
+  block_phases = NULL;
+  block_count = 0;
+  start_gen = 0;
+  want_quit.store(false);
+}
+
+
+
+// Destructor.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t, estimator_t,
+  avgcoeffbits, bankcount, chancount>::~nloop_SweepPipeline_t(void)
+{
+  size_t vidx;
+
+  StopWorkers();
+
+  for (vidx = 0; vidx < variants.size(); vidx++)
+    delete variants[vidx];
+
+  variants.clear();
+}
+
+
+
+// This is each worker thread's main loop.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::WorkerLoop(
+  int workeridx, int cpuidx)
+{
+  unsigned long seen_gen;
+
+  if (!nloop_WorkerPinThread(cpuidx))
+    pin_failures.fetch_add(1);
+
+  // NOTE - Start from the generation StartWorkers() saw, not the current
+  // one. The first block may have been published before this thread got
+  // around to running.
+  seen_gen = start_gen;
+
+  while (true)
+  {
+    // Wait for the next block (or for a request to quit).
+    barrier.WaitForBlock(seen_gen);
+
+    if (want_quit.load(memory_order_acquire))
+      break;
+
+    ProcessWorkerBlock(workeridx);
+
+    barrier.FinishBlock();
+  }
+}
+
+
+
+// This runs one block through the variants handled by one worker.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::ProcessWorkerBlock(
+  int workeridx)
+{
+  size_t vidx;
+
+  for (vidx = workeridx; vidx < variants.size(); vidx += workers.size())
+    variants[vidx]->ProcessBlock( magnitudes.data(), periods.data(),
+      since_rise.data(), block_truth, block_phases, block_count );
+}
+
+
+
+// This adds a variant with default configuration and returns it.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+typename nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::variant_t *
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::AddVariant(void)
+{
+  variant_t *newvariant;
+
+  if (0 < workers.size())
+    return NULL;
+
+  newvariant = new variant_t;
+  variants.push_back(newvariant);
+
+  return newvariant;
+}
+
+
+
+// Variant accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+typename nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::variant_t *
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetVariant(int varidx)
+{
+  if ( (0 > varidx) || (((int) variants.size()) <= varidx) )
+    return NULL;
+
+  return variants[varidx];
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+int nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetVariantCount(void)
+{
+  return (int) variants.size();
+}
+
+
+
+// This starts the workers.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+bool nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::StartWorkers(
+  int new_maxblock, int new_workers, int first_cpu)
+{
+  size_t vidx;
+  int widx;
+
+  if ( (0 < workers.size()) || (1 > new_maxblock) || (1 > new_workers) )
+    return false;
+
+  max_block = new_maxblock;
+  magnitudes.resize(max_block);
+  periods.resize(max_block);
+  since_rise.resize(max_block);
+
+  for (vidx = 0; vidx < variants.size(); vidx++)
+    variants[vidx]->SetMaxBlock(max_block);
+
+  pin_failures.store(0);
+  want_quit.store(false);
+  start_gen = barrier.GetGeneration();
+
+  for (widx = 0; widx < new_workers; widx++)
+    workers.push_back( thread(
+      &nloop_SweepPipeline_t::WorkerLoop, this, widx,
+      ( 0 <= first_cpu ? first_cpu + widx : -1 ) ) );
+
+  return true;
+}
+
+
+
+// This stops the workers.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::StopWorkers(void)
+{
+  size_t widx;
+
+  if (0 == workers.size())
+    return;
+
+  want_quit.store(true, memory_order_release);
+  barrier.PublishBlock();
+
+  for (widx = 0; widx < workers.size(); widx++)
+    workers[widx].join();
+
+  workers.clear();
+}
+
+
+
+// Thread status accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+bool nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::IsRunning(void)
+{
+  return (0 < workers.size());
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+int nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetPinFailures(void)
+{
+  return pin_failures.load();
+}
+
+
+
+// This runs "count" samples through the shared stages and then through
+// every variant.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+bool nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::ProcessBlock(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *indata,
+  nloop_SampleSlice_t<bool, 1, chancount> *truthflags,
+  nloop_SampleSlice_t<uint16_t, 1, chancount> *truephases, int count)
+{
+  int firstidx, sidx;
+
+  if (0 == workers.size())
+    return false;
+
+  for (firstidx = 0; firstidx < count; firstidx += max_block)
+  {
+    block_count = count - firstidx;
+    if (block_count > max_block)
+      block_count = max_block;
+
+    // Shared stages. These run once no matter how many variants there are.
+    for (sidx = 0; sidx < block_count; sidx++)
+    {
+      if (want_autorange)
+      {
+        ranger.UpdateFromSample(indata[firstidx + sidx]);
+        ranger.GetLatchedOutput(indata[firstidx + sidx], ranged);
+      }
+      else
+        ranged.CopyFrom(indata[firstidx + sidx]);
+
+      filters.ApplyBankOnce(ranged, filtered);
+
+      analytic.HandleSamples(filtered);
+      analytic.GetEstimatedAnalytic( magnitudes[sidx], periods[sidx],
+        since_rise[sidx], since_fall );
+    }
+
+    // Hand this chunk to the workers.
+    block_truth = NULL;
+    block_phases = NULL;
+    if ( (NULL != truthflags) && (NULL != truephases) )
+    {
+      block_truth = truthflags + firstidx;
+      block_phases = truephases + firstidx;
+    }
+
+    barrier.PublishBlock();
+
+    // Wait for them to finish.
+    barrier.WaitForWorkers( (int) workers.size() );
+  }
+
+  return true;
+}
+
+
+
+// This sets active geometry in the shared stages and in every variant.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetActiveGeometry(
+  int new_banks, int new_chans)
+{
+  size_t vidx;
+
+  filters.SetActiveBanks(new_banks);
+  filters.SetActiveChans(new_chans);
+
+  analytic.SetActiveBanks(new_banks);
+  analytic.SetActiveChans(new_chans);
+
+  for (vidx = 0; vidx < variants.size(); vidx++)
+    variants[vidx]->SetActiveGeometry(new_banks, new_chans);
+}
+
+
+
+// Auto-ranging enable accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SetAutoRange(
+  bool want_enabled)
+{
+  want_autorange = want_enabled;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+bool nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetAutoRange(void)
+{
+  return want_autorange;
+}
+
+
+
+// Shared module accessors.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_AutoRanger_t<samptype_t, indextype_t, chancount> &
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetRanger(void)
+{
+  return ranger;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+filtbank_t &
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetFilterBank(void)
+{
+  return filters;
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+  bankcount, chancount> &
+nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::GetAnalytic(void)
+{
+  return analytic;
+}
+
+
+
+// Checkpointing.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::SaveState(
+  nloop_StateBuffer_t &statebuf)
+{
+  size_t vidx;
+
+  ranger.SaveState(statebuf);
+  filters.SaveState(statebuf);
+  analytic.SaveState(statebuf);
+
+  for (vidx = 0; vidx < variants.size(); vidx++)
+    variants[vidx]->SaveState(statebuf);
+}
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+void nloop_SweepPipeline_t<samptype_t, indextype_t, filtbank_t,
+  estimator_t, avgcoeffbits, bankcount, chancount>::LoadState(
+  nloop_StateBuffer_t &statebuf)
+{
+  size_t vidx;
+
+  ranger.LoadState(statebuf);
+  filters.LoadState(statebuf);
+  analytic.LoadState(statebuf);
+
+  for (vidx = 0; vidx < variants.size(); vidx++)
+    variants[vidx]->LoadState(statebuf);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,312 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Parameter sweep runner with shared upstream stages - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <thread> and <atomic> from C++11 and POSIX thread
+// affinity, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_SWEEP_H
+#define NLOOP_SWEEP_H
+
+
+// When tuning, the same recording is run through many detection and
+// trigger configurations. The front of the pipeline (auto-ranger, filter
+// bank, and analytic estimator) doesn't depend on any of the parameters
+// being tuned, so a sweep runner computes it once per block and fans its
+// outputs out to several "variants":
+//
+//   auto-ranger -> filter bank -> analytic estimator
+//     -> variant 0: averager, thresholds, deglitcher, trigger bank
+//     -> variant 1: averager, thresholds, deglitcher, trigger bank
+//     -> ...
+//
+// The shared stages run on the calling thread. Variants are dealt out to
+// worker threads round-robin (variant N goes to worker N % workercount),
+// and the calling thread waits for every variant to finish the block
+// before starting the next one.
+//
+// Each variant's burst and trigger flags are identical to those of a
+// detection pipeline (see nloop-pipeline.h) with the same configuration.
+// Variants count burst and trigger onsets, and can optionally score
+// themselves against ground truth labels (see nloop-score.h).
+//
+// Variants are added with AddVariant() and configured through the
+// returned pointer, while workers are stopped.
+//
+// NOTE - Workers spin while waiting for blocks (see nloop-workers.h), so
+// each one should have a core to itself. Stop the workers when the runner
+// is idle.
+//
+// NOTE - This is very large. Allocate it on the heap, not the stack.
+
+
+//
+// Classes
+
+
+// One downstream configuration. This owns every stage after the analytic
+// estimator, and its outputs from the most recent block.
+
+template <class samptype_t, class indextype_t, uint8_t avgcoeffbits,
+  int bankcount, int chancount>
+class nloop_SweepVariant_t
+{
+protected:
+  // Modules.
+  nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount>
+    averagers;
+  nloop_ThresholdSingleBank_t<samptype_t, bankcount, chancount> threshsingle;
+  nloop_ThresholdDualBank_t<bankcount, chancount> threshdual;
+  nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount> deglitch;
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> triggers;
+  nloop_DetectionScorer_t<bankcount, chancount> scorer;
+
+  // Configuration that isn't held by modules.
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> thresh_high;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> thresh_low;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> targets;
+  int banks_active;
+  int chans_active;
+
+  // Per-sample scratch.
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> averages;
+  nloop_SampleSlice_t<bool, bankcount, chancount> flag_high;
+  nloop_SampleSlice_t<bool, bankcount, chancount> flag_low;
+  nloop_SampleSlice_t<bool, bankcount, chancount> detected;
+
+  // Outputs from the most recent block.
+  vector< nloop_SampleSlice_t<bool, bankcount, chancount> > bursts;
+  vector< nloop_SampleSlice_t<bool, bankcount, chancount> > trigout;
+
+  // Onset counting.
+  nloop_SampleSlice_t<bool, bankcount, chancount> was_burst;
+  nloop_SampleSlice_t<bool, bankcount, chancount> was_trig;
+  uint64_t burst_total, trig_total;
+
+public:
+  // This sets thresholds and targets to zero and clears counts.
+  // Modules get their own default configurations.
+  nloop_SweepVariant_t(void);
+  // Default destructor is fine.
+
+
+  // Processing functions.
+
+  // This sizes the per-block output buffers.
+  // NOTE - This allocates.
+  void SetMaxBlock(int new_maxblock);
+
+  // This runs "count" samples of analytic estimator output through every
+  // stage. If "truthflags" and "truephases" aren't NULL, the outputs are
+  // also scored.
+  void ProcessBlock(
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> *magnitudes,
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> *periods,
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> *since_rise,
+    nloop_SampleSlice_t<bool, 1, chancount> *truthflags,
+    nloop_SampleSlice_t<uint16_t, 1, chancount> *truephases,
+    int count );
+
+
+  // Configuration.
+
+  void SetActiveGeometry(int new_banks, int new_chans);
+
+  void SetThresholds(
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_high,
+    nloop_SampleSlice_t<samptype_t, bankcount, chancount> &new_low );
+  void SetUniformThresholds(samptype_t new_high, samptype_t new_low);
+
+  // Target delays after the rising zero crossing, for the trigger bank.
+  void SetTargets(
+    nloop_SampleSlice_t<indextype_t, bankcount, chancount> &new_targets );
+  void SetUniformTargets(indextype_t new_target);
+
+
+  // Module accessors.
+
+  nloop_AveragerBank_t<samptype_t, avgcoeffbits, bankcount, chancount>
+    &GetAverager(void);
+  nloop_DeGlitcherBank_t<indextype_t, bankcount, chancount>
+    &GetDeGlitcher(void);
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> &GetTriggers(void);
+  nloop_DetectionScorer_t<bankcount, chancount> &GetScorer(void);
+
+
+  // Output accessors. These hold values from the most recent block.
+
+  nloop_SampleSlice_t<bool, bankcount, chancount> &GetBurstFlags(int sidx);
+  nloop_SampleSlice_t<bool, bankcount, chancount> &GetTriggerFlags(
+    int sidx);
+
+
+  // Summary statistics. These are onsets (a bank/channel's flag going
+  // from false to true), summed over active banks and channels.
+
+  uint64_t GetBurstCount(void);
+  uint64_t GetTriggerCount(void);
+  // This clears onset counts. Scorer statistics are kept.
+  void ResetCounts(void);
+
+
+  // Checkpointing. This saves or restores every module's processing
+  // state, in pipeline order. Onset counts and the scorer aren't saved.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+// The sweep runner. This owns the shared stages and the variants.
+
+template <class samptype_t, class indextype_t, class filtbank_t,
+  class estimator_t, uint8_t avgcoeffbits, int bankcount, int chancount>
+class nloop_SweepPipeline_t
+{
+public:
+  typedef nloop_SweepVariant_t<samptype_t, indextype_t, avgcoeffbits,
+    bankcount, chancount> variant_t;
+
+protected:
+  // Shared modules.
+  nloop_AutoRanger_t<samptype_t, indextype_t, chancount> ranger;
+  filtbank_t filters;
+  nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+    bankcount, chancount> analytic;
+  bool want_autorange;
+
+  // Shared per-sample scratch.
+  nloop_SampleSlice_t<samptype_t, 1, chancount> ranged;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> filtered;
+  nloop_SampleSlice_t<indextype_t, bankcount, chancount> since_fall;
+
+  // Shared outputs for the current block.
+  vector< nloop_SampleSlice_t<samptype_t, bankcount, chancount> >
+    magnitudes;
+  vector< nloop_SampleSlice_t<indextype_t, bankcount, chancount> > periods;
+  vector< nloop_SampleSlice_t<indextype_t, bankcount, chancount> >
+    since_rise;
+
+  // Variants. These are separate allocations so that workers don't share
+  // cache lines.
+  vector<variant_t *> variants;
+
+  // Worker threads.
+  vector<thread> workers;
+  int max_block;
+  atomic<int> pin_failures;
+
+  // The calling thread publishes a block by setting these and then
+  // passing the barrier. Workers start from generation "start_gen".
+  nloop_SampleSlice_t<bool, 1, chancount> *block_truth;
+  nloop_SampleSlice_t<uint16_t, 1, chancount> *block_phases;
+  int block_count;
+  nloop_BlockBarrier_t barrier;
+  unsigned long start_gen;
+  atomic<bool> want_quit;
+
+
+  // Helper functions.
+
+  // This is each worker thread's main loop.
+  void WorkerLoop(int workeridx, int cpuidx);
+
+  // This runs one block through the variants handled by one worker.
+  void ProcessWorkerBlock(int workeridx);
+
+public:
+  // This disables auto-ranging. There are no variants, and workers
+  // aren't started.
+  nloop_SweepPipeline_t(void);
+  // This stops the workers and deletes the variants.
+  ~nloop_SweepPipeline_t(void);
+
+
+  // Variant management.
+  // NOTE - Only add variants while workers are stopped.
+
+  // This adds a variant with default configuration and returns it, or
+  // returns NULL if workers are running. The runner owns the variant.
+  // NOTE - This allocates.
+  variant_t *AddVariant(void);
+
+  // This returns NULL if the variant index is out of range.
+  variant_t *GetVariant(int varidx);
+  int GetVariantCount(void);
+
+
+  // Thread management.
+
+  // This starts "new_workers" workers. Blocks passed to ProcessBlock() are
+  // handed out in chunks of at most "new_maxblock" samples.
+  // If "first_cpu" is non-negative, worker N is pinned to CPU first_cpu+N.
+  // This returns false if workers are already running or the block size or
+  // worker count is invalid.
+  // NOTE - This allocates.
+  bool StartWorkers(int new_maxblock, int new_workers, int first_cpu);
+
+  void StopWorkers(void);
+  bool IsRunning(void);
+
+  // This is the number of workers that couldn't be pinned to their CPU.
+  // Unpinned workers still run.
+  int GetPinFailures(void);
+
+
+  // Processing functions.
+
+  // This runs "count" samples through the shared stages and then through
+  // every variant. If "truthflags" and "truephases" aren't NULL, each
+  // variant scores its outputs against them.
+  // Variant outputs hold the last chunk of at most "maxblock" samples.
+  // This returns false if the workers aren't running.
+  bool ProcessBlock(nloop_SampleSlice_t<samptype_t, 1, chancount> *indata,
+    nloop_SampleSlice_t<bool, 1, chancount> *truthflags,
+    nloop_SampleSlice_t<uint16_t, 1, chancount> *truephases, int count);
+
+
+  // Configuration.
+  // NOTE - Only configure the runner while workers are stopped or between
+  // calls to ProcessBlock().
+
+  // This sets active geometry in the shared stages and in every variant.
+  void SetActiveGeometry(int new_banks, int new_chans);
+
+  // If auto-ranging is disabled, input goes straight to the filter bank.
+  void SetAutoRange(bool want_enabled);
+  bool GetAutoRange(void);
+
+  nloop_AutoRanger_t<samptype_t, indextype_t, chancount> &GetRanger(void);
+  filtbank_t &GetFilterBank(void);
+  nloop_AnalyticBank_PT_t<samptype_t, indextype_t, estimator_t,
+    bankcount, chancount> &GetAnalytic(void);
+
+
+  // Checkpointing. This saves or restores the shared stages' state,
+  // followed by every variant's state in order.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
+};
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-sweep-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,426 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Synthetic LFP generator - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// NOTE - Because this implements template code, it has to be included by
+// every file that instantiates templates.
+// Only one copy of each instantiated variant will actually be compiled;
+// extra copies get pruned at link-time.
+
+// NOTE - Non-template functions here are declared "inline" so that
+// multiple copies don't collide at link-time.
+
+
+//
+// Functions
+
+
+// This returns a sine wave value for a phase in units of 1/2^32 cycles.
+// Each quarter-cycle is approximated by a fifth-order odd polynomial in
+// 16-bit fixed-point, fitted to be exact at 0 and 90 degrees. Error is
+// about 1e-4.
+
+inline int32_t nloop_SynthSine(uint32_t phase)
+{
+  int64_t xval, xsquared, scratch;
+  int quadrant;
+
+  quadrant = (int) (phase >> 30);
+  xval = (int64_t) ((phase >> 14) & 0xffff);
+
+  // Mirror the second and fourth quadrants.
+  if (1 & quadrant)
+    xval = 65536 - xval;
+
+  xsquared = (xval * xval) >> 16;
+  scratch = (4703 * xsquared) >> 16;
+  scratch = 42081 - scratch;
+  scratch = (scratch * xsquared) >> 16;
+  scratch = 102914 - scratch;
+  scratch = (scratch * xval) >> 16;
+
+  scratch >>= (16 - NLOOP_SYNTH_SINE_BITS);
+
+  // The second half-cycle is negative.
+  if (2 & quadrant)
+    scratch = -scratch;
+
+  return (int32_t) scratch;
+}
+
+
+
+//
+// nloop_SynthLFP_t Class
+
+
+// Constructor.
+
+template <class samptype_t, int chancount>
+nloop_SynthLFP_t<samptype_t, chancount>::nloop_SynthLFP_t(void)
+{
+  ResetDefaults();
+  Reset(1);
+}
+
+
+
+// This returns the next pseudorandom value (xorshift64*).
+
+template <class samptype_t, int chancount>
+uint64_t nloop_SynthLFP_t<samptype_t, chancount>::GetRandom(void)
+{
+  rngstate ^= rngstate >> 12;
+  rngstate ^= rngstate << 25;
+  rngstate ^= rngstate >> 27;
+
+  return rngstate * 2685821657736338717ull;
+}
+
+
+
+// This returns a pseudorandom value from "minval" to "maxval" inclusive.
+// The high bits of the generator are the best-mixed, so those are used.
+
+template <class samptype_t, int chancount>
+int32_t nloop_SynthLFP_t<samptype_t, chancount>::GetRandomRange(
+  int32_t minval, int32_t maxval)
+{
+  uint64_t span;
+
+  if (maxval <= minval)
+    return minval;
+
+  span = (uint64_t) ((int64_t) maxval - (int64_t) minval) + 1;
+
+  return (int32_t) ( minval + (int64_t) ((GetRandom() >> 32) % span) );
+}
+
+
+
+// This schedules the next burst on one channel.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::ScheduleGap(int cidx)
+{
+  chans[cidx].in_burst = false;
+  chans[cidx].countdown = GetRandomRange(min_gap, max_gap);
+}
+
+
+
+// This starts a burst on one channel.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::StartBurst(int cidx)
+{
+  int32_t period, cycles;
+
+  period = GetRandomRange(min_period, max_period);
+  cycles = GetRandomRange(min_cycles, max_cycles);
+
+  chans[cidx].in_burst = true;
+  chans[cidx].burst_len = period * cycles;
+  chans[cidx].ramp_len = period;
+  chans[cidx].elapsed = 0;
+  chans[cidx].countdown = chans[cidx].burst_len;
+  chans[cidx].phase = (uint32_t) (GetRandom() >> 32);
+  chans[cidx].phase_step = (uint32_t) ( (((uint64_t) 1) << 32)
+    / (uint64_t) period );
+
+  burstcount++;
+}
+
+
+
+// This generates one channel's next sample, and updates its labels.
+// "pinkrow" is the pink noise row to refresh, or -1 for none.
+
+template <class samptype_t, int chancount>
+samptype_t nloop_SynthLFP_t<samptype_t, chancount>::GenerateChannel(
+  int cidx, int pinkrow, bool &is_burst, uint16_t &phase)
+{
+  chanstate_t &chan = chans[cidx];
+  int64_t value, burstval;
+  int32_t rowamp, envelope, remaining;
+
+  // Background.
+
+  rowamp = background_amp / (NLOOP_SYNTH_PINK_ROWS + 1);
+
+  if (0 <= pinkrow)
+  {
+    chan.pinksum -= chan.pinkrows[pinkrow];
+    chan.pinkrows[pinkrow] = GetRandomRange(-rowamp, rowamp);
+    chan.pinksum += chan.pinkrows[pinkrow];
+  }
+
+  // The white noise term is fresh every sample.
+  value = chan.pinksum + GetRandomRange(-rowamp, rowamp);
+
+
+  // Bursts.
+
+  is_burst = false;
+  phase = 0;
+
+  if (!chan.in_burst)
+  {
+    if (0 < chan.countdown)
+      chan.countdown--;
+    else
+      StartBurst(cidx);
+  }
+
+  if (chan.in_burst)
+  {
+    // Ramp up over the first cycle and down over the last.
+    remaining = chan.burst_len - chan.elapsed;
+    envelope = 1 << NLOOP_SYNTH_ENV_BITS;
+    if (chan.elapsed < chan.ramp_len)
+      envelope = (chan.elapsed << NLOOP_SYNTH_ENV_BITS) / chan.ramp_len;
+    else if (remaining < chan.ramp_len)
+      envelope = (remaining << NLOOP_SYNTH_ENV_BITS) / chan.ramp_len;
+
+    burstval = ((int64_t) burst_amp) * nloop_SynthSine(chan.phase)
+      * envelope;
+    NLOOP_ARITHSHR( burstval,
+      (NLOOP_SYNTH_SINE_BITS + NLOOP_SYNTH_ENV_BITS) );
+    value += burstval;
+
+    is_burst = true;
+    phase = (uint16_t) (chan.phase >> 16);
+
+    chan.phase += chan.phase_step;
+    chan.elapsed++;
+    chan.countdown--;
+
+    if (chan.elapsed >= chan.burst_len)
+      ScheduleGap(cidx);
+  }
+
+
+  // Saturate.
+
+  if (value > (int64_t) NLOOP_MAXVAL(samptype_t))
+    value = (int64_t) NLOOP_MAXVAL(samptype_t);
+  if (value < (int64_t) NLOOP_MINVAL(samptype_t))
+    value = (int64_t) NLOOP_MINVAL(samptype_t);
+
+  return (samptype_t) value;
+}
+
+
+
+// This generates the next sample on every channel, plus labels.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::GenerateSlice(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> &outdata,
+  nloop_SampleSlice_t<bool, 1, chancount> &burstflags,
+  nloop_SampleSlice_t<uint16_t, 1, chancount> &phases)
+{
+  uint64_t scratch;
+  int cidx, pinkrow;
+
+  // Voss-McCartney: sample N refreshes the row given by the number of
+  // trailing zeros in N, so row K is refreshed every 2^(K+1) samples.
+  pinkrow = -1;
+  if (0 < sampcount)
+  {
+    scratch = sampcount;
+    pinkrow = 0;
+    while ( (0 == (scratch & 1)) && (pinkrow < NLOOP_SYNTH_PINK_ROWS) )
+    {
+      scratch >>= 1;
+      pinkrow++;
+    }
+    if (pinkrow >= NLOOP_SYNTH_PINK_ROWS)
+      pinkrow = -1;
+  }
+
+  for (cidx = 0; cidx < chancount; cidx++)
+    outdata.data[0][cidx] = GenerateChannel( cidx, pinkrow,
+      burstflags.data[0][cidx], phases.data[0][cidx] );
+
+  sampcount++;
+}
+
+
+
+// This generates "count" slices, with optional labels.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::GenerateBlock(
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *outdata,
+  nloop_SampleSlice_t<bool, 1, chancount> *burstflags,
+  nloop_SampleSlice_t<uint16_t, 1, chancount> *phases, int count)
+{
+  nloop_SampleSlice_t<bool, 1, chancount> scratchflags;
+  nloop_SampleSlice_t<uint16_t, 1, chancount> scratchphases;
+  int sidx;
+
+  for (sidx = 0; sidx < count; sidx++)
+    GenerateSlice( outdata[sidx],
+      (NULL == burstflags ? scratchflags : burstflags[sidx]),
+      (NULL == phases ? scratchphases : phases[sidx]) );
+}
+
+
+
+// This restarts generation from a seed.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::Reset(uint64_t new_seed)
+{
+  int32_t rowamp;
+  int cidx, ridx;
+
+  seed = new_seed;
+
+  // Xorshift generators can't have a state of zero.
+  rngstate = new_seed ^ 0x9e3779b97f4a7c15ull;
+  if (0 == rngstate)
+    rngstate = 0x9e3779b97f4a7c15ull;
+
+  sampcount = 0;
+  burstcount = 0;
+
+  rowamp = background_amp / (NLOOP_SYNTH_PINK_ROWS + 1);
+
+  for (cidx = 0; cidx < chancount; cidx++)
+  {
+    chans[cidx].pinksum = 0;
+    for (ridx = 0; ridx < NLOOP_SYNTH_PINK_ROWS; ridx++)
+    {
+      chans[cidx].pinkrows[ridx] = GetRandomRange(-rowamp, rowamp);
+      chans[cidx].pinksum += chans[cidx].pinkrows[ridx];
+    }
+
+    chans[cidx].burst_len = 0;
+    chans[cidx].ramp_len = 0;
+    chans[cidx].elapsed = 0;
+    chans[cidx].phase = 0;
+    chans[cidx].phase_step = 0;
+
+    // Channels start partway into their first gap, so they aren't in step.
+    ScheduleGap(cidx);
+  }
+}
+
+
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::Reset(void)
+{
+  Reset(seed);
+}
+
+
+
+// This restores default settings.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::ResetDefaults(void)
+{
+  background_amp = 1000;
+  burst_amp = 4000;
+  min_period = 20;
+  max_period = 40;
+  min_cycles = 3;
+  max_cycles = 8;
+  min_gap = 200;
+  max_gap = 1000;
+}
+
+
+
+// Settings.
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::SetBackgroundAmplitude(
+  int32_t new_amp)
+{
+  if (0 > new_amp)
+    new_amp = 0;
+
+  background_amp = new_amp;
+}
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::SetBurstAmplitude(
+  int32_t new_amp)
+{
+  if (0 > new_amp)
+    new_amp = 0;
+
+  burst_amp = new_amp;
+}
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::SetBurstPeriods(
+  int32_t new_min, int32_t new_max)
+{
+  if (2 > new_min)
+    new_min = 2;
+  if (new_max < new_min)
+    new_max = new_min;
+
+  min_period = new_min;
+  max_period = new_max;
+}
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::SetBurstCycles(
+  int32_t new_min, int32_t new_max)
+{
+  if (2 > new_min)
+    new_min = 2;
+  if (new_max < new_min)
+    new_max = new_min;
+
+  min_cycles = new_min;
+  max_cycles = new_max;
+}
+
+template <class samptype_t, int chancount>
+void nloop_SynthLFP_t<samptype_t, chancount>::SetBurstGaps(
+  int32_t new_min, int32_t new_max)
+{
+  if (1 > new_min)
+    new_min = 1;
+  if (new_max < new_min)
+    new_max = new_min;
+
+  min_gap = new_min;
+  max_gap = new_max;
+}
+
+
+
+// Accessors.
+
+template <class samptype_t, int chancount>
+uint64_t nloop_SynthLFP_t<samptype_t, chancount>::GetSeed(void)
+{
+  return seed;
+}
+
+template <class samptype_t, int chancount>
+uint64_t nloop_SynthLFP_t<samptype_t, chancount>::GetSampleCount(void)
+{
+  return sampcount;
+}
+
+template <class samptype_t, int chancount>
+uint64_t nloop_SynthLFP_t<samptype_t, chancount>::GetBurstCount(void)
+{
+  return burstcount;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,188 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Synthetic LFP generator - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// Wrapper.
+#ifndef NLOOP_SYNTH_H
+#define NLOOP_SYNTH_H
+
+
+// A synthetic LFP generator produces test input for benchmarks and for
+// detection accuracy checks, along with ground truth labels.
+//
+// Each channel gets an independent 1/f ("pink") background, made with the
+// Voss-McCartney method (a sum of random values that are refreshed at
+// octave-spaced rates), plus transient oscillatory bursts. Bursts start at
+// random times, with random period, length, and starting phase; they ramp
+// up over their first cycle and ramp down over their last cycle.
+//
+// For every sample, the generator reports whether each channel is inside
+// a burst, and the burst oscillation's true phase. Phase is in units of
+// 1/65536 of a cycle; phase 0 is the rising zero crossing of the burst
+// waveform (it's a sine wave). Outside of bursts, phase is reported as 0.
+//
+// Everything is integer arithmetic, with a seeded pseudorandom number
+// generator, so the same seed and settings give bit-identical output on
+// every platform. Nothing is allocated.
+//
+// Burst amplitude is the peak value of the burst waveform. Background
+// amplitude is the largest value the background can reach; typical values
+// are much smaller. Output saturates at the limits of "samptype_t".
+
+
+//
+// Constants
+
+// Number of octave-spaced rows in the pink noise generator. More rows
+// extend the 1/f spectrum to lower frequencies.
+#define NLOOP_SYNTH_PINK_ROWS 12
+
+// Phase labels are in units of 1/NLOOP_SYNTH_PHASE_UNITS cycles.
+#define NLOOP_SYNTH_PHASE_UNITS 65536
+
+// Sine waves are computed with this many fractional bits.
+#define NLOOP_SYNTH_SINE_BITS 15
+
+// Envelope ramps are computed with this many fractional bits.
+#define NLOOP_SYNTH_ENV_BITS 8
+
+
+//
+// Classes
+
+
+template <class samptype_t, int chancount>
+class nloop_SynthLFP_t
+{
+protected:
+  // Per-channel state.
+  struct chanstate_t
+  {
+    // Pink noise rows, and their sum.
+    int32_t pinkrows[NLOOP_SYNTH_PINK_ROWS];
+    int64_t pinksum;
+
+    // Burst state. When idle, "countdown" is the number of samples until
+    // the next burst. In a burst, it's the number of samples left.
+    bool in_burst;
+    int32_t countdown;
+    int32_t burst_len, ramp_len, elapsed;
+    uint32_t phase, phase_step;
+  };
+
+  chanstate_t chans[chancount];
+
+  // Pseudorandom generator state.
+  uint64_t rngstate;
+  uint64_t seed;
+
+  // Samples generated since the last reset.
+  uint64_t sampcount;
+  // Bursts started since the last reset.
+  uint64_t burstcount;
+
+  // Configuration.
+  int32_t background_amp;
+  int32_t burst_amp;
+  int32_t min_period, max_period;
+  int32_t min_cycles, max_cycles;
+  int32_t min_gap, max_gap;
+
+
+  // Helper functions.
+
+  // This returns the next pseudorandom value.
+  uint64_t GetRandom(void);
+  // This returns a pseudorandom value from "minval" to "maxval" inclusive.
+  int32_t GetRandomRange(int32_t minval, int32_t maxval);
+
+  // This schedules the next burst on one channel.
+  void ScheduleGap(int cidx);
+  // This starts a burst on one channel.
+  void StartBurst(int cidx);
+
+  // This generates one channel's next sample, and updates its labels.
+  // "pinkrow" is the pink noise row to refresh, or -1 for none.
+  samptype_t GenerateChannel(int cidx, int pinkrow, bool &is_burst,
+    uint16_t &phase);
+
+public:
+  // This uses default settings (see ResetDefaults()) and seed 1.
+  nloop_SynthLFP_t(void);
+  // Default destructor is fine.
+
+
+  // Processing functions.
+
+  // This generates the next sample on every channel, plus ground truth
+  // labels.
+  void GenerateSlice(nloop_SampleSlice_t<samptype_t, 1, chancount> &outdata,
+    nloop_SampleSlice_t<bool, 1, chancount> &burstflags,
+    nloop_SampleSlice_t<uint16_t, 1, chancount> &phases);
+
+  // This generates "count" slices. Label arrays may be NULL if they aren't
+  // wanted.
+  void GenerateBlock(nloop_SampleSlice_t<samptype_t, 1, chancount> *outdata,
+    nloop_SampleSlice_t<bool, 1, chancount> *burstflags,
+    nloop_SampleSlice_t<uint16_t, 1, chancount> *phases, int count);
+
+
+  // Accessors.
+
+  // This restarts generation from a seed. Settings are kept, and the same
+  // seed and settings always give the same output.
+  void Reset(uint64_t new_seed);
+  // This restarts with the current seed.
+  void Reset(void);
+
+  // This restores default settings: background amplitude 1000, burst
+  // amplitude 4000, periods of 20 to 40 samples, 3 to 8 cycles per burst,
+  // and 200 to 1000 samples between bursts. This doesn't reset.
+  void ResetDefaults(void);
+
+  // Settings take effect at the next burst or gap; call Reset() to apply
+  // them from the start.
+  void SetBackgroundAmplitude(int32_t new_amp);
+  void SetBurstAmplitude(int32_t new_amp);
+  // Periods are in samples, and must be at least 2.
+  void SetBurstPeriods(int32_t new_min, int32_t new_max);
+  // Cycle counts must be at least 2 (one to ramp up, one to ramp down).
+  void SetBurstCycles(int32_t new_min, int32_t new_max);
+  // Gaps are in samples, and must be at least 1.
+  void SetBurstGaps(int32_t new_min, int32_t new_max);
+
+  uint64_t GetSeed(void);
+  uint64_t GetSampleCount(void);
+  uint64_t GetBurstCount(void);
+};
+
+
+//
+// Functions
+
+// This returns a sine wave value, with NLOOP_SYNTH_SINE_BITS fractional
+// bits, for a phase in units of 1/2^32 cycles. This is integer-only, so
+// it's bit-identical on every platform.
+int32_t nloop_SynthSine(uint32_t phase);
+
+
+
+//
+// Code Inclusion
+
+// C++ compiles templated classes on-demand. The source code has to be
+// included so that the compiler can do this.
+// Only one copy of each variant will actually be compiled; extra copies get
+// pruned at link-time.
+
+#include "nloop-synth-inc.cpp"
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -97,6 +97,44 @@ SetAvgBits(uint8_t new_avgbits)
 
 
 
+template <class samptype_t, uint8_t coeffbits>
+samptype_t nloop_Averager_t<samptype_t,coeffbits>::
+GetCoeff(void)
+{
+  return coeff;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+uint8_t nloop_Averager_t<samptype_t,coeffbits>::
+GetAvgBits(void)
+{
+  return avgbits;
+}
+
+
+
+// Checkpointing. Only the running sum is state; the rest is configuration.
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_Averager_t<samptype_t,coeffbits>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.PutValue(running_sum);
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits>
+void nloop_Averager_t<samptype_t,coeffbits>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.GetValue(running_sum);
+}
+
+
+
 //
 // nloop_AveragerBank_t Class
 
@@ -130,6 +168,8 @@ UpdateAverage(
 {
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_AVERAGERBANK);
+
   for (bidx = 0; bidx < banks_active; bidx++)
     for (cidx = 0; cidx < chans_active; cidx++)
       outdata.data[bidx][cidx] =
@@ -323,6 +363,76 @@ SetOneAvgBits(int bankidx, int chanidx, uint8_t new_avgbits)
 
 
 
+template <class samptype_t, uint8_t coeffbits, int bankcount, int chancount>
+samptype_t nloop_AveragerBank_t<samptype_t,coeffbits,bankcount,chancount>::
+GetOneCoeff(int bankidx, int chanidx)
+{
+  samptype_t result;
+
+  result = 0;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = averagers[bankidx][chanidx].GetCoeff();
+
+  return result;
+}
+
+
+
+template <class samptype_t, uint8_t coeffbits, int bankcount, int chancount>
+uint8_t nloop_AveragerBank_t<samptype_t,coeffbits,bankcount,chancount>::
+GetOneAvgBits(int bankidx, int chanidx)
+{
+  uint8_t result;
+
+  result = 0;
+
+  if ( (bankidx >= 0) && (bankidx < bankcount)
+    && (chanidx >= 0) && (chanidx < chancount) )
+    result = averagers[bankidx][chanidx].GetAvgBits();
+
+  return result;
+}
+
+
+
+// Checkpointing. Only active banks and channels are stored.
+
+template <class samptype_t, uint8_t coeffbits, int bankcount, int chancount>
+void nloop_AveragerBank_t<samptype_t,coeffbits,bankcount,chancount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag(NLOOP_STATE_AVERAGERBANK, banks_active, chans_active, 0);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      averagers[bidx][cidx].SaveState(statebuf);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template <class samptype_t, uint8_t coeffbits, int bankcount, int chancount>
+void nloop_AveragerBank_t<samptype_t,coeffbits,bankcount,chancount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_AVERAGERBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      averagers[bidx][cidx].LoadState(statebuf);
+}
+
+
+
 //
 // nloop_DeGlitcher_t Class
 
@@ -390,6 +500,30 @@ SetDelays(indextype_t new_rise_delay, indextype_t new_fall_delay)
 
 
 
+// Checkpointing. The delays are configuration and aren't stored.
+
+template <class indextype_t>
+void nloop_DeGlitcher_t<indextype_t>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.PutValue(rise_countdown);
+  statebuf.PutValue(fall_countdown);
+  statebuf.PutValue(last_output);
+}
+
+
+
+template <class indextype_t>
+void nloop_DeGlitcher_t<indextype_t>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.GetValue(rise_countdown);
+  statebuf.GetValue(fall_countdown);
+  statebuf.GetValue(last_output);
+}
+
+
+
 //
 // nloop_DeGlitcherBank_t Class
 
@@ -405,6 +539,8 @@ ProcessSample( nloop_SampleSlice_t<bool,bankcount,chancount> &indata,
 {
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_DEGLITCHERBANK);
+
   for (bidx = 0; bidx < bankcount; bidx++)
     for (cidx = 0; cidx < chancount; cidx++)
       outdata.data[bidx][cidx] =
@@ -487,6 +623,40 @@ SetOneDelays( int bankidx, int chanidx,
 
 
 
+// Checkpointing. This bank has no active geometry, so all de-glitchers
+// are stored.
+
+template <class indextype_t, int bankcount, int chancount>
+void nloop_DeGlitcherBank_t<indextype_t,bankcount,chancount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag(NLOOP_STATE_DEGLITCHERBANK, bankcount, chancount, 0);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      deglitchers[bidx][cidx].SaveState(statebuf);
+}
+
+
+
+template <class indextype_t, int bankcount, int chancount>
+void nloop_DeGlitcherBank_t<indextype_t,bankcount,chancount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag(NLOOP_STATE_DEGLITCHERBANK, bankcount, chancount, 0))
+    return;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      deglitchers[bidx][cidx].LoadState(statebuf);
+}
+
+
+
 //
 // nloop_ThresholdSingleBank_t Class
 
@@ -506,6 +676,8 @@ TestSamples(
 {
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_THRESHSINGLE);
+
   for (bidx = 0; bidx < bankcount; bidx++)
     for (cidx = 0; cidx < chancount; cidx++)
       outflag.data[bidx][cidx] =
@@ -549,6 +721,8 @@ TestDual(
 {
   int bidx, cidx;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_THRESHDUAL);
+
   for (bidx = 0; bidx < bankcount; bidx++)
     for (cidx = 0; cidx < chancount; cidx++)
     {
@@ -560,5 +734,36 @@ TestDual(
 
 
 
+// Checkpointing. This bank has no active geometry, so all flags are stored.
+
+template <int bankcount, int chancount>
+void nloop_ThresholdDualBank_t<bankcount,chancount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx;
+
+  statebuf.PutTag(NLOOP_STATE_THRESHDUAL, bankcount, chancount, 0);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    statebuf.PutArray(prev_state.data[bidx], chancount);
+}
+
+
+
+template <int bankcount, int chancount>
+void nloop_ThresholdDualBank_t<bankcount,chancount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx;
+
+  if (!statebuf.CheckTag(NLOOP_STATE_THRESHDUAL, bankcount, chancount, 0))
+    return;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    statebuf.GetArray(prev_state.data[bidx], chancount);
+}
+
+
+
 //
 // This is the end of the file.
@@ -45,6 +45,13 @@ public:
   void InitAverage(samptype_t indata);
   void SetCoeff(samptype_t new_coeff);
   void SetAvgBits(uint8_t new_avgbits);
+
+  samptype_t GetCoeff(void);
+  uint8_t GetAvgBits(void);
+
+  // Checkpointing. This saves or restores the running sum.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -108,6 +115,15 @@ public:
     nloop_SampleSlice_t<uint8_t,1,chancount> &new_avgbits );
   void SetUniformAvgBits(uint8_t new_avgbits);
   void SetOneAvgBits(int bankidx, int chanidx, uint8_t new_avgbits);
+
+  // These return 0 for out-of-range banks/channels.
+  samptype_t GetOneCoeff(int bankidx, int chanidx);
+  uint8_t GetOneAvgBits(int bankidx, int chanidx);
+
+  // Checkpointing. This saves or restores running sums for active banks
+  // and channels. Loading fails if the active geometry doesn't match.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -135,6 +151,10 @@ public:
 
   // This sets the delays and resets the countdowns.
   void SetDelays(indextype_t new_rise_delay, indextype_t new_fall_delay);
+
+  // Checkpointing. This saves or restores the countdowns and output state.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -165,6 +185,10 @@ public:
     indextype_t new_rise_delay, indextype_t new_fall_delay );
   void SetOneDelays( int bankidx, int chanidx,
     indextype_t new_rise_delay, indextype_t new_fall_delay );
+
+  // Checkpointing. This saves or restores all de-glitchers' state.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -211,6 +235,10 @@ public:
     nloop_SampleSlice_t<bool,bankcount,chancount> &flag_activate,
     nloop_SampleSlice_t<bool,bankcount,chancount> &flag_sustain,
     nloop_SampleSlice_t<bool,bankcount,chancount> &outflag );
+
+  // Checkpointing. This saves or restores the detection state.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -427,6 +427,44 @@ bool nloop_Trigger_t<indextype_t>::GetReRaise(void)
 
 
 
+// Checkpointing. Durations and the re-raise flag are configuration and
+// aren't stored.
+
+template<class indextype_t>
+void nloop_Trigger_t<indextype_t>::SaveState(nloop_StateBuffer_t &statebuf)
+{
+  statebuf.PutValue( (uint8_t) state );
+  statebuf.PutValue(timeout_left);
+  statebuf.PutValue(saved_target);
+  statebuf.PutValue(prev_signal);
+  statebuf.PutValue(unwrap_offset);
+}
+
+
+
+template<class indextype_t>
+void nloop_Trigger_t<indextype_t>::LoadState(nloop_StateBuffer_t &statebuf)
+{
+  uint8_t newstate;
+
+  statebuf.GetValue(newstate);
+  statebuf.GetValue(timeout_left);
+  statebuf.GetValue(saved_target);
+  statebuf.GetValue(prev_signal);
+  statebuf.GetValue(unwrap_offset);
+
+  // Don't trust the stored state number blindly.
+  state = NLOOP_TSTATE_IDLE;
+  if (NLOOP_TSTATE_WAITRISE == newstate)
+    state = NLOOP_TSTATE_WAITRISE;
+  else if (NLOOP_TSTATE_WAITFALL == newstate)
+    state = NLOOP_TSTATE_WAITFALL;
+  else if (NLOOP_TSTATE_WAITCOOL == newstate)
+    state = NLOOP_TSTATE_WAITCOOL;
+}
+
+
+
 //
 // Trigger generator bank.
 
@@ -527,6 +565,8 @@ ProcessSamples(
   int bidx, cidx;
   bool thisout;
 
+  NLOOP_PROFILE_SCOPE(NLOOP_PROF_TRIGGERBANK);
+
   // Reaching the end of the window drops the stimulation quota to zero.
   // We still have to call the update routine to finish pulses that are
   // in progress.
@@ -809,5 +849,47 @@ GetOneReRaise(int bankidx, int chanidx)
 
 
 
+// Checkpointing. Only active triggers are stored.
+
+template<class indextype_t, int bankcount, int chancount>
+void nloop_TriggerBank_t<indextype_t,bankcount,chancount>::
+SaveState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  statebuf.PutTag(NLOOP_STATE_TRIGGERBANK, banks_active, chans_active, 0);
+
+  statebuf.PutValue(trigger_count_left);
+  statebuf.PutValue(window_time_left);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      triggers[bidx][cidx].SaveState(statebuf);
+}
+
+
+
+// Nothing is modified if the active geometry doesn't match.
+
+template<class indextype_t, int bankcount, int chancount>
+void nloop_TriggerBank_t<indextype_t,bankcount,chancount>::
+LoadState(nloop_StateBuffer_t &statebuf)
+{
+  int bidx, cidx;
+
+  if (!statebuf.CheckTag( NLOOP_STATE_TRIGGERBANK,
+    banks_active, chans_active, 0 ))
+    return;
+
+  statebuf.GetValue(trigger_count_left);
+  statebuf.GetValue(window_time_left);
+
+  for (bidx = 0; bidx < banks_active; bidx++)
+    for (cidx = 0; cidx < chans_active; cidx++)
+      triggers[bidx][cidx].LoadState(statebuf);
+}
+
+
+
 //
 // This is the end of the file.
@@ -156,6 +156,10 @@ public:
   indextype_t GetPulseDuration(void);
   indextype_t GetPulseCooldown(void);
   bool GetReRaise(void);
+
+  // Checkpointing. This saves or restores the state machine's state.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -238,6 +242,14 @@ public:
   indextype_t GetOnePulseDuration(int bankidx, int chanidx);
   indextype_t GetOnePulseCooldown(int bankidx, int chanidx);
   bool GetOneReRaise(int bankidx, int chanidx);
+
+
+  // Checkpointing. This saves or restores the priming state (window time
+  // and pulse quota) and the state of active triggers. Enable flags are
+  // configuration and aren't stored.
+  // Loading fails if the active geometry doesn't match.
+  void SaveState(nloop_StateBuffer_t &statebuf);
+  void LoadState(nloop_StateBuffer_t &statebuf);
 };
 
 
@@ -81,10 +81,15 @@ void nloop_IdentifyWinningBanks(
   nloop_SampleSlice_t<bool,1,chancount> &was_local_winner
 )
 {
-  int bidx, cidx;
-  samptype_t thisval, maxval;
+  int cidx;
   int maxidx;
   bool was_local;
+#ifdef NLOOP_USE_DISPATCH
+  samptype_t maxvals[chancount];
+#else
+  int bidx;
+  samptype_t thisval, maxval;
+#endif
 
   if (active_banks > bankcount)
     active_banks = bankcount;
@@ -94,8 +99,18 @@ void nloop_IdentifyWinningBanks(
   selections.SetUniformValue(0);
   was_local_winner.SetUniformValue(false);
 
+#ifdef NLOOP_USE_DISPATCH
+  // Banks are rows of "chancount" samples.
+  if (0 < active_chans)
+    nloop_DispatchArgMax<samptype_t>( &(source.data[0][0]), chancount,
+      active_banks, active_chans, &(selections.data[0][0]), maxvals );
+#endif
+
   for (cidx = 0; cidx < active_chans; cidx++)
   {
+#ifdef NLOOP_USE_DISPATCH
+    maxidx = selections.data[0][cidx];
+#else
     maxval = source.data[0][cidx];
     maxidx = 0;
 
@@ -108,6 +123,7 @@ void nloop_IdentifyWinningBanks(
         maxidx = bidx;
       }
     }
+#endif
 
     was_local = true;
     if ( (0 == maxidx) || ((active_banks-1) == maxidx) )
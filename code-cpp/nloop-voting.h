@@ -38,6 +38,10 @@ void nloop_ConditionallyLatchNew(
 
 // The "was_local_winner" flag is true if the winner was a local maximum,
 // and false if the first or last bank won (edge of the distribution).
+// Ties go to the earlier bank.
+
+// If NLOOP_USE_DISPATCH is defined, this uses nloop_DispatchArgMax() from
+// nloop-dispatch.h.
 
 template <class samptype_t, int bankcount, int chancount>
 void nloop_IdentifyWinningBanks(
@@ -48,6 +52,16 @@ void nloop_IdentifyWinningBanks(
 );
 
 
+#ifdef NLOOP_USE_DISPATCH
+
+// Vector kernel from nloop-dispatch.h (workstation builds).
+template <class samptype_t>
+void nloop_DispatchArgMax(const samptype_t *source, int stride, int banks,
+  int chans, int *selections, samptype_t *maxvals);
+
+#endif
+
+
 //
 // Code Inclusion
 
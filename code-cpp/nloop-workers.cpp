@@ -0,0 +1,119 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Worker thread helpers for multi-threaded runners - implementation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+
+//
+// nloop_BlockBarrier_t Class
+
+
+// Constructor.
+
+nloop_BlockBarrier_t::nloop_BlockBarrier_t(void)
+{
+  block_gen.store(0);
+  workers_done.store(0);
+}
+
+
+
+// This returns the current generation.
+
+unsigned long nloop_BlockBarrier_t::GetGeneration(void)
+{
+  return block_gen.load();
+}
+
+
+
+// This clears the completion count and publishes the next block.
+// NOTE - The completion count is only read by the calling thread, after
+// this, so it doesn't need ordering of its own.
+
+void nloop_BlockBarrier_t::PublishBlock(void)
+{
+  workers_done.store(0, memory_order_relaxed);
+  block_gen.fetch_add(1, memory_order_release);
+}
+
+
+
+// This waits until "workercount" workers have finished the block.
+
+void nloop_BlockBarrier_t::WaitForWorkers(int workercount)
+{
+  int spincount;
+
+  spincount = 0;
+  while (workercount > workers_done.load(memory_order_acquire))
+    nloop_WorkerIdleWait(spincount);
+}
+
+
+
+// This waits for a generation other than "seen_gen", and stores it in
+// "seen_gen".
+
+void nloop_BlockBarrier_t::WaitForBlock(unsigned long &seen_gen)
+{
+  unsigned long this_gen;
+  int spincount;
+
+  spincount = 0;
+  this_gen = block_gen.load(memory_order_acquire);
+  while (this_gen == seen_gen)
+  {
+    nloop_WorkerIdleWait(spincount);
+    this_gen = block_gen.load(memory_order_acquire);
+  }
+
+  seen_gen = this_gen;
+}
+
+
+
+// This reports that the calling worker has finished the block.
+
+void nloop_BlockBarrier_t::FinishBlock(void)
+{
+  workers_done.fetch_add(1, memory_order_release);
+}
+
+
+//
+// Functions
+
+
+// This spins, or yields once we've spun for long enough.
+
+void nloop_WorkerIdleWait(int &spincount)
+{
+  if (NLOOP_WORKER_SPIN_LIMIT > spincount)
+    spincount++;
+  else
+    this_thread::yield();
+}
+
+
+
+// This pins the calling thread to a CPU, if "cpuidx" is non-negative.
+// It returns false if pinning was requested and failed.
+
+bool nloop_WorkerPinThread(int cpuidx)
+{
+  if (0 > cpuidx)
+    return true;
+
+  return nloop_RTPinThread(cpuidx);
+}
+
+
+//
+// This is the end of the file.
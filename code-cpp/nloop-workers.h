@@ -0,0 +1,108 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Worker thread helpers for multi-threaded runners - declarations.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This needs <atomic> and <thread> from C++11 and POSIX thread
+// affinity, so it's workstation-only.
+
+// Wrapper.
+#ifndef NLOOP_WORKERS_H
+#define NLOOP_WORKERS_H
+
+
+// The multi-threaded runners (nloop-shards.h, nloop-stages.h, and
+// nloop-sweep.h) share the same worker plumbing:
+//
+// - Workers are optionally pinned to one CPU each, via nloop_RTPinThread().
+// - A thread with nothing to do polls, spinning for a while and then
+// yielding its time slice (nloop_WorkerIdleWait()).
+// - Runners that hand the same block to every worker at once use a block
+// barrier (nloop_BlockBarrier_t).
+//
+// The block barrier is two counters. The calling thread writes the block
+// and then calls PublishBlock(), which release-increments a generation
+// count. Workers acquire-wait in WaitForBlock() for the generation to
+// change, process the block, and call FinishBlock(), which
+// release-increments a completion count. The calling thread acquire-waits
+// in WaitForWorkers() for every worker to finish before reading worker
+// outputs or publishing the next block, so workers never see a block
+// change under them.
+//
+// To shut down, set a quit flag and call PublishBlock(); workers check the
+// flag after WaitForBlock() returns.
+//
+// NOTE - A worker should start from the generation that was current when
+// it was created (GetGeneration()), not the generation it sees when it
+// first runs. The first block may be published before the thread gets
+// around to running.
+
+
+//
+// Constants
+
+// Number of polling iterations a waiting thread spins for before it
+// starts yielding its time slice.
+#define NLOOP_WORKER_SPIN_LIMIT 20000
+
+
+//
+// Classes
+
+
+// Block barrier between one calling thread and several workers.
+
+class nloop_BlockBarrier_t
+{
+protected:
+  atomic<unsigned long> block_gen;
+  atomic<int> workers_done;
+
+public:
+  // This starts at generation zero with no workers done.
+  nloop_BlockBarrier_t(void);
+  // Default destructor is fine.
+
+
+  // Calling thread.
+
+  // This returns the current generation.
+  unsigned long GetGeneration(void);
+
+  // This clears the completion count and publishes the next block.
+  void PublishBlock(void);
+
+  // This waits until "workercount" workers have finished the block.
+  void WaitForWorkers(int workercount);
+
+
+  // Workers.
+
+  // This waits for a generation other than "seen_gen", and stores it in
+  // "seen_gen".
+  void WaitForBlock(unsigned long &seen_gen);
+
+  // This reports that the calling worker has finished the block.
+  void FinishBlock(void);
+};
+
+
+//
+// Functions
+
+// This spins, or yields once we've spun for long enough. Set "spincount"
+// to zero before the first call, and again after any useful work.
+void nloop_WorkerIdleWait(int &spincount);
+
+// This pins the calling thread to a CPU, if "cpuidx" is non-negative.
+// It returns false if pinning was requested and failed.
+bool nloop_WorkerPinThread(int cpuidx);
+
+
+// End of wrapper.
+#endif
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,203 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Filters with a wider accumulator than sample type.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <math.h>
+
+
+//
+// Constants
+
+// Test geometry.
+#define ACCUMTEST_BANKS 3
+#define ACCUMTEST_CHANS 8
+#define ACCUMTEST_STAGES 2
+#define ACCUMTEST_FIRTAPS 16
+
+#define ACCUMTEST_SAMPLES 4000
+
+// Input amplitude. Products of this with the coefficients below don't fit
+// in 16 bits, but filter outputs do.
+#define ACCUMTEST_AMPLITUDE 12000.0
+
+
+//
+// Types
+
+// Narrow samples with a wide accumulator, and the all-wide reference.
+
+typedef nloop_IIRFilterBank_t<int16_t, int, ACCUMTEST_STAGES,
+  ACCUMTEST_BANKS, ACCUMTEST_CHANS, int32_t> test_iir_narrow_t;
+typedef nloop_IIRFilterBank_t<int32_t, int, ACCUMTEST_STAGES,
+  ACCUMTEST_BANKS, ACCUMTEST_CHANS> test_iir_wide_t;
+// Narrow samples and a narrow accumulator. This should overflow.
+typedef nloop_IIRFilterBank_t<int16_t, int, ACCUMTEST_STAGES,
+  ACCUMTEST_BANKS, ACCUMTEST_CHANS> test_iir_overflow_t;
+
+typedef nloop_FIRFilterBank_t<int16_t, int, ACCUMTEST_FIRTAPS,
+  ACCUMTEST_FIRTAPS, ACCUMTEST_BANKS, ACCUMTEST_CHANS, int32_t>
+  test_fir_narrow_t;
+typedef nloop_FIRFilterBank_t<int32_t, int, ACCUMTEST_FIRTAPS,
+  ACCUMTEST_FIRTAPS, ACCUMTEST_BANKS, ACCUMTEST_CHANS> test_fir_wide_t;
+
+
+//
+// Helper Functions
+
+
+// This configures an IIR bank with gentle first-order low-pass sections
+// (unity DC gain, 8 fractional bits).
+
+template <class bank_t>
+void ConfigureIIR(bank_t &bank)
+{
+  int bidx, sidx;
+
+  bank.SetActiveBanks(ACCUMTEST_BANKS);
+  bank.SetActiveChans(ACCUMTEST_CHANS);
+  bank.SetActiveStages(ACCUMTEST_STAGES);
+
+  for (bidx = 0; bidx < ACCUMTEST_BANKS; bidx++)
+    for (sidx = 0; sidx < ACCUMTEST_STAGES; sidx++)
+      bank.SetCoefficients( sidx, bidx, 8,
+        -128 + 32 * bidx, 0, 64 - 16 * bidx, 64 - 16 * bidx, 0 );
+}
+
+
+
+// This configures a FIR bank with boxcar filters (8 fractional bits).
+
+template <class bank_t>
+void ConfigureFIR(bank_t &bank)
+{
+  int bidx, tidx, taps;
+
+  bank.SetActiveBanks(ACCUMTEST_BANKS);
+  bank.SetActiveChans(ACCUMTEST_CHANS);
+  bank.BlankAllInputBuffers();
+
+  for (bidx = 0; bidx < ACCUMTEST_BANKS; bidx++)
+  {
+    taps = 4 << bidx;
+    bank.SetOneGeometry(bidx, 8, taps);
+    for (tidx = 0; tidx < taps; tidx++)
+      bank.SetOneCoefficient(bidx, tidx, 256 / taps);
+  }
+}
+
+
+
+// This generates one input sample for every channel.
+
+template <class samptype_t>
+void MakeInput(int sidx,
+  nloop_SampleSlice_t<samptype_t, 1, ACCUMTEST_CHANS> &indata)
+{
+  int cidx;
+
+  for (cidx = 0; cidx < ACCUMTEST_CHANS; cidx++)
+    indata.data[0][cidx] = (samptype_t) ( ACCUMTEST_AMPLITUDE
+      * sin( 6.2832 * sidx / (30.0 + 5 * cidx) ) );
+}
+
+
+
+// This returns the number of cells where two output slices differ.
+
+template <class narrow_t, class wide_t>
+int CountMismatches(
+  nloop_SampleSlice_t<narrow_t, ACCUMTEST_BANKS, ACCUMTEST_CHANS> &narrow,
+  nloop_SampleSlice_t<wide_t, ACCUMTEST_BANKS, ACCUMTEST_CHANS> &wide )
+{
+  int bidx, cidx;
+  int result;
+
+  result = 0;
+
+  for (bidx = 0; bidx < ACCUMTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < ACCUMTEST_CHANS; cidx++)
+      if (((wide_t) narrow.data[bidx][cidx]) != wide.data[bidx][cidx])
+        result++;
+
+  return result;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_iir_narrow_t iirnarrow;
+  test_iir_wide_t iirwide;
+  test_iir_overflow_t iiroverflow;
+  test_fir_narrow_t firnarrow;
+  test_fir_wide_t firwide;
+  nloop_SampleSlice_t<int16_t, 1, ACCUMTEST_CHANS> in16;
+  nloop_SampleSlice_t<int32_t, 1, ACCUMTEST_CHANS> in32;
+  nloop_SampleSlice_t<int16_t, ACCUMTEST_BANKS, ACCUMTEST_CHANS> out16;
+  nloop_SampleSlice_t<int32_t, ACCUMTEST_BANKS, ACCUMTEST_CHANS> out32;
+  long iirmismatch, firmismatch, overflowmismatch;
+  int sidx;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Wide accumulator test.\n\n";
+
+  ConfigureIIR(iirnarrow);
+  ConfigureIIR(iirwide);
+  ConfigureIIR(iiroverflow);
+  ConfigureFIR(firnarrow);
+  ConfigureFIR(firwide);
+
+  iirmismatch = 0;
+  firmismatch = 0;
+  overflowmismatch = 0;
+
+  for (sidx = 0; sidx < ACCUMTEST_SAMPLES; sidx++)
+  {
+    MakeInput(sidx, in16);
+    MakeInput(sidx, in32);
+
+    iirwide.ApplyBankOnce(in32, out32);
+    iirnarrow.ApplyBankOnce(in16, out16);
+    iirmismatch += CountMismatches(out16, out32);
+    iiroverflow.ApplyBankOnce(in16, out16);
+    overflowmismatch += CountMismatches(out16, out32);
+
+    firwide.ApplyBankOnce(in32, out32);
+    firnarrow.ApplyBankOnce(in16, out16);
+    firmismatch += CountMismatches(out16, out32);
+  }
+
+  cout << "IIR, int16 samples with int32 accumulator: " << iirmismatch
+    << " mismatches against int32.\n";
+  cout << "FIR, int16 samples with int32 accumulator: " << firmismatch
+    << " mismatches against int32.\n";
+  cout << "IIR, int16 samples with int16 accumulator: " << overflowmismatch
+    << " mismatches against int32 (overflow expected).\n";
+
+  is_ok = (0 == iirmismatch) && (0 == firmismatch)
+    && (0 < overflowmismatch);
+
+  cout << "Wide accumulator test " << (is_ok ? "passed" : "FAILED")
+    << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of wide accumulator test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,246 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Lock-free acquisition ring buffer.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+
+
+//
+// Constants
+
+// Ring geometry.
+#define ACQTEST_CHANS 64
+#define ACQTEST_DEPTH 1024
+#define ACQTEST_MAXBLOCK 128
+
+// Frames streamed from the acquisition thread to the DSP thread.
+#define ACQTEST_FRAMES 2000000
+#define ACQTEST_BLOCKSIZE 100
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, ACQTEST_CHANS> test_frame_t;
+
+typedef nloop_AcqRing_t<int32_t, ACQTEST_CHANS, ACQTEST_DEPTH,
+  ACQTEST_MAXBLOCK> test_ring_t;
+
+
+//
+// Helper Functions
+
+
+// This fills a frame with a pattern identifying its sequence number.
+
+void MakeFrame(long seqnum, test_frame_t &frame)
+{
+  int cidx;
+
+  for (cidx = 0; cidx < ACQTEST_CHANS; cidx++)
+    frame.data[0][cidx] = (int32_t) (seqnum * ACQTEST_CHANS + cidx);
+}
+
+
+
+// This checks a run of frames against the pattern, returning the number
+// of frames that don't match.
+
+int CheckFrames(long firstseq, test_frame_t *frames, int count)
+{
+  int fidx, cidx, mismatches;
+
+  mismatches = 0;
+  for (fidx = 0; fidx < count; fidx++)
+    for (cidx = 0; cidx < ACQTEST_CHANS; cidx++)
+      if ( frames[fidx].data[0][cidx]
+        != (int32_t) ((firstseq + fidx) * ACQTEST_CHANS + cidx) )
+      {
+        mismatches++;
+        break;
+      }
+
+  return mismatches;
+}
+
+
+
+// Acquisition thread. This writes frames straight into the ring in
+// irregular batches, waiting whenever it's full.
+
+void ProducerLoop(test_ring_t *ring)
+{
+  test_frame_t *span;
+  long seqnum;
+  int spancount, batch, fidx;
+
+  seqnum = 0;
+  batch = 1;
+
+  while (seqnum < ACQTEST_FRAMES)
+  {
+    span = ring->GetWriteSpan(spancount);
+    if (NULL == span)
+    {
+      this_thread::yield();
+      continue;
+    }
+
+    // Vary batch sizes between 1 and 97 frames.
+    batch = (batch * 37 + 11) % 97 + 1;
+    if (spancount > batch)
+      spancount = batch;
+    if (spancount > (ACQTEST_FRAMES - seqnum))
+      spancount = ACQTEST_FRAMES - seqnum;
+
+    for (fidx = 0; fidx < spancount; fidx++)
+      MakeFrame(seqnum + fidx, span[fidx]);
+
+    ring->CommitWrite(spancount);
+    seqnum += spancount;
+  }
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_ring_t *ring;
+  test_frame_t *frames, *block;
+  thread producer;
+  chrono::steady_clock::time_point tstart;
+  double elapsed;
+  long seqnum;
+  int fidx, thiscount, mismatches;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Acquisition ring buffer test.\n\n";
+
+  // These are too large for the stack.
+  ring = new test_ring_t;
+  frames = new test_frame_t[ACQTEST_DEPTH + ACQTEST_MAXBLOCK];
+
+  for (fidx = 0; fidx < (ACQTEST_DEPTH + ACQTEST_MAXBLOCK); fidx++)
+    MakeFrame(fidx, frames[fidx]);
+
+
+  // Overruns. Pushing more than fits should drop the excess and count it.
+
+  is_ok = (ACQTEST_DEPTH == ring->PushFrames( frames,
+    ACQTEST_DEPTH + ACQTEST_MAXBLOCK ));
+  is_ok = is_ok && (0 == ring->PushFrames(frames, 1));
+  is_ok = is_ok && (ACQTEST_MAXBLOCK + 1 == ring->GetOverrunFrames())
+    && (2 == ring->GetOverrunEvents())
+    && (ACQTEST_DEPTH == ring->GetPeakFill())
+    && (ACQTEST_DEPTH == ring->GetReadableCount());
+
+  cout << "Overruns: " << ring->GetOverrunFrames() << " frames in "
+    << ring->GetOverrunEvents() << " events (peak fill "
+    << ring->GetPeakFill() << ").\n";
+
+
+  // Blocks that wrap around the end of the ring should still be
+  // contiguous.
+
+  mismatches = 0;
+  seqnum = 0;
+  while (seqnum < (ACQTEST_DEPTH - ACQTEST_MAXBLOCK / 2))
+  {
+    block = ring->GetReadBlock(ACQTEST_MAXBLOCK / 2);
+    is_ok = is_ok && (NULL != block);
+    if (NULL == block)
+      break;
+    mismatches += CheckFrames(seqnum, block, ACQTEST_MAXBLOCK / 2);
+    ring->ReleaseRead(ACQTEST_MAXBLOCK / 2);
+    seqnum += ACQTEST_MAXBLOCK / 2;
+  }
+
+  // Oversized requests and requests for more than is available fail.
+  is_ok = is_ok && (NULL == ring->GetReadBlock(ACQTEST_MAXBLOCK + 1))
+    && (NULL == ring->GetReadBlock(ACQTEST_MAXBLOCK));
+
+  // Top up, then read one block that straddles the end.
+  is_ok = is_ok && ( ACQTEST_MAXBLOCK == ring->PushFrames(
+    frames + ACQTEST_DEPTH, ACQTEST_MAXBLOCK ) );
+  block = ring->GetReadBlock(ACQTEST_MAXBLOCK);
+  is_ok = is_ok && (NULL != block);
+  if (NULL != block)
+  {
+    mismatches += CheckFrames(seqnum, block, ACQTEST_MAXBLOCK);
+    ring->ReleaseRead(ACQTEST_MAXBLOCK);
+  }
+
+  cout << "Wrapped reads: " << mismatches << " mismatched frames.\n";
+  is_ok = is_ok && (0 == mismatches);
+
+
+  // Stream frames from an acquisition thread, and read them in blocks.
+
+  ring->Clear();
+  is_ok = is_ok && (0 == ring->GetOverrunFrames())
+    && (0 == ring->GetReadableCount());
+
+  mismatches = 0;
+  seqnum = 0;
+
+  tstart = chrono::steady_clock::now();
+  producer = thread(ProducerLoop, ring);
+
+  while (seqnum < ACQTEST_FRAMES)
+  {
+    thiscount = ACQTEST_FRAMES - seqnum;
+    if (thiscount > ACQTEST_BLOCKSIZE)
+      thiscount = ACQTEST_BLOCKSIZE;
+
+    block = ring->GetReadBlock(thiscount);
+    if (NULL == block)
+    {
+      this_thread::yield();
+      continue;
+    }
+
+    mismatches += CheckFrames(seqnum, block, thiscount);
+    ring->ReleaseRead(thiscount);
+    seqnum += thiscount;
+  }
+
+  producer.join();
+  elapsed = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  cout << "Streamed " << ACQTEST_FRAMES << " frames of " << ACQTEST_CHANS
+    << " channels: " << mismatches << " mismatched, "
+    << ring->GetOverrunFrames() << " overruns, peak fill "
+    << ring->GetPeakFill() << ", "
+    << (ACQTEST_FRAMES / (elapsed * 1.0e6)) << " Mframes/sec.\n";
+
+  is_ok = is_ok && (0 == mismatches) && (0 == ring->GetOverrunFrames())
+    && (0 == ring->GetReadableCount());
+
+
+  cout << "Acquisition ring test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  delete ring;
+  delete[] frames;
+
+  // Ending banner.
+  cout << "\n== End of acquisition ring test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,623 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Benchmark regression check.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// This compares "modbench" results against a stored baseline, and fails if
+// any kernel got slower by more than its tolerance. Usage:
+//
+//   ./benchcompare <baseline file> <results file> [more results...]
+//   ./benchcompare -u <baseline file> <results file> [more results...]
+//
+// If several results files are given (from repeated runs), the fastest
+// time for each kernel is used.
+//
+// The first form prints a table of regressions (and of improvements, which
+// suggest the baseline is stale) and returns non-zero if there were any
+// regressions or if kernels are missing from the results.
+//
+// The second form rewrites the baseline using the new results. Tolerance
+// settings from the old baseline are kept.
+//
+// The baseline is a "modbench" results file with two extra top-level
+// fields:
+//
+//   "default_tolerance_pct": 25,
+//   "tolerances": [
+//     { "match": "fir-bank", "tolerance_pct": 30 },
+//     { "match": "voting/int16/1x16", "tolerance_pct": 60 }
+//   ],
+//
+// A tolerance entry matches a kernel name ("fir-bank"), a kernel and type
+// ("fir-bank/int16"), or a full result ID ("fir-bank/int16/1x16"). The
+// most specific match wins. Times are compared using "ns_per_slice".
+//
+// NOTE - This only reads the flat JSON that "modbench" writes; it isn't a
+// general JSON parser. Objects in lists can't contain further objects.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <string.h>
+#include <sstream>
+
+
+//
+// Constants
+
+// Must match "modbench".
+#define BENCHCMP_FORMAT_VERSION 1
+
+// Default slowdown tolerance, in percent.
+#define BENCHCMP_DEFAULT_TOLERANCE 25.0
+
+// Width of the kernel ID column in reports.
+#define BENCHCMP_ID_WIDTH 30
+
+
+//
+// Types
+
+// One flat JSON object: field values by name, plus its source text.
+struct cmp_object_t
+{
+  map<string, string> fields;
+  string text;
+};
+
+
+// One parsed benchmark file.
+struct cmp_file_t
+{
+  int format_version;
+  double default_tolerance;
+
+  // Results by ID, plus IDs in file order.
+  map<string, double> ns_per_slice;
+  map<string, string> result_text;
+  vector<string> result_ids;
+
+  // Tolerance overrides by match string, plus match strings in file order.
+  map<string, double> tolerances;
+  vector<string> tolerance_order;
+};
+
+
+// One line of the comparison report.
+struct cmp_row_t
+{
+  string id;
+  double baseline, current, change_pct, tolerance;
+};
+
+
+//
+// Helper Functions
+
+
+// This prints usage information.
+
+void PrintUsage(void)
+{
+  cerr <<
+"Usage:  benchcompare <baseline file> <results file> [more results...]\n"
+"        benchcompare -u <baseline file> <results file> [more results...]\n"
+"\n"
+"Compares modbench results against a baseline, failing if any kernel is\n"
+"slower than its tolerance allows. With -u, the baseline is rewritten from\n"
+"the results instead (keeping its tolerance settings). With several\n"
+"results files, the fastest time for each kernel is used.\n";
+}
+
+
+
+// This reads a whole file into a string. It returns false on error.
+
+bool ReadWholeFile(string fname, string &contents)
+{
+  ifstream infile;
+  stringstream scratch;
+
+  contents = "";
+
+  infile.open(fname.c_str());
+  if (!infile.is_open())
+    return false;
+
+  scratch << infile.rdbuf();
+  contents = scratch.str();
+
+  return true;
+}
+
+
+
+// This returns the value following "key": at the top level of a file, or
+// an empty string if it isn't present. Quotes are stripped from strings.
+
+string FindTopLevelValue(string &text, string key)
+{
+  size_t keypos, startpos, endpos;
+
+  keypos = text.find("\"" + key + "\"");
+  if (string::npos == keypos)
+    return "";
+
+  startpos = text.find(':', keypos);
+  if (string::npos == startpos)
+    return "";
+
+  startpos = text.find_first_not_of(" \t\r\n", startpos + 1);
+  if (string::npos == startpos)
+    return "";
+
+  if ('"' == text[startpos])
+  {
+    endpos = text.find('"', startpos + 1);
+    if (string::npos == endpos)
+      return "";
+    return text.substr(startpos + 1, endpos - startpos - 1);
+  }
+
+  endpos = text.find_first_of(",}] \t\r\n", startpos);
+  if (string::npos == endpos)
+    endpos = text.size();
+
+  return text.substr(startpos, endpos - startpos);
+}
+
+
+
+// This parses the fields of one flat object (the text between braces).
+
+void ParseObjectFields(string body, map<string, string> &fields)
+{
+  size_t pos, endpos;
+  string key, value;
+
+  fields.clear();
+  pos = 0;
+
+  while (pos < body.size())
+  {
+    // Key.
+    pos = body.find('"', pos);
+    if (string::npos == pos)
+      break;
+    endpos = body.find('"', pos + 1);
+    if (string::npos == endpos)
+      break;
+    key = body.substr(pos + 1, endpos - pos - 1);
+
+    pos = body.find(':', endpos);
+    if (string::npos == pos)
+      break;
+    pos = body.find_first_not_of(" \t\r\n", pos + 1);
+    if (string::npos == pos)
+      break;
+
+    // Value. Strings are quoted; anything else runs to the next comma.
+    if ('"' == body[pos])
+    {
+      endpos = body.find('"', pos + 1);
+      if (string::npos == endpos)
+        break;
+      value = body.substr(pos + 1, endpos - pos - 1);
+      pos = endpos + 1;
+    }
+    else
+    {
+      endpos = body.find_first_of(", \t\r\n", pos);
+      if (string::npos == endpos)
+        endpos = body.size();
+      value = body.substr(pos, endpos - pos);
+      pos = endpos;
+    }
+
+    fields[key] = value;
+
+    pos = body.find(',', pos);
+    if (string::npos == pos)
+      break;
+    pos++;
+  }
+}
+
+
+
+// This finds every object that doesn't contain other objects.
+
+void FindFlatObjects(string &text, vector<cmp_object_t> &objects)
+{
+  cmp_object_t thisobject;
+  size_t pos, startpos;
+  bool in_string, have_start;
+
+  objects.clear();
+  in_string = false;
+  have_start = false;
+  startpos = 0;
+
+  for (pos = 0; pos < text.size(); pos++)
+  {
+    if (in_string)
+    {
+      if ('\\' == text[pos])
+        pos++;
+      else if ('"' == text[pos])
+        in_string = false;
+    }
+    else if ('"' == text[pos])
+      in_string = true;
+    else if ('{' == text[pos])
+    {
+      have_start = true;
+      startpos = pos;
+    }
+    else if ( ('}' == text[pos]) && have_start )
+    {
+      thisobject.text = text.substr(startpos, pos + 1 - startpos);
+      ParseObjectFields( text.substr(startpos + 1, pos - startpos - 1),
+        thisobject.fields );
+      objects.push_back(thisobject);
+      have_start = false;
+    }
+  }
+}
+
+
+
+// This reads a results or baseline file. It returns false on error.
+
+bool ReadBenchFile(string fname, cmp_file_t &contents)
+{
+  string text, scratch;
+  vector<cmp_object_t> objects;
+  size_t oidx;
+
+  contents.format_version = 0;
+  contents.default_tolerance = BENCHCMP_DEFAULT_TOLERANCE;
+  contents.ns_per_slice.clear();
+  contents.result_text.clear();
+  contents.result_ids.clear();
+  contents.tolerances.clear();
+  contents.tolerance_order.clear();
+
+  if (!ReadWholeFile(fname, text))
+  {
+    cerr << "Couldn't read \"" << fname << "\".\n";
+    return false;
+  }
+
+  if ("nloop-modbench" != FindTopLevelValue(text, "suite"))
+  {
+    cerr << "\"" << fname << "\" isn't a modbench results file.\n";
+    return false;
+  }
+
+  scratch = FindTopLevelValue(text, "format_version");
+  if ("" != scratch)
+    contents.format_version = atoi(scratch.c_str());
+
+  scratch = FindTopLevelValue(text, "default_tolerance_pct");
+  if ("" != scratch)
+    contents.default_tolerance = atof(scratch.c_str());
+
+  FindFlatObjects(text, objects);
+
+  for (oidx = 0; oidx < objects.size(); oidx++)
+  {
+    map<string, string> &fields = objects[oidx].fields;
+
+    if ( fields.count("id") && fields.count("ns_per_slice") )
+    {
+      if (0 == contents.ns_per_slice.count(fields["id"]))
+        contents.result_ids.push_back(fields["id"]);
+      contents.ns_per_slice[fields["id"]] =
+        atof(fields["ns_per_slice"].c_str());
+      contents.result_text[fields["id"]] = objects[oidx].text;
+    }
+    else if ( fields.count("match") && fields.count("tolerance_pct") )
+    {
+      if (0 == contents.tolerances.count(fields["match"]))
+        contents.tolerance_order.push_back(fields["match"]);
+      contents.tolerances[fields["match"]] =
+        atof(fields["tolerance_pct"].c_str());
+    }
+  }
+
+  return true;
+}
+
+
+
+// This merges another run's results into "results", keeping the fastest
+// time seen for each kernel. The fastest of several runs is much less
+// sensitive to other load on the machine than any single run.
+
+void MergeFastest(cmp_file_t &results, cmp_file_t &otherrun)
+{
+  string id;
+  size_t ridx;
+
+  for (ridx = 0; ridx < otherrun.result_ids.size(); ridx++)
+  {
+    id = otherrun.result_ids[ridx];
+
+    if (0 == results.ns_per_slice.count(id))
+      results.result_ids.push_back(id);
+    else if (results.ns_per_slice[id] <= otherrun.ns_per_slice[id])
+      continue;
+
+    results.ns_per_slice[id] = otherrun.ns_per_slice[id];
+    results.result_text[id] = otherrun.result_text[id];
+  }
+}
+
+
+
+// This returns the tolerance for a result ID. The most specific matching
+// entry wins.
+
+double GetTolerance(cmp_file_t &baseline, string id)
+{
+  size_t slashpos;
+
+  if (baseline.tolerances.count(id))
+    return baseline.tolerances[id];
+
+  slashpos = id.rfind('/');
+  if (string::npos != slashpos)
+  {
+    id = id.substr(0, slashpos);
+    if (baseline.tolerances.count(id))
+      return baseline.tolerances[id];
+
+    slashpos = id.rfind('/');
+    if (string::npos != slashpos)
+    {
+      id = id.substr(0, slashpos);
+      if (baseline.tolerances.count(id))
+        return baseline.tolerances[id];
+    }
+  }
+
+  return baseline.default_tolerance;
+}
+
+
+
+// This prints one report table.
+
+void PrintTable(const char *title, vector<cmp_row_t> &rows)
+{
+  char linebuf[256];
+  size_t ridx;
+
+  if (rows.empty())
+    return;
+
+  cout << title << ":\n";
+
+  snprintf( linebuf, sizeof(linebuf), "  %-*s %12s %12s %9s %10s\n",
+    BENCHCMP_ID_WIDTH, "kernel", "baseline ns", "current ns", "change",
+    "tolerance" );
+  cout << linebuf;
+
+  for (ridx = 0; ridx < rows.size(); ridx++)
+  {
+    snprintf( linebuf, sizeof(linebuf),
+      "  %-*s %12.2f %12.2f %+8.1f%% %9.0f%%\n",
+      BENCHCMP_ID_WIDTH, rows[ridx].id.c_str(), rows[ridx].baseline,
+      rows[ridx].current, rows[ridx].change_pct, rows[ridx].tolerance );
+    cout << linebuf;
+  }
+
+  cout << "\n";
+}
+
+
+
+// This compares results against a baseline and prints a report. It returns
+// false if anything regressed or is missing.
+
+bool CompareResults(cmp_file_t &baseline, cmp_file_t &results)
+{
+  vector<cmp_row_t> regressions, improvements;
+  vector<string> missing, added;
+  cmp_row_t thisrow;
+  size_t ridx;
+
+  for (ridx = 0; ridx < baseline.result_ids.size(); ridx++)
+  {
+    thisrow.id = baseline.result_ids[ridx];
+
+    if (0 == results.ns_per_slice.count(thisrow.id))
+    {
+      missing.push_back(thisrow.id);
+      continue;
+    }
+
+    thisrow.baseline = baseline.ns_per_slice[thisrow.id];
+    thisrow.current = results.ns_per_slice[thisrow.id];
+    thisrow.tolerance = GetTolerance(baseline, thisrow.id);
+    thisrow.change_pct = 0;
+    if (thisrow.baseline > 0)
+      thisrow.change_pct =
+        100.0 * (thisrow.current - thisrow.baseline) / thisrow.baseline;
+
+    // Getting faster by the same margin means the baseline is stale.
+    if (thisrow.change_pct > thisrow.tolerance)
+      regressions.push_back(thisrow);
+    else if ( (-thisrow.change_pct) > thisrow.tolerance )
+      improvements.push_back(thisrow);
+  }
+
+  for (ridx = 0; ridx < results.result_ids.size(); ridx++)
+    if (0 == baseline.ns_per_slice.count(results.result_ids[ridx]))
+      added.push_back(results.result_ids[ridx]);
+
+  PrintTable("Regressions", regressions);
+  PrintTable("Improvements (consider updating the baseline)", improvements);
+
+  if (!missing.empty())
+  {
+    cout << "Missing from results:\n";
+    for (ridx = 0; ridx < missing.size(); ridx++)
+      cout << "  " << missing[ridx] << "\n";
+    cout << "\n";
+  }
+
+  if (!added.empty())
+  {
+    cout << "Not in baseline:\n";
+    for (ridx = 0; ridx < added.size(); ridx++)
+      cout << "  " << added[ridx] << "\n";
+    cout << "\n";
+  }
+
+  cout << "Compared " << (baseline.result_ids.size() - missing.size())
+    << " kernels: " << regressions.size() << " regressed, "
+    << improvements.size() << " improved, " << missing.size()
+    << " missing, " << added.size() << " new.\n";
+
+  return regressions.empty() && missing.empty();
+}
+
+
+
+// This writes a new baseline from results, keeping the old baseline's
+// tolerance settings. It returns false on error.
+
+bool WriteBaseline(string fname, cmp_file_t &oldbaseline,
+  cmp_file_t &results)
+{
+  ofstream outfile;
+  size_t tidx, ridx;
+
+  outfile.open(fname.c_str());
+  if (!outfile.is_open())
+  {
+    cerr << "Couldn't write \"" << fname << "\".\n";
+    return false;
+  }
+
+  outfile << "{\n"
+    << "  \"suite\": \"nloop-modbench\",\n"
+    << "  \"format_version\": " << results.format_version << ",\n"
+    << "  \"default_tolerance_pct\": " << oldbaseline.default_tolerance
+    << ",\n"
+    << "  \"tolerances\": [\n";
+
+  for (tidx = 0; tidx < oldbaseline.tolerance_order.size(); tidx++)
+    outfile << "    { \"match\": \"" << oldbaseline.tolerance_order[tidx]
+      << "\", \"tolerance_pct\": "
+      << oldbaseline.tolerances[oldbaseline.tolerance_order[tidx]] << " }"
+      << ( (tidx + 1) < oldbaseline.tolerance_order.size() ? ",\n" : "\n" );
+
+  outfile << "  ],\n"
+    << "  \"results\": [\n";
+
+  for (ridx = 0; ridx < results.result_ids.size(); ridx++)
+    outfile << "    " << results.result_text[results.result_ids[ridx]]
+      << ( (ridx + 1) < results.result_ids.size() ? ",\n" : "\n" );
+
+  outfile << "  ]\n}\n";
+
+  return outfile.good();
+}
+
+
+//
+// Main Program
+
+
+int main(int argc, char **argv)
+{
+  cmp_file_t baseline, results, thisrun;
+  string basename;
+  int firstarg, aidx;
+  bool want_update, is_ok;
+
+  want_update = (argc > 1) && (0 == strcmp(argv[1], "-u"));
+  firstarg = (want_update ? 2 : 1);
+
+  if ( argc < (firstarg + 2) )
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  basename = argv[firstarg];
+
+
+  // Read every run, keeping the fastest time for each kernel.
+
+  for (aidx = firstarg + 1; aidx < argc; aidx++)
+  {
+    if (!ReadBenchFile(argv[aidx], thisrun))
+      return 2;
+
+    if (BENCHCMP_FORMAT_VERSION != thisrun.format_version)
+    {
+      cerr << "\"" << argv[aidx] << "\" has format version "
+        << thisrun.format_version << " (expected "
+        << BENCHCMP_FORMAT_VERSION << ").\n";
+      return 2;
+    }
+
+    if ( (firstarg + 1) == aidx )
+      results = thisrun;
+    else
+      MergeFastest(results, thisrun);
+  }
+
+
+  // Updating. A missing baseline just means default tolerances.
+
+  if (want_update)
+  {
+    if (!ReadBenchFile(basename, baseline))
+      cerr << "Starting a new baseline.\n";
+
+    is_ok = WriteBaseline(basename, baseline, results);
+    if (is_ok)
+      cout << "Wrote " << results.result_ids.size() << " results to \""
+        << basename << "\".\n";
+
+    return (is_ok ? 0 : 2);
+  }
+
+
+  // Comparing.
+
+  if (!ReadBenchFile(basename, baseline))
+    return 2;
+
+  if (baseline.format_version != results.format_version)
+  {
+    cerr << "Baseline format version " << baseline.format_version
+      << " doesn't match results version " << results.format_version
+      << "; update the baseline.\n";
+    return 2;
+  }
+
+  cout << "Comparing the fastest of " << (argc - firstarg - 1)
+    << " run(s) against \"" << basename << "\" (default tolerance "
+    << baseline.default_tolerance << "%).\n\n";
+
+  is_ok = CompareResults(baseline, results);
+
+  cout << "Benchmark check " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,520 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Configuration hot-swapping between threads.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <string.h>
+
+
+//
+// Constants
+
+// Number of configuration updates pushed by the control thread.
+#define SWAPTEST_UPDATES 200
+
+// Slices per DSP block.
+#define SWAPTEST_BLOCKLEN 64
+
+// Test geometry.
+#define SWAPTEST_BANKS 4
+#define SWAPTEST_CHANS 16
+#define SWAPTEST_STAGES 2
+#define SWAPTEST_LUTROWS 8
+
+
+//
+// Types
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  SWAPTEST_STAGES, SWAPTEST_BANKS, SWAPTEST_CHANS> test_biquadbank_t;
+
+typedef nloop_SampleSlice_t<int32_t, 1, SWAPTEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<int32_t, SWAPTEST_BANKS, SWAPTEST_CHANS>
+  test_sampslice_t;
+
+
+// One swappable configuration: filters, a LUT, and thresholds.
+
+struct test_config_t
+{
+  test_biquadbank_t biquads;
+  nloop_LookupMonoStepPerBank_t<int32_t, int16_t,
+    SWAPTEST_LUTROWS, SWAPTEST_BANKS, 1> lut;
+  test_sampslice_t thresholds;
+  int generation;
+
+  // Only the filters have processing state.
+  void SaveState(nloop_StateBuffer_t &statebuf)
+  { biquads.SaveState(statebuf); }
+  void LoadState(nloop_StateBuffer_t &statebuf)
+  { biquads.LoadState(statebuf); }
+};
+
+typedef nloop_ConfigSwap_t<test_config_t> test_swap_t;
+
+
+// A configuration with two stateful modules, for checking that a carry
+// that fails on the second module doesn't leave the first one modified.
+
+struct test_pair_t
+{
+  test_biquadbank_t first;
+  test_biquadbank_t second;
+
+  void SaveState(nloop_StateBuffer_t &statebuf)
+  { first.SaveState(statebuf); second.SaveState(statebuf); }
+  void LoadState(nloop_StateBuffer_t &statebuf)
+  { first.LoadState(statebuf); second.LoadState(statebuf); }
+};
+
+typedef nloop_ConfigSwap_t<test_pair_t> test_pairswap_t;
+
+
+//
+// Helper Functions
+
+
+// This builds biquad CSV text for one configuration generation.
+// Coefficients are feed-forward only (stable), and "num1" is the
+// generation number so that torn updates can be detected.
+
+string BuildBiquadText(int generation)
+{
+  ostringstream textstream;
+  int bidx, sidx;
+
+  textstream << "bank,stage,num0,num1,num2,den0,den1,den2\n";
+  for (bidx = 0; bidx < SWAPTEST_BANKS; bidx++)
+    for (sidx = 0; sidx < SWAPTEST_STAGES; sidx++)
+      textstream << bidx << "," << sidx << ",32768," << generation
+        << ",0,65536,0,0\n";
+
+  return textstream.str();
+}
+
+
+
+// This loads one configuration generation. Odd generations are read from
+// CSV and even ones from a binary snapshot, as a control thread would.
+
+void LoadConfig(test_config_t &config, int generation)
+{
+  int bidx, ridx;
+
+  config.biquads.SetActiveBanks(SWAPTEST_BANKS);
+  config.biquads.SetActiveChans(SWAPTEST_CHANS);
+  config.biquads.SetActiveStages(SWAPTEST_STAGES);
+
+  if (generation & 1)
+  {
+    istringstream instream(BuildBiquadText(generation));
+    nloop_ReadBiquadCoeffs<int32_t>(instream, config.biquads);
+  }
+  else
+  {
+    test_biquadbank_t *scratch;
+    nloop_SnapshotWriter_t snapwriter;
+    nloop_SnapshotFile_t snapfile;
+    ostringstream snapstream;
+    string snaptext;
+
+    scratch = new test_biquadbank_t;
+    scratch->SetActiveBanks(SWAPTEST_BANKS);
+    scratch->SetActiveChans(SWAPTEST_CHANS);
+    scratch->SetActiveStages(SWAPTEST_STAGES);
+    {
+      istringstream instream(BuildBiquadText(generation));
+      nloop_ReadBiquadCoeffs<int32_t>(instream, *scratch);
+    }
+
+    nloop_WriteBiquadSnapshot<int32_t>(snapwriter, 1, *scratch);
+    snapwriter.WriteToStream(snapstream);
+    snaptext = snapstream.str();
+
+    snapfile.AttachBuffer(snaptext.data(), snaptext.size());
+    nloop_ReadBiquadSnapshot<int32_t>(snapfile, 1, config.biquads);
+    snapfile.Close();
+
+    delete scratch;
+  }
+
+  config.lut.SetActiveBanks(SWAPTEST_BANKS);
+  config.lut.SetActiveChans(1);
+  config.lut.SetActiveRows(SWAPTEST_LUTROWS);
+  for (bidx = 0; bidx < SWAPTEST_BANKS; bidx++)
+    for (ridx = 0; ridx < SWAPTEST_LUTROWS; ridx++)
+      config.lut.SetOneEntry(bidx, ridx, ridx * 1000, generation);
+
+  config.thresholds.SetUniformValue(generation);
+  config.generation = generation;
+}
+
+
+
+// This checks that every part of a configuration is from one generation.
+
+bool ConfigIsConsistent(test_config_t &config)
+{
+  uint8_t den0bits;
+  int32_t den1, den2, num0, num1, num2;
+  int32_t lutin;
+  int16_t lutout;
+  int bidx, sidx, cidx;
+  bool is_ok;
+
+  is_ok = true;
+
+  for (bidx = 0; bidx < SWAPTEST_BANKS; bidx++)
+  {
+    for (sidx = 0; sidx < SWAPTEST_STAGES; sidx++)
+    {
+      config.biquads.GetCoefficients( sidx, bidx,
+        den0bits, den1, den2, num0, num1, num2 );
+      is_ok = is_ok && (num1 == config.generation);
+    }
+
+    for (sidx = 0; sidx < SWAPTEST_LUTROWS; sidx++)
+    {
+      config.lut.GetOneEntry(bidx, sidx, lutin, lutout);
+      is_ok = is_ok && (lutout == config.generation);
+    }
+
+    for (cidx = 0; cidx < SWAPTEST_CHANS; cidx++)
+      is_ok = is_ok
+        && (config.thresholds.data[bidx][cidx] == config.generation);
+  }
+
+  return is_ok;
+}
+
+
+
+// This generates deterministic input.
+
+void MakeInput(long sampidx, test_inslice_t &indata)
+{
+  int cidx;
+
+  for (cidx = 0; cidx < SWAPTEST_CHANS; cidx++)
+    indata.data[0][cidx] = (int32_t) ( ((sampidx * (cidx + 3)) % 4001) - 2000 );
+}
+
+
+
+// This sets one filter bank's geometry and generation 1 coefficients.
+
+void LoadBank(test_biquadbank_t &bank, int stagecount)
+{
+  istringstream instream(BuildBiquadText(1));
+
+  bank.SetActiveBanks(SWAPTEST_BANKS);
+  bank.SetActiveChans(SWAPTEST_CHANS);
+  bank.SetActiveStages(stagecount);
+  nloop_ReadBiquadCoeffs<int32_t>(instream, bank);
+}
+
+
+
+// This swaps to a copy whose second module has different geometry, and
+// checks that the first module keeps the state it was published with
+// (here, the initial empty state) rather than the old copy's state.
+
+bool CheckPartialCarry(void)
+{
+  test_pairswap_t *swapper;
+  test_pair_t *config;
+  test_biquadbank_t *reference;
+  test_inslice_t indata;
+  test_sampslice_t refout, swapout;
+  long sampidx;
+  int mismatches;
+  bool is_ok;
+
+  swapper = new test_pairswap_t;
+  reference = new test_biquadbank_t;
+
+  config = swapper->BeginUpdate();
+  LoadBank(config->first, SWAPTEST_STAGES);
+  LoadBank(config->second, SWAPTEST_STAGES);
+  swapper->PublishUpdate();
+  config = swapper->GetActive();
+
+  // Build up filter history in the active copy.
+  for (sampidx = 0; sampidx < 200; sampidx++)
+  {
+    MakeInput(sampidx, indata);
+    config->first.ApplyBankOnce(indata, swapout);
+    config->second.ApplyBankOnce(indata, swapout);
+  }
+
+  // The new copy has never run, so its history is empty.
+  config = swapper->BeginUpdate();
+  LoadBank(config->first, SWAPTEST_STAGES);
+  LoadBank(config->second, SWAPTEST_STAGES - 1);
+  swapper->PublishUpdate();
+  config = swapper->GetActive();
+
+  LoadBank(*reference, SWAPTEST_STAGES);
+
+  mismatches = 0;
+  for (sampidx = 200; sampidx < 300; sampidx++)
+  {
+    MakeInput(sampidx, indata);
+    reference->ApplyBankOnce(indata, refout);
+    config->first.ApplyBankOnce(indata, swapout);
+
+    if ( 0 != memcmp(refout.data, swapout.data, sizeof(refout.data)) )
+      mismatches++;
+  }
+
+  is_ok = (0 == mismatches) && (!swapper->GetLastCarryOk());
+
+  delete swapper;
+  delete reference;
+
+  return is_ok;
+}
+
+
+//
+// Threaded Test
+
+
+// Shared between the two threads.
+
+struct test_shared_t
+{
+  test_swap_t *swapper;
+  atomic<bool> control_done;
+
+  // Reported by the DSP thread.
+  long blocks_run;
+  int generations_seen;
+  bool dsp_ok;
+  double max_swap_us;
+};
+
+
+
+// Control thread: push a stream of updates as fast as they're taken.
+
+void ControlThread(test_shared_t *shared)
+{
+  test_config_t *config;
+  int generation;
+
+  // The first generation was loaded before the threads started.
+  for (generation = 2; generation <= SWAPTEST_UPDATES; generation++)
+  {
+    config = shared->swapper->BeginUpdate();
+    while (NULL == config)
+    {
+      this_thread::sleep_for(chrono::microseconds(50));
+      config = shared->swapper->BeginUpdate();
+    }
+
+    LoadConfig(*config, generation);
+    shared->swapper->PublishUpdate();
+  }
+
+  shared->control_done.store(true);
+}
+
+
+
+// DSP thread: process blocks, picking up new configurations at block
+// boundaries.
+
+void DSPThread(test_shared_t *shared)
+{
+  test_config_t *config;
+  test_inslice_t indata;
+  test_sampslice_t outdata;
+  chrono::steady_clock::time_point tstart, tend;
+  unsigned long swaps_before;
+  double thistime;
+  long sampidx;
+  int sidx, lastgen;
+  bool done;
+
+  sampidx = 0;
+  lastgen = 0;
+  done = false;
+
+  while (!done)
+  {
+    // Check this before fetching, so that the final update is consumed.
+    done = shared->control_done.load()
+      && !shared->swapper->IsUpdatePending();
+
+    swaps_before = shared->swapper->GetSwapCount();
+    tstart = chrono::steady_clock::now();
+    config = shared->swapper->GetActive();
+    tend = chrono::steady_clock::now();
+
+    if (swaps_before != shared->swapper->GetSwapCount())
+    {
+      thistime = chrono::duration<double>(tend - tstart).count() * 1.0e6;
+      if (thistime > shared->max_swap_us)
+        shared->max_swap_us = thistime;
+
+      // The first swap is away from the unconfigured copy, which has no
+      // state to carry.
+      if ( (0 < swaps_before) && (!shared->swapper->GetLastCarryOk()) )
+        shared->dsp_ok = false;
+    }
+
+    // Generations must never go backwards or arrive torn.
+    if ( (config->generation < lastgen) || (!ConfigIsConsistent(*config)) )
+      shared->dsp_ok = false;
+    if (config->generation != lastgen)
+      shared->generations_seen++;
+    lastgen = config->generation;
+
+    for (sidx = 0; sidx < SWAPTEST_BLOCKLEN; sidx++)
+    {
+      MakeInput(sampidx, indata);
+      config->biquads.ApplyBankOnce(indata, outdata);
+      sampidx++;
+    }
+
+    shared->blocks_run++;
+  }
+
+  if (SWAPTEST_UPDATES != lastgen)
+    shared->dsp_ok = false;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_shared_t shared;
+  test_swap_t *swapper;
+  test_biquadbank_t *reference;
+  test_config_t *config;
+  test_inslice_t indata;
+  test_sampslice_t refout, swapout;
+  long sampidx;
+  int mismatches;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Configuration hot-swap test.\n\n";
+
+
+  // Single-threaded check: swapping to identical coefficients mid-stream
+  // should carry filter state over, giving the same output as never
+  // swapping.
+
+  swapper = new test_swap_t;
+  reference = new test_biquadbank_t;
+
+  LoadConfig(*(swapper->BeginUpdate()), 1);
+  swapper->PublishUpdate();
+  config = swapper->GetActive();
+
+  LoadConfig(*(swapper->BeginUpdate()), 1);
+
+  reference->SetActiveBanks(SWAPTEST_BANKS);
+  reference->SetActiveChans(SWAPTEST_CHANS);
+  reference->SetActiveStages(SWAPTEST_STAGES);
+  {
+    istringstream instream(BuildBiquadText(1));
+    nloop_ReadBiquadCoeffs<int32_t>(instream, *reference);
+  }
+
+  mismatches = 0;
+  for (sampidx = 0; sampidx < 1000; sampidx++)
+  {
+    if (500 == sampidx)
+    {
+      swapper->PublishUpdate();
+      config = swapper->GetActive();
+    }
+
+    MakeInput(sampidx, indata);
+    reference->ApplyBankOnce(indata, refout);
+    config->biquads.ApplyBankOnce(indata, swapout);
+
+    if ( 0 != memcmp(refout.data, swapout.data, sizeof(refout.data)) )
+      mismatches++;
+  }
+
+  is_ok = (0 == mismatches) && swapper->GetLastCarryOk()
+    && (2 == swapper->GetSwapCount());
+  cout << "State carried across swap: " << (is_ok ? "yes" : "NO")
+    << " (" << mismatches << " mismatched slices).\n";
+
+  delete swapper;
+  delete reference;
+
+
+  // A carry that fails part of the way through should be rolled back.
+
+  if (CheckPartialCarry())
+    cout << "Partial carry rolled back: yes\n";
+  else
+  {
+    cout << "Partial carry rolled back: NO\n";
+    is_ok = false;
+  }
+
+
+  // Threaded check: a control thread streams updates while the DSP thread
+  // runs blocks. No block may see a torn or stale configuration.
+
+  swapper = new test_swap_t;
+
+  LoadConfig(*(swapper->BeginUpdate()), 1);
+  swapper->PublishUpdate();
+
+  shared.swapper = swapper;
+  shared.control_done.store(false);
+  shared.blocks_run = 0;
+  shared.generations_seen = 0;
+  shared.dsp_ok = true;
+  shared.max_swap_us = 0;
+
+  {
+    thread dspthread(DSPThread, &shared);
+    thread controlthread(ControlThread, &shared);
+    controlthread.join();
+    dspthread.join();
+  }
+
+  cout << "Threaded: " << shared.blocks_run << " blocks, "
+    << swapper->GetSwapCount() << " swaps, "
+    << shared.generations_seen << " generations seen; slowest swap "
+    << shared.max_swap_us << " us.\n";
+
+  is_ok = is_ok && shared.dsp_ok
+    && (SWAPTEST_UPDATES == swapper->GetSwapCount());
+
+  delete swapper;
+
+
+  cout << "Hot-swap test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of hot-swap test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,1005 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - CSV parser and typed loader comparison and benchmark.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <sstream>
+#include <chrono>
+
+
+//
+// Constants
+
+// Default number of data rows in the generated table.
+#define CSVBENCH_DEFAULT_ROWS 20000
+
+// Number of times to parse the table with each parser.
+#define CSVBENCH_PASSES 3
+
+// Lookup table geometry for the writer comparison.
+#define CSVBENCH_LUTBANKS 32
+#define CSVBENCH_LUTROWS 4096
+
+
+//
+// Reference Implementation
+
+// This is the original regex-based nloop_ReadCSV(), kept here so that the
+// single-pass parser can be checked against it and timed relative to it.
+
+map<string,vector<string>> ReadCSVRegex(istream &infile)
+{
+  map<string,vector<string>> result;
+  list<string> colnames, cellvals;
+  list<string>::iterator cidx, vidx;
+  string thisline;
+  bool first_line;
+  regex regexnotnewline, regexnotblank;
+  regex regexquoted, regexnoquotes;
+  regex regexquotedend, regexnoquotesend;
+  smatch thismatchlist;
+  bool had_match, have_string;
+  string matchval;
+
+  regexnotnewline = "(.*)";
+  regexnotblank = "\\S";
+  regexquoted = "\\s*\"(.*?)\"\\s*,(.*)";
+  regexnoquotes = "\\s*([^\",\\s]*)\\s*,(.*)";
+  regexquotedend = "\\s*\"(.*?)\"\\s*";
+  regexnoquotesend = "\\s*([^\",\\s]*)\\s*";
+
+  first_line = true;
+  colnames.clear();
+  result.clear();
+
+  while (infile.good())
+  {
+    getline(infile, thisline);
+
+    if (infile.good())
+    {
+      if (regex_search(thisline, thismatchlist, regexnotnewline))
+        thisline = thismatchlist[1];
+
+      if (regex_search(thisline, regexnotblank))
+      {
+        cellvals.clear();
+
+        had_match = true;
+        have_string = true;
+
+        while (had_match && have_string)
+        {
+          matchval = "";
+
+          if (regex_match(thisline, thismatchlist, regexquoted))
+          {
+            matchval = thismatchlist[1];
+            thisline = thismatchlist[2];
+          }
+          else if (regex_match(thisline, thismatchlist, regexnoquotes))
+          {
+            matchval = thismatchlist[1];
+            thisline = thismatchlist[2];
+          }
+          else if (regex_match(thisline, thismatchlist, regexquotedend))
+          {
+            matchval = thismatchlist[1];
+            thisline = "";
+            have_string = false;
+          }
+          else if (regex_match(thisline, thismatchlist, regexnoquotesend))
+          {
+            matchval = thismatchlist[1];
+            thisline = "";
+            have_string = false;
+          }
+          else
+            had_match = false;
+
+          if (had_match)
+            cellvals.push_back(matchval);
+        }
+
+        if (first_line)
+        {
+          colnames.clear();
+          for (cidx = cellvals.begin(); cidx != cellvals.end(); cidx++)
+            colnames.push_back(*cidx);
+
+          first_line = false;
+        }
+        else
+        {
+          vidx = cellvals.begin();
+          for (cidx = colnames.begin(); cidx != colnames.end(); cidx++)
+          {
+            if (vidx != cellvals.end())
+            {
+              result[*cidx].push_back(*vidx);
+              vidx++;
+            }
+            else
+              result[*cidx].push_back("");
+          }
+        }
+      }
+    }
+  }
+
+  return result;
+}
+
+
+
+// This is the original table-building nloop_WriteLookupTablePerBank(),
+// kept here so that the streaming writer can be checked against it and
+// timed relative to it. It also uses the original row-by-row lookup in
+// nloop_WriteCSV().
+
+template<class intype_t, class outtype_t, class luttype_t>
+void WriteLUTPerBankTable( ostream &outfile, luttype_t &lut,
+  string infield, string outfield, bool want_header,
+  list<string> &extra_col_order, map<string,string> &extra_col_values)
+{
+  int bankcount, rowcount;
+  int bidx, ridx;
+  list<string> colnames;
+  map<string,vector<string>> colseries;
+  map<string,string> thisrow;
+  list<string>::iterator nidx, cidx;
+  size_t row_count, tidx;
+  bool is_first;
+  intype_t inval;
+  outtype_t outval;
+
+  bankcount = lut.GetActiveBanks();
+  rowcount = lut.GetActiveRows();
+
+  for (nidx = extra_col_order.begin(); nidx != extra_col_order.end(); nidx++)
+    colnames.push_back(*nidx);
+
+  colnames.push_back("bank");
+  colnames.push_back("row");
+  colnames.push_back(infield);
+  colnames.push_back(outfield);
+
+  inval = 0;
+  outval = 0;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (ridx = 0; ridx < rowcount; ridx++)
+    {
+      lut.GetOneEntry(bidx, ridx, inval, outval);
+
+      colseries["bank"].push_back(to_string(bidx));
+      colseries["row"].push_back(to_string(ridx));
+      colseries[infield].push_back(to_string(
+        nloop_SampleToLL<intype_t>(inval) ));
+      colseries[outfield].push_back(to_string(
+        nloop_SampleToLL<outtype_t>(outval) ));
+
+      for (nidx = extra_col_order.begin();
+        nidx != extra_col_order.end();
+        nidx++)
+        colseries[*nidx].push_back(extra_col_values[*nidx]);
+    }
+
+  if (want_header)
+  {
+    is_first = true;
+    for (cidx = colnames.begin(); colnames.end() != cidx; cidx++)
+    {
+      if (!is_first)
+        outfile << ',';
+      is_first = false;
+      outfile << '"' << (*cidx) << '"';
+    }
+    outfile << "\r\n";
+  }
+
+  row_count = nloop_GetCSVRowCount(colseries);
+  for (tidx = 0; tidx < row_count; tidx++)
+  {
+    thisrow = nloop_GetCSVRowCells(colseries, tidx);
+
+    is_first = true;
+    for (cidx = colnames.begin(); colnames.end() != cidx; cidx++)
+    {
+      if (!is_first)
+        outfile << ',';
+      is_first = false;
+      if (thisrow.count(*cidx))
+        outfile << thisrow[*cidx];
+    }
+    outfile << "\r\n";
+  }
+}
+
+
+//
+// Helper Functions
+
+
+// This builds a biquad-style coefficient table with several filter sets.
+// Rows use CRLF line endings and a mix of quoted and unquoted cells.
+
+string BuildTestTable(int rowcount)
+{
+  ostringstream result;
+  int ridx;
+
+  result << "\"type\",\"set\",\"bank\",\"stage\","
+    << "\"num0\",\"num1\",\"num2\",\"den0\",\"den1\",\"den2\"\r\n";
+
+  // Blank lines should be skipped.
+  result << "\r\n  \r\n";
+
+  for (ridx = 0; ridx < rowcount; ridx++)
+  {
+    result << '"' << ( (ridx & 1) ? "bank" : "anti-alias" ) << "\", "
+      << (ridx % 37) << " , "
+      << "\"" << (ridx % 16) << "\"," << (ridx % 4) << ","
+      << (ridx * 7919) << "," << -(ridx * 104729) << ","
+      << (ridx * 31) << "," << (1 << 30) << ","
+      << -(ridx % 1000);
+
+    // Short rows should be padded with empty cells, and extra cells in
+    // long rows should be ignored.
+    if (0 != (ridx % 97))
+      result << "," << (ridx % 999);
+    if (0 == (ridx % 5))
+      result << ",\"extra\"";
+
+    result << "\r\n";
+  }
+
+  return result.str();
+}
+
+
+// This compares two tables and reports the first difference.
+
+bool TablesMatch(map<string,vector<string>> &first,
+  map<string,vector<string>> &second)
+{
+  map<string,vector<string>>::iterator cidx;
+  size_t ridx;
+
+  if (first.size() != second.size())
+  {
+    cout << "!! Column counts differ (" << first.size() << " vs "
+      << second.size() << ").\n";
+    return false;
+  }
+
+  for (cidx = first.begin(); first.end() != cidx; cidx++)
+  {
+    if (!second.count(cidx->first))
+    {
+      cout << "!! Column \"" << cidx->first << "\" is missing.\n";
+      return false;
+    }
+
+    if (cidx->second.size() != second[cidx->first].size())
+    {
+      cout << "!! Column \"" << cidx->first << "\" lengths differ.\n";
+      return false;
+    }
+
+    for (ridx = 0; ridx < cidx->second.size(); ridx++)
+      if (cidx->second[ridx] != second[cidx->first][ridx])
+      {
+        cout << "!! Column \"" << cidx->first << "\" row " << ridx
+          << ": \"" << cidx->second[ridx] << "\" vs \""
+          << second[cidx->first][ridx] << "\".\n";
+        return false;
+      }
+  }
+
+  return true;
+}
+
+
+// This times several passes of a parser over the specified table text.
+// The result from the last pass is returned.
+
+double TimeParser( map<string,vector<string>> (*parser)(istream &),
+  string &tabletext, map<string,vector<string>> &result )
+{
+  chrono::steady_clock::time_point tstart, tend;
+  int pidx;
+
+  tstart = chrono::steady_clock::now();
+
+  for (pidx = 0; pidx < CSVBENCH_PASSES; pidx++)
+  {
+    istringstream instream(tabletext);
+    result = (*parser)(instream);
+  }
+
+  tend = chrono::steady_clock::now();
+
+  return chrono::duration<double>(tend - tstart).count() / CSVBENCH_PASSES;
+}
+
+
+// This checks quote handling that the regex parser didn't support.
+
+bool CheckQuoteHandling(void)
+{
+  istringstream instream(
+    "\"a\",\"b\",c\n"
+    " \"x, y\" , \"say \"\"hi\"\"\" ,  two words  \n"
+    "\"multi\nline\",,\"\"\n"
+    "last,row,no newline" );
+  map<string,vector<string>> result;
+  bool is_ok;
+
+  result = nloop_ReadCSV(instream);
+
+  is_ok = (3 == result.size()) && (3 == result["a"].size());
+
+  if (is_ok)
+    is_ok = ("x, y" == result["a"][0])
+      && ("say \"hi\"" == result["b"][0])
+      && ("two words" == result["c"][0])
+      && ("multi\nline" == result["a"][1])
+      && ("" == result["b"][1])
+      && ("" == result["c"][1])
+      && ("no newline" == result["c"][2]);
+
+  return is_ok;
+}
+
+
+// This checks that malformed integer cells are rejected, both by the cell
+// parser and by the coefficient and lookup table readers.
+
+bool CheckMalformedCells(void)
+{
+  nloop_LookupMonoStepPerBank_t<int16_t, int8_t, 4, 2, 1> lutbank;
+  nloop_FIRFilterBank_t<int32_t, int, 8, 8, 2, 1> firbank;
+  nloop_IIRFilterBank_t<int32_t, int, 2, 2, 1> iirbank;
+  long long value;
+  int16_t inval;
+  int8_t outval;
+  bool is_ok;
+
+  is_ok = nloop_CSVCellToLL(" -42 ", value) && (-42 == value)
+    && nloop_CSVCellToLL("+7", value) && (7 == value)
+    && nloop_CSVCellToLL("-9223372036854775808", value)
+    && (NLOOP_MINVAL(long long) == value)
+    && nloop_CSVCellToLL("9223372036854775807", value)
+    && (NLOOP_MAXVAL(long long) == value);
+
+  is_ok = is_ok
+    && (!nloop_CSVCellToLL("", value))
+    && (!nloop_CSVCellToLL("  ", value))
+    && (!nloop_CSVCellToLL("-", value))
+    && (!nloop_CSVCellToLL("abc", value))
+    && (!nloop_CSVCellToLL("12abc", value))
+    && (!nloop_CSVCellToLL("1.5", value))
+    && (!nloop_CSVCellToLL("9223372036854775808", value))
+    && (!nloop_CSVCellToLL("-9223372036854775809", value))
+    && (!nloop_CSVCellToLL("99999999999999999999", value))
+    && (0 == value);
+
+  // The bad row is skipped; the good ones are still loaded.
+  {
+    istringstream instream(
+      "row,bank,threshold,label\n"
+      "0,0,10,1\n"
+      "1,0,x20,2\n"
+      "1,1,30,3\n" );
+    lutbank.BlankTables();
+    lutbank.SetActiveRows(2);
+    is_ok = is_ok && (!nloop_ReadLookupTablePerBank<int16_t, int8_t>(
+      instream, lutbank, "threshold", "label" ));
+  }
+
+  lutbank.GetOneEntry(0, 0, inval, outval);
+  is_ok = is_ok && (10 == inval) && (1 == outval);
+  lutbank.GetOneEntry(0, 1, inval, outval);
+  is_ok = is_ok && (0 == inval) && (0 == outval);
+  lutbank.GetOneEntry(1, 1, inval, outval);
+  is_ok = is_ok && (30 == inval) && (3 == outval);
+
+  {
+    istringstream instream(
+      "bank 0\n"
+      "1\n"
+      "99999999999999999999\n" );
+    is_ok = is_ok && (!nloop_ReadFIRCoeffs<int32_t, int>(
+      instream, firbank, 12 ));
+  }
+
+  {
+    // A coefficient after the end of a bank's column is rejected.
+    istringstream instream(
+      "bank 0,bank 1\n"
+      "1,1\n"
+      ",2\n"
+      "3,3\n" );
+    is_ok = is_ok && (!nloop_ReadFIRCoeffs<int32_t, int>(
+      instream, firbank, 12 ));
+  }
+
+  {
+    istringstream instream(
+      "bank,stage,num0,num1,num2,den0,den1,den2\n"
+      "0,0,1,2,1,16384,-3,2\n" );
+    is_ok = is_ok && nloop_ReadBiquadCoeffs<int32_t>(instream, iirbank);
+  }
+
+  return is_ok;
+}
+
+
+// This loads one filter set from the test table using the typed reader,
+// and checks it against values pulled from the full parsed table.
+// The typed load time is returned via "loadtime".
+
+bool CheckBiquadLoading(string &tabletext, double &loadtime)
+{
+  nloop_IIRFilterBank_t<int32_t, int, 4, 16, 2> filtbank;
+  map<string,vector<string>> table;
+  map<string,string> thisrow;
+  multimap<string,string> criteria;
+  map<int,int> bankremap;
+  long long expected[16][4][6];
+  bool seen[16][4];
+  chrono::steady_clock::time_point tstart, tend;
+  size_t ridx;
+  int bidx, sidx, vidx;
+  uint8_t den0bits;
+  int32_t den1, den2, num0, num1, num2;
+  bool is_ok;
+
+  criteria.insert(pair<string,string>("type", "bank"));
+  criteria.insert(pair<string,string>("set", "3"));
+  bankremap.clear();
+
+
+  // Build the expected coefficients the slow way.
+  // Later rows overwrite earlier ones, as with the reader.
+
+  for (bidx = 0; bidx < 16; bidx++)
+    for (sidx = 0; sidx < 4; sidx++)
+      seen[bidx][sidx] = false;
+
+  {
+    istringstream instream(tabletext);
+    table = nloop_ReadCSV(instream);
+  }
+
+  for (ridx = 0; ridx < nloop_GetCSVRowCount(table); ridx++)
+  {
+    thisrow = nloop_GetCSVRowCells(table, ridx);
+    if (nloop_CSVRowMatchesAllCriteria(thisrow, criteria))
+    {
+      bidx = stoi(thisrow["bank"]);
+      sidx = stoi(thisrow["stage"]);
+      seen[bidx][sidx] = true;
+
+      expected[bidx][sidx][0] = stoll(thisrow["num0"]);
+      expected[bidx][sidx][1] = stoll(thisrow["num1"]);
+      expected[bidx][sidx][2] = stoll(thisrow["num2"]);
+      expected[bidx][sidx][3] = stoll(thisrow["den0"]);
+      expected[bidx][sidx][4] = stoll(thisrow["den1"]);
+      expected[bidx][sidx][5] =
+        ( thisrow["den2"].empty() ? 0 : stoll(thisrow["den2"]) );
+    }
+  }
+
+
+  // Load using the typed reader, and time it.
+
+  tstart = chrono::steady_clock::now();
+  for (vidx = 0; vidx < CSVBENCH_PASSES; vidx++)
+  {
+    istringstream instream(tabletext);
+    filtbank.BlankCoefficients();
+    nloop_ReadBiquadCoeffs<int32_t>(instream, filtbank, criteria, bankremap);
+  }
+  tend = chrono::steady_clock::now();
+  loadtime =
+    chrono::duration<double>(tend - tstart).count() / CSVBENCH_PASSES;
+
+
+  // Compare.
+
+  is_ok = true;
+
+  for (bidx = 0; is_ok && (bidx < 16); bidx++)
+    for (sidx = 0; is_ok && (sidx < 4); sidx++)
+      if (seen[bidx][sidx])
+      {
+        filtbank.GetCoefficients( sidx, bidx,
+          den0bits, den1, den2, num0, num1, num2 );
+
+        is_ok = (expected[bidx][sidx][0] == num0)
+          && (expected[bidx][sidx][1] == num1)
+          && (expected[bidx][sidx][2] == num2)
+          && (expected[bidx][sidx][3] == (1LL << den0bits))
+          && (expected[bidx][sidx][4] == den1)
+          && (expected[bidx][sidx][5] == den2);
+
+        if (!is_ok)
+          cout << "!! Bank " << bidx << " stage " << sidx
+            << " coefficients differ.\n";
+      }
+
+  return is_ok;
+}
+
+
+
+// This checks FIR and lookup table loading with criteria and remapping.
+
+bool CheckFIRAndLUTLoading(void)
+{
+  nloop_FIRFilterBank_t<int32_t, int, 8, 8, 2, 1> firbank;
+  nloop_LookupMonoStepPerBank_t<int16_t, int8_t, 4, 2, 1> lutbank;
+  multimap<string,string> criteria;
+  map<int,int> bankremap;
+  uint8_t fracbits;
+  int coeffcount;
+  int16_t inval;
+  int8_t outval;
+  bool is_ok;
+
+  criteria.insert(pair<string,string>("set", "b"));
+  bankremap[3] = 1;
+
+  {
+    istringstream instream(
+      "set,bank 0,\"bank 3\",note\n"
+      "a,100,200,x\n"
+      "b,1,2,x\n"
+      "b,-3,4\n"
+      "a,300,400,x\n"
+      "b,5,\n" );
+    nloop_ReadFIRCoeffs<int32_t, int>( instream, firbank, 12,
+      criteria, bankremap );
+  }
+
+  firbank.GetOneGeometry(0, fracbits, coeffcount);
+  is_ok = (12 == fracbits) && (3 == coeffcount)
+    && (1 == firbank.GetOneCoefficient(0, 0))
+    && (-3 == firbank.GetOneCoefficient(0, 1))
+    && (5 == firbank.GetOneCoefficient(0, 2))
+    && (2 == firbank.GetOneCoefficient(1, 0))
+    && (4 == firbank.GetOneCoefficient(1, 1))
+    && (0 == firbank.GetOneCoefficient(1, 2));
+
+  // The blank cell ends bank 3's column.
+  firbank.GetOneGeometry(1, fracbits, coeffcount);
+  is_ok = is_ok && (2 == coeffcount);
+
+
+  // Banks of different lengths should survive a write/read round trip.
+  // The shorter bank is written padded with blank cells.
+
+  firbank.SetActiveBanks(2);
+  firbank.SetActiveChans(1);
+  firbank.SetOneGeometry(0, 8, 4);
+  firbank.SetOneGeometry(1, 8, 2);
+  for (coeffcount = 0; coeffcount < 4; coeffcount++)
+  {
+    firbank.SetOneCoefficient(0, coeffcount, 1 + coeffcount);
+    firbank.SetOneCoefficient(1, coeffcount, 10 + coeffcount);
+  }
+
+  {
+    ostringstream outstream;
+    nloop_WriteFIRCoeffs<int32_t, int>(outstream, firbank, true);
+
+    is_ok = is_ok && ( "\"bank 0\",\"bank 1\"\r\n"
+      "1,10\r\n2,11\r\n3,\r\n4,\r\n" == outstream.str() );
+
+    istringstream instream(outstream.str());
+    firbank.BlankOneFilter(0);
+    firbank.BlankOneFilter(1);
+    is_ok = is_ok && nloop_ReadFIRCoeffs<int32_t, int>(
+      instream, firbank, 8 );
+  }
+
+  firbank.GetOneGeometry(0, fracbits, coeffcount);
+  is_ok = is_ok && (8 == fracbits) && (4 == coeffcount)
+    && (1 == firbank.GetOneCoefficient(0, 0))
+    && (4 == firbank.GetOneCoefficient(0, 3));
+  firbank.GetOneGeometry(1, fracbits, coeffcount);
+  is_ok = is_ok && (8 == fracbits) && (2 == coeffcount)
+    && (10 == firbank.GetOneCoefficient(1, 0))
+    && (11 == firbank.GetOneCoefficient(1, 1));
+
+  {
+    istringstream instream(
+      "row,bank,set,threshold,label\n"
+      "0,0,b,10,-1\n"
+      "1,3,b,20,7\n"
+      "1,3,a,99,99\n" );
+    lutbank.SetActiveRows(2);
+    nloop_ReadLookupTablePerBank<int16_t, int8_t>( instream, lutbank,
+      "threshold", "label", criteria, bankremap );
+  }
+
+  lutbank.GetOneEntry(0, 0, inval, outval);
+  is_ok = is_ok && (10 == inval) && (-1 == outval);
+  lutbank.GetOneEntry(1, 1, inval, outval);
+  is_ok = is_ok && (20 == inval) && (7 == outval);
+
+  return is_ok;
+}
+
+
+
+// This writes a large lookup table bank with the table-building writer and
+// with the streaming writer, checks that the output is identical, and
+// checks that FIR and biquad coefficients survive a write/read round trip.
+// Write times are returned.
+
+bool CheckStreamingWriters(double &tabletime, double &streamtime)
+{
+  nloop_LookupMonoStepPerBank_t<int32_t, int16_t,
+    CSVBENCH_LUTROWS, CSVBENCH_LUTBANKS, 1> *lutbank;
+  nloop_FIRFilterBank_t<int32_t, int, 64, 64, 4, 1> firbank, firback;
+  nloop_IIRFilterBank_t<int16_t, int, 3, 4, 1> biquadbank, biquadback;
+  list<string> extra_order;
+  map<string,string> extra_values;
+  multimap<string,string> criteria;
+  map<int,int> bankremap;
+  ostringstream tablestream, streamstream, firstream, biquadstream;
+  chrono::steady_clock::time_point tstart, tend;
+  uint8_t bits1, bits2;
+  int16_t coeffs1[5], coeffs2[5];
+  int count1, count2;
+  int bidx, ridx;
+  bool is_ok;
+
+  // This is too large for the stack.
+  lutbank = new nloop_LookupMonoStepPerBank_t<int32_t, int16_t,
+    CSVBENCH_LUTROWS, CSVBENCH_LUTBANKS, 1>;
+
+  lutbank->SetActiveBanks(CSVBENCH_LUTBANKS);
+  lutbank->SetActiveChans(1);
+  lutbank->SetActiveRows(CSVBENCH_LUTROWS);
+  for (bidx = 0; bidx < CSVBENCH_LUTBANKS; bidx++)
+    for (ridx = 0; ridx < CSVBENCH_LUTROWS; ridx++)
+      lutbank->SetOneEntry( bidx, ridx, (ridx - 2000) * 1000003 + bidx,
+        (int16_t) (ridx * 7 - bidx) );
+
+  extra_order.push_back("session");
+  extra_values["session"] = "cal-17";
+
+
+  // Lookup table output should be byte-for-byte identical.
+
+  tstart = chrono::steady_clock::now();
+  WriteLUTPerBankTable<int32_t, int16_t>( tablestream, *lutbank,
+    "threshold", "label", true, extra_order, extra_values );
+  tend = chrono::steady_clock::now();
+  tabletime = chrono::duration<double>(tend - tstart).count();
+
+  tstart = chrono::steady_clock::now();
+  nloop_WriteLookupTablePerBank<int32_t, int16_t>( streamstream, *lutbank,
+    "threshold", "label", true, extra_order, extra_values );
+  tend = chrono::steady_clock::now();
+  streamtime = chrono::duration<double>(tend - tstart).count();
+
+  is_ok = (tablestream.str() == streamstream.str());
+
+  delete lutbank;
+
+
+  // FIR banks have ragged columns; they should read back unchanged.
+
+  firbank.SetActiveBanks(4);
+  firbank.SetActiveChans(1);
+  firback.SetActiveBanks(4);
+  firback.SetActiveChans(1);
+  for (bidx = 0; bidx < 4; bidx++)
+  {
+    firbank.SetOneGeometry(bidx, 10, 8 + 16 * bidx);
+    for (ridx = 0; ridx < 8 + 16 * bidx; ridx++)
+      firbank.SetOneCoefficient(bidx, ridx, (ridx - 20) * (bidx + 1) * 37);
+  }
+
+  nloop_WriteFIRCoeffs<int32_t, int>( firstream, firbank, true,
+    extra_order, extra_values );
+  {
+    istringstream instream(firstream.str());
+    criteria.insert(pair<string,string>("session", "cal-17"));
+    is_ok = is_ok && nloop_ReadFIRCoeffs<int32_t, int>( instream, firback,
+      10, criteria, bankremap );
+  }
+
+  // Each bank should get its own coefficient count back.
+  for (bidx = 0; bidx < 4; bidx++)
+  {
+    firbank.GetOneGeometry(bidx, bits1, count1);
+    firback.GetOneGeometry(bidx, bits2, count2);
+    is_ok = is_ok && (bits1 == bits2) && (count1 == count2);
+    for (ridx = 0; is_ok && (ridx < count2); ridx++)
+      is_ok = ( firback.GetOneCoefficient(bidx, ridx)
+        == firbank.GetOneCoefficient(bidx, ridx) );
+  }
+
+
+  // Biquads, including negative coefficients.
+
+  biquadbank.SetActiveBanks(4);
+  biquadbank.SetActiveChans(1);
+  biquadbank.SetActiveStages(3);
+  biquadback.SetActiveBanks(4);
+  biquadback.SetActiveChans(1);
+  biquadback.SetActiveStages(3);
+  for (bidx = 0; bidx < 4; bidx++)
+    for (ridx = 0; ridx < 3; ridx++)
+      biquadbank.SetCoefficients( ridx, bidx, 12 + ridx,
+        -7000 + bidx, 3000 - ridx, 100 * bidx, -200, 300 + ridx );
+
+  nloop_WriteBiquadCoeffs<int16_t>( biquadstream, biquadbank, true,
+    extra_order, extra_values );
+  {
+    istringstream instream(biquadstream.str());
+    nloop_ReadBiquadCoeffs<int16_t>( instream, biquadback,
+      criteria, bankremap );
+  }
+
+  for (bidx = 0; bidx < 4; bidx++)
+    for (ridx = 0; ridx < 3; ridx++)
+    {
+      biquadbank.GetCoefficients( ridx, bidx, bits1,
+        coeffs1[0], coeffs1[1], coeffs1[2], coeffs1[3], coeffs1[4] );
+      biquadback.GetCoefficients( ridx, bidx, bits2,
+        coeffs2[0], coeffs2[1], coeffs2[2], coeffs2[3], coeffs2[4] );
+      is_ok = is_ok && (bits1 == bits2);
+      for (count1 = 0; count1 < 5; count1++)
+        is_ok = is_ok && (coeffs1[count1] == coeffs2[count1]);
+    }
+
+  return is_ok;
+}
+
+
+
+// This loads every "bank" filter set in the test table, once by streaming
+// the file for each set and once from a single indexed table, and checks
+// that the results agree. Load times are returned.
+
+bool CheckIndexedLoading(string &tabletext,
+  double &streamtime, double &tabletime, size_t &setcount)
+{
+  typedef nloop_IIRFilterBank_t<int32_t, int, 4, 16, 1> testbank_t;
+  vector<testbank_t> streambanks, tablebanks;
+  nloop_CSVTable_t table;
+  vector<string> setnames;
+  multimap<string,string> criteria;
+  map<int,int> bankremap;
+  chrono::steady_clock::time_point tstart, tend;
+  size_t sidx;
+  int bidx, stidx;
+  uint8_t bits1, bits2;
+  int32_t coeffs1[5], coeffs2[5];
+  bool is_ok;
+
+  bankremap.clear();
+
+
+  // Get the list of sets from the indexed table.
+  // Time the table parse along with the loads.
+
+  tstart = chrono::steady_clock::now();
+
+  {
+    istringstream instream(tabletext);
+    table.ReadTable(instream);
+  }
+  table.GetColumnValues("set", setnames);
+  setcount = setnames.size();
+  tablebanks.resize(setcount);
+
+  for (sidx = 0; sidx < setcount; sidx++)
+  {
+    criteria.clear();
+    criteria.insert(pair<string,string>("type", "bank"));
+    criteria.insert(pair<string,string>("set", setnames[sidx]));
+
+    tablebanks[sidx].BlankCoefficients();
+    nloop_ReadBiquadCoeffs<int32_t>( table, tablebanks[sidx],
+      criteria, bankremap );
+  }
+
+  tend = chrono::steady_clock::now();
+  tabletime = chrono::duration<double>(tend - tstart).count();
+
+
+  // Load the same sets by streaming the file once per set.
+
+  streambanks.resize(setcount);
+
+  tstart = chrono::steady_clock::now();
+
+  for (sidx = 0; sidx < setcount; sidx++)
+  {
+    istringstream instream(tabletext);
+
+    criteria.clear();
+    criteria.insert(pair<string,string>("type", "bank"));
+    criteria.insert(pair<string,string>("set", setnames[sidx]));
+
+    streambanks[sidx].BlankCoefficients();
+    nloop_ReadBiquadCoeffs<int32_t>( instream, streambanks[sidx],
+      criteria, bankremap );
+  }
+
+  tend = chrono::steady_clock::now();
+  streamtime = chrono::duration<double>(tend - tstart).count();
+
+
+  // Compare.
+
+  is_ok = (setcount > 1);
+
+  for (sidx = 0; is_ok && (sidx < setcount); sidx++)
+    for (bidx = 0; is_ok && (bidx < 16); bidx++)
+      for (stidx = 0; is_ok && (stidx < 4); stidx++)
+      {
+        streambanks[sidx].GetCoefficients( stidx, bidx, bits1,
+          coeffs1[0], coeffs1[1], coeffs1[2], coeffs1[3], coeffs1[4] );
+        tablebanks[sidx].GetCoefficients( stidx, bidx, bits2,
+          coeffs2[0], coeffs2[1], coeffs2[2], coeffs2[3], coeffs2[4] );
+
+        is_ok = (bits1 == bits2)
+          && (coeffs1[0] == coeffs2[0]) && (coeffs1[1] == coeffs2[1])
+          && (coeffs1[2] == coeffs2[2]) && (coeffs1[3] == coeffs2[3])
+          && (coeffs1[4] == coeffs2[4]);
+
+        if (!is_ok)
+          cout << "!! Set \"" << setnames[sidx] << "\" bank " << bidx
+            << " stage " << stidx << " differs.\n";
+      }
+
+  return is_ok;
+}
+
+
+
+//
+// Main Program
+
+
+int main(int argc, char **argv)
+{
+  string tabletext;
+  map<string,vector<string>> regexresult, fastresult;
+  double regextime, fasttime, loadtime;
+  double streamtime, tabletime;
+  double tablewritetime, streamwritetime;
+  size_t setcount;
+  int rowcount;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== CSV parser comparison.\n\n";
+
+
+  // Get the test table. Either read a user-specified file or make one.
+  rowcount = CSVBENCH_DEFAULT_ROWS;
+  if (argc > 1)
+  {
+    ifstream infile(argv[1]);
+    ostringstream filetext;
+    filetext << infile.rdbuf();
+    tabletext = filetext.str();
+    cout << "Reading \"" << argv[1] << "\" (" << tabletext.size()
+      << " bytes).\n";
+  }
+  else
+  {
+    tabletext = BuildTestTable(rowcount);
+    cout << "Generated " << rowcount << " rows (" << tabletext.size()
+      << " bytes).\n";
+  }
+
+
+  // Time both parsers and make sure they agree.
+
+  regextime = TimeParser(&ReadCSVRegex, tabletext, regexresult);
+  fasttime = TimeParser(&nloop_ReadCSV, tabletext, fastresult);
+
+  cout << "Regex parser:        " << (regextime * 1000.0) << " ms\n";
+  cout << "Single-pass parser:  " << (fasttime * 1000.0) << " ms\n";
+  if (fasttime > 0)
+    cout << "Speedup:             " << (regextime / fasttime) << "x\n";
+
+  is_ok = TablesMatch(regexresult, fastresult);
+  cout << "Tables match:        " << (is_ok ? "yes" : "NO") << "\n";
+
+  // Check the cases that only the new parser handles.
+  if (!CheckQuoteHandling())
+  {
+    cout << "!! Quote handling check failed.\n";
+    is_ok = false;
+  }
+  else
+    cout << "Quote handling:      ok\n";
+
+  if (!CheckMalformedCells())
+  {
+    cout << "!! Malformed cell check failed.\n";
+    is_ok = false;
+  }
+  else
+    cout << "Malformed cells:     ok\n";
+
+  // Check typed coefficient loading. This only makes sense for the
+  // generated table.
+  if (argc <= 1)
+  {
+    if (!CheckBiquadLoading(tabletext, loadtime))
+    {
+      cout << "!! Typed biquad loading check failed.\n";
+      is_ok = false;
+    }
+    else
+      cout << "Typed biquad load:   " << (loadtime * 1000.0) << " ms\n";
+
+    if (!CheckFIRAndLUTLoading())
+    {
+      cout << "!! Typed FIR/LUT loading check failed.\n";
+      is_ok = false;
+    }
+    else
+      cout << "Typed FIR/LUT load:  ok\n";
+
+    if (!CheckIndexedLoading(tabletext, streamtime, tabletime, setcount))
+    {
+      cout << "!! Indexed table loading check failed.\n";
+      is_ok = false;
+    }
+    else
+    {
+      cout << "Streamed " << setcount << " sets:   "
+        << (streamtime * 1000.0) << " ms\n";
+      cout << "Indexed " << setcount << " sets:    "
+        << (tabletime * 1000.0) << " ms\n";
+    }
+  }
+
+
+  // Check the streaming writers against the table-building one.
+  if (!CheckStreamingWriters(tablewritetime, streamwritetime))
+  {
+    cout << "!! Streaming writer check failed.\n";
+    is_ok = false;
+  }
+  else
+  {
+    cout << "Table-built LUT write: " << (tablewritetime * 1000.0)
+      << " ms\n";
+    cout << "Streamed LUT write:    " << (streamwritetime * 1000.0)
+      << " ms\n";
+  }
+
+
+  // Ending banner.
+  cout << "\n== End of CSV parser comparison.\n\n";
+
+
+  // Report success or failure.
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
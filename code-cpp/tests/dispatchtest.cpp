@@ -0,0 +1,432 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Run-time CPU feature dispatch.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <math.h>
+
+
+//
+// Constants
+
+// Geometry. Channel counts aren't multiples of any vector width, so that
+// loop tails are exercised.
+#define DISPTEST_CHANS 37
+#define DISPTEST_BANKS 5
+#define DISPTEST_STAGES 2
+#define DISPTEST_TAPS 29
+#define DISPTEST_ROWS 23
+
+#define DISPTEST_SAMPLES 500
+
+// Averager parameters.
+#define DISPTEST_COEFFBITS 8
+
+// Input amplitude. This fits every sample type.
+#define DISPTEST_AMPLITUDE 8000
+
+#define DISPTEST_SEED 4321
+
+
+//
+// Helper Functions
+
+
+// This returns a pseudorandom value in the range +/- "amplitude".
+
+long long GetRandom(long long amplitude)
+{
+  return ( ((long long) rand()) % (2 * amplitude + 1) ) - amplitude;
+}
+
+
+
+// This returns a test input sample.
+
+long long GetInput(int sidx, int cidx)
+{
+  return (long long) ( DISPTEST_AMPLITUDE
+    * sin( 6.2832 * sidx / (20.0 + 3 * cidx) ) ) + GetRandom(200);
+}
+
+
+
+// This checks the biquad kernel against nloop_IIRFilterBank_t.
+// It returns the number of mismatched output samples.
+
+template <class samptype_t, class accumtype_t>
+long TestBiquad(nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels)
+{
+  nloop_IIRFilterBank_t<samptype_t, int, DISPTEST_STAGES, 1,
+    DISPTEST_CHANS, accumtype_t> filtbank;
+  nloop_SampleSlice_t<samptype_t, 1, DISPTEST_CHANS> indata;
+  nloop_SampleSlice_t<samptype_t, 1, DISPTEST_CHANS> outdata;
+  samptype_t history[DISPTEST_STAGES][4 * DISPTEST_CHANS];
+  samptype_t stagedata[DISPTEST_STAGES + 1][DISPTEST_CHANS];
+  samptype_t coeffs[DISPTEST_STAGES][5];
+  uint8_t den0bits;
+  int sidx, stidx, cidx;
+  long result;
+
+  // Band-pass-ish stages with 10 fractional bits.
+  den0bits = 10;
+
+  filtbank.SetActiveBanks(1);
+  filtbank.SetActiveChans(DISPTEST_CHANS);
+  filtbank.SetActiveStages(DISPTEST_STAGES);
+
+  for (stidx = 0; stidx < DISPTEST_STAGES; stidx++)
+  {
+    coeffs[stidx][0] = -1800 + 100 * stidx;
+    coeffs[stidx][1] = 850;
+    coeffs[stidx][2] = 80;
+    coeffs[stidx][3] = 0;
+    coeffs[stidx][4] = -80;
+
+    filtbank.SetCoefficients( stidx, 0, den0bits,
+      coeffs[stidx][0], coeffs[stidx][1], coeffs[stidx][2],
+      coeffs[stidx][3], coeffs[stidx][4] );
+
+    for (cidx = 0; cidx < (4 * DISPTEST_CHANS); cidx++)
+      history[stidx][cidx] = 0;
+  }
+
+  result = 0;
+
+  for (sidx = 0; sidx < DISPTEST_SAMPLES; sidx++)
+  {
+    for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+    {
+      indata.data[0][cidx] = (samptype_t) GetInput(sidx, cidx);
+      stagedata[0][cidx] = indata.data[0][cidx];
+    }
+
+    filtbank.ApplyBankOnce(indata, outdata);
+
+    for (stidx = 0; stidx < DISPTEST_STAGES; stidx++)
+      (*kernels.BiquadStage)( stagedata[stidx], stagedata[stidx + 1],
+        history[stidx], DISPTEST_CHANS, coeffs[stidx], den0bits,
+        DISPTEST_CHANS );
+
+    for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+      if (stagedata[DISPTEST_STAGES][cidx] != outdata.data[0][cidx])
+        result++;
+  }
+
+  return result;
+}
+
+
+
+// This checks the dot product kernel against nloop_FIRFilter_t.
+// It returns the number of mismatches.
+
+template <class samptype_t, class accumtype_t>
+long TestDot(nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels)
+{
+  nloop_FIRFilter_t<samptype_t, int, DISPTEST_TAPS, accumtype_t> filter;
+  samptype_t data[DISPTEST_TAPS];
+  accumtype_t total;
+  int sidx, tidx, count;
+  long result;
+
+  result = 0;
+
+  // No fractional bits, so the filter returns the dot product itself.
+  filter.SetFracBits(0);
+
+  for (sidx = 0; sidx < DISPTEST_SAMPLES; sidx++)
+  {
+    // Vary the length, including zero.
+    count = sidx % (DISPTEST_TAPS + 1);
+    filter.SetCoeffCount(count);
+
+    for (tidx = 0; tidx < DISPTEST_TAPS; tidx++)
+    {
+      data[tidx] = (samptype_t) GetRandom(DISPTEST_AMPLITUDE);
+      filter.SetOneCoefficient(tidx, (samptype_t) GetRandom(100));
+    }
+
+    total = (*kernels.DotProduct)( data, filter.GetCoefficientArray(),
+      count );
+
+    if ( ((samptype_t) total) != filter.ApplyFIROnceLinear(data) )
+      result++;
+  }
+
+  return result;
+}
+
+
+
+// This checks the averager kernel against nloop_Averager_t.
+// It returns the number of mismatched output samples.
+
+template <class samptype_t, class accumtype_t>
+long TestAverage(nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels)
+{
+  nloop_Averager_t<samptype_t, DISPTEST_COEFFBITS>
+    averagers[DISPTEST_CHANS];
+  samptype_t indata[DISPTEST_CHANS], outdata[DISPTEST_CHANS];
+  samptype_t sums[DISPTEST_CHANS], coeffs[DISPTEST_CHANS];
+  uint8_t avgbits[DISPTEST_CHANS];
+  int sidx, cidx;
+  long result;
+
+  for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+  {
+    coeffs[cidx] = 200 + cidx;
+    avgbits[cidx] = 2 + (cidx % 5);
+    sums[cidx] = 0;
+
+    averagers[cidx].SetCoeff(coeffs[cidx]);
+    averagers[cidx].SetAvgBits(avgbits[cidx]);
+    averagers[cidx].InitAverage(0);
+  }
+
+  result = 0;
+
+  for (sidx = 0; sidx < DISPTEST_SAMPLES; sidx++)
+  {
+    // Averager input is typically a magnitude.
+    for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+      indata[cidx] = (samptype_t) ( GetInput(sidx, cidx) / 8 );
+
+    (*kernels.Average)( indata, outdata, sums, coeffs, avgbits,
+      DISPTEST_COEFFBITS, DISPTEST_CHANS );
+
+    for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+      if (outdata[cidx] != averagers[cidx].UpdateAverage(indata[cidx]))
+        result++;
+  }
+
+  return result;
+}
+
+
+
+// This checks the arg-max kernel against a plain search, and checks that
+// nloop_IdentifyWinningBanks() (which uses the kernels for the level in
+// use) agrees. It returns the number of mismatched selections.
+
+template <class samptype_t, class accumtype_t>
+long TestArgMax(nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels)
+{
+  nloop_SampleSlice_t<samptype_t, DISPTEST_BANKS, DISPTEST_CHANS> source;
+  nloop_SampleSlice_t<int, 1, DISPTEST_CHANS> selections;
+  nloop_SampleSlice_t<bool, 1, DISPTEST_CHANS> was_local;
+  int kernelsel[DISPTEST_CHANS];
+  samptype_t maxvals[DISPTEST_CHANS];
+  int sidx, bidx, cidx, expected;
+  long result;
+
+  result = 0;
+
+  for (sidx = 0; sidx < DISPTEST_SAMPLES; sidx++)
+  {
+    // A narrow range gives plenty of ties.
+    for (bidx = 0; bidx < DISPTEST_BANKS; bidx++)
+      for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+        source.data[bidx][cidx] = (samptype_t) GetRandom(4);
+
+    nloop_IdentifyWinningBanks<samptype_t, DISPTEST_BANKS, DISPTEST_CHANS>(
+      source, DISPTEST_BANKS, DISPTEST_CHANS, selections, was_local );
+
+    (*kernels.ArgMax)( &(source.data[0][0]), DISPTEST_CHANS,
+      DISPTEST_BANKS, DISPTEST_CHANS, kernelsel, maxvals );
+
+    for (cidx = 0; cidx < DISPTEST_CHANS; cidx++)
+    {
+      // Ties go to the earlier bank.
+      expected = 0;
+      for (bidx = 1; bidx < DISPTEST_BANKS; bidx++)
+        if (source.data[bidx][cidx] > source.data[expected][cidx])
+          expected = bidx;
+
+      if ( (kernelsel[cidx] != expected)
+        || (maxvals[cidx] != source.data[expected][cidx])
+        || (selections.data[0][cidx] != expected)
+        || ( was_local.data[0][cidx]
+          != ((0 < expected) && ((DISPTEST_BANKS - 1) > expected)) ) )
+        result++;
+    }
+  }
+
+  return result;
+}
+
+
+
+// This checks the lookup kernels against a plain search, and checks that
+// nloop_LookupMonoStep_t (which uses the kernels for the level in use)
+// agrees. It returns the number of mismatched lookups.
+
+template <class samptype_t, class accumtype_t>
+long TestLookup(nloop_DispatchKernels_t<samptype_t, accumtype_t> &kernels)
+{
+  nloop_LookupMonoStep_t<samptype_t, int, DISPTEST_ROWS> lutdown, lutup;
+  samptype_t keysdown[DISPTEST_ROWS], keysup[DISPTEST_ROWS];
+  samptype_t value;
+  int ridx, sidx, kernelidx, expected;
+  long result;
+
+  // Steps of 700, with a repeated key.
+  for (ridx = 0; ridx < DISPTEST_ROWS; ridx++)
+  {
+    keysup[ridx] = (samptype_t) (700 * ridx - 8000);
+    if (5 == ridx)
+      keysup[ridx] = keysup[ridx - 1];
+    keysdown[DISPTEST_ROWS - 1 - ridx] = keysup[ridx];
+  }
+
+  for (ridx = 0; ridx < DISPTEST_ROWS; ridx++)
+  {
+    // Output values are row numbers plus one, so "no match" (0) is
+    // distinguishable.
+    lutdown.SetEntry(ridx, keysdown[ridx], ridx + 1);
+    lutup.SetEntry(ridx, keysup[ridx], ridx + 1);
+  }
+  lutdown.SetActiveRows(DISPTEST_ROWS);
+  lutup.SetActiveRows(DISPTEST_ROWS);
+
+  result = 0;
+
+  for (sidx = 0; sidx < DISPTEST_SAMPLES; sidx++)
+  {
+    // This covers values past both ends and exact key matches.
+    value = (samptype_t) ( (sidx % 2) ? GetRandom(9000)
+      : keysup[sidx % DISPTEST_ROWS] );
+
+    for (expected = 0; expected < DISPTEST_ROWS; expected++)
+      if (keysdown[expected] <= value)
+        break;
+
+    kernelidx = (*kernels.LookupIndexLE)(keysdown, DISPTEST_ROWS, value);
+    if ( (kernelidx != expected) || ( lutdown.Lookup_LE(value)
+      != ((expected < DISPTEST_ROWS) ? (expected + 1) : 0) ) )
+      result++;
+
+    for (expected = 0; expected < DISPTEST_ROWS; expected++)
+      if (keysup[expected] >= value)
+        break;
+
+    kernelidx = (*kernels.LookupIndexGE)(keysup, DISPTEST_ROWS, value);
+    if ( (kernelidx != expected) || ( lutup.Lookup_GE(value)
+      != ((expected < DISPTEST_ROWS) ? (expected + 1) : 0) ) )
+      result++;
+  }
+
+  return result;
+}
+
+
+
+// This runs all kernel checks at every supported level for one type
+// pair. It returns false if anything mismatched.
+
+template <class samptype_t, class accumtype_t>
+bool TestTypes(const char *tname)
+{
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> kernels;
+  long mismatches;
+  int level;
+  bool is_ok;
+
+  is_ok = true;
+
+  for (level = NLOOP_CPU_SCALAR; level <= nloop_CPUDetectLevel(); level++)
+  {
+    // Library modules that use the kernels pick up the level in use.
+    nloop_CPUSetLevel(level);
+    nloop_GetDispatchKernelsForLevel(kernels, level);
+    srand(DISPTEST_SEED);
+
+    mismatches = TestBiquad(kernels);
+    mismatches += TestDot(kernels);
+    mismatches += TestAverage(kernels);
+    mismatches += TestArgMax(kernels);
+    mismatches += TestLookup(kernels);
+
+    cout << "  " << tname << ", " << nloop_CPULevelName(kernels.level)
+      << ":  " << mismatches << " mismatches.\n";
+
+    if ((0 != mismatches) || (level != kernels.level))
+      is_ok = false;
+  }
+
+  return is_ok;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  nloop_DispatchKernels_t<int32_t, int64_t> kernels;
+  int detected, level;
+  bool is_ok, is_override_ok;
+
+  // Starting banner.
+  cout << "\n== CPU dispatch test.\n\n";
+
+  is_ok = true;
+
+  // The override is read on first use, and can only lower the level.
+  setenv(NLOOP_CPU_LEVEL_ENV, "scalar", 1);
+
+  detected = nloop_CPUDetectLevel();
+  level = nloop_CPUGetLevel();
+  nloop_GetDispatchKernels(kernels);
+
+  cout << "Detected level:  " << nloop_CPULevelName(detected) << "\n";
+  cout << "Level with \"" << NLOOP_CPU_LEVEL_ENV << "=scalar\":  "
+    << nloop_CPULevelName(level) << "\n";
+
+  is_override_ok = (NLOOP_CPU_SCALAR == level)
+    && (NLOOP_CPU_SCALAR == kernels.level)
+    && nloop_CPULevelOverrideOk();
+
+  level = nloop_CPUSetLevel(NLOOP_CPU_AVX512);
+  is_override_ok = is_override_ok && (detected == level);
+
+  cout << "Level after asking for avx512:  " << nloop_CPULevelName(level)
+    << "\n";
+
+  is_override_ok = is_override_ok
+    && (NLOOP_CPU_AVX2 == nloop_CPUParseLevel("avx2"))
+    && (-1 == nloop_CPUParseLevel("mmx"));
+
+  if (!is_override_ok)
+  {
+    cout << "Level selection didn't behave as expected.\n";
+    is_ok = false;
+  }
+
+  cout << "Kernels against library modules:\n";
+
+  is_ok = TestTypes<int16_t, int16_t>("int16") && is_ok;
+  is_ok = TestTypes<int16_t, int32_t>("int16-acc32") && is_ok;
+  is_ok = TestTypes<int32_t, int32_t>("int32") && is_ok;
+  is_ok = TestTypes<int32_t, int64_t>("int32-acc64") && is_ok;
+  is_ok = TestTypes<int64_t, int64_t>("int64") && is_ok;
+
+  cout << "CPU dispatch test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of CPU dispatch test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
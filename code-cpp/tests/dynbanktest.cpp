@@ -0,0 +1,631 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Run-time geometry banks and storage arenas.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <math.h>
+
+
+//
+// Constants
+
+// Test geometry. The standard banks use this at compile time; the Dyn
+// banks are given it at run time.
+#define DYNTEST_BANKS 4
+#define DYNTEST_CHANS 16
+#define DYNTEST_STAGES 3
+#define DYNTEST_FIRTAPS 16
+
+// Samples processed before and after the checkpoint.
+#define DYNTEST_WARMUP 1500
+#define DYNTEST_RESUME 1500
+
+// The restarted Dyn banks are configured with more channels than are
+// active, so that the channel stride differs from the active count.
+#define DYNTEST_WIDE_CHANS 40
+
+// Averager coefficient precision; the test averager uses unity gain.
+#define DYNTEST_AVGBITS 8
+
+// Trigger window and pulse quota. The quota is large enough that every
+// onset can trigger, but small enough that it runs out partway through.
+#define DYNTEST_TRIG_WINDOW 100000
+#define DYNTEST_TRIG_PULSES 400
+
+// Large rig, for the sizing check.
+#define DYNTEST_LARGE_BANKS 8
+#define DYNTEST_LARGE_CHANS 1024
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, DYNTEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<int32_t, DYNTEST_BANKS, DYNTEST_CHANS>
+  test_sampslice_t;
+typedef nloop_SampleSlice_t<int, DYNTEST_BANKS, DYNTEST_CHANS>
+  test_indexslice_t;
+typedef nloop_SampleSlice_t<bool, DYNTEST_BANKS, DYNTEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_Analytic_PTZC_t<int32_t, int> test_estimator_t;
+
+
+// Standard banks.
+
+struct test_fixed_t
+{
+  nloop_IIRFilterBank_t<int32_t, int,
+    DYNTEST_STAGES, DYNTEST_BANKS, DYNTEST_CHANS> biquads;
+  nloop_FIRFilterBank_t<int32_t, int, DYNTEST_FIRTAPS, DYNTEST_FIRTAPS,
+    DYNTEST_BANKS, DYNTEST_CHANS> firs;
+  nloop_AnalyticBank_PT_t<int32_t, int, test_estimator_t,
+    DYNTEST_BANKS, DYNTEST_CHANS> analytic;
+  nloop_AveragerBank_t<int32_t, DYNTEST_AVGBITS,
+    DYNTEST_BANKS, DYNTEST_CHANS> averagers;
+  nloop_ThresholdSingleBank_t<int32_t, DYNTEST_BANKS, DYNTEST_CHANS>
+    threshsingle;
+  nloop_ThresholdDualBank_t<DYNTEST_BANKS, DYNTEST_CHANS> threshdual;
+  nloop_DeGlitcherBank_t<int, DYNTEST_BANKS, DYNTEST_CHANS> deglitch;
+  nloop_TriggerBank_t<int, DYNTEST_BANKS, DYNTEST_CHANS> triggers;
+
+  test_sampslice_t thresh_high, thresh_low;
+  test_indexslice_t targets;
+
+  test_sampslice_t iirout, firout, magnitudes, averages;
+  test_indexslice_t periods, since_rise, since_fall;
+  test_flagslice_t flag_high, flag_low, detected, bursts, trigout;
+};
+
+
+// Run-time geometry banks, plus output arrays sized for the widest
+// configuration.
+
+struct test_dyn_t
+{
+  nloop_Arena_t arena;
+
+  nloop_IIRFilterBankDyn_t<int32_t, int, DYNTEST_STAGES> biquads;
+  nloop_FIRFilterBankDyn_t<int32_t, int, DYNTEST_FIRTAPS, DYNTEST_FIRTAPS>
+    firs;
+  nloop_AnalyticBankDyn_t<int32_t, int, test_estimator_t> analytic;
+  nloop_AveragerBankDyn_t<int32_t, DYNTEST_AVGBITS> averagers;
+  nloop_ThresholdSingleBankDyn_t<int32_t> threshsingle;
+  nloop_ThresholdDualBankDyn_t threshdual;
+  nloop_DeGlitcherBankDyn_t<int> deglitch;
+  nloop_TriggerBankDyn_t<int> triggers;
+
+  int32_t thresh_high[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int32_t thresh_low[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int targets[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+
+  int32_t indata[DYNTEST_WIDE_CHANS];
+  int32_t iirout[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int32_t firout[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int32_t magnitudes[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int32_t averages[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int periods[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int since_rise[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  int since_fall[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  bool flag_high[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  bool flag_low[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  bool detected[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  bool bursts[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+  bool trigout[DYNTEST_BANKS * DYNTEST_WIDE_CHANS];
+};
+
+
+//
+// Helper Functions
+
+
+// This generates one input sample: a chirp that differs per channel.
+
+void MakeInput(int sidx, test_inslice_t &indata)
+{
+  int cidx;
+  double phase;
+
+  for (cidx = 0; cidx < DYNTEST_CHANS; cidx++)
+  {
+    phase = 6.2832 * sidx / (24.0 + 2 * cidx + (sidx % 500) / 100.0);
+    indata.data[0][cidx] = (int32_t) ( 12000.0 * sin(phase)
+      + 3000.0 * sin(3.7 * phase) );
+  }
+}
+
+
+
+// This applies the same filter design to a standard or Dyn bank.
+
+template <class iirbank_t, class firbank_t>
+void ConfigureFilters(iirbank_t &biquads, firbank_t &firs)
+{
+  ConfigureTestBiquads(biquads, DYNTEST_BANKS, DYNTEST_STAGES);
+  ConfigureTestFIRs(firs, DYNTEST_BANKS);
+}
+
+
+
+// This saves the state of every bank in a standard or Dyn bank set.
+
+template <class bankset_t>
+void SaveBanks(bankset_t &banks, nloop_StateBuffer_t &statebuf)
+{
+  banks.biquads.SaveState(statebuf);
+  banks.firs.SaveState(statebuf);
+  banks.analytic.SaveState(statebuf);
+  banks.averagers.SaveState(statebuf);
+  banks.threshdual.SaveState(statebuf);
+  banks.deglitch.SaveState(statebuf);
+  banks.triggers.SaveState(statebuf);
+}
+
+
+
+// This restores the state of every bank in a standard or Dyn bank set.
+
+template <class bankset_t>
+void LoadBanks(bankset_t &banks, nloop_StateBuffer_t &statebuf)
+{
+  banks.biquads.LoadState(statebuf);
+  banks.firs.LoadState(statebuf);
+  banks.analytic.LoadState(statebuf);
+  banks.averagers.LoadState(statebuf);
+  banks.threshdual.LoadState(statebuf);
+  banks.deglitch.LoadState(statebuf);
+  banks.triggers.LoadState(statebuf);
+}
+
+
+
+// This configures the standard banks.
+
+void ConfigureFixed(test_fixed_t &fixed)
+{
+  nloop_SampleSlice_t<int, DYNTEST_BANKS, 1> minperiods;
+  int bidx;
+
+  fixed.biquads.SetActiveBanks(DYNTEST_BANKS);
+  fixed.biquads.SetActiveChans(DYNTEST_CHANS);
+  fixed.firs.SetActiveBanks(DYNTEST_BANKS);
+  fixed.firs.SetActiveChans(DYNTEST_CHANS);
+
+  ConfigureFilters(fixed.biquads, fixed.firs);
+
+  fixed.analytic.ResetState();
+  for (bidx = 0; bidx < DYNTEST_BANKS; bidx++)
+    minperiods.data[bidx][0] = 8 + 4 * bidx;
+  fixed.analytic.SetMinPeriods(minperiods);
+
+  ConfigureTestAverager(fixed.averagers);
+  fixed.threshdual.ResetState();
+  fixed.deglitch.SetUniformDelays(TEST_DEGLITCH_RISE, TEST_DEGLITCH_FALL);
+
+  fixed.triggers.SetActiveBanks(DYNTEST_BANKS);
+  fixed.triggers.SetActiveChans(DYNTEST_CHANS);
+  ConfigureTestTriggers(fixed.triggers, DYNTEST_TRIG_WINDOW,
+    DYNTEST_TRIG_PULSES);
+
+  fixed.thresh_high.SetUniformValue(TEST_THRESH_HIGH);
+  fixed.thresh_low.SetUniformValue(TEST_THRESH_LOW);
+  fixed.targets.SetUniformValue(TEST_TARGET_DELAY);
+}
+
+
+
+// This sets up storage for the Dyn banks and configures them. It returns
+// false if storage couldn't be attached.
+
+bool ConfigureDyn(test_dyn_t &dyn, int chans)
+{
+  int minperiods[DYNTEST_BANKS];
+  int bidx, cellidx;
+  bool is_ok;
+
+  dyn.arena.Clear();
+  dyn.biquads.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.firs.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.analytic.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.averagers.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.threshsingle.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.threshdual.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.deglitch.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+  dyn.triggers.ReserveStorage(dyn.arena, DYNTEST_BANKS, chans);
+
+  is_ok = dyn.arena.Commit();
+  is_ok = is_ok && dyn.biquads.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.firs.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.analytic.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.averagers.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.threshsingle.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.threshdual.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.deglitch.AttachStorage(dyn.arena);
+  is_ok = is_ok && dyn.triggers.AttachStorage(dyn.arena);
+
+  ConfigureFilters(dyn.biquads, dyn.firs);
+
+  dyn.analytic.ResetState();
+  for (bidx = 0; bidx < DYNTEST_BANKS; bidx++)
+    minperiods[bidx] = 8 + 4 * bidx;
+  dyn.analytic.SetMinPeriods(minperiods);
+
+  for (cellidx = 0; cellidx < DYNTEST_BANKS * chans; cellidx++)
+  {
+    dyn.thresh_high[cellidx] = TEST_THRESH_HIGH;
+    dyn.thresh_low[cellidx] = TEST_THRESH_LOW;
+    dyn.targets[cellidx] = TEST_TARGET_DELAY;
+    dyn.trigout[cellidx] = true;
+  }
+
+  // Averager running sums start at zero, as with ConfigureTestAverager().
+  dyn.averagers.SetUniformCoeffs(256);
+  dyn.averagers.SetUniformAvgBits(5);
+  dyn.deglitch.SetUniformDelays(TEST_DEGLITCH_RISE, TEST_DEGLITCH_FALL);
+
+  // "trigout" doubles as an all-true array here.
+  dyn.triggers.SetEnableFlags(dyn.trigout);
+  dyn.triggers.SetAllReRaises(true);
+  dyn.triggers.EnableTriggering(DYNTEST_TRIG_WINDOW, DYNTEST_TRIG_PULSES);
+
+  // Only the test geometry's channels are active.
+  dyn.biquads.SetActiveChans(DYNTEST_CHANS);
+  dyn.firs.SetActiveChans(DYNTEST_CHANS);
+  dyn.analytic.SetActiveChans(DYNTEST_CHANS);
+  dyn.averagers.SetActiveChans(DYNTEST_CHANS);
+  dyn.threshsingle.SetActiveChans(DYNTEST_CHANS);
+  dyn.threshdual.SetActiveChans(DYNTEST_CHANS);
+  dyn.deglitch.SetActiveChans(DYNTEST_CHANS);
+  dyn.triggers.SetActiveChans(DYNTEST_CHANS);
+
+  return is_ok;
+}
+
+
+
+// This processes one sample through the standard banks.
+
+void StepFixed(test_fixed_t &fixed, test_inslice_t &indata)
+{
+  fixed.biquads.ApplyBankOnce(indata, fixed.iirout);
+  fixed.firs.ApplyBankOnce(indata, fixed.firout);
+  fixed.analytic.HandleSamples(fixed.iirout);
+  fixed.analytic.GetEstimatedAnalytic( fixed.magnitudes, fixed.periods,
+    fixed.since_rise, fixed.since_fall );
+
+  fixed.averagers.UpdateAverage(fixed.magnitudes, fixed.averages);
+  fixed.threshsingle.TestSamples( fixed.averages, fixed.thresh_high,
+    fixed.flag_high );
+  fixed.threshsingle.TestSamples( fixed.averages, fixed.thresh_low,
+    fixed.flag_low );
+  fixed.threshdual.TestDual(fixed.flag_high, fixed.flag_low, fixed.detected);
+  fixed.deglitch.ProcessSample(fixed.detected, fixed.bursts);
+  fixed.triggers.ProcessSamples( fixed.since_rise, fixed.targets,
+    fixed.periods, fixed.bursts, fixed.trigout );
+}
+
+
+
+// This processes one sample through the Dyn banks.
+
+void StepDyn(test_dyn_t &dyn, test_inslice_t &indata)
+{
+  int cidx;
+
+  for (cidx = 0; cidx < DYNTEST_CHANS; cidx++)
+    dyn.indata[cidx] = indata.data[0][cidx];
+
+  dyn.biquads.ApplyBankOnce(dyn.indata, dyn.iirout);
+  dyn.firs.ApplyBankOnce(dyn.indata, dyn.firout);
+  dyn.analytic.HandleSamples(dyn.iirout);
+  dyn.analytic.GetEstimatedAnalytic( dyn.magnitudes, dyn.periods,
+    dyn.since_rise, dyn.since_fall );
+
+  dyn.averagers.UpdateAverage(dyn.magnitudes, dyn.averages);
+  dyn.threshsingle.TestSamples( dyn.averages, dyn.thresh_high,
+    dyn.flag_high );
+  dyn.threshsingle.TestSamples( dyn.averages, dyn.thresh_low,
+    dyn.flag_low );
+  dyn.threshdual.TestDual(dyn.flag_high, dyn.flag_low, dyn.detected);
+  dyn.deglitch.ProcessSample(dyn.detected, dyn.bursts);
+  dyn.triggers.ProcessSamples( dyn.since_rise, dyn.targets,
+    dyn.periods, dyn.bursts, dyn.trigout );
+}
+
+
+
+// This returns true if the Dyn outputs match the standard outputs for
+// the active channels.
+
+bool OutputsMatch(test_fixed_t &fixed, test_dyn_t &dyn)
+{
+  int bidx, cidx, dynidx;
+  int stride;
+  bool is_ok;
+
+  stride = dyn.biquads.GetChanCount();
+  is_ok = true;
+
+  for (bidx = 0; bidx < DYNTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < DYNTEST_CHANS; cidx++)
+    {
+      dynidx = bidx * stride + cidx;
+
+      is_ok = is_ok
+        && (fixed.iirout.data[bidx][cidx] == dyn.iirout[dynidx])
+        && (fixed.firout.data[bidx][cidx] == dyn.firout[dynidx])
+        && (fixed.magnitudes.data[bidx][cidx] == dyn.magnitudes[dynidx])
+        && (fixed.periods.data[bidx][cidx] == dyn.periods[dynidx])
+        && (fixed.since_rise.data[bidx][cidx] == dyn.since_rise[dynidx])
+        && (fixed.since_fall.data[bidx][cidx] == dyn.since_fall[dynidx])
+        && (fixed.averages.data[bidx][cidx] == dyn.averages[dynidx])
+        && (fixed.detected.data[bidx][cidx] == dyn.detected[dynidx])
+        && (fixed.bursts.data[bidx][cidx] == dyn.bursts[dynidx])
+        && (fixed.trigout.data[bidx][cidx] == dyn.trigout[dynidx]);
+    }
+
+  return is_ok;
+}
+
+
+
+// This counts the true flags in a standard bank slice.
+
+int CountFlags(test_flagslice_t &flags)
+{
+  int bidx, cidx;
+  int count;
+
+  count = 0;
+
+  for (bidx = 0; bidx < DYNTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < DYNTEST_CHANS; cidx++)
+      if (flags.data[bidx][cidx])
+        count++;
+
+  return count;
+}
+
+
+
+// This checks reservation rounding, alignment, and overrun handling.
+
+bool TestArena(void)
+{
+  nloop_Arena_t arena;
+  void *first;
+  void *second;
+  bool is_ok;
+
+  is_ok = (NULL == arena.Carve(1));
+
+  arena.Reserve(10);
+  arena.Reserve(100);
+  is_ok = is_ok && (3 * NLOOP_ARENA_ALIGN_BYTES == arena.GetTotalBytes());
+
+  is_ok = is_ok && arena.Commit() && !arena.Commit();
+
+  first = arena.Carve(10);
+  second = arena.Carve(100);
+
+  is_ok = is_ok && (NULL != first) && (NULL != second)
+    && ( 0 == (((uintptr_t) first) % NLOOP_ARENA_ALIGN_BYTES) )
+    && ( 0 == (((uintptr_t) second) % NLOOP_ARENA_ALIGN_BYTES) )
+    && ( NLOOP_ARENA_ALIGN_BYTES
+      == ((uint8_t *) second - (uint8_t *) first) )
+    && ( arena.GetTotalBytes() == arena.GetCarvedBytes() )
+    && ( 0 == ((uint8_t *) second)[99] );
+
+  // Past the end of the reservation.
+  is_ok = is_ok && (NULL == arena.Carve(1));
+
+  arena.Clear();
+  is_ok = is_ok && !arena.IsCommitted() && (0 == arena.GetTotalBytes());
+
+  return is_ok;
+}
+
+
+
+// This sizes Dyn banks for a large rig, and compares that to what the
+// standard banks would need for the same geometry.
+
+bool TestLargeRig(void)
+{
+  nloop_Arena_t arena;
+  nloop_IIRFilterBankDyn_t<int32_t, int, DYNTEST_STAGES> biquads;
+  nloop_AnalyticBankDyn_t<int32_t, int, test_estimator_t> analytic;
+  size_t fixedbytes;
+  bool is_ok;
+
+  biquads.ReserveStorage(arena, DYNTEST_LARGE_BANKS, DYNTEST_LARGE_CHANS);
+  analytic.ReserveStorage(arena, DYNTEST_LARGE_BANKS, DYNTEST_LARGE_CHANS);
+
+  is_ok = arena.Commit() && biquads.AttachStorage(arena)
+    && analytic.AttachStorage(arena);
+
+  is_ok = is_ok && (DYNTEST_LARGE_BANKS == biquads.GetActiveBanks())
+    && (DYNTEST_LARGE_CHANS == biquads.GetActiveChans())
+    && (DYNTEST_LARGE_CHANS == analytic.GetChanCount())
+    && (arena.GetTotalBytes() == arena.GetCarvedBytes());
+
+  fixedbytes = sizeof( nloop_IIRFilterBank_t<int32_t, int, DYNTEST_STAGES,
+    DYNTEST_LARGE_BANKS, DYNTEST_LARGE_CHANS> )
+    + sizeof( nloop_AnalyticBank_PT_t<int32_t, int, test_estimator_t,
+    DYNTEST_LARGE_BANKS, DYNTEST_LARGE_CHANS> );
+
+  cout << DYNTEST_LARGE_BANKS << " x " << DYNTEST_LARGE_CHANS
+    << " arena: " << arena.GetTotalBytes() << " bytes (standard banks: "
+    << fixedbytes << " bytes).\n";
+
+  // Only per-cell storage scales, and it's the same size either way.
+  is_ok = is_ok && (arena.GetTotalBytes() <= fixedbytes
+    + 2 * NLOOP_ARENA_ALIGN_BYTES);
+
+  return is_ok;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_fixed_t *fixed;
+  test_dyn_t *dyn;
+  test_dyn_t *restarted;
+  test_fixed_t *reloaded;
+  test_inslice_t indata;
+  nloop_StateBuffer_t statebuf;
+  vector<uint8_t> statedata;
+  int sidx;
+  int burstcount, trigcount;
+  bool is_ok, is_match;
+
+  // Starting banner.
+  cout << "\n== Run-time geometry bank test.\n\n";
+
+
+  // Arena bookkeeping.
+
+  is_ok = TestArena();
+  cout << "Arena reservation, alignment, and bounds: "
+    << (is_ok ? "ok" : "FAILED") << ".\n";
+
+
+  // These are too large for the stack.
+  fixed = new test_fixed_t;
+  dyn = new test_dyn_t;
+  restarted = new test_dyn_t;
+  reloaded = new test_fixed_t;
+
+  ConfigureFixed(*fixed);
+  is_ok = ConfigureDyn(*dyn, DYNTEST_CHANS) && is_ok;
+
+
+  // Standard and Dyn banks should give identical output.
+
+  is_match = true;
+  burstcount = 0;
+  trigcount = 0;
+
+  for (sidx = 0; sidx < DYNTEST_WARMUP; sidx++)
+  {
+    MakeInput(sidx, indata);
+    StepFixed(*fixed, indata);
+    StepDyn(*dyn, indata);
+    is_match = is_match && OutputsMatch(*fixed, *dyn);
+
+    burstcount += CountFlags(fixed->bursts);
+    trigcount += CountFlags(fixed->trigout);
+  }
+
+  cout << "Dyn banks (" << dyn->arena.GetTotalBytes() << " byte arena) "
+    << (is_match ? "match" : "DON'T MATCH") << " standard banks over "
+    << DYNTEST_WARMUP << " samples.\n";
+  cout << "(" << burstcount << " burst samples, " << trigcount
+    << " trigger samples.)\n";
+
+  // The comparison only means something if detection did something.
+  is_ok = is_ok && is_match && (0 < burstcount) && (0 < trigcount);
+
+
+  // Checkpoint the standard banks, and restore into Dyn banks with a
+  // wider configured geometry.
+
+  statebuf.StartWrite(NULL, 0);
+  SaveBanks(*fixed, statebuf);
+  statedata.resize(statebuf.GetByteCount());
+
+  statebuf.StartWrite(statedata.data(), statedata.size());
+  SaveBanks(*fixed, statebuf);
+  is_ok = is_ok && statebuf.IsOk();
+
+  is_ok = ConfigureDyn(*restarted, DYNTEST_WIDE_CHANS) && is_ok;
+
+  is_ok = is_ok && statebuf.StartRead(statedata.data(), statedata.size());
+  LoadBanks(*restarted, statebuf);
+  is_ok = is_ok && statebuf.IsOk();
+
+  is_match = true;
+
+  for (sidx = DYNTEST_WARMUP; sidx < (DYNTEST_WARMUP + DYNTEST_RESUME);
+    sidx++)
+  {
+    MakeInput(sidx, indata);
+    StepFixed(*fixed, indata);
+    StepDyn(*restarted, indata);
+    is_match = is_match && OutputsMatch(*fixed, *restarted);
+  }
+
+  cout << "Standard checkpoint restored into " << DYNTEST_WIDE_CHANS
+    << "-channel Dyn banks: " << (is_match ? "match" : "DON'T MATCH")
+    << " over " << DYNTEST_RESUME << " samples.\n";
+
+  is_ok = is_ok && is_match;
+
+
+  // Checkpoint the restarted Dyn banks, and restore into standard banks.
+
+  statebuf.StartWrite(NULL, 0);
+  SaveBanks(*restarted, statebuf);
+  statedata.resize(statebuf.GetByteCount());
+
+  statebuf.StartWrite(statedata.data(), statedata.size());
+  SaveBanks(*restarted, statebuf);
+  is_ok = is_ok && statebuf.IsOk();
+
+  ConfigureFixed(*reloaded);
+
+  is_ok = is_ok && statebuf.StartRead(statedata.data(), statedata.size());
+  LoadBanks(*reloaded, statebuf);
+  is_ok = is_ok && statebuf.IsOk();
+
+  is_match = true;
+
+  for (sidx = DYNTEST_WARMUP + DYNTEST_RESUME;
+    sidx < (DYNTEST_WARMUP + 2 * DYNTEST_RESUME); sidx++)
+  {
+    MakeInput(sidx, indata);
+    StepFixed(*reloaded, indata);
+    StepDyn(*restarted, indata);
+    is_match = is_match && OutputsMatch(*reloaded, *restarted);
+  }
+
+  cout << "Dyn checkpoint restored into standard banks: "
+    << (is_match ? "match" : "DON'T MATCH") << " over " << DYNTEST_RESUME
+    << " samples.\n";
+
+  is_ok = is_ok && is_match;
+
+
+  // Large rig sizing.
+
+  is_ok = TestLargeRig() && is_ok;
+
+
+  delete fixed;
+  delete dyn;
+  delete restarted;
+  delete reloaded;
+
+  cout << "Run-time geometry bank test " << (is_ok ? "passed" : "FAILED")
+    << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of run-time geometry bank test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,538 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - EDF/BDF recording reader.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <sstream>
+#include <chrono>
+#include <string.h>
+
+
+//
+// Constants
+
+#define EDFTEST_EDFNAME "edftest.edf"
+#define EDFTEST_BDFNAME "edftest.bdf"
+
+// EDF geometry: 32 fast channels, one slow channel, and annotations.
+#define EDFTEST_EDFCHANS 32
+#define EDFTEST_EDFRATE 500
+#define EDFTEST_EDFSLOW 50
+#define EDFTEST_EDFANNOT 30
+#define EDFTEST_EDFRECORDS 600
+
+// BDF geometry.
+#define EDFTEST_BDFCHANS 8
+#define EDFTEST_BDFRATE 256
+#define EDFTEST_BDFRECORDS 50
+
+// Slices per batch. This deliberately doesn't divide the record length.
+#define EDFTEST_BATCH 256
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, EDFTEST_EDFCHANS> test_edfslice_t;
+typedef nloop_SampleSlice_t<int32_t, 1, EDFTEST_BDFCHANS> test_bdfslice_t;
+
+
+//
+// Classes
+
+
+// Stream buffer that stops one read early at a given offset, the way a
+// flaky disk or network mount would.
+
+class test_flakybuf_t : public stringbuf
+{
+public:
+  // Offset where the next read stops, or -1.
+  streamsize fail_at;
+
+  test_flakybuf_t(const string &text) : stringbuf(text, ios::in)
+  { fail_at = -1; }
+
+protected:
+  streamsize xsgetn(char *dest, streamsize count)
+  {
+    streamsize here;
+
+    here = (streamsize) seekoff(0, ios::cur, ios::in);
+    if ( (0 <= fail_at) && (here <= fail_at) && ((here + count) > fail_at) )
+    {
+      count = fail_at - here;
+      fail_at = -1;
+    }
+
+    return stringbuf::xsgetn(dest, count);
+  }
+};
+
+
+//
+// Helper Functions
+
+
+// This generates deterministic digital values.
+
+int32_t MakeEDFSample(long sampidx, int chanidx)
+{
+  return (int32_t) ( ((sampidx * (chanidx + 5)) % 65521) - 32760 );
+}
+
+int32_t MakeBDFSample(long sampidx, int chanidx)
+{
+  return (int32_t) ( ((sampidx * (chanidx + 5) * 977) % 16777213) - 8388600 );
+}
+
+
+
+// This appends a space-padded header field.
+
+void AddField(string &header, string value, size_t fieldlen)
+{
+  value.resize(fieldlen, ' ');
+  header += value;
+}
+
+
+
+// This appends one field per signal.
+
+void AddSignalFields(string &header, vector<string> &values,
+  size_t fieldlen)
+{
+  size_t sidx;
+
+  for (sidx = 0; sidx < values.size(); sidx++)
+    AddField(header, values[sidx], fieldlen);
+}
+
+
+
+// This builds a complete EDF/BDF header.
+
+string BuildHeader(bool is_bdf, long recordcount,
+  vector<string> &labels, vector<string> &units,
+  vector<string> &physmins, vector<string> &physmaxes,
+  vector<string> &digmins, vector<string> &digmaxes,
+  vector<string> &samprecords)
+{
+  string header;
+  vector<string> blanks;
+  size_t sigcount;
+
+  sigcount = labels.size();
+  blanks.resize(sigcount);
+
+  if (is_bdf)
+  {
+    header += (char) 0xff;
+    AddField(header, "BIOSEMI", 7);
+  }
+  else
+    AddField(header, "0", 8);
+
+  AddField(header, "X X X X", 80);
+  AddField(header, "Startdate X X X X", 80);
+  AddField(header, "01.01.20", 8);
+  AddField(header, "00.00.00", 8);
+  AddField(header, to_string((sigcount + 1) * 256), 8);
+  AddField(header, (is_bdf ? "24BIT" : "EDF+C"), 44);
+  AddField(header, to_string(recordcount), 8);
+  AddField(header, "1", 8);
+  AddField(header, to_string(sigcount), 4);
+
+  AddSignalFields(header, labels, 16);
+  AddSignalFields(header, blanks, 80);
+  AddSignalFields(header, units, 8);
+  AddSignalFields(header, physmins, 8);
+  AddSignalFields(header, physmaxes, 8);
+  AddSignalFields(header, digmins, 8);
+  AddSignalFields(header, digmaxes, 8);
+  AddSignalFields(header, blanks, 80);
+  AddSignalFields(header, samprecords, 8);
+  AddSignalFields(header, blanks, 32);
+
+  return header;
+}
+
+
+
+// This writes the EDF test file. The record count in the header is -1, as
+// it would be for an interrupted recording.
+// It returns false on I/O errors.
+
+bool WriteEDF(void)
+{
+  ofstream outfile;
+  vector<string> labels, units, physmins, physmaxes, digmins, digmaxes,
+    samprecords;
+  vector<uint8_t> record;
+  uint8_t *recptr;
+  long ridx, sidx, sampidx;
+  int cidx;
+  int32_t thisval;
+
+  for (cidx = 0; cidx < EDFTEST_EDFCHANS + 2; cidx++)
+  {
+    labels.push_back("Ch" + to_string(cidx));
+    units.push_back("uV");
+    physmins.push_back("0");
+    physmaxes.push_back("6553.5");
+    digmins.push_back("-32768");
+    digmaxes.push_back("32767");
+    samprecords.push_back(to_string(EDFTEST_EDFRATE));
+  }
+
+  labels[EDFTEST_EDFCHANS] = "Temp";
+  samprecords[EDFTEST_EDFCHANS] = to_string(EDFTEST_EDFSLOW);
+  labels[EDFTEST_EDFCHANS + 1] = "EDF Annotations";
+  samprecords[EDFTEST_EDFCHANS + 1] = to_string(EDFTEST_EDFANNOT);
+
+  outfile.open(EDFTEST_EDFNAME, ios::out | ios::binary | ios::trunc);
+  if (!outfile.is_open())
+    return false;
+
+  outfile << BuildHeader( false, -1, labels, units, physmins, physmaxes,
+    digmins, digmaxes, samprecords );
+
+  record.resize( 2 * (EDFTEST_EDFCHANS * EDFTEST_EDFRATE
+    + EDFTEST_EDFSLOW + EDFTEST_EDFANNOT) );
+
+  for (ridx = 0; ridx < EDFTEST_EDFRECORDS; ridx++)
+  {
+    // Fill with a marker value, so that skipped signals show up if they're
+    // read by mistake.
+    memset(record.data(), 0x7f, record.size());
+
+    recptr = record.data();
+    for (cidx = 0; cidx < EDFTEST_EDFCHANS; cidx++)
+      for (sidx = 0; sidx < EDFTEST_EDFRATE; sidx++)
+      {
+        sampidx = ridx * EDFTEST_EDFRATE + sidx;
+        thisval = MakeEDFSample(sampidx, cidx);
+        recptr[0] = (uint8_t) (thisval & 0xff);
+        recptr[1] = (uint8_t) ((thisval >> 8) & 0xff);
+        recptr += 2;
+      }
+
+    outfile.write( (const char *) record.data(), record.size() );
+  }
+
+  outfile.close();
+
+  return !outfile.fail();
+}
+
+
+
+// This writes the BDF test file. It returns false on I/O errors.
+
+bool WriteBDF(void)
+{
+  ofstream outfile;
+  vector<string> labels, units, physmins, physmaxes, digmins, digmaxes,
+    samprecords;
+  vector<uint8_t> record;
+  uint8_t *recptr;
+  long ridx, sidx, sampidx;
+  int cidx;
+  int32_t thisval;
+
+  for (cidx = 0; cidx < EDFTEST_BDFCHANS; cidx++)
+  {
+    labels.push_back("A" + to_string(cidx + 1));
+    units.push_back("uV");
+    physmins.push_back("-262144");
+    physmaxes.push_back("262143");
+    digmins.push_back("-8388608");
+    digmaxes.push_back("8388607");
+    samprecords.push_back(to_string(EDFTEST_BDFRATE));
+  }
+
+  outfile.open(EDFTEST_BDFNAME, ios::out | ios::binary | ios::trunc);
+  if (!outfile.is_open())
+    return false;
+
+  outfile << BuildHeader( true, EDFTEST_BDFRECORDS, labels, units,
+    physmins, physmaxes, digmins, digmaxes, samprecords );
+
+  record.resize(3 * EDFTEST_BDFCHANS * EDFTEST_BDFRATE);
+
+  for (ridx = 0; ridx < EDFTEST_BDFRECORDS; ridx++)
+  {
+    recptr = record.data();
+    for (cidx = 0; cidx < EDFTEST_BDFCHANS; cidx++)
+      for (sidx = 0; sidx < EDFTEST_BDFRATE; sidx++)
+      {
+        sampidx = ridx * EDFTEST_BDFRATE + sidx;
+        thisval = MakeBDFSample(sampidx, cidx);
+        recptr[0] = (uint8_t) (thisval & 0xff);
+        recptr[1] = (uint8_t) ((thisval >> 8) & 0xff);
+        recptr[2] = (uint8_t) ((thisval >> 16) & 0xff);
+        recptr += 3;
+      }
+
+    outfile.write( (const char *) record.data(), record.size() );
+  }
+
+  outfile.close();
+
+  return !outfile.fail();
+}
+
+
+
+// This reads an entire EDF test file and checks it.
+// "offset" is added to expected values. Throughput is reported.
+
+bool CheckEDF(nloop_EDFReader_t &reader, test_edfslice_t *slices,
+  int32_t offset, const char *label)
+{
+  chrono::steady_clock::time_point tstart, tend;
+  double seconds;
+  size_t count, bidx;
+  long sampidx, mismatches;
+  int cidx;
+
+  mismatches = 0;
+  sampidx = 0;
+
+  reader.Rewind();
+  tstart = chrono::steady_clock::now();
+  do
+  {
+    count = reader.ReadNextSlices<int32_t, EDFTEST_EDFCHANS>(
+      EDFTEST_BATCH, slices );
+
+    for (bidx = 0; bidx < count; bidx++)
+    {
+      for (cidx = 0; cidx < EDFTEST_EDFCHANS; cidx++)
+        if ( (MakeEDFSample(sampidx, cidx) + offset)
+          != slices[bidx].data[0][cidx] )
+          mismatches++;
+      sampidx++;
+    }
+  }
+  while (0 < count);
+  tend = chrono::steady_clock::now();
+
+  seconds = chrono::duration<double>(tend - tstart).count();
+
+  cout << label << ( ((0 == mismatches)
+    && (EDFTEST_EDFRECORDS * EDFTEST_EDFRATE == sampidx)) ? "ok" : "FAILED" )
+    << "  (" << (seconds * 1000.0) << " ms, "
+    << ( ((double) sampidx) * EDFTEST_EDFCHANS * 2 / (seconds * 1.0e6) )
+    << " MB/s)\n";
+
+  return (0 == mismatches) && (EDFTEST_EDFRECORDS * EDFTEST_EDFRATE == sampidx);
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  nloop_EDFReader_t reader;
+  test_edfslice_t *edfslices;
+  test_bdfslice_t *bdfslices;
+  size_t count, bidx;
+  long sampidx;
+  int cidx;
+  bool is_ok, this_ok;
+
+  // Starting banner.
+  cout << "\n== EDF/BDF reader test.\n\n";
+
+  is_ok = true;
+
+  if ( (!WriteEDF()) || (!WriteBDF()) )
+  {
+    cout << "Couldn't write test files.\n";
+    return 1;
+  }
+
+  edfslices = new test_edfslice_t[EDFTEST_BATCH];
+  bdfslices = new test_bdfslice_t[EDFTEST_BATCH];
+
+
+  // EDF header.
+
+  this_ok = reader.OpenFile(EDFTEST_EDFNAME);
+  this_ok = this_ok && (!reader.IsBDF())
+    && (EDFTEST_EDFCHANS + 2 == reader.GetSignalCount())
+    && (EDFTEST_EDFRECORDS == reader.GetRecordCount())
+    && (EDFTEST_EDFCHANS == reader.GetChanCount())
+    && (EDFTEST_EDFRATE == reader.GetSampleRate())
+    && ("Temp" == reader.GetSignalLabel(EDFTEST_EDFCHANS))
+    && ("uV" == reader.GetSignalUnits(0));
+  for (cidx = 0; cidx < EDFTEST_EDFCHANS; cidx++)
+    this_ok = this_ok && (cidx == reader.GetChanSignal(cidx));
+  cout << "EDF header:          " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  // EDF data, with the default block size and with one record per block.
+
+  is_ok = is_ok && CheckEDF(reader, edfslices, 0, "EDF data:            ");
+
+  reader.SetBlockBytes(1);
+  is_ok = is_ok
+    && CheckEDF(reader, edfslices, 0, "EDF single records:  ");
+  reader.SetBlockBytes(NLOOP_EDF_BLOCK_BYTES);
+
+  // Physical range 0..6553.5 over -32768..32767 is 0.1 per count, offset
+  // by 3276.8, so tenths of a unit are digital values plus 32768.
+  is_ok = is_ok && reader.SetPhysicalScaling(10.0);
+  is_ok = is_ok
+    && CheckEDF(reader, edfslices, 32768, "EDF physical units:  ");
+  reader.ClearScaling();
+
+  // Gains and offsets that could overflow are rejected, and leave the
+  // scaling alone.
+  this_ok = (!reader.SetChanScaling(0, NAN, 0))
+    && (!reader.SetChanScaling(0, 1.0e12, 0))
+    && (!reader.SetChanScaling(0, -1.0e12, 0))
+    && (!reader.SetChanScaling(0, 1.0, NLOOP_EDF_MAX_OFFSET + 1))
+    && (!reader.SetChanScaling(0, 1.0, -NLOOP_EDF_MAX_OFFSET - 1))
+    && (!reader.SetChanScaling(EDFTEST_EDFCHANS, 1.0, 0))
+    && (!reader.SetPhysicalScaling(1.0e30))
+    && (!reader.SetPhysicalScaling(NAN));
+  cout << "Scaling limits:      " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+  is_ok = is_ok && CheckEDF(reader, edfslices, 0, "EDF after rejects:   ");
+
+  reader.Close();
+
+
+  // BDF, read from a stream.
+
+  {
+    ifstream bdffile;
+    long mismatches;
+
+    bdffile.open(EDFTEST_BDFNAME, ios::in | ios::binary);
+
+    this_ok = reader.AttachStream(bdffile);
+    this_ok = this_ok && reader.IsBDF()
+      && (EDFTEST_BDFCHANS == reader.GetChanCount())
+      && (EDFTEST_BDFRECORDS == reader.GetRecordCount());
+
+    mismatches = 0;
+    sampidx = 0;
+    do
+    {
+      count = reader.ReadNextSlices<int32_t, EDFTEST_BDFCHANS>(
+        EDFTEST_BATCH - 1, bdfslices );
+
+      for (bidx = 0; bidx < count; bidx++)
+      {
+        for (cidx = 0; cidx < EDFTEST_BDFCHANS; cidx++)
+          if (MakeBDFSample(sampidx, cidx) != bdfslices[bidx].data[0][cidx])
+            mismatches++;
+        sampidx++;
+      }
+    }
+    while (0 < count);
+
+    this_ok = this_ok && (0 == mismatches)
+      && (EDFTEST_BDFRECORDS * EDFTEST_BDFRATE == sampidx)
+      && (reader.GetFrameCount() == reader.GetPosition());
+
+    reader.Close();
+  }
+
+  cout << "BDF data:            " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  // Malformed input.
+
+  {
+    istringstream badstream("0       this is not an EDF header");
+
+    this_ok = !reader.AttachStream(badstream);
+    this_ok = this_ok && (!reader.IsOpen());
+  }
+
+  cout << "Malformed header:    " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  // A read that fails partway through a record. Reading from the start
+  // again has to seek, rather than carry on from wherever the failed read
+  // left the stream.
+
+  {
+    ifstream edffile;
+    ostringstream filetext;
+    size_t recordbytes, headerbytes;
+
+    edffile.open(EDFTEST_EDFNAME, ios::in | ios::binary);
+    filetext << edffile.rdbuf();
+
+    recordbytes = ( EDFTEST_EDFCHANS * EDFTEST_EDFRATE + EDFTEST_EDFSLOW
+      + EDFTEST_EDFANNOT ) * 2;
+    headerbytes = filetext.str().size() - EDFTEST_EDFRECORDS * recordbytes;
+
+    test_flakybuf_t flakybuf(filetext.str());
+    istream flakystream(&flakybuf);
+
+    this_ok = reader.AttachStream(flakystream);
+    reader.SetBlockBytes(1);
+
+    // This stops at the failed read.
+    flakybuf.fail_at = (streamsize) (headerbytes + 5 * recordbytes / 2);
+    sampidx = 0;
+    do
+    {
+      count = reader.ReadNextSlices<int32_t, EDFTEST_EDFCHANS>(
+        EDFTEST_BATCH, edfslices );
+      sampidx += count;
+    }
+    while (EDFTEST_BATCH == count);
+    this_ok = this_ok && (2 * EDFTEST_EDFRATE == sampidx);
+
+    reader.Rewind();
+    count = reader.ReadNextSlices<int32_t, EDFTEST_EDFCHANS>(
+      EDFTEST_BATCH, edfslices );
+    this_ok = this_ok && (EDFTEST_BATCH == count);
+
+    for (bidx = 0; this_ok && (bidx < count); bidx++)
+      for (cidx = 0; cidx < EDFTEST_EDFCHANS; cidx++)
+        if (MakeEDFSample(bidx, cidx) != edfslices[bidx].data[0][cidx])
+          this_ok = false;
+
+    reader.SetBlockBytes(NLOOP_EDF_BLOCK_BYTES);
+    reader.Close();
+  }
+
+  cout << "Failed block read:   " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  delete[] edfslices;
+  delete[] bdfslices;
+
+  cout << "EDF/BDF test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of EDF/BDF test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
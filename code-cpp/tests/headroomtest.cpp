@@ -0,0 +1,345 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Fixed-point headroom analysis.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <math.h>
+
+
+//
+// Constants
+
+// Filter bank geometry.
+#define HEADTEST_BANKS 2
+#define HEADTEST_STAGES 2
+#define HEADTEST_FIRTAPS 16
+
+// Input range, as passed to the auto-ranger.
+#define HEADTEST_INMIN -12000
+#define HEADTEST_INMAX 12000
+
+// Length of the worst-case and random input runs.
+#define HEADTEST_SAMPLES 4000
+
+// Resonator parameters (pole radius and angle) and coefficient precision.
+#define HEADTEST_RADIUS 0.95
+#define HEADTEST_OMEGA 0.3
+#define HEADTEST_RESBITS 14
+
+#define HEADTEST_SEED 12345
+
+
+//
+// Types
+
+typedef nloop_IIRFilterBank_t<int64_t, int, HEADTEST_STAGES,
+  HEADTEST_BANKS, 1> test_iir_t;
+typedef nloop_FIRFilterBank_t<int64_t, int, HEADTEST_FIRTAPS,
+  HEADTEST_FIRTAPS, 1, 1> test_fir_t;
+
+
+//
+// Helper Functions
+
+
+// This configures the IIR bank. Bank 0 is two gentle first-order
+// low-pass stages (unity DC gain, 8 fractional bits). Bank 1 is a
+// resonator followed by a pass-through stage. The resonator's worst-case
+// gain is much larger than its peak frequency-response gain.
+
+void ConfigureIIR(test_iir_t &bank)
+{
+  long long den1, den2, num0;
+  int sidx;
+
+  bank.BlankCoefficients();
+  bank.SetActiveBanks(HEADTEST_BANKS);
+  bank.SetActiveChans(1);
+  bank.SetActiveStages(HEADTEST_STAGES);
+
+  for (sidx = 0; sidx < HEADTEST_STAGES; sidx++)
+    bank.SetCoefficients(sidx, 0, 8, -128, 0, 64, 64, 0);
+
+  den1 = llround( -2.0 * HEADTEST_RADIUS * cos(HEADTEST_OMEGA)
+    * (1 << HEADTEST_RESBITS) );
+  den2 = llround( HEADTEST_RADIUS * HEADTEST_RADIUS
+    * (1 << HEADTEST_RESBITS) );
+  num0 = llround( (1.0 - HEADTEST_RADIUS) * (1 << HEADTEST_RESBITS) );
+
+  bank.SetCoefficients(0, 1, HEADTEST_RESBITS, den1, den2, num0, 0, -num0);
+  bank.SetCoefficients(1, 1, 0, 0, 0, 1, 0, 0);
+}
+
+
+
+// This configures the FIR bank as a 16-tap boxcar (8 fractional bits).
+
+void ConfigureFIR(test_fir_t &bank)
+{
+  int tidx;
+
+  bank.SetActiveBanks(1);
+  bank.SetActiveChans(1);
+  bank.BlankAllInputBuffers();
+
+  bank.SetOneGeometry(0, 8, HEADTEST_FIRTAPS);
+  for (tidx = 0; tidx < HEADTEST_FIRTAPS; tidx++)
+    bank.SetOneCoefficient(0, tidx, 256 / HEADTEST_FIRTAPS);
+}
+
+
+
+// This computes the first "count" samples of the impulse response of one
+// bank of the IIR bank, in floating point.
+
+void GetImpulseResponse(test_iir_t &bank, int banknum, int count,
+  vector<double> &response)
+{
+  vector<double> in1, in2, out1, out2;
+  double thisin, thisout, scale;
+  uint8_t bits;
+  int64_t den1, den2, num0, num1, num2;
+  int sampidx, sidx;
+
+  in1.assign(HEADTEST_STAGES, 0.0);
+  in2.assign(HEADTEST_STAGES, 0.0);
+  out1.assign(HEADTEST_STAGES, 0.0);
+  out2.assign(HEADTEST_STAGES, 0.0);
+
+  bits = 0;
+  den1 = 0;
+  den2 = 0;
+  num0 = 0;
+  num1 = 0;
+  num2 = 0;
+
+  response.clear();
+
+  for (sampidx = 0; sampidx < count; sampidx++)
+  {
+    thisin = (0 == sampidx) ? 1.0 : 0.0;
+
+    for (sidx = 0; sidx < HEADTEST_STAGES; sidx++)
+    {
+      bank.GetCoefficients(sidx, banknum, bits, den1, den2,
+        num0, num1, num2);
+      scale = ldexp(1.0, - ((int) bits));
+
+      thisout = scale * ( num0 * thisin + num1 * in1[sidx]
+        + num2 * in2[sidx] - den1 * out1[sidx] - den2 * out2[sidx] );
+
+      in2[sidx] = in1[sidx];
+      in1[sidx] = thisin;
+      out2[sidx] = out1[sidx];
+      out1[sidx] = thisout;
+
+      thisin = thisout;
+    }
+
+    response.push_back(thisout);
+  }
+}
+
+
+
+// This runs one input sequence through the IIR bank, and returns the
+// largest and smallest output values for one bank.
+
+void RunIIR(test_iir_t &bank, int banknum, vector<int64_t> &input,
+  int64_t &outmin, int64_t &outmax)
+{
+  nloop_SampleSlice_t<int64_t, 1, 1> indata;
+  nloop_SampleSlice_t<int64_t, HEADTEST_BANKS, 1> outdata;
+  bool copy_input[HEADTEST_STAGES];
+  size_t sidx;
+
+  // Settle buffers to zero.
+  for (sidx = 0; sidx < HEADTEST_STAGES; sidx++)
+    copy_input[sidx] = false;
+  indata.data[0][0] = 0;
+  bank.FastSettleBuffers(indata, copy_input);
+
+  outmin = 0;
+  outmax = 0;
+
+  for (sidx = 0; sidx < input.size(); sidx++)
+  {
+    indata.data[0][0] = input[sidx];
+    bank.ApplyBankOnce(indata, outdata);
+
+    outmin = min(outmin, outdata.data[banknum][0]);
+    outmax = max(outmax, outdata.data[banknum][0]);
+  }
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_iir_t iirbank;
+  test_fir_t firbank;
+  vector<nloop_HeadroomStage_t> lowpass, resonator, unstable;
+  vector<uint8_t> ubits;
+  vector<long long> uden1, uden2, unum0, unum1, unum2;
+  nloop_HeadroomStage_t boxcar;
+  vector<double> response;
+  vector<int64_t> input;
+  int64_t outmin, outmax;
+  int sampbits, accumbits, maxden0, sidx;
+  bool is_ok, is_unstable_ok;
+
+  // Starting banner.
+  cout << "\n== Headroom analysis test.\n\n";
+
+  is_ok = true;
+
+  ConfigureIIR(iirbank);
+  ConfigureFIR(firbank);
+
+
+  // Low-pass stages. Samples stay within 16 bits but products don't.
+
+  is_ok = is_ok && nloop_HeadroomBiquadBank<int64_t>(iirbank, 0,
+    HEADTEST_INMIN, HEADTEST_INMAX, lowpass);
+
+  sampbits = nloop_HeadroomPickSampleBits(HEADTEST_INMIN, HEADTEST_INMAX,
+    lowpass, NLOOP_HEADROOM_DEFAULT_MARGIN_BITS);
+  accumbits = nloop_HeadroomPickAccumBits(lowpass,
+    NLOOP_HEADROOM_DEFAULT_MARGIN_BITS);
+  maxden0 = nloop_HeadroomMaxDen0Bits(lowpass[0], sampbits, accumbits,
+    NLOOP_HEADROOM_DEFAULT_MARGIN_BITS);
+
+  cout << "Low-pass: samples " << nloop_HeadroomTypeName(sampbits)
+    << ", accumulator " << nloop_HeadroomTypeName(accumbits)
+    << ", largest den0_bits " << maxden0 << ".\n";
+
+  // These match the types that the wide accumulator test verifies.
+  if ((16 != sampbits) || (32 != accumbits) || (maxden0 < 8))
+  {
+    cout << "Wrong types for low-pass stages.\n";
+    is_ok = false;
+  }
+
+
+  // Resonator. Drive it with the input that maximizes the final output,
+  // and with random full-scale input, and check against the bounds.
+
+  is_ok = is_ok && nloop_HeadroomBiquadBank<int64_t>(iirbank, 1,
+    HEADTEST_INMIN, HEADTEST_INMAX, resonator);
+
+  GetImpulseResponse(iirbank, 1, HEADTEST_SAMPLES, response);
+
+  input.clear();
+  for (sidx = HEADTEST_SAMPLES - 1; sidx >= 0; sidx--)
+    input.push_back( (0 < response[sidx])
+      ? HEADTEST_INMAX : HEADTEST_INMIN );
+
+  RunIIR(iirbank, 1, input, outmin, outmax);
+
+  cout << "Resonator: worst case " << resonator[1].worst_min << " to "
+    << resonator[1].worst_max << ", typical peak "
+    << resonator[1].typical_peak << ".\n";
+  cout << "Resonator, worst-case input: " << outmin << " to " << outmax
+    << ".\n";
+
+  if ( (outmax > resonator[1].worst_max)
+    || (outmax < (0.99 * resonator[1].worst_max))
+    || (resonator[1].typical_peak >= resonator[1].worst_max) )
+  {
+    cout << "Worst-case bound doesn't match worst-case input.\n";
+    is_ok = false;
+  }
+
+  srand(HEADTEST_SEED);
+  input.clear();
+  for (sidx = 0; sidx < HEADTEST_SAMPLES; sidx++)
+    input.push_back( HEADTEST_INMIN
+      + (rand() % (HEADTEST_INMAX + 1 - HEADTEST_INMIN)) );
+
+  RunIIR(iirbank, 1, input, outmin, outmax);
+
+  cout << "Resonator, random input: " << outmin << " to " << outmax
+    << ".\n";
+
+  if ( (outmin < resonator[1].worst_min)
+    || (outmax > resonator[1].worst_max) )
+  {
+    cout << "Random input exceeded the worst-case bound.\n";
+    is_ok = false;
+  }
+
+
+  // Boxcar FIR. This has exact bounds.
+
+  is_ok = is_ok
+    && nloop_HeadroomFIRBank<int64_t, int>(firbank, 0, 0, 1000, boxcar);
+
+  cout << "Boxcar: worst case " << boxcar.worst_min << " to "
+    << boxcar.worst_max << ", accumulator " << boxcar.worst_accum
+    << ".\n";
+
+  if ( (-1.0 != boxcar.worst_min) || (1000.0 != boxcar.worst_max)
+    || (256000.0 != boxcar.worst_accum) || (19 != boxcar.accum_bits) )
+  {
+    cout << "Wrong bounds for boxcar filter.\n";
+    is_ok = false;
+  }
+
+
+  // A stage with poles on the unit circle has no bound.
+
+  ubits.push_back(8);
+  uden1.push_back(0);
+  uden2.push_back(256);
+  unum0.push_back(256);
+  unum1.push_back(0);
+  unum2.push_back(0);
+
+  is_unstable_ok = !nloop_HeadroomBiquadChain(HEADTEST_INMIN,
+    HEADTEST_INMAX, ubits, uden1, uden2, unum0, unum1, unum2, unstable);
+  is_unstable_ok = is_unstable_ok && (1 == unstable.size())
+    && (!unstable[0].is_stable)
+    && ( 0 == nloop_HeadroomPickSampleBits( HEADTEST_INMIN,
+      HEADTEST_INMAX, unstable, NLOOP_HEADROOM_DEFAULT_MARGIN_BITS ) );
+
+  cout << "Unstable stage "
+    << (is_unstable_ok ? "was flagged" : "was NOT flagged") << ".\n";
+
+  is_ok = is_ok && is_unstable_ok;
+
+
+  // Banks past the active count are rejected rather than analyzed.
+
+  if ( nloop_HeadroomBiquadBank<int64_t>(iirbank, HEADTEST_BANKS,
+      HEADTEST_INMIN, HEADTEST_INMAX, unstable)
+    || nloop_HeadroomBiquadBank<int64_t>(iirbank, -1,
+      HEADTEST_INMIN, HEADTEST_INMAX, unstable)
+    || nloop_HeadroomFIRBank<int64_t, int>(firbank, 1, 0, 1000, boxcar) )
+  {
+    cout << "Inactive bank was analyzed.\n";
+    is_ok = false;
+  }
+
+
+  cout << "Headroom analysis test " << (is_ok ? "passed" : "FAILED")
+    << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of headroom analysis test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,1041 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Module throughput benchmark suite.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// This times every bank-level processing module across a range of sample
+// types and geometries, and writes the results as JSON (one result per
+// line) so that runs can be compared. Usage:
+//
+//   ./modbench [output file] [work scale]
+//
+// The output file defaults to "bench.json". The work scale multiplies the
+// number of slices processed per kernel (default 1.0); smaller values give
+// faster, noisier runs.
+//
+// The IIR and FIR kernels are also run with narrow samples and a wider
+// accumulator; these have types like "int16-acc32".
+//
+// The vector kernels from the CPU dispatch layer are run at every level
+// the CPU supports; these have types like "int16-acc32-avx2".
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Default output file.
+#define MODBENCH_DEFAULT_OUTPUT "bench.json"
+
+// JSON format version. Bump this if fields change meaning.
+#define MODBENCH_FORMAT_VERSION 1
+
+// Number of bank/channel elements each kernel processes, in total. Small
+// geometries run more slices than large ones.
+#define MODBENCH_TARGET_ELEMENTS 4000000
+#define MODBENCH_MIN_SLICES 200
+
+// Untimed warm-up, as a fraction of the timed slice count.
+#define MODBENCH_WARMUP_DIVISOR 10
+
+// Number of distinct input slices cycled through. Power of two.
+#define MODBENCH_INPUT_SLICES 16
+
+// Module parameters.
+#define MODBENCH_IIR_STAGES 4
+#define MODBENCH_FIR_TAPS 32
+#define MODBENCH_LUT_ROWS 32
+#define MODBENCH_MOD_SUBCOUNT 4
+#define MODBENCH_AVG_BITS 8
+
+// Input amplitude. This fits every sample type.
+#define MODBENCH_AMPLITUDE 8000
+
+
+//
+// Types
+
+// One timed kernel.
+struct bench_result_t
+{
+  string kernel, type;
+  int banks, chans;
+  long slices;
+  double ns_per_slice, slices_per_sec, samples_per_sec;
+};
+
+
+//
+// Global Variables
+
+// Slice count multiplier, from the command line.
+double work_scale = 1.0;
+
+
+//
+// Helper Functions
+
+
+// This returns the number of slices to time for a given geometry.
+
+long GetSliceCount(int banks, int chans)
+{
+  long slicecount;
+
+  slicecount = (long) ( work_scale * MODBENCH_TARGET_ELEMENTS
+    / (banks * chans) );
+
+  if (slicecount < MODBENCH_MIN_SLICES)
+    slicecount = MODBENCH_MIN_SLICES;
+
+  return slicecount;
+}
+
+
+
+// This returns deterministic pseudorandom bits.
+
+uint32_t GetNoise(uint32_t sampidx, uint32_t chanidx)
+{
+  uint32_t noise;
+
+  noise = sampidx * 2654435761u + chanidx * 40503u;
+  noise ^= noise >> 13;
+  noise *= 1274126177u;
+  noise ^= noise >> 16;
+
+  return noise;
+}
+
+
+
+// This fills input slices with per-element tones plus noise.
+
+template <class samptype_t, int bankcount, int chancount>
+void FillSlices(nloop_SampleSlice_t<samptype_t, bankcount, chancount> *slices)
+{
+  int sidx, bidx, cidx, eidx;
+
+  for (sidx = 0; sidx < MODBENCH_INPUT_SLICES; sidx++)
+    for (bidx = 0; bidx < bankcount; bidx++)
+      for (cidx = 0; cidx < chancount; cidx++)
+      {
+        eidx = bidx * chancount + cidx;
+        slices[sidx].data[bidx][cidx] = (samptype_t) (
+          (MODBENCH_AMPLITUDE / 2)
+            * sin( 6.2832 * sidx / (5.0 + (eidx % 7)) )
+          + (int) (GetNoise(sidx, eidx) % MODBENCH_AMPLITUDE)
+          - (MODBENCH_AMPLITUDE / 2) );
+      }
+}
+
+
+
+// This records one kernel's timing.
+
+void AddResult(vector<bench_result_t> &results, const char *kernel,
+  const char *type, int banks, int chans, long slices, double seconds)
+{
+  bench_result_t thisresult;
+
+  thisresult.kernel = kernel;
+  thisresult.type = type;
+  thisresult.banks = banks;
+  thisresult.chans = chans;
+  thisresult.slices = slices;
+
+  if (seconds <= 0)
+    seconds = 1.0e-9;
+
+  thisresult.ns_per_slice = seconds * 1.0e9 / slices;
+  thisresult.slices_per_sec = slices / seconds;
+  thisresult.samples_per_sec = thisresult.slices_per_sec * banks * chans;
+
+  results.push_back(thisresult);
+
+  cout << "  " << kernel << " " << type << " " << banks << "x" << chans
+    << ": " << thisresult.ns_per_slice << " ns/slice, "
+    << (thisresult.samples_per_sec / 1.0e6) << " Msamples/sec\n";
+}
+
+
+
+// This returns seconds elapsed since "tstart".
+
+double GetElapsed(chrono::steady_clock::time_point tstart)
+{
+  return chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+}
+
+
+
+// This writes results as JSON, one result per line.
+
+bool WriteResults(string fname, vector<bench_result_t> &results)
+{
+  ofstream outfile;
+  size_t ridx;
+
+  outfile.open(fname.c_str());
+  if (!outfile.is_open())
+    return false;
+
+  outfile << "{\n"
+    << "  \"suite\": \"nloop-modbench\",\n"
+    << "  \"format_version\": " << MODBENCH_FORMAT_VERSION << ",\n"
+    << "  \"results\": [\n";
+
+  for (ridx = 0; ridx < results.size(); ridx++)
+  {
+    outfile << "    { \"id\": \"" << results[ridx].kernel << "/"
+      << results[ridx].type << "/" << results[ridx].banks << "x"
+      << results[ridx].chans << "\", "
+      << "\"kernel\": \"" << results[ridx].kernel << "\", "
+      << "\"type\": \"" << results[ridx].type << "\", "
+      << "\"banks\": " << results[ridx].banks << ", "
+      << "\"chans\": " << results[ridx].chans << ", "
+      << "\"slices\": " << results[ridx].slices << ", "
+      << "\"ns_per_slice\": " << results[ridx].ns_per_slice << ", "
+      << "\"slices_per_sec\": " << results[ridx].slices_per_sec << ", "
+      << "\"samples_per_sec\": " << results[ridx].samples_per_sec << " }"
+      << ( (ridx + 1) < results.size() ? ",\n" : "\n" );
+  }
+
+  outfile << "  ]\n}\n";
+
+  return outfile.good();
+}
+
+
+//
+// Kernels
+
+// Each of these builds and configures one module, warms it up, and times
+// it over GetSliceCount() slices.
+
+
+// Biquad IIR filter bank.
+
+template <class samptype_t, int bankcount, int chancount,
+  class accumtype_t = samptype_t>
+void BenchIIR(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_IIRFilterBank_t<samptype_t, int, MODBENCH_IIR_STAGES,
+    bankcount, chancount, accumtype_t> *bank;
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+  int bidx, stidx;
+
+  bank = new nloop_IIRFilterBank_t<samptype_t, int, MODBENCH_IIR_STAGES,
+    bankcount, chancount, accumtype_t>;
+  inslices = new nloop_SampleSlice_t<samptype_t, 1, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+
+  FillSlices(inslices);
+
+  bank->SetActiveStages(MODBENCH_IIR_STAGES);
+  bank->SetActiveBanks(bankcount);
+  bank->SetActiveChans(chancount);
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (stidx = 0; stidx < MODBENCH_IIR_STAGES; stidx++)
+      bank->SetCoefficients( stidx, bidx, 8, -128 + (bidx % 8), 0,
+        32, 32, 0 );
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+    bank->ApplyBankOnce( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    bank->ApplyBankOnce( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+  AddResult( results, "iir-bank", tname, bankcount, chancount, slicecount,
+    GetElapsed(tstart) );
+
+  delete bank;
+  delete[] inslices;
+  delete outslice;
+}
+
+
+
+// FIR filter bank.
+
+template <class samptype_t, int bankcount, int chancount,
+  class accumtype_t = samptype_t>
+void BenchFIR(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_FIRFilterBank_t<samptype_t, int, MODBENCH_FIR_TAPS,
+    MODBENCH_FIR_TAPS, bankcount, chancount, accumtype_t> *bank;
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+  int bidx, tidx;
+
+  bank = new nloop_FIRFilterBank_t<samptype_t, int, MODBENCH_FIR_TAPS,
+    MODBENCH_FIR_TAPS, bankcount, chancount, accumtype_t>;
+  inslices = new nloop_SampleSlice_t<samptype_t, 1, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+
+  FillSlices(inslices);
+
+  bank->SetActiveBanks(bankcount);
+  bank->SetActiveChans(chancount);
+  for (bidx = 0; bidx < bankcount; bidx++)
+  {
+    bank->SetOneGeometry(bidx, 8, MODBENCH_FIR_TAPS);
+    for (tidx = 0; tidx < MODBENCH_FIR_TAPS; tidx++)
+      bank->SetOneCoefficient(bidx, tidx, (samptype_t) (tidx - bidx % 5));
+  }
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+    bank->ApplyBankOnce( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    bank->ApplyBankOnce( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+  AddResult( results, "fir-bank", tname, bankcount, chancount, slicecount,
+    GetElapsed(tstart) );
+
+  delete bank;
+  delete[] inslices;
+  delete outslice;
+}
+
+
+
+// Analytic signal estimator bank (estimate and query).
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchAnalytic(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_AnalyticBank_PT_t<samptype_t, int,
+    nloop_Analytic_PTZC_t<samptype_t, int>, bankcount, chancount> *bank;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *magnitudes;
+  nloop_SampleSlice_t<int, bankcount, chancount> *periods, *rises, *falls;
+  nloop_SampleSlice_t<int, bankcount, 1> minperiods;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+  int bidx;
+
+  bank = new nloop_AnalyticBank_PT_t<samptype_t, int,
+    nloop_Analytic_PTZC_t<samptype_t, int>, bankcount, chancount>;
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  magnitudes = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  periods = new nloop_SampleSlice_t<int, bankcount, chancount>;
+  rises = new nloop_SampleSlice_t<int, bankcount, chancount>;
+  falls = new nloop_SampleSlice_t<int, bankcount, chancount>;
+
+  FillSlices(inslices);
+
+  bank->ResetState();
+  bank->SetActiveBanks(bankcount);
+  bank->SetActiveChans(chancount);
+  for (bidx = 0; bidx < bankcount; bidx++)
+    minperiods.data[bidx][0] = 3;
+  bank->SetMinPeriods(minperiods);
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+  {
+    bank->HandleSamples(inslices[sidx & (MODBENCH_INPUT_SLICES - 1)]);
+    bank->GetEstimatedAnalytic(*magnitudes, *periods, *rises, *falls);
+  }
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    bank->HandleSamples(inslices[sidx & (MODBENCH_INPUT_SLICES - 1)]);
+    bank->GetEstimatedAnalytic(*magnitudes, *periods, *rises, *falls);
+  }
+  AddResult( results, "analytic-bank", tname, bankcount, chancount,
+    slicecount, GetElapsed(tstart) );
+
+  delete bank;
+  delete[] inslices;
+  delete magnitudes;
+  delete periods;
+  delete rises;
+  delete falls;
+}
+
+
+
+// Averager bank.
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchAverager(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_AveragerBank_t<samptype_t, MODBENCH_AVG_BITS, bankcount, chancount>
+    *bank;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+
+  bank = new nloop_AveragerBank_t<samptype_t, MODBENCH_AVG_BITS,
+    bankcount, chancount>;
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+
+  FillSlices(inslices);
+
+  bank->SetActiveBanks(bankcount);
+  bank->SetActiveChans(chancount);
+  bank->SetUniformCoeffs(100);
+  bank->SetUniformAvgBits(5);
+  bank->InitAverage(inslices[0]);
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+    bank->UpdateAverage( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    bank->UpdateAverage( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+  AddResult( results, "averager-bank", tname, bankcount, chancount,
+    slicecount, GetElapsed(tstart) );
+
+  delete bank;
+  delete[] inslices;
+  delete outslice;
+}
+
+
+
+// Dual-threshold detection (two single-threshold tests and a dual test).
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchThreshold(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_ThresholdSingleBank_t<samptype_t, bankcount, chancount> *single;
+  nloop_ThresholdDualBank_t<bankcount, chancount> *dual;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *highs, *lows;
+  nloop_SampleSlice_t<bool, bankcount, chancount> *flaghigh, *flaglow;
+  nloop_SampleSlice_t<bool, bankcount, chancount> *outflags;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx, inidx;
+
+  single = new nloop_ThresholdSingleBank_t<samptype_t, bankcount, chancount>;
+  dual = new nloop_ThresholdDualBank_t<bankcount, chancount>;
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  highs = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  lows = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  flaghigh = new nloop_SampleSlice_t<bool, bankcount, chancount>;
+  flaglow = new nloop_SampleSlice_t<bool, bankcount, chancount>;
+  outflags = new nloop_SampleSlice_t<bool, bankcount, chancount>;
+
+  FillSlices(inslices);
+  highs->SetUniformValue(MODBENCH_AMPLITUDE / 4);
+  lows->SetUniformValue(0);
+  dual->ResetState();
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+  {
+    inidx = sidx & (MODBENCH_INPUT_SLICES - 1);
+    single->TestSamples(inslices[inidx], *highs, *flaghigh);
+    single->TestSamples(inslices[inidx], *lows, *flaglow);
+    dual->TestDual(*flaghigh, *flaglow, *outflags);
+  }
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    inidx = sidx & (MODBENCH_INPUT_SLICES - 1);
+    single->TestSamples(inslices[inidx], *highs, *flaghigh);
+    single->TestSamples(inslices[inidx], *lows, *flaglow);
+    dual->TestDual(*flaghigh, *flaglow, *outflags);
+  }
+  AddResult( results, "threshold", tname, bankcount, chancount,
+    slicecount, GetElapsed(tstart) );
+
+  delete single;
+  delete dual;
+  delete[] inslices;
+  delete highs;
+  delete lows;
+  delete flaghigh;
+  delete flaglow;
+  delete outflags;
+}
+
+
+
+// Per-bank lookup table.
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchLUT(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_LookupMonoStepPerBank_t<samptype_t, int, MODBENCH_LUT_ROWS,
+    bankcount, chancount> *lut;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<int, bankcount, chancount> *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+  int bidx, ridx;
+
+  lut = new nloop_LookupMonoStepPerBank_t<samptype_t, int, MODBENCH_LUT_ROWS,
+    bankcount, chancount>;
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<int, bankcount, chancount>;
+
+  FillSlices(inslices);
+
+  // Descending tables spanning the input range.
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (ridx = 0; ridx < MODBENCH_LUT_ROWS; ridx++)
+      lut->SetOneEntry( bidx, ridx, (samptype_t) ( (MODBENCH_AMPLITUDE / 2)
+        - (ridx * MODBENCH_AMPLITUDE) / MODBENCH_LUT_ROWS ), ridx );
+  lut->SetActiveBanks(bankcount);
+  lut->SetActiveChans(chancount);
+  lut->SetActiveRows(MODBENCH_LUT_ROWS);
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+    lut->LookupAll_LE( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    lut->LookupAll_LE( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+  AddResult( results, "lut-bank", tname, bankcount, chancount, slicecount,
+    GetElapsed(tstart) );
+
+  delete lut;
+  delete[] inslices;
+  delete outslice;
+}
+
+
+
+// Voting (winner identification and selection).
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchVoting(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, 1, chancount> *outslice;
+  nloop_SampleSlice_t<int, 1, chancount> *selections;
+  nloop_SampleSlice_t<bool, 1, chancount> *localflags;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx, inidx;
+
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<samptype_t, 1, chancount>;
+  selections = new nloop_SampleSlice_t<int, 1, chancount>;
+  localflags = new nloop_SampleSlice_t<bool, 1, chancount>;
+
+  FillSlices(inslices);
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+  {
+    inidx = sidx & (MODBENCH_INPUT_SLICES - 1);
+    nloop_IdentifyWinningBanks( inslices[inidx], bankcount, chancount,
+      *selections, *localflags );
+    nloop_SelectWinningBanks(inslices[inidx], *outslice, *selections);
+  }
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    inidx = sidx & (MODBENCH_INPUT_SLICES - 1);
+    nloop_IdentifyWinningBanks( inslices[inidx], bankcount, chancount,
+      *selections, *localflags );
+    nloop_SelectWinningBanks(inslices[inidx], *outslice, *selections);
+  }
+  AddResult( results, "voting", tname, bankcount, chancount, slicecount,
+    GetElapsed(tstart) );
+
+  delete[] inslices;
+  delete outslice;
+  delete selections;
+  delete localflags;
+}
+
+
+
+// Fast modulo.
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchFastModulo(const char *tname, vector<bench_result_t> &results)
+{
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *moduli, *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+  int fidx, bidx, cidx;
+
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  moduli = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  outslice = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+
+  // Inputs have to be non-negative, with small quotients.
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+    {
+      moduli->data[bidx][cidx] = (samptype_t) (20 + (bidx + cidx) % 40);
+      for (fidx = 0; fidx < MODBENCH_INPUT_SLICES; fidx++)
+        inslices[fidx].data[bidx][cidx] = (samptype_t) (
+          GetNoise(fidx, bidx * chancount + cidx)
+          % (moduli->data[bidx][cidx] * 15) );
+    }
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+    nloop_FastModulo_Bank<samptype_t, MODBENCH_MOD_SUBCOUNT,
+      bankcount, chancount>( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *moduli, *outslice );
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    nloop_FastModulo_Bank<samptype_t, MODBENCH_MOD_SUBCOUNT,
+      bankcount, chancount>( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *moduli, *outslice );
+  AddResult( results, "fast-modulo", tname, bankcount, chancount,
+    slicecount, GetElapsed(tstart) );
+
+  delete[] inslices;
+  delete moduli;
+  delete outslice;
+}
+
+
+
+// De-glitcher bank. This works on flags, so it has no sample type.
+
+template <int bankcount, int chancount>
+void BenchDeGlitcher(vector<bench_result_t> &results)
+{
+  nloop_DeGlitcherBank_t<int, bankcount, chancount> *bank;
+  nloop_SampleSlice_t<bool, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<bool, bankcount, chancount> *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx;
+  int fidx, bidx, cidx;
+
+  bank = new nloop_DeGlitcherBank_t<int, bankcount, chancount>;
+  inslices = new nloop_SampleSlice_t<bool, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<bool, bankcount, chancount>;
+
+  for (fidx = 0; fidx < MODBENCH_INPUT_SLICES; fidx++)
+    for (bidx = 0; bidx < bankcount; bidx++)
+      for (cidx = 0; cidx < chancount; cidx++)
+        inslices[fidx].data[bidx][cidx] =
+          ( 0 == (GetNoise(fidx, bidx * chancount + cidx) & 4) );
+
+  bank->SetUniformDelays(3, 10);
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+    bank->ProcessSample( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    bank->ProcessSample( inslices[sidx & (MODBENCH_INPUT_SLICES - 1)],
+      *outslice );
+  AddResult( results, "deglitcher-bank", "bool", bankcount, chancount,
+    slicecount, GetElapsed(tstart) );
+
+  delete bank;
+  delete[] inslices;
+  delete outslice;
+}
+
+
+
+// Trigger bank. This works on indices and flags, so it has no sample type.
+
+template <int bankcount, int chancount>
+void BenchTrigger(vector<bench_result_t> &results)
+{
+  nloop_TriggerBank_t<int, bankcount, chancount> *bank;
+  nloop_SampleSlice_t<int, bankcount, chancount> *rises;
+  nloop_SampleSlice_t<bool, bankcount, chancount> *detects;
+  nloop_SampleSlice_t<int, bankcount, chancount> *targets, *periods;
+  nloop_SampleSlice_t<bool, bankcount, chancount> *enableflags, *outslice;
+  chrono::steady_clock::time_point tstart;
+  long slicecount, sidx, inidx;
+  int fidx, bidx, cidx;
+
+  bank = new nloop_TriggerBank_t<int, bankcount, chancount>;
+  rises = new nloop_SampleSlice_t<int, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  detects = new nloop_SampleSlice_t<bool, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  targets = new nloop_SampleSlice_t<int, bankcount, chancount>;
+  periods = new nloop_SampleSlice_t<int, bankcount, chancount>;
+  enableflags = new nloop_SampleSlice_t<bool, bankcount, chancount>;
+  outslice = new nloop_SampleSlice_t<bool, bankcount, chancount>;
+
+  // Phase counters wrap every 16 samples; detection is on most of the
+  // time.
+  for (fidx = 0; fidx < MODBENCH_INPUT_SLICES; fidx++)
+    for (bidx = 0; bidx < bankcount; bidx++)
+      for (cidx = 0; cidx < chancount; cidx++)
+      {
+        rises[fidx].data[bidx][cidx] = (fidx + bidx + cidx) % 16;
+        detects[fidx].data[bidx][cidx] =
+          ( 0 != (GetNoise(fidx, bidx * chancount + cidx) & 3) );
+      }
+
+  targets->SetUniformValue(5);
+  periods->SetUniformValue(16);
+  enableflags->SetUniformValue(true);
+
+  bank->SetActiveBanks(bankcount);
+  bank->SetActiveChans(chancount);
+  bank->SetEnableFlags(*enableflags);
+  bank->SetAllReRaises(true);
+  bank->EnableTriggering(0x7fffffff, 0x7fffffff);
+
+  slicecount = GetSliceCount(bankcount, chancount);
+
+  for (sidx = 0; sidx < (slicecount / MODBENCH_WARMUP_DIVISOR); sidx++)
+  {
+    inidx = sidx & (MODBENCH_INPUT_SLICES - 1);
+    bank->ProcessSamples( rises[inidx], *targets, *periods, detects[inidx],
+      *outslice );
+  }
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    inidx = sidx & (MODBENCH_INPUT_SLICES - 1);
+    bank->ProcessSamples( rises[inidx], *targets, *periods, detects[inidx],
+      *outslice );
+  }
+  AddResult( results, "trigger-bank", "int", bankcount, chancount,
+    slicecount, GetElapsed(tstart) );
+
+  delete bank;
+  delete[] rises;
+  delete[] detects;
+  delete targets;
+  delete periods;
+  delete enableflags;
+  delete outslice;
+}
+
+
+
+// Vector kernels from the CPU dispatch layer, at one level. Data is in
+// flat bank-major arrays, as the kernels expect. The level name is
+// appended to the type name.
+
+template <class samptype_t, int bankcount, int chancount,
+  class accumtype_t>
+void BenchDispatchLevel(const char *tname, int level,
+  vector<bench_result_t> &results)
+{
+  nloop_DispatchKernels_t<samptype_t, accumtype_t> kernels;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *inslices;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *outslice;
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> *sums, *avgcoeffs;
+  nloop_SampleSlice_t<uint8_t, bankcount, chancount> *avgbits;
+  nloop_SampleSlice_t<int, 1, chancount> *selections;
+  samptype_t *history, *firbufs, *indata, *outdata;
+  samptype_t iircoeffs[5], fircoeffs[MODBENCH_FIR_TAPS];
+  samptype_t lutkeys[MODBENCH_LUT_ROWS];
+  samptype_t maxvals[chancount];
+  chrono::steady_clock::time_point tstart;
+  string thistype;
+  long slicecount, sidx;
+  int bidx, stidx, cidx, tidx, histstride;
+
+  nloop_GetDispatchKernelsForLevel(kernels, level);
+  thistype = string(tname) + "-" + nloop_CPULevelName(kernels.level);
+
+  inslices = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>
+    [MODBENCH_INPUT_SLICES];
+  outslice = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  sums = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  avgcoeffs = new nloop_SampleSlice_t<samptype_t, bankcount, chancount>;
+  avgbits = new nloop_SampleSlice_t<uint8_t, bankcount, chancount>;
+  selections = new nloop_SampleSlice_t<int, 1, chancount>;
+
+  // Biquad history: four planes of "chancount" per stage per bank.
+  histstride = 4 * chancount;
+  history = new samptype_t[bankcount * MODBENCH_IIR_STAGES * histstride];
+  firbufs = new samptype_t[chancount * MODBENCH_FIR_TAPS];
+
+  FillSlices(inslices);
+
+  for (tidx = 0; tidx < (bankcount * MODBENCH_IIR_STAGES * histstride);
+    tidx++)
+    history[tidx] = 0;
+  for (tidx = 0; tidx < (chancount * MODBENCH_FIR_TAPS); tidx++)
+    firbufs[tidx] = inslices[tidx % MODBENCH_INPUT_SLICES].data[0][
+      tidx % chancount ];
+
+  // Same coefficients as the bank benchmarks.
+  iircoeffs[0] = -128;
+  iircoeffs[1] = 0;
+  iircoeffs[2] = 32;
+  iircoeffs[3] = 32;
+  iircoeffs[4] = 0;
+  for (tidx = 0; tidx < MODBENCH_FIR_TAPS; tidx++)
+    fircoeffs[tidx] = (samptype_t) tidx;
+  for (tidx = 0; tidx < MODBENCH_LUT_ROWS; tidx++)
+    lutkeys[tidx] = (samptype_t) ( (MODBENCH_AMPLITUDE / 2)
+      - (tidx * MODBENCH_AMPLITUDE) / MODBENCH_LUT_ROWS );
+
+  avgcoeffs->SetUniformValue(100);
+  avgbits->SetUniformValue(5);
+  sums->SetUniformValue(0);
+
+  outdata = &(outslice->data[0][0]);
+  slicecount = GetSliceCount(bankcount, chancount);
+
+
+  // Biquad stages. Input is one channel row, as with the IIR bank.
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    indata = &(inslices[sidx & (MODBENCH_INPUT_SLICES - 1)].data[0][0]);
+
+    for (bidx = 0; bidx < bankcount; bidx++)
+      for (stidx = 0; stidx < MODBENCH_IIR_STAGES; stidx++)
+        (*kernels.BiquadStage)( (0 == stidx) ? indata
+          : &(outslice->data[bidx][0]), &(outslice->data[bidx][0]),
+          history + (bidx * MODBENCH_IIR_STAGES + stidx) * histstride,
+          chancount, iircoeffs, 8, chancount );
+  }
+  AddResult( results, "dispatch-biquad", thistype.c_str(), bankcount,
+    chancount, slicecount, GetElapsed(tstart) );
+
+
+  // FIR dot products, one per bank and channel.
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    // Change one tap per slice, so that results aren't loop-invariant.
+    firbufs[sidx % (chancount * MODBENCH_FIR_TAPS)] = (samptype_t) sidx;
+
+    for (bidx = 0; bidx < bankcount; bidx++)
+      for (cidx = 0; cidx < chancount; cidx++)
+        outslice->data[bidx][cidx] = (samptype_t) (*kernels.DotProduct)(
+          firbufs + cidx * MODBENCH_FIR_TAPS, fircoeffs,
+          MODBENCH_FIR_TAPS );
+  }
+  AddResult( results, "dispatch-fir", thistype.c_str(), bankcount,
+    chancount, slicecount, GetElapsed(tstart) );
+
+
+  // Averagers.
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    (*kernels.Average)(
+      &(inslices[sidx & (MODBENCH_INPUT_SLICES - 1)].data[0][0]),
+      &(outslice->data[0][0]), &(sums->data[0][0]),
+      &(avgcoeffs->data[0][0]), &(avgbits->data[0][0]),
+      MODBENCH_AVG_BITS, bankcount * chancount );
+  AddResult( results, "dispatch-averager", thistype.c_str(), bankcount,
+    chancount, slicecount, GetElapsed(tstart) );
+
+
+  // Winner-take-all.
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+    (*kernels.ArgMax)(
+      &(inslices[sidx & (MODBENCH_INPUT_SLICES - 1)].data[0][0]),
+      chancount, bankcount, chancount, &(selections->data[0][0]),
+      maxvals );
+  AddResult( results, "dispatch-argmax", thistype.c_str(), bankcount,
+    chancount, slicecount, GetElapsed(tstart) );
+
+
+  // Lookup table search, one per bank and channel.
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < slicecount; sidx++)
+  {
+    indata = &(inslices[sidx & (MODBENCH_INPUT_SLICES - 1)].data[0][0]);
+
+    for (cidx = 0; cidx < (bankcount * chancount); cidx++)
+      outdata[cidx] = (samptype_t)
+        (*kernels.LookupIndexLE)(lutkeys, MODBENCH_LUT_ROWS, indata[cidx]);
+  }
+  AddResult( results, "dispatch-lut", thistype.c_str(), bankcount,
+    chancount, slicecount, GetElapsed(tstart) );
+
+
+  delete[] inslices;
+  delete outslice;
+  delete sums;
+  delete avgcoeffs;
+  delete avgbits;
+  delete selections;
+  delete[] history;
+  delete[] firbufs;
+}
+
+
+
+// This runs the dispatch kernels at every level the CPU supports, at two
+// geometries.
+
+template <class samptype_t, class accumtype_t>
+void BenchDispatch(const char *tname, vector<bench_result_t> &results)
+{
+  int level;
+
+  for (level = NLOOP_CPU_SCALAR; level <= nloop_CPUDetectLevel(); level++)
+  {
+    BenchDispatchLevel<samptype_t, 4, 64, accumtype_t>(tname, level,
+      results);
+    BenchDispatchLevel<samptype_t, 32, 1024, accumtype_t>(tname, level,
+      results);
+  }
+}
+
+
+
+// This runs every sample-typed kernel at one geometry.
+
+template <class samptype_t, int bankcount, int chancount>
+void BenchTypedKernels(const char *tname, vector<bench_result_t> &results)
+{
+  BenchIIR<samptype_t, bankcount, chancount>(tname, results);
+  BenchFIR<samptype_t, bankcount, chancount>(tname, results);
+  BenchAnalytic<samptype_t, bankcount, chancount>(tname, results);
+  BenchAverager<samptype_t, bankcount, chancount>(tname, results);
+  BenchThreshold<samptype_t, bankcount, chancount>(tname, results);
+  BenchLUT<samptype_t, bankcount, chancount>(tname, results);
+  BenchVoting<samptype_t, bankcount, chancount>(tname, results);
+  BenchFastModulo<samptype_t, bankcount, chancount>(tname, results);
+}
+
+
+
+// This runs every sample-typed kernel at every geometry.
+
+template <class samptype_t>
+void BenchTypedGeometries(const char *tname, vector<bench_result_t> &results)
+{
+  BenchTypedKernels<samptype_t, 1, 16>(tname, results);
+  BenchTypedKernels<samptype_t, 4, 64>(tname, results);
+  BenchTypedKernels<samptype_t, 8, 256>(tname, results);
+  BenchTypedKernels<samptype_t, 32, 1024>(tname, results);
+}
+
+
+// This runs the filter kernels with narrow samples and a wider
+// accumulator, at every geometry.
+
+template <class samptype_t, class accumtype_t>
+void BenchWideAccum(const char *tname, vector<bench_result_t> &results)
+{
+  BenchIIR<samptype_t, 1, 16, accumtype_t>(tname, results);
+  BenchFIR<samptype_t, 1, 16, accumtype_t>(tname, results);
+  BenchIIR<samptype_t, 4, 64, accumtype_t>(tname, results);
+  BenchFIR<samptype_t, 4, 64, accumtype_t>(tname, results);
+  BenchIIR<samptype_t, 8, 256, accumtype_t>(tname, results);
+  BenchFIR<samptype_t, 8, 256, accumtype_t>(tname, results);
+  BenchIIR<samptype_t, 32, 1024, accumtype_t>(tname, results);
+  BenchFIR<samptype_t, 32, 1024, accumtype_t>(tname, results);
+}
+
+
+//
+// Main Program
+
+
+int main(int argc, char **argv)
+{
+  vector<bench_result_t> results;
+  string outname;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Module benchmark suite.\n\n";
+
+  outname = MODBENCH_DEFAULT_OUTPUT;
+  if (argc > 1)
+    outname = argv[1];
+  if (argc > 2)
+    work_scale = atof(argv[2]);
+  if (!(work_scale > 0))
+    work_scale = 1.0;
+
+  BenchTypedGeometries<int16_t>("int16", results);
+  BenchTypedGeometries<int32_t>("int32", results);
+  BenchTypedGeometries<int64_t>("int64", results);
+
+  BenchWideAccum<int16_t, int32_t>("int16-acc32", results);
+  BenchWideAccum<int32_t, int64_t>("int32-acc64", results);
+
+  BenchDispatch<int16_t, int32_t>("int16-acc32", results);
+  BenchDispatch<int32_t, int64_t>("int32-acc64", results);
+
+  BenchDeGlitcher<1, 16>(results);
+  BenchDeGlitcher<4, 64>(results);
+  BenchDeGlitcher<8, 256>(results);
+  BenchDeGlitcher<32, 1024>(results);
+
+  BenchTrigger<1, 16>(results);
+  BenchTrigger<4, 64>(results);
+  BenchTrigger<8, 256>(results);
+  BenchTrigger<32, 1024>(results);
+
+  is_ok = WriteResults(outname, results);
+
+  cout << "Wrote " << results.size() << " results to \"" << outname
+    << "\": " << (is_ok ? "ok" : "FAILED") << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of module benchmark suite.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
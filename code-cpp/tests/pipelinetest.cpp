@@ -0,0 +1,325 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Compile-time detection pipeline.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Samples processed.
+#define PIPETEST_SAMPLES 20000
+#define PIPETEST_BLOCKSIZE 64
+
+// Test geometry.
+#define PIPETEST_BANKS 4
+#define PIPETEST_CHANS 8
+#define PIPETEST_STAGES 3
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, PIPETEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<int32_t, PIPETEST_BANKS, PIPETEST_CHANS>
+  test_sampslice_t;
+typedef nloop_SampleSlice_t<int, PIPETEST_BANKS, PIPETEST_CHANS>
+  test_indexslice_t;
+typedef nloop_SampleSlice_t<bool, PIPETEST_BANKS, PIPETEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  PIPETEST_STAGES, PIPETEST_BANKS, PIPETEST_CHANS> test_filtbank_t;
+
+typedef nloop_DetectionPipeline_t<int32_t, int, test_filtbank_t,
+  nloop_Analytic_PTZC_t<int32_t, int>, 8, PIPETEST_BANKS, PIPETEST_CHANS>
+  test_pipeline_t;
+
+
+// The same chain of modules, wired by hand.
+
+struct test_handwired_t
+{
+  nloop_AutoRanger_t<int32_t, int, PIPETEST_CHANS> ranger;
+  test_filtbank_t biquads;
+  nloop_AnalyticBank_PT_t<int32_t, int, nloop_Analytic_PTZC_t<int32_t, int>,
+    PIPETEST_BANKS, PIPETEST_CHANS> analytic;
+  nloop_AveragerBank_t<int32_t, 8, PIPETEST_BANKS, PIPETEST_CHANS>
+    averagers;
+  nloop_ThresholdSingleBank_t<int32_t, PIPETEST_BANKS, PIPETEST_CHANS>
+    threshsingle;
+  nloop_ThresholdDualBank_t<PIPETEST_BANKS, PIPETEST_CHANS> threshdual;
+  nloop_DeGlitcherBank_t<int, PIPETEST_BANKS, PIPETEST_CHANS> deglitch;
+  nloop_TriggerBank_t<int, PIPETEST_BANKS, PIPETEST_CHANS> triggers;
+
+  test_sampslice_t thresh_high, thresh_low;
+  test_indexslice_t targets;
+
+  test_inslice_t ranged;
+  test_sampslice_t filtered, magnitudes, averages;
+  test_indexslice_t periods, since_rise, since_fall;
+  test_flagslice_t flag_high, flag_low, detected, cleaned;
+};
+
+
+//
+// Helper Functions
+
+
+// These configure both versions of the pipeline the same way.
+
+void ConfigureHandWired(test_handwired_t &pipe)
+{
+  ConfigureTestRanger(pipe.ranger);
+  ConfigureTestBiquads(pipe.biquads, PIPETEST_BANKS, PIPETEST_STAGES);
+  ConfigureTestAnalytic(pipe.analytic);
+  ConfigureTestAverager(pipe.averagers);
+  pipe.deglitch.SetUniformDelays(TEST_DEGLITCH_RISE, TEST_DEGLITCH_FALL);
+  ConfigureTestTriggers(pipe.triggers, PIPETEST_SAMPLES, 1000000);
+
+  pipe.biquads.SetActiveBanks(PIPETEST_BANKS);
+  pipe.biquads.SetActiveChans(PIPETEST_CHANS);
+  pipe.triggers.SetActiveBanks(PIPETEST_BANKS);
+  pipe.triggers.SetActiveChans(PIPETEST_CHANS);
+
+  pipe.thresh_high.SetUniformValue(TEST_THRESH_HIGH);
+  pipe.thresh_low.SetUniformValue(TEST_THRESH_LOW);
+  pipe.threshdual.ResetState();
+  pipe.targets.SetUniformValue(TEST_TARGET_DELAY);
+}
+
+
+
+void ConfigurePipeline(test_pipeline_t &pipe)
+{
+  ConfigureTestDetection(pipe, PIPETEST_BANKS, PIPETEST_STAGES);
+  ConfigureTestTriggers(pipe.GetTriggers(), PIPETEST_SAMPLES, 1000000);
+
+  pipe.SetActiveGeometry(PIPETEST_BANKS, PIPETEST_CHANS);
+  pipe.SetUniformThresholds(TEST_THRESH_HIGH, TEST_THRESH_LOW);
+  pipe.SetUniformTargets(TEST_TARGET_DELAY);
+}
+
+
+
+// This runs one sample through the hand-wired pipeline.
+
+void StepHandWired(test_handwired_t &pipe, test_inslice_t &indata,
+  test_flagslice_t &trigout)
+{
+  pipe.ranger.UpdateFromSample(indata);
+  pipe.ranger.GetLatchedOutput(indata, pipe.ranged);
+
+  pipe.biquads.ApplyBankOnce(pipe.ranged, pipe.filtered);
+
+  pipe.analytic.HandleSamples(pipe.filtered);
+  pipe.analytic.GetEstimatedAnalytic( pipe.magnitudes, pipe.periods,
+    pipe.since_rise, pipe.since_fall );
+
+  pipe.averagers.UpdateAverage(pipe.magnitudes, pipe.averages);
+
+  pipe.threshsingle.TestSamples( pipe.averages, pipe.thresh_high,
+    pipe.flag_high );
+  pipe.threshsingle.TestSamples( pipe.averages, pipe.thresh_low,
+    pipe.flag_low );
+  pipe.threshdual.TestDual(pipe.flag_high, pipe.flag_low, pipe.detected);
+  pipe.deglitch.ProcessSample(pipe.detected, pipe.cleaned);
+
+  pipe.triggers.ProcessSamples( pipe.since_rise, pipe.targets,
+    pipe.periods, pipe.cleaned, trigout );
+}
+
+
+
+// This returns true if two sample slices match.
+
+template <class samptype_t, int bankcount, int chancount>
+bool SlicesMatch( nloop_SampleSlice_t<samptype_t, bankcount, chancount> &first,
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> &second )
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+      if (first.data[bidx][cidx] != second.data[bidx][cidx])
+        return false;
+
+  return true;
+}
+
+
+
+// This counts the number of flags that are high.
+
+int CountFlags(test_flagslice_t &flags)
+{
+  int bidx, cidx, count;
+
+  count = 0;
+  for (bidx = 0; bidx < PIPETEST_BANKS; bidx++)
+    for (cidx = 0; cidx < PIPETEST_CHANS; cidx++)
+      if (flags.data[bidx][cidx])
+        count++;
+
+  return count;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_handwired_t *handwired;
+  test_pipeline_t *pipeline, *blocked;
+  test_inslice_t *inblock;
+  test_flagslice_t *handtrig, *pipetrig, *blocktrig;
+  nloop_StateBuffer_t statebuf;
+  vector<uint8_t> handstate, pipestate;
+  chrono::steady_clock::time_point tstart;
+  double handtime, pipetime, blocktime;
+  int sidx, bidx, mismatches, trigcount;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Compile-time detection pipeline test.\n\n";
+
+  // These are too large for the stack.
+  handwired = new test_handwired_t;
+  pipeline = new test_pipeline_t;
+  blocked = new test_pipeline_t;
+  inblock = new test_inslice_t[PIPETEST_SAMPLES];
+  handtrig = new test_flagslice_t[PIPETEST_SAMPLES];
+  pipetrig = new test_flagslice_t[PIPETEST_SAMPLES];
+  blocktrig = new test_flagslice_t[PIPETEST_SAMPLES];
+
+  ConfigureHandWired(*handwired);
+  ConfigurePipeline(*pipeline);
+  ConfigurePipeline(*blocked);
+
+  for (sidx = 0; sidx < PIPETEST_SAMPLES; sidx++)
+    MakeBurstInput(sidx, inblock[sidx]);
+
+
+  // Run the same input through the hand-wired chain, the pipeline one
+  // sample at a time, and the pipeline one block at a time.
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < PIPETEST_SAMPLES; sidx++)
+    StepHandWired(*handwired, inblock[sidx], handtrig[sidx]);
+  handtime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  tstart = chrono::steady_clock::now();
+  for (sidx = 0; sidx < PIPETEST_SAMPLES; sidx++)
+    pipeline->ProcessSlice(inblock[sidx], pipetrig[sidx]);
+  pipetime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  tstart = chrono::steady_clock::now();
+  for (bidx = 0; bidx < PIPETEST_SAMPLES; bidx += PIPETEST_BLOCKSIZE)
+    blocked->ProcessBlock( inblock + bidx, blocktrig + bidx,
+      ( (PIPETEST_SAMPLES - bidx) < PIPETEST_BLOCKSIZE ?
+        (PIPETEST_SAMPLES - bidx) : PIPETEST_BLOCKSIZE ) );
+  blocktime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  mismatches = 0;
+  trigcount = 0;
+  for (sidx = 0; sidx < PIPETEST_SAMPLES; sidx++)
+  {
+    trigcount += CountFlags(handtrig[sidx]);
+    if ( !SlicesMatch(handtrig[sidx], pipetrig[sidx])
+      || !SlicesMatch(handtrig[sidx], blocktrig[sidx]) )
+      mismatches++;
+  }
+
+  // Intermediate outputs from the last sample should match too.
+  is_ok = SlicesMatch(handwired->filtered, pipeline->GetFiltered())
+    && SlicesMatch(handwired->magnitudes, pipeline->GetMagnitudes())
+    && SlicesMatch(handwired->averages, pipeline->GetAverages())
+    && SlicesMatch(handwired->periods, pipeline->GetPeriods())
+    && SlicesMatch(handwired->cleaned, pipeline->GetBurstFlags())
+    && SlicesMatch(handwired->averages, blocked->GetAverages());
+
+  cout << "Processed " << PIPETEST_SAMPLES << " samples: "
+    << mismatches << " mismatched trigger samples, "
+    << trigcount << " trigger samples.\n";
+  cout << "Hand-wired: " << (handtime * 1.0e9 / PIPETEST_SAMPLES)
+    << " ns/sample;  ProcessSlice(): "
+    << (pipetime * 1.0e9 / PIPETEST_SAMPLES)
+    << " ns/sample;  ProcessBlock(): "
+    << (blocktime * 1.0e9 / PIPETEST_SAMPLES) << " ns/sample.\n";
+
+  is_ok = is_ok && (0 == mismatches) && (0 < trigcount);
+
+
+  // The pipeline's checkpoint should be byte-identical to the hand-wired
+  // chain's, saved in the same order.
+
+  statebuf.StartWrite(NULL, 0);
+  pipeline->SaveState(statebuf);
+  pipestate.resize(statebuf.GetByteCount());
+  statebuf.StartWrite(pipestate.data(), pipestate.size());
+  pipeline->SaveState(statebuf);
+  is_ok = is_ok && statebuf.IsOk();
+
+  statebuf.StartWrite(NULL, 0);
+  handwired->ranger.SaveState(statebuf);
+  handwired->biquads.SaveState(statebuf);
+  handwired->analytic.SaveState(statebuf);
+  handwired->averagers.SaveState(statebuf);
+  handwired->threshdual.SaveState(statebuf);
+  handwired->deglitch.SaveState(statebuf);
+  handwired->triggers.SaveState(statebuf);
+  handstate.resize(statebuf.GetByteCount());
+  statebuf.StartWrite(handstate.data(), handstate.size());
+  handwired->ranger.SaveState(statebuf);
+  handwired->biquads.SaveState(statebuf);
+  handwired->analytic.SaveState(statebuf);
+  handwired->averagers.SaveState(statebuf);
+  handwired->threshdual.SaveState(statebuf);
+  handwired->deglitch.SaveState(statebuf);
+  handwired->triggers.SaveState(statebuf);
+  is_ok = is_ok && statebuf.IsOk() && (handstate == pipestate);
+
+  // Restoring into the block-processed pipeline should succeed.
+  is_ok = is_ok && statebuf.StartRead(pipestate.data(), pipestate.size());
+  blocked->LoadState(statebuf);
+  is_ok = is_ok && statebuf.IsOk();
+
+  cout << "Checkpoint is " << pipestate.size() << " bytes ("
+    << ( handstate == pipestate ? "matches" : "DOESN'T MATCH" )
+    << " hand-wired).\n";
+
+
+  cout << "Pipeline test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  delete handwired;
+  delete pipeline;
+  delete blocked;
+  delete[] inblock;
+  delete[] handtrig;
+  delete[] pipetrig;
+  delete[] blocktrig;
+
+  // Ending banner.
+  cout << "\n== End of pipeline test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,195 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Per-stage cycle-count instrumentation.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - This has to be compiled with NLOOP_PROFILE defined.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <math.h>
+
+
+//
+// Constants
+
+// Samples processed.
+#define PROFTEST_SAMPLES 5000
+
+// Test geometry.
+#define PROFTEST_BANKS 4
+#define PROFTEST_CHANS 16
+#define PROFTEST_STAGES 3
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, PROFTEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<bool, PROFTEST_BANKS, PROFTEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  PROFTEST_STAGES, PROFTEST_BANKS, PROFTEST_CHANS> test_filtbank_t;
+
+typedef nloop_DetectionPipeline_t<int32_t, int, test_filtbank_t,
+  nloop_Analytic_PTZC_t<int32_t, int>, 8, PROFTEST_BANKS, PROFTEST_CHANS>
+  test_pipeline_t;
+
+
+//
+// Helper Functions
+
+
+// This checks histogram bookkeeping and percentiles against known data.
+
+bool CheckHistogram(void)
+{
+  nloop_CycleHistogram_t histogram, other;
+  uint64_t ticks, p50, p99;
+  bool is_ok;
+
+  // Empty histograms report zero.
+  is_ok = (0 == histogram.GetCount()) && (0 == histogram.GetPercentile(500));
+
+  // Small values are exact.
+  for (ticks = 0; ticks < 10; ticks++)
+    histogram.Record(ticks);
+  is_ok = is_ok && (4 == histogram.GetPercentile(500))
+    && (9 == histogram.GetPercentile(1000)) && (9 == histogram.GetMax())
+    && (45 == histogram.GetTotal());
+
+  // Larger values are accurate to one bucket (1/8 of a power of two).
+  histogram.Clear();
+  for (ticks = 1; ticks <= 100000; ticks++)
+    histogram.Record(ticks);
+
+  p50 = histogram.GetPercentile(500);
+  p99 = histogram.GetPercentile(990);
+
+  cout << "1..100000: p50 " << p50 << ", p99 " << p99 << ", max "
+    << histogram.GetMax() << ".\n";
+
+  is_ok = is_ok && (p50 >= 50000) && (p50 < 50000 + 50000 / 8)
+    && (p99 >= 99000) && (p99 <= 100000)
+    && (100000 == histogram.GetMax());
+
+  // Very long times land in the last bucket, and percentiles are capped at
+  // the maximum.
+  other.Record(((uint64_t) 1) << 40);
+  is_ok = is_ok && ((((uint64_t) 1) << 40) == other.GetPercentile(500));
+
+  histogram.MergeFrom(other);
+  is_ok = is_ok && (100001 == histogram.GetCount())
+    && ((((uint64_t) 1) << 40) == histogram.GetMax())
+    && ((((uint64_t) 1) << 40) == histogram.GetPercentile(1000));
+
+  return is_ok;
+}
+
+
+
+// This configures a pipeline with enough activity that every stage does
+// real work.
+
+void ConfigurePipeline(test_pipeline_t &pipe)
+{
+  ConfigureTestDetection(pipe, PROFTEST_BANKS, PROFTEST_STAGES);
+
+  pipe.SetUniformThresholds(TEST_THRESH_HIGH, TEST_THRESH_LOW);
+  pipe.SetActiveGeometry(PROFTEST_BANKS, PROFTEST_CHANS);
+
+  ConfigureTestTriggers(pipe.GetTriggers(), PROFTEST_SAMPLES,
+    PROFTEST_SAMPLES);
+  pipe.SetUniformTargets(TEST_TARGET_DELAY);
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_pipeline_t *pipe;
+  test_inslice_t *inblock;
+  test_flagslice_t *trigblock;
+  uint64_t count, p50, p99, maxval, expected;
+  int sidx, cidx;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Profiling test.\n\n";
+
+#ifndef NLOOP_PROFILE
+  cout << "Built without NLOOP_PROFILE.\n";
+  is_ok = false;
+#else
+
+  is_ok = CheckHistogram();
+
+  // These are too large for the stack.
+  pipe = new test_pipeline_t;
+  inblock = new test_inslice_t[PROFTEST_SAMPLES];
+  trigblock = new test_flagslice_t[PROFTEST_SAMPLES];
+
+  ConfigurePipeline(*pipe);
+
+  for (sidx = 0; sidx < PROFTEST_SAMPLES; sidx++)
+    for (cidx = 0; cidx < PROFTEST_CHANS; cidx++)
+      inblock[sidx].data[0][cidx] = (int32_t) ( 20000.0
+        * sin( 6.2832 * sidx / (20.0 + 3 * cidx) ) );
+
+
+  // Every stage the pipeline uses should be called once per sample
+  // (twice for single thresholds). Stages it doesn't use stay empty.
+
+  nloop_GetProfiler().Clear();
+  pipe->ProcessBlock(inblock, trigblock, PROFTEST_SAMPLES);
+
+  for (sidx = 0; sidx < NLOOP_PROF_STAGECOUNT; sidx++)
+  {
+    expected = PROFTEST_SAMPLES;
+    if (NLOOP_PROF_THRESHSINGLE == sidx)
+      expected = 2 * PROFTEST_SAMPLES;
+    else if ( (NLOOP_PROF_FIRBANK == sidx) || (NLOOP_PROF_LUTBANK == sidx) )
+      expected = 0;
+
+    if ( nloop_GetProfiler().GetStageSummary( sidx, count, p50, p99,
+      maxval ) )
+      cout << "  " << nloop_GetProfileStageName(sidx) << ": " << count
+        << " calls, p50 " << p50 << ", p99 " << p99 << ", max " << maxval
+        << "\n";
+
+    is_ok = is_ok && (expected == count)
+      && (p50 <= p99) && (p99 <= maxval);
+  }
+
+  // Out-of-range stages are rejected.
+  is_ok = is_ok && (NULL == nloop_GetProfiler().GetStage(-1))
+    && (NULL == nloop_GetProfiler().GetStage(NLOOP_PROF_STAGECOUNT))
+    && !nloop_GetProfiler().GetStageSummary( NLOOP_PROF_STAGECOUNT,
+      count, p50, p99, maxval );
+
+  delete pipe;
+  delete[] inblock;
+  delete[] trigblock;
+
+#endif
+
+  cout << "Profiling test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of profiling test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
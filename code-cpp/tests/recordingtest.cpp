@@ -0,0 +1,413 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Raw binary recording reader.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+
+
+//
+// Constants
+
+#define RECTEST_FILENAME "recordingtest.dat"
+
+// Open Ephys-style geometry: 32 channels of int16.
+#define RECTEST_CHANS 32
+#define RECTEST_FRAMES 200000
+
+// Slices per batch.
+#define RECTEST_BATCH 256
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int16_t, 1, RECTEST_CHANS> test_rawslice_t;
+typedef nloop_SampleSlice_t<int32_t, 1, RECTEST_CHANS> test_wideslice_t;
+typedef nloop_SampleSlice_t<int32_t, 1, 24> test_narrowslice_t;
+typedef nloop_SampleSlice_t<int32_t, 1, 40> test_paddedslice_t;
+typedef nloop_SampleSlice_t<int64_t, 1, 4> test_int64slice_t;
+typedef nloop_SampleSlice_t<int16_t, 1, 4> test_int16slice_t;
+
+
+//
+// Helper Functions
+
+
+// This generates deterministic test samples.
+
+int16_t MakeSample(long frameidx, int chanidx)
+{
+  return (int16_t) ( ((frameidx * (chanidx + 7)) % 60001) - 30000 );
+}
+
+
+
+// This writes the test recording. It returns false on I/O errors.
+
+bool WriteRecording(void)
+{
+  ofstream outfile;
+  vector<int16_t> frame;
+  long fidx;
+  int cidx;
+
+  outfile.open(RECTEST_FILENAME, ios::out | ios::binary | ios::trunc);
+  if (!outfile.is_open())
+    return false;
+
+  frame.resize(RECTEST_CHANS);
+
+  for (fidx = 0; fidx < RECTEST_FRAMES; fidx++)
+  {
+    for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+      frame[cidx] = MakeSample(fidx, cidx);
+
+    outfile.write( (const char *) frame.data(),
+      RECTEST_CHANS * sizeof(int16_t) );
+  }
+
+  outfile.close();
+
+  return !outfile.fail();
+}
+
+
+
+// This reports elapsed time and throughput.
+
+void ReportRate(const char *label,
+  chrono::steady_clock::time_point tstart,
+  chrono::steady_clock::time_point tend)
+{
+  double seconds;
+
+  seconds = chrono::duration<double>(tend - tstart).count();
+
+  cout << label << (seconds * 1000.0) << " ms ("
+    << ( ((double) RECTEST_FRAMES) * RECTEST_CHANS * sizeof(int16_t)
+      / (seconds * 1.0e6) )
+    << " MB/s).\n";
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  nloop_RawRecording_t recording;
+  const test_rawslice_t *views;
+  test_wideslice_t *wideslices;
+  test_narrowslice_t *narrowslices;
+  test_paddedslice_t *paddedslices;
+  test_rawslice_t narrowraw[2];
+  vector<int16_t> rawbuf;
+  vector<float> floatbuf;
+  vector<uint8_t> bytebuf;
+  int32_t wideval;
+  chrono::steady_clock::time_point tstart, tend;
+  size_t count, bidx;
+  long fidx, mismatches;
+  int cidx, expected;
+  bool is_ok, this_ok;
+
+  // Starting banner.
+  cout << "\n== Raw recording reader test.\n\n";
+
+  is_ok = true;
+
+  if (!WriteRecording())
+  {
+    cout << "Couldn't write \"" RECTEST_FILENAME "\".\n";
+    return 1;
+  }
+
+
+  // Geometry checks.
+
+  this_ok = recording.OpenFile(RECTEST_FILENAME, RECTEST_CHANS + 1,
+    NLOOP_RAW_INT16);
+  this_ok = (!this_ok) && recording.OpenFile(RECTEST_FILENAME,
+    RECTEST_CHANS, NLOOP_RAW_INT16);
+  this_ok = this_ok && (RECTEST_FRAMES == recording.GetFrameCount());
+  cout << "Geometry checks:     " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  // Zero-copy views.
+
+  mismatches = 0;
+  fidx = 0;
+  tstart = chrono::steady_clock::now();
+  recording.Rewind();
+  do
+  {
+    count = RECTEST_BATCH;
+    views = recording.ViewNextSlices<int16_t, RECTEST_CHANS>(count);
+
+    for (bidx = 0; (NULL != views) && (bidx < count); bidx++)
+    {
+      for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+        if (MakeSample(fidx, cidx) != views[bidx].data[0][cidx])
+          mismatches++;
+      fidx++;
+    }
+  }
+  while (0 < count);
+  tend = chrono::steady_clock::now();
+
+  this_ok = (0 == mismatches) && (RECTEST_FRAMES == fidx);
+  cout << "Zero-copy views:     " << (this_ok ? "ok" : "FAILED") << "\n";
+  ReportRate("  Time:  ", tstart, tend);
+  is_ok = is_ok && this_ok;
+
+  // Views need an exact type match.
+  count = RECTEST_BATCH;
+  this_ok = (NULL == recording.GetSliceViews<int32_t, RECTEST_CHANS>(
+    0, count ));
+  cout << "View type checking:  " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  // Converted batches.
+
+  wideslices = new test_wideslice_t[RECTEST_BATCH];
+
+  mismatches = 0;
+  fidx = 0;
+  tstart = chrono::steady_clock::now();
+  recording.Rewind();
+  do
+  {
+    count = recording.ReadNextSlices<int32_t, RECTEST_CHANS>(
+      RECTEST_BATCH, wideslices );
+
+    for (bidx = 0; bidx < count; bidx++)
+    {
+      for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+        if (MakeSample(fidx, cidx) != wideslices[bidx].data[0][cidx])
+          mismatches++;
+      fidx++;
+    }
+  }
+  while (0 < count);
+  tend = chrono::steady_clock::now();
+
+  this_ok = (0 == mismatches) && (RECTEST_FRAMES == fidx);
+  cout << "Converted batches:   " << (this_ok ? "ok" : "FAILED") << "\n";
+  ReportRate("  Time:  ", tstart, tend);
+  is_ok = is_ok && this_ok;
+
+
+  // Scaled conversion. A gain of 0.5 is exact in fixed-point.
+
+  recording.SetScaling(0.5, 10);
+
+  count = recording.ReadSlices<int32_t, RECTEST_CHANS>(
+    1000, RECTEST_BATCH, wideslices );
+
+  mismatches = 0;
+  for (bidx = 0; bidx < count; bidx++)
+    for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+    {
+      expected = MakeSample(1000 + bidx, cidx);
+      // Arithmetic shift rounds toward negative infinity.
+      expected = (expected >> 1) + 10;
+      if (expected != wideslices[bidx].data[0][cidx])
+        mismatches++;
+    }
+
+  // Scaling disables views.
+  count = RECTEST_BATCH;
+  this_ok = (0 == mismatches)
+    && (NULL == recording.GetSliceViews<int16_t, RECTEST_CHANS>(0, count));
+
+  recording.ClearScaling();
+
+  cout << "Scaled conversion:   " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+
+  // Slices narrower and wider than the file.
+
+  narrowslices = new test_narrowslice_t[RECTEST_BATCH];
+  paddedslices = new test_paddedslice_t[RECTEST_BATCH];
+
+  // Read the tail, to check trimming too.
+  count = recording.ReadSlices<int32_t, 24>(
+    RECTEST_FRAMES - 10, RECTEST_BATCH, narrowslices );
+  this_ok = (10 == count);
+  count = recording.ReadSlices<int32_t, 40>(
+    RECTEST_FRAMES - 10, RECTEST_BATCH, paddedslices );
+  this_ok = this_ok && (10 == count);
+
+  for (bidx = 0; bidx < count; bidx++)
+  {
+    fidx = RECTEST_FRAMES - 10 + bidx;
+
+    for (cidx = 0; cidx < 24; cidx++)
+      this_ok = this_ok
+        && (MakeSample(fidx, cidx) == narrowslices[bidx].data[0][cidx]);
+
+    for (cidx = 0; cidx < 40; cidx++)
+      this_ok = this_ok && ( paddedslices[bidx].data[0][cidx]
+        == ((cidx < RECTEST_CHANS) ? MakeSample(fidx, cidx) : 0) );
+  }
+
+  cout << "Channel remapping:   " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+  recording.Close();
+
+
+  // In-memory buffers with a header, and float samples.
+
+  rawbuf.resize(1 + 4 * RECTEST_CHANS);
+  for (fidx = 0; fidx < 4; fidx++)
+    for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+      rawbuf[1 + fidx * RECTEST_CHANS + cidx] = MakeSample(fidx, cidx);
+
+  this_ok = recording.AttachBuffer( rawbuf.data(),
+    rawbuf.size() * sizeof(int16_t), RECTEST_CHANS, NLOOP_RAW_INT16,
+    sizeof(int16_t) );
+  this_ok = this_ok && (4 == recording.GetFrameCount());
+  this_ok = this_ok && (4 == recording.ReadSlices<int32_t, RECTEST_CHANS>(
+    0, RECTEST_BATCH, wideslices ));
+  for (fidx = 0; fidx < 4; fidx++)
+    for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+      this_ok = this_ok
+        && (MakeSample(fidx, cidx) == wideslices[fidx].data[0][cidx]);
+
+  floatbuf.resize(3 * RECTEST_CHANS);
+  for (bidx = 0; bidx < floatbuf.size(); bidx++)
+    floatbuf[bidx] = ((float) bidx) - 0.25f;
+
+  this_ok = this_ok && recording.AttachBuffer( floatbuf.data(),
+    floatbuf.size() * sizeof(float), RECTEST_CHANS, NLOOP_RAW_FLOAT32 );
+  recording.SetScaling(1000.0, 0);
+  this_ok = this_ok && (3 == recording.ReadSlices<int32_t, RECTEST_CHANS>(
+    0, RECTEST_BATCH, wideslices ));
+  for (fidx = 0; fidx < 3; fidx++)
+    for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+      this_ok = this_ok && ( wideslices[fidx].data[0][cidx]
+        == (1000 * (fidx * RECTEST_CHANS + cidx) - 250) );
+
+  cout << "Header and float:    " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+  recording.Close();
+
+
+  // 32-bit samples behind an odd-sized header (so every sample is
+  // misaligned), read into 16-bit slices. Out-of-range values saturate,
+  // with and without scaling, and extreme gains don't overflow.
+
+  bytebuf.resize(3 + 2 * RECTEST_CHANS * sizeof(int32_t));
+  for (fidx = 0; fidx < 2; fidx++)
+    for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+    {
+      wideval = (cidx & 1) ? -100000 : MakeSample(fidx, cidx);
+      if (1 == fidx)
+        wideval = (cidx & 1) ? NLOOP_MINVAL(int32_t) : NLOOP_MAXVAL(int32_t);
+      memcpy( bytebuf.data() + 3
+        + (fidx * RECTEST_CHANS + cidx) * sizeof(int32_t),
+        &wideval, sizeof(int32_t) );
+    }
+
+  this_ok = recording.AttachBuffer( bytebuf.data(), bytebuf.size(),
+    RECTEST_CHANS, NLOOP_RAW_INT32, 3 );
+  recording.ClearScaling();
+  this_ok = this_ok && (2 == recording.ReadSlices<int16_t, RECTEST_CHANS>(
+    0, 2, narrowraw ));
+  for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+  {
+    expected = (cidx & 1) ? NLOOP_MINVAL(int16_t) : MakeSample(0, cidx);
+    this_ok = this_ok && (expected == narrowraw[0].data[0][cidx]);
+    expected = (cidx & 1) ? NLOOP_MINVAL(int16_t) : NLOOP_MAXVAL(int16_t);
+    this_ok = this_ok && (expected == narrowraw[1].data[0][cidx]);
+  }
+
+  recording.SetScaling(1.0e12, 0);
+  this_ok = this_ok && (2 == recording.ReadSlices<int16_t, RECTEST_CHANS>(
+    0, 2, narrowraw ));
+  for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+  {
+    expected = (cidx & 1) ? NLOOP_MINVAL(int16_t) : NLOOP_MAXVAL(int16_t);
+    this_ok = this_ok && (expected == narrowraw[1].data[0][cidx]);
+  }
+
+  // The offset outweighs even the most negative scaled sample.
+  recording.SetScaling(1.0e12, NLOOP_MAXVAL(int64_t));
+  this_ok = this_ok && (2 == recording.ReadSlices<int16_t, RECTEST_CHANS>(
+    0, 2, narrowraw ));
+  for (cidx = 0; cidx < RECTEST_CHANS; cidx++)
+    this_ok = this_ok
+      && (NLOOP_MAXVAL(int16_t) == narrowraw[1].data[0][cidx]);
+
+  recording.ClearScaling();
+
+  cout << "Misaligned samples:  " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+  recording.Close();
+
+
+  // Float samples that are NaN, infinite, or past the slice type's range.
+  // NaN reads as 0, and everything else saturates, including for 64-bit
+  // slices.
+
+  {
+    float specialvals[8] = { NAN, INFINITY, -INFINITY, 100.6f,
+      1.0e30f, -1.0e30f, 9.3e18f, -2.4f };
+    int64_t widevals[8] = { 0, NLOOP_MAXVAL(int64_t), NLOOP_MINVAL(int64_t),
+      101, NLOOP_MAXVAL(int64_t), NLOOP_MINVAL(int64_t),
+      NLOOP_MAXVAL(int64_t), -2 };
+    int16_t narrowvals[8] = { 0, NLOOP_MAXVAL(int16_t),
+      NLOOP_MINVAL(int16_t), 101, NLOOP_MAXVAL(int16_t),
+      NLOOP_MINVAL(int16_t), NLOOP_MAXVAL(int16_t), -2 };
+    test_int64slice_t int64slices[2];
+    test_int16slice_t int16slices[2];
+
+    this_ok = recording.AttachBuffer( specialvals, sizeof(specialvals), 4,
+      NLOOP_RAW_FLOAT32 );
+    this_ok = this_ok && (2 == recording.ReadSlices<int64_t, 4>(
+      0, 2, int64slices ));
+    this_ok = this_ok && (2 == recording.ReadSlices<int16_t, 4>(
+      0, 2, int16slices ));
+
+    for (bidx = 0; bidx < 8; bidx++)
+      this_ok = this_ok
+        && (widevals[bidx] == int64slices[bidx / 4].data[0][bidx % 4])
+        && (narrowvals[bidx] == int16slices[bidx / 4].data[0][bidx % 4]);
+  }
+
+  cout << "Special floats:      " << (this_ok ? "ok" : "FAILED") << "\n";
+  is_ok = is_ok && this_ok;
+
+  recording.Close();
+
+  delete[] wideslices;
+  delete[] narrowslices;
+  delete[] paddedslices;
+
+
+  cout << "Recording test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of recording test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
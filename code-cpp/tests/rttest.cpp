@@ -0,0 +1,208 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Real-time loop helpers.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+// NOTE - Real-time scheduling and memory locking need privileges that test
+// machines often don't have. Their results are reported but don't cause
+// the test to fail.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <math.h>
+
+
+//
+// Constants
+
+// Test geometry.
+#define RTTEST_BANKS 4
+#define RTTEST_CHANS 16
+#define RTTEST_STAGES 3
+
+// Loop timing.
+#define RTTEST_CYCLES 200
+#define RTTEST_PERIOD_NS 1000000
+#define RTTEST_DEADLINE_NS 1000000
+
+// Overrun test: one cycle sleeps this long, so at least two releases
+// should be skipped.
+#define RTTEST_OVERRUN_US 3500
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, RTTEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<bool, RTTEST_BANKS, RTTEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  RTTEST_STAGES, RTTEST_BANKS, RTTEST_CHANS> test_filtbank_t;
+
+typedef nloop_DetectionPipeline_t<int32_t, int, test_filtbank_t,
+  nloop_Analytic_PTZC_t<int32_t, int>, 8, RTTEST_BANKS, RTTEST_CHANS>
+  test_pipeline_t;
+
+
+//
+// Helper Functions
+
+
+// This returns a simple checksum of a memory range.
+
+uint64_t GetChecksum(void *buffer, size_t bytes)
+{
+  uint8_t *bytedata;
+  uint64_t result;
+  size_t bidx;
+
+  bytedata = (uint8_t *) buffer;
+  result = 0;
+
+  for (bidx = 0; bidx < bytes; bidx++)
+    result = result * 31 + bytedata[bidx];
+
+  return result;
+}
+
+
+
+// This prints a histogram summary, in microseconds.
+
+void PrintHistogram(const char *label, nloop_CycleHistogram_t &histogram)
+{
+  cout << label << ": p50 " << (histogram.GetPercentile(500) / 1000.0)
+    << " us, p99 " << (histogram.GetPercentile(990) / 1000.0)
+    << " us, max " << (histogram.GetMax() / 1000.0) << " us.\n";
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_pipeline_t *pipe;
+  test_inslice_t *inblock;
+  test_flagslice_t trigout;
+  nloop_RTStatus_t status;
+  nloop_DeadlineMonitor_t monitor;
+  uint64_t before, after;
+  int sidx, cidx;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Real-time helper test.\n\n";
+
+  is_ok = true;
+
+
+  // Thread setup. Only pinning is expected to work everywhere.
+
+  nloop_RTSetupThread(0, NLOOP_RT_DEFAULT_PRIORITY, status);
+
+  cout << "Pinned: " << (status.is_pinned ? "yes" : "no")
+    << ".  SCHED_FIFO: " << (status.is_fifo ? "yes" : "not permitted")
+    << ".  Memory locked: " << (status.is_locked ? "yes" : "not permitted")
+    << ".\n";
+
+  is_ok = is_ok && status.is_pinned;
+
+
+  // Prefaulting shouldn't change anything.
+
+  // These are too large for the stack.
+  pipe = new test_pipeline_t;
+  inblock = new test_inslice_t[RTTEST_CYCLES];
+
+  for (sidx = 0; sidx < RTTEST_CYCLES; sidx++)
+    for (cidx = 0; cidx < RTTEST_CHANS; cidx++)
+      inblock[sidx].data[0][cidx] = (int32_t) ( 20000.0
+        * sin( 6.2832 * sidx / (20.0 + 3 * cidx) ) );
+
+  pipe->SetUniformThresholds(5000, 3000);
+
+  before = GetChecksum(pipe, sizeof(test_pipeline_t))
+    ^ GetChecksum(inblock, RTTEST_CYCLES * sizeof(test_inslice_t));
+
+  nloop_RTPrefault(*pipe);
+  nloop_RTPrefaultArray(inblock, RTTEST_CYCLES);
+  nloop_RTPrefault(trigout);
+
+  after = GetChecksum(pipe, sizeof(test_pipeline_t))
+    ^ GetChecksum(inblock, RTTEST_CYCLES * sizeof(test_inslice_t));
+
+  cout << "Prefaulted " << ( sizeof(test_pipeline_t)
+    + RTTEST_CYCLES * sizeof(test_inslice_t) ) << " bytes: contents "
+    << (before == after ? "unchanged" : "CHANGED") << ".\n";
+
+  is_ok = is_ok && (before == after);
+
+
+  // Periodic loop. Timing depends on the machine, so only check that the
+  // bookkeeping is consistent.
+
+  monitor.Start(RTTEST_PERIOD_NS, RTTEST_DEADLINE_NS);
+
+  for (sidx = 0; sidx < RTTEST_CYCLES; sidx++)
+  {
+    monitor.WaitForRelease();
+    pipe->ProcessSlice(inblock[sidx], trigout);
+    monitor.EndCycle();
+  }
+
+  cout << "Ran " << monitor.GetCycleCount() << " cycles of "
+    << (RTTEST_PERIOD_NS / 1000) << " us: " << monitor.GetMissCount()
+    << " deadline misses, " << monitor.GetSkipCount()
+    << " skipped releases.\n";
+  PrintHistogram("  Release jitter", monitor.GetJitter());
+  PrintHistogram("  Response time", monitor.GetResponse());
+
+  is_ok = is_ok && (RTTEST_CYCLES == monitor.GetCycleCount())
+    && (RTTEST_CYCLES == monitor.GetJitter().GetCount())
+    && (RTTEST_CYCLES == monitor.GetResponse().GetCount())
+    && (RTTEST_CYCLES >= monitor.GetMissCount())
+    && ( monitor.GetJitter().GetMax() <= monitor.GetResponse().GetMax() );
+
+
+  // Overrun. A cycle that runs long is a miss, and the releases it spans
+  // are skipped.
+
+  monitor.Start(RTTEST_PERIOD_NS, RTTEST_DEADLINE_NS);
+
+  monitor.WaitForRelease();
+  this_thread::sleep_for(chrono::microseconds(RTTEST_OVERRUN_US));
+  monitor.EndCycle();
+
+  monitor.WaitForRelease();
+  monitor.EndCycle();
+
+  cout << "Overrun: " << monitor.GetMissCount() << " deadline misses, "
+    << monitor.GetSkipCount() << " skipped releases.\n";
+
+  is_ok = is_ok && (2 == monitor.GetCycleCount())
+    && (1 <= monitor.GetMissCount()) && (2 <= monitor.GetSkipCount());
+
+
+  delete pipe;
+  delete[] inblock;
+
+  cout << "Real-time helper test " << (is_ok ? "passed" : "FAILED")
+    << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of real-time helper test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,183 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Detection and trigger scoring.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+
+//
+// Constants
+
+// Test geometry.
+#define SCORETEST_BANKS 2
+#define SCORETEST_CHANS 2
+#define SCORETEST_SAMPLES 100
+
+// Scoring configuration.
+#define SCORETEST_LATE 5
+#define SCORETEST_TARGET 16384
+#define SCORETEST_WRAPTARGET 60000
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<bool, 1, SCORETEST_CHANS> test_truthslice_t;
+typedef nloop_SampleSlice_t<uint16_t, 1, SCORETEST_CHANS> test_phaseslice_t;
+typedef nloop_SampleSlice_t<bool, SCORETEST_BANKS, SCORETEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_DetectionScorer_t<SCORETEST_BANKS, SCORETEST_CHANS>
+  test_scorer_t;
+
+
+//
+// Helper Functions
+
+
+// This returns true if "sidx" is in the range "first" to "last" inclusive.
+
+bool InRange(int sidx, int first, int last)
+{
+  return (sidx >= first) && (sidx <= last);
+}
+
+
+
+// This runs a scripted scenario through a scorer.
+//
+// Channel 0:
+// - Burst A (10..29) is detected by bank 1 at 14 (latency 4). Bank 0
+// triggers at 13, a quarter-cycle before the target phase.
+// - Burst B (40..49) is detected late, at 52 (latency 12). Bank 0 triggers
+// at 51, which is stray.
+// - Burst C (70..79) is never detected; it's a miss.
+// - Detection at 95..97 is a false alarm.
+//
+// Channel 1:
+// - Both banks detect at 20..22; that's one false alarm. Bank 1 triggers
+// at 30, which is stray.
+// - A burst starts at 98 and isn't finished, so it isn't scored.
+
+void RunScenario(test_scorer_t &scorer)
+{
+  test_truthslice_t truth;
+  test_phaseslice_t phases;
+  test_flagslice_t detect, trigs;
+  int sidx;
+
+  for (sidx = 0; sidx < SCORETEST_SAMPLES; sidx++)
+  {
+    truth.SetUniformValue(false);
+    phases.SetUniformValue(0);
+    detect.SetUniformValue(false);
+    trigs.SetUniformValue(false);
+
+    // Channel 0.
+
+    if ( InRange(sidx, 10, 29) || InRange(sidx, 40, 49)
+      || InRange(sidx, 70, 79) )
+    {
+      truth.data[0][0] = true;
+      phases.data[0][0] = (uint16_t) (4096 * (sidx % 10));
+    }
+
+    detect.data[1][0] = InRange(sidx, 14, 31) || InRange(sidx, 52, 56)
+      || InRange(sidx, 95, 97);
+    trigs.data[0][0] = InRange(sidx, 13, 14) || InRange(sidx, 51, 52);
+
+    // Channel 1.
+
+    truth.data[0][1] = InRange(sidx, 98, 99);
+    detect.data[0][1] = InRange(sidx, 20, 22);
+    detect.data[1][1] = InRange(sidx, 20, 22);
+    trigs.data[1][1] = InRange(sidx, 30, 30);
+
+    scorer.ProcessSample(truth, phases, detect, trigs);
+  }
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_scorer_t scorer;
+  bool is_ok, this_ok;
+
+  // Starting banner.
+  cout << "\n== Detection scoring test.\n\n";
+
+
+  // Both channels.
+
+  scorer.SetTargetPhase(SCORETEST_TARGET);
+  scorer.SetLateWindow(SCORETEST_LATE);
+  RunScenario(scorer);
+
+  cout << "All channels: " << scorer.GetBurstCount() << " bursts, "
+    << scorer.GetHitCount() << " hits, " << scorer.GetMissCount()
+    << " misses, " << scorer.GetFalseAlarmCount() << " false alarms in "
+    << scorer.GetQuietSampleCount() << " quiet samples.\n";
+  cout << "  Latency total " << scorer.GetLatencies().GetTotal()
+    << ", max " << scorer.GetLatencies().GetMax() << ".  "
+    << scorer.GetTriggerCount() << " triggers, "
+    << scorer.GetStrayTriggerCount() << " stray, phase error sum "
+    << scorer.GetPhaseErrorSum() << ".\n";
+
+  this_ok = (SCORETEST_SAMPLES == scorer.GetSampleCount())
+    && (3 == scorer.GetBurstCount()) && (2 == scorer.GetHitCount())
+    && (1 == scorer.GetMissCount()) && (2 == scorer.GetFalseAlarmCount())
+    && (143 == scorer.GetQuietSampleCount())
+    && (2 == scorer.GetLatencies().GetCount())
+    && (16 == scorer.GetLatencies().GetTotal())
+    && (12 == scorer.GetLatencies().GetMax())
+    && (1 == scorer.GetTriggerCount())
+    && (2 == scorer.GetStrayTriggerCount())
+    && (-4096 == scorer.GetPhaseErrorSum())
+    && (4096 == scorer.GetPhaseErrors().GetMax());
+
+  is_ok = this_ok;
+
+
+  // One channel, with a target that makes the phase error wrap around.
+
+  scorer.SetActiveGeometry(SCORETEST_BANKS, 1);
+  scorer.SetTargetPhase(SCORETEST_WRAPTARGET);
+  scorer.ResetState();
+  RunScenario(scorer);
+
+  cout << "One channel: " << scorer.GetBurstCount() << " bursts, "
+    << scorer.GetFalseAlarmCount() << " false alarms in "
+    << scorer.GetQuietSampleCount() << " quiet samples, phase error sum "
+    << scorer.GetPhaseErrorSum() << ".\n";
+
+  this_ok = (3 == scorer.GetBurstCount())
+    && (1 == scorer.GetFalseAlarmCount())
+    && (45 == scorer.GetQuietSampleCount())
+    && (1 == scorer.GetStrayTriggerCount())
+    && (17824 == scorer.GetPhaseErrorSum());
+
+  is_ok = is_ok && this_ok;
+
+
+  cout << "Detection scoring test " << (is_ok ? "passed" : "FAILED")
+    << ".\n";
+
+  // Ending banner.
+  cout << "\n== End of detection scoring test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
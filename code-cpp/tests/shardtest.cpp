@@ -0,0 +1,232 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Channel-sharded multi-threaded pipeline runner.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Samples processed.
+#define SHARDTEST_SAMPLES 20000
+#define SHARDTEST_BLOCKSIZE 256
+
+// Test geometry.
+#define SHARDTEST_BANKS 4
+#define SHARDTEST_SHARDCHANS 16
+#define SHARDTEST_SHARDS 4
+#define SHARDTEST_CHANS (SHARDTEST_SHARDCHANS * SHARDTEST_SHARDS)
+#define SHARDTEST_STAGES 3
+
+// Pulse quota. This should run out partway through the test, so that the
+// order in which channels draw from it matters.
+#define SHARDTEST_MAXPULSES 2000
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, SHARDTEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<bool, SHARDTEST_BANKS, SHARDTEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_Analytic_PTZC_t<int32_t, int> test_estimator_t;
+
+typedef nloop_DetectionPipeline_t<int32_t, int,
+  nloop_IIRFilterBank_t<int32_t, int,
+    SHARDTEST_STAGES, SHARDTEST_BANKS, SHARDTEST_CHANS>,
+  test_estimator_t, 8, SHARDTEST_BANKS, SHARDTEST_CHANS> test_single_t;
+
+typedef nloop_ShardedPipeline_t<int32_t, int,
+  nloop_IIRFilterBank_t<int32_t, int,
+    SHARDTEST_STAGES, SHARDTEST_BANKS, SHARDTEST_SHARDCHANS>,
+  test_estimator_t, 8, SHARDTEST_BANKS, SHARDTEST_SHARDCHANS,
+  SHARDTEST_SHARDS> test_sharded_t;
+
+
+//
+// Helper Functions
+
+
+// This configures one pipeline's detection stages. "chanoffset" is the
+// index of the pipeline's first channel, so that per-channel settings
+// follow channels into shards.
+
+template <class pipeline_t, int chancount>
+void ConfigureDetection(pipeline_t &pipe, int chanoffset)
+{
+  nloop_SampleSlice_t<int32_t, SHARDTEST_BANKS, chancount> highs, lows;
+  int bidx, cidx;
+
+  ConfigureTestDetection(pipe, SHARDTEST_BANKS, SHARDTEST_STAGES);
+
+  for (bidx = 0; bidx < SHARDTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < chancount; cidx++)
+    {
+      highs.data[bidx][cidx] = 4000 + 200 * ((chanoffset + cidx) % 7);
+      lows.data[bidx][cidx] = TEST_THRESH_LOW;
+    }
+  pipe.SetThresholds(highs, lows);
+}
+
+
+
+// This counts trigger pulses (rising edges) in a series of outputs.
+
+int CountPulses(test_flagslice_t *trigout, int count)
+{
+  int sidx, bidx, cidx, pulses;
+  bool prev;
+
+  pulses = 0;
+  for (bidx = 0; bidx < SHARDTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < SHARDTEST_CHANS; cidx++)
+    {
+      prev = false;
+      for (sidx = 0; sidx < count; sidx++)
+      {
+        if (trigout[sidx].data[bidx][cidx] && !prev)
+          pulses++;
+        prev = trigout[sidx].data[bidx][cidx];
+      }
+    }
+
+  return pulses;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_single_t *single;
+  test_sharded_t *sharded;
+  test_inslice_t *inblock;
+  test_flagslice_t *singletrig, *shardtrig;
+  chrono::steady_clock::time_point tstart;
+  double singletime, shardtime;
+  int sidx, bidx, cidx, shardidx, firstidx, thiscount;
+  int mismatches, pulses, firstcpu;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Channel-sharded pipeline test.\n\n";
+
+  // These are too large for the stack.
+  single = new test_single_t;
+  sharded = new test_sharded_t;
+  inblock = new test_inslice_t[SHARDTEST_SAMPLES];
+  singletrig = new test_flagslice_t[SHARDTEST_SAMPLES];
+  shardtrig = new test_flagslice_t[SHARDTEST_SAMPLES];
+
+  ConfigureDetection<test_single_t, SHARDTEST_CHANS>(*single, 0);
+  single->SetActiveGeometry(SHARDTEST_BANKS, SHARDTEST_CHANS);
+  single->SetUniformTargets(5);
+  ConfigureTestTriggers( single->GetTriggers(), SHARDTEST_SAMPLES,
+    SHARDTEST_MAXPULSES );
+
+  for (shardidx = 0; shardidx < SHARDTEST_SHARDS; shardidx++)
+    ConfigureDetection<test_sharded_t::shard_pipeline_t,
+      SHARDTEST_SHARDCHANS>( *(sharded->GetShard(shardidx)),
+      shardidx * SHARDTEST_SHARDCHANS );
+  sharded->SetActiveGeometry(SHARDTEST_BANKS, SHARDTEST_CHANS);
+  sharded->SetUniformTargets(5);
+  ConfigureTestTriggers( sharded->GetTriggers(), SHARDTEST_SAMPLES,
+    SHARDTEST_MAXPULSES );
+
+  is_ok = (NULL == sharded->GetShard(SHARDTEST_SHARDS));
+
+  for (sidx = 0; sidx < SHARDTEST_SAMPLES; sidx++)
+    MakeBurstInput(sidx, inblock[sidx]);
+
+
+  // Run the same input through one full-width pipeline and through the
+  // sharded runner. Block sizes differ on purpose.
+
+  tstart = chrono::steady_clock::now();
+  single->ProcessBlock(inblock, singletrig, SHARDTEST_SAMPLES);
+  singletime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  // Not running yet.
+  is_ok = is_ok && !sharded->ProcessBlock(inblock, shardtrig, 1);
+
+  // Only pin workers if there are enough cores to go around.
+  firstcpu = -1;
+  if (SHARDTEST_SHARDS < thread::hardware_concurrency())
+    firstcpu = 1;
+
+  is_ok = is_ok && sharded->StartWorkers(SHARDTEST_BLOCKSIZE / 2, firstcpu);
+  is_ok = is_ok && !sharded->StartWorkers(SHARDTEST_BLOCKSIZE, 0);
+
+  tstart = chrono::steady_clock::now();
+  for (firstidx = 0; firstidx < SHARDTEST_SAMPLES;
+    firstidx += SHARDTEST_BLOCKSIZE)
+  {
+    thiscount = SHARDTEST_SAMPLES - firstidx;
+    if (thiscount > SHARDTEST_BLOCKSIZE)
+      thiscount = SHARDTEST_BLOCKSIZE;
+
+    is_ok = is_ok && sharded->ProcessBlock( inblock + firstidx,
+      shardtrig + firstidx, thiscount );
+  }
+  shardtime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  sharded->StopWorkers();
+  is_ok = is_ok && !sharded->IsRunning();
+
+
+  // Outputs should be identical.
+
+  mismatches = 0;
+  for (sidx = 0; sidx < SHARDTEST_SAMPLES; sidx++)
+    for (bidx = 0; bidx < SHARDTEST_BANKS; bidx++)
+      for (cidx = 0; cidx < SHARDTEST_CHANS; cidx++)
+        if ( singletrig[sidx].data[bidx][cidx]
+          != shardtrig[sidx].data[bidx][cidx] )
+          mismatches++;
+
+  pulses = CountPulses(singletrig, SHARDTEST_SAMPLES);
+
+  cout << "Processed " << SHARDTEST_SAMPLES << " samples of "
+    << SHARDTEST_CHANS << " channels in " << SHARDTEST_SHARDS
+    << " shards: " << mismatches << " mismatched trigger outputs, "
+    << pulses << " pulses (quota " << SHARDTEST_MAXPULSES << ").\n";
+  cout << "Single thread: " << (singletime * 1.0e9 / SHARDTEST_SAMPLES)
+    << " ns/sample;  sharded: " << (shardtime * 1.0e9 / SHARDTEST_SAMPLES)
+    << " ns/sample (" << sharded->GetPinFailures()
+    << " workers not pinned).\n";
+
+  is_ok = is_ok && (0 == mismatches) && (SHARDTEST_MAXPULSES == pulses);
+
+
+  cout << "Sharded pipeline test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  delete single;
+  delete sharded;
+  delete[] inblock;
+  delete[] singletrig;
+  delete[] shardtrig;
+
+  // Ending banner.
+  cout << "\n== End of sharded pipeline test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
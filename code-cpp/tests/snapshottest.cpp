@@ -0,0 +1,415 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Binary snapshot round trip and load timing.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <sstream>
+#include <chrono>
+#include <string.h>
+
+
+//
+// Constants
+
+// Snapshot file written by this test. The Makefile removes it.
+#define SNAPTEST_FILENAME "snapshottest.snap"
+
+// Number of timed loads.
+#define SNAPTEST_PASSES 20
+
+// Test geometry.
+#define SNAPTEST_BANKS 16
+#define SNAPTEST_CHANS 8
+#define SNAPTEST_STAGES 4
+#define SNAPTEST_FIRTAPS 256
+#define SNAPTEST_LUTROWS 32
+
+
+//
+// Types
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  SNAPTEST_STAGES, SNAPTEST_BANKS, SNAPTEST_CHANS> test_biquadbank_t;
+typedef nloop_FIRFilterBank_t<int32_t, int,
+  SNAPTEST_FIRTAPS, SNAPTEST_FIRTAPS, SNAPTEST_BANKS, SNAPTEST_CHANS>
+  test_firbank_t;
+typedef nloop_LookupMonoStepPerBank_t<int16_t, int16_t,
+  SNAPTEST_LUTROWS, SNAPTEST_BANKS, SNAPTEST_CHANS> test_lutbank_t;
+typedef nloop_LookupMonoStep_t<int32_t, uint8_t, SNAPTEST_LUTROWS>
+  test_lut_t;
+typedef nloop_AveragerBank_t<int32_t, 8,
+  SNAPTEST_BANKS, SNAPTEST_CHANS> test_avgbank_t;
+typedef nloop_TriggerBank_t<int16_t,
+  SNAPTEST_BANKS, SNAPTEST_CHANS> test_trigbank_t;
+
+
+// Everything that goes into one snapshot.
+
+struct test_config_t
+{
+  test_biquadbank_t biquads;
+  test_firbank_t firs;
+  test_lutbank_t luts;
+  test_lut_t singlelut;
+  test_avgbank_t averagers;
+  test_trigbank_t triggers;
+};
+
+
+//
+// Helper Functions
+
+
+// This builds biquad and FIR coefficient CSV text.
+
+void BuildCoeffText(string &biquadtext, string &firtext)
+{
+  ostringstream biquadstream, firstream;
+  int bidx, sidx, tidx;
+
+  biquadstream << "bank,stage,num0,num1,num2,den0,den1,den2\n";
+  for (bidx = 0; bidx < SNAPTEST_BANKS; bidx++)
+    for (sidx = 0; sidx < SNAPTEST_STAGES; sidx++)
+      biquadstream << bidx << "," << sidx << ","
+        << (bidx * 1000 + sidx) << "," << -(bidx * 37 + sidx) << ","
+        << (sidx * 11) << "," << (1 << 14) << ","
+        << -(bidx * 3 + 100) << "," << (sidx * 5 + 1) << "\n";
+
+  for (bidx = 0; bidx < SNAPTEST_BANKS; bidx++)
+    firstream << (bidx ? "," : "") << "\"bank " << bidx << "\"";
+  firstream << "\n";
+
+  // Make later banks shorter, to exercise padding.
+  for (tidx = 0; tidx < SNAPTEST_FIRTAPS; tidx++)
+  {
+    for (bidx = 0; bidx < SNAPTEST_BANKS; bidx++)
+    {
+      if (bidx)
+        firstream << ",";
+      if (tidx < (SNAPTEST_FIRTAPS - bidx * 8))
+        firstream << ((tidx * 7 + bidx * 131) % 2001 - 1000);
+    }
+    firstream << "\n";
+  }
+
+  biquadtext = biquadstream.str();
+  firtext = firstream.str();
+}
+
+
+
+// This fills in LUT, averager, and trigger settings.
+
+void FillOtherSettings(test_config_t &config)
+{
+  int bidx, cidx, ridx;
+
+  // Filter banks start with no active geometry.
+  config.biquads.SetActiveBanks(SNAPTEST_BANKS);
+  config.biquads.SetActiveChans(SNAPTEST_CHANS);
+  config.biquads.SetActiveStages(SNAPTEST_STAGES);
+  config.firs.SetActiveBanks(SNAPTEST_BANKS);
+  config.firs.SetActiveChans(SNAPTEST_CHANS);
+
+  config.luts.SetActiveBanks(SNAPTEST_BANKS);
+  config.luts.SetActiveChans(SNAPTEST_CHANS);
+  config.luts.SetActiveRows(SNAPTEST_LUTROWS - 3);
+  config.singlelut.SetActiveRows(SNAPTEST_LUTROWS / 2);
+
+  for (bidx = 0; bidx < SNAPTEST_BANKS; bidx++)
+    for (ridx = 0; ridx < SNAPTEST_LUTROWS; ridx++)
+      config.luts.SetOneEntry( bidx, ridx,
+        1000 - ridx * 30 - bidx, ridx + bidx );
+
+  for (ridx = 0; ridx < SNAPTEST_LUTROWS; ridx++)
+    config.singlelut.SetEntry( ridx, ridx * 100000, 255 - ridx );
+
+  config.averagers.SetActiveChans(SNAPTEST_CHANS - 2);
+  config.triggers.SetActiveBanks(SNAPTEST_BANKS - 1);
+  config.triggers.SetActiveChans(SNAPTEST_CHANS);
+
+  for (bidx = 0; bidx < SNAPTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < SNAPTEST_CHANS; cidx++)
+    {
+      config.averagers.SetOneCoeff(bidx, cidx, bidx * 10 - cidx);
+      config.averagers.SetOneAvgBits(bidx, cidx, (bidx + cidx) % 12);
+
+      config.triggers.SetOneEnableFlag( bidx, cidx,
+        (0 != ((bidx + cidx) & 1)) );
+      config.triggers.SetOnePulseDuration(bidx, cidx, 10 + bidx);
+      config.triggers.SetOnePulseCooldown(bidx, cidx, 300 - cidx);
+      config.triggers.SetOneReRaise(bidx, cidx, (0 == (cidx % 3)));
+    }
+}
+
+
+
+// This adds every module in a configuration to a snapshot.
+
+void WriteConfig(nloop_SnapshotWriter_t &snap, test_config_t &config)
+{
+  nloop_WriteBiquadSnapshot<int32_t>(snap, 1, config.biquads);
+  nloop_WriteFIRSnapshot<int32_t, int>(snap, 1, config.firs);
+  nloop_WriteLookupTablePerBankSnapshot<int16_t, int16_t>(
+    snap, 1, config.luts );
+  nloop_WriteLookupTableSingleSnapshot<int32_t, uint8_t>(
+    snap, 2, config.singlelut );
+  nloop_WriteAveragerSnapshot<int32_t>(snap, 1, config.averagers);
+  nloop_WriteTriggerSnapshot<int16_t>(snap, 1, config.triggers);
+}
+
+
+
+// This loads every module in a configuration from a snapshot.
+
+bool ReadConfig(nloop_SnapshotFile_t &snap, test_config_t &config)
+{
+  bool is_ok;
+
+  is_ok = nloop_ReadBiquadSnapshot<int32_t>(snap, 1, config.biquads);
+  is_ok = is_ok
+    && nloop_ReadFIRSnapshot<int32_t, int>(snap, 1, config.firs);
+  is_ok = is_ok && nloop_ReadLookupTablePerBankSnapshot<int16_t, int16_t>(
+    snap, 1, config.luts );
+  is_ok = is_ok && nloop_ReadLookupTableSingleSnapshot<int32_t, uint8_t>(
+    snap, 2, config.singlelut );
+  is_ok = is_ok
+    && nloop_ReadAveragerSnapshot<int32_t>(snap, 1, config.averagers);
+  is_ok = is_ok
+    && nloop_ReadTriggerSnapshot<int16_t>(snap, 1, config.triggers);
+
+  return is_ok;
+}
+
+
+
+// This compares two configurations.
+
+bool ConfigsMatch(test_config_t &first, test_config_t &second)
+{
+  int bidx, cidx, sidx, ridx;
+  uint8_t bits1, bits2;
+  int32_t coeffs1[5], coeffs2[5];
+  int taps1, taps2;
+  int16_t lutin1, lutin2, lutout1, lutout2;
+  int32_t slin1, slin2;
+  uint8_t slout1, slout2;
+  bool is_ok;
+
+  is_ok = true;
+
+  for (bidx = 0; bidx < SNAPTEST_BANKS; bidx++)
+  {
+    for (sidx = 0; sidx < SNAPTEST_STAGES; sidx++)
+    {
+      first.biquads.GetCoefficients( sidx, bidx, bits1,
+        coeffs1[0], coeffs1[1], coeffs1[2], coeffs1[3], coeffs1[4] );
+      second.biquads.GetCoefficients( sidx, bidx, bits2,
+        coeffs2[0], coeffs2[1], coeffs2[2], coeffs2[3], coeffs2[4] );
+
+      is_ok = is_ok && (bits1 == bits2)
+        && (0 == memcmp(coeffs1, coeffs2, sizeof(coeffs1)));
+    }
+
+    first.firs.GetOneGeometry(bidx, bits1, taps1);
+    second.firs.GetOneGeometry(bidx, bits2, taps2);
+    is_ok = is_ok && (bits1 == bits2) && (taps1 == taps2);
+    for (sidx = 0; is_ok && (sidx < taps1); sidx++)
+      is_ok = ( first.firs.GetOneCoefficient(bidx, sidx)
+        == second.firs.GetOneCoefficient(bidx, sidx) );
+
+    for (ridx = 0; ridx < first.luts.GetActiveRows(); ridx++)
+    {
+      first.luts.GetOneEntry(bidx, ridx, lutin1, lutout1);
+      second.luts.GetOneEntry(bidx, ridx, lutin2, lutout2);
+      is_ok = is_ok && (lutin1 == lutin2) && (lutout1 == lutout2);
+    }
+
+    for (cidx = 0; cidx < first.averagers.GetActiveChans(); cidx++)
+      is_ok = is_ok
+        && ( first.averagers.GetOneCoeff(bidx, cidx)
+          == second.averagers.GetOneCoeff(bidx, cidx) )
+        && ( first.averagers.GetOneAvgBits(bidx, cidx)
+          == second.averagers.GetOneAvgBits(bidx, cidx) );
+
+    if (bidx < first.triggers.GetActiveBanks())
+      for (cidx = 0; cidx < SNAPTEST_CHANS; cidx++)
+        is_ok = is_ok
+          && ( first.triggers.GetOneEnableFlag(bidx, cidx)
+            == second.triggers.GetOneEnableFlag(bidx, cidx) )
+          && ( first.triggers.GetOnePulseDuration(bidx, cidx)
+            == second.triggers.GetOnePulseDuration(bidx, cidx) )
+          && ( first.triggers.GetOnePulseCooldown(bidx, cidx)
+            == second.triggers.GetOnePulseCooldown(bidx, cidx) )
+          && ( first.triggers.GetOneReRaise(bidx, cidx)
+            == second.triggers.GetOneReRaise(bidx, cidx) );
+  }
+
+  for (ridx = 0; ridx < first.singlelut.GetActiveRows(); ridx++)
+  {
+    first.singlelut.GetEntry(ridx, slin1, slout1);
+    second.singlelut.GetEntry(ridx, slin2, slout2);
+    is_ok = is_ok && (slin1 == slin2) && (slout1 == slout2);
+  }
+
+  // Geometry stored in the snapshot should have been applied.
+  is_ok = is_ok
+    && ( first.luts.GetActiveRows() == second.luts.GetActiveRows() )
+    && ( first.singlelut.GetActiveRows()
+      == second.singlelut.GetActiveRows() )
+    && ( first.averagers.GetActiveChans()
+      == second.averagers.GetActiveChans() )
+    && ( first.triggers.GetActiveBanks()
+      == second.triggers.GetActiveBanks() );
+
+  return is_ok;
+}
+
+
+
+// This checks that damaged snapshots are rejected.
+
+bool CheckRejection(string &snaptext)
+{
+  nloop_SnapshotFile_t snap;
+  string damaged;
+  bool is_ok;
+
+  is_ok = snap.AttachBuffer(snaptext.data(), snaptext.size());
+
+  // Truncated.
+  damaged = snaptext.substr(0, snaptext.size() - 8);
+  is_ok = is_ok && !snap.AttachBuffer(damaged.data(), damaged.size());
+
+  // Bad signature.
+  damaged = snaptext;
+  damaged[0] = 'X';
+  is_ok = is_ok && !snap.AttachBuffer(damaged.data(), damaged.size());
+
+  // Newer version.
+  damaged = snaptext;
+  damaged[8] = NLOOP_SNAPSHOT_VERSION + 1;
+  is_ok = is_ok && !snap.AttachBuffer(damaged.data(), damaged.size());
+
+  // Section data pointing past the end of the file.
+  damaged = snaptext;
+  damaged[NLOOP_SNAPSHOT_HEADER_BYTES + 23] = 0x7f;
+  is_ok = is_ok && !snap.AttachBuffer(damaged.data(), damaged.size());
+
+  // A missing section should be reported as such.
+  is_ok = is_ok && snap.AttachBuffer(snaptext.data(), snaptext.size());
+  is_ok = is_ok && (snap.FindSection(NLOOP_SNAP_BIQUAD, 99) < 0);
+
+  return is_ok;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_config_t *original, *fromsnap;
+  nloop_SnapshotWriter_t snapwriter;
+  nloop_SnapshotFile_t snapfile;
+  string biquadtext, firtext, snaptext;
+  ostringstream snapstream;
+  chrono::steady_clock::time_point tstart, tend;
+  double csvtime, snaptime;
+  int pidx;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Binary snapshot test.\n\n";
+
+  // These are too large for the stack.
+  original = new test_config_t;
+  fromsnap = new test_config_t;
+
+
+  // Build a configuration, loading filters from CSV and timing that.
+
+  BuildCoeffText(biquadtext, firtext);
+  FillOtherSettings(*original);
+
+  tstart = chrono::steady_clock::now();
+  for (pidx = 0; pidx < SNAPTEST_PASSES; pidx++)
+  {
+    istringstream biquadstream(biquadtext);
+    istringstream firstream(firtext);
+
+    nloop_ReadBiquadCoeffs<int32_t>(biquadstream, original->biquads);
+    nloop_ReadFIRCoeffs<int32_t, int>(firstream, original->firs, 12);
+  }
+  tend = chrono::steady_clock::now();
+  csvtime = chrono::duration<double>(tend - tstart).count() / SNAPTEST_PASSES;
+
+
+  // Write the snapshot and map it back in.
+
+  WriteConfig(snapwriter, *original);
+  is_ok = snapwriter.WriteToFile(SNAPTEST_FILENAME);
+  is_ok = is_ok && snapfile.OpenFile(SNAPTEST_FILENAME);
+
+  if (!is_ok)
+    cout << "!! Couldn't write and map \"" << SNAPTEST_FILENAME << "\".\n";
+
+  if (is_ok)
+  {
+    tstart = chrono::steady_clock::now();
+    for (pidx = 0; is_ok && (pidx < SNAPTEST_PASSES); pidx++)
+      is_ok = ReadConfig(snapfile, *fromsnap);
+    tend = chrono::steady_clock::now();
+    snaptime =
+      chrono::duration<double>(tend - tstart).count() / SNAPTEST_PASSES;
+
+    if (!is_ok)
+      cout << "!! Couldn't read sections back.\n";
+  }
+
+  if (is_ok)
+  {
+    is_ok = ConfigsMatch(*original, *fromsnap);
+
+    cout << "CSV filter load:       " << (csvtime * 1.0e6) << " us\n";
+    cout << "Snapshot full load:    " << (snaptime * 1.0e6) << " us\n";
+    cout << "Round trip matches:    " << (is_ok ? "yes" : "NO") << "\n";
+  }
+
+  snapfile.Close();
+
+
+  // Check that the in-memory writer agrees, and test damaged files.
+
+  snapwriter.WriteToStream(snapstream);
+  snaptext = snapstream.str();
+
+  if (!CheckRejection(snaptext))
+  {
+    cout << "!! Damaged snapshot check failed.\n";
+    is_ok = false;
+  }
+  else
+    cout << "Damaged snapshots:     rejected\n";
+
+
+  delete original;
+  delete fromsnap;
+
+  // Ending banner.
+  cout << "\n== End of binary snapshot test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,194 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Stage-pipelined multi-threaded executor.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Samples processed.
+#define STAGETEST_SAMPLES 20000
+#define STAGETEST_BLOCKSIZE 256
+
+// Test geometry.
+#define STAGETEST_BANKS 4
+#define STAGETEST_CHANS 32
+#define STAGETEST_STAGES 3
+#define STAGETEST_QUEUEDEPTH 16
+
+// Pulse quota. This should run out partway through the test.
+#define STAGETEST_MAXPULSES 1000
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, STAGETEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<bool, STAGETEST_BANKS, STAGETEST_CHANS>
+  test_flagslice_t;
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  STAGETEST_STAGES, STAGETEST_BANKS, STAGETEST_CHANS> test_filtbank_t;
+typedef nloop_Analytic_PTZC_t<int32_t, int> test_estimator_t;
+
+typedef nloop_DetectionPipeline_t<int32_t, int, test_filtbank_t,
+  test_estimator_t, 8, STAGETEST_BANKS, STAGETEST_CHANS> test_single_t;
+
+typedef nloop_StagedPipeline_t<int32_t, int, test_filtbank_t,
+  test_estimator_t, 8, STAGETEST_BANKS, STAGETEST_CHANS,
+  STAGETEST_QUEUEDEPTH> test_staged_t;
+
+
+//
+// Helper Functions
+
+
+// This configures a pipeline. The detection pipeline and the staged
+// executor have the same configuration interface.
+
+template <class pipeline_t>
+void ConfigurePipeline(pipeline_t &pipe)
+{
+  ConfigureTestDetection(pipe, STAGETEST_BANKS, STAGETEST_STAGES);
+
+  pipe.SetUniformThresholds(TEST_THRESH_HIGH, TEST_THRESH_LOW);
+  pipe.SetActiveGeometry(STAGETEST_BANKS, STAGETEST_CHANS);
+
+  ConfigureTestTriggers( pipe.GetTriggers(), STAGETEST_SAMPLES,
+    STAGETEST_MAXPULSES );
+  pipe.SetUniformTargets(TEST_TARGET_DELAY);
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_single_t *single;
+  test_staged_t *staged;
+  test_inslice_t *inblock;
+  test_flagslice_t *singletrig, *stagetrig;
+  chrono::steady_clock::time_point tstart;
+  double singletime, stagetime, mean_ns, max_ns;
+  int sidx, bidx, cidx, hidx, firstidx, thiscount, mismatches, firstcpu;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Stage-pipelined executor test.\n\n";
+
+  // These are too large for the stack.
+  single = new test_single_t;
+  staged = new test_staged_t;
+  inblock = new test_inslice_t[STAGETEST_SAMPLES];
+  singletrig = new test_flagslice_t[STAGETEST_SAMPLES];
+  stagetrig = new test_flagslice_t[STAGETEST_SAMPLES];
+
+  ConfigurePipeline(*single);
+  ConfigurePipeline(*staged);
+
+  for (sidx = 0; sidx < STAGETEST_SAMPLES; sidx++)
+    MakeBurstInput(sidx, inblock[sidx]);
+
+
+  // Run the same input through one detection pipeline and through the
+  // staged executor.
+
+  tstart = chrono::steady_clock::now();
+  single->ProcessBlock(inblock, singletrig, STAGETEST_SAMPLES);
+  singletime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  // Not running yet.
+  is_ok = !staged->ProcessBlock(inblock, stagetrig, 1);
+
+  // Only pin workers if there are enough cores to go around.
+  firstcpu = -1;
+  if (NLOOP_STAGES_WORKERS < thread::hardware_concurrency())
+    firstcpu = 1;
+
+  is_ok = is_ok && staged->StartWorkers(firstcpu);
+  is_ok = is_ok && !staged->StartWorkers(firstcpu);
+
+  tstart = chrono::steady_clock::now();
+  for (firstidx = 0; firstidx < STAGETEST_SAMPLES;
+    firstidx += STAGETEST_BLOCKSIZE)
+  {
+    thiscount = STAGETEST_SAMPLES - firstidx;
+    if (thiscount > STAGETEST_BLOCKSIZE)
+      thiscount = STAGETEST_BLOCKSIZE;
+
+    is_ok = is_ok && staged->ProcessBlock( inblock + firstidx,
+      stagetrig + firstidx, thiscount );
+  }
+  stagetime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  staged->StopWorkers();
+  is_ok = is_ok && !staged->IsRunning();
+
+
+  // Outputs should be identical.
+
+  mismatches = 0;
+  for (sidx = 0; sidx < STAGETEST_SAMPLES; sidx++)
+    for (bidx = 0; bidx < STAGETEST_BANKS; bidx++)
+      for (cidx = 0; cidx < STAGETEST_CHANS; cidx++)
+        if ( singletrig[sidx].data[bidx][cidx]
+          != stagetrig[sidx].data[bidx][cidx] )
+          mismatches++;
+
+  cout << "Processed " << STAGETEST_SAMPLES << " samples of "
+    << STAGETEST_CHANS << " channels: " << mismatches
+    << " mismatched trigger outputs.\n";
+  cout << "Single thread: " << (singletime * 1.0e9 / STAGETEST_SAMPLES)
+    << " ns/sample;  staged: " << (stagetime * 1.0e9 / STAGETEST_SAMPLES)
+    << " ns/sample (" << staged->GetPinFailures()
+    << " workers not pinned).\n";
+
+  is_ok = is_ok && (0 == mismatches);
+
+
+  // Every hop should have seen every sample.
+
+  for (hidx = 0; hidx < NLOOP_STAGES_HOPS; hidx++)
+  {
+    is_ok = is_ok && staged->GetHopLatency(hidx, mean_ns, max_ns);
+    cout << "Hop " << hidx << ": mean " << mean_ns << " ns, max "
+      << max_ns << " ns.\n";
+  }
+  is_ok = is_ok && staged->GetTotalLatency(mean_ns, max_ns);
+  cout << "Total: mean " << mean_ns << " ns, max " << max_ns << " ns.\n";
+
+  is_ok = is_ok && !staged->GetHopLatency(NLOOP_STAGES_HOPS, mean_ns, max_ns);
+
+
+  cout << "Staged executor test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  delete single;
+  delete staged;
+  delete[] inblock;
+  delete[] singletrig;
+  delete[] stagetrig;
+
+  // Ending banner.
+  cout << "\n== End of staged executor test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,355 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Processing state checkpoint and warm restart.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Checkpoint file written by this test. The Makefile removes it.
+#define STATETEST_FILENAME "statetest.state"
+
+// Samples processed before and after the checkpoint.
+#define STATETEST_WARMUP 3000
+#define STATETEST_RESUME 3000
+
+// Test geometry.
+#define STATETEST_BANKS 4
+#define STATETEST_CHANS 8
+#define STATETEST_STAGES 3
+#define STATETEST_FIRTAPS 16
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, STATETEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<int32_t, STATETEST_BANKS, STATETEST_CHANS>
+  test_sampslice_t;
+typedef nloop_SampleSlice_t<int, STATETEST_BANKS, STATETEST_CHANS>
+  test_indexslice_t;
+typedef nloop_SampleSlice_t<bool, STATETEST_BANKS, STATETEST_CHANS>
+  test_flagslice_t;
+
+
+// One of every stateful module, wired into a detection pipeline.
+
+struct test_pipeline_t
+{
+  // Modules.
+  nloop_AutoRanger_t<int32_t, int, STATETEST_CHANS> ranger;
+  nloop_IIRFilterBank_t<int32_t, int,
+    STATETEST_STAGES, STATETEST_BANKS, STATETEST_CHANS> biquads;
+  nloop_FIRFilterBank_t<int32_t, int, STATETEST_FIRTAPS, STATETEST_FIRTAPS,
+    STATETEST_BANKS, STATETEST_CHANS> firs;
+  nloop_AnalyticBank_PT_t<int32_t, int, nloop_Analytic_PTZC_t<int32_t, int>,
+    STATETEST_BANKS, STATETEST_CHANS> analytic;
+  nloop_AveragerBank_t<int32_t, 8, STATETEST_BANKS, STATETEST_CHANS>
+    averagers;
+  nloop_ThresholdSingleBank_t<int32_t, STATETEST_BANKS, STATETEST_CHANS>
+    threshsingle;
+  nloop_ThresholdDualBank_t<STATETEST_BANKS, STATETEST_CHANS> threshdual;
+  nloop_DeGlitcherBank_t<int, STATETEST_BANKS, STATETEST_CHANS> deglitch;
+  nloop_TriggerBank_t<int, STATETEST_BANKS, STATETEST_CHANS> triggers;
+
+  // Configuration that isn't held by modules.
+  test_sampslice_t thresh_high, thresh_low;
+  test_indexslice_t targets;
+
+  // Intermediate and output slices.
+  test_inslice_t ranged;
+  test_sampslice_t filtered, firout, magnitudes, averages;
+  test_indexslice_t periods, since_rise, since_fall;
+  test_flagslice_t flag_high, flag_low, detected, cleaned, trigsout;
+};
+
+
+//
+// Helper Functions
+
+
+// This configures a pipeline. Every instance gets the same configuration.
+
+void ConfigurePipeline(test_pipeline_t &pipe)
+{
+  ConfigureTestRanger(pipe.ranger);
+
+  pipe.biquads.SetActiveBanks(STATETEST_BANKS);
+  pipe.biquads.SetActiveChans(STATETEST_CHANS);
+  ConfigureTestBiquads(pipe.biquads, STATETEST_BANKS, STATETEST_STAGES);
+
+  pipe.firs.SetActiveBanks(STATETEST_BANKS);
+  pipe.firs.SetActiveChans(STATETEST_CHANS);
+  ConfigureTestFIRs(pipe.firs, STATETEST_BANKS);
+
+  ConfigureTestAnalytic(pipe.analytic);
+  ConfigureTestAverager(pipe.averagers);
+
+  pipe.thresh_high.SetUniformValue(TEST_THRESH_HIGH);
+  pipe.thresh_low.SetUniformValue(TEST_THRESH_LOW);
+  pipe.threshdual.ResetState();
+  pipe.deglitch.SetUniformDelays(TEST_DEGLITCH_RISE, TEST_DEGLITCH_FALL);
+
+  pipe.triggers.SetActiveBanks(STATETEST_BANKS);
+  pipe.triggers.SetActiveChans(STATETEST_CHANS);
+  ConfigureTestTriggers( pipe.triggers, STATETEST_WARMUP + STATETEST_RESUME,
+    1000000 );
+  pipe.targets.SetUniformValue(TEST_TARGET_DELAY);
+}
+
+
+
+// This runs one sample through the pipeline, and returns a hash of all
+// module outputs.
+
+uint64_t StepPipeline(test_pipeline_t &pipe, test_inslice_t &indata)
+{
+  uint64_t hash;
+  int bidx, cidx;
+
+  pipe.ranger.UpdateFromSample(indata);
+  pipe.ranger.GetLatchedOutput(indata, pipe.ranged);
+
+  pipe.biquads.ApplyBankOnce(pipe.ranged, pipe.filtered);
+  pipe.firs.ApplyBankOnce(pipe.ranged, pipe.firout);
+
+  pipe.analytic.HandleSamples(pipe.filtered);
+  pipe.analytic.GetEstimatedAnalytic( pipe.magnitudes, pipe.periods,
+    pipe.since_rise, pipe.since_fall );
+
+  pipe.averagers.UpdateAverage(pipe.magnitudes, pipe.averages);
+
+  pipe.threshsingle.TestSamples( pipe.averages, pipe.thresh_high,
+    pipe.flag_high );
+  pipe.threshsingle.TestSamples( pipe.averages, pipe.thresh_low,
+    pipe.flag_low );
+  pipe.threshdual.TestDual(pipe.flag_high, pipe.flag_low, pipe.detected);
+  pipe.deglitch.ProcessSample(pipe.detected, pipe.cleaned);
+
+  pipe.triggers.ProcessSamples( pipe.since_rise, pipe.targets,
+    pipe.periods, pipe.cleaned, pipe.trigsout );
+
+  // FNV-1a over everything downstream of the input.
+  hash = 14695981039346656037ull;
+  for (bidx = 0; bidx < STATETEST_BANKS; bidx++)
+    for (cidx = 0; cidx < STATETEST_CHANS; cidx++)
+    {
+      hash = (hash ^ (uint32_t) pipe.filtered.data[bidx][cidx])
+        * 1099511628211ull;
+      hash = (hash ^ (uint32_t) pipe.firout.data[bidx][cidx])
+        * 1099511628211ull;
+      hash = (hash ^ (uint32_t) pipe.averages.data[bidx][cidx])
+        * 1099511628211ull;
+      hash = (hash ^ (uint32_t) pipe.periods.data[bidx][cidx])
+        * 1099511628211ull;
+      hash = (hash ^ ( (pipe.cleaned.data[bidx][cidx] ? 1 : 0)
+        + (pipe.trigsout.data[bidx][cidx] ? 2 : 0) )) * 1099511628211ull;
+    }
+
+  return hash;
+}
+
+
+
+// This saves or loads every module's state, in pipeline order.
+
+void SavePipeline(test_pipeline_t &pipe, nloop_StateBuffer_t &statebuf)
+{
+  pipe.ranger.SaveState(statebuf);
+  pipe.biquads.SaveState(statebuf);
+  pipe.firs.SaveState(statebuf);
+  pipe.analytic.SaveState(statebuf);
+  pipe.averagers.SaveState(statebuf);
+  pipe.threshdual.SaveState(statebuf);
+  pipe.deglitch.SaveState(statebuf);
+  pipe.triggers.SaveState(statebuf);
+}
+
+void LoadPipeline(test_pipeline_t &pipe, nloop_StateBuffer_t &statebuf)
+{
+  pipe.ranger.LoadState(statebuf);
+  pipe.biquads.LoadState(statebuf);
+  pipe.firs.LoadState(statebuf);
+  pipe.analytic.LoadState(statebuf);
+  pipe.averagers.LoadState(statebuf);
+  pipe.threshdual.LoadState(statebuf);
+  pipe.deglitch.LoadState(statebuf);
+  pipe.triggers.LoadState(statebuf);
+}
+
+
+
+// This counts the number of trigger outputs that are high.
+
+int CountTriggers(test_pipeline_t &pipe)
+{
+  int bidx, cidx, count;
+
+  count = 0;
+  for (bidx = 0; bidx < STATETEST_BANKS; bidx++)
+    for (cidx = 0; cidx < STATETEST_CHANS; cidx++)
+      if (pipe.trigsout.data[bidx][cidx])
+        count++;
+
+  return count;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_pipeline_t *reference, *resumed, *cold;
+  test_inslice_t indata;
+  nloop_StateBuffer_t statebuf;
+  vector<uint8_t> statedata, readback;
+  ofstream outfile;
+  ifstream infile;
+  chrono::steady_clock::time_point tstart, tend;
+  double savetime, loadtime;
+  size_t statebytes;
+  uint64_t refhash;
+  int sidx, mismatches, coldmismatches, trigcount;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Processing state checkpoint test.\n\n";
+
+  // These are too large for the stack.
+  reference = new test_pipeline_t;
+  resumed = new test_pipeline_t;
+  cold = new test_pipeline_t;
+
+  ConfigurePipeline(*reference);
+  ConfigurePipeline(*resumed);
+  ConfigurePipeline(*cold);
+
+
+  // Warm up the reference pipeline, then checkpoint it to a file.
+
+  for (sidx = 0; sidx < STATETEST_WARMUP; sidx++)
+  {
+    MakeBurstInput(sidx, indata);
+    StepPipeline(*reference, indata);
+  }
+
+  // Sizing pass.
+  statebuf.StartWrite(NULL, 0);
+  SavePipeline(*reference, statebuf);
+  statebytes = statebuf.GetByteCount();
+  statedata.resize(statebytes);
+
+  tstart = chrono::steady_clock::now();
+  statebuf.StartWrite(statedata.data(), statedata.size());
+  SavePipeline(*reference, statebuf);
+  tend = chrono::steady_clock::now();
+  savetime = chrono::duration<double>(tend - tstart).count();
+
+  is_ok = statebuf.IsOk() && (statebytes == statebuf.GetByteCount());
+
+  outfile.open(STATETEST_FILENAME, ios::binary);
+  outfile.write((const char *) statedata.data(), statedata.size());
+  outfile.close();
+
+
+  // Simulate a restart: read the file back into a freshly configured
+  // pipeline.
+
+  infile.open(STATETEST_FILENAME, ios::binary);
+  readback.assign( istreambuf_iterator<char>(infile),
+    istreambuf_iterator<char>() );
+  infile.close();
+
+  tstart = chrono::steady_clock::now();
+  is_ok = is_ok && statebuf.StartRead(readback.data(), readback.size());
+  LoadPipeline(*resumed, statebuf);
+  tend = chrono::steady_clock::now();
+  loadtime = chrono::duration<double>(tend - tstart).count();
+
+  is_ok = is_ok && statebuf.IsOk()
+    && (readback.size() == statebuf.GetByteCount());
+
+  cout << "Checkpoint is " << statebytes << " bytes; saved in "
+    << (savetime * 1.0e6) << " us, loaded in "
+    << (loadtime * 1.0e6) << " us.\n";
+
+
+  // Run all three pipelines forward. The resumed pipeline should match the
+  // reference exactly; the cold-started one shouldn't.
+
+  mismatches = 0;
+  coldmismatches = 0;
+  trigcount = 0;
+
+  for (sidx = STATETEST_WARMUP;
+    sidx < (STATETEST_WARMUP + STATETEST_RESUME); sidx++)
+  {
+    MakeBurstInput(sidx, indata);
+    refhash = StepPipeline(*reference, indata);
+    trigcount += CountTriggers(*reference);
+
+    if (refhash != StepPipeline(*resumed, indata))
+      mismatches++;
+    if (refhash != StepPipeline(*cold, indata))
+      coldmismatches++;
+  }
+
+  cout << "After resuming: " << mismatches << " mismatched samples (warm), "
+    << coldmismatches << " (cold); " << trigcount << " trigger samples.\n";
+
+  is_ok = is_ok && (0 == mismatches) && (0 < coldmismatches)
+    && (0 < trigcount);
+
+
+  // Damaged or mismatched checkpoints should be rejected.
+
+  // Truncated.
+  statebuf.StartRead(readback.data(), readback.size() - 1);
+  LoadPipeline(*cold, statebuf);
+  is_ok = is_ok && !statebuf.IsOk();
+
+  // Bad signature.
+  readback[0] = 'X';
+  is_ok = is_ok && !statebuf.StartRead(readback.data(), readback.size());
+  readback[0] = NLOOP_STATE_MAGIC[0];
+
+  // Different active geometry.
+  cold->biquads.SetActiveStages(STATETEST_STAGES - 1);
+  statebuf.StartRead(readback.data(), readback.size());
+  LoadPipeline(*cold, statebuf);
+  is_ok = is_ok && !statebuf.IsOk();
+
+  // Undersized output buffer.
+  statebuf.StartWrite(statedata.data(), statedata.size() - 1);
+  SavePipeline(*reference, statebuf);
+  is_ok = is_ok && !statebuf.IsOk();
+
+
+  cout << "Checkpoint test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  delete reference;
+  delete resumed;
+  delete cold;
+
+  // Ending banner.
+  cout << "\n== End of checkpoint test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
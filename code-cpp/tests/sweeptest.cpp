@@ -0,0 +1,365 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Parameter sweep runner with shared upstream stages.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+
+
+//
+// Constants
+
+// Samples processed.
+#define SWEEPTEST_SAMPLES 20000
+#define SWEEPTEST_BLOCKSIZE 256
+
+// Test geometry.
+#define SWEEPTEST_BANKS 4
+#define SWEEPTEST_CHANS 16
+#define SWEEPTEST_STAGES 3
+
+// Sweep size.
+#define SWEEPTEST_VARIANTS 6
+#define SWEEPTEST_WORKERS 3
+
+// Synthetic input. Bursts are well above the background, so that the
+// thresholds being swept separate them.
+#define SWEEPTEST_SEED 1234
+#define SWEEPTEST_BACKGROUND_AMP 1000
+#define SWEEPTEST_BURST_AMP 12000
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, SWEEPTEST_CHANS> test_inslice_t;
+typedef nloop_SampleSlice_t<bool, SWEEPTEST_BANKS, SWEEPTEST_CHANS>
+  test_flagslice_t;
+typedef nloop_SampleSlice_t<bool, 1, SWEEPTEST_CHANS> test_truthslice_t;
+typedef nloop_SampleSlice_t<uint16_t, 1, SWEEPTEST_CHANS> test_phaseslice_t;
+
+typedef nloop_IIRFilterBank_t<int32_t, int,
+  SWEEPTEST_STAGES, SWEEPTEST_BANKS, SWEEPTEST_CHANS> test_filtbank_t;
+typedef nloop_Analytic_PTZC_t<int32_t, int> test_estimator_t;
+
+typedef nloop_DetectionPipeline_t<int32_t, int, test_filtbank_t,
+  test_estimator_t, 8, SWEEPTEST_BANKS, SWEEPTEST_CHANS> test_single_t;
+
+typedef nloop_SweepPipeline_t<int32_t, int, test_filtbank_t,
+  test_estimator_t, 8, SWEEPTEST_BANKS, SWEEPTEST_CHANS> test_sweep_t;
+
+typedef nloop_DetectionScorer_t<SWEEPTEST_BANKS, SWEEPTEST_CHANS>
+  test_scorer_t;
+
+typedef nloop_SynthLFP_t<int32_t, SWEEPTEST_CHANS> test_synth_t;
+
+
+// Detection pipelines don't have scorers, so reference pipelines get
+// standalone ones. This gives a pipeline and its scorer the same interface
+// as a sweep variant, for configuration.
+
+struct test_adapter_t
+{
+  test_single_t *pipe;
+  test_scorer_t *scorer;
+
+  nloop_AveragerBank_t<int32_t, 8, SWEEPTEST_BANKS, SWEEPTEST_CHANS>
+    &GetAverager(void) { return pipe->GetAverager(); }
+  nloop_DeGlitcherBank_t<int, SWEEPTEST_BANKS, SWEEPTEST_CHANS>
+    &GetDeGlitcher(void) { return pipe->GetDeGlitcher(); }
+  nloop_TriggerBank_t<int, SWEEPTEST_BANKS, SWEEPTEST_CHANS>
+    &GetTriggers(void) { return pipe->GetTriggers(); }
+  test_scorer_t &GetScorer(void) { return *scorer; }
+
+  void SetUniformThresholds(int32_t new_high, int32_t new_low)
+    { pipe->SetUniformThresholds(new_high, new_low); }
+  void SetUniformTargets(int new_target)
+    { pipe->SetUniformTargets(new_target); }
+};
+
+
+//
+// Helper Functions
+
+
+// This applies one point of the parameter sweep. Variants differ in
+// averaging, thresholds, deglitching, trigger targets, and pulse quota;
+// everything else uses the shared test configuration.
+// This works with a reference pipeline's adapter or a sweep variant.
+
+template <class target_t>
+void ApplySweepPoint(target_t &target, int varidx)
+{
+  ConfigureTestAverager(target.GetAverager());
+  target.GetAverager().SetUniformCoeffs(256 - 16 * (varidx % 3));
+  target.GetAverager().SetUniformAvgBits(3 + (varidx % 4));
+
+  target.SetUniformThresholds( TEST_THRESH_HIGH + 500 * varidx,
+    TEST_THRESH_LOW );
+  target.GetDeGlitcher().SetUniformDelays(1 + varidx, 5 + 2 * varidx);
+  target.SetUniformTargets(2 + varidx);
+
+  ConfigureTestTriggers( target.GetTriggers(), SWEEPTEST_SAMPLES,
+    500 + 300 * varidx );
+
+  target.GetScorer().SetTargetPhase(0);
+  target.GetScorer().SetLateWindow(20);
+  target.GetScorer().ResetState();
+}
+
+
+
+// This returns true if two flag slices are identical.
+
+bool FlagsMatch(test_flagslice_t &first, test_flagslice_t &second)
+{
+  int bidx, cidx;
+
+  for (bidx = 0; bidx < SWEEPTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < SWEEPTEST_CHANS; cidx++)
+      if (first.data[bidx][cidx] != second.data[bidx][cidx])
+        return false;
+
+  return true;
+}
+
+
+
+// This counts rising edges in a series of flags.
+
+uint64_t CountOnsets(test_flagslice_t *flags, int count)
+{
+  int sidx, bidx, cidx;
+  uint64_t onsets;
+  bool prev;
+
+  onsets = 0;
+  for (bidx = 0; bidx < SWEEPTEST_BANKS; bidx++)
+    for (cidx = 0; cidx < SWEEPTEST_CHANS; cidx++)
+    {
+      prev = false;
+      for (sidx = 0; sidx < count; sidx++)
+      {
+        if (flags[sidx].data[bidx][cidx] && !prev)
+          onsets++;
+        prev = flags[sidx].data[bidx][cidx];
+      }
+    }
+
+  return onsets;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_single_t *single;
+  test_sweep_t *sweep;
+  test_sweep_t::variant_t *variant;
+  test_scorer_t *scorers;
+  test_inslice_t *inblock;
+  test_truthslice_t *truthblock;
+  test_phaseslice_t *phaseblock;
+  test_synth_t synth;
+  test_flagslice_t *singleburst, *singletrig, *sweepburst, *sweeptrig;
+  chrono::steady_clock::time_point tstart;
+  double singletime, sweeptime;
+  int sidx, vidx, firstidx, thiscount;
+  int mismatches;
+  uint64_t pulses;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Parameter sweep test.\n\n";
+
+  // These are too large for the stack.
+  single = new test_single_t[SWEEPTEST_VARIANTS];
+  sweep = new test_sweep_t;
+  scorers = new test_scorer_t[SWEEPTEST_VARIANTS];
+  inblock = new test_inslice_t[SWEEPTEST_SAMPLES];
+  truthblock = new test_truthslice_t[SWEEPTEST_SAMPLES];
+  phaseblock = new test_phaseslice_t[SWEEPTEST_SAMPLES];
+  singleburst = new test_flagslice_t[SWEEPTEST_SAMPLES * SWEEPTEST_VARIANTS];
+  singletrig = new test_flagslice_t[SWEEPTEST_SAMPLES * SWEEPTEST_VARIANTS];
+  sweepburst = new test_flagslice_t[SWEEPTEST_SAMPLES * SWEEPTEST_VARIANTS];
+  sweeptrig = new test_flagslice_t[SWEEPTEST_SAMPLES * SWEEPTEST_VARIANTS];
+
+  // Labelled input.
+  synth.SetBackgroundAmplitude(SWEEPTEST_BACKGROUND_AMP);
+  synth.SetBurstAmplitude(SWEEPTEST_BURST_AMP);
+  synth.Reset(SWEEPTEST_SEED);
+  synth.GenerateBlock(inblock, truthblock, phaseblock, SWEEPTEST_SAMPLES);
+
+
+  // Reference: one full pipeline per variant.
+
+  for (vidx = 0; vidx < SWEEPTEST_VARIANTS; vidx++)
+  {
+    test_adapter_t adapter;
+
+    adapter.pipe = &(single[vidx]);
+    adapter.scorer = &(scorers[vidx]);
+
+    ConfigureTestDetection(single[vidx], SWEEPTEST_BANKS, SWEEPTEST_STAGES);
+    ApplySweepPoint(adapter, vidx);
+    single[vidx].SetActiveGeometry(SWEEPTEST_BANKS, SWEEPTEST_CHANS);
+    scorers[vidx].SetActiveGeometry(SWEEPTEST_BANKS, SWEEPTEST_CHANS);
+  }
+
+  tstart = chrono::steady_clock::now();
+  for (vidx = 0; vidx < SWEEPTEST_VARIANTS; vidx++)
+    for (sidx = 0; sidx < SWEEPTEST_SAMPLES; sidx++)
+    {
+      test_flagslice_t &thisburst =
+        singleburst[vidx * SWEEPTEST_SAMPLES + sidx];
+      test_flagslice_t &thistrig =
+        singletrig[vidx * SWEEPTEST_SAMPLES + sidx];
+
+      single[vidx].ProcessSlice(inblock[sidx], thistrig);
+      thisburst.CopyFrom(single[vidx].GetBurstFlags());
+      scorers[vidx].ProcessSample( truthblock[sidx], phaseblock[sidx],
+        thisburst, thistrig );
+    }
+  singletime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+
+  // Sweep: shared stages once, variants on workers.
+
+  ConfigureTestRanger(sweep->GetRanger());
+  sweep->SetAutoRange(true);
+  ConfigureTestBiquads( sweep->GetFilterBank(), SWEEPTEST_BANKS,
+    SWEEPTEST_STAGES );
+  ConfigureTestAnalytic(sweep->GetAnalytic());
+
+  for (vidx = 0; vidx < SWEEPTEST_VARIANTS; vidx++)
+  {
+    variant = sweep->AddVariant();
+    ApplySweepPoint(*variant, vidx);
+  }
+  sweep->SetActiveGeometry(SWEEPTEST_BANKS, SWEEPTEST_CHANS);
+
+  is_ok = (SWEEPTEST_VARIANTS == sweep->GetVariantCount());
+  is_ok = is_ok && (NULL == sweep->GetVariant(SWEEPTEST_VARIANTS));
+
+  // Not running yet.
+  is_ok = is_ok && !sweep->ProcessBlock(inblock, NULL, NULL, 1);
+  is_ok = is_ok && !sweep->StartWorkers(SWEEPTEST_BLOCKSIZE, 0, -1);
+
+  is_ok = is_ok && sweep->StartWorkers( SWEEPTEST_BLOCKSIZE,
+    SWEEPTEST_WORKERS, -1 );
+  is_ok = is_ok && !sweep->StartWorkers(SWEEPTEST_BLOCKSIZE, 1, -1);
+  is_ok = is_ok && (NULL == sweep->AddVariant());
+
+  tstart = chrono::steady_clock::now();
+  for (firstidx = 0; firstidx < SWEEPTEST_SAMPLES;
+    firstidx += SWEEPTEST_BLOCKSIZE)
+  {
+    thiscount = SWEEPTEST_SAMPLES - firstidx;
+    if (thiscount > SWEEPTEST_BLOCKSIZE)
+      thiscount = SWEEPTEST_BLOCKSIZE;
+
+    is_ok = is_ok && sweep->ProcessBlock( inblock + firstidx,
+      truthblock + firstidx, phaseblock + firstidx, thiscount );
+
+    for (vidx = 0; vidx < SWEEPTEST_VARIANTS; vidx++)
+      for (sidx = 0; sidx < thiscount; sidx++)
+      {
+        variant = sweep->GetVariant(vidx);
+        sweepburst[vidx * SWEEPTEST_SAMPLES + firstidx + sidx].CopyFrom(
+          variant->GetBurstFlags(sidx) );
+        sweeptrig[vidx * SWEEPTEST_SAMPLES + firstidx + sidx].CopyFrom(
+          variant->GetTriggerFlags(sidx) );
+      }
+  }
+  sweeptime = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  sweep->StopWorkers();
+  is_ok = is_ok && !sweep->IsRunning();
+
+
+  // Every variant's outputs and summaries should match its reference
+  // pipeline's.
+
+  for (vidx = 0; vidx < SWEEPTEST_VARIANTS; vidx++)
+  {
+    variant = sweep->GetVariant(vidx);
+    test_scorer_t &thisscore = variant->GetScorer();
+
+    mismatches = 0;
+    for (sidx = vidx * SWEEPTEST_SAMPLES;
+      sidx < (vidx + 1) * SWEEPTEST_SAMPLES; sidx++)
+    {
+      if (!FlagsMatch(singleburst[sidx], sweepburst[sidx]))
+        mismatches++;
+      if (!FlagsMatch(singletrig[sidx], sweeptrig[sidx]))
+        mismatches++;
+    }
+
+    pulses = CountOnsets( singletrig + vidx * SWEEPTEST_SAMPLES,
+      SWEEPTEST_SAMPLES );
+
+    cout << "Variant " << vidx << ":  " << mismatches
+      << " mismatched samples,  " << variant->GetBurstCount()
+      << " bursts,  " << variant->GetTriggerCount() << " pulses,  "
+      << thisscore.GetHitCount() << "/" << thisscore.GetBurstCount()
+      << " hits,  " << thisscore.GetFalseAlarmCount()
+      << " false alarms.\n";
+
+    is_ok = is_ok && (0 == mismatches)
+      && ( CountOnsets( singleburst + vidx * SWEEPTEST_SAMPLES,
+        SWEEPTEST_SAMPLES ) == variant->GetBurstCount() )
+      && (pulses == variant->GetTriggerCount())
+      && (0 < pulses)
+      && (scorers[vidx].GetBurstCount() == thisscore.GetBurstCount())
+      && (scorers[vidx].GetHitCount() == thisscore.GetHitCount())
+      && ( scorers[vidx].GetFalseAlarmCount()
+        == thisscore.GetFalseAlarmCount() )
+      && (scorers[vidx].GetTriggerCount() == thisscore.GetTriggerCount())
+      && ( scorers[vidx].GetPhaseErrorSum()
+        == thisscore.GetPhaseErrorSum() );
+  }
+
+  // Variants should actually differ.
+  is_ok = is_ok && ( sweep->GetVariant(0)->GetTriggerCount()
+    != sweep->GetVariant(SWEEPTEST_VARIANTS - 1)->GetTriggerCount() );
+
+  cout << "Separate pipelines: " << (singletime * 1.0e9 / SWEEPTEST_SAMPLES)
+    << " ns/sample;  sweep (" << SWEEPTEST_WORKERS << " workers): "
+    << (sweeptime * 1.0e9 / SWEEPTEST_SAMPLES) << " ns/sample.\n";
+
+
+  cout << "Parameter sweep test " << (is_ok ? "passed" : "FAILED")
+    << ".\n";
+
+  delete[] single;
+  delete sweep;
+  delete[] scorers;
+  delete[] inblock;
+  delete[] truthblock;
+  delete[] phaseblock;
+  delete[] singleburst;
+  delete[] singletrig;
+  delete[] sweepburst;
+  delete[] sweeptrig;
+
+  // Ending banner.
+  cout << "\n== End of parameter sweep test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,262 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Test program - Synthetic LFP generator.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "testincludes.h"
+
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Test geometry.
+#define SYNTHTEST_CHANS 16
+#define SYNTHTEST_SAMPLES 50000
+
+// Burst settings for the label checks.
+#define SYNTHTEST_MINPERIOD 10
+#define SYNTHTEST_MAXPERIOD 30
+#define SYNTHTEST_MINCYCLES 3
+#define SYNTHTEST_MAXCYCLES 6
+#define SYNTHTEST_MINGAP 100
+#define SYNTHTEST_MAXGAP 400
+#define SYNTHTEST_BURSTAMP 10000
+
+// Largest acceptable sine error, in output units.
+#define SYNTHTEST_SINE_TOLERANCE 8
+
+
+//
+// Types
+
+typedef nloop_SampleSlice_t<int32_t, 1, SYNTHTEST_CHANS> test_sampslice_t;
+typedef nloop_SampleSlice_t<bool, 1, SYNTHTEST_CHANS> test_flagslice_t;
+typedef nloop_SampleSlice_t<uint16_t, 1, SYNTHTEST_CHANS> test_phaseslice_t;
+
+typedef nloop_SynthLFP_t<int32_t, SYNTHTEST_CHANS> test_synth_t;
+
+
+//
+// Helper Functions
+
+
+// This checks the fixed-point sine against the library sine.
+
+bool CheckSine(void)
+{
+  int32_t thisval, maxerr, thiserr;
+  int pidx;
+
+  maxerr = 0;
+  for (pidx = 0; pidx < 65536; pidx++)
+  {
+    thisval = nloop_SynthSine(((uint32_t) pidx) << 16);
+    thiserr = thisval - (int32_t) lround( 32768.0
+      * sin(6.283185307179586 * pidx / 65536.0) );
+    if (thiserr < 0)
+      thiserr = -thiserr;
+    if (thiserr > maxerr)
+      maxerr = thiserr;
+  }
+
+  cout << "Sine: max error " << maxerr << " / 32768.\n";
+
+  return (maxerr <= SYNTHTEST_SINE_TOLERANCE)
+    && (0 == nloop_SynthSine(0))
+    && (32768 == nloop_SynthSine(0x40000000u))
+    && (-32768 == nloop_SynthSine(0xc0000000u));
+}
+
+
+
+// This counts mismatched elements between two blocks.
+
+int CountMismatches(test_sampslice_t *first, test_sampslice_t *second)
+{
+  int sidx, cidx, mismatches;
+
+  mismatches = 0;
+  for (sidx = 0; sidx < SYNTHTEST_SAMPLES; sidx++)
+    for (cidx = 0; cidx < SYNTHTEST_CHANS; cidx++)
+      if (first[sidx].data[0][cidx] != second[sidx].data[0][cidx])
+        mismatches++;
+
+  return mismatches;
+}
+
+
+//
+// Main Program
+
+
+int main(void)
+{
+  test_synth_t *synth;
+  test_sampslice_t *firstblock, *secondblock;
+  test_flagslice_t *flags;
+  test_phaseslice_t *phases;
+  chrono::steady_clock::time_point tstart;
+  double elapsed;
+  long runcount, badlengths, badgaps, badsigns, badsteps, badquiet;
+  int sidx, cidx, runlen, gaplen, step, mismatches;
+  int32_t thisval;
+  bool is_ok;
+
+  // Starting banner.
+  cout << "\n== Synthetic LFP generator test.\n\n";
+
+  is_ok = CheckSine();
+
+  // These are too large for the stack.
+  synth = new test_synth_t;
+  firstblock = new test_sampslice_t[SYNTHTEST_SAMPLES];
+  secondblock = new test_sampslice_t[SYNTHTEST_SAMPLES];
+  flags = new test_flagslice_t[SYNTHTEST_SAMPLES];
+  phases = new test_phaseslice_t[SYNTHTEST_SAMPLES];
+
+
+  // Determinism. The same seed gives the same output; a different seed
+  // doesn't.
+
+  synth->Reset(42);
+  synth->GenerateBlock(firstblock, NULL, NULL, SYNTHTEST_SAMPLES);
+  synth->Reset();
+  synth->GenerateBlock(secondblock, flags, phases, SYNTHTEST_SAMPLES);
+  mismatches = CountMismatches(firstblock, secondblock);
+
+  synth->Reset(43);
+  synth->GenerateBlock(secondblock, NULL, NULL, SYNTHTEST_SAMPLES);
+
+  cout << "Same seed: " << mismatches << " mismatches.  Different seed: "
+    << CountMismatches(firstblock, secondblock) << " mismatches.\n";
+
+  is_ok = is_ok && (0 == mismatches)
+    && (SYNTHTEST_SAMPLES < CountMismatches(firstblock, secondblock))
+    && (43 == synth->GetSeed())
+    && (SYNTHTEST_SAMPLES == synth->GetSampleCount());
+
+
+  // Labels. With no background, output is zero outside bursts, and inside
+  // bursts its sign matches the phase label.
+
+  synth->SetBackgroundAmplitude(0);
+  synth->SetBurstAmplitude(SYNTHTEST_BURSTAMP);
+  synth->SetBurstPeriods(SYNTHTEST_MINPERIOD, SYNTHTEST_MAXPERIOD);
+  synth->SetBurstCycles(SYNTHTEST_MINCYCLES, SYNTHTEST_MAXCYCLES);
+  synth->SetBurstGaps(SYNTHTEST_MINGAP, SYNTHTEST_MAXGAP);
+  synth->Reset(7);
+  synth->GenerateBlock(firstblock, flags, phases, SYNTHTEST_SAMPLES);
+
+  runcount = 0;
+  badlengths = 0;
+  badgaps = 0;
+  badsigns = 0;
+  badsteps = 0;
+  badquiet = 0;
+
+  for (cidx = 0; cidx < SYNTHTEST_CHANS; cidx++)
+  {
+    runlen = 0;
+    gaplen = -1;
+
+    for (sidx = 0; sidx < SYNTHTEST_SAMPLES; sidx++)
+    {
+      thisval = firstblock[sidx].data[0][cidx];
+
+      if (flags[sidx].data[0][cidx])
+      {
+        // Sign should follow phase, away from zero crossings.
+        if ( (thisval > 1000) && (phases[sidx].data[0][cidx] >= 32768) )
+          badsigns++;
+        if ( (thisval < -1000) && (phases[sidx].data[0][cidx] < 32768) )
+          badsigns++;
+
+        // Phase should advance by one period's step.
+        if (0 < runlen)
+        {
+          step = (uint16_t) ( phases[sidx].data[0][cidx]
+            - phases[sidx - 1].data[0][cidx] );
+          if ( (step < (65536 / SYNTHTEST_MAXPERIOD) - 2)
+            || (step > (65536 / SYNTHTEST_MINPERIOD) + 2) )
+            badsteps++;
+        }
+
+        if (0 < gaplen)
+          if ( (gaplen < SYNTHTEST_MINGAP) || (gaplen > SYNTHTEST_MAXGAP) )
+            badgaps++;
+
+        if (0 == runlen)
+          runcount++;
+        runlen++;
+        gaplen = 0;
+      }
+      else
+      {
+        if (0 != thisval)
+          badquiet++;
+
+        // Only check complete bursts.
+        if ( (0 < runlen) && (0 <= gaplen) )
+          if ( (runlen < SYNTHTEST_MINPERIOD * SYNTHTEST_MINCYCLES)
+            || (runlen > SYNTHTEST_MAXPERIOD * SYNTHTEST_MAXCYCLES) )
+            badlengths++;
+
+        runlen = 0;
+        if (0 <= gaplen)
+          gaplen++;
+      }
+    }
+  }
+
+  cout << "Labels: " << runcount << " bursts (" << synth->GetBurstCount()
+    << " started), " << badlengths << " bad lengths, " << badgaps
+    << " bad gaps, " << badsteps << " bad phase steps, " << badsigns
+    << " bad signs, " << badquiet << " non-zero quiet samples.\n";
+
+  is_ok = is_ok && (100 < runcount)
+    && ( ((uint64_t) runcount) == synth->GetBurstCount() )
+    && (0 == badlengths) && (0 == badgaps) && (0 == badsteps)
+    && (0 == badsigns) && (0 == badquiet);
+
+
+  // Throughput, with default settings.
+
+  synth->ResetDefaults();
+  synth->Reset(1);
+
+  tstart = chrono::steady_clock::now();
+  synth->GenerateBlock(firstblock, flags, phases, SYNTHTEST_SAMPLES);
+  elapsed = chrono::duration<double>(
+    chrono::steady_clock::now() - tstart ).count();
+
+  cout << "Generated " << SYNTHTEST_SAMPLES << " samples of "
+    << SYNTHTEST_CHANS << " channels: "
+    << (SYNTHTEST_SAMPLES * SYNTHTEST_CHANS / (elapsed * 1.0e6))
+    << " Msamples/sec.\n";
+
+
+  cout << "Synthetic LFP test " << (is_ok ? "passed" : "FAILED") << ".\n";
+
+  delete synth;
+  delete[] firstblock;
+  delete[] secondblock;
+  delete[] flags;
+  delete[] phases;
+
+  // Ending banner.
+  cout << "\n== End of synthetic LFP test.\n\n";
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.
@@ -22,8 +22,177 @@
 
 using namespace std;
 
-#include <nloop-modules.h>
-#include <nloop-fileio.h>
+#include <math.h>
+
+#include <nloop-includes-workstation.h>
+
+
+//
+// Constants
+
+// Detection settings shared by the pipeline tests.
+#define TEST_THRESH_HIGH 5000
+#define TEST_THRESH_LOW 3000
+#define TEST_DEGLITCH_RISE 3
+#define TEST_DEGLITCH_FALL 10
+#define TEST_TARGET_DELAY 5
+
+
+//
+// Shared Test Fixtures
+
+// These set up the input and module configuration used by the pipeline
+// tests (pipelines, shards, stages, sweeps, and checkpoints), so that each
+// test only has to describe what it does differently.
+
+
+// This generates a deterministic test input: per-channel tones with
+// amplitude bursts and pseudorandom noise. Burst lengths repeat every 9
+// channels and tone periods repeat every 11 channels.
+
+template <class samptype_t, int chancount>
+void MakeBurstInput(int sampidx,
+  nloop_SampleSlice_t<samptype_t, 1, chancount> &indata)
+{
+  int cidx;
+  uint32_t noise;
+  double amplitude;
+
+  for (cidx = 0; cidx < chancount; cidx++)
+  {
+    noise = ((uint32_t) sampidx) * 2654435761u + ((uint32_t) cidx) * 40503u;
+    noise ^= noise >> 13;
+    noise *= 1274126177u;
+    noise ^= noise >> 16;
+
+    amplitude = ( 0 == ((sampidx / (400 + 50 * (cidx % 9))) % 2) ?
+      2000 : 30000 );
+
+    indata.data[0][cidx] = (samptype_t) ( amplitude
+      * sin( 6.2832 * sampidx / (20.0 + 3 * (cidx % 11)) ) )
+      + (samptype_t) (noise % 2001) - 1000;
+  }
+}
+
+
+
+// This configures an auto-ranger to latch its gain after 500 samples.
+
+template <class ranger_t>
+void ConfigureTestRanger(ranger_t &ranger)
+{
+  ranger.SetDesiredRange(-20000, 20000);
+  ranger.ResetTracking(false);
+  ranger.LatchAfter(500);
+}
+
+
+
+// This gives each bank gentle first-order sections with unity DC gain.
+
+template <class filtbank_t>
+void ConfigureTestBiquads(filtbank_t &biquads, int bankcount,
+  int stagecount)
+{
+  int bidx, sidx;
+
+  biquads.SetActiveStages(stagecount);
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+    for (sidx = 0; sidx < stagecount; sidx++)
+      biquads.SetCoefficients( sidx, bidx, 8,
+        -128 + 16 * bidx, 0, 64 - 8 * bidx, 64 - 8 * bidx, 0 );
+}
+
+
+
+// This gives each bank a boxcar filter; later banks are longer.
+
+template <class filtbank_t>
+void ConfigureTestFIRs(filtbank_t &firs, int bankcount)
+{
+  int bidx, tidx;
+
+  for (bidx = 0; bidx < bankcount; bidx++)
+  {
+    firs.SetOneGeometry(bidx, 4, 4 + 4 * bidx);
+    for (tidx = 0; tidx < 4 + 4 * bidx; tidx++)
+      firs.SetOneCoefficient(bidx, tidx, 16 / (1 + bidx));
+  }
+}
+
+
+
+// This resets an analytic estimator bank and sets per-bank minimum
+// periods.
+
+template <class samptype_t, class indextype_t, class estimator_t,
+  int bankcount, int chancount>
+void ConfigureTestAnalytic( nloop_AnalyticBank_PT_t<samptype_t, indextype_t,
+  estimator_t, bankcount, chancount> &analytic )
+{
+  nloop_SampleSlice_t<indextype_t, bankcount, 1> minperiods;
+  int bidx;
+
+  analytic.ResetState();
+  for (bidx = 0; bidx < bankcount; bidx++)
+    minperiods.data[bidx][0] = 8 + 4 * bidx;
+  analytic.SetMinPeriods(minperiods);
+}
+
+
+
+// This sets a slow averager, starting from zero.
+
+template <class samptype_t, uint8_t coeffbits, int bankcount, int chancount>
+void ConfigureTestAverager( nloop_AveragerBank_t<samptype_t, coeffbits,
+  bankcount, chancount> &averagers )
+{
+  nloop_SampleSlice_t<samptype_t, bankcount, chancount> zeroslice;
+
+  averagers.SetUniformCoeffs(256);
+  averagers.SetUniformAvgBits(5);
+  zeroslice.SetUniformValue(0);
+  averagers.InitAverage(zeroslice);
+}
+
+
+
+// This enables every trigger, with re-raising, for "windowsamps" samples
+// or "maxpulses" pulses.
+
+template <class indextype_t, int bankcount, int chancount>
+void ConfigureTestTriggers(
+  nloop_TriggerBank_t<indextype_t, bankcount, chancount> &triggers,
+  indextype_t windowsamps, indextype_t maxpulses )
+{
+  nloop_SampleSlice_t<bool, bankcount, chancount> enableflags;
+
+  enableflags.SetUniformValue(true);
+  triggers.SetEnableFlags(enableflags);
+  triggers.SetAllReRaises(true);
+  triggers.EnableTriggering(windowsamps, maxpulses);
+}
+
+
+
+// This configures the stages up to and including the deglitcher in
+// anything with the detection pipeline's accessors. Thresholds, targets,
+// triggers, and geometry are left to the caller.
+
+template <class pipeline_t>
+void ConfigureTestDetection(pipeline_t &pipe, int bankcount, int stagecount)
+{
+  ConfigureTestRanger(pipe.GetRanger());
+  pipe.SetAutoRange(true);
+
+  ConfigureTestBiquads(pipe.GetFilterBank(), bankcount, stagecount);
+  ConfigureTestAnalytic(pipe.GetAnalytic());
+  ConfigureTestAverager(pipe.GetAverager());
+
+  pipe.GetDeGlitcher().SetUniformDelays(TEST_DEGLITCH_RISE,
+    TEST_DEGLITCH_FALL);
+}
 
 
 //
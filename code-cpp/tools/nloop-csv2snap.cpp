@@ -0,0 +1,449 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Tool program - Convert CSV configuration files to a binary snapshot.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <fstream>
+
+
+//
+// Constants
+
+// Converter geometry. Modules are loaded into 64-bit banks this large, and
+// the populated part is written out.
+#define CSV2SNAP_MAXBANKS 64
+#define CSV2SNAP_MAXSTAGES 16
+#define CSV2SNAP_MAXCOEFFS 4096
+#define CSV2SNAP_MAXROWS 4096
+#define CSV2SNAP_MAXCHANS 1024
+
+// This doesn't affect storage; the averager needs something.
+#define CSV2SNAP_AVGCOEFFBITS 16
+
+
+//
+// Types
+
+typedef nloop_IIRFilterBank_t<int64_t, int,
+  CSV2SNAP_MAXSTAGES, CSV2SNAP_MAXBANKS, 1> conv_biquadbank_t;
+typedef nloop_FIRFilterBank_t<int64_t, int,
+  CSV2SNAP_MAXCOEFFS, CSV2SNAP_MAXCOEFFS, CSV2SNAP_MAXBANKS, 1>
+  conv_firbank_t;
+typedef nloop_LookupMonoStepPerBank_t<int64_t, int64_t,
+  CSV2SNAP_MAXROWS, CSV2SNAP_MAXBANKS, 1> conv_lutbank_t;
+typedef nloop_AveragerBank_t<int64_t, CSV2SNAP_AVGCOEFFBITS,
+  CSV2SNAP_MAXBANKS, CSV2SNAP_MAXCHANS> conv_avgbank_t;
+typedef nloop_TriggerBank_t<int64_t,
+  CSV2SNAP_MAXBANKS, CSV2SNAP_MAXCHANS> conv_trigbank_t;
+
+
+//
+// Helper Functions
+
+
+// This returns one more than the largest integer value in a column, or 0
+// if the column is missing or empty. Only matching rows are checked.
+
+int GetColumnExtent(nloop_CSVTable_t &table, string colname,
+  multimap<string,string> &criteria)
+{
+  vector<size_t> rowlist;
+  int cellidx, thisval, result;
+  long long cellval;
+  size_t ridx;
+
+  result = 0;
+
+  cellidx = table.FindColumn(colname);
+  if (cellidx < 0)
+    return 0;
+
+  table.SelectRows(criteria, rowlist);
+
+  for (ridx = 0; ridx < rowlist.size(); ridx++)
+  {
+    vector<string> &thisrow = table.GetRow(rowlist[ridx]);
+
+    // Malformed cells are reported when the table is read.
+    if ( (((size_t) cellidx) < thisrow.size())
+      && nloop_CSVCellToLL(thisrow[cellidx], cellval) )
+    {
+      thisval = (int) cellval;
+      if (thisval >= result)
+        result = thisval + 1;
+    }
+  }
+
+  return result;
+}
+
+
+
+// This returns the number of "bank N" columns in a table.
+
+int GetFIRBankExtent(nloop_CSVTable_t &table)
+{
+  vector<string> &colnames = table.GetColumnNames();
+  regex thisregex;
+  smatch thismatchlist;
+  int thisval, result;
+  size_t cidx;
+
+  result = 0;
+  thisregex = "bank\\s+(\\d+)";
+
+  for (cidx = 0; cidx < colnames.size(); cidx++)
+    if (regex_match(colnames[cidx], thismatchlist, thisregex))
+    {
+      thisval = stoi(thismatchlist[1]);
+      if (thisval >= result)
+        result = thisval + 1;
+    }
+
+  return result;
+}
+
+
+
+// This clamps a geometry value to the converter's limits, with a warning.
+
+int ClampExtent(int extent, int maxval, const char *label)
+{
+  if (extent > maxval)
+  {
+    cerr << "Warning: " << label << " count " << extent
+      << " exceeds converter limit " << maxval << "; truncating.\n";
+    extent = maxval;
+  }
+
+  return extent;
+}
+
+
+
+// This prints usage information.
+
+void PrintUsage(void)
+{
+  cerr <<
+"Usage:  nloop-csv2snap <output file> <spec> [<spec>...]\n"
+"\n"
+"Each <spec> is one of the following, optionally followed by match\n"
+"criteria of the form \"column=value\":\n"
+"\n"
+"  biquad <id> <csv file>\n"
+"  fir <id> <csv file> <fracbits>\n"
+"  lut <id> <csv file> <input column> <output column>\n"
+"  averager <id> <csv file>\n"
+"  trigger <id> <csv file>\n"
+"\n"
+"Section IDs are integers chosen by the user; they distinguish multiple\n"
+"sections of the same type. See SNAPSHOT.txt for details.\n"
+"\n"
+"Example:\n"
+"  nloop-csv2snap rig.snap biquad 0 filters.csv type=anti-alias \\\n"
+"    biquad 1 filters.csv type=bank\n";
+}
+
+
+
+// This converts one spec, adding a section to the snapshot.
+// It returns false on error.
+
+bool ConvertSpec(nloop_SnapshotWriter_t &snap, string spectype,
+  uint32_t sectid, string filename, vector<string> &specargs,
+  multimap<string,string> &criteria)
+{
+  nloop_CSVTable_t table;
+  ifstream infile;
+  map<int,int> bankremap;
+  vector<string> colnames;
+  long long cellvals[6];
+  int bankcount, extent;
+  bool read_ok;
+
+  bankremap.clear();
+  read_ok = true;
+
+  infile.open(filename.c_str());
+  if (!infile.is_open())
+  {
+    cerr << "Couldn't open \"" << filename << "\".\n";
+    return false;
+  }
+
+  if (!table.ReadTable(infile))
+  {
+    cerr << "No header in \"" << filename << "\".\n";
+    return false;
+  }
+
+  infile.close();
+
+
+  if ("biquad" == spectype)
+  {
+    conv_biquadbank_t *filtbank = new conv_biquadbank_t;
+
+    bankcount = ClampExtent( GetColumnExtent(table, "bank", criteria),
+      CSV2SNAP_MAXBANKS, "Bank" );
+    extent = ClampExtent( GetColumnExtent(table, "stage", criteria),
+      CSV2SNAP_MAXSTAGES, "Stage" );
+
+    filtbank->BlankCoefficients();
+    read_ok = nloop_ReadBiquadCoeffs<int64_t>(table, *filtbank,
+      criteria, bankremap);
+    filtbank->SetActiveBanks(bankcount);
+    filtbank->SetActiveStages(extent);
+
+    if (read_ok)
+      nloop_WriteBiquadSnapshot<int64_t>(snap, sectid, *filtbank);
+
+    delete filtbank;
+  }
+  else if ("fir" == spectype)
+  {
+    conv_firbank_t *filtbank = new conv_firbank_t;
+
+    if (specargs.size() < 1)
+    {
+      cerr << "FIR specs need a fracbits value.\n";
+      delete filtbank;
+      return false;
+    }
+
+    bankcount = ClampExtent( GetFIRBankExtent(table),
+      CSV2SNAP_MAXBANKS, "Bank" );
+
+    filtbank->BlankAllFilters();
+    read_ok = nloop_ReadFIRCoeffs<int64_t, int>( table, *filtbank,
+      (uint8_t) stoi(specargs[0]), criteria, bankremap );
+    filtbank->SetActiveBanks(bankcount);
+
+    if (read_ok)
+      nloop_WriteFIRSnapshot<int64_t, int>(snap, sectid, *filtbank);
+
+    delete filtbank;
+  }
+  else if ("lut" == spectype)
+  {
+    conv_lutbank_t *lut = new conv_lutbank_t;
+
+    if (specargs.size() < 2)
+    {
+      cerr << "LUT specs need input and output column names.\n";
+      delete lut;
+      return false;
+    }
+
+    // Tables without a "bank" column are single LUTs.
+    bankcount = GetColumnExtent(table, "bank", criteria);
+    if (table.FindColumn("bank") < 0)
+      bankcount = 1;
+    bankcount = ClampExtent(bankcount, CSV2SNAP_MAXBANKS, "Bank");
+    extent = ClampExtent( GetColumnExtent(table, "row", criteria),
+      CSV2SNAP_MAXROWS, "Row" );
+
+    lut->BlankTables();
+    read_ok = nloop_ReadLookupTablePerBank<int64_t, int64_t>( table, *lut,
+      specargs[0], specargs[1], criteria, bankremap );
+    lut->SetActiveBanks(bankcount);
+    lut->SetActiveRows(extent);
+
+    if (read_ok)
+      nloop_WriteLookupTablePerBankSnapshot<int64_t, int64_t>(
+        snap, sectid, *lut );
+
+    delete lut;
+  }
+  else if ("averager" == spectype)
+  {
+    conv_avgbank_t *avgbank = new conv_avgbank_t;
+    nloop_CSVIntegerReader_t reader;
+
+    bankcount = ClampExtent( GetColumnExtent(table, "bank", criteria),
+      CSV2SNAP_MAXBANKS, "Bank" );
+    extent = ClampExtent( GetColumnExtent(table, "chan", criteria),
+      CSV2SNAP_MAXCHANS, "Channel" );
+
+    colnames.push_back("bank");
+    colnames.push_back("chan");
+    colnames.push_back("coeff");
+    colnames.push_back("avgbits");
+
+    reader.AttachTable(table);
+    reader.SelectColumns(colnames);
+    reader.SetCriteria(criteria);
+
+    while (reader.ReadRow(cellvals))
+    {
+      avgbank->SetOneCoeff( (int) cellvals[0], (int) cellvals[1],
+        cellvals[2] );
+      avgbank->SetOneAvgBits( (int) cellvals[0], (int) cellvals[1],
+        (uint8_t) cellvals[3] );
+    }
+
+    read_ok = (0 == reader.GetBadCellCount());
+    avgbank->SetActiveBanks(bankcount);
+    avgbank->SetActiveChans(extent);
+
+    if (read_ok)
+      nloop_WriteAveragerSnapshot<int64_t>(snap, sectid, *avgbank);
+
+    delete avgbank;
+  }
+  else if ("trigger" == spectype)
+  {
+    conv_trigbank_t *trigbank = new conv_trigbank_t;
+    nloop_CSVIntegerReader_t reader;
+
+    bankcount = ClampExtent( GetColumnExtent(table, "bank", criteria),
+      CSV2SNAP_MAXBANKS, "Bank" );
+    extent = ClampExtent( GetColumnExtent(table, "chan", criteria),
+      CSV2SNAP_MAXCHANS, "Channel" );
+
+    colnames.push_back("bank");
+    colnames.push_back("chan");
+    colnames.push_back("enabled");
+    colnames.push_back("duration");
+    colnames.push_back("cooldown");
+    colnames.push_back("reraise");
+
+    reader.AttachTable(table);
+    reader.SelectColumns(colnames);
+    reader.SetCriteria(criteria);
+
+    while (reader.ReadRow(cellvals))
+    {
+      trigbank->SetOneEnableFlag( (int) cellvals[0], (int) cellvals[1],
+        (0 != cellvals[2]) );
+      trigbank->SetOnePulseDuration( (int) cellvals[0], (int) cellvals[1],
+        cellvals[3] );
+      trigbank->SetOnePulseCooldown( (int) cellvals[0], (int) cellvals[1],
+        cellvals[4] );
+      trigbank->SetOneReRaise( (int) cellvals[0], (int) cellvals[1],
+        (0 != cellvals[5]) );
+    }
+
+    read_ok = (0 == reader.GetBadCellCount());
+    trigbank->SetActiveBanks(bankcount);
+    trigbank->SetActiveChans(extent);
+
+    if (read_ok)
+      nloop_WriteTriggerSnapshot<int64_t>(snap, sectid, *trigbank);
+
+    delete trigbank;
+  }
+  else
+  {
+    cerr << "Unknown section type \"" << spectype << "\".\n";
+    return false;
+  }
+
+  if (!read_ok)
+  {
+    cerr << "Malformed integer cells in \"" << filename << "\".\n";
+    return false;
+  }
+
+  return true;
+}
+
+
+
+//
+// Main Program
+
+
+int main(int argc, char **argv)
+{
+  nloop_SnapshotWriter_t snap;
+  multimap<string,string> criteria;
+  vector<string> specargs;
+  string spectype, filename, thisarg;
+  size_t eqpos;
+  uint32_t sectid;
+  int aidx, fixedcount;
+
+  if (argc < 5)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+
+  // Walk through the specs.
+
+  aidx = 2;
+  while (aidx < argc)
+  {
+    spectype = argv[aidx];
+
+    // Number of arguments after the file name.
+    fixedcount = 0;
+    if ("fir" == spectype)
+      fixedcount = 1;
+    else if ("lut" == spectype)
+      fixedcount = 2;
+
+    if (aidx + 2 + fixedcount >= argc)
+    {
+      cerr << "Not enough arguments for \"" << spectype << "\".\n";
+      PrintUsage();
+      return 1;
+    }
+
+    sectid = (uint32_t) stoul(argv[aidx + 1]);
+    filename = argv[aidx + 2];
+    aidx += 3;
+
+    specargs.clear();
+    for (; fixedcount > 0; fixedcount--)
+    {
+      specargs.push_back(argv[aidx]);
+      aidx++;
+    }
+
+    // Criteria continue until the next argument without an "=".
+    criteria.clear();
+    while (aidx < argc)
+    {
+      thisarg = argv[aidx];
+      eqpos = thisarg.find('=');
+      if (string::npos == eqpos)
+        break;
+
+      criteria.insert(pair<string,string>(
+        thisarg.substr(0, eqpos), thisarg.substr(eqpos + 1) ));
+      aidx++;
+    }
+
+    if (!ConvertSpec(snap, spectype, sectid, filename, specargs, criteria))
+      return 1;
+  }
+
+
+  // Write the snapshot.
+
+  if (!snap.WriteToFile(argv[1]))
+  {
+    cerr << "Couldn't write \"" << argv[1] << "\".\n";
+    return 1;
+  }
+
+  cout << "Wrote " << snap.GetSectionCount() << " section(s) to \""
+    << argv[1] << "\".\n";
+
+  return 0;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,431 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Tool program - Fixed-point headroom analysis for filter coefficients.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <fstream>
+
+
+//
+// Constants
+
+// Analyzer geometry. Coefficients are loaded into 64-bit banks this large,
+// so that any coefficient set can be read without overflow.
+#define HEADROOM_MAXBANKS 64
+#define HEADROOM_MAXSTAGES 16
+#define HEADROOM_MAXCOEFFS 4096
+
+
+//
+// Types
+
+typedef nloop_IIRFilterBank_t<int64_t, int,
+  HEADROOM_MAXSTAGES, HEADROOM_MAXBANKS, 1> head_biquadbank_t;
+typedef nloop_FIRFilterBank_t<int64_t, int,
+  HEADROOM_MAXCOEFFS, HEADROOM_MAXCOEFFS, HEADROOM_MAXBANKS, 1>
+  head_firbank_t;
+
+
+//
+// Helper Functions
+
+
+// This returns one more than the largest integer value in a column, or 0
+// if the column is missing or empty. Only matching rows are checked.
+
+int GetColumnExtent(nloop_CSVTable_t &table, string colname,
+  multimap<string,string> &criteria)
+{
+  vector<size_t> rowlist;
+  int cellidx, thisval, result;
+  long long cellval;
+  size_t ridx;
+
+  result = 0;
+
+  cellidx = table.FindColumn(colname);
+  if (cellidx < 0)
+    return 0;
+
+  table.SelectRows(criteria, rowlist);
+
+  for (ridx = 0; ridx < rowlist.size(); ridx++)
+  {
+    vector<string> &thisrow = table.GetRow(rowlist[ridx]);
+
+    // Malformed cells are reported when the table is read.
+    if ( (((size_t) cellidx) < thisrow.size())
+      && nloop_CSVCellToLL(thisrow[cellidx], cellval) )
+    {
+      thisval = (int) cellval;
+      if (thisval >= result)
+        result = thisval + 1;
+    }
+  }
+
+  return result;
+}
+
+
+
+// This returns the number of "bank N" columns in a table.
+
+int GetFIRBankExtent(nloop_CSVTable_t &table)
+{
+  vector<string> &colnames = table.GetColumnNames();
+  regex thisregex;
+  smatch thismatchlist;
+  int thisval, result;
+  size_t cidx;
+
+  result = 0;
+  thisregex = "bank\\s+(\\d+)";
+
+  for (cidx = 0; cidx < colnames.size(); cidx++)
+    if (regex_match(colnames[cidx], thismatchlist, thisregex))
+    {
+      thisval = stoi(thismatchlist[1]);
+      if (thisval >= result)
+        result = thisval + 1;
+    }
+
+  return result;
+}
+
+
+
+// This prints usage information.
+
+void PrintUsage(void)
+{
+  cerr <<
+"Usage:  nloop-headroom <input min> <input max> <spec> [<spec>...]\n"
+"\n"
+"The input range is the range given to the auto-ranger (the \"autorange\"\n"
+"keyword in nloop-run configuration files).\n"
+"\n"
+"Each <spec> is one of the following, optionally followed by match\n"
+"criteria of the form \"column=value\":\n"
+"\n"
+"  biquad <csv file>\n"
+"  fir <csv file> <fracbits>\n"
+"  margin <bits>\n"
+"\n"
+"\"margin\" sets the number of guard bits required for specs after it\n"
+"(default " << NLOOP_HEADROOM_DEFAULT_MARGIN_BITS << ").\n"
+"\n"
+"For each bank and stage, this reports the worst-case output range, the\n"
+"worst-case accumulator magnitude, and the typical output peak, followed\n"
+"by the narrowest sample and accumulator types that are safe and the\n"
+"largest den0_bits (or fracbits) each stage could use with those types.\n"
+"\n"
+"Example:\n"
+"  nloop-headroom -16384 16383 biquad filters.csv type=bank set=1\n";
+}
+
+
+
+// This prints one stage's bounds as a table row.
+
+void PrintStage(const char *label, int index, nloop_HeadroomStage_t &stage)
+{
+  if (!stage.is_stable)
+  {
+    cout << "  " << label << " " << index
+      << ":  UNSTABLE (or doesn't decay); no bound.\n";
+    return;
+  }
+
+  cout << "  " << label << " " << index << ":  bits " << (int) stage.den0bits
+    << ",  output " << stage.worst_min << " to " << stage.worst_max
+    << " (" << stage.sample_bits << " bits),  accum " << stage.worst_accum
+    << " (" << stage.accum_bits << " bits),  typical " << stage.typical_peak
+    << " (" << stage.typical_bits << " bits)\n";
+}
+
+
+
+// This prints the type recommendations for a list of stages. If "label"
+// isn't NULL, the largest usable den0_bits is printed for each stage.
+
+void PrintSummary(double inmin, double inmax,
+  vector<nloop_HeadroomStage_t> &stages, int marginbits, const char *label)
+{
+  int samplebits, accumbits, maxbits;
+  size_t sidx;
+
+  samplebits = nloop_HeadroomPickSampleBits(inmin, inmax, stages,
+    marginbits);
+  accumbits = nloop_HeadroomPickAccumBits(stages, marginbits);
+
+  // The accumulator is never narrower than the samples.
+  if ((0 < samplebits) && (0 < accumbits) && (accumbits < samplebits))
+    accumbits = samplebits;
+
+  cout << "  Narrowest samptype_t:   "
+    << nloop_HeadroomTypeName(samplebits) << "\n";
+  cout << "  Narrowest accumtype_t:  "
+    << nloop_HeadroomTypeName(accumbits) << "\n";
+
+  if ((0 == samplebits) || (0 == accumbits) || (NULL == label))
+    return;
+
+  for (sidx = 0; sidx < stages.size(); sidx++)
+  {
+    maxbits = nloop_HeadroomMaxDen0Bits( stages[sidx],
+      samplebits, accumbits, marginbits );
+
+    cout << "  Largest den0_bits, " << label << " " << sidx << ":  "
+      << maxbits
+      << " (using " << (int) stages[sidx].den0bits << ")\n";
+  }
+}
+
+
+
+// This analyzes one spec and prints the results. Stages from every bank
+// are appended to "allstages".
+// It returns false on error.
+
+bool AnalyzeSpec(string spectype, string filename,
+  vector<string> &specargs, multimap<string,string> &criteria,
+  double inmin, double inmax, int marginbits,
+  vector<nloop_HeadroomStage_t> &allstages)
+{
+  nloop_CSVTable_t table;
+  ifstream infile;
+  map<int,int> bankremap;
+  vector<nloop_HeadroomStage_t> bankstages;
+  nloop_HeadroomStage_t thisstage;
+  int bankcount, extent, bidx;
+  size_t sidx;
+
+  bankremap.clear();
+
+  infile.open(filename.c_str());
+  if (!infile.is_open())
+  {
+    cerr << "Couldn't open \"" << filename << "\".\n";
+    return false;
+  }
+
+  if (!table.ReadTable(infile))
+  {
+    cerr << "No header in \"" << filename << "\".\n";
+    return false;
+  }
+
+  infile.close();
+
+  cout << spectype << " \"" << filename << "\"";
+  for (multimap<string,string>::iterator citer = criteria.begin();
+    citer != criteria.end(); citer++)
+    cout << " " << citer->first << "=" << citer->second;
+  cout << "\n";
+
+
+  if ("biquad" == spectype)
+  {
+    head_biquadbank_t *filtbank = new head_biquadbank_t;
+
+    bankcount = min( GetColumnExtent(table, "bank", criteria),
+      HEADROOM_MAXBANKS );
+    extent = min( GetColumnExtent(table, "stage", criteria),
+      HEADROOM_MAXSTAGES );
+
+    filtbank->BlankCoefficients();
+    if (!nloop_ReadBiquadCoeffs<int64_t>(table, *filtbank,
+      criteria, bankremap))
+    {
+      cerr << "Malformed integer cells in \"" << filename << "\".\n";
+      delete filtbank;
+      return false;
+    }
+    filtbank->SetActiveBanks(bankcount);
+    filtbank->SetActiveStages(extent);
+
+    for (bidx = 0; bidx < bankcount; bidx++)
+    {
+      cout << "bank " << bidx << ":\n";
+
+      bankstages.clear();
+      nloop_HeadroomBiquadBank<int64_t>( *filtbank, bidx, inmin, inmax,
+        bankstages );
+
+      for (sidx = 0; sidx < bankstages.size(); sidx++)
+      {
+        PrintStage("stage", sidx, bankstages[sidx]);
+        allstages.push_back(bankstages[sidx]);
+      }
+
+      PrintSummary(inmin, inmax, bankstages, marginbits, "stage");
+    }
+
+    delete filtbank;
+  }
+  else if ("fir" == spectype)
+  {
+    head_firbank_t *filtbank = new head_firbank_t;
+
+    if (specargs.size() < 1)
+    {
+      cerr << "FIR specs need a fracbits value.\n";
+      delete filtbank;
+      return false;
+    }
+
+    bankcount = min( GetFIRBankExtent(table), HEADROOM_MAXBANKS );
+
+    filtbank->BlankAllFilters();
+    if (!nloop_ReadFIRCoeffs<int64_t, int>( table, *filtbank,
+      (uint8_t) stoi(specargs[0]), criteria, bankremap ))
+    {
+      cerr << "Malformed integer cells in \"" << filename << "\".\n";
+      delete filtbank;
+      return false;
+    }
+    filtbank->SetActiveBanks(bankcount);
+
+    bankstages.clear();
+    for (bidx = 0; bidx < bankcount; bidx++)
+    {
+      nloop_HeadroomFIRBank<int64_t, int>( *filtbank, bidx, inmin, inmax,
+        thisstage );
+
+      PrintStage("bank", bidx, thisstage);
+      bankstages.push_back(thisstage);
+      allstages.push_back(thisstage);
+    }
+
+    PrintSummary(inmin, inmax, bankstages, marginbits, "bank");
+
+    delete filtbank;
+  }
+  else
+  {
+    cerr << "Unknown spec type \"" << spectype << "\".\n";
+    return false;
+  }
+
+  cout << "\n";
+
+  return true;
+}
+
+
+
+//
+// Main Program
+
+
+int main(int argc, char **argv)
+{
+  multimap<string,string> criteria;
+  vector<string> specargs;
+  vector<nloop_HeadroomStage_t> allstages;
+  string spectype, filename, thisarg;
+  double inmin, inmax;
+  size_t eqpos;
+  int aidx, fixedcount, marginbits;
+
+  if (argc < 5)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  inmin = stod(argv[1]);
+  inmax = stod(argv[2]);
+  marginbits = NLOOP_HEADROOM_DEFAULT_MARGIN_BITS;
+
+  if (inmax < inmin)
+  {
+    cerr << "Input range is backwards.\n";
+    return 1;
+  }
+
+  cout << "Input range " << inmin << " to " << inmax << " ("
+    << nloop_HeadroomBitsNeeded(inmin, inmax) << " bits).\n\n";
+
+
+  // Walk through the specs.
+
+  aidx = 3;
+  while (aidx < argc)
+  {
+    spectype = argv[aidx];
+
+    if ("margin" == spectype)
+    {
+      if (aidx + 1 >= argc)
+      {
+        cerr << "Not enough arguments for \"margin\".\n";
+        PrintUsage();
+        return 1;
+      }
+
+      marginbits = stoi(argv[aidx + 1]);
+      aidx += 2;
+      continue;
+    }
+
+    // Number of arguments after the file name.
+    fixedcount = 0;
+    if ("fir" == spectype)
+      fixedcount = 1;
+
+    if (aidx + 1 + fixedcount >= argc)
+    {
+      cerr << "Not enough arguments for \"" << spectype << "\".\n";
+      PrintUsage();
+      return 1;
+    }
+
+    filename = argv[aidx + 1];
+    aidx += 2;
+
+    specargs.clear();
+    for (; fixedcount > 0; fixedcount--)
+    {
+      specargs.push_back(argv[aidx]);
+      aidx++;
+    }
+
+    // Criteria continue until the next argument without an "=".
+    criteria.clear();
+    while (aidx < argc)
+    {
+      thisarg = argv[aidx];
+      eqpos = thisarg.find('=');
+      if (string::npos == eqpos)
+        break;
+
+      criteria.insert(pair<string,string>(
+        thisarg.substr(0, eqpos), thisarg.substr(eqpos + 1) ));
+      aidx++;
+    }
+
+    if (!AnalyzeSpec( spectype, filename, specargs, criteria,
+      inmin, inmax, marginbits, allstages ))
+      return 1;
+  }
+
+
+  // Report types that work for everything.
+
+  cout << "All specs:\n";
+  PrintSummary(inmin, inmax, allstages, marginbits, NULL);
+
+  return 0;
+}
+
+
+//
+// This is the end of the file.
@@ -0,0 +1,1621 @@
+// Attention Circuits Control Laboratory - NeuroLoop project
+// Tool program - Offline batch runner.
+// Written by Christopher Thomas.
+// Copyright (c) 2020 by Vanderbilt University. This work is licensed under
+// the Creative Commons Attribution 4.0 International License.
+
+
+// This streams a recording through a complete detection pipeline:
+// auto-ranging, a biquad filter bank, analytic signal estimation,
+// averaging, thresholding, and triggering. Detected bursts and trigger
+// pulses are written to CSV files, and throughput is reported.
+// See RUNCONFIG.txt for the configuration file format.
+
+// Input can also be synthetic LFP with ground truth labels (see
+// nloop-synth.h). In that case detection latency, hit and false alarm
+// rates, and trigger phase error are reported as well.
+
+// Processing is done in blocks: each stage runs over every slice in the
+// block before the next stage starts, so that each module's coefficients
+// and state stay in cache while it's running.
+
+// If the configuration lists sweep variants, the run is a parameter sweep
+// instead (see nloop-sweep.h). Auto-ranging, filtering, and analytic
+// signal estimation are done once, and each variant's averaging,
+// detection, and triggering runs on a worker thread. A summary line is
+// reported for each variant, and no event files are written.
+
+
+//
+// Includes
+
+#include "nloop-includes-workstation.h"
+
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <math.h>
+
+
+//
+// Constants
+
+// Runner geometry. Recordings and filter banks up to this size can be
+// processed.
+// NOTE - Thresholding and deglitching don't have active geometry, so they
+// always process this many banks and channels. Keep these close to what
+// your rig uses.
+#define NLOOPRUN_MAXBANKS 8
+#define NLOOPRUN_MAXCHANS 64
+#define NLOOPRUN_MAXSTAGES 8
+#define NLOOPRUN_MAXLUTROWS 256
+
+// Largest block size, in slices.
+#define NLOOPRUN_MAXBLOCK 1024
+#define NLOOPRUN_DEFAULTBLOCK 64
+
+// Averager coefficient bits.
+#define NLOOPRUN_AVGCOEFFBITS 8
+
+// Largest trigger window and pulse count. These are indextype_t (int).
+#define NLOOPRUN_MAXCOUNT 0x7fffffff
+
+// Largest number of sweep variants.
+#define NLOOPRUN_MAXVARIANTS 256
+
+
+//
+// Types
+
+typedef int32_t run_samp_t;
+typedef int run_index_t;
+
+typedef nloop_SampleSlice_t<run_samp_t, 1, NLOOPRUN_MAXCHANS> run_inslice_t;
+typedef nloop_SampleSlice_t<run_samp_t, NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS>
+  run_sampslice_t;
+typedef nloop_SampleSlice_t<run_index_t, NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS>
+  run_indexslice_t;
+typedef nloop_SampleSlice_t<bool, NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS>
+  run_flagslice_t;
+
+typedef nloop_IIRFilterBank_t<run_samp_t, run_index_t, NLOOPRUN_MAXSTAGES,
+  NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> run_biquads_t;
+typedef nloop_Analytic_PTZC_t<run_samp_t, run_index_t> run_estimator_t;
+
+typedef nloop_SweepPipeline_t<run_samp_t, run_index_t, run_biquads_t,
+  run_estimator_t, NLOOPRUN_AVGCOEFFBITS,
+  NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> run_sweep_t;
+
+
+// One sweep variant. Settings that aren't overridden come from the rest
+// of the configuration file.
+
+struct run_variant_t
+{
+  string label;
+
+  bool want_thresholds;
+  run_samp_t thresh_high, thresh_low;
+
+  bool want_average;
+  run_samp_t avg_coeff;
+  uint8_t avg_bits;
+
+  bool want_deglitch;
+  run_index_t deglitch_rise, deglitch_fall;
+
+  bool want_target;
+  run_index_t trigger_target;
+};
+
+
+// Runner configuration, as read from the configuration file.
+
+struct run_config_t
+{
+  // Input.
+  string input_name;
+  bool is_edf;
+  bool is_synth;
+  int synth_chans;
+  long long synth_frames;
+  uint64_t synth_seed;
+  nloop_rawtype_t raw_type;
+  int raw_chans;
+  size_t raw_header;
+  double samprate;
+  bool want_scale;
+  double scale_gain;
+  long long scale_offset;
+  bool want_physical;
+  double physical_units;
+  int blocksize;
+
+  // Auto-ranging.
+  bool want_autorange;
+  run_samp_t range_min, range_max;
+  run_index_t range_latch;
+
+  // Averaging.
+  run_samp_t avg_coeff;
+  uint8_t avg_bits;
+
+  // Detection.
+  run_index_t deglitch_rise, deglitch_fall;
+
+  // Triggering.
+  bool have_lut;
+  run_index_t trigger_target;
+  long long trigger_window, trigger_count;
+
+  // Scoring (synthetic input only).
+  double score_phase;
+  run_index_t score_late;
+
+  // Output.
+  string bursts_name;
+  string triggers_name;
+
+  // Parameter sweep. There's no sweep if "variants" is empty.
+  vector<run_variant_t> variants;
+  int sweep_threads;
+  string sweep_name;
+};
+
+
+// The pipeline. This is large, so allocate it on the heap.
+
+struct run_pipeline_t
+{
+  // Active geometry.
+  int banks;
+  int chans;
+
+  // Modules.
+  nloop_AutoRanger_t<run_samp_t, run_index_t, NLOOPRUN_MAXCHANS> ranger;
+  run_biquads_t biquads;
+  nloop_AnalyticBank_PT_t<run_samp_t, run_index_t, run_estimator_t,
+    NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> analytic;
+  nloop_AveragerBank_t<run_samp_t, NLOOPRUN_AVGCOEFFBITS,
+    NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> averagers;
+  nloop_ThresholdSingleBank_t<run_samp_t,
+    NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> threshsingle;
+  nloop_ThresholdDualBank_t<NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS>
+    threshdual;
+  nloop_DeGlitcherBank_t<run_index_t, NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS>
+    deglitch;
+  nloop_LookupMonoStepPerBank_t<run_index_t, run_index_t,
+    NLOOPRUN_MAXLUTROWS, NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> targetlut;
+  nloop_TriggerBank_t<run_index_t, NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS>
+    triggers;
+
+  // Configuration that isn't held by modules.
+  run_sampslice_t thresh_high, thresh_low;
+  run_indexslice_t targets;
+
+  // Per-slice scratch for the detection stage.
+  run_flagslice_t flag_high, flag_low, detected;
+
+  // Per-block intermediate slices.
+  run_inslice_t inblock[NLOOPRUN_MAXBLOCK];
+  run_sampslice_t filtblock[NLOOPRUN_MAXBLOCK];
+  run_sampslice_t magblock[NLOOPRUN_MAXBLOCK];
+  run_sampslice_t avgblock[NLOOPRUN_MAXBLOCK];
+  run_indexslice_t periodblock[NLOOPRUN_MAXBLOCK];
+  run_indexslice_t riseblock[NLOOPRUN_MAXBLOCK];
+  run_indexslice_t fallblock[NLOOPRUN_MAXBLOCK];
+  run_flagslice_t burstblock[NLOOPRUN_MAXBLOCK];
+  run_flagslice_t trigblock[NLOOPRUN_MAXBLOCK];
+
+  // Event tracking. Start times are -1 if no event is in progress.
+  long long burst_start[NLOOPRUN_MAXBANKS][NLOOPRUN_MAXCHANS];
+  run_samp_t burst_peak[NLOOPRUN_MAXBANKS][NLOOPRUN_MAXCHANS];
+  long long trig_start[NLOOPRUN_MAXBANKS][NLOOPRUN_MAXCHANS];
+  long long burst_total, trig_total;
+
+  // Synthetic input, ground truth, and scoring.
+  nloop_SynthLFP_t<run_samp_t, NLOOPRUN_MAXCHANS> synth;
+  nloop_SampleSlice_t<bool, 1, NLOOPRUN_MAXCHANS>
+    truthblock[NLOOPRUN_MAXBLOCK];
+  nloop_SampleSlice_t<uint16_t, 1, NLOOPRUN_MAXCHANS>
+    phaseblock[NLOOPRUN_MAXBLOCK];
+  nloop_DetectionScorer_t<NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> scorer;
+};
+
+
+//
+// Helper Functions
+
+
+// This prints usage information.
+
+void PrintUsage(void)
+{
+  cerr <<
+"Usage:  nloop-run <config file>\n"
+"\n"
+"Streams a recording through the configured detection pipeline, writing\n"
+"detected bursts and trigger pulses to CSV files.\n"
+"See RUNCONFIG.txt for the configuration file format.\n";
+}
+
+
+
+// This returns one more than the largest integer value in a column, or 0
+// if the column is missing or empty. Only matching rows are checked.
+
+int GetColumnExtent(nloop_CSVTable_t &table, string colname,
+  multimap<string,string> &criteria)
+{
+  vector<size_t> rowlist;
+  int cellidx, thisval, result;
+  long long cellval;
+  size_t ridx;
+
+  result = 0;
+
+  cellidx = table.FindColumn(colname);
+  if (cellidx < 0)
+    return 0;
+
+  table.SelectRows(criteria, rowlist);
+
+  for (ridx = 0; ridx < rowlist.size(); ridx++)
+  {
+    vector<string> &thisrow = table.GetRow(rowlist[ridx]);
+
+    // Malformed cells are reported when the table is read.
+    if ( (((size_t) cellidx) < thisrow.size())
+      && nloop_CSVCellToLL(thisrow[cellidx], cellval) )
+    {
+      thisval = (int) cellval;
+      if (thisval >= result)
+        result = thisval + 1;
+    }
+  }
+
+  return result;
+}
+
+
+
+// This reads a CSV file into a table. It returns false on error.
+
+bool LoadTable(string filename, nloop_CSVTable_t &table)
+{
+  ifstream infile;
+
+  infile.open(filename.c_str());
+  if (!infile.is_open())
+  {
+    cerr << "Couldn't open \"" << filename << "\".\n";
+    return false;
+  }
+
+  if (!table.ReadTable(infile))
+  {
+    cerr << "No header in \"" << filename << "\".\n";
+    return false;
+  }
+
+  return true;
+}
+
+
+
+// This extracts "column=value" match criteria from the end of a
+// configuration line, starting at "firstidx".
+
+void GetCriteria(vector<string> &tokens, size_t firstidx,
+  multimap<string,string> &criteria)
+{
+  size_t tidx, eqpos;
+
+  criteria.clear();
+
+  for (tidx = firstidx; tidx < tokens.size(); tidx++)
+  {
+    eqpos = tokens[tidx].find('=');
+    if (string::npos != eqpos)
+      criteria.insert(pair<string,string>(
+        tokens[tidx].substr(0, eqpos), tokens[tidx].substr(eqpos + 1) ));
+  }
+}
+
+
+
+// This sets configuration defaults.
+
+void InitConfig(run_config_t &config)
+{
+  config.input_name = "";
+  config.is_edf = false;
+  config.is_synth = false;
+  config.synth_chans = 0;
+  config.synth_frames = 0;
+  config.synth_seed = 1;
+  config.raw_type = NLOOP_RAW_INT16;
+  config.raw_chans = 0;
+  config.raw_header = 0;
+  config.samprate = 0;
+  config.want_scale = false;
+  config.scale_gain = 1.0;
+  config.scale_offset = 0;
+  config.want_physical = false;
+  config.physical_units = 1.0;
+  config.blocksize = NLOOPRUN_DEFAULTBLOCK;
+
+  config.want_autorange = false;
+  config.range_min = -20000;
+  config.range_max = 20000;
+  config.range_latch = 1000;
+
+  config.avg_coeff = 1 << NLOOPRUN_AVGCOEFFBITS;
+  config.avg_bits = 4;
+
+  config.deglitch_rise = 0;
+  config.deglitch_fall = 0;
+
+  config.have_lut = false;
+  config.trigger_target = 0;
+  config.trigger_window = NLOOPRUN_MAXCOUNT;
+  config.trigger_count = NLOOPRUN_MAXCOUNT;
+
+  config.score_phase = 0;
+  config.score_late = 0;
+
+  config.bursts_name = "";
+  config.triggers_name = "";
+
+  config.variants.clear();
+  config.sweep_threads = 0;
+  config.sweep_name = "";
+}
+
+
+
+// This parses a "sweep" line's overrides, of the form "name=value,value".
+// It returns false on error.
+
+bool ParseVariant(vector<string> &tokens, run_variant_t &variant)
+{
+  string thisname, firstval, secondval;
+  size_t tidx, eqpos, commapos;
+
+  variant.label = tokens[1];
+  variant.want_thresholds = false;
+  variant.want_average = false;
+  variant.want_deglitch = false;
+  variant.want_target = false;
+
+  if ("" == variant.label)
+  {
+    cerr << "Sweep variants need a label.\n";
+    return false;
+  }
+
+  for (tidx = 2; (tidx < tokens.size()) && ("" != tokens[tidx]); tidx++)
+  {
+    eqpos = tokens[tidx].find('=');
+    if (string::npos == eqpos)
+    {
+      cerr << "Sweep overrides look like \"name=value\", not \""
+        << tokens[tidx] << "\".\n";
+      return false;
+    }
+
+    thisname = tokens[tidx].substr(0, eqpos);
+    firstval = tokens[tidx].substr(eqpos + 1);
+    secondval = "";
+    commapos = firstval.find(',');
+    if (string::npos != commapos)
+    {
+      secondval = firstval.substr(commapos + 1);
+      firstval = firstval.substr(0, commapos);
+    }
+
+    if ( ("target" != thisname) && ("" == secondval) )
+    {
+      cerr << "Sweep override \"" << thisname << "\" needs two values.\n";
+      return false;
+    }
+
+    if ("thresholds" == thisname)
+    {
+      variant.want_thresholds = true;
+      variant.thresh_high = stoi(firstval);
+      variant.thresh_low = stoi(secondval);
+    }
+    else if ("average" == thisname)
+    {
+      variant.want_average = true;
+      variant.avg_coeff = stoi(firstval);
+      variant.avg_bits = (uint8_t) stoi(secondval);
+    }
+    else if ("deglitch" == thisname)
+    {
+      variant.want_deglitch = true;
+      variant.deglitch_rise = stoi(firstval);
+      variant.deglitch_fall = stoi(secondval);
+    }
+    else if ("target" == thisname)
+    {
+      variant.want_target = true;
+      variant.trigger_target = stoi(firstval);
+    }
+    else
+    {
+      cerr << "Unknown sweep override \"" << thisname << "\".\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+
+// This reads the configuration file and loads module configuration.
+// It returns false on error.
+
+bool ReadConfig(string filename, run_config_t &config, run_pipeline_t &pipe)
+{
+  ifstream infile;
+  string thisline, rawtype;
+  vector<string> tokens;
+  multimap<string,string> criteria;
+  map<int,int> bankremap;
+  nloop_CSVTable_t table;
+  nloop_CSVIntegerReader_t reader;
+  vector<string> colnames;
+  long long cellvals[6];
+  nloop_SampleSlice_t<run_index_t, NLOOPRUN_MAXBANKS, 1> minperiods;
+  run_flagslice_t enableflags;
+  run_variant_t thisvariant;
+  int linenum, bidx, stagecount, lutrows;
+  size_t tidx;
+  bool is_ok;
+
+  infile.open(filename.c_str());
+  if (!infile.is_open())
+  {
+    cerr << "Couldn't open \"" << filename << "\".\n";
+    return false;
+  }
+
+  bankremap.clear();
+
+  // Module defaults. Filter geometry comes from the coefficient file.
+  pipe.banks = 0;
+  pipe.biquads.BlankCoefficients();
+  for (bidx = 0; bidx < NLOOPRUN_MAXBANKS; bidx++)
+    minperiods.data[bidx][0] = 4;
+  pipe.thresh_high.SetUniformValue(0);
+  pipe.thresh_low.SetUniformValue(0);
+  pipe.targetlut.BlankTables();
+  pipe.triggers.ResetState();
+  enableflags.SetUniformValue(true);
+  pipe.triggers.SetEnableFlags(enableflags);
+
+  is_ok = true;
+  linenum = 0;
+
+  while ( is_ok && getline(infile, thisline) )
+  {
+    linenum++;
+
+    // Strip comments, and split into whitespace-delimited tokens.
+    if (string::npos != thisline.find('#'))
+      thisline = thisline.substr(0, thisline.find('#'));
+
+    {
+      istringstream linestream(thisline);
+      string thistoken;
+
+      tokens.clear();
+      while (linestream >> thistoken)
+        tokens.push_back(thistoken);
+    }
+
+    if (tokens.empty())
+      continue;
+
+    // Missing arguments show up as "not enough arguments" below.
+    tokens.resize(tokens.size() + 4, "");
+
+    if ("input" == tokens[0])
+    {
+      config.input_name = tokens[1];
+      rawtype = tokens[1].substr( tokens[1].find_last_of('.') + 1 );
+      config.is_edf = ( ("edf" == rawtype) || ("EDF" == rawtype)
+        || ("bdf" == rawtype) || ("BDF" == rawtype) );
+    }
+    else if ("synth_input" == tokens[0])
+    {
+      config.is_synth = true;
+      config.input_name = "synthetic LFP";
+      config.synth_chans = stoi(tokens[1]);
+      config.synth_frames = stoll(tokens[2]);
+      if ("" != tokens[3])
+        config.synth_seed = stoull(tokens[3]);
+
+      if ( (config.synth_chans < 1) || (config.synth_frames < 1) )
+      {
+        cerr << "Synthetic input needs at least one channel and frame.\n";
+        is_ok = false;
+      }
+    }
+    else if ("synth_amplitude" == tokens[0])
+    {
+      pipe.synth.SetBackgroundAmplitude(stoi(tokens[1]));
+      pipe.synth.SetBurstAmplitude(stoi(tokens[2]));
+    }
+    else if ("synth_periods" == tokens[0])
+      pipe.synth.SetBurstPeriods(stoi(tokens[1]), stoi(tokens[2]));
+    else if ("synth_cycles" == tokens[0])
+      pipe.synth.SetBurstCycles(stoi(tokens[1]), stoi(tokens[2]));
+    else if ("synth_gaps" == tokens[0])
+      pipe.synth.SetBurstGaps(stoi(tokens[1]), stoi(tokens[2]));
+    else if ("raw_format" == tokens[0])
+    {
+      if ("int16" == tokens[1])
+        config.raw_type = NLOOP_RAW_INT16;
+      else if ("uint16" == tokens[1])
+        config.raw_type = NLOOP_RAW_UINT16;
+      else if ("int32" == tokens[1])
+        config.raw_type = NLOOP_RAW_INT32;
+      else if ("float32" == tokens[1])
+        config.raw_type = NLOOP_RAW_FLOAT32;
+      else
+      {
+        cerr << "Unknown sample type \"" << tokens[1] << "\".\n";
+        is_ok = false;
+      }
+
+      if ("" != tokens[2])
+        config.raw_chans = stoi(tokens[2]);
+      if ("" != tokens[3])
+        config.raw_header = stoul(tokens[3]);
+    }
+    else if ("samprate" == tokens[0])
+      config.samprate = stod(tokens[1]);
+    else if ("input_scale" == tokens[0])
+    {
+      config.want_scale = true;
+      config.scale_gain = stod(tokens[1]);
+      config.scale_offset = ("" == tokens[2]) ? 0 : stoll(tokens[2]);
+    }
+    else if ("edf_physical" == tokens[0])
+    {
+      config.want_physical = true;
+      config.physical_units = stod(tokens[1]);
+    }
+    else if ("blocksize" == tokens[0])
+    {
+      config.blocksize = stoi(tokens[1]);
+      if ( (config.blocksize < 1) || (config.blocksize > NLOOPRUN_MAXBLOCK) )
+      {
+        cerr << "Block size must be 1.." << NLOOPRUN_MAXBLOCK << ".\n";
+        is_ok = false;
+      }
+    }
+    else if ("autorange" == tokens[0])
+    {
+      config.want_autorange = true;
+      config.range_min = stoi(tokens[1]);
+      config.range_max = stoi(tokens[2]);
+      config.range_latch = stoi(tokens[3]);
+    }
+    else if ("biquads" == tokens[0])
+    {
+      GetCriteria(tokens, 2, criteria);
+      is_ok = LoadTable(tokens[1], table);
+
+      if (is_ok)
+      {
+        pipe.banks = GetColumnExtent(table, "bank", criteria);
+        stagecount = GetColumnExtent(table, "stage", criteria);
+
+        if ( (pipe.banks > NLOOPRUN_MAXBANKS)
+          || (stagecount > NLOOPRUN_MAXSTAGES) )
+        {
+          cerr << "Filter bank is too large (" << pipe.banks << " banks, "
+            << stagecount << " stages; limits are " << NLOOPRUN_MAXBANKS
+            << " and " << NLOOPRUN_MAXSTAGES << ").\n";
+          is_ok = false;
+        }
+        else
+        {
+          if (!nloop_ReadBiquadCoeffs<run_samp_t>(
+            table, pipe.biquads, criteria, bankremap ))
+          {
+            cerr << "Malformed integer cells in \"" << tokens[1]
+              << "\".\n";
+            is_ok = false;
+          }
+          pipe.biquads.SetActiveBanks(pipe.banks);
+          pipe.biquads.SetActiveStages(stagecount);
+        }
+      }
+    }
+    else if ("minperiods" == tokens[0])
+    {
+      for (tidx = 1; (tidx <= NLOOPRUN_MAXBANKS) && ("" != tokens[tidx]);
+        tidx++)
+        minperiods.data[tidx - 1][0] = stoi(tokens[tidx]);
+    }
+    else if ("average" == tokens[0])
+    {
+      config.avg_coeff = stoi(tokens[1]);
+      config.avg_bits = (uint8_t) stoi(tokens[2]);
+    }
+    else if ("thresholds" == tokens[0])
+    {
+      pipe.thresh_high.SetUniformValue(stoi(tokens[1]));
+      pipe.thresh_low.SetUniformValue(stoi(tokens[2]));
+    }
+    else if ("thresholds_csv" == tokens[0])
+    {
+      GetCriteria(tokens, 2, criteria);
+      is_ok = LoadTable(tokens[1], table);
+
+      if (is_ok)
+      {
+        colnames.clear();
+        colnames.push_back("bank");
+        colnames.push_back("chan");
+        colnames.push_back("high");
+        colnames.push_back("low");
+
+        reader.AttachTable(table);
+        reader.SelectColumns(colnames);
+        reader.SetCriteria(criteria);
+
+        while (reader.ReadRow(cellvals))
+          if ( (0 <= cellvals[0]) && (NLOOPRUN_MAXBANKS > cellvals[0])
+            && (0 <= cellvals[1]) && (NLOOPRUN_MAXCHANS > cellvals[1]) )
+          {
+            pipe.thresh_high.data[cellvals[0]][cellvals[1]] =
+              (run_samp_t) cellvals[2];
+            pipe.thresh_low.data[cellvals[0]][cellvals[1]] =
+              (run_samp_t) cellvals[3];
+          }
+
+        if (0 < reader.GetBadCellCount())
+        {
+          cerr << "Malformed integer cells in \"" << tokens[1] << "\".\n";
+          is_ok = false;
+        }
+      }
+    }
+    else if ("deglitch" == tokens[0])
+    {
+      config.deglitch_rise = stoi(tokens[1]);
+      config.deglitch_fall = stoi(tokens[2]);
+    }
+    else if ("triggers" == tokens[0])
+    {
+      GetCriteria(tokens, 2, criteria);
+      is_ok = LoadTable(tokens[1], table);
+
+      if (is_ok)
+      {
+        colnames.clear();
+        colnames.push_back("bank");
+        colnames.push_back("chan");
+        colnames.push_back("enabled");
+        colnames.push_back("duration");
+        colnames.push_back("cooldown");
+        colnames.push_back("reraise");
+
+        // Only listed triggers are enabled.
+        enableflags.SetUniformValue(false);
+        pipe.triggers.SetEnableFlags(enableflags);
+
+        reader.AttachTable(table);
+        reader.SelectColumns(colnames);
+        reader.SetCriteria(criteria);
+
+        while (reader.ReadRow(cellvals))
+        {
+          pipe.triggers.SetOneEnableFlag( (int) cellvals[0],
+            (int) cellvals[1], (0 != cellvals[2]) );
+          pipe.triggers.SetOnePulseDuration( (int) cellvals[0],
+            (int) cellvals[1], (run_index_t) cellvals[3] );
+          pipe.triggers.SetOnePulseCooldown( (int) cellvals[0],
+            (int) cellvals[1], (run_index_t) cellvals[4] );
+          pipe.triggers.SetOneReRaise( (int) cellvals[0],
+            (int) cellvals[1], (0 != cellvals[5]) );
+        }
+
+        if (0 < reader.GetBadCellCount())
+        {
+          cerr << "Malformed integer cells in \"" << tokens[1] << "\".\n";
+          is_ok = false;
+        }
+      }
+    }
+    else if ("trigger_lut" == tokens[0])
+    {
+      GetCriteria(tokens, 4, criteria);
+      is_ok = LoadTable(tokens[1], table);
+
+      if (is_ok)
+      {
+        lutrows = GetColumnExtent(table, "row", criteria);
+        if (lutrows > NLOOPRUN_MAXLUTROWS)
+        {
+          cerr << "Lookup table is too large (" << lutrows
+            << " rows; limit is " << NLOOPRUN_MAXLUTROWS << ").\n";
+          is_ok = false;
+        }
+        else
+        {
+          if (!nloop_ReadLookupTablePerBank<run_index_t, run_index_t>(
+            table, pipe.targetlut, tokens[2], tokens[3],
+            criteria, bankremap ))
+          {
+            cerr << "Malformed integer cells in \"" << tokens[1]
+              << "\".\n";
+            is_ok = false;
+          }
+          pipe.targetlut.SetActiveRows(lutrows);
+          config.have_lut = true;
+        }
+      }
+    }
+    else if ("trigger_target" == tokens[0])
+      config.trigger_target = stoi(tokens[1]);
+    else if ("trigger_quota" == tokens[0])
+    {
+      config.trigger_window = stoll(tokens[1]);
+      config.trigger_count = stoll(tokens[2]);
+    }
+    else if ("score_phase" == tokens[0])
+      config.score_phase = stod(tokens[1]);
+    else if ("score_late" == tokens[0])
+      config.score_late = stoi(tokens[1]);
+    else if ("bursts_out" == tokens[0])
+      config.bursts_name = tokens[1];
+    else if ("triggers_out" == tokens[0])
+      config.triggers_name = tokens[1];
+    else if ("sweep" == tokens[0])
+    {
+      is_ok = ParseVariant(tokens, thisvariant);
+
+      if (is_ok && (NLOOPRUN_MAXVARIANTS <= config.variants.size()))
+      {
+        cerr << "Too many sweep variants (limit is " << NLOOPRUN_MAXVARIANTS
+          << ").\n";
+        is_ok = false;
+      }
+
+      if (is_ok)
+        config.variants.push_back(thisvariant);
+    }
+    else if ("sweep_threads" == tokens[0])
+      config.sweep_threads = stoi(tokens[1]);
+    else if ("sweep_out" == tokens[0])
+      config.sweep_name = tokens[1];
+    else
+    {
+      cerr << "Unknown keyword \"" << tokens[0] << "\".\n";
+      is_ok = false;
+    }
+
+    if (!is_ok)
+      cerr << "Error at line " << linenum << " of \"" << filename
+        << "\".\n";
+  }
+
+  if (is_ok && ("" == config.input_name))
+  {
+    cerr << "No input file specified.\n";
+    is_ok = false;
+  }
+
+  if (is_ok && (pipe.banks < 1))
+  {
+    cerr << "No filter bank specified.\n";
+    is_ok = false;
+  }
+
+  if (is_ok && config.have_lut && (0 < config.variants.size()))
+  {
+    cerr << "Trigger lookup tables can't be used in sweeps.\n";
+    is_ok = false;
+  }
+
+  if (is_ok)
+  {
+    pipe.analytic.ResetState();
+    pipe.analytic.SetMinPeriods(minperiods);
+  }
+
+  return is_ok;
+}
+
+
+
+// This finishes configuring the pipeline once the input geometry is known.
+
+void ConfigurePipeline(run_config_t &config, run_pipeline_t &pipe,
+  size_t framecount)
+{
+  run_sampslice_t zeroslice;
+  int bidx, cidx;
+
+  pipe.ranger.SetDesiredRange(config.range_min, config.range_max);
+  pipe.ranger.ResetTracking(false);
+  pipe.ranger.LatchAfter(config.range_latch);
+
+  pipe.biquads.SetActiveChans(pipe.chans);
+
+  pipe.analytic.SetActiveBanks(pipe.banks);
+  pipe.analytic.SetActiveChans(pipe.chans);
+
+  pipe.averagers.SetActiveBanks(pipe.banks);
+  pipe.averagers.SetActiveChans(pipe.chans);
+  pipe.averagers.SetUniformCoeffs(config.avg_coeff);
+  pipe.averagers.SetUniformAvgBits(config.avg_bits);
+  zeroslice.SetUniformValue(0);
+  pipe.averagers.InitAverage(zeroslice);
+
+  pipe.threshdual.ResetState();
+  pipe.deglitch.SetUniformDelays(config.deglitch_rise, config.deglitch_fall);
+
+  pipe.targetlut.SetActiveBanks(pipe.banks);
+  pipe.targetlut.SetActiveChans(pipe.chans);
+  pipe.targets.SetUniformValue(config.trigger_target);
+
+  pipe.triggers.SetActiveBanks(pipe.banks);
+  pipe.triggers.SetActiveChans(pipe.chans);
+
+  // The default window covers the whole recording.
+  if ( ((long long) framecount) < config.trigger_window )
+    config.trigger_window = framecount;
+  pipe.triggers.EnableTriggering( (run_index_t) config.trigger_window,
+    (run_index_t) config.trigger_count );
+
+  for (bidx = 0; bidx < NLOOPRUN_MAXBANKS; bidx++)
+    for (cidx = 0; cidx < NLOOPRUN_MAXCHANS; cidx++)
+    {
+      pipe.burst_start[bidx][cidx] = -1;
+      pipe.burst_peak[bidx][cidx] = 0;
+      pipe.trig_start[bidx][cidx] = -1;
+    }
+
+  pipe.burst_total = 0;
+  pipe.trig_total = 0;
+
+  // Degrees to 1/65536 cycles.
+  pipe.scorer.SetActiveGeometry(pipe.banks, pipe.chans);
+  pipe.scorer.SetTargetPhase( (uint16_t) (0xffff & lround(
+    fmod(config.score_phase, 360.0) * 65536.0 / 360.0 )) );
+  pipe.scorer.SetLateWindow(config.score_late);
+  pipe.scorer.ResetState();
+}
+
+
+
+// This builds a sweep runner from a configured pipeline and starts its
+// workers. The shared stages and each variant's defaults are copies of
+// the pipeline's modules. This returns NULL if workers couldn't start.
+
+run_sweep_t *BuildSweep(run_config_t &config, run_pipeline_t &pipe)
+{
+  run_sweep_t *sweep;
+  run_sweep_t::variant_t *variant;
+  run_sampslice_t zeroslice;
+  int threadcount;
+  size_t vidx;
+
+  sweep = new run_sweep_t;
+
+  sweep->GetRanger() = pipe.ranger;
+  sweep->GetFilterBank() = pipe.biquads;
+  sweep->GetAnalytic() = pipe.analytic;
+  sweep->SetAutoRange(config.want_autorange);
+
+  zeroslice.SetUniformValue(0);
+
+  for (vidx = 0; vidx < config.variants.size(); vidx++)
+  {
+    run_variant_t &thisconfig = config.variants[vidx];
+
+    variant = sweep->AddVariant();
+
+    variant->GetAverager() = pipe.averagers;
+    if (thisconfig.want_average)
+    {
+      variant->GetAverager().SetUniformCoeffs(thisconfig.avg_coeff);
+      variant->GetAverager().SetUniformAvgBits(thisconfig.avg_bits);
+      variant->GetAverager().InitAverage(zeroslice);
+    }
+
+    variant->SetThresholds(pipe.thresh_high, pipe.thresh_low);
+    if (thisconfig.want_thresholds)
+      variant->SetUniformThresholds( thisconfig.thresh_high,
+        thisconfig.thresh_low );
+
+    variant->GetDeGlitcher() = pipe.deglitch;
+    if (thisconfig.want_deglitch)
+      variant->GetDeGlitcher().SetUniformDelays( thisconfig.deglitch_rise,
+        thisconfig.deglitch_fall );
+
+    variant->SetTargets(pipe.targets);
+    if (thisconfig.want_target)
+      variant->SetUniformTargets(thisconfig.trigger_target);
+
+    variant->GetTriggers() = pipe.triggers;
+    variant->GetScorer() = pipe.scorer;
+  }
+
+  sweep->SetActiveGeometry(pipe.banks, pipe.chans);
+
+  // By default, leave one core for the shared stages, and don't start
+  // more workers than there are variants.
+  threadcount = config.sweep_threads;
+  if (1 > threadcount)
+  {
+    threadcount = ((int) thread::hardware_concurrency()) - 1;
+    if (threadcount > (int) config.variants.size())
+      threadcount = (int) config.variants.size();
+    if (1 > threadcount)
+      threadcount = 1;
+  }
+
+  if (!sweep->StartWorkers(config.blocksize, threadcount, -1))
+  {
+    delete sweep;
+    return NULL;
+  }
+
+  config.sweep_threads = threadcount;
+
+  return sweep;
+}
+
+
+
+// This runs one block through the pipeline, one stage at a time.
+
+void ProcessBlock(run_config_t &config, run_pipeline_t &pipe, int count)
+{
+  int sidx;
+
+  // Pre-processing. This works in-place.
+  if (config.want_autorange)
+    for (sidx = 0; sidx < count; sidx++)
+    {
+      pipe.ranger.UpdateFromSample(pipe.inblock[sidx]);
+      pipe.ranger.GetLatchedOutput(pipe.inblock[sidx], pipe.inblock[sidx]);
+    }
+
+  // Filter bank.
+  for (sidx = 0; sidx < count; sidx++)
+    pipe.biquads.ApplyBankOnce(pipe.inblock[sidx], pipe.filtblock[sidx]);
+
+  // Analytic signal estimation.
+  for (sidx = 0; sidx < count; sidx++)
+  {
+    pipe.analytic.HandleSamples(pipe.filtblock[sidx]);
+    pipe.analytic.GetEstimatedAnalytic( pipe.magblock[sidx],
+      pipe.periodblock[sidx], pipe.riseblock[sidx], pipe.fallblock[sidx] );
+  }
+
+  // Averaging.
+  for (sidx = 0; sidx < count; sidx++)
+    pipe.averagers.UpdateAverage(pipe.magblock[sidx], pipe.avgblock[sidx]);
+
+  // Detection.
+  for (sidx = 0; sidx < count; sidx++)
+  {
+    pipe.threshsingle.TestSamples( pipe.avgblock[sidx], pipe.thresh_high,
+      pipe.flag_high );
+    pipe.threshsingle.TestSamples( pipe.avgblock[sidx], pipe.thresh_low,
+      pipe.flag_low );
+    pipe.threshdual.TestDual(pipe.flag_high, pipe.flag_low, pipe.detected);
+    pipe.deglitch.ProcessSample(pipe.detected, pipe.burstblock[sidx]);
+  }
+
+  // Triggering. Targets come from the period if there's a lookup table.
+  for (sidx = 0; sidx < count; sidx++)
+  {
+    if (config.have_lut)
+      pipe.targetlut.LookupAll_LE(pipe.periodblock[sidx], pipe.targets);
+
+    pipe.triggers.ProcessSamples( pipe.riseblock[sidx], pipe.targets,
+      pipe.periodblock[sidx], pipe.burstblock[sidx], pipe.trigblock[sidx] );
+  }
+}
+
+
+
+// This finds burst and trigger edges in a processed block, and writes
+// completed events. "firstframe" is the block's starting frame index.
+// If "want_flush" is set, events still in progress are ended.
+
+void WriteEvents(run_pipeline_t &pipe, int count, long long firstframe,
+  bool want_flush, nloop_CSVWriter_t *burstwriter,
+  nloop_CSVWriter_t *trigwriter)
+{
+  int sidx, bidx, cidx;
+  bool thisflag;
+  run_samp_t thismag;
+
+  for (bidx = 0; bidx < pipe.banks; bidx++)
+    for (cidx = 0; cidx < pipe.chans; cidx++)
+    {
+      long long &burst_start = pipe.burst_start[bidx][cidx];
+      run_samp_t &burst_peak = pipe.burst_peak[bidx][cidx];
+      long long &trig_start = pipe.trig_start[bidx][cidx];
+
+      for (sidx = 0; sidx < count; sidx++)
+      {
+        // Bursts.
+        thisflag = pipe.burstblock[sidx].data[bidx][cidx];
+        thismag = pipe.magblock[sidx].data[bidx][cidx];
+
+        if (thisflag && (burst_start < 0))
+        {
+          burst_start = firstframe + sidx;
+          burst_peak = thismag;
+        }
+        else if (thisflag && (thismag > burst_peak))
+          burst_peak = thismag;
+        else if ( (!thisflag) && (0 <= burst_start) )
+        {
+          if (NULL != burstwriter)
+          {
+            burstwriter->AddInteger(bidx);
+            burstwriter->AddInteger(cidx);
+            burstwriter->AddInteger(burst_start);
+            burstwriter->AddInteger(firstframe + sidx);
+            burstwriter->AddInteger(burst_peak);
+            burstwriter->EndRow();
+          }
+          pipe.burst_total++;
+          burst_start = -1;
+        }
+
+        // Triggers.
+        thisflag = pipe.trigblock[sidx].data[bidx][cidx];
+
+        if (thisflag && (trig_start < 0))
+          trig_start = firstframe + sidx;
+        else if ( (!thisflag) && (0 <= trig_start) )
+        {
+          if (NULL != trigwriter)
+          {
+            trigwriter->AddInteger(bidx);
+            trigwriter->AddInteger(cidx);
+            trigwriter->AddInteger(trig_start);
+            trigwriter->AddInteger(firstframe + sidx);
+            trigwriter->EndRow();
+          }
+          pipe.trig_total++;
+          trig_start = -1;
+        }
+      }
+
+      if ( want_flush && (0 <= burst_start) )
+      {
+        if (NULL != burstwriter)
+        {
+          burstwriter->AddInteger(bidx);
+          burstwriter->AddInteger(cidx);
+          burstwriter->AddInteger(burst_start);
+          burstwriter->AddInteger(firstframe + count);
+          burstwriter->AddInteger(burst_peak);
+          burstwriter->EndRow();
+        }
+        pipe.burst_total++;
+        burst_start = -1;
+      }
+
+      if ( want_flush && (0 <= trig_start) )
+      {
+        if (NULL != trigwriter)
+        {
+          trigwriter->AddInteger(bidx);
+          trigwriter->AddInteger(cidx);
+          trigwriter->AddInteger(trig_start);
+          trigwriter->AddInteger(firstframe + count);
+          trigwriter->EndRow();
+        }
+        pipe.trig_total++;
+        trig_start = -1;
+      }
+    }
+}
+
+
+
+// This prints detection and trigger accuracy, for synthetic input.
+
+void PrintScore(run_config_t &config, run_pipeline_t &pipe)
+{
+  nloop_DetectionScorer_t<NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> &scorer =
+    pipe.scorer;
+  nloop_CycleHistogram_t &latencies = scorer.GetLatencies();
+  nloop_CycleHistogram_t &phase_errors = scorer.GetPhaseErrors();
+  double units_to_deg;
+
+  units_to_deg = 360.0 / 65536.0;
+
+  cout << "Bursts: " << scorer.GetBurstCount() << " scored, "
+    << scorer.GetHitCount() << " hit, " << scorer.GetMissCount()
+    << " missed";
+  if (0 < scorer.GetBurstCount())
+    cout << " (hit rate " << ( 100.0 * scorer.GetHitCount()
+      / scorer.GetBurstCount() ) << "%)";
+  cout << ".\n";
+
+  if (0 < latencies.GetCount())
+  {
+    cout << "Latency (samples): mean "
+      << ( ((double) latencies.GetTotal()) / latencies.GetCount() )
+      << ", p50 " << latencies.GetPercentile(500)
+      << ", p90 " << latencies.GetPercentile(900)
+      << ", p99 " << latencies.GetPercentile(990)
+      << ", max " << latencies.GetMax() << ".\n";
+
+    if (0 < config.samprate)
+      cout << "Latency (ms): p50 "
+        << (1000.0 * latencies.GetPercentile(500) / config.samprate)
+        << ", p99 "
+        << (1000.0 * latencies.GetPercentile(990) / config.samprate)
+        << ".\n";
+  }
+
+  cout << "False alarms: " << scorer.GetFalseAlarmCount() << " in "
+    << scorer.GetQuietSampleCount() << " quiet channel-samples";
+  if (0 < scorer.GetQuietSampleCount())
+  {
+    if (0 < config.samprate)
+      cout << " (" << ( scorer.GetFalseAlarmCount() * config.samprate
+        / scorer.GetQuietSampleCount() ) << " per channel-second)";
+    else
+      cout << " (" << ( 1000.0 * scorer.GetFalseAlarmCount()
+        / scorer.GetQuietSampleCount() ) << " per 1000 samples)";
+  }
+  cout << ".\n";
+
+  cout << "Triggers: " << scorer.GetTriggerCount() << " during bursts, "
+    << scorer.GetStrayTriggerCount() << " stray.\n";
+
+  if (0 < scorer.GetTriggerCount())
+    cout << "Phase error (degrees, target " << config.score_phase
+      << "): mean " << ( units_to_deg * scorer.GetPhaseErrorSum()
+        / scorer.GetTriggerCount() )
+      << ", |p50| " << (units_to_deg * phase_errors.GetPercentile(500))
+      << ", |p90| " << (units_to_deg * phase_errors.GetPercentile(900))
+      << ", |max| " << (units_to_deg * phase_errors.GetMax()) << ".\n";
+}
+
+
+
+// This prints one summary line per sweep variant. Scores are included for
+// synthetic input.
+
+void PrintSweep(run_config_t &config, run_sweep_t &sweep)
+{
+  run_sweep_t::variant_t *variant;
+  double units_to_deg;
+  int vidx;
+
+  units_to_deg = 360.0 / 65536.0;
+
+  cout << "Sweep results:\n";
+
+  for (vidx = 0; vidx < sweep.GetVariantCount(); vidx++)
+  {
+    variant = sweep.GetVariant(vidx);
+    nloop_DetectionScorer_t<NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> &scorer =
+      variant->GetScorer();
+
+    cout << "  " << config.variants[vidx].label << ":  "
+      << variant->GetBurstCount() << " burst(s),  "
+      << variant->GetTriggerCount() << " pulse(s)";
+
+    if (config.is_synth)
+    {
+      if (0 < scorer.GetBurstCount())
+        cout << ",  hit rate " << ( 100.0 * scorer.GetHitCount()
+          / scorer.GetBurstCount() ) << "%";
+      cout << ",  " << scorer.GetFalseAlarmCount() << " false alarm(s)";
+      if (0 < scorer.GetLatencies().GetCount())
+        cout << ",  latency p50 " << scorer.GetLatencies().GetPercentile(500);
+      if (0 < scorer.GetTriggerCount())
+        cout << ",  phase error mean " << ( units_to_deg
+          * scorer.GetPhaseErrorSum() / scorer.GetTriggerCount() )
+          << " |p50| "
+          << (units_to_deg * scorer.GetPhaseErrors().GetPercentile(500));
+    }
+
+    cout << "\n";
+  }
+}
+
+
+
+// This writes one CSV row per sweep variant. Score columns are left empty
+// for recordings. Latencies are in samples, and phase errors are in
+// 1/65536 cycles. This returns false on error.
+
+bool WriteSweep(run_config_t &config, run_sweep_t &sweep)
+{
+  ofstream outfile;
+  nloop_CSVWriter_t writer;
+  vector<string> colnames;
+  run_sweep_t::variant_t *variant;
+  int vidx, colidx;
+
+  outfile.open(config.sweep_name.c_str(), ios::out | ios::trunc);
+  if (!outfile.is_open())
+  {
+    cerr << "Couldn't write \"" << config.sweep_name << "\".\n";
+    return false;
+  }
+
+  colnames.push_back("label");
+  colnames.push_back("bursts");
+  colnames.push_back("triggers");
+  colnames.push_back("scored");
+  colnames.push_back("hits");
+  colnames.push_back("misses");
+  colnames.push_back("false_alarms");
+  colnames.push_back("quiet_samples");
+  colnames.push_back("latency_p50");
+  colnames.push_back("latency_p99");
+  colnames.push_back("burst_triggers");
+  colnames.push_back("stray_triggers");
+  colnames.push_back("phase_error_sum");
+  colnames.push_back("phase_error_p50");
+  writer.Start(outfile, colnames, true);
+
+  for (vidx = 0; vidx < sweep.GetVariantCount(); vidx++)
+  {
+    variant = sweep.GetVariant(vidx);
+    nloop_DetectionScorer_t<NLOOPRUN_MAXBANKS, NLOOPRUN_MAXCHANS> &scorer =
+      variant->GetScorer();
+
+    writer.AddText(config.variants[vidx].label);
+    writer.AddInteger(variant->GetBurstCount());
+    writer.AddInteger(variant->GetTriggerCount());
+
+    if (config.is_synth)
+    {
+      writer.AddInteger(scorer.GetBurstCount());
+      writer.AddInteger(scorer.GetHitCount());
+      writer.AddInteger(scorer.GetMissCount());
+      writer.AddInteger(scorer.GetFalseAlarmCount());
+      writer.AddInteger(scorer.GetQuietSampleCount());
+      writer.AddInteger(scorer.GetLatencies().GetPercentile(500));
+      writer.AddInteger(scorer.GetLatencies().GetPercentile(990));
+      writer.AddInteger(scorer.GetTriggerCount());
+      writer.AddInteger(scorer.GetStrayTriggerCount());
+      writer.AddInteger(scorer.GetPhaseErrorSum());
+      writer.AddInteger(scorer.GetPhaseErrors().GetPercentile(500));
+    }
+    else
+      for (colidx = 3; colidx < (int) colnames.size(); colidx++)
+        writer.AddEmpty();
+
+    writer.EndRow();
+  }
+
+  return writer.IsOk();
+}
+
+
+
+#ifdef NLOOP_PROFILE
+
+// This prints per-stage call times, from the profiling histograms.
+
+void PrintProfile(void)
+{
+  uint64_t count, p50, p99, maxval;
+  int sidx;
+
+  cout << "Stage timing (ticks per call):\n";
+
+  for (sidx = 0; sidx < NLOOP_PROF_STAGECOUNT; sidx++)
+    if ( nloop_GetProfiler().GetStageSummary( sidx, count, p50, p99,
+      maxval ) )
+      cout << "  " << nloop_GetProfileStageName(sidx) << ": " << count
+        << " calls, p50 " << p50 << ", p99 " << p99 << ", max " << maxval
+        << "\n";
+}
+
+#endif
+
+
+//
+// Main Program
+
+
+int main(int argc, char **argv)
+{
+  run_config_t config;
+  run_pipeline_t *pipe;
+  run_sweep_t *sweep;
+  nloop_RawRecording_t rawfile;
+  nloop_EDFReader_t edffile;
+  ofstream burstfile, trigfile;
+  nloop_CSVWriter_t burstwriter, trigwriter;
+  nloop_CSVWriter_t *burstptr, *trigptr;
+  vector<string> colnames;
+  chrono::steady_clock::time_point tstart, tend, tblock;
+  double dsp_seconds, total_seconds;
+  size_t framecount;
+  long long frames_done;
+  int count, cidx, sidx;
+  bool is_ok;
+
+  if (2 != argc)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  InitConfig(config);
+  pipe = new run_pipeline_t;
+
+  if (!ReadConfig(argv[1], config, *pipe))
+  {
+    delete pipe;
+    return 1;
+  }
+
+  // The lookup tables use the vector kernels (nloop-dispatch.h).
+  if (!nloop_CPULevelOverrideOk())
+    cerr << "Unknown " << NLOOP_CPU_LEVEL_ENV << " value; using \""
+      << nloop_CPULevelName(nloop_CPUGetLevel()) << "\".\n";
+
+
+  // Open the input.
+
+  if (config.is_synth)
+  {
+    is_ok = true;
+    pipe->chans = config.synth_chans;
+    framecount = (size_t) config.synth_frames;
+    pipe->synth.Reset(config.synth_seed);
+  }
+  else if (config.is_edf)
+  {
+    is_ok = edffile.OpenFile(config.input_name);
+    if (is_ok)
+    {
+      pipe->chans = edffile.GetChanCount();
+      framecount = edffile.GetFrameCount();
+      config.samprate = edffile.GetSampleRate();
+
+      if (config.want_physical)
+        is_ok = edffile.SetPhysicalScaling(config.physical_units);
+      else if (config.want_scale)
+        for (cidx = 0; is_ok && (cidx < pipe->chans); cidx++)
+          is_ok = edffile.SetChanScaling(cidx, config.scale_gain,
+            config.scale_offset);
+
+      if (!is_ok)
+      {
+        cerr << "Scaling for \"" << config.input_name
+          << "\" is out of range.\n";
+        delete pipe;
+        return 1;
+      }
+    }
+  }
+  else
+  {
+    is_ok = rawfile.OpenFile( config.input_name, config.raw_chans,
+      config.raw_type, config.raw_header );
+    if (is_ok)
+    {
+      pipe->chans = rawfile.GetChanCount();
+      framecount = rawfile.GetFrameCount();
+
+      if (config.want_scale)
+        rawfile.SetScaling(config.scale_gain, config.scale_offset);
+    }
+  }
+
+  if (!is_ok)
+  {
+    cerr << "Couldn't read \"" << config.input_name << "\".\n";
+    delete pipe;
+    return 1;
+  }
+
+  if (pipe->chans > NLOOPRUN_MAXCHANS)
+  {
+    cerr << "Warning: Only the first " << NLOOPRUN_MAXCHANS << " of "
+      << pipe->chans << " channels will be processed.\n";
+    pipe->chans = NLOOPRUN_MAXCHANS;
+  }
+
+  ConfigurePipeline(config, *pipe, framecount);
+
+  sweep = NULL;
+  if (0 < config.variants.size())
+  {
+    sweep = BuildSweep(config, *pipe);
+    if (NULL == sweep)
+    {
+      cerr << "Couldn't start sweep workers.\n";
+      delete pipe;
+      return 1;
+    }
+
+    if ( ("" != config.bursts_name) || ("" != config.triggers_name) )
+    {
+      cerr << "Warning: Burst and trigger files aren't written by sweeps.\n";
+      config.bursts_name = "";
+      config.triggers_name = "";
+    }
+  }
+
+
+  // Open the outputs.
+
+  burstptr = NULL;
+  if ("" != config.bursts_name)
+  {
+    burstfile.open(config.bursts_name.c_str(), ios::out | ios::trunc);
+    if (!burstfile.is_open())
+    {
+      cerr << "Couldn't write \"" << config.bursts_name << "\".\n";
+      delete pipe;
+      return 1;
+    }
+
+    colnames.clear();
+    colnames.push_back("bank");
+    colnames.push_back("chan");
+    colnames.push_back("start");
+    colnames.push_back("end");
+    colnames.push_back("peak");
+    burstwriter.Start(burstfile, colnames, true);
+    burstptr = &burstwriter;
+  }
+
+  trigptr = NULL;
+  if ("" != config.triggers_name)
+  {
+    trigfile.open(config.triggers_name.c_str(), ios::out | ios::trunc);
+    if (!trigfile.is_open())
+    {
+      cerr << "Couldn't write \"" << config.triggers_name << "\".\n";
+      delete pipe;
+      return 1;
+    }
+
+    colnames.clear();
+    colnames.push_back("bank");
+    colnames.push_back("chan");
+    colnames.push_back("start");
+    colnames.push_back("end");
+    trigwriter.Start(trigfile, colnames, true);
+    trigptr = &trigwriter;
+  }
+
+
+  // Stream the recording through the pipeline.
+
+  cout << "Processing " << framecount << " frames (" << pipe->chans
+    << " channels, " << pipe->banks << " banks) from \""
+    << config.input_name << "\".\n";
+  if (NULL != sweep)
+    cout << "Sweeping " << sweep->GetVariantCount() << " variant(s) on "
+      << config.sweep_threads << " worker thread(s).\n";
+
+  frames_done = 0;
+  dsp_seconds = 0;
+  tstart = chrono::steady_clock::now();
+
+  do
+  {
+    if (config.is_synth)
+    {
+      count = config.blocksize;
+      if ( ((long long) count) > (config.synth_frames - frames_done) )
+        count = (int) (config.synth_frames - frames_done);
+      pipe->synth.GenerateBlock( pipe->inblock, pipe->truthblock,
+        pipe->phaseblock, count );
+    }
+    else if (config.is_edf)
+      count = (int) edffile.ReadNextSlices<run_samp_t, NLOOPRUN_MAXCHANS>(
+        config.blocksize, pipe->inblock );
+    else
+      count = (int) rawfile.ReadNextSlices<run_samp_t, NLOOPRUN_MAXCHANS>(
+        config.blocksize, pipe->inblock );
+
+    tblock = chrono::steady_clock::now();
+    if (NULL != sweep)
+      sweep->ProcessBlock( pipe->inblock,
+        (config.is_synth ? pipe->truthblock : NULL),
+        (config.is_synth ? pipe->phaseblock : NULL), count );
+    else
+      ProcessBlock(config, *pipe, count);
+    dsp_seconds += chrono::duration<double>(
+      chrono::steady_clock::now() - tblock ).count();
+
+    // Sweep variants track their own counts and scores.
+    if (NULL == sweep)
+    {
+      WriteEvents( *pipe, count, frames_done, (count < config.blocksize),
+        burstptr, trigptr );
+
+      if (config.is_synth)
+        for (sidx = 0; sidx < count; sidx++)
+          pipe->scorer.ProcessSample( pipe->truthblock[sidx],
+            pipe->phaseblock[sidx], pipe->burstblock[sidx],
+            pipe->trigblock[sidx] );
+    }
+
+    frames_done += count;
+  }
+  while (count == config.blocksize);
+
+  tend = chrono::steady_clock::now();
+  total_seconds = chrono::duration<double>(tend - tstart).count();
+
+
+  // Report.
+
+  is_ok = true;
+  if (NULL != burstptr)
+    is_ok = is_ok && burstwriter.IsOk();
+  if (NULL != trigptr)
+    is_ok = is_ok && trigwriter.IsOk();
+
+  if (NULL == sweep)
+    cout << "Found " << pipe->burst_total << " burst(s) and "
+      << pipe->trig_total << " trigger pulse(s).\n";
+
+  if ( (0 < total_seconds) && (0 < dsp_seconds) )
+  {
+    cout << "Total:  " << total_seconds << " s, "
+      << (frames_done / total_seconds) << " samples/sec per channel, "
+      << (frames_done * pipe->chans / total_seconds)
+      << " samples/sec overall.\n";
+    cout << "DSP:    " << dsp_seconds << " s, "
+      << (frames_done / dsp_seconds) << " samples/sec per channel, "
+      << (frames_done * pipe->chans / dsp_seconds)
+      << " samples/sec overall.\n";
+
+    if (0 < config.samprate)
+      cout << "Speed:  " << (frames_done / config.samprate / total_seconds)
+        << "x real-time.\n";
+  }
+
+  if (NULL != sweep)
+  {
+    PrintSweep(config, *sweep);
+    if ("" != config.sweep_name)
+      is_ok = is_ok && WriteSweep(config, *sweep);
+  }
+  else if (config.is_synth)
+    PrintScore(config, *pipe);
+
+#ifdef NLOOP_PROFILE
+  PrintProfile();
+#endif
+
+  if (!is_ok)
+    cerr << "Error writing output files.\n";
+
+  if (NULL != sweep)
+    delete sweep;
+  delete pipe;
+
+  return (is_ok ? 0 : 1);
+}
+
+
+//
+// This is the end of the file.